@@ -164,33 +164,124 @@ PWIN32_FIND_DATAW VfsFileList_FindSingle(_In_ PVFS_FILELIST pFileList, _In_ LPWS
 //-------------------------------------------------------------------------------
 // DIRECTORY LISTINGS READ CACHE BELOW:
 // (caching is used to cache vmmproc directory listings for performance reasons)
+// The cache is a set-associative hash table keyed on the directory path. Every
+// cached directory holds an index of its files sorted by name for fast lookup.
+// The lifetime of a cached directory is decided per subtree - see below.
 //-------------------------------------------------------------------------------
 
+typedef struct tdVFS_CACHE_DIRECTORY {
+    QWORD qwHash;
+    QWORD qwExpireTickCount64;
+    WCHAR wszDirectoryName[MAX_PATH];
+    PVFS_FILELIST pFileList;
+    DWORD cFiles;
+    PWIN32_FIND_DATAW ppFiles[];        // sorted by file name
+} VFS_CACHE_DIRECTORY, *PVFS_CACHE_DIRECTORY;
+
+typedef struct tdVFS_CACHE_DIRECTORY_LIFETIME {
+    LPCWSTR wszPrefix;
+    DWORD dwMsVolatile;
+    DWORD dwMsStatic;
+} VFS_CACHE_DIRECTORY_LIFETIME;
+
+// directory listing lifetimes per subtree (first match) - contents of the
+// .status directory (file sizes) may change at any time, process directories
+// change frequently on live memory but are stable on static memory dumps.
+static const VFS_CACHE_DIRECTORY_LIFETIME g_VfsCacheDirectoryLifetime[] = {
+    { L"\\.status", VMMVFS_CACHE_DIRECTORY_LIFETIME_PROC_MS, VMMVFS_CACHE_DIRECTORY_LIFETIME_PROC_MS },
+    { L"\\name",    VMMVFS_CACHE_DIRECTORY_LIFETIME_PROC_MS, VMMVFS_CACHE_DIRECTORY_LIFETIME_STATIC_MS },
+    { L"\\pid",     VMMVFS_CACHE_DIRECTORY_LIFETIME_PROC_MS, VMMVFS_CACHE_DIRECTORY_LIFETIME_STATIC_MS },
+    { L"",          VMMVFS_CACHE_DIRECTORY_LIFETIME_PROC_MS, VMMVFS_CACHE_DIRECTORY_LIFETIME_STATIC_MS },
+};
+
+QWORD VfsCacheDirectory_Hash(_In_ LPCWSTR wsz)
+{
+    QWORD qwHash = 0xcbf29ce484222325;
+    while(*wsz) {
+        qwHash = (qwHash ^ *wsz) * 0x100000001b3;
+        wsz++;
+    }
+    return qwHash;
+}
+
+DWORD VfsCacheDirectory_LifetimeMs(_In_ LPCWSTR wcsDirectoryName)
+{
+    DWORD i;
+    SIZE_T cch;
+    for(i = 0; i < sizeof(g_VfsCacheDirectoryLifetime) / sizeof(VFS_CACHE_DIRECTORY_LIFETIME); i++) {
+        cch = wcslen(g_VfsCacheDirectoryLifetime[i].wszPrefix);
+        if(!wcsncmp(wcsDirectoryName, g_VfsCacheDirectoryLifetime[i].wszPrefix, cch) && (!cch || !wcsDirectoryName[cch] || (wcsDirectoryName[cch] == '\\'))) {
+            return ctxVfs->fVolatile ? g_VfsCacheDirectoryLifetime[i].dwMsVolatile : g_VfsCacheDirectoryLifetime[i].dwMsStatic;
+        }
+    }
+    return VMMVFS_CACHE_DIRECTORY_LIFETIME_PROC_MS;
+}
+
+int VfsCacheDirectory_CmpSort(_In_ PWIN32_FIND_DATAW *pp1, _In_ PWIN32_FIND_DATAW *pp2)
+{
+    return wcscmp((*pp1)->cFileName, (*pp2)->cFileName);
+}
+
+VOID VfsCacheDirectory_Free(_In_opt_ PVFS_CACHE_DIRECTORY pDir)
+{
+    if(pDir) {
+        VfsFileList_Free(pDir->pFileList);
+        LocalFree(pDir);
+    }
+}
+
+/*
+* Retrieve a non-expired cached directory. CacheDirectoryLock must be held.
+* -- wcsPath
+* -- return
+*/
+PVFS_CACHE_DIRECTORY VfsCacheDirectory_GetDirectory(_In_ LPCWSTR wcsPath)
+{
+    DWORD i;
+    PVFS_CACHE_DIRECTORY pDir;
+    QWORD qwHash = VfsCacheDirectory_Hash(wcsPath);
+    QWORD qwCurrentTickCount = GetTickCount64();
+    for(i = 0; i < VMMVFS_CACHE_DIRECTORY_WAYS; i++) {
+        pDir = (PVFS_CACHE_DIRECTORY)ctxVfs->CacheDirectory[qwHash % VMMVFS_CACHE_DIRECTORY_SETS][i];
+        if(pDir && (pDir->qwHash == qwHash) && (qwCurrentTickCount <= pDir->qwExpireTickCount64) && !wcscmp(wcsPath, pDir->wszDirectoryName)) {
+            return pDir;
+        }
+    }
+    return NULL;
+}
+
 _Success_(return)
 BOOL VfsCacheDirectory_GetSingle2(_In_ LPWSTR wszPath, _In_ LPWSTR wszFile, _Out_ PWIN32_FIND_DATAW pFindData, _Out_ PBOOL pIsDirectoryExisting)
 {
-    QWORD i, qwCurrentTickCount;
-    PWIN32_FIND_DATAW pFindDataCache;
-    qwCurrentTickCount = GetTickCount64();
+    int iCmp;
+    DWORD iMin, iMax, iMid;
+    BOOL fResult = FALSE;
+    PVFS_CACHE_DIRECTORY pDir;
     *pIsDirectoryExisting = FALSE;
-    EnterCriticalSection(&ctxVfs->CacheDirectoryLock);
-    for(i = 0; i < VMMVFS_CACHE_DIRECTORY_ENTRIES; i++) {
-        if(wcscmp(wszPath, ctxVfs->CacheDirectory[i].wszDirectoryName)) { continue; }
-        if(qwCurrentTickCount > ctxVfs->CacheDirectory[i].qwExpireTickCount64) { continue; }
+    AcquireSRWLockShared(&ctxVfs->CacheDirectoryLock);
+    if((pDir = VfsCacheDirectory_GetDirectory(wszPath))) {
         *pIsDirectoryExisting = TRUE;
-        pFindDataCache = VfsFileList_FindSingle(ctxVfs->CacheDirectory[i].pFileList, wszFile);
-        if(!pFindDataCache) {
-            LeaveCriticalSection(&ctxVfs->CacheDirectoryLock);
-            return FALSE;
-        }
-        if(pFindData) {
-            memcpy(pFindData, pFindDataCache, sizeof(WIN32_FIND_DATAW));
+        iMin = 0;
+        iMax = pDir->cFiles;
+        while(iMin < iMax) {
+            iMid = (iMin + iMax) / 2;
+            iCmp = wcscmp(wszFile, pDir->ppFiles[iMid]->cFileName);
+            if(iCmp == 0) {
+                if(pFindData) {
+                    memcpy(pFindData, pDir->ppFiles[iMid], sizeof(WIN32_FIND_DATAW));
+                }
+                fResult = TRUE;
+                break;
+            }
+            if(iCmp < 0) {
+                iMax = iMid;
+            } else {
+                iMin = iMid + 1;
+            }
         }
-        LeaveCriticalSection(&ctxVfs->CacheDirectoryLock);
-        return TRUE;
     }
-    LeaveCriticalSection(&ctxVfs->CacheDirectoryLock);
-    return FALSE;
+    ReleaseSRWLockShared(&ctxVfs->CacheDirectoryLock);
+    return fResult;
 }
 
 BOOL VfsCacheDirectory_GetSingle(_In_ LPWSTR wszPath, _In_ LPWSTR wszFile, _Out_ PWIN32_FIND_DATAW pFindData, _Out_ PBOOL pfIsDirectoryExisting)
@@ -204,41 +295,82 @@ BOOL VfsCacheDirectory_GetSingle(_In_ LPWSTR wszPath, _In_ LPWSTR wszFile, _Out_
 
 BOOL VfsCacheDirectory_DokanFillDirectory(_In_ LPCWSTR wcsPathFileName, _In_ PFillFindData FillFindData, _Inout_ PDOKAN_FILE_INFO DokanFileInfo)
 {
-    QWORD i, qwCurrentTickCount;
-    qwCurrentTickCount = GetTickCount64();
-    EnterCriticalSection(&ctxVfs->CacheDirectoryLock);
-    for(i = 0; i < VMMVFS_CACHE_DIRECTORY_ENTRIES; i++) {
-        if(wcscmp(wcsPathFileName, ctxVfs->CacheDirectory[i].wszDirectoryName)) { continue; }
-        if(qwCurrentTickCount > ctxVfs->CacheDirectory[i].qwExpireTickCount64) { continue; }
-        VfsFileList_DokanFillAll(ctxVfs->CacheDirectory[i].pFileList, DokanFileInfo, FillFindData);
-        LeaveCriticalSection(&ctxVfs->CacheDirectoryLock);
-        return TRUE;
+    PVFS_CACHE_DIRECTORY pDir;
+    AcquireSRWLockShared(&ctxVfs->CacheDirectoryLock);
+    if((pDir = VfsCacheDirectory_GetDirectory(wcsPathFileName))) {
+        VfsFileList_DokanFillAll(pDir->pFileList, DokanFileInfo, FillFindData);
     }
-    LeaveCriticalSection(&ctxVfs->CacheDirectoryLock);
-    return FALSE;
+    ReleaseSRWLockShared(&ctxVfs->CacheDirectoryLock);
+    return pDir ? TRUE : FALSE;
 }
 
+/*
+* Put a directory listing into the cache. The cache takes ownership of the
+* file list which will be free'd on eviction.
+* -- wcsDirectoryName
+* -- pFileList
+*/
 VOID VfsCacheDirectory_Put(_In_ LPCWSTR wcsDirectoryName, _In_ PVFS_FILELIST pFileList)
 {
-    EnterCriticalSection(&ctxVfs->CacheDirectoryLock);
-    ctxVfs->CacheDirectory[ctxVfs->CacheDirectoryIndex].qwExpireTickCount64 = GetTickCount64() + VMMVFS_CACHE_DIRECTORY_LIFETIME_PROC_MS;
-    wcsncpy_s(ctxVfs->CacheDirectory[ctxVfs->CacheDirectoryIndex].wszDirectoryName, MAX_PATH, wcsDirectoryName, _TRUNCATE);
-    VfsFileList_Free(ctxVfs->CacheDirectory[ctxVfs->CacheDirectoryIndex].pFileList);
-    ctxVfs->CacheDirectory[ctxVfs->CacheDirectoryIndex].pFileList = pFileList;
-    ctxVfs->CacheDirectoryIndex = (ctxVfs->CacheDirectoryIndex + 1) % VMMVFS_CACHE_DIRECTORY_ENTRIES;
-    LeaveCriticalSection(&ctxVfs->CacheDirectoryLock);
+    DWORD i, iWay = 0, cFiles = 0;
+    QWORD qwHash, qwCurrentTickCount;
+    PVFS_FILELIST pFileListIter;
+    PVFS_CACHE_DIRECTORY pDir, pDirOld, *ppDirSet;
+    // 1: create directory entry with a by name sorted file index
+    for(pFileListIter = pFileList; pFileListIter; pFileListIter = pFileListIter->FLink) {
+        cFiles += pFileListIter->cFiles;
+    }
+    if(!(pDir = LocalAlloc(0, sizeof(VFS_CACHE_DIRECTORY) + cFiles * sizeof(PWIN32_FIND_DATAW)))) {
+        VfsFileList_Free(pFileList);
+        return;
+    }
+    qwHash = VfsCacheDirectory_Hash(wcsDirectoryName);
+    qwCurrentTickCount = GetTickCount64();
+    pDir->qwHash = qwHash;
+    pDir->qwExpireTickCount64 = qwCurrentTickCount + VfsCacheDirectory_LifetimeMs(wcsDirectoryName);
+    wcsncpy_s(pDir->wszDirectoryName, MAX_PATH, wcsDirectoryName, _TRUNCATE);
+    pDir->pFileList = pFileList;
+    pDir->cFiles = 0;
+    for(pFileListIter = pFileList; pFileListIter; pFileListIter = pFileListIter->FLink) {
+        for(i = 0; i < pFileListIter->cFiles; i++) {
+            pDir->ppFiles[pDir->cFiles++] = pFileListIter->pFiles + i;
+        }
+    }
+    qsort(pDir->ppFiles, pDir->cFiles, sizeof(PWIN32_FIND_DATAW), (int(*)(const void*, const void*))VfsCacheDirectory_CmpSort);
+    // 2: insert into set - replace same directory, empty or the entry which
+    //    expires first (in that order of preference).
+    AcquireSRWLockExclusive(&ctxVfs->CacheDirectoryLock);
+    ppDirSet = (PVFS_CACHE_DIRECTORY*)ctxVfs->CacheDirectory[qwHash % VMMVFS_CACHE_DIRECTORY_SETS];
+    for(i = 0; i < VMMVFS_CACHE_DIRECTORY_WAYS; i++) {
+        if(!ppDirSet[i]) {
+            iWay = i;
+            break;
+        }
+        if((ppDirSet[i]->qwHash == qwHash) && !wcscmp(ppDirSet[i]->wszDirectoryName, pDir->wszDirectoryName)) {
+            iWay = i;
+            break;
+        }
+        if(ppDirSet[i]->qwExpireTickCount64 < ppDirSet[iWay]->qwExpireTickCount64) {
+            iWay = i;
+        }
+    }
+    pDirOld = ppDirSet[iWay];
+    ppDirSet[iWay] = pDir;
+    ReleaseSRWLockExclusive(&ctxVfs->CacheDirectoryLock);
+    VfsCacheDirectory_Free(pDirOld);
 }
 
 VOID VfsCacheDirectory_Close()
 {
-    DWORD i;
-    EnterCriticalSection(&ctxVfs->CacheDirectoryLock);
-    for(i = 0; i < VMMVFS_CACHE_DIRECTORY_ENTRIES; i++) {
-        ctxVfs->CacheDirectory[i].qwExpireTickCount64 = 0;
-        VfsFileList_Free(ctxVfs->CacheDirectory[i].pFileList);
-        ctxVfs->CacheDirectory[i].pFileList = NULL;
+    DWORD i, j;
+    AcquireSRWLockExclusive(&ctxVfs->CacheDirectoryLock);
+    for(i = 0; i < VMMVFS_CACHE_DIRECTORY_SETS; i++) {
+        for(j = 0; j < VMMVFS_CACHE_DIRECTORY_WAYS; j++) {
+            VfsCacheDirectory_Free((PVFS_CACHE_DIRECTORY)ctxVfs->CacheDirectory[i][j]);
+            ctxVfs->CacheDirectory[i][j] = NULL;
+        }
     }
-    LeaveCriticalSection(&ctxVfs->CacheDirectoryLock);
+    ReleaseSRWLockExclusive(&ctxVfs->CacheDirectoryLock);
 }
 
 //-------------------------------------------------------------------------------
@@ -280,6 +412,17 @@ VOID Vfs_UtilSplitPathFile(_Out_writes_(MAX_PATH) PWCHAR wszPath, _Out_ LPWSTR *
     *pwcsFile = wszPath + iSplitFilePath + 1;
 }
 
+//-------------------------------------------------------------------------------
+// READ FUNCTIONALITY BELOW:
+// The parallel large-read and read-ahead paths are implemented in
+// vfs_readahead.c on top of the vmm.dll virtual file read below.
+//-------------------------------------------------------------------------------
+
+NTSTATUS VfsRead_VmmDll(_In_ LPCWSTR wcsFileName, _Out_ LPVOID pb, _In_ DWORD cb, _Out_ PDWORD pcbRead, _In_ ULONG64 cbOffset)
+{
+    return ctxVfs->pVmmDll->VfsRead(wcsFileName, pb, cb, pcbRead, cbOffset);
+}
+
 //-------------------------------------------------------------------------------
 // DOKAN CALLBACK FUNCTIONS BELOW:
 //-------------------------------------------------------------------------------
@@ -309,6 +452,9 @@ VfsCallback_CreateFile_Impl(LPCWSTR wcsFileName, PDOKAN_IO_SECURITY_CONTEXT Secu
     DokanFileInfo->IsDirectory = (FindData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) ? TRUE : FALSE;
     DokanFileInfo->Nocache = TRUE;
     if(!DokanFileInfo->IsDirectory && (CreateOptions & FILE_DIRECTORY_FILE)) { return STATUS_NOT_A_DIRECTORY; }     // fail upon open normal file as directory
+    if(!ctxVfs->fVolatile && !DokanFileInfo->IsDirectory && !DokanFileInfo->Context && (CreateDisposition != OPEN_ALWAYS)) {
+        DokanFileInfo->Context = (ULONG64)VfsReadAhead_New(VfsRead_VmmDll, wcsFileName, ((QWORD)FindData.nFileSizeHigh << 32) | FindData.nFileSizeLow, ctxVfs->dwReadAheadLifetimeMs);
+    }
     return (CreateDisposition == OPEN_ALWAYS) ? STATUS_OBJECT_NAME_COLLISION : STATUS_SUCCESS;
 }
 
@@ -390,7 +536,11 @@ VfsCallback_ReadFile(LPCWSTR wcsFileName, LPVOID Buffer, DWORD BufferLength, LPD
     UINT64 tmStart = dbg_GetTickCount64();
     NTSTATUS nt;
     dbg_wprintf_init(L"DEBUG:: -------- VfsCallback_ReadFile:\t\t\t 0x%08x %s\n", 0, wcsFileName);
-    nt = ctxVfs->pVmmDll->VfsRead(wcsFileName, Buffer, BufferLength, ReadLength, Offset);
+    if(DokanFileInfo->Context) {
+        nt = VfsReadAhead_Read((PVFS_READAHEAD)DokanFileInfo->Context, Buffer, BufferLength, ReadLength, Offset);
+    } else {
+        nt = VfsRead_SplitParallel(VfsRead_VmmDll, wcsFileName, Buffer, BufferLength, ReadLength, Offset);
+    }
     dbg_wprintf(L"DEBUG::%08x %8x VfsCallback_ReadFile:\t\t\t 0x%08x %s\t [ %016llx %08x %08x ]\n", (DWORD)(dbg_GetTickCount64() - tmStart), nt, wcsFileName, Offset, BufferLength, *ReadLength);
     return nt;
 }
@@ -402,10 +552,18 @@ VfsCallback_WriteFile(LPCWSTR wcsFileName, LPCVOID Buffer, DWORD NumberOfBytesTo
     NTSTATUS nt;
     dbg_wprintf_init(L"DEBUG:: -------- VfsCallback_WriteFile:\t\t\t 0x%08x %s\n", 0, wcsFileName);
     nt = ctxVfs->pVmmDll->VfsWrite(wcsFileName, (PBYTE)Buffer, NumberOfBytesToWrite, NumberOfBytesWritten, Offset);
+    VfsReadAhead_Invalidate();
     dbg_wprintf(L"DEBUG::%08x %8x VfsCallback_WriteFile:\t\t\t 0x%08x %s\t [ %016llx %08x %08x ]\n", (DWORD)(dbg_GetTickCount64() - tmStart), nt, wcsFileName, Offset, NumberOfBytesToWrite, *NumberOfBytesWritten);
     return nt;
 }
 
+void DOKAN_CALLBACK
+VfsCallback_CloseFile(LPCWSTR wcsFileName, PDOKAN_FILE_INFO DokanFileInfo)
+{
+    VfsReadAhead_Free((PVFS_READAHEAD)DokanFileInfo->Context);
+    DokanFileInfo->Context = 0;
+}
+
 //-------------------------------------------------------------------------------
 // VFS INITIALIZATION FUNCTIONALITY BELOW:
 //-------------------------------------------------------------------------------
@@ -427,7 +585,6 @@ VOID VfsClose(_In_ CHAR chMountPoint)
             }
         }
         VfsCacheDirectory_Close();
-        DeleteCriticalSection(&ctxVfs->CacheDirectoryLock);
     }
     LocalFree(ctxVfs);
     ctxVfs = NULL;
@@ -442,7 +599,7 @@ VOID VfsInitializeAndMount(_In_ CHAR chMountPoint, _In_ PVMMDLL_FUNCTIONS pVmmDl
     WCHAR wszMountPoint[] = { 'M', ':', '\\', 0 };
     SYSTEMTIME SystemTimeNow;
     int(*fnDokanMain)(PDOKAN_OPTIONS, PDOKAN_OPERATIONS);
-    ULONG64 qwVersionMajor = 0, qwVersionMinor = 0, qwVersionRevision = 0;
+    ULONG64 qwVersionMajor = 0, qwVersionMinor = 0, qwVersionRevision = 0, qwRefresh = 0, qwTickPeriod = 0, qwCacheTicks = 0;
     // get versions
     pVmmDll->ConfigGet(VMMDLL_OPT_CONFIG_VMM_VERSION_MAJOR, &qwVersionMajor);
     pVmmDll->ConfigGet(VMMDLL_OPT_CONFIG_VMM_VERSION_MINOR, &qwVersionMinor);
@@ -473,7 +630,12 @@ VOID VfsInitializeAndMount(_In_ CHAR chMountPoint, _In_ PVMMDLL_FUNCTIONS pVmmDl
     // set vfs context
     GetSystemTime(&SystemTimeNow);
     SystemTimeToFileTime(&SystemTimeNow, &ctxVfs->ftDefaultTime);
-    InitializeCriticalSection(&ctxVfs->CacheDirectoryLock);
+    InitializeSRWLock(&ctxVfs->CacheDirectoryLock);
+    pVmmDll->ConfigGet(VMMDLL_OPT_CONFIG_IS_REFRESH_ENABLED, &qwRefresh);
+    ctxVfs->fVolatile = qwRefresh ? TRUE : FALSE;
+    pVmmDll->ConfigGet(VMMDLL_OPT_CONFIG_TICK_PERIOD, &qwTickPeriod);
+    pVmmDll->ConfigGet(VMMDLL_OPT_CONFIG_READCACHE_TICKS, &qwCacheTicks);
+    ctxVfs->dwReadAheadLifetimeMs = (DWORD)max(VMMVFS_READAHEAD_LIFETIME_MIN_MS, qwTickPeriod * qwCacheTicks);
     ctxVfs->DokanNtStatusFromWin32 = (NTSTATUS(*)(DWORD))GetProcAddress(hModuleDokan, "DokanNtStatusFromWin32");
     ctxVfs->fInitialized = TRUE;
     // set options
@@ -489,6 +651,7 @@ VOID VfsInitializeAndMount(_In_ CHAR chMountPoint, _In_ PVMMDLL_FUNCTIONS pVmmDl
     pDokanOperations->FindFiles = VfsCallback_FindFiles;
     pDokanOperations->ReadFile = VfsCallback_ReadFile;
     pDokanOperations->WriteFile = VfsCallback_WriteFile;
+    pDokanOperations->CloseFile = VfsCallback_CloseFile;
     // enable
     printf(
         "MOUNTING THE MEMORY PROCESS FILE SYSTEM                                        \n" \
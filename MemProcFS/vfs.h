@@ -7,11 +7,15 @@
 #define __VFS_H__
 #include <windows.h>
 #include "vmmdll.h"
+#include "vfs_readahead.h"
 
 typedef unsigned __int64                QWORD, *PQWORD;
 
-#define VMMVFS_CACHE_DIRECTORY_ENTRIES          15
-#define VMMVFS_CACHE_DIRECTORY_LIFETIME_PROC_MS 500
+#define VMMVFS_CACHE_DIRECTORY_SETS                 0x40    // hashed directory cache: number of sets
+#define VMMVFS_CACHE_DIRECTORY_WAYS                 4       // hashed directory cache: entries per set
+#define VMMVFS_CACHE_DIRECTORY_LIFETIME_PROC_MS     500     // listing lifetime - live memory
+#define VMMVFS_CACHE_DIRECTORY_LIFETIME_STATIC_MS   60000   // listing lifetime - static memory dump
+#define VMMVFS_READAHEAD_LIFETIME_MIN_MS            100     // min read-ahead buffer lifetime (vmm memory cache validity otherwise)
 
 typedef struct tdVMMDLL_FUNCTIONS {
     BOOL(*Initialize)(_In_ DWORD argc, _In_ LPSTR argv[]);
@@ -27,14 +31,11 @@ typedef struct tdVMMVFS_CONFIG {
     PVMMDLL_FUNCTIONS pVmmDll;
     FILETIME ftDefaultTime;
     NTSTATUS(*DokanNtStatusFromWin32)(DWORD Error);
-    CRITICAL_SECTION CacheDirectoryLock;
+    SRWLOCK CacheDirectoryLock;
     BOOL fInitialized;
-    QWORD CacheDirectoryIndex;
-    struct {
-        QWORD qwExpireTickCount64;
-        WCHAR wszDirectoryName[MAX_PATH];
-        PVOID pFileList;
-    } CacheDirectory[VMMVFS_CACHE_DIRECTORY_ENTRIES];
+    BOOL fVolatile;             // memory is live (background refresh enabled) - no read-ahead
+    DWORD dwReadAheadLifetimeMs;
+    PVOID CacheDirectory[VMMVFS_CACHE_DIRECTORY_SETS][VMMVFS_CACHE_DIRECTORY_WAYS];
 } VMMVFS_CONFIG, *PVMMVFS_CONFIG;
 
 PVMMVFS_CONFIG ctxVfs;
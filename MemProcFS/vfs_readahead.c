@@ -0,0 +1,224 @@
+// vfs_readahead.c : implementation of the parallel large-read and per-open-
+//                   file sequential read-ahead paths of the vfs.
+//
+// Large reads are split into chunks which are read in parallel on the system
+// thread pool. Large files opened for reading are given a per-open-file read-
+// ahead context: once sequential access is detected the next window is read
+// asynchronously into one of two buffers while the current window is served.
+//
+// A read-ahead buffer is only served if it was filled after the last write to
+// any virtual file and if its fill was started less than the context lifetime
+// ago. Stale buffers are read around and refilled.
+//
+// (c) Ulf Frisk, 2018-2019
+// Author: Ulf Frisk, pcileech@frizk.net
+//
+#include "vfs_readahead.h"
+
+typedef struct tdVFS_READ_CHUNK {
+    PFN_VFS_READ pfnRead;
+    LPCWSTR wcsFileName;
+    PBYTE pb;
+    DWORD cb;
+    DWORD cbRead;
+    QWORD cbOffset;
+    NTSTATUS nt;
+    volatile LONG *pcPending;
+    HANDLE hEventDone;
+} VFS_READ_CHUNK, *PVFS_READ_CHUNK;
+
+typedef struct tdVFS_READAHEAD_SLOT {
+    volatile BOOL fPending;
+    HANDLE hEventDone;
+    QWORD qwOffset;
+    DWORD cb;                   // requested (if pending) or read bytes
+    DWORD dwGeneration;         // write generation at fill start
+    QWORD qwTickFill;           // tick count at fill start
+    NTSTATUS nt;
+    PBYTE pb;
+    struct tdVFS_READAHEAD *ctx;
+} VFS_READAHEAD_SLOT, *PVFS_READAHEAD_SLOT;
+
+typedef struct tdVFS_READAHEAD {
+    SRWLOCK LockSRW;
+    PFN_VFS_READ pfnRead;
+    QWORD cbFile;
+    QWORD qwOffsetNext;
+    DWORD cSequential;
+    DWORD dwLifetimeMs;
+    WCHAR wszFileName[MAX_PATH];
+    VFS_READAHEAD_SLOT Slot[2];
+} VFS_READAHEAD;
+
+// incremented on each completed virtual file write.
+volatile LONG g_VfsReadAhead_dwGeneration = 0;
+
+DWORD WINAPI VfsRead_ChunkThreadProc(_In_ PVFS_READ_CHUNK pc)
+{
+    pc->nt = pc->pfnRead(pc->wcsFileName, pc->pb, pc->cb, &pc->cbRead, pc->cbOffset);
+    if(0 == InterlockedDecrement(pc->pcPending)) {
+        SetEvent(pc->hEventDone);
+    }
+    return 0;
+}
+
+NTSTATUS VfsRead_SplitParallel(_In_ PFN_VFS_READ pfnRead, _In_ LPCWSTR wcsFileName, _Out_writes_(cb) PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbRead, _In_ QWORD cbOffset)
+{
+    NTSTATUS nt;
+    DWORD i, cChunk;
+    volatile LONG cPending;
+    HANDLE hEventDone = NULL;
+    PVFS_READ_CHUNK pChunks = NULL;
+    if((cb <= VMMVFS_READ_SPLIT_MIN) || !(hEventDone = CreateEventA(NULL, TRUE, FALSE, NULL))) { goto fail; }
+    cChunk = (cb + VMMVFS_READ_SPLIT_CHUNK - 1) / VMMVFS_READ_SPLIT_CHUNK;
+    if(!(pChunks = LocalAlloc(LMEM_ZEROINIT, cChunk * sizeof(VFS_READ_CHUNK)))) { goto fail; }
+    cPending = cChunk;
+    for(i = 0; i < cChunk; i++) {
+        pChunks[i].pfnRead = pfnRead;
+        pChunks[i].wcsFileName = wcsFileName;
+        pChunks[i].pb = pb + (SIZE_T)i * VMMVFS_READ_SPLIT_CHUNK;
+        pChunks[i].cb = min(VMMVFS_READ_SPLIT_CHUNK, cb - i * VMMVFS_READ_SPLIT_CHUNK);
+        pChunks[i].cbOffset = cbOffset + (QWORD)i * VMMVFS_READ_SPLIT_CHUNK;
+        pChunks[i].pcPending = &cPending;
+        pChunks[i].hEventDone = hEventDone;
+    }
+    // 1: dispatch all but the first chunk to the thread pool (read inline if
+    //    not possible) and read the first chunk in the current thread.
+    for(i = 1; i < cChunk; i++) {
+        if(!QueueUserWorkItem((LPTHREAD_START_ROUTINE)VfsRead_ChunkThreadProc, pChunks + i, WT_EXECUTEDEFAULT)) {
+            VfsRead_ChunkThreadProc(pChunks + i);
+        }
+    }
+    VfsRead_ChunkThreadProc(pChunks);
+    WaitForSingleObject(hEventDone, INFINITE);
+    // 2: merge results - the read is complete up until the first short chunk.
+    nt = pChunks[0].nt;
+    *pcbRead = 0;
+    for(i = 0; (i < cChunk) && (pChunks[i].nt == VMMDLL_STATUS_SUCCESS); i++) {
+        *pcbRead += pChunks[i].cbRead;
+        if(pChunks[i].cbRead < pChunks[i].cb) { break; }
+    }
+    LocalFree(pChunks);
+    CloseHandle(hEventDone);
+    return nt;
+fail:
+    if(hEventDone) { CloseHandle(hEventDone); }
+    return pfnRead(wcsFileName, pb, cb, pcbRead, cbOffset);
+}
+
+DWORD WINAPI VfsReadAhead_FillThreadProc(_In_ PVFS_READAHEAD_SLOT pSlot)
+{
+    DWORD cbRead = 0;
+    pSlot->nt = VfsRead_SplitParallel(pSlot->ctx->pfnRead, pSlot->ctx->wszFileName, pSlot->pb, pSlot->cb, &cbRead, pSlot->qwOffset);
+    pSlot->cb = (pSlot->nt == VMMDLL_STATUS_SUCCESS) ? cbRead : 0;
+    pSlot->fPending = FALSE;
+    SetEvent(pSlot->hEventDone);
+    return 0;
+}
+
+PVFS_READAHEAD VfsReadAhead_New(_In_ PFN_VFS_READ pfnRead, _In_ LPCWSTR wcsFileName, _In_ QWORD cbFile, _In_ DWORD dwLifetimeMs)
+{
+    DWORD i;
+    PVFS_READAHEAD ctx;
+    if(cbFile < VMMVFS_READAHEAD_FILE_MIN) { return NULL; }
+    if(!(ctx = LocalAlloc(LMEM_ZEROINIT, sizeof(VFS_READAHEAD)))) { return NULL; }
+    InitializeSRWLock(&ctx->LockSRW);
+    ctx->pfnRead = pfnRead;
+    ctx->cbFile = cbFile;
+    ctx->dwLifetimeMs = dwLifetimeMs;
+    wcsncpy_s(ctx->wszFileName, MAX_PATH, wcsFileName, _TRUNCATE);
+    for(i = 0; i < 2; i++) {
+        ctx->Slot[i].ctx = ctx;
+        if(!(ctx->Slot[i].hEventDone = CreateEventA(NULL, TRUE, TRUE, NULL))) {
+            if(i) { CloseHandle(ctx->Slot[0].hEventDone); }
+            LocalFree(ctx);
+            return NULL;
+        }
+    }
+    return ctx;
+}
+
+VOID VfsReadAhead_Free(_In_opt_ PVFS_READAHEAD ctx)
+{
+    DWORD i;
+    if(!ctx) { return; }
+    for(i = 0; i < 2; i++) {
+        WaitForSingleObject(ctx->Slot[i].hEventDone, INFINITE);
+        CloseHandle(ctx->Slot[i].hEventDone);
+        LocalFree(ctx->Slot[i].pb);
+    }
+    LocalFree(ctx);
+}
+
+VOID VfsReadAhead_Invalidate()
+{
+    InterlockedIncrement(&g_VfsReadAhead_dwGeneration);
+}
+
+/*
+* Check whether a slot holds (or is being filled with) a range of the file and
+* whether it's still fresh - i.e. filled after the last write and within the
+* context lifetime.
+*/
+inline BOOL VfsReadAhead_SlotValid(_In_ PVFS_READAHEAD_SLOT pSlot, _In_ QWORD qwOffset, _In_ DWORD cb)
+{
+    return
+        pSlot->pb && (qwOffset >= pSlot->qwOffset) && (qwOffset + cb <= pSlot->qwOffset + pSlot->cb) &&
+        (pSlot->dwGeneration == (DWORD)g_VfsReadAhead_dwGeneration) &&
+        (GetTickCount64() - pSlot->qwTickFill < pSlot->ctx->dwLifetimeMs);
+}
+
+NTSTATUS VfsReadAhead_Read(_In_ PVFS_READAHEAD ctx, _Out_writes_(cb) PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbRead, _In_ QWORD cbOffset)
+{
+    DWORD i;
+    NTSTATUS nt;
+    QWORD qwOffsetWindow;
+    PVFS_READAHEAD_SLOT pSlot, pSlotServe = NULL;
+    AcquireSRWLockExclusive(&ctx->LockSRW);
+    ctx->cSequential = (cbOffset == ctx->qwOffsetNext) ? ctx->cSequential + 1 : 0;
+    ctx->qwOffsetNext = cbOffset + cb;
+    // 1: serve from a fresh read-ahead buffer (wait for a pending fill if required)
+    for(i = 0; i < 2; i++) {
+        pSlot = ctx->Slot + i;
+        if(VfsReadAhead_SlotValid(pSlot, cbOffset, cb)) {
+            WaitForSingleObject(pSlot->hEventDone, INFINITE);
+            if((pSlot->nt == VMMDLL_STATUS_SUCCESS) && VfsReadAhead_SlotValid(pSlot, cbOffset, cb)) {
+                memcpy(pb, pSlot->pb + (cbOffset - pSlot->qwOffset), cb);
+                pSlotServe = pSlot;
+            }
+            break;
+        }
+    }
+    if(pSlotServe) {
+        *pcbRead = cb;
+        nt = VMMDLL_STATUS_SUCCESS;
+    } else {
+        nt = VfsRead_SplitParallel(ctx->pfnRead, ctx->wszFileName, pb, cb, pcbRead, cbOffset);
+    }
+    // 2: start an asynchronous fill of the next window on sequential access
+    //    if it's not already in a fresh buffer and a buffer is free.
+    if(ctx->cSequential >= VMMVFS_READAHEAD_SEQUENTIAL_MIN) {
+        qwOffsetWindow = pSlotServe ? (pSlotServe->qwOffset + VMMVFS_READAHEAD_WINDOW) : (cbOffset + cb);
+        if((qwOffsetWindow < ctx->cbFile) && !VfsReadAhead_SlotValid(ctx->Slot, qwOffsetWindow, 1) && !VfsReadAhead_SlotValid(ctx->Slot + 1, qwOffsetWindow, 1)) {
+            for(i = 0; i < 2; i++) {
+                pSlot = ctx->Slot + i;
+                if((pSlot == pSlotServe) || pSlot->fPending) { continue; }
+                if(!pSlot->pb && !(pSlot->pb = LocalAlloc(0, VMMVFS_READAHEAD_WINDOW))) { break; }
+                pSlot->qwOffset = qwOffsetWindow;
+                pSlot->cb = (DWORD)min(VMMVFS_READAHEAD_WINDOW, ctx->cbFile - qwOffsetWindow);
+                pSlot->dwGeneration = (DWORD)g_VfsReadAhead_dwGeneration;
+                pSlot->qwTickFill = GetTickCount64();
+                pSlot->fPending = TRUE;
+                ResetEvent(pSlot->hEventDone);
+                if(!QueueUserWorkItem((LPTHREAD_START_ROUTINE)VfsReadAhead_FillThreadProc, pSlot, WT_EXECUTELONGFUNCTION)) {
+                    pSlot->cb = 0;
+                    pSlot->fPending = FALSE;
+                    SetEvent(pSlot->hEventDone);
+                }
+                break;
+            }
+        }
+    }
+    ReleaseSRWLockExclusive(&ctx->LockSRW);
+    return nt;
+}
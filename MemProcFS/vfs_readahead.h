@@ -0,0 +1,73 @@
+// vfs_readahead.h : definitions related to the parallel large-read and per-
+//                   open-file sequential read-ahead paths of the vfs. The read
+//                   functionality does not depend on the vfs context and may be
+//                   used stand-alone (vmm_bench).
+//
+// (c) Ulf Frisk, 2018-2019
+// Author: Ulf Frisk, pcileech@frizk.net
+//
+#ifndef __VFS_READAHEAD_H__
+#define __VFS_READAHEAD_H__
+#include <windows.h>
+#include "vmmdll.h"
+
+#define VMMVFS_READAHEAD_FILE_MIN                   0x01000000  // min file size for per-open-file read-ahead
+#define VMMVFS_READAHEAD_WINDOW                     0x00400000  // read-ahead window per buffer (two buffers per file)
+#define VMMVFS_READAHEAD_SEQUENTIAL_MIN             2           // sequential reads before read-ahead is started
+#define VMMVFS_READ_SPLIT_MIN                       0x00200000  // reads larger than this are split into parallel chunks
+#define VMMVFS_READ_SPLIT_CHUNK                     0x00100000
+
+typedef NTSTATUS(*PFN_VFS_READ)(_In_ LPCWSTR wcsFileName, _Out_ LPVOID pb, _In_ DWORD cb, _Out_ PDWORD pcbRead, _In_ ULONG64 cbOffset);
+
+typedef struct tdVFS_READAHEAD *PVFS_READAHEAD;
+
+/*
+* Read from a virtual file. Reads larger than VMMVFS_READ_SPLIT_MIN are split
+* into VMMVFS_READ_SPLIT_CHUNK sized chunks read in parallel.
+* -- pfnRead = the underlying virtual file read function.
+* -- wcsFileName
+* -- pb
+* -- cb
+* -- pcbRead
+* -- cbOffset
+* -- return
+*/
+NTSTATUS VfsRead_SplitParallel(_In_ PFN_VFS_READ pfnRead, _In_ LPCWSTR wcsFileName, _Out_writes_(cb) PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbRead, _In_ QWORD cbOffset);
+
+/*
+* Create a read-ahead context for a file opened for reading. A context is only
+* created for files larger than VMMVFS_READAHEAD_FILE_MIN. Read-ahead buffers
+* are only served for dwLifetimeMs after their fill was started.
+* -- pfnRead = the underlying virtual file read function.
+* -- wcsFileName
+* -- cbFile
+* -- dwLifetimeMs = read-ahead buffer lifetime.
+* -- return = the context, or NULL.
+*/
+PVFS_READAHEAD VfsReadAhead_New(_In_ PFN_VFS_READ pfnRead, _In_ LPCWSTR wcsFileName, _In_ QWORD cbFile, _In_ DWORD dwLifetimeMs);
+
+/*
+* Free a read-ahead context - pending asynchronous fills are waited upon.
+* -- ctx
+*/
+VOID VfsReadAhead_Free(_In_opt_ PVFS_READAHEAD ctx);
+
+/*
+* Read using the read-ahead context of an open file.
+* -- ctx
+* -- pb
+* -- cb
+* -- pcbRead
+* -- cbOffset
+* -- return
+*/
+NTSTATUS VfsReadAhead_Read(_In_ PVFS_READAHEAD ctx, _Out_writes_(cb) PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbRead, _In_ QWORD cbOffset);
+
+/*
+* Invalidate the read-ahead buffers of all read-ahead contexts. This must be
+* called after a successful write to any virtual file has completed - a write
+* may change the contents of other files (i.e. config files or memory views).
+*/
+VOID VfsReadAhead_Invalidate();
+
+#endif /* __VFS_READAHEAD_H__ */
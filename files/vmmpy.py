@@ -223,6 +223,24 @@ def VmmPy_MemRead(pid, address, length, flags = 0):
 
 
 
+def VmmPy_MemReadInto(pid, address, buffer, flags = 0):
+    """Read memory given a pid and a (64-bit) address directly into a caller supplied bytearray. The length of the bytearray is the number of bytes to read. Return the number of bytes read.
+    The python interpreter lock is released during the read - the buffer must not be resized by other threads while the read is in progress.
+
+    Keyword arguments:
+    pid -- int: the process identifier (pid) when reading process virtual memory. -1 when reading physical memory.
+    address -- int: the address to read.
+    buffer -- bytearray: destination buffer.
+    flags -- int: optional flags as specified by VMMPY_FLAG* constants.
+    return -- int: the number of bytes read.
+
+    Example:
+    VmmPy_MemReadInto(-1, 0x1000, bytearray(4)) --> 4
+    """
+    return VMMPYC_MemReadInto(pid, address, buffer, flags)
+
+
+
 def VmmPy_MemReadScatter(pid, address_list, flags = 0):
     """Read page (4kB) sized & aligned memory given a pid and a list of (64-bit) addresses. Return result in list of dict.
 
@@ -240,6 +258,43 @@ def VmmPy_MemReadScatter(pid, address_list, flags = 0):
 
 
 
+def VmmPy_MemReadScatterContiguous(pid, address_list, flags = 0):
+    """Read page (4kB) sized & aligned memory given a pid and a list of (64-bit) addresses. Return result as one contiguous bytes object together with a validity bitmap.
+    Page i of the address list is located at offset i * 0x1000 of the data. Bit i of the bitmap is set if page i was successfully read; failed pages are zero-filled.
+    No per-page python objects are created and the python interpreter lock is released during the read.
+
+    Keyword arguments:
+    pid -- int: the process identifier (pid) when reading process virtual memory. -1 when reading physical memory.
+    address_list -- list: a list of page (4kB/0x1000) aligned addresses.
+    flags -- int: optional flags as specified by VMMPY_FLAG* constants.
+    return -- tuple: (bytes: data, bytes: validity bitmap).
+
+    Example:
+    VmmPy_MemReadScatterContiguous(-1, [0x1000, 0x2000]) --> (b'\x00\x01\x02\x03\x04 ... ', b'\x03')
+    """
+    return VMMPYC_MemReadScatterContiguous(pid, address_list, flags)
+
+
+
+def VmmPy_MemReadScatterInto(pid, address_list, buffer, flags = 0):
+    """Read page (4kB) sized & aligned memory given a pid and a list of (64-bit) addresses directly into a caller supplied bytearray. Return a validity bitmap.
+    Page i of the address list is read into offset i * 0x1000 of the buffer. Bit i of the bitmap is set if page i was successfully read; failed pages are zero-filled.
+    The python interpreter lock is released during the read - the buffer must not be resized by other threads while the read is in progress.
+
+    Keyword arguments:
+    pid -- int: the process identifier (pid) when reading process virtual memory. -1 when reading physical memory.
+    address_list -- list: a list of page (4kB/0x1000) aligned addresses - max 0x10000 addresses.
+    buffer -- bytearray: destination buffer of at least len(address_list) * 0x1000 bytes.
+    flags -- int: optional flags as specified by VMMPY_FLAG* constants.
+    return -- bytes: validity bitmap.
+
+    Example:
+    VmmPy_MemReadScatterInto(-1, [0x1000, 0x2000], bytearray(0x2000)) --> b'\x03'
+    """
+    return VMMPYC_MemReadScatterInto(pid, address_list, buffer, flags)
+
+
+
 def VmmPy_MemWrite(pid, address, bytes_data):
     """Write memory given a pid, a (64-bit) address and length. No return.
 
@@ -379,6 +434,119 @@ def VmmPy_ProcessGetHandleMap(pid):
 
 
 
+#------------------------------------------------------------------------------
+# VmmPy PACKED (COLUMNAR) MAP FUNCTIONALITY BELOW:
+# Packed maps are returned as a dict: {'count': int, 'entry-size': int,
+# 'entries': bytes, 'strings': bytes}. 'entries' holds 'count' fixed size
+# entries laid out as described by the VMMPY_PACKED_DTYPE_* lists below. The
+# lists may be passed directly to numpy.dtype() to import the entries zero
+# copy with numpy.frombuffer(). Strings are stored in 'strings' as null
+# terminated UTF-16LE and are referenced by a byte offset and a length in
+# characters - use VmmPy_PackedString() to retrieve a string.
+#------------------------------------------------------------------------------
+
+VMMPY_PACKED_DTYPE_PTE = [
+    ('va', '<u8'), ('pages', '<u8'), ('flags-pte', '<u8'), ('wow64', '<u4'),
+    ('tag-offset', '<u4'), ('tag-len', '<u4'), ('_reserved', '<u4')]
+
+VMMPY_PACKED_DTYPE_VAD = [
+    ('start', '<u8'), ('end', '<u8'), ('va-vad', '<u8'), ('subsection', '<u8'), ('prototype', '<u8'),
+    ('prototype-len', '<u4'), ('commit_charge', '<u4'),
+    ('vadtype', 'u1'), ('protection', 'u1'), ('image', 'u1'), ('file', 'u1'), ('pagefile', 'u1'),
+    ('private', 'u1'), ('teb', 'u1'), ('stack', 'u1'), ('heap', 'u1'), ('heapnum', 'u1'),
+    ('mem_commit', 'u1'), ('_reserved1', 'u1'),
+    ('tag-offset', '<u4'), ('tag-len', '<u4'), ('_reserved2', '<u4')]
+
+VMMPY_PACKED_DTYPE_THREAD = [
+    ('tid', '<u4'), ('pid', '<u4'), ('exitstatus', '<u4'),
+    ('state', 'u1'), ('running', 'u1'), ('priority', 'u1'), ('basepriority', 'u1'),
+    ('va-ethread', '<u8'), ('va-teb', '<u8'), ('va-start', '<u8'),
+    ('va-stackbase', '<u8'), ('va-stacklimit', '<u8'),
+    ('va-stackbase-kernel', '<u8'), ('va-stacklimit-kernel', '<u8'),
+    ('time-create', '<u8'), ('time-exit', '<u8')]
+
+VMMPY_PACKED_DTYPE_HANDLE = [
+    ('va-object', '<u8'), ('chandle', '<u8'), ('cpointer', '<u8'),
+    ('va-object-creatinfo', '<u8'), ('va-securitydescriptor', '<u8'),
+    ('handle', '<u4'), ('access', '<u4'), ('typeindex', '<u4'), ('pid', '<u4'), ('pooltag', '<u4'),
+    ('tag-offset', '<u4'), ('tag-len', '<u4'), ('type-offset', '<u4'), ('type-len', '<u4'), ('_reserved', '<u4')]
+
+
+
+def VmmPy_PackedString(packed_map, offset, length):
+    """Retrieve a string from the string blob of a packed map.
+
+    Keyword arguments:
+    packed_map -- dict: a packed map as returned by VmmPy_ProcessGet*MapPacked.
+    offset -- int: the string byte offset, i.e. the '*-offset' field of an entry.
+    length -- int: the string length in characters, i.e. the '*-len' field of an entry.
+    return -- str: the string.
+
+    Example:
+    VmmPy_PackedString(m, e['tag-offset'], e['tag-len']) --> 'ntdll.dll'
+    """
+    return packed_map['strings'][offset:offset + 2 * length].decode('utf-16-le')
+
+
+
+def VmmPy_ProcessGetPteMapPacked(pid, is_identify_modules = False):
+    """Retrieve the PTE memory map for a given process as a packed map - see VMMPY_PACKED_DTYPE_PTE.
+
+    Keyword arguments:
+    pid -- int: the process identifier (pid).
+    is_identify_modules -- bool: identify modules (slower).
+    return -- dict: packed map.
+
+    Example:
+    numpy.frombuffer(VmmPy_ProcessGetPteMapPacked(4)['entries'], dtype=numpy.dtype(VMMPY_PACKED_DTYPE_PTE))
+    """
+    return VMMPYC_ProcessGetPteMapPacked(pid, is_identify_modules)
+
+
+
+def VmmPy_ProcessGetVadMapPacked(pid, is_identify_modules = False):
+    """Retrieve the VAD memory map for a given process as a packed map - see VMMPY_PACKED_DTYPE_VAD.
+
+    Keyword arguments:
+    pid -- int: the process identifier (pid).
+    is_identify_modules -- bool: identify modules (slower).
+    return -- dict: packed map.
+
+    Example:
+    numpy.frombuffer(VmmPy_ProcessGetVadMapPacked(4)['entries'], dtype=numpy.dtype(VMMPY_PACKED_DTYPE_VAD))
+    """
+    return VMMPYC_ProcessGetVadMapPacked(pid, is_identify_modules)
+
+
+
+def VmmPy_ProcessGetThreadMapPacked(pid):
+    """Retrieve the thread map for a given process as a packed map - see VMMPY_PACKED_DTYPE_THREAD.
+
+    Keyword arguments:
+    pid -- int: the process identifier (pid).
+    return -- dict: packed map.
+
+    Example:
+    numpy.frombuffer(VmmPy_ProcessGetThreadMapPacked(4)['entries'], dtype=numpy.dtype(VMMPY_PACKED_DTYPE_THREAD))
+    """
+    return VMMPYC_ProcessGetThreadMapPacked(pid)
+
+
+
+def VmmPy_ProcessGetHandleMapPacked(pid):
+    """Retrieve the handle map for a given process as a packed map - see VMMPY_PACKED_DTYPE_HANDLE.
+
+    Keyword arguments:
+    pid -- int: the process identifier (pid).
+    return -- dict: packed map.
+
+    Example:
+    numpy.frombuffer(VmmPy_ProcessGetHandleMapPacked(4)['entries'], dtype=numpy.dtype(VMMPY_PACKED_DTYPE_HANDLE))
+    """
+    return VMMPYC_ProcessGetHandleMapPacked(pid)
+
+
+
 def VmmPy_ProcessGetModuleMap(pid):
     """Retrieve the module map for a specific pid.
 
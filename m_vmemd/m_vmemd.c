@@ -55,137 +55,156 @@ VOID VMemD_Util_FileNameW(_Out_writes_(64) LPWSTR wszOut, _In_ LPCWSTR wsz)
 }
 
 /*
-* Utility function to efficiently search through an ordered array of data with
-* a comparator function.
+* Resolved memory map entries are cached per file (pid, base address and type)
+* for a short time so that consecutive reads of a large file do not have to
+* retrieve the memory map on each read. The cache is cleared on total refresh.
 */
-PVOID VMemD_Util_qfind(_In_ PVOID pvFind, _In_ DWORD cMap, _In_ PVOID pvMap, _In_ DWORD cbEntry, _In_ int(*pfnCmp)(_In_ PVOID pvFind, _In_ PVOID pvEntry))
-{
-    int f;
-    DWORD i, cbSearch, cbStep, cbMap;
-    PBYTE pbMap = pvMap;
-    if(!cMap || !cbEntry) { return NULL; }
-    for(i = 1; ((cMap - 1) >> i); i++);
-    cbMap = cMap * cbEntry;
-    cbSearch = cbEntry * min(1UL << (i - 1), cMap - 1);
-    cbStep = max(cbEntry, cbSearch >> 1);
-    while(cbStep >= cbEntry) {
-        f = pfnCmp(pvFind, pbMap + cbSearch);
-        if(f < 0) {
-            cbSearch -= cbStep;
-        } else if(f > 0) {
-            if(cbSearch + cbStep < cbMap) {
-                cbSearch += cbStep;
-            }
-        } else {
-            return pbMap + cbSearch;
-        }
-        cbStep = cbStep >> 1;
-    }
-    if(cbSearch < cbMap) {
-        if(!pfnCmp(pvFind, pbMap + cbSearch)) {
-            return pbMap + cbSearch;
-        }
-        if((cbSearch >= cbEntry) && !pfnCmp(pvFind, pbMap + cbSearch - cbEntry)) {
-            return pbMap + cbSearch - cbEntry;
-        }
-    }
-    return NULL;
-}
+#define VMEMD_CACHE_MAX                 0x20
+#define VMEMD_CACHE_TTL_MS              2000
+#define VMEMD_SCATTER_MIN               0x00010000      // min read size to use scatter reads
+#define VMEMD_SCATTER_BATCH             0x100           // pages per scatter read batch
 
-/*
-* Comparator function for VMemD_Util_qfind to serach entries in PTEMAP.
-*/
-int VMemD_ReadPte_CmpFind(_In_ QWORD vaFind, _In_ PVMMDLL_MAP_PTEENTRY pEntry)
-{
-    if(pEntry->vaBase > vaFind) { return -1; }
-    if(pEntry->vaBase < vaFind) { return 1; }
-    return 0;
-}
+typedef struct tdVMEMD_CACHE_ENTRY {
+    DWORD dwPID;
+    BOOL fVad;
+    QWORD vaBase;
+    QWORD vaTop;                    // top address (exclusive) of the map entry
+    QWORD qwTickExpire;
+} VMEMD_CACHE_ENTRY, *PVMEMD_CACHE_ENTRY;
+
+struct {
+    SRWLOCK LockSRW;
+    DWORD iNext;
+    VMEMD_CACHE_ENTRY e[VMEMD_CACHE_MAX];
+} g_VMemD_Cache = { SRWLOCK_INIT };
 
 /*
-* Comparator function for VMemD_Util_qfind to serach entries in VADMAP.
+* Resolve the top address of the memory map entry starting at vaBase. The map
+* entry is retrieved from vmm.dll without copying the full memory map and the
+* result is cached.
+* -- dwPID
+* -- vaBase
+* -- fVad
+* -- pvaTop = ptr to receive the top address (exclusive) of the entry.
+* -- return
 */
-int VMemD_ReadVad_CmpFind(_In_ QWORD vaFind, _In_ PVMMDLL_MAP_VADENTRY pEntry)
+_Success_(return)
+BOOL VMemD_ResolveEntry(_In_ DWORD dwPID, _In_ QWORD vaBase, _In_ BOOL fVad, _Out_ PQWORD pvaTop)
 {
-    if(pEntry->vaStart > vaFind) { return -1; }
-    if(pEntry->vaStart < vaFind) { return 1; }
-    return 0;
+    DWORD i;
+    QWORD qwTickNow = GetTickCount64();
+    PVMEMD_CACHE_ENTRY pe;
+    VMMDLL_MAP_PTEENTRY ePte;
+    VMMDLL_MAP_VADENTRY eVad;
+    // 1: cached entry
+    AcquireSRWLockShared(&g_VMemD_Cache.LockSRW);
+    for(i = 0; i < VMEMD_CACHE_MAX; i++) {
+        pe = g_VMemD_Cache.e + i;
+        if((pe->vaBase == vaBase) && (pe->dwPID == dwPID) && (pe->fVad == fVad) && (pe->qwTickExpire > qwTickNow)) {
+            *pvaTop = pe->vaTop;
+            ReleaseSRWLockShared(&g_VMemD_Cache.LockSRW);
+            return TRUE;
+        }
+    }
+    ReleaseSRWLockShared(&g_VMemD_Cache.LockSRW);
+    // 2: resolve entry
+    if(fVad) {
+        if(!VMMDLL_ProcessMap_GetVadEntry(dwPID, vaBase, &eVad) || (eVad.vaStart != vaBase)) { return FALSE; }
+        *pvaTop = eVad.vaEnd + 1;
+    } else {
+        if(!VMMDLL_ProcessMap_GetPteEntry(dwPID, vaBase, &ePte) || (ePte.vaBase != vaBase)) { return FALSE; }
+        *pvaTop = ePte.vaBase + (ePte.cPages << 12);
+    }
+    // 3: cache entry
+    AcquireSRWLockExclusive(&g_VMemD_Cache.LockSRW);
+    pe = g_VMemD_Cache.e + g_VMemD_Cache.iNext;
+    g_VMemD_Cache.iNext = (g_VMemD_Cache.iNext + 1) % VMEMD_CACHE_MAX;
+    pe->dwPID = dwPID;
+    pe->fVad = fVad;
+    pe->vaBase = vaBase;
+    pe->vaTop = *pvaTop;
+    pe->qwTickExpire = qwTickNow + VMEMD_CACHE_TTL_MS;
+    ReleaseSRWLockExclusive(&g_VMemD_Cache.LockSRW);
+    return TRUE;
 }
 
 /*
-* Read/Write virtual memory inside a memory map entry of PTE-type.
+* Read virtual memory - zero pad on fail. Large reads are performed as scatter
+* reads in multi-page batches directly into the destination buffer.
+* -- dwPID
+* -- va
+* -- pb
+* -- cb
+* -- return
 */
-NTSTATUS VMemD_ReadWritePte(_In_ DWORD dwPID, _In_ QWORD vaBase, _In_ BOOL fRead, _Out_writes_bytes_(*pcbReadWrite) PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbReadWrite, _In_ ULONG64 cbOffset)
+_Success_(return)
+BOOL VMemD_ReadMemory(_In_ DWORD dwPID, _In_ QWORD va, _Out_writes_(cb) PBYTE pb, _In_ DWORD cb)
 {
-    NTSTATUS nt = VMMDLL_STATUS_FILE_INVALID;
-    BOOL result;
-    QWORD cbMax;
-    DWORD cbPteMap = 0;
-    PVMMDLL_MAP_PTE pPteMap = NULL;
-    PVMMDLL_MAP_PTEENTRY pe = NULL;
-    // read memory from "vmemd" directory file - "pte mapped"
-    *pcbReadWrite = 0;
-    result =
-        VMMDLL_ProcessMap_GetPte(dwPID, NULL, &cbPteMap, FALSE) &&
-        (pPteMap = LocalAlloc(0, cbPteMap)) &&
-        VMMDLL_ProcessMap_GetPte(dwPID, pPteMap, &cbPteMap, FALSE) &&
-        (pe = VMemD_Util_qfind((PVOID)vaBase, pPteMap->cMap, pPteMap->pMap, sizeof(VMMDLL_MAP_PTEENTRY), (int(*)(PVOID, PVOID))VMemD_ReadPte_CmpFind));
-    if(!result) { goto fail; }
-    if(pe->vaBase + (pe->cPages << 12) <= vaBase + cbOffset) {
-        nt = VMMDLL_STATUS_END_OF_FILE;
-        goto fail;
+    DWORD i, o, cbHead, cPages, cBatch;
+    PBYTE pbBuffer;
+    PMEM_IO_SCATTER_HEADER pMEMs;
+    PPMEM_IO_SCATTER_HEADER ppMEMs;
+    if(cb < VMEMD_SCATTER_MIN) {
+        return VMMDLL_MemReadEx(dwPID, va, pb, cb, NULL, VMMDLL_FLAG_ZEROPAD_ON_FAIL);
     }
-    cbMax = min((pe->vaBase + (pe->cPages << 12)), (vaBase + cb + cbOffset)) - (vaBase + cbOffset);   // min(entry_top_addr, request_top_addr) - request_start_addr
-    if(fRead) {
-        result = VMMDLL_MemReadEx(dwPID, vaBase + cbOffset, pb, (DWORD)min(cb, cbMax), NULL, VMMDLL_FLAG_ZEROPAD_ON_FAIL);
-        *pcbReadWrite = (DWORD)min(cb, cbMax);
-        nt = (result && *pcbReadWrite) ? VMMDLL_STATUS_SUCCESS : VMMDLL_STATUS_END_OF_FILE;
-    } else {
-        VMMDLL_MemWrite(dwPID, vaBase + cbOffset, pb, (DWORD)min(cb, cbMax));
-        *pcbReadWrite = cb;
-        nt = VMMDLL_STATUS_SUCCESS;
+    if(!(pbBuffer = LocalAlloc(0, VMEMD_SCATTER_BATCH * (sizeof(PMEM_IO_SCATTER_HEADER) + sizeof(MEM_IO_SCATTER_HEADER))))) {
+        return VMMDLL_MemReadEx(dwPID, va, pb, cb, NULL, VMMDLL_FLAG_ZEROPAD_ON_FAIL);
     }
-fail:
-    LocalFree(pPteMap);
-    return nt;
+    ppMEMs = (PPMEM_IO_SCATTER_HEADER)pbBuffer;
+    pMEMs = (PMEM_IO_SCATTER_HEADER)(pbBuffer + VMEMD_SCATTER_BATCH * sizeof(PMEM_IO_SCATTER_HEADER));
+    // 1: unaligned head
+    cbHead = (0x1000 - (va & 0xfff)) & 0xfff;
+    if(cbHead) {
+        VMMDLL_MemReadEx(dwPID, va, pb, cbHead, NULL, VMMDLL_FLAG_ZEROPAD_ON_FAIL);
+    }
+    // 2: page aligned body in scatter batches
+    cPages = (cb - cbHead) >> 12;
+    for(o = cbHead; cPages; cPages -= cBatch) {
+        cBatch = min(cPages, VMEMD_SCATTER_BATCH);
+        ZeroMemory(pMEMs, cBatch * sizeof(MEM_IO_SCATTER_HEADER));
+        for(i = 0; i < cBatch; i++) {
+            pMEMs[i].magic = MEM_IO_SCATTER_HEADER_MAGIC;
+            pMEMs[i].version = MEM_IO_SCATTER_HEADER_VERSION;
+            pMEMs[i].qwA = va + o + ((QWORD)i << 12);
+            pMEMs[i].cbMax = 0x1000;
+            pMEMs[i].pb = pb + o + ((QWORD)i << 12);
+            ppMEMs[i] = pMEMs + i;
+        }
+        VMMDLL_MemReadScatter(dwPID, ppMEMs, cBatch, 0);
+        for(i = 0; i < cBatch; i++) {
+            if(pMEMs[i].cb != 0x1000) {
+                ZeroMemory(pMEMs[i].pb, 0x1000);
+            }
+        }
+        o += cBatch << 12;
+    }
+    // 3: unaligned tail
+    if(o < cb) {
+        VMMDLL_MemReadEx(dwPID, va + o, pb + o, cb - o, NULL, VMMDLL_FLAG_ZEROPAD_ON_FAIL);
+    }
+    LocalFree(pbBuffer);
+    return TRUE;
 }
 
 /*
-* Read/Write virtual memory inside a memory map entry of VAD-type.
+* Read/Write virtual memory inside a memory map entry of PTE-type or VAD-type.
 */
-NTSTATUS VMemD_ReadWriteVad(_In_ DWORD dwPID, _In_ QWORD vaBase, _In_ BOOL fRead, _Out_writes_bytes_(*pcbReadWrite) PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbReadWrite, _In_ ULONG64 cbOffset)
+NTSTATUS VMemD_ReadWrite(_In_ DWORD dwPID, _In_ QWORD vaBase, _In_ BOOL fVad, _In_ BOOL fRead, _Out_writes_bytes_(*pcbReadWrite) PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbReadWrite, _In_ ULONG64 cbOffset)
 {
-    NTSTATUS nt = VMMDLL_STATUS_FILE_INVALID;
     BOOL result;
-    QWORD cbMax;
-    DWORD cbVadMap = 0;
-    PVMMDLL_MAP_VAD pVadMap = NULL;
-    PVMMDLL_MAP_VADENTRY pe = NULL;
-    // read memory from "vmemd" directory file - "pte mapped"
+    QWORD cbMax, vaTop;
     *pcbReadWrite = 0;
-    result =
-        VMMDLL_ProcessMap_GetVad(dwPID, NULL, &cbVadMap, FALSE) &&
-        (pVadMap = LocalAlloc(0, cbVadMap)) &&
-        VMMDLL_ProcessMap_GetVad(dwPID, pVadMap, &cbVadMap, FALSE) &&
-        (pe = VMemD_Util_qfind((PVOID)vaBase, pVadMap->cMap, pVadMap->pMap, sizeof(VMMDLL_MAP_VADENTRY), (int(*)(PVOID, PVOID))VMemD_ReadVad_CmpFind));
-    if(!result) { goto fail; }
-    if(pe->vaEnd <= vaBase + cbOffset) {
-        nt = VMMDLL_STATUS_END_OF_FILE;
-        goto fail;
-    }
-    cbMax = min(pe->vaEnd + 1, (vaBase + cb + cbOffset)) - (vaBase + cbOffset);   // min(entry_top_addr, request_top_addr) - request_start_addr
+    if(!VMemD_ResolveEntry(dwPID, vaBase, fVad, &vaTop)) { return VMMDLL_STATUS_FILE_INVALID; }
+    if(vaTop <= vaBase + cbOffset) { return VMMDLL_STATUS_END_OF_FILE; }
+    cbMax = min(vaTop, (vaBase + cb + cbOffset)) - (vaBase + cbOffset);   // min(entry_top_addr, request_top_addr) - request_start_addr
     if(fRead) {
-        result = VMMDLL_MemReadEx(dwPID, vaBase + cbOffset, pb, (DWORD)min(cb, cbMax), NULL, VMMDLL_FLAG_ZEROPAD_ON_FAIL);
+        result = VMemD_ReadMemory(dwPID, vaBase + cbOffset, pb, (DWORD)min(cb, cbMax));
         *pcbReadWrite = (DWORD)min(cb, cbMax);
-        nt = (result && *pcbReadWrite) ? VMMDLL_STATUS_SUCCESS : VMMDLL_STATUS_END_OF_FILE;
-    } else {
-        VMMDLL_MemWrite(dwPID, vaBase + cbOffset, pb, (DWORD)min(cb, cbMax));
-        *pcbReadWrite = cb;
-        nt = VMMDLL_STATUS_SUCCESS;
+        return (result && *pcbReadWrite) ? VMMDLL_STATUS_SUCCESS : VMMDLL_STATUS_END_OF_FILE;
     }
-fail:
-    LocalFree(pVadMap);
-    return nt;
+    VMMDLL_MemWrite(dwPID, vaBase + cbOffset, pb, (DWORD)min(cb, cbMax));
+    *pcbReadWrite = cb;
+    return VMMDLL_STATUS_SUCCESS;
 }
 
 /*
@@ -203,9 +222,7 @@ NTSTATUS VMemD_Read(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _Out_ LPVOID pb, _In_ DWORD
     BOOL fVad;
     QWORD vaBase;
     if(!VMemD_GetBaseAndTypeFromFileName(ctx->wszPath, &vaBase, &fVad)) { return VMMDLL_STATUS_FILE_INVALID; }
-    return fVad ?
-        VMemD_ReadWriteVad(ctx->dwPID, vaBase, TRUE, pb, cb, pcbRead, cbOffset) :
-        VMemD_ReadWritePte(ctx->dwPID, vaBase, TRUE, pb, cb, pcbRead, cbOffset);
+    return VMemD_ReadWrite(ctx->dwPID, vaBase, fVad, TRUE, pb, cb, pcbRead, cbOffset);
 }
 
 /*
@@ -223,9 +240,7 @@ NTSTATUS VMemD_WritePte(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _In_ LPVOID pb, _In_ DW
     BOOL fVad;
     QWORD vaBase;
     if(!VMemD_GetBaseAndTypeFromFileName(ctx->wszPath, &vaBase, &fVad)) { return VMMDLL_STATUS_FILE_INVALID; }
-    return fVad ?
-        VMemD_ReadWriteVad(ctx->dwPID, vaBase, FALSE, pb, cb, pcbWrite, cbOffset) :
-        VMemD_ReadWritePte(ctx->dwPID, vaBase, FALSE, pb, cb, pcbWrite, cbOffset);
+    return VMemD_ReadWrite(ctx->dwPID, vaBase, fVad, FALSE, pb, cb, pcbWrite, cbOffset);
 }
 
 /*
@@ -315,6 +330,22 @@ fail:
     return fResult;
 }
 
+/*
+* Notify : function as specified by the module manager. Clear the resolved map
+* entry cache on total refresh.
+* -- fEvent
+* -- pvEvent
+* -- cbEvent
+*/
+VOID VMemD_Notify(_In_ DWORD fEvent, _In_opt_ PVOID pvEvent, _In_opt_ DWORD cbEvent)
+{
+    if(fEvent == VMMDLL_PLUGIN_EVENT_TOTALREFRESH) {
+        AcquireSRWLockExclusive(&g_VMemD_Cache.LockSRW);
+        ZeroMemory(g_VMemD_Cache.e, sizeof(g_VMemD_Cache.e));
+        ReleaseSRWLockExclusive(&g_VMemD_Cache.LockSRW);
+    }
+}
+
 /*
 * Initialization function for the vmemd native plugin module.
 * It's important that the function is exported in the DLL and that it is
@@ -337,5 +368,6 @@ VOID InitializeVmmPlugin(_In_ PVMMDLL_PLUGIN_REGINFO pRegInfo)
     pRegInfo->reg_fn.pfnList = VMemD_List;                      // List function supported.
     pRegInfo->reg_fn.pfnRead = VMemD_Read;                      // Read function supported.
     pRegInfo->reg_fn.pfnWrite = VMemD_WritePte;                    // Write function supported.
+    pRegInfo->reg_fn.pfnNotify = VMemD_Notify;                  // Notify function supported.
     pRegInfo->pfnPluginManager_Register(pRegInfo);              // Register with the plugin maanger.
 }
@@ -47,7 +47,18 @@ extern "C" {
 *              and may not be completed when initialization call is completed.
 *              This includes virtual memory compression, registry and more.
 *              Example: '-waitinitialize'
+*    -cachesize = total memory budget in MB of the physical memory, page table
+*              and paged memory caches. Lower the budget when analyzing many
+*              targets in parallel (one process per target).
+*              Example: '-cachesize 64'
 *
+* Only one instance of VMM.DLL may be initialized per process since all state
+* and the LeechCore memory acquisition device are process-wide. There is no
+* handle based API; multiple targets can't be analyzed concurrently in one
+* process and cache budgets / worker threads can't be shared between targets.
+* To analyze another target call VMMDLL_Close before initializing again -
+* initializing an already initialized VMM.DLL fails. To analyze targets in
+* parallel use one process per target with a lowered -cachesize.
 * -- argc
 * -- argv
 * -- return = success/fail
@@ -64,16 +75,18 @@ _Success_(return)
 BOOL VMMDLL_Close();
 
 /*
-* Perform a force refresh of all internal caches including:
+* Perform a refresh of all internal caches including:
 * - process listings
 * - memory cache
 * - page table cache
+* If dwMaxAgeMs is non-zero only the caches/listings last refreshed more than
+* dwMaxAgeMs milliseconds ago are refreshed ("refresh if older than").
 * WARNING: function may take some time to execute!
-* -- dwReserved = reserved future use - must be zero
+* -- dwMaxAgeMs = max age in ms, 0 = force refresh of everything.
 * -- return = sucess/fail
 */
 _Success_(return)
-BOOL VMMDLL_Refresh(_In_ DWORD dwReserved);
+BOOL VMMDLL_Refresh(_In_ DWORD dwMaxAgeMs);
 
 /*
 * Free memory allocated by the VMMDLL.
@@ -113,6 +126,63 @@ VOID VMMDLL_MemFree(_Frees_ptr_opt_ PVOID pvMem);
 #define VMMDLL_OPT_CONFIG_VMM_VERSION_REVISION          0x40000009  // R
 #define VMMDLL_OPT_CONFIG_STATISTICS_FUNCTIONCALL       0x4000000A  // RW - enable function call statistics (.status/statistics_fncall file)
 #define VMMDLL_OPT_CONFIG_IS_PAGING_ENABLED             0x4000000B  // RW - 1/0
+#define VMMDLL_OPT_CONFIG_CACHE_BUDGET_MB               0x4000000C  // RW - total memory budget (in MB) of the PHYS/TLB/PAGING caches
+#define VMMDLL_OPT_CONFIG_CACHE_POLICY                  0x4000000D  // RW - cache eviction policy: 0 = age (default), 1 = 2Q (scan resistant)
+#define VMMDLL_OPT_CONFIG_READSCATTER_ASYNC_INFLIGHT    0x4000000E  // RW - max number of VMMDLL_MemReadScatterAsync batches in flight (1-64)
+#define VMMDLL_OPT_CONFIG_REGISTRY_LAZY                 0x4000000F  // RW - 1 = registry key listings only resolve the listed key's subkey lists (no deleted/orphan keys), 0 = full hive scan on first listing (default)
+#define VMMDLL_OPT_CONFIG_INIT_STAGED                   0x40000010  // R - 1 = staged initialization (-stagedinit): subsystems are initialized in the background
+#define VMMDLL_OPT_CONFIG_TRACE_RING                    0x40000011  // RW - 1 = record trace events into the in-memory ring buffer (.status/trace file)
+#define VMMDLL_OPT_CONFIG_REFRESH_ADAPTIVE              0x40000012  // RW - 1 = adapt refresh periods to measured change rates (default), 0 = fixed refresh periods
+#define VMMDLL_OPT_CONFIG_REFRESH_IDLE_MS               0x40000013  // RW - suspend refreshes after ms without api activity, 0 = never suspend
+#define VMMDLL_OPT_CONFIG_REMOTE_PIPELINE_DEPTH         0x40000014  // RW - max outstanding requests per scatter read towards remote devices (1-16, 1 = no pipelining)
+#define VMMDLL_OPT_CONFIG_CACHE_DEDUP                   0x40000015  // RW - PHYS cache content deduplication: 0 = off, 1 = zero pages (default), 2 = zero + duplicate pages
+#define VMMDLL_OPT_CONFIG_PROTOTYPEPTE_CACHE_MB         0x40000016  // RW - memory budget of the prototype pte array cache in MB (1-4096)
+#define VMMDLL_OPT_CONFIG_PAGING_FAILED_TTL_MS          0x40000017  // RW - ms a failed paged memory read is remembered before being retried
+#define VMMDLL_OPT_CONFIG_REMOTE_COMPRESS               0x40000018  // R - 1 = remote device page payloads are compressed (default, -remotenocompress to disable)
+#define VMMDLL_OPT_CONFIG_REMOTE_PREFETCH_ASYNC         0x40000019  // RW - 1 = VMMDLL_MemPrefetchPages towards remote devices returns immediately and prefetches in the background (default)
+// options below take a sub-option in bits 0-11 (and for some in bits 32-63).
+// each option occupies its own 0x1000 range separate from plain options 0x40000xxx.
+#define VMMDLL_OPT_CONFIG_CACHESTAT_PHYS                0x40001000  // R - PHYS cache statistics counter: OR with VMMDLL_OPT_CACHESTAT_*
+#define VMMDLL_OPT_CONFIG_CACHESTAT_TLB                 0x40002000  // R - TLB cache statistics counter: OR with VMMDLL_OPT_CACHESTAT_*
+#define VMMDLL_OPT_CONFIG_CACHESTAT_PAGING              0x40003000  // R - PAGING cache statistics counter: OR with VMMDLL_OPT_CACHESTAT_*
+#define VMMDLL_OPT_CONFIG_INIT_READY                    0x40004000  // R - 1 = initialization stage ready: OR with VMMDLL_OPT_INIT_STAGE_*
+#define VMMDLL_OPT_CONFIG_INIT_TIME_MS                  0x40005000  // R - initialization stage duration in ms (0 if not ready): OR with VMMDLL_OPT_INIT_STAGE_*
+#define VMMDLL_OPT_CONFIG_OBJECTS                       0x40006000  // R - object manager counter: OR with VMMDLL_OPT_OBJECTS_* and optionally ((ULONG64)tag << 32) for a single object tag (default: all tags)
+#define VMMDLL_OPT_CONFIG_STATISTICS_CALL               0x40007000  // R - function call statistics (requires VMMDLL_OPT_CONFIG_STATISTICS_FUNCTIONCALL): OR with VMMDLL_OPT_STATISTICS_CALL_* and ((ULONG64)id << 32), id = row index in .status/statistics_fncall
+
+#define VMMDLL_OPT_CACHESTAT_HIT                        0x01        // cache lookup hits
+#define VMMDLL_OPT_CACHESTAT_MISS                       0x02        // cache lookup misses
+#define VMMDLL_OPT_CACHESTAT_INSERT                     0x03        // entries inserted
+#define VMMDLL_OPT_CACHESTAT_EVICT                      0x04        // entries evicted to make room for new entries
+#define VMMDLL_OPT_CACHESTAT_EVICT_STALE                0x05        // stale entries (from previous refresh) reclaimed
+#define VMMDLL_OPT_CACHESTAT_ENTRIES                    0x06        // current number of entries in the cache
+#define VMMDLL_OPT_CACHESTAT_ENTRIES_MAX                0x07        // max number of entries in the cache
+#define VMMDLL_OPT_CACHESTAT_LOCK_CONTENDED             0x08        // number of contended region lock acquisitions
+#define VMMDLL_OPT_CACHESTAT_LOCK_WAIT_US               0x09        // total time waited for region locks (microseconds)
+
+#define VMMDLL_OPT_OBJECTS_ALIVE                        0x01        // currently alive objects
+#define VMMDLL_OPT_OBJECTS_ALLOC_TOTAL                  0x02        // total number of allocated objects
+#define VMMDLL_OPT_OBJECTS_BYTES                        0x03        // bytes held by currently alive objects
+#define VMMDLL_OPT_OBJECTS_PEAK                         0x04        // peak number of alive objects (sampled)
+#define VMMDLL_OPT_OBJECTS_TAGS                         0x05        // number of accounted object tags
+
+#define VMMDLL_OPT_STATISTICS_CALL_COUNT                0x01        // number of calls
+#define VMMDLL_OPT_STATISTICS_CALL_TIME_TOTAL_US        0x02        // total time spent in calls (microseconds)
+#define VMMDLL_OPT_STATISTICS_CALL_TIME_P50_US          0x03        // approximate median call latency (microseconds)
+#define VMMDLL_OPT_STATISTICS_CALL_TIME_P99_US          0x04        // approximate 99th percentile call latency (microseconds)
+#define VMMDLL_OPT_STATISTICS_CALL_TIME_P999_US         0x05        // approximate 99.9th percentile call latency (microseconds)
+#define VMMDLL_OPT_STATISTICS_CALL_TIME_MAX_US          0x06        // max call latency (microseconds)
+#define VMMDLL_OPT_STATISTICS_CALL_IDS                  0x07        // number of function call ids (id is ignored)
+
+#define VMMDLL_OPT_INIT_STAGE_ALL                       0x00        // all stages (ready: all stages ready, time: ms from start until last stage ready)
+#define VMMDLL_OPT_INIT_STAGE_KERNEL                    0x01        // DTB, memory model and ntoskrnl.exe
+#define VMMDLL_OPT_INIT_STAGE_PROCESS                   0x02        // process list
+#define VMMDLL_OPT_INIT_STAGE_KERNELINFO                0x03        // PsLoadedModuleList and KDBG
+#define VMMDLL_OPT_INIT_STAGE_REGISTRY                  0x04        // registry hive map
+#define VMMDLL_OPT_INIT_STAGE_PDB                       0x05        // debug symbol subsystem
+#define VMMDLL_OPT_INIT_STAGE_PAGING                    0x06        // full paging - page files and memory compression
+#define VMMDLL_OPT_INIT_STAGE_THREADING                 0x07        // thread map
+#define VMMDLL_OPT_INIT_STAGE_KERNELOPT                 0x08        // optional kernel values
 
 #define VMMDLL_OPT_WIN_VERSION_MAJOR                    0x40000101  // R
 #define VMMDLL_OPT_WIN_VERSION_MINOR                    0x40000102  // R
@@ -260,6 +330,21 @@ NTSTATUS VMMDLL_VfsRead(_In_ LPCWSTR wcsFileName, _Out_ LPVOID pb, _In_ DWORD cb
 */
 NTSTATUS VMMDLL_VfsWrite(_In_ LPCWSTR wcsFileName, _In_ LPVOID pb, _In_ DWORD cb, _Out_ PDWORD pcbWrite, _In_ ULONG64 cbOffset);
 
+#define VMMDLL_DUMP_FLAG_CRASHDUMP              0x0001  // write memory.dmp crash dump format (default: memory.pmem raw format)
+
+/*
+* Write a full physical memory dump to a file. This is equivalent of copying
+* the file memory.pmem (or memory.dmp) in the memory process file system root
+* but considerably faster; memory is read in large chunks in parallel across
+* threads bypassing the internal cache and holes in the physical memory map
+* are skipped. Progress and throughput is printed (if printf is enabled).
+* -- szFileName = the file to write (existing files are overwritten).
+* -- flags = optional flags as given by VMMDLL_DUMP_FLAG_*
+* -- return = success/fail.
+*/
+_Success_(return)
+BOOL VMMDLL_DumpToFile(_In_ LPSTR szFileName, _In_ DWORD flags);
+
 /*
 * Utility functions for memory process file system read/write towards different
 * underlying data representations.
@@ -294,6 +379,32 @@ NTSTATUS VMMDLL_UtilVfsWriteFile_DWORD(_Inout_ PDWORD pdwTarget, _In_ PBYTE pb,
 _Success_(return)
 BOOL VMMDLL_VfsInitializePlugins();
 
+typedef VOID(*VMMDLL_NOTIFY_CALLBACK)(_In_opt_ PVOID ctx, _In_ DWORD fEvent, _In_opt_ PVOID pvEvent, _In_opt_ DWORD cbEvent);
+
+/*
+* Subscribe to change notifications without being a plugin. The callback is
+* called on the refresh thread with the same events and event data as sent to
+* plugin pfnNotify. The callback must return quickly and must not call the
+* VMMDLL_NotifySubscribe/VMMDLL_NotifyUnsubscribe functions.
+* -- fEventMask = mask of VMMDLL_PLUGIN_EVENT_PROCESS_* / VMMDLL_PLUGIN_EVENT_MAP_*
+* -- pfnCallback
+* -- ctx = optional context passed to pfnCallback.
+* -- return = success/fail (max 16 concurrent subscriptions).
+*/
+_Success_(return)
+BOOL VMMDLL_NotifySubscribe(_In_ DWORD fEventMask, _In_ VMMDLL_NOTIFY_CALLBACK pfnCallback, _In_opt_ PVOID ctx);
+
+/*
+* Remove a subscription previously added by VMMDLL_NotifySubscribe. The
+* function waits for an ongoing callback to return; once it has returned the
+* callback will not be called again and ctx may be freed.
+* -- pfnCallback
+* -- ctx
+* -- return = success/fail.
+*/
+_Success_(return)
+BOOL VMMDLL_NotifyUnsubscribe(_In_ VMMDLL_NOTIFY_CALLBACK pfnCallback, _In_opt_ PVOID ctx);
+
 #define VMMDLL_PLUGIN_CONTEXT_MAGIC             0xc0ffee663df9301c
 #define VMMDLL_PLUGIN_CONTEXT_VERSION           3
 #define VMMDLL_PLUGIN_REGINFO_MAGIC             0xc0ffee663df9301d
@@ -301,6 +412,19 @@ BOOL VMMDLL_VfsInitializePlugins();
 
 #define VMMDLL_PLUGIN_EVENT_VERBOSITYCHANGE     0x01
 #define VMMDLL_PLUGIN_EVENT_TOTALREFRESH        0x02
+#define VMMDLL_PLUGIN_EVENT_PROCESS_TERMINATE   0x04    // pvEvent = PVMMDLL_PLUGIN_NOTIFY_PROCESS
+#define VMMDLL_PLUGIN_EVENT_PROCESS_CREATE      0x08    // pvEvent = PVMMDLL_PLUGIN_NOTIFY_PROCESS
+#define VMMDLL_PLUGIN_EVENT_MAP_MODULE          0x10    // pvEvent = PVMMDLL_PLUGIN_NOTIFY_PROCESS
+#define VMMDLL_PLUGIN_EVENT_MAP_HANDLE          0x20    // pvEvent = PVMMDLL_PLUGIN_NOTIFY_PROCESS
+
+// event data for process create/terminate and module/handle map changed events.
+// qwGeneration is the process table generation for process events and the map
+// generation (as returned by VMMDLL_ProcessGetGeneration) for map events.
+typedef struct tdVMMDLL_PLUGIN_NOTIFY_PROCESS {
+    DWORD dwPID;
+    DWORD _Reserved;
+    ULONG64 qwGeneration;
+} VMMDLL_PLUGIN_NOTIFY_PROCESS, *PVMMDLL_PLUGIN_NOTIFY_PROCESS;
 
 typedef struct tdVMMDLL_PLUGIN_CONTEXT {
     ULONG64 magic;
@@ -376,6 +500,38 @@ typedef struct tdVMMDLL_PLUGIN_REGINFO {
 */
 DWORD VMMDLL_MemReadScatter(_In_ DWORD dwPID, _Inout_ PPMEM_IO_SCATTER_HEADER ppMEMs, _In_ DWORD cpMEMs, _In_ DWORD flags);
 
+/*
+* Callback function for VMMDLL_MemReadScatterAsync. The callback is called on
+* a worker thread once the batch has been read.
+* -- ctx = the caller supplied context.
+* -- ppMEMs = the array of scatter read headers of the completed batch.
+* -- cpMEMs = count of ppMEMs.
+* -- cMEMsRead = the number of successfully read items.
+*/
+typedef VOID(*VMMDLL_MEM_SCATTER_ASYNC_CALLBACK)(_In_opt_ PVOID ctx, _In_ PPMEM_IO_SCATTER_HEADER ppMEMs, _In_ DWORD cpMEMs, _In_ DWORD cMEMsRead);
+
+/*
+* Submit an asynchronous scatter read of a batch of memory - see the function
+* VMMDLL_MemReadScatter for more information about the read. The function
+* returns immediately unless the max number of batches are already in flight,
+* in which case it waits for a batch to complete. The max number of batches is
+* set by the option VMMDLL_OPT_CONFIG_READSCATTER_ASYNC_INFLIGHT.
+* The ppMEMs array, its headers and buffers must remain valid until the batch
+* has completed. Completion is signalled by the optional callback function as
+* well as by the returned waitable handle.
+* CALLER CloseHandle: return
+* -- dwPID - PID of target process, (DWORD)-1 to read physical memory.
+* -- ppMEMs = array of scatter read headers.
+* -- cpMEMs = count of ppMEMs.
+* -- flags = optional flags as given by VMMDLL_FLAG_*
+* -- pfnCallback = optional callback function to call on batch completion.
+* -- ctx = optional context to pass along to the callback function.
+* -- return = waitable handle signalled after completion (and after callback),
+*             or NULL on fail. The handle must be closed with CloseHandle.
+*/
+_Success_(return != NULL)
+HANDLE VMMDLL_MemReadScatterAsync(_In_ DWORD dwPID, _Inout_ PPMEM_IO_SCATTER_HEADER ppMEMs, _In_ DWORD cpMEMs, _In_ DWORD flags, _In_opt_ VMMDLL_MEM_SCATTER_ASYNC_CALLBACK pfnCallback, _In_opt_ PVOID ctx);
+
 /*
 * Read a single 4096-byte page of memory.
 * -- dwPID - PID of target process, (DWORD)-1 to read physical memory.
@@ -386,6 +542,41 @@ DWORD VMMDLL_MemReadScatter(_In_ DWORD dwPID, _Inout_ PPMEM_IO_SCATTER_HEADER pp
 _Success_(return)
 BOOL VMMDLL_MemReadPage(_In_ DWORD dwPID, _In_ ULONG64 qwA, _Inout_bytecount_(4096) PBYTE pbPage);
 
+/*
+* Retrieve a read-only pointer to a single 4096-byte page of memory without any
+* copying. The page is taken directly from the internal memory cache whenever
+* possible. The page is reference counted and pinned in memory until released
+* by the caller with VMMDLL_MemPageRelease. Pages should be released promptly
+* since pinned pages may not be used for caching.
+* -- dwPID - PID of target process, (DWORD)-1 to read physical memory.
+* -- qwA = address of page (will be page aligned).
+* -- ppbPage = ptr to receive read-only page pointer.
+* -- flags = optional flags as given by VMMDLL_FLAG_*
+* -- return = success/fail.
+*/
+_Success_(return)
+BOOL VMMDLL_MemReadPageRef(_In_ DWORD dwPID, _In_ ULONG64 qwA, _Out_ PBYTE *ppbPage, _In_ DWORD flags);
+
+/*
+* Retrieve read-only pointers to multiple 4096-byte pages of memory without any
+* copying. Pages not in the internal cache are read in one scatter read before
+* references are taken. Pages successfully read must be released by the caller
+* with VMMDLL_MemPageRelease. Failed pages are set to NULL.
+* -- dwPID - PID of target process, (DWORD)-1 to read physical memory.
+* -- pqwA = array of page addresses.
+* -- cPages
+* -- ppbPages = array to receive read-only page pointers (or NULL on fail).
+* -- flags = optional flags as given by VMMDLL_FLAG_*
+* -- return = the number of successfully retrieved pages.
+*/
+DWORD VMMDLL_MemReadScatterPageRef(_In_ DWORD dwPID, _In_reads_(cPages) PULONG64 pqwA, _In_ DWORD cPages, _Out_writes_(cPages) PBYTE *ppbPages, _In_ DWORD flags);
+
+/*
+* Release a page retrieved by VMMDLL_MemReadPageRef/VMMDLL_MemReadScatterPageRef.
+* -- pbPage
+*/
+VOID VMMDLL_MemPageRelease(_In_opt_ PBYTE pbPage);
+
 /*
 * Read a contigious arbitrary amount of memory.
 * -- dwPID - PID of target process, (DWORD)-1 to read physical memory.
@@ -416,6 +607,9 @@ BOOL VMMDLL_MemReadEx(_In_ DWORD dwPID, _In_ ULONG64 qwA, _Out_writes_(cb) PBYTE
 * cache. This function is to be used to batch larger known reads into local
 * cache before making multiple smaller reads - which will then happen from
 * the cache. Function exists for performance reasons.
+* Towards remote devices the prefetch is a hint: the function returns at once
+* and the pages are read in the background. Subsequent reads wait for hinted
+* pages to arrive (VMMDLL_OPT_CONFIG_REMOTE_PREFETCH_ASYNC).
 * -- dwPID = PID of target process, (DWORD)-1 for physical memory.
 * -- pPrefetchAddresses = array of addresses to read into cache.
 * -- cPrefetchAddresses
@@ -439,6 +633,32 @@ BOOL VMMDLL_MemPrefetchPages(_In_ DWORD dwPID, _In_reads_(cPrefetchAddresses) PU
 _Success_(return)
 BOOL VMMDLL_MemWrite(_In_ DWORD dwPID, _In_ ULONG64 qwA, _In_reads_(cb) PBYTE pb, _In_ DWORD cb);
 
+#define VMMDLL_MEM_WRITE_FLAG_VERIFY        0x01    // verify by batched read-back (bypassing cache)
+
+typedef struct tdVMMDLL_MEM_WRITE_ENTRY {
+    DWORD dwPID;                    // [in] PID of target process, (DWORD)-1 for physical memory
+    DWORD cb;                       // [in] number of bytes to write
+    ULONG64 qwA;                    // [in] address to write
+    PBYTE pb;                       // [in] data to write
+    DWORD cbWrite;                  // [out] number of bytes written
+    BOOL fVerified;                 // [out] fully written and verified (VMMDLL_MEM_WRITE_FLAG_VERIFY only)
+} VMMDLL_MEM_WRITE_ENTRY, *PVMMDLL_MEM_WRITE_ENTRY;
+
+/*
+* Write a batch of memory writes, possibly spanning multiple processes and/or
+* physical memory, in one call. All addresses are translated up front and
+* physically adjacent writes are merged into single device writes. Only the
+* cached pages actually written are invalidated. Optionally the written data
+* may be verified by a single batched read-back of the affected pages.
+* The same precautions as for VMMDLL_MemWrite applies!
+* NB! the order of overlapping writes within the same batch is undefined.
+* -- cEntries
+* -- pEntries
+* -- flags = 0 or VMMDLL_MEM_WRITE_FLAG_VERIFY.
+* -- return = the number of entries fully written (and verified if requested).
+*/
+DWORD VMMDLL_MemWriteBatch(_In_ DWORD cEntries, _Inout_updates_(cEntries) PVMMDLL_MEM_WRITE_ENTRY pEntries, _In_ DWORD flags);
+
 /*
 * Translate a virtual address to a physical address by walking the page tables
 * of the specified process.
@@ -450,6 +670,162 @@ BOOL VMMDLL_MemWrite(_In_ DWORD dwPID, _In_ ULONG64 qwA, _In_reads_(cb) PBYTE pb
 _Success_(return)
 BOOL VMMDLL_MemVirt2Phys(_In_ DWORD dwPID, _In_ ULONG64 qwVA, _Out_ PULONG64 pqwPA);
 
+#define VMMDLL_MEM_SEARCH_VERSION           0xfe3e0001
+#define VMMDLL_MEM_SEARCH_MAXLENGTH         32
+#define VMMDLL_MEM_SEARCH_MAX               16
+
+#define VMMDLL_MEM_SEARCH_SCOPE_PHYSICAL    1
+#define VMMDLL_MEM_SEARCH_SCOPE_PROCESS     2
+#define VMMDLL_MEM_SEARCH_SCOPE_ALLPROCESS  3
+
+typedef struct tdVMMDLL_MEM_SEARCH_ENTRY {
+    DWORD cb;                                       // length of search pattern (1-32 bytes)
+    DWORD cbAlign;                                  // byte alignment of hits (0/1 = none, otherwise power of two)
+    BYTE pb[VMMDLL_MEM_SEARCH_MAXLENGTH];           // search pattern
+    BYTE pbSkipMask[VMMDLL_MEM_SEARCH_MAXLENGTH];   // wildcard mask - bits set are ignored in comparison
+} VMMDLL_MEM_SEARCH_ENTRY, *PVMMDLL_MEM_SEARCH_ENTRY;
+
+/*
+* Callback function invoked for each search hit. Callbacks are serialized but
+* are not made in any particular address order.
+* -- ctx = user supplied context.
+* -- dwPID = PID of hit, (DWORD)-1 for physical memory.
+* -- qwA = address of hit.
+* -- iSearch = index into search[] of the pattern that was found.
+* -- return = TRUE to continue the search, FALSE to abort.
+*/
+typedef BOOL(*VMMDLL_MEM_SEARCH_RESULT_CALLBACK)(_In_opt_ PVOID ctx, _In_ DWORD dwPID, _In_ ULONG64 qwA, _In_ DWORD iSearch);
+
+typedef struct tdVMMDLL_MEM_SEARCH_CONTEXT {
+    DWORD dwVersion;                                // VMMDLL_MEM_SEARCH_VERSION
+    DWORD tpScope;                                  // VMMDLL_MEM_SEARCH_SCOPE_*
+    DWORD dwPID;                                    // PID if scope is VMMDLL_MEM_SEARCH_SCOPE_PROCESS
+    DWORD cSearch;                                  // number of valid entries in search[]
+    ULONG64 qwAddrMin;                              // min address to search
+    ULONG64 qwAddrMax;                              // max address to search (0 = no limit)
+    ULONG64 flags;                                  // VMMDLL_FLAG_* read flags
+    DWORD cMaxResult;                               // max # of hits before search is aborted (0 = no limit)
+    DWORD _Reserved;
+    PVOID ctx;                                      // user context forwarded to pfnResultCB
+    VMMDLL_MEM_SEARCH_RESULT_CALLBACK pfnResultCB;  // optional result callback
+    VMMDLL_MEM_SEARCH_ENTRY search[VMMDLL_MEM_SEARCH_MAX];
+    // fields below may be accessed by the caller (from another thread) during an ongoing search.
+    volatile BOOL fAbortRequested;                  // set by caller to abort search
+    volatile ULONG64 cbReadTotal;                   // progress: bytes read so far
+    volatile DWORD cResult;                         // number of hits so far
+} VMMDLL_MEM_SEARCH_CONTEXT, *PVMMDLL_MEM_SEARCH_CONTEXT;
+
+/*
+* Search memory for up to 16 byte patterns (of up to 32 bytes each) with
+* optional wildcard masks and alignment. Physical memory, the virtual memory of
+* a single process or the virtual memory of all processes may be searched. The
+* search is performed in parallel on multiple threads and uses SIMD (AVX2)
+* instructions if supported by the CPU. This function is blocking until the
+* search is completed or aborted - progress may be monitored and the search may
+* be aborted from another thread by the fields at the end of the context.
+* -- ctx
+* -- return = TRUE on completed (or aborted) search, FALSE on fail.
+*/
+_Success_(return)
+BOOL VMMDLL_MemSearch(_Inout_ PVMMDLL_MEM_SEARCH_CONTEXT ctx);
+
+#define VMMDLL_MEM_SNAPSHOT_MAGIC           0xc0ffee663df9301d
+#define VMMDLL_MEM_SNAPSHOT_VERSION         1
+#define VMMDLL_MEM_SNAPSHOT_DIFF_MAGIC      0xc0ffee663df9301e
+#define VMMDLL_MEM_SNAPSHOT_DIFF_VERSION    1
+
+#define VMMDLL_MEM_SNAPSHOT_DIFF_CHANGED    1
+#define VMMDLL_MEM_SNAPSHOT_DIFF_ADDED      2
+#define VMMDLL_MEM_SNAPSHOT_DIFF_REMOVED    3
+
+typedef struct tdVMMDLL_MEM_SNAPSHOT_RANGE {
+    ULONG64 qwA;                    // page aligned start address of range
+    DWORD cPages;
+    DWORD iHash;                    // index of first page hash in pqwHash
+} VMMDLL_MEM_SNAPSHOT_RANGE, *PVMMDLL_MEM_SNAPSHOT_RANGE;
+
+typedef struct tdVMMDLL_MEM_SNAPSHOT {
+    ULONG64 magic;                  // VMMDLL_MEM_SNAPSHOT_MAGIC
+    DWORD dwVersion;                // VMMDLL_MEM_SNAPSHOT_VERSION
+    DWORD dwPID;                    // PID, (DWORD)-1 for physical memory
+    ULONG64 qwAddrMin;
+    ULONG64 qwAddrMax;
+    ULONG64 flags;
+    DWORD cRange;
+    DWORD cPages;
+    PVMMDLL_MEM_SNAPSHOT_RANGE pRange;  // ranges sorted by address
+    PULONG64 pqwHash;               // page hashes - 0 = page not readable
+} VMMDLL_MEM_SNAPSHOT, *PVMMDLL_MEM_SNAPSHOT;
+
+typedef struct tdVMMDLL_MEM_SNAPSHOT_DIFF_ENTRY {
+    ULONG64 qwA;                    // page address
+    DWORD tp;                       // VMMDLL_MEM_SNAPSHOT_DIFF_*
+    DWORD _Reserved;
+} VMMDLL_MEM_SNAPSHOT_DIFF_ENTRY, *PVMMDLL_MEM_SNAPSHOT_DIFF_ENTRY;
+
+typedef struct tdVMMDLL_MEM_SNAPSHOT_DIFF {
+    ULONG64 magic;                  // VMMDLL_MEM_SNAPSHOT_DIFF_MAGIC
+    DWORD dwVersion;                // VMMDLL_MEM_SNAPSHOT_DIFF_VERSION
+    DWORD cChanged;
+    DWORD cAdded;
+    DWORD cRemoved;
+    DWORD cEntry;
+    DWORD _Reserved;
+    VMMDLL_MEM_SNAPSHOT_DIFF_ENTRY pEntry[];    // entries sorted by address
+} VMMDLL_MEM_SNAPSHOT_DIFF, *PVMMDLL_MEM_SNAPSHOT_DIFF;
+
+/*
+* Take a page-level snapshot of memory - a 64-bit hash is recorded for each
+* readable page. For processes the present pages of the PTE map within the
+* address range are recorded, for physical memory all pages within the range.
+* Pages are read in parallel from the memory acquisition device (bypassing the
+* cache) and hashed - page contents are not stored.
+* NB! CALLER IS RESPONSIBLE FOR VMMDLL_MemFree return value!
+* CALLER FREE: VMMDLL_MemFree(return)
+* -- dwPID = PID of target process, (DWORD)-1 for physical memory.
+* -- qwAddrMin
+* -- qwAddrMax = max address (0 = no limit).
+* -- flags = VMMDLL_FLAG_*
+* -- return - fail: NULL, success: the snapshot - NB! Caller responsible for VMMDLL_MemFree!
+*/
+PVMMDLL_MEM_SNAPSHOT VMMDLL_MemSnapshot(_In_ DWORD dwPID, _In_ ULONG64 qwAddrMin, _In_ ULONG64 qwAddrMax, _In_ ULONG64 flags);
+
+/*
+* Take a new snapshot with the same parameters as an existing snapshot and
+* return the changed, added and removed pages between them. The new snapshot
+* is optionally returned so that it may be used as the base for the next diff.
+* NB! CALLER IS RESPONSIBLE FOR VMMDLL_MemFree return value and *ppSnapshotNew!
+* CALLER FREE: VMMDLL_MemFree(return)
+* CALLER FREE: VMMDLL_MemFree(*ppSnapshotNew)
+* -- pSnapshot = snapshot previously retrieved by VMMDLL_MemSnapshot / VMMDLL_MemSnapshotDiff.
+* -- ppSnapshotNew = optional ptr to receive the new snapshot.
+* -- return - fail: NULL, success: the diff - NB! Caller responsible for VMMDLL_MemFree!
+*/
+PVMMDLL_MEM_SNAPSHOT_DIFF VMMDLL_MemSnapshotDiff(_In_ PVMMDLL_MEM_SNAPSHOT pSnapshot, _Out_opt_ PVMMDLL_MEM_SNAPSHOT *ppSnapshotNew);
+
+typedef struct tdVMMDLL_PHYS2VIRT_ENTRY {
+    ULONG64 pa;
+    ULONG64 va;
+    DWORD dwPID;
+    DWORD _Reserved;
+} VMMDLL_PHYS2VIRT_ENTRY, *PVMMDLL_PHYS2VIRT_ENTRY;
+
+/*
+* Translate physical addresses to all virtual addresses (in all processes)
+* which map them. A global reverse index is built in one page table walk of
+* all active processes on first use and kept until the next total refresh -
+* subsequent lookups are fast. If pEntries is set to NULL the number of
+* entries required will be returned in parameter pcEntries.
+* Entries are returned in order of pPAs and by PID and virtual address.
+* -- cPAs = number of physical addresses in pPAs.
+* -- pPAs = physical addresses to look up.
+* -- pEntries = buffer of minimum length *pcEntries or NULL.
+* -- pcEntries = pointer to number of entries in pEntries.
+* -- return = success/fail.
+*/
+_Success_(return)
+BOOL VMMDLL_MemPhys2VirtIndex(_In_ DWORD cPAs, _In_reads_(cPAs) PULONG64 pPAs, _Out_writes_opt_(*pcEntries) PVMMDLL_PHYS2VIRT_ENTRY pEntries, _Inout_ PDWORD pcEntries);
+
 
 
 //-----------------------------------------------------------------------------
@@ -462,7 +838,7 @@ BOOL VMMDLL_MemVirt2Phys(_In_ DWORD dwPID, _In_ ULONG64 qwVA, _Out_ PULONG64 pqw
 #define VMMDLL_MAP_PTE_VERSION              1
 #define VMMDLL_MAP_VAD_VERSION              1
 #define VMMDLL_MAP_MODULE_VERSION           1
-#define VMMDLL_MAP_HEAP_VERSION             1
+#define VMMDLL_MAP_HEAP_VERSION             2
 #define VMMDLL_MAP_THREAD_VERSION           1
 #define VMMDLL_MAP_HANDLE_VERSION           1
 
@@ -527,6 +903,9 @@ typedef struct tdVMMDLL_MAP_HEAPENTRY {
     DWORD cPagesUnCommitted : 24;
     DWORD HeapId : 7;
     DWORD fPrimary : 1;
+    QWORD vaHeap;                   // heap (_HEAP) the segment belongs to
+    QWORD vaFirstEntry;             // segment range: first heap entry
+    QWORD vaLastValidEntry;         // segment range: end of last valid entry
 } VMMDLL_MAP_HEAPENTRY, *PVMMDLL_MAP_HEAPENTRY;
 
 typedef struct tdVMMDLL_MAP_THREADENTRY {
@@ -546,7 +925,8 @@ typedef struct tdVMMDLL_MAP_THREADENTRY {
     QWORD vaStackLimitUser;
     QWORD vaStackBaseKernel;
     QWORD vaStackLimitKernel;
-    DWORD _FutureUse[10];
+    DWORD dwGeneration;             // thread map generation in which entry was added or last changed
+    DWORD _FutureUse[9];
 } VMMDLL_MAP_THREADENTRY, *PVMMDLL_MAP_THREADENTRY;
 
 typedef struct tdVMMDLL_MAP_HANDLEENTRY {
@@ -645,6 +1025,31 @@ BOOL VMMDLL_ProcessMap_GetPte(_In_ DWORD dwPID, _Out_writes_bytes_opt_(*pcbPteMa
 _Success_(return)
 BOOL VMMDLL_ProcessMap_GetVad(_In_ DWORD dwPID, _Out_writes_bytes_opt_(*pcbVadMap) PVMMDLL_MAP_VAD pVadMap, _Inout_ PDWORD pcbVadMap, _In_ BOOL fIdentifyModules);
 
+/*
+* Retrieve the single memory map entry based on hardware page tables (PTE)
+* which contains the virtual address va. The entry is looked up in the cached
+* map without copying the full map. No text is returned - wszText is NULL.
+* -- dwPID
+* -- va = virtual address inside the entry to retrieve.
+* -- pPteEntry = buffer to receive the entry.
+* -- return = success/fail.
+*/
+_Success_(return)
+BOOL VMMDLL_ProcessMap_GetPteEntry(_In_ DWORD dwPID, _In_ ULONG64 va, _Out_ PVMMDLL_MAP_PTEENTRY pPteEntry);
+
+/*
+* Retrieve the single memory map entry based on virtual address descriptors
+* (VAD) which contains the virtual address va. The entry is looked up in the
+* cached map without copying the full map. No text is returned - wszText is
+* NULL.
+* -- dwPID
+* -- va = virtual address inside the entry to retrieve.
+* -- pVadEntry = buffer to receive the entry.
+* -- return = success/fail.
+*/
+_Success_(return)
+BOOL VMMDLL_ProcessMap_GetVadEntry(_In_ DWORD dwPID, _In_ ULONG64 va, _Out_ PVMMDLL_MAP_VADENTRY pVadEntry);
+
 /*
 * Retrieve the modules (.dlls) for the specified process. If pModuleMap is set
 * to NULL the number of bytes required will be returned in parameter pcbModuleMap.
@@ -679,6 +1084,37 @@ BOOL VMMDLL_ProcessMap_GetModuleFromName(_In_ DWORD dwPID, _In_ LPWSTR wszModule
 _Success_(return)
 BOOL VMMDLL_ProcessMap_GetHeap(_In_ DWORD dwPID, _Out_writes_bytes_opt_(*pcbHeapMap) PVMMDLL_MAP_HEAP pHeapMap, _Inout_ PDWORD pcbHeapMap);
 
+typedef struct tdVMMDLL_HEAP_ENTRY {
+    ULONG64 va;                     // heap entry (header) address
+    DWORD cb;                       // block size including header
+    DWORD dwFlags;                  // decoded heap entry flags
+    DWORD HeapId;
+    DWORD iSegment;                 // index of segment in the heap map
+    BOOL fBusy;                     // allocated block
+    DWORD _Reserved;
+} VMMDLL_HEAP_ENTRY, *PVMMDLL_HEAP_ENTRY;
+
+/*
+* Callback function for VMMDLL_ProcessMap_EnumHeapEntries.
+* -- ctx = optional context as given to VMMDLL_ProcessMap_EnumHeapEntries.
+* -- pEntry
+* -- return = TRUE to continue enumeration, FALSE to stop.
+*/
+typedef BOOL(*VMMDLL_HEAP_ENTRY_CALLBACK)(_In_opt_ PVOID ctx, _In_ PVMMDLL_HEAP_ENTRY pEntry);
+
+/*
+* Enumerate the heap entries of all segments in the heap map of the specified
+* process. Segments are walked lazily in batched page windows and encoded heap
+* entry headers are decoded. Only NT (back-end) heap entries are enumerated;
+* low fragmentation heap sub-segments show up as single busy entries.
+* -- dwPID
+* -- pfnCallback
+* -- ctx = optional context forwarded to pfnCallback.
+* -- return = success/fail.
+*/
+_Success_(return)
+BOOL VMMDLL_ProcessMap_EnumHeapEntries(_In_ DWORD dwPID, _In_ VMMDLL_HEAP_ENTRY_CALLBACK pfnCallback, _In_opt_ PVOID ctx);
+
 /*
 * Retrieve the threads for the specified process. If pThreadMap is set to NULL
 * the number of bytes required will be returned in parameter pcbThreadMap.
@@ -691,6 +1127,23 @@ BOOL VMMDLL_ProcessMap_GetHeap(_In_ DWORD dwPID, _Out_writes_bytes_opt_(*pcbHeap
 _Success_(return)
 BOOL VMMDLL_ProcessMap_GetThread(_In_ DWORD dwPID, _Out_writes_bytes_opt_(*pcbThreadMap) PVMMDLL_MAP_THREAD pThreadMap, _Inout_ PDWORD pcbThreadMap);
 
+/*
+* Retrieve the threads of all processes which have been added or changed since
+* the thread map generation dwGeneration. Thread maps of processes which don't
+* have a thread map yet are built in one batched pass. Thread maps are rebuilt
+* on total refresh; threads unchanged since the previous build keep their older
+* generation (VMMDLL_MAP_THREADENTRY.dwGeneration). Removed threads are not
+* reported. Use 0 as dwGeneration to retrieve all threads. If pThreadMap is
+* set to NULL the number of bytes required will be returned in pcbThreadMap.
+* -- dwGeneration = generation returned by a previous call in pdwGeneration or 0.
+* -- pThreadMap = buffer of minimum byte length *pcbThreadMap or NULL.
+* -- pcbThreadMap = pointer to byte count of pThreadMap buffer.
+* -- pdwGeneration = optional current generation to use in the next call.
+* -- return = success/fail.
+*/
+_Success_(return)
+BOOL VMMDLL_ProcessMap_GetThreadChanged(_In_ DWORD dwGeneration, _Out_writes_bytes_opt_(*pcbThreadMap) PVMMDLL_MAP_THREAD pThreadMap, _Inout_ PDWORD pcbThreadMap, _Out_opt_ PDWORD pdwGeneration);
+
 /*
 * Retrieve the handles for the specified process. If pHandleMap is set to NULL
 * the number of bytes required will be returned in parameter pcbHandleMap.
@@ -703,6 +1156,28 @@ BOOL VMMDLL_ProcessMap_GetThread(_In_ DWORD dwPID, _Out_writes_bytes_opt_(*pcbTh
 _Success_(return)
 BOOL VMMDLL_ProcessMap_GetHandle(_In_ DWORD dwPID, _Out_writes_bytes_opt_(*pcbHandleMap) PVMMDLL_MAP_HANDLE pHandleMap, _Inout_ PDWORD pcbHandleMap);
 
+#define VMMDLL_GENERATION_TP_PROCESSTABLE       0
+#define VMMDLL_GENERATION_TP_PTE                1
+#define VMMDLL_GENERATION_TP_VAD                2
+#define VMMDLL_GENERATION_TP_MODULE             3
+#define VMMDLL_GENERATION_TP_HEAP               4
+#define VMMDLL_GENERATION_TP_THREAD             5
+#define VMMDLL_GENERATION_TP_HANDLE             6
+
+/*
+* Retrieve the generation of the process table or of a map of the specified
+* process. Generations are unique and increase monotonically - a changed
+* generation means the object has been rebuilt since last retrieved. Module
+* and handle maps retain their generation if rebuilt with unchanged contents.
+* Retrieving the generation of a map will build the map if not already built.
+* -- dwPID = process (ignored for VMMDLL_GENERATION_TP_PROCESSTABLE).
+* -- tp = VMMDLL_GENERATION_TP_*
+* -- pqwGeneration
+* -- return = success/fail.
+*/
+_Success_(return)
+BOOL VMMDLL_ProcessGetGeneration(_In_ DWORD dwPID, _In_ DWORD tp, _Out_ PULONG64 pqwGeneration);
+
 
 
 //-----------------------------------------------------------------------------
@@ -786,6 +1261,38 @@ BOOL VMMDLL_ProcessGetInformation(_In_ DWORD dwPID, _Inout_opt_ PVMMDLL_PROCESS_
 */
 LPSTR VMMDLL_ProcessGetInformationString(_In_ DWORD dwPID, _In_ DWORD fOptionString);
 
+#define VMMDLL_PROCESS_INFORMATION_ALL_VERSION  1
+
+typedef struct tdVMMDLL_PROCESS_INFORMATION_ALL_ENTRY {
+    VMMDLL_PROCESS_INFORMATION info;
+    ULONG64 ftCreateTime;                   // FILETIME, 0 if not available
+    ULONG64 ftExitTime;                     // FILETIME, 0 if not available
+    LPSTR szPathKernel;                     // ptr into szMultiText, never NULL
+    LPSTR szPathUserImage;                  // ptr into szMultiText, never NULL
+    LPSTR szCommandLine;                    // ptr into szMultiText, never NULL
+} VMMDLL_PROCESS_INFORMATION_ALL_ENTRY, *PVMMDLL_PROCESS_INFORMATION_ALL_ENTRY;
+
+typedef struct tdVMMDLL_PROCESS_INFORMATION_ALL {
+    DWORD dwVersion;                        // VMMDLL_PROCESS_INFORMATION_ALL_VERSION
+    DWORD cbMultiText;
+    LPSTR szMultiText;                      // NULL-terminated strings shared by all entries
+    DWORD _Reserved;
+    DWORD cProcess;
+    VMMDLL_PROCESS_INFORMATION_ALL_ENTRY pProcess[];
+} VMMDLL_PROCESS_INFORMATION_ALL, *PVMMDLL_PROCESS_INFORMATION_ALL;
+
+/*
+* Retrieve process information, including creation/exit times, kernel path,
+* user mode image path and command line, for all processes in one call. The
+* user mode process parameters of all processes are read in a single parallel
+* pass before the result is packed into one allocation. All strings are stored
+* in a shared string blob and are always NULL terminated (possibly empty).
+* NB! CALLER IS RESPONSIBLE FOR VMMDLL_MemFree return value!
+* CALLER FREE: VMMDLL_MemFree(return)
+* -- return - fail: NULL, success: the process information - NB! must be VMMDLL_MemFree'd by caller!
+*/
+PVMMDLL_PROCESS_INFORMATION_ALL VMMDLL_ProcessGetInformationAll();
+
 typedef struct tdVMMDLL_EAT_ENTRY {
     ULONG64 vaFunction;
     DWORD vaFunctionOffset;
@@ -819,6 +1326,33 @@ BOOL VMMDLL_ProcessGetEAT(_In_ DWORD dwPID, _In_ LPWSTR wszModule, _Out_opt_ PVM
 _Success_(return)
 BOOL VMMDLL_ProcessGetIAT(_In_ DWORD dwPID, _In_ LPWSTR wszModule, _Out_opt_ PVMMDLL_IAT_ENTRY pData, _In_ DWORD cData, _Out_ PDWORD pcData);
 
+/*
+* Callback function for VMMDLL_ProcessDumpModules. The callback may be called
+* in parallel from multiple threads (for different modules). The chunks of a
+* single module are delivered in file offset order.
+* -- ctx = optional context as given to VMMDLL_ProcessDumpModules.
+* -- vaModuleBase
+* -- wszModuleName
+* -- cbFile = total size of the re-constructed module file.
+* -- cbOffset = file offset of the chunk.
+* -- pb
+* -- cb
+* -- return = TRUE to continue, FALSE to stop the dump.
+*/
+typedef BOOL(*VMMDLL_PE_DUMP_CALLBACK)(_In_opt_ PVOID ctx, _In_ ULONG64 vaModuleBase, _In_ LPWSTR wszModuleName, _In_ DWORD cbFile, _In_ DWORD cbOffset, _In_reads_(cb) PBYTE pb, _In_ DWORD cb);
+
+/*
+* Dump all modules of a process as best-effort re-constructed PE files (same
+* as the files in the 'pedump' directory). Modules are re-constructed in
+* parallel and streamed in chunks of up to 1MB to the callback function.
+* -- dwPID
+* -- pfnCallback
+* -- ctx = optional context forwarded to pfnCallback.
+* -- return = TRUE on completion, FALSE on fail or if stopped by the callback.
+*/
+_Success_(return)
+BOOL VMMDLL_ProcessDumpModules(_In_ DWORD dwPID, _In_ VMMDLL_PE_DUMP_CALLBACK pfnCallback, _In_opt_ PVOID ctx);
+
 /*
 * Retrieve the virtual address of a given function inside a process/module.
 * -- dwPID
@@ -846,6 +1380,8 @@ ULONG64 VMMDLL_ProcessGetModuleBase(_In_ DWORD dwPID, _In_ LPWSTR wszModuleName)
 * Retrieve a symbol virtual address given a module name and a symbol name.
 * NB! not all modules may exist - initially only module "nt" is available.
 * NB! if multiple modules have the same name the 1st to be added will be used.
+* NB! the call waits for the PDB of the module to be loaded if required - this
+*     may take some time if the PDB has to be downloaded from the symbol server.
 * -- szModule
 * -- szSymbolName
 * -- pvaSymbolAddress
@@ -858,6 +1394,8 @@ BOOL VMMDLL_PdbSymbolAddress(_In_ LPSTR szModule, _In_ LPSTR szSymbolName, _Out_
 * Retrieve a type size given a module name and a type name.
 * NB! not all modules may exist - initially only module "nt" is available.
 * NB! if multiple modules have the same name the 1st to be added will be used.
+* NB! the call waits for the PDB of the module to be loaded if required - this
+*     may take some time if the PDB has to be downloaded from the symbol server.
 * -- szModule
 * -- szTypeName
 * -- pcbTypeSize
@@ -870,6 +1408,8 @@ BOOL VMMDLL_PdbTypeSize(_In_ LPSTR szModule, _In_ LPSTR szTypeName, _Out_ PDWORD
 * Locate the offset of a type child - typically a sub-item inside a struct.
 * NB! not all modules may exist - initially only module "nt" is available.
 * NB! if multiple modules have the same name the 1st to be added will be used.
+* NB! the call waits for the PDB of the module to be loaded if required - this
+*     may take some time if the PDB has to be downloaded from the symbol server.
 * -- szModule
 * -- szTypeName
 * -- wszTypeChildName
@@ -1016,6 +1556,46 @@ BOOL VMMDLL_WinReg_QueryValueExW(
     _When_(lpData == NULL, _Out_opt_) _When_(lpData != NULL, _Inout_opt_) LPDWORD lpcbData
 );
 
+typedef struct tdVMMDLL_REGISTRY_SEARCH_MATCH {
+    ULONG64 vaCMHIVE;
+    ULONG64 ftLastWrite;        // last write time of key
+    LPWSTR wszKeyPath;          // key path relative to hive, i.e. 'ROOT\Key\SubKey'
+    LPWSTR wszValueName;        // value name, or NULL on key match
+    DWORD dwType;
+    DWORD cbData;               // value data length in pbData (max 16MB)
+    PBYTE pbData;
+} VMMDLL_REGISTRY_SEARCH_MATCH, *PVMMDLL_REGISTRY_SEARCH_MATCH;
+
+typedef BOOL(*VMMDLL_WINREG_SEARCH_CALLBACK)(_In_opt_ PVOID ctx, _In_ PVMMDLL_REGISTRY_SEARCH_MATCH pMatch);
+
+/*
+* Search all registry hives for keys and values matching the given criteria -
+* i.e. for persistence hunting without a large number of enumeration calls.
+* Hives are searched in parallel directly over their in-memory snapshots. The
+* active key tree is searched - deleted and orphaned keys are not searched.
+* If neither wszValueNameGlob nor pbDataPattern is given matching keys will be
+* reported, otherwise matching values will be reported.
+* Globs are case insensitive and may contain '*' and '?'.
+* Callbacks are never made concurrently but may be made from different threads.
+* Pointers in the match struct are only valid during the callback.
+* -- wszKeyPathGlob = optional key path glob, i.e. 'ROOT\*\CurrentVersion\Run*'.
+* -- wszValueNameGlob = optional value name glob.
+* -- pbDataPattern = optional byte pattern to search for within value data.
+* -- cbDataPattern
+* -- pfnCallback = callback function called on each match. Return FALSE to stop the search.
+* -- ctx = optional context to pass along to the callback function.
+* -- return
+*/
+_Success_(return)
+BOOL VMMDLL_WinReg_Search(
+    _In_opt_ LPWSTR wszKeyPathGlob,
+    _In_opt_ LPWSTR wszValueNameGlob,
+    _In_reads_opt_(cbDataPattern) PBYTE pbDataPattern,
+    _In_ DWORD cbDataPattern,
+    _In_ VMMDLL_WINREG_SEARCH_CALLBACK pfnCallback,
+    _In_opt_ PVOID ctx
+);
+
 
 
 //-----------------------------------------------------------------------------
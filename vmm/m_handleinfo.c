@@ -55,6 +55,19 @@ NTSTATUS HandleInfo_Read_HandleMap(_In_ PVMMOB_MAP_HANDLE pHandleMap, _Out_ PBYT
     return nt;
 }
 
+/*
+* Render function for the render cache - render the complete handles.txt file.
+*/
+_Success_(return)
+BOOL HandleInfo_Render_HandleMap(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _In_ PVMMOB_MAP_HANDLE pHandleMap, _Out_ PBYTE *ppb, _Out_ PDWORD pcb)
+{
+    DWORD cb = (DWORD)(pHandleMap->cMap * HANDLEINFO_LINELENGTH);
+    *pcb = 0;
+    if(!(*ppb = LocalAlloc(0, max(1, cb)))) { return FALSE; }
+    HandleInfo_Read_HandleMap(pHandleMap, *ppb, cb, pcb, 0);
+    return TRUE;
+}
+
 /*
 * Read : function as specified by the module manager. The module manager will
 * call into this callback function whenever a read shall occur from a "file".
@@ -71,7 +84,7 @@ NTSTATUS HandleInfo_Read(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _Out_ PBYTE pb, _In_ D
     NTSTATUS nt = VMMDLL_STATUS_FILE_INVALID;
     PVMMOB_MAP_HANDLE pObHandleMap = NULL;
     if(!_wcsicmp(ctx->wszPath, L"handles.txt") && VmmMap_GetHandle(ctx->pProcess, &pObHandleMap, TRUE)) {
-        nt = HandleInfo_Read_HandleMap(pObHandleMap, pb, cb, pcbRead, cbOffset);
+        nt = PluginManager_RenderRead(ctx, pObHandleMap, 0, (PFN_PLUGINMANAGER_RENDER)HandleInfo_Render_HandleMap, pb, cb, pcbRead, cbOffset);
         Ob_DECREF(pObHandleMap);
     }
     return nt;
@@ -330,6 +330,19 @@ NTSTATUS LdrModules_Read_ModuleSubFile(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _In_ PVM
     return VMMDLL_STATUS_FILE_INVALID;
 }
 
+/*
+* Render function for the render cache - render the complete modules.txt file.
+*/
+_Success_(return)
+BOOL LdrModules_Render_ModulesFile(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _In_ PVMMOB_MAP_MODULE pModuleMap, _Out_ PBYTE *ppb, _Out_ PDWORD pcb)
+{
+    DWORD cb = (DWORD)(pModuleMap->cMap * (ctxVmm->f32 ? LDRMODULES_LINELENGTH_X86 : LDRMODULES_LINELENGTH_X64));
+    *pcb = 0;
+    if(!(*ppb = LocalAlloc(0, max(1, cb)))) { return FALSE; }
+    LdrModules_ReadModulesFile(pModuleMap, *ppb, cb, pcb, 0);
+    return TRUE;
+}
+
 /*
 * Read : function as specified by the module manager. The module manager will
 * call into this callback function whenever a read shall occur from a "file".
@@ -349,7 +362,7 @@ NTSTATUS LdrModules_Read(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _Out_ PBYTE pb, _In_ D
     PVMMOB_MAP_MODULE pObModuleMap = NULL;
     if(!_wcsicmp(ctx->wszPath, L"modules.txt")) {
         if(VmmMap_GetModule((PVMM_PROCESS)ctx->pProcess, &pObModuleMap)) {
-            nt = LdrModules_ReadModulesFile(pObModuleMap, pb, cb, pcbRead, cbOffset);
+            nt = PluginManager_RenderRead(ctx, pObModuleMap, 0, (PFN_PLUGINMANAGER_RENDER)LdrModules_Render_ModulesFile, pb, cb, pcbRead, cbOffset);
             Ob_DECREF(pObModuleMap);
         }
         return nt;
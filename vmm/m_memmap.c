@@ -156,6 +156,29 @@ NTSTATUS MemMap_Read_PteMap(_In_ PVMMOB_MAP_PTE pPteMap, _Out_ PBYTE pb, _In_ DW
     return nt;
 }
 
+/*
+* Render functions for the render cache - render the complete file.
+*/
+_Success_(return)
+BOOL MemMap_Render_PteMap(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _In_ PVMMOB_MAP_PTE pPteMap, _Out_ PBYTE *ppb, _Out_ PDWORD pcb)
+{
+    DWORD cb = (DWORD)(pPteMap->cMap * (ctxVmm->f32 ? MEMMAP_PTE_LINELENGTH_X86 : MEMMAP_PTE_LINELENGTH_X64));
+    *pcb = 0;
+    if(!(*ppb = LocalAlloc(0, max(1, cb)))) { return FALSE; }
+    MemMap_Read_PteMap(pPteMap, *ppb, cb, pcb, 0);
+    return TRUE;
+}
+
+_Success_(return)
+BOOL MemMap_Render_VadMap(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _In_ PVMMOB_MAP_VAD pVadMap, _Out_ PBYTE *ppb, _Out_ PDWORD pcb)
+{
+    DWORD cb = (DWORD)(pVadMap->cMap * (ctxVmm->f32 ? MEMMAP_VAD_LINELENGTH_X86 : MEMMAP_VAD_LINELENGTH_X64));
+    *pcb = 0;
+    if(!(*ppb = LocalAlloc(0, max(1, cb)))) { return FALSE; }
+    MemMap_Read_VadMap(pVadMap, *ppb, cb, pcb, 0);
+    return TRUE;
+}
+
 /*
 * Read : function as specified by the module manager. The module manager will
 * call into this callback function whenever a read shall occur from a "file".
@@ -175,14 +198,14 @@ NTSTATUS MemMap_Read(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _Out_ PBYTE pb, _In_ DWORD
     // read page table memory map.
     if(!_wcsicmp(ctx->wszPath, L"pte.txt")) {
         if(VmmMap_GetPte(ctx->pProcess, &pObMemMapPte, TRUE)) {
-            nt = MemMap_Read_PteMap(pObMemMapPte, pb, cb, pcbRead, cbOffset);
+            nt = PluginManager_RenderRead(ctx, pObMemMapPte, 0, (PFN_PLUGINMANAGER_RENDER)MemMap_Render_PteMap, pb, cb, pcbRead, cbOffset);
             Ob_DECREF(pObMemMapPte);
         }
         return nt;
     }
     if(!_wcsicmp(ctx->wszPath, L"vad.txt")) {
         if(VmmMap_GetVad(ctx->pProcess, &pObMemMapVad, TRUE)) {
-            nt = MemMap_Read_VadMap(pObMemMapVad, pb, cb, pcbRead, cbOffset);
+            nt = PluginManager_RenderRead(ctx, pObMemMapVad, 0, (PFN_PLUGINMANAGER_RENDER)MemMap_Render_VadMap, pb, cb, pcbRead, cbOffset);
             Ob_DECREF(pObMemMapVad);
         }
         return nt;
@@ -58,7 +58,33 @@ _Success_(return)
 BOOL Phys2Virt_GetUpdateAll(_Out_opt_ PM_PHYS2VIRT_MULTIENTRY_CONTEXT *ppMultiEntry, _Out_opt_ PDWORD pcMultiEntry)
 {
     PM_PHYS2VIRT_MULTIENTRY_CONTEXT ctx = NULL;
+    PVMMOB_PHYS2VIRT_INDEX pObIndex = NULL;
+    PVMM_PHYS2VIRT_INDEX_ENTRY pe = NULL;
     SIZE_T cPIDs = 0;
+    DWORD i, c;
+    // use the global reverse index if already built by another consumer.
+    if((pObIndex = VmmPhys2VirtIndex_Get(FALSE))) {
+        c = VmmPhys2VirtIndex_Query(pObIndex, ctxVmm->paPluginPhys2VirtRoot, NULL, 0);
+        ctx = LocalAlloc(LMEM_ZEROINIT, sizeof(M_PHYS2VIRT_MULTIENTRY_CONTEXT) + (c + 1) * sizeof(M_PHYS2VIRT_MULTIENTRY));
+        pe = LocalAlloc(0, max(1, c) * sizeof(VMM_PHYS2VIRT_INDEX_ENTRY));
+        if(ctx && pe) {
+            ctx->pa = ctxVmm->paPluginPhys2VirtRoot;
+            ctx->cMax = c + 1;
+            c = VmmPhys2VirtIndex_Query(pObIndex, ctx->pa, pe, c);
+            for(i = 0; i < c; i++) {
+                ctx->e[i + 1].dwPID = pe[i].dwPID;
+                ctx->e[i + 1].va = pe[i].va;
+            }
+            ctx->c = c;
+            Ob_DECREF(pObIndex);
+            LocalFree(pe);
+            goto finish;
+        }
+        Ob_DECREF(pObIndex);
+        LocalFree(ctx);
+        LocalFree(pe);
+        ctx = NULL;
+    }
     VmmProcessListPIDs(NULL, &cPIDs, 0);
     ctx = LocalAlloc(LMEM_ZEROINIT, sizeof(M_PHYS2VIRT_MULTIENTRY_CONTEXT) + cPIDs * 4 * sizeof(M_PHYS2VIRT_MULTIENTRY));
     if(!ctx) { return FALSE; }
@@ -66,6 +92,7 @@ BOOL Phys2Virt_GetUpdateAll(_Out_opt_ PM_PHYS2VIRT_MULTIENTRY_CONTEXT *ppMultiEn
     ctx->cMax = (DWORD)cPIDs * 4;
     VmmProcessActionForeachParallel(ctx, 5, VmmProcessActionForeachParallel_CriteriaActiveOnly, Phys2Virt_GetUpdateAll_CallbackAction);
     ctx->c = min(ctx->c, ctx->cMax - 1);
+finish:
     if(pcMultiEntry) { *pcMultiEntry = ctx->c; }
     if(ppMultiEntry) {
         *ppMultiEntry = ctx;
@@ -21,8 +21,310 @@
 #include "vmm.h"
 #include "vmmproc.h"
 #include "vmmvfs.h"
+#include "vmmwininit.h"
 #include "vmmwinreg.h"
 #include "statistics.h"
+#include "vmmtrace.h"
+
+/*
+* Render the statistics of a cache table - in total and per cache region - as
+* text into the supplied buffer.
+* -- dwTblTag
+* -- sz
+* -- cch
+* -- return = the number of characters written (excluding null terminator).
+*/
+DWORD MStatus_CacheStatistics(_In_ DWORD dwTblTag, _Out_writes_(cch) LPSTR sz, _In_ DWORD cch)
+{
+    int i, o;
+    LPSTR szRegion;
+    CHAR szRegionNum[4];
+    PVMM_CACHE_STATISTICS_REGION pR;
+    VMM_CACHE_STATISTICS Stat;
+    LPCSTR szName = (dwTblTag == VMM_CACHE_TAG_PHYS) ? "PHYS  " : ((dwTblTag == VMM_CACHE_TAG_TLB) ? "TLB   " : "PAGING");
+    if(!VmmCacheGetStatistics(dwTblTag, &Stat)) { return 0; }
+    o = snprintf(sz, cch,
+        "VMM CACHE %s (4kB PAGES / COUNTS - HEXADECIMAL)\n" \
+        "=================================================\n" \
+        "POLICY:                          %16s\n" \
+        "ENTRIES MAX:                     %16x\n" \
+        "ENTRIES ALLOCATED:               %16x\n" \
+        "ENTRIES EMPTY:                   %16x\n" \
+        "ENTRIES RETIRED:                 %16x\n" \
+        "NUMA NODES:                      %16x\n" \
+        "NUMA REMOTE RESERVES:            %16llx\n" \
+        "REGION  ENTRIES      HOT          HIT         MISS       INSERT        EVICT  EVICT_STALE  LOCK_WAIT LOCK_WAIT_US\n",
+        szName,
+        (Stat.tpPolicy == VMM_CACHE_POLICY_2Q) ? "2q" : "age",
+        Stat.cMaxEntries, Stat.cTotal, Stat.cEmpty, Stat.cRetire, Stat.cNumaNode, Stat.cReserveNumaRemote
+    );
+    for(i = -1; (i < VMM_CACHE2_REGIONS) && (o > 0) && ((DWORD)o < cch); i++) {
+        if(i < 0) {
+            pR = &Stat.Total;
+            szRegion = "TOTAL";
+        } else {
+            pR = &Stat.R[i];
+            _snprintf_s(szRegionNum, sizeof(szRegionNum), _TRUNCATE, "%i", i);
+            szRegion = szRegionNum;
+        }
+        o += snprintf(sz + o, cch - o, "%6s %8x %8x %12llx %12llx %12llx %12llx %12llx %10llx %12llx\n",
+            szRegion, pR->cEntries - pR->cHot, pR->cHot, pR->cHit, pR->cMiss, pR->cInsert, pR->cEvict, pR->cEvictStale, pR->cLockContended, pR->qwLockWaitUs);
+    }
+    return (o > 0) ? min((DWORD)o, cch - 1) : 0;
+}
+
+/*
+* Render the readiness and the startup timings of the initialization stages as
+* text into the supplied buffer.
+* -- sz
+* -- cch
+* -- return = the number of characters written (excluding null terminator).
+*/
+DWORD MStatus_InitStages(_Out_writes_(cch) LPSTR sz, _In_ DWORD cch)
+{
+    int o;
+    DWORD i;
+    BOOL fReady;
+    QWORD qwStartMs, qwDurationMs;
+    o = snprintf(sz, cch,
+        "VMM INITIALIZATION STAGES (TIMES IN MS - DECIMAL)\n" \
+        "=================================================\n" \
+        "MODE:                    %10s\n" \
+        "STAGE         READY    START_MS DURATION_MS\n",
+        ctxVmm->Init.fStaged ? "staged" : "sequential");
+    for(i = 0; (i <= VMM_INIT_STAGE_MAX) && (o > 0) && ((DWORD)o < cch); i++) {
+        fReady = VmmWinInit_StageGet(i, &qwStartMs, &qwDurationMs);
+        o += snprintf(sz + o, cch - o, "%-12s %6s %11llu %11llu\n",
+            (i < VMM_INIT_STAGE_MAX) ? VMM_INIT_STAGE_TOSTRING[i] : "TOTAL", fReady ? "yes" : "no", qwStartMs, qwDurationMs);
+    }
+    return (o > 0) ? min((DWORD)o, cch - 1) : 0;
+}
+
+/*
+* Render the device I/O telemetry - i.e. what is requested from the LeechCore
+* device by the VMM - as text into the supplied buffer. The histograms are log2
+* bucketed; each row shows the count of values >= the row value and less than
+* the value of the next row.
+* -- sz
+* -- cch
+* -- return = the number of characters written (excluding null terminator).
+*/
+DWORD MStatus_DeviceStatistics(_Out_writes_(cch) LPSTR sz, _In_ DWORD cch)
+{
+    int o;
+    DWORD i;
+    QWORD tmNow, qwTimeUs, qwUnusedPct;
+    PVMM_STATISTICS_DEVICE pD = &ctxVmm->stat.dev;
+    PVMM_STATISTICS_DEVICE_OP pOp, pOps[] = { &pD->ReadScatter, &pD->ReadContiguous, &pD->Write };
+    LPCSTR szOps[] = { "READ_SCATTER", "READ_CONTIG", "WRITE" };
+    if(!pD->qwFreq) { return 0; }
+    QueryPerformanceCounter((PLARGE_INTEGER)&tmNow);
+    qwTimeUs = ((tmNow - pD->tmInitialize) * 1000000ULL) / pD->qwFreq;
+    qwUnusedPct = ctxVmm->stat.cPhysReadAhead ? (100 * (ctxVmm->stat.cPhysReadAhead - min(ctxVmm->stat.cPhysReadAhead, ctxVmm->stat.cPhysReadAheadHit)) / ctxVmm->stat.cPhysReadAhead) : 0;
+    o = snprintf(sz, cch,
+        "VMM DEVICE I/O TELEMETRY (COUNTS / TIMES IN US / KB/S - DECIMAL)\n" \
+        "================================================================\n" \
+        "UPTIME_US:                %16llu\n" \
+        "READ-AHEAD PAGES:         %16llu\n" \
+        "READ-AHEAD USED:          %16llu\n" \
+        "READ-AHEAD EVICTED UNUSED:%16llu\n" \
+        "READ-AHEAD UNUSED PCT:    %16llu\n" \
+        "OPERATION           CALLS        PAGES            BYTES          TIME_US  KB/S_DEVICE  KB/S_UPTIME\n",
+        qwTimeUs, ctxVmm->stat.cPhysReadAhead, ctxVmm->stat.cPhysReadAheadHit, ctxVmm->stat.cPhysReadAheadMiss, qwUnusedPct);
+    for(i = 0; (i < sizeof(pOps) / sizeof(PVMM_STATISTICS_DEVICE_OP)) && (o > 0) && ((DWORD)o < cch); i++) {
+        pOp = pOps[i];
+        o += snprintf(sz + o, cch - o, "%-12s %12llu %12llu %16llu %16llu %12llu %12llu\n",
+            szOps[i], pOp->cCall, pOp->cPage, pOp->cb,
+            (pOp->tm * 1000000ULL) / pD->qwFreq,
+            pOp->tm ? ((pOp->cb / 1024) * pD->qwFreq / pOp->tm) : 0,
+            qwTimeUs ? ((pOp->cb / 1024) * 1000000ULL / qwTimeUs) : 0);
+    }
+    if((o > 0) && ((DWORD)o < cch)) {
+        o += snprintf(sz + o, cch - o,
+            "HISTOGRAMS (LOG2 BUCKETS): BATCH = PAGES PER DEVICE CALL, RUN = CONTIGUOUS PAGES, LAT = LATENCY US\n" \
+            "   >= VALUE RS_BATCH   RC_BATCH    W_BATCH        RUN     RS_LAT     RC_LAT      W_LAT\n");
+    }
+    for(i = 0; (i < VMM_STATISTICS_DEVICE_BUCKETS) && (o > 0) && ((DWORD)o < cch); i++) {
+        o += snprintf(sz + o, cch - o, "%11llu %8llu %10llu %10llu %10llu %10llu %10llu %10llu\n",
+            i ? (1ULL << (i - 1)) : 0,
+            pD->ReadScatter.cHistBatch[i], pD->ReadContiguous.cHistBatch[i], pD->Write.cHistBatch[i], pD->cHistRun[i],
+            pD->ReadScatter.cHistLatency[i], pD->ReadContiguous.cHistLatency[i], pD->Write.cHistLatency[i]);
+    }
+    return (o > 0) ? min((DWORD)o, cch - 1) : 0;
+}
+
+/*
+* Render the state of the adaptive refresh scheduler as text into the supplied
+* buffer. Refresh periods are shown in ms; CHANGE_PCT is the change rate last
+* measured by the scheduler ('-' if not yet measured).
+* -- sz
+* -- cch
+* -- return = the number of characters written (excluding null terminator).
+*/
+DWORD MStatus_RefreshStatistics(_Out_writes_(cch) LPSTR sz, _In_ DWORD cch)
+{
+    int o;
+    DWORD i, cMsTick;
+    QWORD tcNow = GetTickCount64();
+    CHAR szChangePct[8];
+    PVMM_REFRESH_SCHEDULE ps;
+    LPCSTR szRefresh[] = { "PHYS", "TLB", "PROC_PARTIAL", "PROC_TOTAL", "REGISTRY" };
+    DWORD cTickBase[] = {
+        ctxVmm->ThreadProcCache.cTick_Phys,
+        ctxVmm->ThreadProcCache.cTick_TLB,
+        ctxVmm->ThreadProcCache.cTick_ProcPartial,
+        ctxVmm->ThreadProcCache.cTick_ProcTotal,
+        ctxVmm->ThreadProcCache.cTick_Registry
+    };
+    cMsTick = ctxVmm->ThreadProcCache.cMs_TickPeriod;
+    o = snprintf(sz, cch,
+        "VMM REFRESH SCHEDULER (TIMES IN MS - DECIMAL)\n" \
+        "=============================================\n" \
+        "BACKGROUND REFRESH:       %16s\n" \
+        "ADAPTIVE:                 %16s\n" \
+        "IDLE (SUSPENDED):         %16s\n" \
+        "IDLE_THRESHOLD_MS:        %16i\n" \
+        "LAST_API_ACTIVITY_MS:     %16llu\n" \
+        "REFRESH           BASE_MS  CURRENT_MS  CHANGE_PCT   LAST_AGE_MS\n",
+        ctxVmm->ThreadProcCache.fEnabled ? "yes" : "no",
+        ctxVmm->ThreadProcCache.fAdaptive ? "yes" : "no",
+        ctxVmm->ThreadProcCache.fIdle ? "yes" : "no",
+        ctxVmm->ThreadProcCache.cMs_Idle,
+        tcNow - min(tcNow, ctxVmm->ThreadProcCache.tcActivity));
+    for(i = 0; (i < VMM_REFRESH_MAX) && (o > 0) && ((DWORD)o < cch); i++) {
+        ps = &ctxVmm->ThreadProcCache.Schedule[i];
+        if(ps->dwChangePct == VMM_REFRESH_CHANGE_UNKNOWN) {
+            strcpy_s(szChangePct, sizeof(szChangePct), "-");
+        } else {
+            _snprintf_s(szChangePct, sizeof(szChangePct), _TRUNCATE, "%i", ps->dwChangePct);
+        }
+        o += snprintf(sz + o, cch - o, "%-12s %12i %11i %11s %13llu\n",
+            szRefresh[i],
+            cMsTick * max(1, cTickBase[i]),
+            cMsTick * VmmProcRefresh_GetTick(i),
+            szChangePct,
+            tcNow - min(tcNow, ps->tcLast));
+    }
+    return (o > 0) ? min((DWORD)o, cch - 1) : 0;
+}
+
+/*
+* Render the vmm core statistics as text into the supplied buffer.
+* -- sz
+* -- cch
+* -- return = the number of characters written (excluding null terminator).
+*/
+DWORD MStatus_Statistics(_Out_writes_(cch) LPSTR sz, _In_ DWORD cch)
+{
+    int o;
+    QWORD cPageReadTotal, cPageFailTotal, cPrototypePteEntries, cbPrototypePte;
+    AcquireSRWLockShared(&ctxVmm->Cache.PrototypePte.LockSRW);
+    cPrototypePteEntries = (QWORD)ObMap_Size(ctxVmm->Cache.PrototypePte.pmHot) + ObMap_Size(ctxVmm->Cache.PrototypePte.pmCold);
+    cbPrototypePte = ctxVmm->Cache.PrototypePte.cbHot + ctxVmm->Cache.PrototypePte.cbCold;
+    ReleaseSRWLockShared(&ctxVmm->Cache.PrototypePte.LockSRW);
+    cPageReadTotal = ctxVmm->stat.page.cPrototype + ctxVmm->stat.page.cTransition + ctxVmm->stat.page.cDemandZero + ctxVmm->stat.page.cVAD + ctxVmm->stat.page.cCacheHit + ctxVmm->stat.page.cPageFile + ctxVmm->stat.page.cCompressed;
+    cPageFailTotal = ctxVmm->stat.page.cFailCacheHit + ctxVmm->stat.page.cFailVAD + ctxVmm->stat.page.cFailPageFile + ctxVmm->stat.page.cFailCompressed + ctxVmm->stat.page.cFail;
+    o = snprintf(sz, cch,
+        "VMM STATISTICS   (4kB PAGES / COUNTS - HEXADECIMAL)\n" \
+        "===================================================\n" \
+        "PHYSICAL MEMORY:                      \n" \
+        "  READ CACHE HIT:               %16llx\n" \
+        "  READ RETRIEVED:               %16llx\n" \
+        "  READ FAIL:                    %16llx\n" \
+        "  WRITE:                        %16llx\n" \
+        "  READ-AHEAD PAGES:             %16llx\n" \
+        "  READ-AHEAD HIT:               %16llx\n" \
+        "  READ-AHEAD MISS:              %16llx\n" \
+        "  READ COALESCED:               %16llx\n" \
+        "  READ DEDUPLICATED:            %16llx\n" \
+        "  READ MEMORY MAPPED FILE:      %16llx\n" \
+        "PAGED VIRTUAL MEMORY:                 \n" \
+        "  READ SUCCESS:                 %16llx\n" \
+        "    Prototype:                  %16llx\n" \
+        "    Transition:                 %16llx\n" \
+        "    DemandZero:                 %16llx\n" \
+        "    VAD:                        %16llx\n" \
+        "    Cache:                      %16llx\n" \
+        "    PageFile:                   %16llx\n" \
+        "    Compressed:                 %16llx\n" \
+        "  READ FAIL:                    %16llx\n" \
+        "    Cache:                      %16llx\n" \
+        "    VAD:                        %16llx\n" \
+        "    PageFile:                   %16llx\n" \
+        "    Compressed:                 %16llx\n" \
+        "TLB (PAGE TABLES):                    \n" \
+        "  CACHE HIT:                    %16llx\n" \
+        "  RETRIEVED:                    %16llx\n" \
+        "  FAILED:                       %16llx\n" \
+        "  VERIFY REJECTED:              %16llx\n" \
+        "  NEGATIVE CACHE HIT:           %16llx\n" \
+        "PHYSICAL MEMORY REFRESH:        %16llx\n" \
+        "TLB MEMORY REFRESH:             %16llx\n" \
+        "PROCESS PARTIAL REFRESH:        %16llx\n" \
+        "PROCESS FULL REFRESH:           %16llx\n" \
+        "CACHE LOCK-FREE READ RETRY:     %16llx\n" \
+        "CACHE LOCKED READ FALLBACK:     %16llx\n" \
+        "CACHE DEDUP ZERO PAGE HIT:      %16llx\n" \
+        "CACHE DEDUP DUPLICATE PAGE HIT: %16llx\n" \
+        "REMOTE ASYNC PREFETCH:          %16llx\n" \
+        "PROTOTYPE PTE ARRAY CACHE:            \n" \
+        "  CACHE HIT:                    %16llx\n" \
+        "  CACHE MISS:                   %16llx\n" \
+        "  PREFETCHED:                   %16llx\n" \
+        "  EVICTED:                      %16llx\n" \
+        "  ENTRIES:                      %16llx\n" \
+        "  BYTES:                        %16llx\n" \
+        "  BYTES MAX:                    %16llx\n",
+        ctxVmm->stat.cPhysCacheHit, ctxVmm->stat.cPhysReadSuccess, ctxVmm->stat.cPhysReadFail, ctxVmm->stat.cPhysWrite,
+        ctxVmm->stat.cPhysReadAhead, ctxVmm->stat.cPhysReadAheadHit, ctxVmm->stat.cPhysReadAheadMiss,
+        ctxVmm->stat.cPhysReadCoalesced, ctxVmm->stat.cPhysReadDedup, ctxVmm->stat.cPhysReadMemMap,
+        cPageReadTotal, ctxVmm->stat.page.cPrototype, ctxVmm->stat.page.cTransition, ctxVmm->stat.page.cDemandZero, ctxVmm->stat.page.cVAD, ctxVmm->stat.page.cCacheHit, ctxVmm->stat.page.cPageFile, ctxVmm->stat.page.cCompressed,
+        cPageFailTotal, ctxVmm->stat.page.cFailCacheHit, ctxVmm->stat.page.cFailVAD, ctxVmm->stat.page.cFailPageFile, ctxVmm->stat.page.cFailCompressed,
+        ctxVmm->stat.cTlbCacheHit, ctxVmm->stat.cTlbReadSuccess, ctxVmm->stat.cTlbReadFail, ctxVmm->stat.cTlbVerifyFail, ctxVmm->stat.cTlbNegativeHit,
+        ctxVmm->stat.cPhysRefreshCache, ctxVmm->stat.cTlbRefreshCache, ctxVmm->stat.cProcessRefreshPartial, ctxVmm->stat.cProcessRefreshFull,
+        ctxVmm->stat.cCacheLockFreeRetry, ctxVmm->stat.cCacheLockFallback,
+        ctxVmm->stat.cPhysCacheDedupZero, ctxVmm->stat.cPhysCacheDedupDuplicate, ctxVmm->stat.cRemotePrefetchAsync,
+        ctxVmm->stat.cPrototypePteCacheHit, ctxVmm->stat.cPrototypePteCacheMiss, ctxVmm->stat.cPrototypePteCachePrefetch, ctxVmm->stat.cPrototypePteCacheEvict,
+        cPrototypePteEntries, cbPrototypePte, ctxVmm->Cache.PrototypePte.cbMax
+    );
+    return (o > 0) ? min((DWORD)o, cch - 1) : 0;
+}
+
+#define MSTATUS_OBJECTS_CCH_MAX     0x4000
+
+int MStatus_Objects_CmpSort(_In_ POB_TAG_STATISTICS p1, _In_ POB_TAG_STATISTICS p2)
+{
+    return (p1->cbAlive < p2->cbAlive) ? 1 : ((p1->cbAlive > p2->cbAlive) ? -1 : 0);
+}
+
+/*
+* Render the per-tag object manager statistics - sorted by the number of bytes
+* held by live objects - as text into the supplied buffer.
+* -- sz
+* -- cch
+* -- return = the number of characters written (excluding null terminator).
+*/
+DWORD MStatus_Objects(_Out_writes_(cch) LPSTR sz, _In_ DWORD cch)
+{
+    int o;
+    DWORD i, j, cStat;
+    CHAR szTag[5] = { 0 };
+    OB_TAG_STATISTICS Stat[0x80];
+    cStat = min(Ob_TagStatistics(Stat, sizeof(Stat) / sizeof(OB_TAG_STATISTICS)), sizeof(Stat) / sizeof(OB_TAG_STATISTICS));
+    qsort(Stat, cStat, sizeof(OB_TAG_STATISTICS), (int(*)(const void*, const void*))MStatus_Objects_CmpSort);
+    o = snprintf(sz, cch,
+        "OBJECT MANAGER OBJECTS PER TAG (COUNTS - HEXADECIMAL)\n" \
+        "=====================================================\n" \
+        "TAG         ALIVE            BYTES             PEAK      ALLOC_TOTAL\n");
+    for(i = 0; (i < cStat) && (o > 0) && ((DWORD)o < cch); i++) {
+        for(j = 0; j < 4; j++) {
+            szTag[j] = (CHAR)(Stat[i].tag >> (24 - 8 * j));
+            if((szTag[j] < 0x20) || (szTag[j] > 0x7e)) { szTag[j] = '?'; }
+        }
+        o += snprintf(sz + o, cch - o, "%s %12llx %16llx %16llx %16llx\n", szTag, Stat[i].cAlive, Stat[i].cbAlive, Stat[i].cAlivePeak, Stat[i].cAllocTotal);
+    }
+    return (o > 0) ? min((DWORD)o, cch - 1) : 0;
+}
 
 /*
 * Read : function as specified by the module manager. The module manager will
@@ -37,10 +339,9 @@
 NTSTATUS MStatus_Read(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _Out_ PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbRead, _In_ QWORD cbOffset)
 {
     DWORD cchBuffer;
-    CHAR szBuffer[0x800];
+    CHAR szBuffer[0x1000];
     DWORD cbCallStatistics = 0;
     PBYTE pbCallStatistics = NULL;
-    QWORD cPageReadTotal, cPageFailTotal;
     NTSTATUS nt;
     if(!_wcsicmp(ctx->wszPath, L"config_process_show_terminated")) {
         return Util_VfsReadFile_FromBOOL(ctxVmm->flags & VMM_FLAG_PROCESS_SHOW_TERMINATED, pb, cb, pcbRead, cbOffset);
@@ -48,12 +349,18 @@ NTSTATUS MStatus_Read(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _Out_ PBYTE pb, _In_ DWOR
     if(!_wcsicmp(ctx->wszPath, L"config_cache_enable")) {
         return Util_VfsReadFile_FromBOOL(!(ctxVmm->flags & VMM_FLAG_NOCACHE), pb, cb, pcbRead, cbOffset);
     }
+    if(!_wcsicmp(ctx->wszPath, L"config_cache_budget_mb")) {
+        return Util_VfsReadFile_FromDWORD(ctxVmm->Cache.cMB_Budget, pb, cb, pcbRead, cbOffset, FALSE);
+    }
     if(!_wcsicmp(ctx->wszPath, L"config_paging_enable")) {
         return Util_VfsReadFile_FromBOOL(!(ctxVmm->flags & VMM_FLAG_NOPAGING), pb, cb, pcbRead, cbOffset);
     }
     if(!_wcsicmp(ctx->wszPath, L"config_statistics_fncall")) {
         return Util_VfsReadFile_FromBOOL(Statistics_CallGetEnabled(), pb, cb, pcbRead, cbOffset);
     }
+    if(!_wcsicmp(ctx->wszPath, L"config_trace_ring_enable")) {
+        return Util_VfsReadFile_FromBOOL(VmmTrace_RingGetEnabled(), pb, cb, pcbRead, cbOffset);
+    }
     if(!_wcsicmp(ctx->wszPath, L"config_refresh_enable")) {
         return Util_VfsReadFile_FromBOOL(ctxVmm->ThreadProcCache.fEnabled, pb, cb, pcbRead, cbOffset);
     }
@@ -75,47 +382,57 @@ NTSTATUS MStatus_Read(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _Out_ PBYTE pb, _In_ DWOR
     if(!_wcsicmp(ctx->wszPath, L"config_refresh_registry")) {
         return Util_VfsReadFile_FromDWORD(ctxVmm->ThreadProcCache.cTick_Registry, pb, cb, pcbRead, cbOffset, FALSE);
     }
+    if(!_wcsicmp(ctx->wszPath, L"config_refresh_adaptive")) {
+        return Util_VfsReadFile_FromBOOL(ctxVmm->ThreadProcCache.fAdaptive, pb, cb, pcbRead, cbOffset);
+    }
+    if(!_wcsicmp(ctx->wszPath, L"config_refresh_idle_ms")) {
+        return Util_VfsReadFile_FromDWORD(ctxVmm->ThreadProcCache.cMs_Idle, pb, cb, pcbRead, cbOffset, FALSE);
+    }
     if(!_wcsicmp(ctx->wszPath, L"statistics")) {
-        cPageReadTotal = ctxVmm->stat.page.cPrototype + ctxVmm->stat.page.cTransition + ctxVmm->stat.page.cDemandZero + ctxVmm->stat.page.cVAD + ctxVmm->stat.page.cCacheHit + ctxVmm->stat.page.cPageFile + ctxVmm->stat.page.cCompressed;
-        cPageFailTotal = ctxVmm->stat.page.cFailCacheHit + ctxVmm->stat.page.cFailVAD + ctxVmm->stat.page.cFailPageFile + ctxVmm->stat.page.cFailCompressed + ctxVmm->stat.page.cFail;
-        cchBuffer = snprintf(szBuffer, 0x800,
-            "VMM STATISTICS   (4kB PAGES / COUNTS - HEXADECIMAL)\n" \
-            "===================================================\n" \
-            "PHYSICAL MEMORY:                      \n" \
-            "  READ CACHE HIT:               %16llx\n" \
-            "  READ RETRIEVED:               %16llx\n" \
-            "  READ FAIL:                    %16llx\n" \
-            "  WRITE:                        %16llx\n" \
-            "PAGED VIRTUAL MEMORY:                 \n" \
-            "  READ SUCCESS:                 %16llx\n" \
-            "    Prototype:                  %16llx\n" \
-            "    Transition:                 %16llx\n" \
-            "    DemandZero:                 %16llx\n" \
-            "    VAD:                        %16llx\n" \
-            "    Cache:                      %16llx\n" \
-            "    PageFile:                   %16llx\n" \
-            "    Compressed:                 %16llx\n" \
-            "  READ FAIL:                    %16llx\n" \
-            "    Cache:                      %16llx\n" \
-            "    VAD:                        %16llx\n" \
-            "    PageFile:                   %16llx\n" \
-            "    Compressed:                 %16llx\n" \
-            "TLB (PAGE TABLES):                    \n" \
-            "  CACHE HIT:                    %16llx\n" \
-            "  RETRIEVED:                    %16llx\n" \
-            "  FAILED:                       %16llx\n" \
-            "PHYSICAL MEMORY REFRESH:        %16llx\n" \
-            "TLB MEMORY REFRESH:             %16llx\n" \
-            "PROCESS PARTIAL REFRESH:        %16llx\n" \
-            "PROCESS FULL REFRESH:           %16llx\n",
-            ctxVmm->stat.cPhysCacheHit, ctxVmm->stat.cPhysReadSuccess, ctxVmm->stat.cPhysReadFail, ctxVmm->stat.cPhysWrite,
-            cPageReadTotal, ctxVmm->stat.page.cPrototype, ctxVmm->stat.page.cTransition, ctxVmm->stat.page.cDemandZero, ctxVmm->stat.page.cVAD, ctxVmm->stat.page.cCacheHit, ctxVmm->stat.page.cPageFile, ctxVmm->stat.page.cCompressed,
-            cPageFailTotal, ctxVmm->stat.page.cFailCacheHit, ctxVmm->stat.page.cFailVAD, ctxVmm->stat.page.cFailPageFile, ctxVmm->stat.page.cFailCompressed,
-            ctxVmm->stat.cTlbCacheHit, ctxVmm->stat.cTlbReadSuccess, ctxVmm->stat.cTlbReadFail,
-            ctxVmm->stat.cPhysRefreshCache, ctxVmm->stat.cTlbRefreshCache, ctxVmm->stat.cProcessRefreshPartial, ctxVmm->stat.cProcessRefreshFull
-        );
+        cchBuffer = MStatus_Statistics(szBuffer, sizeof(szBuffer));
+        return Util_VfsReadFile_FromPBYTE(szBuffer, cchBuffer, pb, cb, pcbRead, cbOffset);
+    }
+    if(!_wcsicmp(ctx->wszPath, L"statistics_cache_phys")) {
+        cchBuffer = MStatus_CacheStatistics(VMM_CACHE_TAG_PHYS, szBuffer, sizeof(szBuffer));
+        return Util_VfsReadFile_FromPBYTE(szBuffer, cchBuffer, pb, cb, pcbRead, cbOffset);
+    }
+    if(!_wcsicmp(ctx->wszPath, L"statistics_cache_tlb")) {
+        cchBuffer = MStatus_CacheStatistics(VMM_CACHE_TAG_TLB, szBuffer, sizeof(szBuffer));
         return Util_VfsReadFile_FromPBYTE(szBuffer, cchBuffer, pb, cb, pcbRead, cbOffset);
     }
+    if(!_wcsicmp(ctx->wszPath, L"statistics_cache_paging")) {
+        cchBuffer = MStatus_CacheStatistics(VMM_CACHE_TAG_PAGING, szBuffer, sizeof(szBuffer));
+        return Util_VfsReadFile_FromPBYTE(szBuffer, cchBuffer, pb, cb, pcbRead, cbOffset);
+    }
+    if(!_wcsicmp(ctx->wszPath, L"statistics_device")) {
+        cchBuffer = MStatus_DeviceStatistics(szBuffer, sizeof(szBuffer));
+        return Util_VfsReadFile_FromPBYTE(szBuffer, cchBuffer, pb, cb, pcbRead, cbOffset);
+    }
+    if(!_wcsicmp(ctx->wszPath, L"statistics_refresh")) {
+        cchBuffer = MStatus_RefreshStatistics(szBuffer, sizeof(szBuffer));
+        return Util_VfsReadFile_FromPBYTE(szBuffer, cchBuffer, pb, cb, pcbRead, cbOffset);
+    }
+    if(!_wcsicmp(ctx->wszPath, L"init_stages")) {
+        cchBuffer = MStatus_InitStages(szBuffer, sizeof(szBuffer));
+        return Util_VfsReadFile_FromPBYTE(szBuffer, cchBuffer, pb, cb, pcbRead, cbOffset);
+    }
+    if(!_wcsicmp(ctx->wszPath, L"trace")) {
+        if(!(cchBuffer = VmmTrace_RingToString(NULL, 0))) {
+            return Util_VfsReadFile_FromPBYTE(NULL, 0, pb, cb, pcbRead, cbOffset);
+        }
+        if(!(pbCallStatistics = LocalAlloc(0, cchBuffer))) { return VMMDLL_STATUS_FILE_INVALID; }
+        cchBuffer = VmmTrace_RingToString(pbCallStatistics, cchBuffer);
+        nt = Util_VfsReadFile_FromPBYTE(pbCallStatistics, cchBuffer, pb, cb, pcbRead, cbOffset);
+        LocalFree(pbCallStatistics);
+        return nt;
+    }
+    if(!_wcsicmp(ctx->wszPath, L"objects")) {
+        if(!(pbCallStatistics = LocalAlloc(0, MSTATUS_OBJECTS_CCH_MAX))) { return VMMDLL_STATUS_FILE_INVALID; }
+        cchBuffer = MStatus_Objects((LPSTR)pbCallStatistics, MSTATUS_OBJECTS_CCH_MAX);
+        nt = Util_VfsReadFile_FromPBYTE(pbCallStatistics, cchBuffer, pb, cb, pcbRead, cbOffset);
+        LocalFree(pbCallStatistics);
+        return nt;
+    }
     if(!_wcsicmp(ctx->wszPath, L"statistics_fncall")) {
         Statistics_CallToString(NULL, 0, &cbCallStatistics);
         pbCallStatistics = LocalAlloc(0, cbCallStatistics);
@@ -179,6 +496,7 @@ NTSTATUS MStatus_Write(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _In_ PBYTE pb, _In_ DWOR
 {
     NTSTATUS nt;
     BOOL fEnable = FALSE;
+    DWORD dwValue;
     if(!_wcsicmp(ctx->wszPath, L"config_process_show_terminated")) {
         nt = Util_VfsWriteFile_BOOL(&fEnable, pb, cb, pcbWrite, cbOffset);
         if(nt == VMMDLL_STATUS_SUCCESS) {
@@ -195,6 +513,14 @@ NTSTATUS MStatus_Write(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _In_ PBYTE pb, _In_ DWOR
         }
         return nt;
     }
+    if(!_wcsicmp(ctx->wszPath, L"config_cache_budget_mb")) {
+        dwValue = ctxVmm->Cache.cMB_Budget;
+        nt = Util_VfsWriteFile_DWORD(&dwValue, pb, cb, pcbWrite, cbOffset, VMM_CACHE_BUDGET_MB_MIN);
+        if(nt == VMMDLL_STATUS_SUCCESS) {
+            VmmCacheSetBudget(dwValue);
+        }
+        return nt;
+    }
     if(!_wcsicmp(ctx->wszPath, L"config_paging_enable")) {
         nt = Util_VfsWriteFile_BOOL(&fEnable, pb, cb, pcbWrite, cbOffset);
         if(nt == VMMDLL_STATUS_SUCCESS) {
@@ -210,6 +536,13 @@ NTSTATUS MStatus_Write(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _In_ PBYTE pb, _In_ DWOR
         }
         return nt;
     }
+    if(!_wcsicmp(ctx->wszPath, L"config_trace_ring_enable")) {
+        nt = Util_VfsWriteFile_BOOL(&fEnable, pb, cb, pcbWrite, cbOffset);
+        if(nt == VMMDLL_STATUS_SUCCESS) {
+            VmmTrace_RingSetEnabled(fEnable);
+        }
+        return nt;
+    }
     if(!_wcsicmp(ctx->wszPath, L"config_refresh_tick_period_ms")) {
         return Util_VfsWriteFile_DWORD(&ctxVmm->ThreadProcCache.cMs_TickPeriod, pb, cb, pcbWrite, cbOffset, 50);
     }
@@ -229,6 +562,12 @@ NTSTATUS MStatus_Write(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _In_ PBYTE pb, _In_ DWOR
         VmmWinReg_Refresh();
         return Util_VfsWriteFile_DWORD(&ctxVmm->ThreadProcCache.cTick_Registry, pb, cb, pcbWrite, cbOffset, 1);
     }
+    if(!_wcsicmp(ctx->wszPath, L"config_refresh_adaptive")) {
+        return Util_VfsWriteFile_BOOL(&ctxVmm->ThreadProcCache.fAdaptive, pb, cb, pcbWrite, cbOffset);
+    }
+    if(!_wcsicmp(ctx->wszPath, L"config_refresh_idle_ms")) {
+        return Util_VfsWriteFile_DWORD(&ctxVmm->ThreadProcCache.cMs_Idle, pb, cb, pcbWrite, cbOffset, 0);
+    }
     if(!_wcsicmp(ctx->wszPath, L"config_printf_enable")) {
         return MStatus_Write_NotifyVerbosityChange(
             Util_VfsWriteFile_BOOL(&ctxMain->cfg.fVerboseDll, pb, cb, pcbWrite, cbOffset));
@@ -276,13 +615,17 @@ NTSTATUS MStatus_Write(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _In_ PBYTE pb, _In_ DWOR
 BOOL MStatus_List(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _Inout_ PHANDLE pFileList)
 {
     DWORD cbCallStatistics = 0;
+    CHAR szBuffer[0x1000];
+    LPSTR pbObjects;
     // not module root directory -> fail!
     if(ctx->wszPath[0]) { return FALSE; }
     // "root" view
     if(!ctx->pProcess) {
         VMMDLL_VfsList_AddFile(pFileList, "config_cache_enable", 1);
+        VMMDLL_VfsList_AddFile(pFileList, "config_cache_budget_mb", 8);
         VMMDLL_VfsList_AddFile(pFileList, "config_paging_enable", 1);
         VMMDLL_VfsList_AddFile(pFileList, "config_statistics_fncall", 1);
+        VMMDLL_VfsList_AddFile(pFileList, "config_trace_ring_enable", 1);
         VMMDLL_VfsList_AddFile(pFileList, "config_refresh_enable", 1);
         VMMDLL_VfsList_AddFile(pFileList, "config_refresh_tick_period_ms", 8);
         VMMDLL_VfsList_AddFile(pFileList, "config_refresh_read", 8);
@@ -290,11 +633,24 @@ BOOL MStatus_List(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _Inout_ PHANDLE pFileList)
         VMMDLL_VfsList_AddFile(pFileList, "config_refresh_proc_partial", 8);
         VMMDLL_VfsList_AddFile(pFileList, "config_refresh_proc_total", 8);
         VMMDLL_VfsList_AddFile(pFileList, "config_refresh_registry", 8);
+        VMMDLL_VfsList_AddFile(pFileList, "config_refresh_adaptive", 1);
+        VMMDLL_VfsList_AddFile(pFileList, "config_refresh_idle_ms", 8);
         VMMDLL_VfsList_AddFile(pFileList, "config_symbol_enable", 1);
         VMMDLL_VfsList_AddFile(pFileList, "config_symbolcache", strlen(ctxMain->pdb.szLocal));
         VMMDLL_VfsList_AddFile(pFileList, "config_symbolserver", strlen(ctxMain->pdb.szServer));
         VMMDLL_VfsList_AddFile(pFileList, "config_symbolserver_enable", 1);
-        VMMDLL_VfsList_AddFile(pFileList, "statistics", 1103);
+        VMMDLL_VfsList_AddFile(pFileList, "statistics", MStatus_Statistics(szBuffer, sizeof(szBuffer)));
+        VMMDLL_VfsList_AddFile(pFileList, "statistics_cache_phys", MStatus_CacheStatistics(VMM_CACHE_TAG_PHYS, szBuffer, sizeof(szBuffer)));
+        VMMDLL_VfsList_AddFile(pFileList, "statistics_cache_tlb", MStatus_CacheStatistics(VMM_CACHE_TAG_TLB, szBuffer, sizeof(szBuffer)));
+        VMMDLL_VfsList_AddFile(pFileList, "statistics_cache_paging", MStatus_CacheStatistics(VMM_CACHE_TAG_PAGING, szBuffer, sizeof(szBuffer)));
+        VMMDLL_VfsList_AddFile(pFileList, "statistics_device", MStatus_DeviceStatistics(szBuffer, sizeof(szBuffer)));
+        VMMDLL_VfsList_AddFile(pFileList, "statistics_refresh", MStatus_RefreshStatistics(szBuffer, sizeof(szBuffer)));
+        VMMDLL_VfsList_AddFile(pFileList, "init_stages", MStatus_InitStages(szBuffer, sizeof(szBuffer)));
+        VMMDLL_VfsList_AddFile(pFileList, "trace", VmmTrace_RingToString(NULL, 0));
+        if((pbObjects = LocalAlloc(0, MSTATUS_OBJECTS_CCH_MAX))) {
+            VMMDLL_VfsList_AddFile(pFileList, "objects", MStatus_Objects(pbObjects, MSTATUS_OBJECTS_CCH_MAX));
+            LocalFree(pbObjects);
+        }
         VMMDLL_VfsList_AddFile(pFileList, "config_printf_enable", 1);
         VMMDLL_VfsList_AddFile(pFileList, "config_printf_v", 1);
         VMMDLL_VfsList_AddFile(pFileList, "config_printf_vv", 1);
@@ -5,8 +5,9 @@
 //
 // Functionality includes:
 //   ProcTree - process tree listing showing parent processes - files:
-//              "proctree"
-//              "proctree-v"
+//              "proc/tree"
+//              "proc/tree-v"
+//              "proc/tree.json"
 //   Version -  operating system version information - files:
 //              "version"
 //              "version-major"
@@ -18,6 +19,7 @@
 //
 #include <ws2tcpip.h>
 #include "m_modules.h"
+#include "pluginmanager.h"
 #include "vmm.h"
 #include "vmmwin.h"
 #include "vmmwintcpip.h"
@@ -34,12 +36,16 @@ LPCSTR szMSYSINFO_NET_README =
 
 // ----------------------------------------------------------------------------
 // ProcTree functionality below:
-// The proctree.txt file is re-generated for each read. This is not efficient,
-// but the file is not read often so it should be OK.
+// The process tree is built from a PID->index hash table and per-process child
+// lists and is walked iteratively. The rendered process trees are cached by the
+// plugin manager render cache until the process list is refreshed.
 // ----------------------------------------------------------------------------
 
 #define MSYSINFO_PROCTREE_LINE_LENGTH_BASE              45
 #define MSYSINFO_PROCTREE_LINE_LENGTH_HEADER_VERBOSE    64
+#define MSYSINFO_PROCTREE_LINE_LENGTH_JSON              0x100
+#define MSYSINFO_PROCTREE_JSON_INDENT_MAX               16
+#define MSYSINFO_PROCTREE_NONE                          ((DWORD)-1)
 
 const LPSTR szMSYSINFO_WHITELIST_WINDOWS_PATHS_AND_BINARIES[] = {
     "\\Windows\\System32\\",
@@ -52,156 +58,359 @@ const LPSTR szMSYSINFO_WHITELIST_WINDOWS_PATHS_AND_BINARIES[] = {
     "\\WINDOWS\\system32\\"
 };
 
+typedef enum tdMSYSINFO_PROCTREE_FORMAT {
+    MSYSINFO_PROCTREE_FORMAT_TEXT,
+    MSYSINFO_PROCTREE_FORMAT_TEXT_VERBOSE,
+    MSYSINFO_PROCTREE_FORMAT_JSON
+} MSYSINFO_PROCTREE_FORMAT;
+
 typedef struct tdMSYSINFO_PROCTREE_ENTRY {
     DWORD dwPPID;
     DWORD dwPID;
-    BYTE iLevel;
+    DWORD iChild;           // index of first child process (or NONE)
+    DWORD iSibling;         // index of next sibling process (or NONE)
+    BOOL fParent;           // parent process exists in the process list
     BOOL fProcessed;
     PVMM_PROCESS pObProcess;
 } MSYSINFO_PROCTREE_ENTRY, *PMSYSINFO_PROCTREE_ENTRY;
 
-BOOL MSysInfo_ProcTree_ExistsUnprocessed(PMSYSINFO_PROCTREE_ENTRY pPidList, DWORD cPidList, DWORD dwPID)
+typedef struct tdMSYSINFO_PROCTREE_STACK {
+    DWORD iNext;            // index of next child process to visit (or NONE)
+    DWORD cChild;           // number of child processes visited so far
+} MSYSINFO_PROCTREE_STACK, *PMSYSINFO_PROCTREE_STACK;
+
+typedef struct tdMSYSINFO_PROCTREE_CONTEXT {
+    MSYSINFO_PROCTREE_FORMAT tpFormat;
+    DWORD cEntry;
+    DWORD dwHashMask;
+    PMSYSINFO_PROCTREE_ENTRY pEntry;
+    PMSYSINFO_PROCTREE_STACK pStack;
+    PDWORD piHash;          // PID hash table: entry index + 1 (0 = empty slot)
+    PBYTE pb;
+    DWORD cb;
+    DWORD o;
+} MSYSINFO_PROCTREE_CONTEXT, *PMSYSINFO_PROCTREE_CONTEXT;
+
+DWORD MSysInfo_ProcTree_HashSlot(_In_ PMSYSINFO_PROCTREE_CONTEXT ctxT, _In_ DWORD dwPID)
+{
+    return ((dwPID >> 2) * 0x9e3779b1) & ctxT->dwHashMask;
+}
+
+VOID MSysInfo_ProcTree_HashPush(_In_ PMSYSINFO_PROCTREE_CONTEXT ctxT, _In_ DWORD iEntry)
+{
+    DWORD dwPID = ctxT->pEntry[iEntry].dwPID;
+    DWORD iSlot = MSysInfo_ProcTree_HashSlot(ctxT, dwPID);
+    while(ctxT->piHash[iSlot]) {
+        if(ctxT->pEntry[ctxT->piHash[iSlot] - 1].dwPID == dwPID) { return; }
+        iSlot = (iSlot + 1) & ctxT->dwHashMask;
+    }
+    ctxT->piHash[iSlot] = iEntry + 1;
+}
+
+/*
+* Retrieve the index of the process entry with the given PID.
+* -- ctxT
+* -- dwPID
+* -- return = the entry index, or MSYSINFO_PROCTREE_NONE if not found.
+*/
+DWORD MSysInfo_ProcTree_HashGet(_In_ PMSYSINFO_PROCTREE_CONTEXT ctxT, _In_ DWORD dwPID)
+{
+    DWORD iSlot = MSysInfo_ProcTree_HashSlot(ctxT, dwPID);
+    while(ctxT->piHash[iSlot]) {
+        if(ctxT->pEntry[ctxT->piHash[iSlot] - 1].dwPID == dwPID) {
+            return ctxT->piHash[iSlot] - 1;
+        }
+        iSlot = (iSlot + 1) & ctxT->dwHashMask;
+    }
+    return MSYSINFO_PROCTREE_NONE;
+}
+
+VOID MSysInfo_ProcTree_Printf(_Inout_ PMSYSINFO_PROCTREE_CONTEXT ctxT, _In_z_ _Printf_format_string_ LPCSTR szFormat, ...)
+{
+    int cch;
+    va_list arglist;
+    if(ctxT->o + 1 >= ctxT->cb) { return; }
+    va_start(arglist, szFormat);
+    cch = vsnprintf(ctxT->pb + ctxT->o, ctxT->cb - ctxT->o, szFormat, arglist);
+    va_end(arglist);
+    if(cch > 0) {
+        ctxT->o = min(ctxT->cb - 1, ctxT->o + (DWORD)cch);
+    }
+}
+
+/*
+* Append a JSON string member (preceded by a comma) to the output. Quotes and
+* backslashes are escaped; control and non-ascii characters are \u escaped.
+* -- ctxT
+* -- szKey
+* -- sz = the string value (NULL is rendered as an empty string).
+* -- cch = max number of chars in sz.
+*/
+VOID MSysInfo_ProcTree_JsonString(_Inout_ PMSYSINFO_PROCTREE_CONTEXT ctxT, _In_ LPCSTR szKey, _In_opt_ LPCSTR sz, _In_ DWORD cch)
 {
     DWORD i;
-    for(i = 0; i < cPidList; i++) {
-        if(pPidList[i].dwPID == dwPID) {
-            return !pPidList[i].fProcessed;
+    BYTE ch;
+    MSysInfo_ProcTree_Printf(ctxT, ",\"%s\":\"", szKey);
+    for(i = 0; sz && (i < cch) && (ch = sz[i]); i++) {
+        if(ctxT->o + 8 >= ctxT->cb) { break; }
+        if((ch == '"') || (ch == '\\')) {
+            ctxT->pb[ctxT->o++] = '\\';
+            ctxT->pb[ctxT->o++] = ch;
+        } else if((ch < 0x20) || (ch >= 0x7f)) {
+            ctxT->o += snprintf(ctxT->pb + ctxT->o, 7, "\\u%04x", ch);
+        } else {
+            ctxT->pb[ctxT->o++] = ch;
         }
     }
-    return FALSE;
+    MSysInfo_ProcTree_Printf(ctxT, "\"");
 }
 
-DWORD MSysInfo_ProcTree_ProcessItems(_In_ PMSYSINFO_PROCTREE_ENTRY pProcessEntry, _In_ PMSYSINFO_PROCTREE_ENTRY pList, _In_ DWORD cList, _In_ PBYTE pb, _In_ DWORD cb, _In_ BYTE iLevel, _In_ BOOL fVerbose)
+/*
+* Render a process when it's visited by the tree walk.
+* -- ctxT
+* -- pe
+* -- iLevel = the tree depth of the process.
+* -- fFirst = the process is the first child of its parent (or first root).
+*/
+VOID MSysInfo_ProcTree_Enter(_Inout_ PMSYSINFO_PROCTREE_CONTEXT ctxT, _Inout_ PMSYSINFO_PROCTREE_ENTRY pe, _In_ DWORD iLevel, _In_ BOOL fFirst)
 {
     LPCSTR szINDENT[] = { "-", "--", "---", "----", "-----", "------", "-------", "--------", "--------+" };
-    DWORD i, o = 0;
+    PVMM_PROCESS pProcess = pe->pObProcess;
+    PVMMWIN_USER_PROCESS_PARAMETERS pu = &pProcess->pObPersistent->UserProcessParams;
     BOOL fWinNativeProc, fStateTerminated;
-    if((cb > 0x01000000) || (cb < 0x00040000)) {
-        vmmprintf_fn("WARNING: BUFFER MAY BE TOO SMALL - SHOULD NOT HAPPEN! %i\n", cb);
-        return 0;
-    }
-    fStateTerminated = (pProcessEntry->pObProcess->dwState != 0);
-    fWinNativeProc = (pProcessEntry->dwPID == 4) || (pProcessEntry->dwPPID == 4);
+    DWORD i;
+    pe->fProcessed = TRUE;
+    fStateTerminated = (pProcess->dwState != 0);
+    fWinNativeProc = (pe->dwPID == 4) || (pe->dwPPID == 4);
     for(i = 0; !fWinNativeProc && (i < (sizeof(szMSYSINFO_WHITELIST_WINDOWS_PATHS_AND_BINARIES) / sizeof(LPSTR))); i++) {
-        fWinNativeProc = (NULL != strstr(pProcessEntry->pObProcess->pObPersistent->szPathKernel, szMSYSINFO_WHITELIST_WINDOWS_PATHS_AND_BINARIES[i]));
-    }
-    o = snprintf(
-            pb,
-            cb,
-            "%s %-15s%*s%6i %6i   %c%c %s\n",
-            szINDENT[min(8, iLevel)],
-            pProcessEntry->pObProcess->szName,
-            8 - min(7, iLevel),
+        fWinNativeProc = (NULL != strstr(pProcess->pObPersistent->szPathKernel, szMSYSINFO_WHITELIST_WINDOWS_PATHS_AND_BINARIES[i]));
+    }
+    if(ctxT->tpFormat == MSYSINFO_PROCTREE_FORMAT_JSON) {
+        MSysInfo_ProcTree_Printf(
+            ctxT,
+            "%s%*s{\"pid\":%u,\"ppid\":%u",
+            fFirst ? "\n" : ",\n",
+            (min(MSYSINFO_PROCTREE_JSON_INDENT_MAX, iLevel) + 1) * 2,
             "",
-            pProcessEntry->dwPID,
-            pProcessEntry->dwPPID,
-            fStateTerminated ? 'T' : ' ',
-            fWinNativeProc ? ' ' : '*',
-            fVerbose ? pProcessEntry->pObProcess->pObPersistent->szPathKernel : ""
+            pe->dwPID,
+            pe->dwPPID
         );
-    if(fVerbose) {
-        if(pProcessEntry->pObProcess->pObPersistent->UserProcessParams.szImagePathName) {
-            o += snprintf(pb + o, cb - o, "%44s%-*s\n", "", 
-                pProcessEntry->pObProcess->pObPersistent->UserProcessParams.cchImagePathName, 
-                pProcessEntry->pObProcess->pObPersistent->UserProcessParams.szImagePathName);
+        MSysInfo_ProcTree_JsonString(ctxT, "name", pProcess->szName, sizeof(pProcess->szName));
+        MSysInfo_ProcTree_Printf(ctxT, ",\"state\":%u,\"terminated\":%s,\"native\":%s", pProcess->dwState, fStateTerminated ? "true" : "false", fWinNativeProc ? "true" : "false");
+        MSysInfo_ProcTree_JsonString(ctxT, "path", pProcess->pObPersistent->szPathKernel, pProcess->pObPersistent->cchPathKernel);
+        MSysInfo_ProcTree_JsonString(ctxT, "image", pu->szImagePathName, pu->cchImagePathName);
+        MSysInfo_ProcTree_JsonString(ctxT, "cmdline", pu->szCommandLine, pu->cchCommandLine);
+        MSysInfo_ProcTree_Printf(ctxT, ",\"children\":[");
+        return;
+    }
+    MSysInfo_ProcTree_Printf(
+        ctxT,
+        "%s %-15s%*s%6i %6i   %c%c %s\n",
+        szINDENT[min(8, iLevel)],
+        pProcess->szName,
+        8 - min(7, iLevel),
+        "",
+        pe->dwPID,
+        pe->dwPPID,
+        fStateTerminated ? 'T' : ' ',
+        fWinNativeProc ? ' ' : '*',
+        (ctxT->tpFormat == MSYSINFO_PROCTREE_FORMAT_TEXT_VERBOSE) ? pProcess->pObPersistent->szPathKernel : ""
+    );
+    if(ctxT->tpFormat == MSYSINFO_PROCTREE_FORMAT_TEXT_VERBOSE) {
+        if(pu->szImagePathName) {
+            MSysInfo_ProcTree_Printf(ctxT, "%44s%-*s\n", "", pu->cchImagePathName, pu->szImagePathName);
+        }
+        if(pu->szCommandLine) {
+            MSysInfo_ProcTree_Printf(ctxT, "%44s%-*s\n", "", pu->cchCommandLine, pu->szCommandLine);
         }
-        if(pProcessEntry->pObProcess->pObPersistent->UserProcessParams.szCommandLine) {
-            o += snprintf(pb + o, cb - o, "%44s%-*s\n", "", 
-                pProcessEntry->pObProcess->pObPersistent->UserProcessParams.cchCommandLine,
-                pProcessEntry->pObProcess->pObPersistent->UserProcessParams.szCommandLine);
+        MSysInfo_ProcTree_Printf(ctxT, "\n");
+    }
+}
+
+/*
+* Finish the rendering of a process once all its child processes are visited.
+* -- ctxT
+* -- iLevel = the tree depth of the process.
+* -- cChild = the number of rendered child processes.
+*/
+VOID MSysInfo_ProcTree_Leave(_Inout_ PMSYSINFO_PROCTREE_CONTEXT ctxT, _In_ DWORD iLevel, _In_ DWORD cChild)
+{
+    if(ctxT->tpFormat != MSYSINFO_PROCTREE_FORMAT_JSON) { return; }
+    if(cChild) {
+        MSysInfo_ProcTree_Printf(ctxT, "\n%*s]}", (min(MSYSINFO_PROCTREE_JSON_INDENT_MAX, iLevel) + 1) * 2, "");
+    } else {
+        MSysInfo_ProcTree_Printf(ctxT, "]}");
+    }
+}
+
+/*
+* Walk and render the not yet processed sub-tree starting at iRoot depth-first.
+* The walk uses an explicit stack so deep (or looped) parent chains won't
+* exhaust the thread stack.
+* -- ctxT
+* -- iRoot
+* -- pcRoot = number of walked root processes (incremented).
+*/
+VOID MSysInfo_ProcTree_Walk(_Inout_ PMSYSINFO_PROCTREE_CONTEXT ctxT, _In_ DWORD iRoot, _Inout_ PDWORD pcRoot)
+{
+    PMSYSINFO_PROCTREE_STACK ps;
+    DWORD i, iLevel = 0;
+    MSysInfo_ProcTree_Enter(ctxT, ctxT->pEntry + iRoot, 0, !(*pcRoot)++);
+    ctxT->pStack[0].iNext = ctxT->pEntry[iRoot].iChild;
+    ctxT->pStack[0].cChild = 0;
+    while(TRUE) {
+        ps = ctxT->pStack + iLevel;
+        i = ps->iNext;
+        while((i != MSYSINFO_PROCTREE_NONE) && ctxT->pEntry[i].fProcessed) {
+            i = ctxT->pEntry[i].iSibling;
         }
-        o += snprintf(pb + o, cb - o, "\n");
-    }
-    pProcessEntry->iLevel = iLevel;
-    pProcessEntry->fProcessed = TRUE;
-    // 2: fetch and process sub-items (child processes)
-    for(i = 0; i < cList; i++) {
-        if(pList[i].fProcessed) { continue; }
-        if(pList[i].dwPPID == pProcessEntry->dwPID) {
-            o += MSysInfo_ProcTree_ProcessItems(pList + i, pList, cList, pb + o, cb - o, iLevel + 1, fVerbose);
+        if(i == MSYSINFO_PROCTREE_NONE) {
+            MSysInfo_ProcTree_Leave(ctxT, iLevel, ps->cChild);
+            if(!iLevel) { return; }
+            iLevel--;
+            continue;
         }
+        ps->iNext = ctxT->pEntry[i].iSibling;
+        MSysInfo_ProcTree_Enter(ctxT, ctxT->pEntry + i, iLevel + 1, !ps->cChild++);
+        iLevel++;
+        ctxT->pStack[iLevel].iNext = ctxT->pEntry[i].iChild;
+        ctxT->pStack[iLevel].cChild = 0;
     }
-    return o;
 }
 
 int MSysInfo_ProcTree_CmpSort(PMSYSINFO_PROCTREE_ENTRY a, PMSYSINFO_PROCTREE_ENTRY b)
 {
-    if(a->dwPPID - b->dwPPID) {
-        return a->dwPID - b->dwPID;
+    if(a->dwPID != b->dwPID) {
+        return (a->dwPID < b->dwPID) ? -1 : 1;
     }
-    return a->dwPPID - b->dwPPID;
+    return 0;
 }
 
 _Success_(return)
-BOOL MSysInfo_ProcTree(_In_ BOOL fVerbose, _Out_ PBYTE *ppb, _Out_ PDWORD pcb)
+BOOL MSysInfo_ProcTree(_In_ MSYSINFO_PROCTREE_FORMAT tpFormat, _Out_ PBYTE *ppb, _Out_ PDWORD pcb)
 {
     BOOL fResult = FALSE;
+    MSYSINFO_PROCTREE_CONTEXT ctxT = { 0 };
+    PMSYSINFO_PROCTREE_ENTRY pe;
+    PVMMWIN_USER_PROCESS_PARAMETERS pu;
     PVMM_PROCESS pObProcess = NULL;
-    PMSYSINFO_PROCTREE_ENTRY pPidEntry, pPidList = NULL;
-    DWORD iPidList = 0, i;
-    SIZE_T cPidList = 0;
-    PBYTE pb;
-    DWORD cb = 0x00100000, o = 0;   // 1MB should be enough to hold any process list ...
-    // 1: retrieve process information into "pid list"
-    VmmProcessListPIDs(NULL, &cPidList, VMM_FLAG_PROCESS_SHOW_TERMINATED);
-    if(!cPidList) { return FALSE; }
-    if(!(pPidList = LocalAlloc(LMEM_ZEROINIT, cPidList * sizeof(MSYSINFO_PROCTREE_ENTRY)))) { return FALSE; }
-    while((iPidList < cPidList) && (pObProcess = VmmProcessGetNext(pObProcess, VMM_FLAG_PROCESS_SHOW_TERMINATED))) {
-        pPidEntry = pPidList + iPidList++;
-        pPidEntry->dwPID = pObProcess->dwPID;
-        pPidEntry->dwPPID = pObProcess->dwPPID;
-        pPidEntry->pObProcess = (PVMM_PROCESS)Ob_INCREF(pObProcess);    // INCREF process object and assign to array
-    }
-    Ob_DECREF_NULL(&pObProcess);
-    pb = LocalAlloc(0, cb);
-    if(pb) {
-        // 3: iterate over top level items - processes with no parent
-        qsort(pPidList, cPidList, sizeof(MSYSINFO_PROCTREE_ENTRY), (int(*)(const void *, const void *))MSysInfo_ProcTree_CmpSort);
-        o = snprintf(pb, cb, fVerbose ?
-            "  Process                   Pid Parent Flag Path / Command Line\n---------------------------------------------------------------\n" :
-            "  Process                   Pid Parent Flag \n--------------------------------------------\n");
-        // 3.1 process items
-        for(i = 0; i < cPidList; i++) {
-            pPidEntry = pPidList + i;
-            if(pPidEntry->fProcessed) { continue; }
-            if(MSysInfo_ProcTree_ExistsUnprocessed(pPidList, (DWORD)cPidList, pPidEntry->dwPPID)) { continue; }
-            o += MSysInfo_ProcTree_ProcessItems(pPidEntry, pPidList, (DWORD)cPidList, pb + o, cb - o, 0, fVerbose);
+    SIZE_T cProcess = 0;
+    QWORD cbBuffer = 0x1000;
+    DWORD i, iParent, cHash, cRoot = 0;
+    // 1: allocate entries, walk stack and PID hash table
+    VmmProcessListPIDs(NULL, &cProcess, VMM_FLAG_PROCESS_SHOW_TERMINATED);
+    if(!cProcess || (cProcess > 0x00100000)) { return FALSE; }
+    for(cHash = 0x100; cHash < 2 * cProcess; cHash <<= 1);
+    ctxT.tpFormat = tpFormat;
+    ctxT.dwHashMask = cHash - 1;
+    if(!(ctxT.pEntry = LocalAlloc(LMEM_ZEROINIT, cProcess * (sizeof(MSYSINFO_PROCTREE_ENTRY) + sizeof(MSYSINFO_PROCTREE_STACK)) + cHash * sizeof(DWORD)))) { return FALSE; }
+    ctxT.pStack = (PMSYSINFO_PROCTREE_STACK)(ctxT.pEntry + cProcess);
+    ctxT.piHash = (PDWORD)(ctxT.pStack + cProcess);
+    // 2: retrieve process information and the required output buffer size
+    while((ctxT.cEntry < cProcess) && (pObProcess = VmmProcessGetNext(pObProcess, VMM_FLAG_PROCESS_SHOW_TERMINATED))) {
+        pe = ctxT.pEntry + ctxT.cEntry++;
+        pe->dwPID = pObProcess->dwPID;
+        pe->dwPPID = pObProcess->dwPPID;
+        pe->iChild = MSYSINFO_PROCTREE_NONE;
+        pe->iSibling = MSYSINFO_PROCTREE_NONE;
+        pe->pObProcess = (PVMM_PROCESS)Ob_INCREF(pObProcess);    // INCREF process object and assign to array
+        if(tpFormat == MSYSINFO_PROCTREE_FORMAT_TEXT) {
+            cbBuffer += 2 * MSYSINFO_PROCTREE_LINE_LENGTH_BASE;
+            continue;
         }
-        // 3.2 process remaining items (in case of PPID-loop which ideally should not happen)
-        //     the remaining items are processed without regards for order.
-        for(i = 0; i < cPidList; i++) {
-            pPidEntry = pPidList + i;
-            if(pPidEntry->fProcessed) { continue; }
-            o += MSysInfo_ProcTree_ProcessItems(pPidEntry, pPidList, (DWORD)cPidList, pb + o, cb - o, 0, fVerbose);
+        pu = VmmWin_UserProcessParameters_Get(pObProcess);
+        i = pObProcess->pObPersistent->cchPathKernel + (pu->szImagePathName ? pu->cchImagePathName : 0) + (pu->szCommandLine ? pu->cchCommandLine : 0);
+        if(tpFormat == MSYSINFO_PROCTREE_FORMAT_JSON) {
+            cbBuffer += MSYSINFO_PROCTREE_LINE_LENGTH_JSON + 6ULL * (sizeof(pObProcess->szName) + i);
+        } else {
+            cbBuffer += 4 * MSYSINFO_PROCTREE_LINE_LENGTH_BASE + i;
         }
-        // 4: finish!
-        *ppb = pb;
-        *pcb = o;
-        fResult = TRUE;
     }
-    for(i = 0; i < cPidList; i++) {
-        Ob_DECREF(pPidList[i].pObProcess);  // DECREF array assigned process object.
+    Ob_DECREF_NULL(&pObProcess);
+    if(cbBuffer > 0x40000000) { goto fail; }
+    // 3: sort on PID and index the processes in the PID hash table
+    qsort(ctxT.pEntry, ctxT.cEntry, sizeof(MSYSINFO_PROCTREE_ENTRY), (int(*)(const void *, const void *))MSysInfo_ProcTree_CmpSort);
+    for(i = 0; i < ctxT.cEntry; i++) {
+        MSysInfo_ProcTree_HashPush(&ctxT, i);
+    }
+    // 4: link child processes to parents - iterate backwards so that child
+    //    lists are ordered on PID
+    for(i = ctxT.cEntry; i > 0; i--) {
+        pe = ctxT.pEntry + i - 1;
+        iParent = MSysInfo_ProcTree_HashGet(&ctxT, pe->dwPPID);
+        if((iParent == MSYSINFO_PROCTREE_NONE) || (iParent == i - 1)) { continue; }
+        pe->fParent = TRUE;
+        pe->iSibling = ctxT.pEntry[iParent].iChild;
+        ctxT.pEntry[iParent].iChild = i - 1;
+    }
+    // 5: render
+    ctxT.cb = (DWORD)cbBuffer;
+    if(!(ctxT.pb = LocalAlloc(0, ctxT.cb))) { goto fail; }
+    if(tpFormat == MSYSINFO_PROCTREE_FORMAT_JSON) {
+        MSysInfo_ProcTree_Printf(&ctxT, "[");
+    } else if(tpFormat == MSYSINFO_PROCTREE_FORMAT_TEXT_VERBOSE) {
+        MSysInfo_ProcTree_Printf(&ctxT, "  Process                   Pid Parent Flag Path / Command Line\n---------------------------------------------------------------\n");
+    } else {
+        MSysInfo_ProcTree_Printf(&ctxT, "  Process                   Pid Parent Flag \n--------------------------------------------\n");
+    }
+    // 5.1 process top level items - processes with no parent
+    for(i = 0; i < ctxT.cEntry; i++) {
+        if(ctxT.pEntry[i].fParent) { continue; }
+        MSysInfo_ProcTree_Walk(&ctxT, i, &cRoot);
     }
-    LocalFree(pPidList);
+    // 5.2 process remaining items (in case of PPID-loop which ideally should not happen)
+    for(i = 0; i < ctxT.cEntry; i++) {
+        if(ctxT.pEntry[i].fProcessed) { continue; }
+        MSysInfo_ProcTree_Walk(&ctxT, i, &cRoot);
+    }
+    if(tpFormat == MSYSINFO_PROCTREE_FORMAT_JSON) {
+        MSysInfo_ProcTree_Printf(&ctxT, "\n]\n");
+    }
+    // 6: finish!
+    *ppb = ctxT.pb;
+    *pcb = ctxT.o;
+    fResult = TRUE;
+fail:
+    for(i = 0; i < ctxT.cEntry; i++) {
+        Ob_DECREF(ctxT.pEntry[i].pObProcess);  // DECREF array assigned process object.
+    }
+    LocalFree(ctxT.pEntry);
     return fResult;
 }
 
-NTSTATUS MSysInfo_Read_ProcTree(_In_ LPWSTR wszPath, _Out_ PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbRead, _In_ QWORD cbOffset)
+_Success_(return)
+BOOL MSysInfo_Render_ProcTree(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _In_opt_ PVOID pvObGeneration, _Out_ PBYTE *ppb, _Out_ PDWORD pcb)
+{
+    return MSysInfo_ProcTree(MSYSINFO_PROCTREE_FORMAT_TEXT, ppb, pcb);
+}
+
+_Success_(return)
+BOOL MSysInfo_Render_ProcTreeVerbose(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _In_opt_ PVOID pvObGeneration, _Out_ PBYTE *ppb, _Out_ PDWORD pcb)
+{
+    return MSysInfo_ProcTree(MSYSINFO_PROCTREE_FORMAT_TEXT_VERBOSE, ppb, pcb);
+}
+
+_Success_(return)
+BOOL MSysInfo_Render_ProcTreeJson(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _In_opt_ PVOID pvObGeneration, _Out_ PBYTE *ppb, _Out_ PDWORD pcb)
+{
+    return MSysInfo_ProcTree(MSYSINFO_PROCTREE_FORMAT_JSON, ppb, pcb);
+}
+
+/*
+* Read the process tree files. The rendered process trees are cached by the
+* render cache until the process list is refreshed.
+*/
+NTSTATUS MSysInfo_Read_ProcTree(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _In_ LPWSTR wszPath, _Out_ PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbRead, _In_ QWORD cbOffset)
 {
-    NTSTATUS nt;
-    DWORD cbFile = 0;
-    PBYTE pbFile = NULL;
+    QWORD qwGeneration = ctxVmm->stat.cProcessRefreshPartial + ctxVmm->stat.cProcessRefreshFull;
     if(!wcscmp(wszPath, L"tree")) {
-        MSysInfo_ProcTree(FALSE, &pbFile, &cbFile);
-        nt = Util_VfsReadFile_FromPBYTE(pbFile, cbFile, pb, cb, pcbRead, cbOffset);
-        LocalFree(pbFile);
-        return nt;
+        return PluginManager_RenderRead(ctx, NULL, qwGeneration, MSysInfo_Render_ProcTree, pb, cb, pcbRead, cbOffset);
     }
     if(!wcscmp(wszPath, L"tree-v")) {
-        MSysInfo_ProcTree(TRUE, &pbFile, &cbFile);
-        nt = Util_VfsReadFile_FromPBYTE(pbFile, cbFile, pb, cb, pcbRead, cbOffset);
-        LocalFree(pbFile);
-        return nt;
+        return PluginManager_RenderRead(ctx, NULL, qwGeneration, MSysInfo_Render_ProcTreeVerbose, pb, cb, pcbRead, cbOffset);
+    }
+    if(!wcscmp(wszPath, L"tree.json")) {
+        return PluginManager_RenderRead(ctx, NULL, qwGeneration, MSysInfo_Render_ProcTreeJson, pb, cb, pcbRead, cbOffset);
     }
     return VMMDLL_STATUS_FILE_INVALID;
 }
@@ -230,6 +439,8 @@ BOOL MSysInfo_List_ProcTree(_Inout_ PHANDLE pFileList)
         cbProcTree = MSYSINFO_PROCTREE_LINE_LENGTH_HEADER_VERBOSE * 2;
         VmmProcessActionForeachParallel(&cbProcTree, 5, NULL, MSysInfo_List_ProcTree_ProcessUserParams_CallbackAction);
         VMMDLL_VfsList_AddFile(pFileList, "tree-v", cbProcTree);
+        cbProcTree = 2 * cbProcTree + (DWORD)cProcess * MSYSINFO_PROCTREE_LINE_LENGTH_JSON;
+        VMMDLL_VfsList_AddFile(pFileList, "tree.json", cbProcTree);
     }
     return TRUE;
 }
@@ -258,86 +469,152 @@ VOID MSysInfo_ObNetContext_CallbackRefCount1(PMSYSINFO_OB_NET_CONTEXT pOb)
     LocalFree(pOb->pbFileVerbose);
 }
 
+#define MSYSINFO_NET_LINE_CCHN      0x100
+#define MSYSINFO_NET_LINE_CCHV      0x400
+
+typedef struct tdMSYSINFO_NET_LINE {
+    VMMWIN_TCPIP_ENTRY e;           // entry the lines were formatted from (reserved fields excluded from compare)
+    DWORD cchN;
+    DWORD cchV;
+    CHAR sz[];                      // normal line followed by verbose line (not NULL terminated)
+} MSYSINFO_NET_LINE, *PMSYSINFO_NET_LINE;
+
+POB_MAP gpm_MSYSINFO_NET_LINES = NULL;  // formatted lines (LocalAlloc) keyed by vaTcpE - protected by ctxVmm->TcpIp.LockUpdate
+
+/*
+* Format a single network connection into a human readable normal and verbose
+* line. The result is allocated and should be LocalFree'd (or put into a map).
+* -- pE
+* -- return
+*/
+PMSYSINFO_NET_LINE MSysInfo_GetNetContext_FormatLine(_In_ PVMMWIN_TCPIP_ENTRY pE)
+{
+    int cch;
+    DWORD dwIpVersion, cchSrc, cchDst, cchN, cchV;
+    CHAR sz[64], szSrc[64], szDst[64], szTime[MAX_PATH];
+    CHAR szN[MSYSINFO_NET_LINE_CCHN], szV[MSYSINFO_NET_LINE_CCHV];
+    PMSYSINFO_NET_LINE pLine;
+    PVMM_PROCESS pObProcess = NULL;
+    pObProcess = VmmProcessGet(pE->dwPID);
+    dwIpVersion = (pE->AF.wAF == AF_INET) ? 4 : ((pE->AF.wAF == AF_INET6) ? 6 : 0);
+    // format src addr
+    if(pE->Src.fValid) {
+        sz[0] = 0;
+        InetNtopA(pE->AF.wAF, pE->Src.pbA, sz, sizeof(sz));
+    } else {
+        strcpy_s(sz, sizeof(sz), "***");
+    }
+    cchSrc = snprintf(szSrc, sizeof(szSrc), ((dwIpVersion == 6) ? "[%s]:%i" : "%s:%i"), sz, pE->Src.wPort);
+    // format dst addr
+    if(pE->Dst.fValid) {
+        sz[0] = 0;
+        InetNtopA(pE->AF.wAF, pE->Dst.pbA, sz, sizeof(sz));
+    } else {
+        strcpy_s(sz, sizeof(sz), "***");
+    }
+    cchDst = snprintf(szDst, sizeof(szDst), ((dwIpVersion == 6) ? "[%s]:%i" : "%s:%i"), sz, pE->Dst.wPort);
+    // get time
+    Util_FileTime2String((PFILETIME)&pE->qwTime, szTime);
+    // print normal
+    cch = snprintf(
+        szN,
+        sizeof(szN),
+        "TCPv%i  %-*s  %-*s  %-11s %6i  %s\n",
+        dwIpVersion,
+        max(28, cchSrc),
+        szSrc,
+        max(28, cchDst),
+        szDst,
+        pE->szState,
+        pE->dwPID,
+        (pObProcess ? pObProcess->szName : "***")
+    );
+    cchN = (cch < 0) ? 0 : min((DWORD)cch, sizeof(szN) - 1);
+    // print verbose
+    cch = snprintf(
+        szV,
+        sizeof(szV),
+        "TCPv%i  %-*s  %-*s  %-11s  %s %6i  %-15s %s\n",
+        dwIpVersion,
+        max(28, cchSrc),
+        szSrc,
+        max(28, cchDst),
+        szDst,
+        pE->szState,
+        szTime,
+        pE->dwPID,
+        (pObProcess ? pObProcess->szName : "***"),
+        (pObProcess ? pObProcess->pObPersistent->szPathKernel : "***")
+    );
+    cchV = (cch < 0) ? 0 : min((DWORD)cch, sizeof(szV) - 1);
+    Ob_DECREF(pObProcess);
+    if(!(pLine = LocalAlloc(LMEM_ZEROINIT, sizeof(MSYSINFO_NET_LINE) + cchN + cchV))) { return NULL; }
+    memcpy(&pLine->e, pE, offsetof(VMMWIN_TCPIP_ENTRY, _Reserved_vaINET_Addr));
+    pLine->cchN = cchN;
+    pLine->cchV = cchV;
+    memcpy(pLine->sz, szN, cchN);
+    memcpy(pLine->sz + cchN, szV, cchV);
+    return pLine;
+}
+
 /*
-* Format network connection into into human readable text.
+* Format network connections into into human readable text. The text is built
+* incrementally - lines formatted for an unchanged connection in the previous
+* run are re-used and only new or changed connections are formatted.
+* NB! must be called with ctxVmm->TcpIp.LockUpdate held.
 */
 _Success_(return)
 BOOL MSysInfo_GetNetContext_ToString(_In_ PVMMWIN_TCPIP_ENTRY pTcpE, _In_ DWORD cTcpE, _Out_ PBYTE* ppbFileN, _Out_ PDWORD pcbFileN, _Out_ PBYTE* ppbFileV, _Out_ PDWORD pcbFileV)
 {
     BOOL fResult = FALSE;
     PVMMWIN_TCPIP_ENTRY pE;
-    DWORD i, oN = 0, oV = 0, dwIpVersion;
-    DWORD cbN = 0x00100000, cbV = 0x00100000;
+    DWORD i, oN = 0, oV = 0, cbN = 0, cbV = 0;
     PBYTE pbN = NULL, pbV = NULL;
-    PVMM_PROCESS pObProcess = NULL;
-    DWORD cchSrc, cchDst;
-    CHAR sz[64], szSrc[64], szDst[64], szTime[MAX_PATH];
-    if(!(pbN = LocalAlloc(0, cbN))) { goto fail; }
-    if(!(pbV = LocalAlloc(0, cbV))) { goto fail; }
-
+    PMSYSINFO_NET_LINE pLine, *ppLines = NULL;
+    POB_MAP pmLines = NULL;
+    if(!(pmLines = ObMap_New(OB_MAP_FLAGS_OBJECT_LOCALFREE))) { goto fail; }
+    if(!(ppLines = LocalAlloc(LMEM_ZEROINIT, (cTcpE + 1ULL) * sizeof(PMSYSINFO_NET_LINE)))) { goto fail; }
+    // 1: fetch unchanged lines from previous run or format new lines
     for(i = 0; i < cTcpE; i++) {
         pE = pTcpE + i;
-        pObProcess = VmmProcessGet(pE->dwPID);
-        dwIpVersion = (pE->AF.wAF == AF_INET) ? 4 : ((pE->AF.wAF == AF_INET6) ? 6 : 0);
-        // format src addr
-        if(pE->Src.fValid) {
-            sz[0] = 0;
-            InetNtopA(pE->AF.wAF, pE->Src.pbA, sz, sizeof(sz));
-        } else {
-            strcpy_s(sz, sizeof(sz), "***");
+        pLine = ObMap_RemoveByKey(gpm_MSYSINFO_NET_LINES, pE->vaTcpE);
+        if(pLine && memcmp(&pLine->e, pE, offsetof(VMMWIN_TCPIP_ENTRY, _Reserved_vaINET_Addr))) {
+            LocalFree(pLine);
+            pLine = NULL;
         }
-        cchSrc = snprintf(szSrc, sizeof(szSrc), ((dwIpVersion == 6) ? "[%s]:%i" : "%s:%i"), sz, pE->Src.wPort);
-        // format dst addr
-        if(pE->Dst.fValid) {
-            sz[0] = 0;
-            InetNtopA(pE->AF.wAF, pE->Dst.pbA, sz, sizeof(sz));
-        } else {
-            strcpy_s(sz, sizeof(sz), "***");
+        if(!pLine && !(pLine = MSysInfo_GetNetContext_FormatLine(pE))) { continue; }
+        if(!ObMap_Push(pmLines, pE->vaTcpE, pLine)) {
+            LocalFree(pLine);
+            continue;
         }
-        cchDst = snprintf(szDst, sizeof(szDst), ((dwIpVersion == 6) ? "[%s]:%i" : "%s:%i"), sz, pE->Dst.wPort);
-        // get time
-        Util_FileTime2String((PFILETIME)&pE->qwTime, szTime);
-        // print normal
-        oN += snprintf(
-            pbN + oN,
-            (QWORD)cbN + oN,
-            "TCPv%i  %-*s  %-*s  %-11s %6i  %s\n",
-            dwIpVersion,
-            max(28, cchSrc),
-            szSrc,
-            max(28, cchDst),
-            szDst,
-            pE->szState,
-            pE->dwPID,
-            (pObProcess ? pObProcess->szName : "***")
-        );
-        // print verbose
-        oV += snprintf(
-            pbV + oV,
-            (QWORD)cbV + oV,
-            "TCPv%i  %-*s  %-*s  %-11s  %s %6i  %-15s %s\n",
-            dwIpVersion,
-            max(28, cchSrc),
-            szSrc,
-            max(28, cchDst),
-            szDst,
-            pE->szState,
-            szTime,
-            pE->dwPID,
-            (pObProcess ? pObProcess->szName : "***"),
-            (pObProcess ? pObProcess->pObPersistent->szPathKernel : "***")
-        );
-        Ob_DECREF_NULL(&pObProcess);
+        ppLines[i] = pLine;
+        cbN += pLine->cchN;
+        cbV += pLine->cchV;
+    }
+    // 2: concatenate lines into properly sized buffers
+    if(!(pbN = LocalAlloc(0, max(1, cbN)))) { goto fail; }
+    if(!(pbV = LocalAlloc(0, max(1, cbV)))) { goto fail; }
+    for(i = 0; i < cTcpE; i++) {
+        if(!(pLine = ppLines[i])) { continue; }
+        memcpy(pbN + oN, pLine->sz, pLine->cchN);
+        memcpy(pbV + oV, pLine->sz + pLine->cchN, pLine->cchV);
+        oN += pLine->cchN;
+        oV += pLine->cchV;
     }
-    // move result into properly sized buffers
-    if(!(*ppbFileN = LocalAlloc(0, oN))) { goto fail; }
-    if(!(*ppbFileV = LocalAlloc(0, oV))) { goto fail; }
-    memcpy(*ppbFileN, pbN, oN);
-    memcpy(*ppbFileV, pbV, oV);
+    // 3: replace line cache - lines of closed connections are discarded
+    Ob_DECREF(gpm_MSYSINFO_NET_LINES);
+    gpm_MSYSINFO_NET_LINES = pmLines;
+    pmLines = NULL;
+    *ppbFileN = pbN;
+    *ppbFileV = pbV;
     *pcbFileN = oN;
     *pcbFileV = oV;
+    pbN = NULL;
+    pbV = NULL;
     fResult = TRUE;
 fail:
+    Ob_DECREF(pmLines);
+    LocalFree(ppLines);
     LocalFree(pbN);
     LocalFree(pbV);
     return fResult;
@@ -432,7 +709,7 @@ NTSTATUS MSysInfo_Read(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _Out_ PBYTE pb, _In_ DWO
     // proc
     wszPath2 = Util_PathSplit2_ExWCHAR(ctx->wszPath, wszPath1, _countof(wszPath1));
     if(!wcscmp(wszPath1, L"proc")) {
-        return MSysInfo_Read_ProcTree(wszPath2, pb, cb, pcbRead, cbOffset);
+        return MSysInfo_Read_ProcTree(ctx, wszPath2, pb, cb, pcbRead, cbOffset);
     }
     if(!wcscmp(wszPath1, L"net")) {
         return MSysInfo_Read_Net(wszPath2, pb, cb, pcbRead, cbOffset);
@@ -467,6 +744,7 @@ BOOL MSysInfo_List(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _Inout_ PHANDLE pFileList)
 VOID MSysInfo_Close()
 {
     Ob_DECREF_NULL(&gp_MSYSINFO_OB_NETCONTEXT);
+    Ob_DECREF_NULL(&gpm_MSYSINFO_NET_LINES);
 }
 
 VOID M_SysInfo_Initialize(_Inout_ PVMMDLL_PLUGIN_REGINFO pRI)
@@ -104,6 +104,19 @@ NTSTATUS ThreadInfo_Read_ThreadMap(_In_ PVMMOB_MAP_THREAD pThreadMap, _Out_ PBYT
     return nt;
 }
 
+/*
+* Render function for the render cache - render the complete threads.txt file.
+*/
+_Success_(return)
+BOOL ThreadInfo_Render_ThreadMap(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _In_ PVMMOB_MAP_THREAD pThreadMap, _Out_ PBYTE *ppb, _Out_ PDWORD pcb)
+{
+    DWORD cb = (DWORD)(pThreadMap->cMap * THREADINFO_LINELENGTH);
+    *pcb = 0;
+    if(!(*ppb = LocalAlloc(0, max(1, cb)))) { return FALSE; }
+    ThreadInfo_Read_ThreadMap(pThreadMap, *ppb, cb, pcb, 0);
+    return TRUE;
+}
+
 /*
 * Read : function as specified by the module manager. The module manager will
 * call into this callback function whenever a read shall occur from a "file".
@@ -127,7 +140,7 @@ NTSTATUS ThreadInfo_Read(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _Out_ PBYTE pb, _In_ D
     if(!VmmMap_GetThread(ctx->pProcess, &pObThreadMap)) { return VMMDLL_STATUS_FILE_INVALID; }
     // module root - thread info file
     if(!_wcsicmp(ctx->wszPath, L"threads.txt")) {
-        nt = ThreadInfo_Read_ThreadMap(pObThreadMap, pb, cb, pcbRead, cbOffset);
+        nt = PluginManager_RenderRead(ctx, pObThreadMap, 0, (PFN_PLUGINMANAGER_RENDER)ThreadInfo_Render_ThreadMap, pb, cb, pcbRead, cbOffset);
         goto finish;
     }
     // individual thread file
@@ -8,6 +8,7 @@
 //
 #include "m_modules.h"
 #include "pluginmanager.h"
+#include "pdb.h"
 #include "pe.h"
 #include "sysquery.h"
 #include "version.h"
@@ -25,6 +26,12 @@
 #define DUMP_TYPE_FULL              1
 #define _PHYSICAL_MEMORY_MAX_RUNS   0x20
 
+#define MVMMVFS_DUMP_NOCACHE_MIN        0x00100000  // reads larger than this bypass the PHYS cache
+#define MVMMVFS_DUMP_PARALLEL_MIN       0x00400000  // reads larger than this are split and read in parallel
+#define MVMMVFS_DUMP_PARALLEL_CHUNK     0x00100000
+#define MVMMVFS_DUMP_TOFILE_CHUNK       0x00400000
+#define MVMMVFS_DUMP_TOFILE_PROGRESS_MS 2000
+
 typedef struct {
     QWORD BasePage;
     QWORD PageCount;
@@ -159,8 +166,36 @@ typedef struct tdOB_VMMVFS_DUMP_CONTEXT {
         BYTE pb[0x10];
     } KiInitialPCR_Context;
     VMMVFS_DUMP_CONTEXT_OVERLAY OVERLAY[3];
+    struct {
+        DWORD cRuns;
+        QWORD cbTotal;
+        struct {
+            QWORD pa;
+            QWORD cb;
+        } Run[_PHYSICAL_MEMORY_MAX_RUNS];
+    } Ranges;                           // physical memory ranges - reads outside are zero-filled
 } OB_VMMVFS_DUMP_CONTEXT, *POB_VMMVFS_DUMP_CONTEXT;
 
+typedef struct tdMVMMVFS_DUMP_READ_PARALLEL_CONTEXT {
+    POB_VMMVFS_DUMP_CONTEXT ctx;
+    QWORD pa;
+    PBYTE pb;
+    DWORD cb;
+    QWORD flags;
+} MVMMVFS_DUMP_READ_PARALLEL_CONTEXT, *PMVMMVFS_DUMP_READ_PARALLEL_CONTEXT;
+
+typedef struct tdMVMMVFS_DUMP_TOFILE_CONTEXT {
+    POB_VMMVFS_DUMP_CONTEXT ctx;
+    HANDLE hFile;
+    BOOL fCrashDump;
+    DWORD cbHdr;
+    QWORD cbMemory;
+    QWORD tcStart;
+    volatile LONG fError;
+    volatile LONG64 cbDone;
+    volatile LONG64 tcProgressNext;
+} MVMMVFS_DUMP_TOFILE_CONTEXT, *PMVMMVFS_DUMP_TOFILE_CONTEXT;
+
 /*
 * Optionally ensure Prcb[0].Context (nt!_CONTEXT) segment registers are
 * set to non-zero. This is required by WinDbg. Lets fake these values.
@@ -252,6 +287,96 @@ VOID MVmmVfsDump_KdbgLoadAndDecrypt(_In_ PVMM_PROCESS pSystemProcess, _In_ POB_V
     ctx->KDBG.fEncrypted = TRUE;
 }
 
+/*
+* Add a physical memory run (in pages) to the dump context memory ranges. Runs
+* are required to be sorted and non-overlapping and are clipped to max memory.
+* -- ctx
+* -- qwBasePage
+* -- qwPageCount
+* -- return = FALSE if the run is invalid (the ranges should then be discarded).
+*/
+BOOL MVmmVfsDump_InitializeRanges_AddRun(_In_ POB_VMMVFS_DUMP_CONTEXT ctx, _In_ QWORD qwBasePage, _In_ QWORD qwPageCount)
+{
+    QWORD pa = qwBasePage << 12, cb = qwPageCount << 12;
+    if((ctx->Ranges.cRuns == _PHYSICAL_MEMORY_MAX_RUNS) || (qwBasePage > (ctxMain->dev.paMax >> 12)) || (qwPageCount > (ctxMain->dev.paMax >> 12))) { return FALSE; }
+    if(ctx->Ranges.cRuns && (pa < ctx->Ranges.Run[ctx->Ranges.cRuns - 1].pa + ctx->Ranges.Run[ctx->Ranges.cRuns - 1].cb)) { return FALSE; }
+    cb = min(cb, ctxMain->dev.paMax - pa);
+    if(!cb) { return TRUE; }
+    ctx->Ranges.Run[ctx->Ranges.cRuns].pa = pa;
+    ctx->Ranges.Run[ctx->Ranges.cRuns].cb = cb;
+    ctx->Ranges.cRuns++;
+    ctx->Ranges.cbTotal += cb;
+    return TRUE;
+}
+
+/*
+* Set the physical memory ranges to all memory. Used as a fallback whenever a
+* physical memory map isn't available.
+*/
+VOID MVmmVfsDump_InitializeRanges_All(_In_ POB_VMMVFS_DUMP_CONTEXT ctx)
+{
+    ctx->Ranges.cRuns = 0;
+    ctx->Ranges.cbTotal = 0;
+    MVmmVfsDump_InitializeRanges_AddRun(ctx, 0, ctxMain->dev.paMax >> 12);
+}
+
+/*
+* Initialize physical memory ranges from the physical memory descriptor in the
+* underlying crash dump header (before it's replaced by a single run).
+*/
+VOID MVmmVfsDump_InitializeRanges_DumpHeader(_In_ POB_VMMVFS_DUMP_CONTEXT ctx)
+{
+    DWORD i, cRuns;
+    BOOL fResult = TRUE;
+    cRuns = ctxVmm->f32 ? ctx->Hdr._32.PhysicalMemoryBlock.NumberOfRuns : (DWORD)min(0xffffffff, ctx->Hdr._64.PhysicalMemoryBlock.NumberOfRuns);
+    if(!cRuns || (cRuns > _PHYSICAL_MEMORY_MAX_RUNS)) { return; }
+    ctx->Ranges.cRuns = 0;
+    ctx->Ranges.cbTotal = 0;
+    for(i = 0; fResult && (i < cRuns); i++) {
+        if(ctxVmm->f32) {
+            fResult = MVmmVfsDump_InitializeRanges_AddRun(ctx, ctx->Hdr._32.PhysicalMemoryBlock.Run[i].BasePage, ctx->Hdr._32.PhysicalMemoryBlock.Run[i].PageCount);
+        } else {
+            fResult = MVmmVfsDump_InitializeRanges_AddRun(ctx, ctx->Hdr._64.PhysicalMemoryBlock.Run[i].BasePage, ctx->Hdr._64.PhysicalMemoryBlock.Run[i].PageCount);
+        }
+    }
+    if(!fResult || !ctx->Ranges.cRuns) {
+        MVmmVfsDump_InitializeRanges_All(ctx);
+    }
+}
+
+/*
+* Initialize physical memory ranges from the kernel nt!MmPhysicalMemoryBlock
+* physical memory descriptor (nt!_PHYSICAL_MEMORY_DESCRIPTOR).
+* -- pSystemProcess
+* -- ctx
+*/
+VOID MVmmVfsDump_InitializeRanges_Kernel(_In_ PVMM_PROCESS pSystemProcess, _In_ POB_VMMVFS_DUMP_CONTEXT ctx)
+{
+    BOOL fResult = TRUE;
+    QWORD va = 0;
+    DWORD i, cRuns, cbPtr, oRuns;
+    BYTE pb[0x10 + _PHYSICAL_MEMORY_MAX_RUNS * 0x10];
+    cbPtr = ctxVmm->f32 ? 4 : 8;
+    oRuns = 2 * cbPtr;
+    if(!PDB_GetSymbolPTR(VMMWIN_PDB_HANDLE_KERNEL, "MmPhysicalMemoryBlock", pSystemProcess, &va) || !va) { return; }
+    if(!VmmRead(pSystemProcess, va, pb, oRuns)) { return; }
+    cRuns = *(PDWORD)pb;
+    if(!cRuns || (cRuns > _PHYSICAL_MEMORY_MAX_RUNS)) { return; }
+    if(!VmmRead(pSystemProcess, va, pb, oRuns + cRuns * 2 * cbPtr)) { return; }
+    ctx->Ranges.cRuns = 0;
+    ctx->Ranges.cbTotal = 0;
+    for(i = 0; fResult && (i < cRuns); i++) {
+        if(ctxVmm->f32) {
+            fResult = MVmmVfsDump_InitializeRanges_AddRun(ctx, *(PDWORD)(pb + oRuns + i * 8), *(PDWORD)(pb + oRuns + i * 8 + 4));
+        } else {
+            fResult = MVmmVfsDump_InitializeRanges_AddRun(ctx, *(PQWORD)(pb + oRuns + i * 16), *(PQWORD)(pb + oRuns + i * 16 + 8));
+        }
+    }
+    if(!fResult || !ctx->Ranges.cRuns) {
+        MVmmVfsDump_InitializeRanges_All(ctx);
+    }
+}
+
 VOID MVmmVfsDump_InitializeDumpContext_SetMemory(_In_ POB_VMMVFS_DUMP_CONTEXT ctx)
 {
     if(ctxVmm->f32) {
@@ -371,7 +496,9 @@ VOID MVmmVfsDump_InitializeDumpContext(POB_VMMVFS_DUMP_CONTEXT ctx)
     //    Crash dump headers are always assumed to be correct and the dump files
     //    are assumed to have a decrypted KDBG block.
     ctx->cbHdr = ctxVmm->f32 ? 0x1000 : 0x2000;
+    MVmmVfsDump_InitializeRanges_All(ctx);
     if(LeechCore_CommandData(LEECHCORE_COMMANDDATA_FILE_DUMPHEADER_GET, NULL, 0, ctx->Hdr.pb, ctx->cbHdr, NULL)) {
+        MVmmVfsDump_InitializeRanges_DumpHeader(ctx);
         MVmmVfsDump_InitializeDumpContext_SetMemory(ctx);
         ctx->fInitialized = TRUE;
         return;
@@ -380,6 +507,7 @@ VOID MVmmVfsDump_InitializeDumpContext(POB_VMMVFS_DUMP_CONTEXT ctx)
     //    if necessary and possible.
     if(!(pObSystemProcess = VmmProcessGet(4))) { return; }
     VmmWinInit_TryInitializeKernelOptionalValues();
+    MVmmVfsDump_InitializeRanges_Kernel(pObSystemProcess, ctx);
     MVmmVfsDump_KdbgLoadAndDecrypt(pObSystemProcess, ctx);
     MVmmVfsDump_EnsureProcessorContext0(pObSystemProcess, ctx);
     // 3: Initialize dump headers
@@ -404,18 +532,20 @@ VOID MVmmVfsDump_CallbackCleanup_ObVmmVfsDumpContext(POB_VMMVFS_DUMP_CONTEXT pOb
 */
 POB_VMMVFS_DUMP_CONTEXT MVmmVfsDump_GetDumpContext()
 {
-    POB_VMMVFS_DUMP_CONTEXT ctx;
-    // 1: fetch context or create initial context if required
+    POB_VMMVFS_DUMP_CONTEXT ctx, ctxNew;
+    // 1: fetch context or create initial context if required - the new context
+    //    is published by pointer swap; if another thread won the race the new
+    //    context is discarded.
     if(!(ctx = (POB_VMMVFS_DUMP_CONTEXT)Ob_INCREF(ctxVmm->pObVfsDumpContext))) {
-        EnterCriticalSection(&ctxVmm->MasterLock);
-        if(!(ctx = (POB_VMMVFS_DUMP_CONTEXT)Ob_INCREF(ctxVmm->pObVfsDumpContext))) {
-            ctx = (POB_VMMVFS_DUMP_CONTEXT)Ob_Alloc(OB_TAG_VMMVFS_DUMPCONTEXT, LMEM_ZEROINIT, sizeof(OB_VMMVFS_DUMP_CONTEXT), NULL, NULL);
-            if(ctx) {
-                InitializeCriticalSection(&ctx->Lock);
-                ctxVmm->pObVfsDumpContext = Ob_INCREF(ctx);
+        ctxNew = (POB_VMMVFS_DUMP_CONTEXT)Ob_Alloc(OB_TAG_VMMVFS_DUMPCONTEXT, LMEM_ZEROINIT, sizeof(OB_VMMVFS_DUMP_CONTEXT), NULL, NULL);
+        if(ctxNew) {
+            InitializeCriticalSection(&ctxNew->Lock);
+            if(InterlockedCompareExchangePointer((PVOID*)&ctxVmm->pObVfsDumpContext, ctxNew, NULL)) {
+                DeleteCriticalSection(&ctxNew->Lock);
+                Ob_DECREF(ctxNew);
             }
         }
-        LeaveCriticalSection(&ctxVmm->MasterLock);
+        ctx = (POB_VMMVFS_DUMP_CONTEXT)Ob_INCREF(ctxVmm->pObVfsDumpContext);
     }
     // 2: initialize context (if required)
     if(ctx && !ctx->fInitialized) {
@@ -428,6 +558,105 @@ POB_VMMVFS_DUMP_CONTEXT MVmmVfsDump_GetDumpContext()
     return ctx;
 }
 
+/*
+* Read physical memory from within the physical memory ranges. Memory outside
+* of the ranges (holes in the physical memory map) is zero-filled without any
+* device access. If no dump context is given (memory.pmem) the memory is read
+* as-is without consulting the physical memory ranges.
+* -- ctxOpt
+* -- pa
+* -- pb
+* -- cb
+* -- flags
+*/
+VOID MVmmVfsDump_ReadMemoryRanges(_In_opt_ POB_VMMVFS_DUMP_CONTEXT ctxOpt, _In_ QWORD pa, _Out_writes_(cb) PBYTE pb, _In_ DWORD cb, _In_ QWORD flags)
+{
+    DWORD i;
+    QWORD paCurrent = pa, paEnd = pa + cb, paRunBase, paRunTop;
+    if(!ctxOpt) {
+        VmmReadEx(NULL, pa, pb, cb, NULL, flags | VMM_FLAG_ZEROPAD_ON_FAIL);
+        return;
+    }
+    for(i = 0; (i < ctxOpt->Ranges.cRuns) && (paCurrent < paEnd); i++) {
+        paRunBase = max(paCurrent, ctxOpt->Ranges.Run[i].pa);
+        paRunTop = min(paEnd, ctxOpt->Ranges.Run[i].pa + ctxOpt->Ranges.Run[i].cb);
+        if(paRunBase >= paRunTop) { continue; }
+        if(paCurrent < paRunBase) {
+            ZeroMemory(pb + (paCurrent - pa), (SIZE_T)(paRunBase - paCurrent));
+        }
+        VmmReadEx(NULL, paRunBase, pb + (paRunBase - pa), (DWORD)(paRunTop - paRunBase), NULL, flags | VMM_FLAG_ZEROPAD_ON_FAIL);
+        paCurrent = paRunTop;
+    }
+    if(paCurrent < paEnd) {
+        ZeroMemory(pb + (paCurrent - pa), (SIZE_T)(paEnd - paCurrent));
+    }
+}
+
+VOID MVmmVfsDump_ReadMemory_ParallelCB(_In_ PMVMMVFS_DUMP_READ_PARALLEL_CONTEXT ctxRead, _In_ DWORD iItem)
+{
+    DWORD o = iItem * MVMMVFS_DUMP_PARALLEL_CHUNK;
+    MVmmVfsDump_ReadMemoryRanges(ctxRead->ctx, ctxRead->pa + o, ctxRead->pb + o, min(MVMMVFS_DUMP_PARALLEL_CHUNK, ctxRead->cb - o), ctxRead->flags);
+}
+
+/*
+* Overlay decrypted KDBG, KdpDataBlockEncoded (if encrypted) and processor
+* context 0 onto physical memory read into a dump buffer.
+* -- ctx
+* -- pa
+* -- pb
+* -- cb
+*/
+VOID MVmmVfsDump_ReadMemoryOverlay(_In_ POB_VMMVFS_DUMP_CONTEXT ctx, _In_ QWORD pa, _Inout_updates_(cb) PBYTE pb, _In_ DWORD cb)
+{
+    DWORD io, cbOverlayOffset, cbOverlay;
+    QWORD cbOverlayAdjust;
+    PVMMVFS_DUMP_CONTEXT_OVERLAY po;
+    for(io = 0; io < sizeof(ctx->OVERLAY) / sizeof(VMMVFS_DUMP_CONTEXT_OVERLAY); io++) {
+        po = ctx->OVERLAY + io;
+        if(!po->cb) { continue; }
+        if((pa <= po->pa + po->cb) && (pa + cb > po->pa)) {
+            if(po->pa <= pa) {
+                cbOverlayAdjust = 0;
+                cbOverlayOffset = (DWORD)(pa - po->pa);
+                cbOverlay = min(po->cb - cbOverlayOffset, cb);
+            } else {
+                cbOverlayAdjust = po->pa - pa;
+                cbOverlayOffset = 0;
+                cbOverlay = (DWORD)min(po->cb, cb - cbOverlayAdjust);
+            }
+            memcpy(pb + cbOverlayAdjust, po->pb + cbOverlayOffset, cbOverlay);
+        }
+    }
+}
+
+/*
+* Read physical memory for the memory dump files. Large reads bypass the PHYS
+* cache (bulk dump reads would otherwise evict the working set of the cache)
+* and are split into chunks read in parallel on the work pool.
+* -- ctxOpt = dump context (memory.dmp), or NULL for memory.pmem.
+* -- pa
+* -- pb
+* -- cb
+* -- return = number of bytes read (bytes below max physical address).
+*/
+DWORD MVmmVfsDump_ReadMemory(_In_opt_ POB_VMMVFS_DUMP_CONTEXT ctxOpt, _In_ QWORD pa, _Out_writes_(cb) PBYTE pb, _In_ DWORD cb)
+{
+    MVMMVFS_DUMP_READ_PARALLEL_CONTEXT ctxRead;
+    if(pa >= ctxMain->dev.paMax) { return 0; }
+    cb = (DWORD)min(cb, ctxMain->dev.paMax - pa);
+    if(cb > MVMMVFS_DUMP_PARALLEL_MIN) {
+        ctxRead.ctx = ctxOpt;
+        ctxRead.pa = pa;
+        ctxRead.pb = pb;
+        ctxRead.cb = cb;
+        ctxRead.flags = VMM_FLAG_NOCACHE;
+        VmmWorkParallel(&ctxRead, (cb + MVMMVFS_DUMP_PARALLEL_CHUNK - 1) / MVMMVFS_DUMP_PARALLEL_CHUNK, (VOID(*)(PVOID, DWORD))MVmmVfsDump_ReadMemory_ParallelCB);
+    } else {
+        MVmmVfsDump_ReadMemoryRanges(ctxOpt, pa, pb, cb, (cb > MVMMVFS_DUMP_NOCACHE_MIN) ? VMM_FLAG_NOCACHE : 0);
+    }
+    return cb;
+}
+
 /*
 * Read from memory dump files in the virtual file system root.
 * -- wcsFileName
@@ -441,12 +670,12 @@ NTSTATUS MVmmVfsDump_Read(_In_ LPCWSTR wcsFileName, _Out_writes_(cb) PBYTE pb, _
 {
     NTSTATUS nt = VMM_STATUS_FILE_INVALID;
     POB_VMMVFS_DUMP_CONTEXT ctx = NULL;
-    PVMMVFS_DUMP_CONTEXT_OVERLAY po;
-    DWORD io, cbHead = 0, cbReadMem = 0;
-    DWORD cbOverlayOffset, cbOverlay;
-    QWORD cbOverlayAdjust;
+    DWORD cbHead = 0, cbReadMem = 0;
     if(!_wcsicmp(wcsFileName, L"\\memory.pmem")) {
-        VmmReadEx(NULL, cbOffset, pb, cb, pcbRead, VMM_FLAG_ZEROPAD_ON_FAIL);
+        // raw physical memory - served directly without the dump context (no
+        // KDBG/PDB dependency).
+        cbReadMem = MVmmVfsDump_ReadMemory(NULL, cbOffset, pb, cb);
+        if(pcbRead) { *pcbRead = cbReadMem; }
         return VMM_STATUS_SUCCESS;
     }
     if(!_wcsicmp(wcsFileName, L"\\memory.dmp")) {
@@ -466,25 +695,9 @@ NTSTATUS MVmmVfsDump_Read(_In_ LPCWSTR wcsFileName, _Out_writes_(cb) PBYTE pb, _
         }
         cbOffset -= ctx->cbHdr;
         // read memory
-        VmmReadEx(NULL, cbOffset, pb, cb, &cbReadMem, VMM_FLAG_ZEROPAD_ON_FAIL);
+        cbReadMem = MVmmVfsDump_ReadMemory(ctx, cbOffset, pb, cb);
         if(pcbRead) { *pcbRead = cbHead + cbReadMem; }
-        // overlay decrypted KDBG, KdpDataBlockEncoded (if encrypted) and ProcessorContext0
-        for(io = 0; io < sizeof(ctx->OVERLAY) / sizeof(VMMVFS_DUMP_CONTEXT_OVERLAY); io++) {
-            po = ctx->OVERLAY + io;
-            if(!po->cb) { continue; }
-            if((cbOffset <= po->pa + po->cb) && (cbOffset + cb > po->pa)) {
-                if(po->pa <= cbOffset) {
-                    cbOverlayAdjust = 0;
-                    cbOverlayOffset = (DWORD)(cbOffset - po->pa);
-                    cbOverlay = min(po->cb - cbOverlayOffset, cb);
-                } else {
-                    cbOverlayAdjust = po->pa - cbOffset;
-                    cbOverlayOffset = 0;
-                    cbOverlay = (DWORD)min(po->cb, cb - cbOverlayAdjust);
-                }
-                memcpy(pb + cbOverlayAdjust, po->pb + cbOverlayOffset, cbOverlay);
-            }
-        }
+        MVmmVfsDump_ReadMemoryOverlay(ctx, cbOffset, pb, cbReadMem);
         nt = VMM_STATUS_SUCCESS;
     }
 finish:
@@ -492,6 +705,99 @@ finish:
     return nt;
 }
 
+VOID MVmmVfsDump_DumpToFile_ItemCB(_In_ PMVMMVFS_DUMP_TOFILE_CONTEXT ctxDump, _In_ DWORD iItem)
+{
+    DWORD i, cb;
+    BOOL fHole = TRUE;
+    PBYTE pb = NULL;
+    OVERLAPPED ov = { 0 };
+    QWORD pa, tcNow, tcProgressNext, cbDone, cbPerSec;
+    pa = (QWORD)iItem * MVMMVFS_DUMP_TOFILE_CHUNK;
+    cb = (DWORD)min(MVMMVFS_DUMP_TOFILE_CHUNK, ctxDump->cbMemory - pa);
+    if(ctxDump->fError) { return; }
+    // 1: chunks entirely in physical memory holes are not written - the file
+    //    is pre-sized and unwritten data reads as zero.
+    for(i = 0; i < ctxDump->ctx->Ranges.cRuns; i++) {
+        if((pa < ctxDump->ctx->Ranges.Run[i].pa + ctxDump->ctx->Ranges.Run[i].cb) && (pa + cb > ctxDump->ctx->Ranges.Run[i].pa)) {
+            fHole = FALSE;
+            break;
+        }
+    }
+    // 2: read (bypassing the cache) and write chunk
+    if(!fHole) {
+        if(!(pb = LocalAlloc(0, cb))) {
+            InterlockedExchange(&ctxDump->fError, TRUE);
+            return;
+        }
+        MVmmVfsDump_ReadMemoryRanges(ctxDump->ctx, pa, pb, cb, VMM_FLAG_NOCACHE);
+        if(ctxDump->fCrashDump) {
+            MVmmVfsDump_ReadMemoryOverlay(ctxDump->ctx, pa, pb, cb);
+        }
+        ov.Offset = (DWORD)(ctxDump->cbHdr + pa);
+        ov.OffsetHigh = (DWORD)((ctxDump->cbHdr + pa) >> 32);
+        if(!WriteFile(ctxDump->hFile, pb, cb, NULL, &ov)) {
+            InterlockedExchange(&ctxDump->fError, TRUE);
+        }
+        LocalFree(pb);
+    }
+    // 3: progress and throughput
+    cbDone = InterlockedAdd64(&ctxDump->cbDone, cb);
+    tcNow = GetTickCount64();
+    tcProgressNext = ctxDump->tcProgressNext;
+    if((tcNow >= tcProgressNext) && (tcProgressNext == (QWORD)InterlockedCompareExchange64(&ctxDump->tcProgressNext, tcNow + MVMMVFS_DUMP_TOFILE_PROGRESS_MS, tcProgressNext))) {
+        cbPerSec = (cbDone * 1000) / max(1, tcNow - ctxDump->tcStart);
+        vmmprintf("DumpToFile: %3lli%% %lli / %lli MB (%lli MB/s)\n", cbDone * 100 / ctxDump->cbMemory, cbDone >> 20, ctxDump->cbMemory >> 20, cbPerSec >> 20);
+    }
+}
+
+/*
+* Write a full physical memory dump to a file. The dump is read in large
+* chunks in parallel on the work pool (deep device queue depth) bypassing the
+* PHYS cache. Holes in the physical memory map are skipped. Progress and
+* throughput is printed.
+* -- szFileName
+* -- fCrashDump = write the memory.dmp crash dump format (otherwise memory.pmem raw).
+* -- return
+*/
+_Success_(return)
+BOOL MVmmVfsDump_DumpToFile(_In_ LPSTR szFileName, _In_ BOOL fCrashDump)
+{
+    LARGE_INTEGER li;
+    DWORD cbWrite;
+    QWORD tcEnd;
+    MVMMVFS_DUMP_TOFILE_CONTEXT ctxDump = { 0 };
+    if(!(ctxDump.ctx = MVmmVfsDump_GetDumpContext())) { return FALSE; }
+    ctxDump.fCrashDump = fCrashDump;
+    ctxDump.cbHdr = fCrashDump ? ctxDump.ctx->cbHdr : 0;
+    ctxDump.cbMemory = ctxMain->dev.paMax;
+    ctxDump.hFile = CreateFileA(szFileName, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(!ctxDump.cbMemory || (ctxDump.hFile == INVALID_HANDLE_VALUE)) { goto fail; }
+    // pre-size file and write header
+    li.QuadPart = ctxDump.cbHdr + ctxDump.cbMemory;
+    if(!SetFilePointerEx(ctxDump.hFile, li, NULL, FILE_BEGIN) || !SetEndOfFile(ctxDump.hFile)) { goto fail; }
+    li.QuadPart = 0;
+    if(!SetFilePointerEx(ctxDump.hFile, li, NULL, FILE_BEGIN)) { goto fail; }
+    if(ctxDump.cbHdr && (!WriteFile(ctxDump.hFile, ctxDump.ctx->Hdr.pb, ctxDump.cbHdr, &cbWrite, NULL) || (cbWrite != ctxDump.cbHdr))) { goto fail; }
+    vmmprintf("DumpToFile: writing %lli MB (%lli MB in %i physical memory ranges) to '%s'.\n", ctxDump.cbMemory >> 20, ctxDump.ctx->Ranges.cbTotal >> 20, ctxDump.ctx->Ranges.cRuns, szFileName);
+    ctxDump.tcStart = GetTickCount64();
+    ctxDump.tcProgressNext = ctxDump.tcStart + MVMMVFS_DUMP_TOFILE_PROGRESS_MS;
+    VmmWorkParallel(&ctxDump, (DWORD)((ctxDump.cbMemory + MVMMVFS_DUMP_TOFILE_CHUNK - 1) / MVMMVFS_DUMP_TOFILE_CHUNK), (VOID(*)(PVOID, DWORD))MVmmVfsDump_DumpToFile_ItemCB);
+    if(ctxDump.fError || (ctxDump.cbDone != ctxDump.cbMemory)) { goto fail; }
+    tcEnd = GetTickCount64();
+    vmmprintf("DumpToFile: completed %lli MB in %lli s (%lli MB/s).\n", ctxDump.cbMemory >> 20, (tcEnd - ctxDump.tcStart) / 1000, ((ctxDump.cbMemory * 1000) / max(1, tcEnd - ctxDump.tcStart)) >> 20);
+    CloseHandle(ctxDump.hFile);
+    Ob_DECREF(ctxDump.ctx);
+    return TRUE;
+fail:
+    vmmprintf("DumpToFile: failed writing '%s'.\n", szFileName);
+    if(ctxDump.hFile != INVALID_HANDLE_VALUE) {
+        CloseHandle(ctxDump.hFile);
+        DeleteFileA(szFileName);
+    }
+    Ob_DECREF(ctxDump.ctx);
+    return FALSE;
+}
+
 /*
 * Write to memory dump files in the virtual file system root. This requires a
 * write-capable backend device/driver. Also the crash dump header in microsoft
@@ -35,6 +35,19 @@ NTSTATUS MVmmVfsDump_Read(_In_ LPCWSTR wcsFileName, _Out_writes_(cb) PBYTE pb, _
 */
 NTSTATUS MVmmVfsDump_Write(_In_ LPCWSTR wcsFileName, _In_reads_(cb) PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbWrite, _In_ QWORD cbOffset);
 
+/*
+* Write a full physical memory dump to a file in either the memory.dmp crash
+* dump format or the memory.pmem raw format. Memory is read in large chunks in
+* parallel bypassing the PHYS cache. Holes in the physical memory map (if one
+* is available from the crash dump header or the kernel) are skipped and read
+* as zero. Progress and throughput is printed.
+* -- szFileName
+* -- fCrashDump = TRUE: memory.dmp format, FALSE: memory.pmem format.
+* -- return
+*/
+_Success_(return)
+BOOL MVmmVfsDump_DumpToFile(_In_ LPSTR szFileName, _In_ BOOL fCrashDump);
+
 /*
 * List dump files in the virtual file system root.
 * -- pFileList
@@ -0,0 +1,68 @@
+// mm_ptescan.c : implementation of vectorized scanning of 64-bit page tables.
+//
+// (c) Ulf Frisk, 2018-2019
+// Author: Ulf Frisk, pcileech@frizk.net
+//
+#include "mm_ptescan.h"
+#include <intrin.h>
+#include <immintrin.h>
+
+BOOL g_fMmX64PteScanAVX2 = FALSE;
+
+VOID MmX64_PteScan(_In_reads_(512) QWORD PTEs[512], _In_ QWORD qwAnd, _In_ QWORD qwCmp, _Inout_updates_(8) QWORD pqwBitmap[8])
+{
+    DWORD i, j;
+    QWORD qwBits;
+    __m128i vAnd128, vCmp128, vEq128;
+    __m256i vAnd256, vCmp256;
+    if(g_fMmX64PteScanAVX2) {
+        vAnd256 = _mm256_set1_epi64x(qwAnd);
+        vCmp256 = _mm256_set1_epi64x(qwCmp);
+        for(i = 0; i < 8; i++) {
+            qwBits = 0;
+            for(j = 0; j < 64; j += 4) {
+                qwBits |= (QWORD)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(_mm256_loadu_si256((__m256i*)(PTEs + i * 64 + j)), vAnd256), vCmp256))) << j;
+            }
+            pqwBitmap[i] |= qwBits;
+        }
+        return;
+    }
+    // SSE2 lacks 64-bit compare - combine 32-bit compare of low/high dwords.
+    vAnd128 = _mm_set1_epi64x(qwAnd);
+    vCmp128 = _mm_set1_epi64x(qwCmp);
+    for(i = 0; i < 8; i++) {
+        qwBits = 0;
+        for(j = 0; j < 64; j += 2) {
+            vEq128 = _mm_cmpeq_epi32(_mm_and_si128(_mm_loadu_si128((__m128i*)(PTEs + i * 64 + j)), vAnd128), vCmp128);
+            vEq128 = _mm_and_si128(vEq128, _mm_shuffle_epi32(vEq128, _MM_SHUFFLE(2, 3, 0, 1)));
+            qwBits |= (QWORD)_mm_movemask_pd(_mm_castsi128_pd(vEq128)) << j;
+        }
+        pqwBitmap[i] |= qwBits;
+    }
+}
+
+BOOL MmX64_PteScanIsAVX2()
+{
+    int rgInfo[4];
+    __cpuid(rgInfo, 0);
+    if(rgInfo[0] < 7) { return FALSE; }
+    __cpuid(rgInfo, 1);
+    if((rgInfo[2] & 0x18000000) != 0x18000000) { return FALSE; }  // OSXSAVE + AVX
+    if((_xgetbv(0) & 0x06) != 0x06) { return FALSE; }             // XMM + YMM state enabled by os
+    __cpuidex(rgInfo, 7, 0);
+    return (rgInfo[1] & 0x20) ? TRUE : FALSE;                     // AVX2
+}
+
+_Success_(return)
+BOOL MmX64_PteScanNext(_Inout_updates_(8) QWORD pqwBitmap[8], _Out_ PQWORD pi)
+{
+    DWORD iQ, iBit;
+    for(iQ = 0; iQ < 8; iQ++) {
+        if(_BitScanForward64(&iBit, pqwBitmap[iQ])) {
+            pqwBitmap[iQ] &= pqwBitmap[iQ] - 1;
+            *pi = iQ * 64ULL + iBit;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
@@ -0,0 +1,47 @@
+// mm_ptescan.h : definitions related to vectorized scanning of 64-bit page
+//                tables (x64 / IA32e). The scan functionality does not depend
+//                on the vmm context and may be used stand-alone (vmm_bench).
+//
+// (c) Ulf Frisk, 2018-2019
+// Author: Ulf Frisk, pcileech@frizk.net
+//
+#ifndef __MM_PTESCAN_H__
+#define __MM_PTESCAN_H__
+#include <windows.h>
+
+typedef unsigned __int64                QWORD, *PQWORD;
+
+/*
+* TRUE if MmX64_PteScan should use AVX2 (initialized from MmX64_PteScanIsAVX2
+* at memory model initialization). SSE2 is used if FALSE.
+*/
+extern BOOL g_fMmX64PteScanAVX2;
+
+/*
+* Scan a page table for all entries matching: ((pte & qwAnd) == qwCmp) and set
+* the corresponding bits in the 512-bit bitmap. Bits already set are retained.
+* The scan is vectorized (AVX2 if supported by the CPU, otherwise SSE2) so that
+* page table walkers only have to visit interesting entries.
+* -- PTEs
+* -- qwAnd
+* -- qwCmp
+* -- pqwBitmap
+*/
+VOID MmX64_PteScan(_In_reads_(512) QWORD PTEs[512], _In_ QWORD qwAnd, _In_ QWORD qwCmp, _Inout_updates_(8) QWORD pqwBitmap[8]);
+
+/*
+* Check whether the CPU and the operating system supports AVX2.
+* -- return
+*/
+BOOL MmX64_PteScanIsAVX2();
+
+/*
+* Retrieve the next set bit index in a 512-bit bitmap and clear it.
+* -- pqwBitmap
+* -- pi = index of the next set bit.
+* -- return = FALSE if no more bits are set.
+*/
+_Success_(return)
+BOOL MmX64_PteScanNext(_Inout_updates_(8) QWORD pqwBitmap[8], _Out_ PQWORD pi);
+
+#endif /* __MM_PTESCAN_H__ */
@@ -12,8 +12,13 @@
 #define MMVAD_POOLTAG_VADL      'Vadl'
 #define MMVAD_POOLTAG_VADM      'Vadm'
 
+#define MMVAD_SPIDER_LEVEL_MAX  0x40    // max vad tree depth walked (balanced tree: ~2*log2(#vad))
 #define MMVAD_PTESIZE           ((ctxVmm->tpMemoryModel == VMM_MEMORYMODEL_X86) ? 4 : 8)
 
+#define MMVAD_PROTOTYPEPTE_PREFETCH_VADS    0x20        // neighbouring vads (in each direction) prefetched on a cache miss
+#define MMVAD_PROTOTYPEPTE_PREFETCH_MAX     0x00100000  // max bytes of prototype pte arrays prefetched on a cache miss
+#define MMVAD_PROTOTYPEPTE_CACHE_COST(e)    ((QWORD)(e)->ObHdr.cbData + sizeof(OB) + 0x20)   // array + object + map overhead
+
 // ----------------------------------------------------------------------------
 // DEFINES OF VAD STRUCTS FOR DIFFRENT WINDOWS VERSIONS
 // Define the VADs here statically rather than parse offsets it from PDBs
@@ -376,6 +381,7 @@ VOID VmmVad_MemMapVad_CloseObCallback(_In_ PVOID pVmmOb)
 {
     PVMMOB_MAP_VAD pOb = (PVMMOB_MAP_VAD)pVmmOb;
     LocalFree(pOb->wszMultiText);
+    Ob_DECREF(pOb->pObIndex);
 }
 
 // ----------------------------------------------------------------------------
@@ -424,12 +430,10 @@ PVMM_MAP_VADENTRY MmVad_Spider_MMVAD32_XP(_In_ PVMM_PROCESS pSystemProcess, _In_
     }
     // short vad
     e = &pmVad->pMap[pmVad->cMap++];
-    if(VMM_KADDR32_8(v.LeftChild)) {
-        ObVSet_Push(psAll, v.LeftChild - 8);
+    if(VMM_KADDR32_8(v.LeftChild) && ObVSet_Push(psAll, v.LeftChild - 8)) {
         ObVSet_Push(psTry1, v.LeftChild - 8);
     }
-    if(VMM_KADDR32_8(v.RightChild)) {
-        ObVSet_Push(psAll, v.RightChild - 8);
+    if(VMM_KADDR32_8(v.RightChild) && ObVSet_Push(psAll, v.RightChild - 8)) {
         ObVSet_Push(psTry1, v.RightChild - 8);
     }
     e->vaStart = (QWORD)v.StartingVpn << 12;
@@ -463,12 +467,10 @@ PVMM_MAP_VADENTRY MmVad_Spider_MMVAD32_7(_In_ PVMM_PROCESS pSystemProcess, _In_
     }
     // short vad
     e = &pmVad->pMap[pmVad->cMap++];
-    if(VMM_KADDR32_8(v.LeftChild)) {
-        ObVSet_Push(psAll, v.LeftChild - 8);
+    if(VMM_KADDR32_8(v.LeftChild) && ObVSet_Push(psAll, v.LeftChild - 8)) {
         ObVSet_Push(psTry1, v.LeftChild - 8);
     }
-    if(VMM_KADDR32_8(v.RightChild)) {
-        ObVSet_Push(psAll, v.RightChild - 8);
+    if(VMM_KADDR32_8(v.RightChild) && ObVSet_Push(psAll, v.RightChild - 8)) {
         ObVSet_Push(psTry1, v.RightChild - 8);
     }
     e->vaStart = (QWORD)v.StartingVpn << 12;
@@ -501,12 +503,10 @@ PVMM_MAP_VADENTRY MmVad_Spider_MMVAD64_7(_In_ PVMM_PROCESS pSystemProcess, _In_
     }
     // short vad
     e = &pmVad->pMap[pmVad->cMap++];
-    if(VMM_KADDR64_16(v.LeftChild)) {
-        ObVSet_Push(psAll, v.LeftChild - 0x10);
+    if(VMM_KADDR64_16(v.LeftChild) && ObVSet_Push(psAll, v.LeftChild - 0x10)) {
         ObVSet_Push(psTry1, v.LeftChild - 0x10);
     }
-    if(VMM_KADDR64_16(v.RightChild)) {
-        ObVSet_Push(psAll, v.RightChild - 0x10);
+    if(VMM_KADDR64_16(v.RightChild) && ObVSet_Push(psAll, v.RightChild - 0x10)) {
         ObVSet_Push(psTry1, v.RightChild - 0x10);
     }
     e->vaStart = (QWORD)v.StartingVpn << 12;
@@ -539,12 +539,10 @@ PVMM_MAP_VADENTRY MmVad_Spider_MMVAD32_80(_In_ PVMM_PROCESS pSystemProcess, _In_
     }
     // short vad
     e = &pmVad->pMap[pmVad->cMap++];
-    if(VMM_KADDR64_16(v.LeftChild)) {
-        ObVSet_Push(psAll, v.LeftChild - 8);
+    if(VMM_KADDR64_16(v.LeftChild) && ObVSet_Push(psAll, v.LeftChild - 8)) {
         ObVSet_Push(psTry1, v.LeftChild - 8);
     }
-    if(VMM_KADDR64_16(v.RightChild)) {
-        ObVSet_Push(psAll, v.RightChild - 8);
+    if(VMM_KADDR64_16(v.RightChild) && ObVSet_Push(psAll, v.RightChild - 8)) {
         ObVSet_Push(psTry1, v.RightChild - 8);
     }
     e->vaStart = (QWORD)v.StartingVpn << 12;
@@ -578,12 +576,10 @@ PVMM_MAP_VADENTRY MmVad_Spider_MMVAD64_80(_In_ PVMM_PROCESS pSystemProcess, _In_
     }
     // short vad
     e = &pmVad->pMap[pmVad->cMap++];
-    if(VMM_KADDR64_16(v.LeftChild)) {
-        ObVSet_Push(psAll, v.LeftChild - 0x10);
+    if(VMM_KADDR64_16(v.LeftChild) && ObVSet_Push(psAll, v.LeftChild - 0x10)) {
         ObVSet_Push(psTry1, v.LeftChild - 0x10);
     }
-    if(VMM_KADDR64_16(v.RightChild)) {
-        ObVSet_Push(psAll, v.RightChild - 0x10);
+    if(VMM_KADDR64_16(v.RightChild) && ObVSet_Push(psAll, v.RightChild - 0x10)) {
         ObVSet_Push(psTry1, v.RightChild - 0x10);
     }
     e->vaStart = (QWORD)v.StartingVpn << 12;
@@ -617,12 +613,10 @@ PVMM_MAP_VADENTRY MmVad_Spider_MMVAD32_10(_In_ PVMM_PROCESS pSystemProcess, _In_
     }
     // short vad
     e = &pmVad->pMap[pmVad->cMap++];
-    if(VMM_KADDR32_8(v.Children[0])) {
-        ObVSet_Push(psAll, v.Children[0] - 8);
+    if(VMM_KADDR32_8(v.Children[0]) && ObVSet_Push(psAll, v.Children[0] - 8)) {
         ObVSet_Push(psTry1, v.Children[0] - 8);
     }
-    if(VMM_KADDR32_8(v.Children[1])) {
-        ObVSet_Push(psAll, v.Children[1] - 8);
+    if(VMM_KADDR32_8(v.Children[1]) && ObVSet_Push(psAll, v.Children[1] - 8)) {
         ObVSet_Push(psTry1, v.Children[1] - 8);
     }
     e->vaStart = (QWORD)v.StartingVpn << 12;
@@ -656,12 +650,10 @@ PVMM_MAP_VADENTRY MmVad_Spider_MMVAD64_10(_In_ PVMM_PROCESS pSystemProcess, _In_
     }
     // short vad
     e = &pmVad->pMap[pmVad->cMap++];
-    if(VMM_KADDR64_16(v.Children[0])) {
-        ObVSet_Push(psAll, v.Children[0] - 0x10);
+    if(VMM_KADDR64_16(v.Children[0]) && ObVSet_Push(psAll, v.Children[0] - 0x10)) {
         ObVSet_Push(psTry1, v.Children[0] - 0x10);
     }
-    if(VMM_KADDR64_16(v.Children[1])) {
-        ObVSet_Push(psAll, v.Children[1] - 0x10);
+    if(VMM_KADDR64_16(v.Children[1]) && ObVSet_Push(psAll, v.Children[1] - 0x10)) {
         ObVSet_Push(psTry1, v.Children[1] - 0x10);
     }
     e->vaStart = ((QWORD)v.StartingVpnHigh << (32 + 12)) | ((QWORD)v.StartingVpn << 12);
@@ -686,10 +678,10 @@ VOID MmVad_Spider_DoWork(_In_ PVMM_PROCESS pSystemProcess, _In_ PVMM_PROCESS pPr
 {
     BOOL f;
     QWORD i, va;
-    DWORD cMax, cVads, dwFlagsBitMask = 0;
+    DWORD cMax, cVads, iLevel, dwFlagsBitMask = 0;
     PVMM_MAP_VADENTRY eVad;
     PVMMOB_MAP_VAD pmObVad = NULL, pmObVadTemp;
-    POB_VSET psObAll = NULL, psObTry1 = NULL, psObTry2 = NULL, psObPrefetch = NULL;
+    POB_VSET psObAll = NULL, psObLevel = NULL, psObLevelNext = NULL, psObSwap, psObPrefetch = NULL;
     PVMM_MAP_VADENTRY(*pfnMmVad_Spider)(PVMM_PROCESS, QWORD, PVMMOB_MAP_VAD, POB_VSET, POB_VSET, POB_VSET, QWORD, DWORD);
     if(!(ctxVmm->tpSystem == VMM_SYSTEM_WINDOWS_X64 || ctxVmm->tpSystem == VMM_SYSTEM_WINDOWS_X86)) { goto fail; }
     // 1: retrieve # of VAD entries and sanity check.
@@ -710,6 +702,7 @@ VOID MmVad_Spider_DoWork(_In_ PVMM_PROCESS pSystemProcess, _In_ PVMM_PROCESS pPr
     }
     // 2: allocate and retrieve objects required for processing
     if(!(pmObVad = Ob_Alloc(OB_TAG_MAP_VAD, LMEM_ZEROINIT, sizeof(VMMOB_MAP_VAD) + cVads * sizeof(VMM_MAP_VADENTRY), VmmVad_MemMapVad_CloseObCallback, NULL))) { goto fail; }
+    pmObVad->qwGeneration = VmmGenerationNext();
     if(cVads == 0) {    // No VADs
         vmmprintfvv_fn("WARNING: NO VAD FOR PROCESS - PID: %i STATE: %i NAME: %s\n", pProcess->dwPID, pProcess->dwState, pProcess->szName);
         pProcess->Map.pObVad = Ob_INCREF(pmObVad);
@@ -717,8 +710,8 @@ VOID MmVad_Spider_DoWork(_In_ PVMM_PROCESS pSystemProcess, _In_ PVMM_PROCESS pPr
     }
     cMax = cVads;
     if(!(psObAll = ObVSet_New())) { goto fail; }
-    if(!(psObTry1 = ObVSet_New())) { goto fail; }
-    if(!(psObTry2 = ObVSet_New())) { goto fail; }
+    if(!(psObLevel = ObVSet_New())) { goto fail; }
+    if(!(psObLevelNext = ObVSet_New())) { goto fail; }
     // 3: retrieve initial VAD node entry
     f = ((ctxVmm->kernel.dwVersionBuild >= 6000) && (ctxVmm->kernel.dwVersionBuild < 9600));    // AvlTree (Vista::Win8.0
     for(i = (f ? 1 : 0); i < (f ? 4 : 1); i++) {
@@ -727,9 +720,9 @@ VOID MmVad_Spider_DoWork(_In_ PVMM_PROCESS pSystemProcess, _In_ PVMM_PROCESS pPr
         if(!ctxVmm->f32 && !VMM_KADDR64_16(va)) { continue; }
         va -= ctxVmm->f32 ? 8 : 0x10;
         ObVSet_Push(psObAll, va);
-        ObVSet_Push(psObTry2, va);
+        ObVSet_Push(psObLevel, va);
     }
-    if(!ObVSet_Size(psObTry2)) { goto fail; }
+    if(!ObVSet_Size(psObLevel)) { goto fail; }
     if(ctxVmm->kernel.dwVersionBuild >= 9600) {
         // Win8.1 and later
         pfnMmVad_Spider = ctxVmm->f32 ? MmVad_Spider_MMVAD32_10 : MmVad_Spider_MMVAD64_10;
@@ -755,25 +748,21 @@ VOID MmVad_Spider_DoWork(_In_ PVMM_PROCESS pSystemProcess, _In_ PVMM_PROCESS pPr
         VmmCachePrefetchPages3(pSystemProcess, psObPrefetch, sizeof(_MMVAD64_10), fVmmRead);
         Ob_DECREF_NULL(&psObPrefetch);
     }
-    // 5: spider vad tree in an efficient way (minimize non-cached reads)
-    while((pmObVad->cMap < cMax) && ObVSet_Size(psObTry2)) {
-        // fetch vad entries 2nd attempt
-        VmmCachePrefetchPages3(pSystemProcess, psObTry2, sizeof(_MMVAD64_10), fVmmRead);
-        while((pmObVad->cMap < cMax) && (va = ObVSet_Pop(psObTry2))) {
-            if((eVad = pfnMmVad_Spider(pSystemProcess, va, pmObVad, psObAll, psObTry1, NULL, fVmmRead, dwFlagsBitMask))) {
-                eVad->vaVad = va;
-                eVad->wszText = &ctxVmm->_EmptyWCHAR;
-                if(eVad->cbPrototypePte > 0x01000000) { eVad->cbPrototypePte = MMVAD_PTESIZE * (DWORD)((0x1000 + eVad->vaEnd - eVad->vaStart) >> 12); }
-            }
-        }
-        // fetch vad entries 1st attempt
-        while((pmObVad->cMap < cMax) && (va = ObVSet_Pop(psObTry1))) {
-            if((eVad = pfnMmVad_Spider(pSystemProcess, va, pmObVad, psObAll, psObTry1, psObTry2, fVmmRead, dwFlagsBitMask))) {
+    // 5: spider vad tree breadth-first / level-synchronous: all nodes of one
+    //    tree level are fetched in one prefetch (one device round trip) and
+    //    then parsed - which yields the nodes of the next tree level.
+    for(iLevel = 0; (iLevel < MMVAD_SPIDER_LEVEL_MAX) && (pmObVad->cMap < cMax) && ObVSet_Size(psObLevel); iLevel++) {
+        VmmCachePrefetchPages3(pSystemProcess, psObLevel, sizeof(_MMVAD64_10), fVmmRead);
+        while((pmObVad->cMap < cMax) && (va = ObVSet_Pop(psObLevel))) {
+            if((eVad = pfnMmVad_Spider(pSystemProcess, va, pmObVad, psObAll, psObLevelNext, NULL, fVmmRead, dwFlagsBitMask))) {
                 eVad->vaVad = va;
                 eVad->wszText = &ctxVmm->_EmptyWCHAR;
                 if(eVad->cbPrototypePte > 0x01000000) { eVad->cbPrototypePte = MMVAD_PTESIZE * (DWORD)((0x1000 + eVad->vaEnd - eVad->vaStart) >> 12); }
             }
         }
+        psObSwap = psObLevel;
+        psObLevel = psObLevelNext;
+        psObLevelNext = psObSwap;
     }
     // 6: sort result
     if(pmObVad->cMap > 1) {
@@ -792,8 +781,8 @@ VOID MmVad_Spider_DoWork(_In_ PVMM_PROCESS pSystemProcess, _In_ PVMM_PROCESS pPr
 fail:
     Ob_DECREF(pmObVad);
     Ob_DECREF(psObAll);
-    Ob_DECREF(psObTry1);
-    Ob_DECREF(psObTry2);
+    Ob_DECREF(psObLevel);
+    Ob_DECREF(psObLevelNext);
 }
 
 /*
@@ -962,35 +951,108 @@ fail:
     LocalFree(pva);
 }
 
-_Success_(return)
-BOOL MmVad_PrototypePteArray_FetchNew_PoolHdrVerify(_In_ PBYTE pb, _In_ DWORD cbDataOffsetPoolHdr)
+/*
+* Retrieve a prototype pte array from the two-generation cache. A hit in the
+* previous (cold) generation promotes the array into the current (hot) one.
+* CALLER DECREF: return
+* -- vaPrototypePte
+* -- return
+*/
+POB_DATA MmVad_PrototypePteArray_CacheGet(_In_ QWORD vaPrototypePte)
 {
-    DWORD o;
-    if(cbDataOffsetPoolHdr < 0x10) {
-        return !cbDataOffsetPoolHdr || ('tSmM' == *(PDWORD)pb);
+    POB_DATA e;
+    BOOL fCold;
+    AcquireSRWLockShared(&ctxVmm->Cache.PrototypePte.LockSRW);
+    e = ObMap_GetByKey(ctxVmm->Cache.PrototypePte.pmHot, vaPrototypePte);
+    fCold = !e && ObMap_Size(ctxVmm->Cache.PrototypePte.pmCold);
+    ReleaseSRWLockShared(&ctxVmm->Cache.PrototypePte.LockSRW);
+    if(!fCold) { return e; }
+    AcquireSRWLockExclusive(&ctxVmm->Cache.PrototypePte.LockSRW);
+    if(!(e = ObMap_GetByKey(ctxVmm->Cache.PrototypePte.pmHot, vaPrototypePte)) && (e = ObMap_RemoveByKey(ctxVmm->Cache.PrototypePte.pmCold, vaPrototypePte))) {
+        ctxVmm->Cache.PrototypePte.cbCold -= MMVAD_PROTOTYPEPTE_CACHE_COST(e);
+        if(ObMap_Push(ctxVmm->Cache.PrototypePte.pmHot, vaPrototypePte, e)) {
+            ctxVmm->Cache.PrototypePte.cbHot += MMVAD_PROTOTYPEPTE_CACHE_COST(e);
+        }
     }
-    for(o = 0; o < cbDataOffsetPoolHdr; o += 4) {
-        if('tSmM' == *(PDWORD)(pb + o)) { return TRUE; }    // check for MmSt pool header in various locations
+    ReleaseSRWLockExclusive(&ctxVmm->Cache.PrototypePte.LockSRW);
+    return e;
+}
+
+/*
+* Check whether a prototype pte array exists in any cache generation. The
+* generation maps are rotated (and the cold map freed) by CachePush - they must
+* only be accessed with the lock held.
+* -- vaPrototypePte
+* -- return
+*/
+BOOL MmVad_PrototypePteArray_CacheExists(_In_ QWORD vaPrototypePte)
+{
+    BOOL fResult;
+    AcquireSRWLockShared(&ctxVmm->Cache.PrototypePte.LockSRW);
+    fResult =
+        ObMap_ExistsKey(ctxVmm->Cache.PrototypePte.pmHot, vaPrototypePte) ||
+        ObMap_ExistsKey(ctxVmm->Cache.PrototypePte.pmCold, vaPrototypePte);
+    ReleaseSRWLockShared(&ctxVmm->Cache.PrototypePte.LockSRW);
+    return fResult;
+}
+
+/*
+* Insert a prototype pte array into the current cache generation. If the hot
+* generation exceeds half of the memory budget the cold generation is dropped
+* and replaced by the hot one - bounding the cache to the budget while keeping
+* recently used arrays (approximate lru).
+* -- vaPrototypePte
+* -- e
+*/
+VOID MmVad_PrototypePteArray_CachePush(_In_ QWORD vaPrototypePte, _In_ POB_DATA e)
+{
+    QWORD cb = MMVAD_PROTOTYPEPTE_CACHE_COST(e);
+    POB_MAP pmObNew;
+    POB_DATA eObOld;
+    AcquireSRWLockExclusive(&ctxVmm->Cache.PrototypePte.LockSRW);
+    if((eObOld = ObMap_RemoveByKey(ctxVmm->Cache.PrototypePte.pmCold, vaPrototypePte))) {
+        ctxVmm->Cache.PrototypePte.cbCold -= MMVAD_PROTOTYPEPTE_CACHE_COST(eObOld);
+        Ob_DECREF(eObOld);
+    }
+    if(ctxVmm->Cache.PrototypePte.cbHot + cb > (ctxVmm->Cache.PrototypePte.cbMax >> 1)) {
+        // rotate generations - a new map is allocated since ObMap_Clear() keeps its memory
+        ctxVmm->stat.cPrototypePteCacheEvict += ObMap_Size(ctxVmm->Cache.PrototypePte.pmCold);
+        if((pmObNew = ObMap_New(OB_MAP_FLAGS_OBJECT_OB | OB_MAP_FLAGS_SHARDED))) {
+            Ob_DECREF(ctxVmm->Cache.PrototypePte.pmCold);
+        } else {
+            pmObNew = ctxVmm->Cache.PrototypePte.pmCold;
+            ObMap_Clear(pmObNew);
+        }
+        ctxVmm->Cache.PrototypePte.pmCold = ctxVmm->Cache.PrototypePte.pmHot;
+        ctxVmm->Cache.PrototypePte.pmHot = pmObNew;
+        ctxVmm->Cache.PrototypePte.cbCold = ctxVmm->Cache.PrototypePte.cbHot;
+        ctxVmm->Cache.PrototypePte.cbHot = 0;
     }
-    return FALSE;
+    if(ObMap_Push(ctxVmm->Cache.PrototypePte.pmHot, vaPrototypePte, e)) {
+        ctxVmm->Cache.PrototypePte.cbHot += cb;
+    }
+    ReleaseSRWLockExclusive(&ctxVmm->Cache.PrototypePte.LockSRW);
 }
 
 /*
-* Fetch an array of prototype pte's into the cache.
-* -- pSystemProcess
+* Retrieve the virtual address range (including any pool header) that should
+* be read to fetch the prototype pte array of a vad.
 * -- pVad
-* -- fVmmRead
+* -- pva = address to read from.
+* -- pcb = number of bytes to read (including pool header).
+* -- pcbPoolHdr = number of leading pool header bytes.
+* -- return
 */
-VOID MmVad_PrototypePteArray_FetchNew(_In_ PVMM_PROCESS pSystemProcess, _In_ PVMM_MAP_VADENTRY pVad, _In_ QWORD fVmmRead)
+_Success_(return)
+BOOL MmVad_PrototypePteArray_Range(_In_ PVMM_MAP_VADENTRY pVad, _Out_ PQWORD pva, _Out_ PDWORD pcb, _Out_ PDWORD pcbPoolHdr)
 {
-    PBYTE pbData;
-    POB_DATA e = NULL;
     DWORD cbData, cbDataOffsetPoolHdr = 0;
+    if(!pVad->vaPrototypePte || !pVad->cbPrototypePte) { return FALSE; }
     cbData = pVad->cbPrototypePte;
     // 1: santity check size
     if(cbData > 0x00010000) {   // most probably an error, file > 32MB
         cbData = MMVAD_PTESIZE * (DWORD)((0x1000 + pVad->vaEnd - pVad->vaStart) >> 12);
-        if(cbData > 0x00010000) { return; }
+        if(cbData > 0x00010000) { return FALSE; }
     }
     // 2: pool header offset (if any)
     if(pVad->vaPrototypePte & 0xfff) {
@@ -1003,29 +1065,109 @@ VOID MmVad_PrototypePteArray_FetchNew(_In_ PVMM_PROCESS pSystemProcess, _In_ PVM
         }
         cbData += cbDataOffsetPoolHdr;
     }
-    // 3: fetch prototype page table entries
-    if(!(pbData = LocalAlloc(0, cbData))) { return; }
-    if(VmmRead2(pSystemProcess, pVad->vaPrototypePte - cbDataOffsetPoolHdr, pbData, cbData, fVmmRead)) {
+    *pva = pVad->vaPrototypePte - cbDataOffsetPoolHdr;
+    *pcb = cbData;
+    *pcbPoolHdr = cbDataOffsetPoolHdr;
+    return TRUE;
+}
+
+_Success_(return)
+BOOL MmVad_PrototypePteArray_FetchNew_PoolHdrVerify(_In_ PBYTE pb, _In_ DWORD cbDataOffsetPoolHdr)
+{
+    DWORD o;
+    if(cbDataOffsetPoolHdr < 0x10) {
+        return !cbDataOffsetPoolHdr || ('tSmM' == *(PDWORD)pb);
+    }
+    for(o = 0; o < cbDataOffsetPoolHdr; o += 4) {
+        if('tSmM' == *(PDWORD)(pb + o)) { return TRUE; }    // check for MmSt pool header in various locations
+    }
+    return FALSE;
+}
+
+/*
+* Fetch an array of prototype pte's into the cache. Failed reads are cached as
+* empty arrays - unless VMM_FLAG_FORCECACHE_READ is set (prefetch) in which case
+* nothing is cached so that a later non-prefetch read may retry the array.
+* -- pSystemProcess
+* -- pVad
+* -- fVmmRead
+* -- return = TRUE if a non-empty array was cached.
+*/
+BOOL MmVad_PrototypePteArray_FetchNew(_In_ PVMM_PROCESS pSystemProcess, _In_ PVMM_MAP_VADENTRY pVad, _In_ QWORD fVmmRead)
+{
+    QWORD va;
+    PBYTE pbData;
+    POB_DATA e = NULL;
+    BOOL fResult = FALSE;
+    DWORD cbData, cbDataOffsetPoolHdr;
+    if(!MmVad_PrototypePteArray_Range(pVad, &va, &cbData, &cbDataOffsetPoolHdr)) { return FALSE; }
+    if(!(pbData = LocalAlloc(0, cbData))) { return FALSE; }
+    if(VmmRead2(pSystemProcess, va, pbData, cbData, fVmmRead)) {
         if(MmVad_PrototypePteArray_FetchNew_PoolHdrVerify(pbData, cbDataOffsetPoolHdr)) {
             if((e = Ob_Alloc('MmSt', 0, sizeof(OB) + cbData - cbDataOffsetPoolHdr, NULL, NULL))) {
                 memcpy(e->pb, pbData + cbDataOffsetPoolHdr, cbData - cbDataOffsetPoolHdr);
+                fResult = TRUE;
             }
         }
     }
-    if(!e) {
+    if(!e && !(fVmmRead & VMM_FLAG_FORCECACHE_READ)) {
         e = Ob_Alloc('MmSt', 0, sizeof(OB), NULL, NULL);
     }
     if(e) {
-        ObMap_Push(ctxVmm->Cache.pmPrototypePte, pVad->vaPrototypePte, e);
+        MmVad_PrototypePteArray_CachePush(pVad->vaPrototypePte, e);
         Ob_DECREF(e);
     }
     LocalFree(pbData);
+    return fResult;
+}
+
+/*
+* Fetch the prototype pte arrays of the vads surrounding a missed vad in one
+* scatter read. Arrays already cached are skipped and the total prefetched
+* size is bounded.
+* -- pSystemProcess
+* -- pVadMap
+* -- pVad = the missed vad - must be an entry of pVadMap.
+* -- fVmmRead
+*/
+VOID MmVad_PrototypePteArray_FetchNeighbours(_In_ PVMM_PROCESS pSystemProcess, _In_ PVMMOB_MAP_VAD pVadMap, _In_ PVMM_MAP_VADENTRY pVad, _In_ QWORD fVmmRead)
+{
+    QWORD i, iVad, iMin, iMax, va, cbPrefetch = 0;
+    DWORD cb, cbPoolHdr;
+    PVMM_MAP_VADENTRY pe;
+    POB_VSET psObPrefetch = NULL;
+    if((pVad < pVadMap->pMap) || (pVad >= pVadMap->pMap + pVadMap->cMap)) { return; }
+    if(!(psObPrefetch = ObVSet_New())) { return; }
+    iVad = pVad - pVadMap->pMap;
+    iMin = (iVad > MMVAD_PROTOTYPEPTE_PREFETCH_VADS) ? (iVad - MMVAD_PROTOTYPEPTE_PREFETCH_VADS) : 0;
+    iMax = min(pVadMap->cMap, iVad + MMVAD_PROTOTYPEPTE_PREFETCH_VADS + 1);
+    // 1: collect missing arrays - the missed vad is always included
+    for(i = iMin; i < iMax; i++) {
+        pe = pVadMap->pMap + i;
+        if(!MmVad_PrototypePteArray_Range(pe, &va, &cb, &cbPoolHdr)) { continue; }
+        if((i != iVad) && ((cbPrefetch + cb > MMVAD_PROTOTYPEPTE_PREFETCH_MAX) || MmVad_PrototypePteArray_CacheExists(pe->vaPrototypePte))) { continue; }
+        ObVSet_Push_PageAlign(psObPrefetch, va, cb);
+        cbPrefetch += cb;
+    }
+    // 2: read missing arrays in one scatter read and populate cache from it
+    if(ObVSet_Size(psObPrefetch) > 1) {
+        VmmCachePrefetchPages(pSystemProcess, psObPrefetch, fVmmRead);
+        for(i = iMin; i < iMax; i++) {
+            pe = pVadMap->pMap + i;
+            if(!pe->vaPrototypePte || !pe->cbPrototypePte || MmVad_PrototypePteArray_CacheExists(pe->vaPrototypePte)) { continue; }
+            if(MmVad_PrototypePteArray_FetchNew(pSystemProcess, pe, fVmmRead | VMM_FLAG_FORCECACHE_READ) && (i != iVad)) {
+                InterlockedIncrement64(&ctxVmm->stat.cPrototypePteCachePrefetch);
+            }
+        }
+    }
+    Ob_DECREF(psObPrefetch);
 }
 
 /*
 * Retrieve an object manager object containing the prototype pte's. THe object
 * will be retrieved from cache if possible, otherwise a read will be attempted
-* provided that the fVmmRead flags allows for it.
+* provided that the fVmmRead flags allows for it. On a cache miss the arrays of
+* neighbouring vads are prefetched alongside the requested one.
 * CALLER DECREF: return
 * -- pVad
 * -- fVmmRead
@@ -1033,49 +1175,34 @@ VOID MmVad_PrototypePteArray_FetchNew(_In_ PVMM_PROCESS pSystemProcess, _In_ PVM
 */
 POB_DATA MmVad_PrototypePteArray_Get(_In_ PVMM_PROCESS pProcess, _In_ PVMM_MAP_VADENTRY pVad, _In_ QWORD fVmmRead)
 {
-    QWORD i, va;
     POB_DATA e = NULL;
-    POB_VSET psObPrefetch = NULL;
     PVMM_PROCESS pObSystemProcess = NULL;
-    PVMMOB_MAP_VAD pVadMap;
     if(!pVad->vaPrototypePte || !pVad->cbPrototypePte) { return NULL; }
-    if((e = ObMap_GetByKey(ctxVmm->Cache.pmPrototypePte, pVad->vaPrototypePte))) { return e; }
+    if((e = MmVad_PrototypePteArray_CacheGet(pVad->vaPrototypePte))) {
+        InterlockedIncrement64(&ctxVmm->stat.cPrototypePteCacheHit);
+        return e;
+    }
     EnterCriticalSection(&pProcess->LockUpdate);
-    if((e = ObMap_GetByKey(ctxVmm->Cache.pmPrototypePte, pVad->vaPrototypePte))) {
+    if((e = MmVad_PrototypePteArray_CacheGet(pVad->vaPrototypePte))) {
         LeaveCriticalSection(&pProcess->LockUpdate);
+        InterlockedIncrement64(&ctxVmm->stat.cPrototypePteCacheHit);
         return e;
     }
+    InterlockedIncrement64(&ctxVmm->stat.cPrototypePteCacheMiss);
     if((pObSystemProcess = VmmProcessGet(4))) {
-        if(!pProcess->Map.pObVad->fSpiderPrototypePte && pVad->cbPrototypePte < 0x1000 && (psObPrefetch = ObVSet_New())) {
-            pVadMap = pProcess->Map.pObVad;
-            // spider all prototype pte's less than 0x1000 in size into the cache
-            pVadMap->fSpiderPrototypePte = TRUE;
-            for(i = 0; i < pVadMap->cMap; i++) {
-                va = pVadMap->pMap[i].vaPrototypePte;
-                if(va && (pVadMap->pMap[i].cbPrototypePte < 0x1000) && !ObMap_ExistsKey(ctxVmm->Cache.pmPrototypePte, va)) {
-                    ObVSet_Push(psObPrefetch, va);
-                }
-            }
-            VmmCachePrefetchPages3(pObSystemProcess, psObPrefetch, 0x1000, fVmmRead);
-            for(i = 0; i < pVadMap->cMap; i++) {
-                va = pVadMap->pMap[i].vaPrototypePte;
-                if(va && (pVadMap->pMap[i].cbPrototypePte < 0x1000) && !ObMap_ExistsKey(ctxVmm->Cache.pmPrototypePte, va)) {
-                    MmVad_PrototypePteArray_FetchNew(pObSystemProcess, pVadMap->pMap + i, fVmmRead | VMM_FLAG_FORCECACHE_READ);
-                }
-            }
-            Ob_DECREF(psObPrefetch);
-        } else {
-            // fetch single vad prototypte pte array into the cache
+        MmVad_PrototypePteArray_FetchNeighbours(pObSystemProcess, pProcess->Map.pObVad, pVad, fVmmRead);
+        if(!(e = MmVad_PrototypePteArray_CacheGet(pVad->vaPrototypePte))) {
+            // prefetch skipped or failed - fetch single vad prototype pte array into the cache
             MmVad_PrototypePteArray_FetchNew(pObSystemProcess, pVad, fVmmRead);
+            e = MmVad_PrototypePteArray_CacheGet(pVad->vaPrototypePte);
         }
         Ob_DECREF(pObSystemProcess);
     }
     LeaveCriticalSection(&pProcess->LockUpdate);
-    return ObMap_GetByKey(ctxVmm->Cache.pmPrototypePte, pVad->vaPrototypePte);
+    return e;
 }
 
 
-
 // ----------------------------------------------------------------------------
 // IMPLEMENTATION OF VAD RELATED GENERAL FUNCTIONALITY BELOW:
 // ----------------------------------------------------------------------------
@@ -1119,7 +1246,9 @@ BOOL MmVad_MapInitialize_Core(_In_ PVMM_PROCESS pProcess, _In_ QWORD fVmmRead)
     if(!pProcess->Map.pObVad && (pObSystemProcess = VmmProcessGet(4))) {
         MmVad_Spider_DoWork(pObSystemProcess, pProcess, fVmmRead | VMM_FLAG_NOVAD);
         if(!pProcess->Map.pObVad) {
-            pProcess->Map.pObVad = Ob_Alloc(OB_TAG_MAP_VAD, LMEM_ZEROINIT, sizeof(VMMOB_MAP_VAD), VmmVad_MemMapVad_CloseObCallback, NULL);
+            if((pProcess->Map.pObVad = Ob_Alloc(OB_TAG_MAP_VAD, LMEM_ZEROINIT, sizeof(VMMOB_MAP_VAD), VmmVad_MemMapVad_CloseObCallback, NULL))) {
+                pProcess->Map.pObVad->qwGeneration = VmmGenerationNext();
+            }
         }
         Ob_DECREF(pObSystemProcess);
     }
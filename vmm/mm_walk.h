@@ -0,0 +1,136 @@
+// mm_walk.h : specialized page table walkers for virtual to physical address
+//             translation. The walkers are force-inlined with constant level
+//             shifts/masks and are instantiated per memory model and per
+//             user-only option by the MMWALK_DEFINE macro - resulting in
+//             branch-light non-recursive walks without any indirect calls.
+//
+// (c) Ulf Frisk, 2018-2019
+// Author: Ulf Frisk, pcileech@frizk.net
+//
+#ifndef __MM_WALK_H__
+#define __MM_WALK_H__
+#include "vmm.h"
+
+#define MMWALK_FAIL                     0
+#define MMWALK_LEAF                     1
+#define MMWALK_NEXT                     2
+
+#define MMWALK_X64_SHIFT(iPML)          (12 + 9 * ((iPML) - 1))
+#define MMWALK_X86PAE_SHIFT(iPML)       (12 + 9 * ((iPML) - 1))
+
+/*
+* Instantiate a specialized walker function 'name' from the force-inlined walk
+* 'walk' with the user-only option fixed at compile time.
+*/
+#define MMWALK_DEFINE(name, walk, fUserOnly)                                    \
+    _Success_(return)                                                           \
+    BOOL name(_In_ QWORD paDTB, _In_ QWORD va, _Out_ PQWORD ppa)                \
+    {                                                                           \
+        return walk(paDTB, fUserOnly, va, ppa);                                 \
+    }
+
+/*
+* Walk one level of a X64 / X86PAE 64-bit page table entry page. The iPML and
+* fUserOnly parameters are expected to be compile-time constants.
+* -- ppte = in: pte/dtb of the page table to walk, out: pte of next level.
+* -- fUserOnly
+* -- iPML
+* -- fPML4 = the walked level is a X64 PML4 (large pages not allowed).
+* -- va
+* -- ppa
+* -- return = MMWALK_FAIL / MMWALK_LEAF / MMWALK_NEXT
+*/
+__forceinline DWORD MmWalk_Level64(_Inout_ PQWORD ppte, _In_ BOOL fUserOnly, _In_ BYTE iPML, _In_ BOOL fPML4, _In_ QWORD va, _Out_ PQWORD ppa)
+{
+    QWORD pte, qwMask;
+    PVMMOB_MEM pObPTEs;
+    if(!(pObPTEs = VmmTlbGetPageTable(*ppte & 0x0000fffffffff000, FALSE))) { return MMWALK_FAIL; }
+    pte = pObPTEs->pqw[0x1ff & (va >> MMWALK_X64_SHIFT(iPML))];
+    Ob_DECREF(pObPTEs);
+    if(!(pte & 0x01)) {
+        if(iPML == 1) { *ppa = pte; }                       // NOT VALID
+        return MMWALK_FAIL;
+    }
+    if(fUserOnly && !(pte & 0x04)) { return MMWALK_FAIL; }  // SUPERVISOR PAGE & USER MODE REQ
+    if(pte & 0x000f000000000000) { return MMWALK_FAIL; }    // RESERVED
+    if((iPML == 1) || (pte & 0x80) /* PS */) {
+        if(fPML4) { return MMWALK_FAIL; }                   // NO SUPPORT IN PML4
+        qwMask = 0xffffffffffffffff << MMWALK_X64_SHIFT(iPML);
+        *ppa = (pte & 0x0000fffffffff000 & qwMask) | (~qwMask & va);
+        return MMWALK_LEAF;
+    }
+    *ppte = pte;
+    return MMWALK_NEXT;
+}
+
+/*
+* X64 4-level page table walk (4kB/2MB/1GB pages).
+*/
+__forceinline BOOL MmWalk_X64(_In_ QWORD paDTB, _In_ BOOL fUserOnly, _In_ QWORD va, _Out_ PQWORD ppa)
+{
+    DWORD r;
+    QWORD pte = paDTB;
+    if((r = MmWalk_Level64(&pte, fUserOnly, 4, TRUE, va, ppa)) != MMWALK_NEXT) { return r == MMWALK_LEAF; }
+    if((r = MmWalk_Level64(&pte, fUserOnly, 3, FALSE, va, ppa)) != MMWALK_NEXT) { return r == MMWALK_LEAF; }
+    if((r = MmWalk_Level64(&pte, fUserOnly, 2, FALSE, va, ppa)) != MMWALK_NEXT) { return r == MMWALK_LEAF; }
+    return MmWalk_Level64(&pte, fUserOnly, 1, FALSE, va, ppa) == MMWALK_LEAF;
+}
+
+/*
+* X86PAE 3-level page table walk (4kB/2MB pages) with a 4-entry PDPT.
+*/
+__forceinline BOOL MmWalk_X86PAE(_In_ QWORD paDTB, _In_ BOOL fUserOnly, _In_ QWORD va, _Out_ PQWORD ppa)
+{
+    DWORD r;
+    QWORD pte, i;
+    PVMMOB_MEM pObPTEs;
+    if(va > 0xffffffff) { return FALSE; }
+    if(!(pObPTEs = VmmTlbGetPageTable(paDTB & 0x0000fffffffff000, FALSE))) { return FALSE; }
+    i = 0x1ff & (va >> MMWALK_X86PAE_SHIFT(3));
+    if(i > 3) {                                             // MAX 4 ENTRIES IN PDPT
+        Ob_DECREF(pObPTEs);
+        return FALSE;
+    }
+    pte = ((PQWORD)(pObPTEs->pb + (paDTB & 0xfe0)))[i];     // ADJUST PDPT TO 32-BYTE BOUNDARY
+    Ob_DECREF(pObPTEs);
+    if(!(pte & 0x01)) { return FALSE; }                     // NOT VALID
+    if(pte & 0xffff0000000001e6) { return FALSE; }          // RESERVED BITS IN PDPTE
+    if((r = MmWalk_Level64(&pte, fUserOnly, 2, FALSE, va, ppa)) != MMWALK_NEXT) { return r == MMWALK_LEAF; }
+    return MmWalk_Level64(&pte, fUserOnly, 1, FALSE, va, ppa) == MMWALK_LEAF;
+}
+
+/*
+* X86 2-level page table walk (4kB/4MB pages).
+*/
+__forceinline BOOL MmWalk_X86(_In_ QWORD paDTB, _In_ BOOL fUserOnly, _In_ QWORD va, _Out_ PQWORD ppa)
+{
+    DWORD pte;
+    PVMMOB_MEM pObPTEs;
+    if(va > 0xffffffff) { return FALSE; }
+    if(paDTB > 0xffffffff) { return FALSE; }
+    // PD
+    if(!(pObPTEs = VmmTlbGetPageTable(paDTB & 0xfffff000, FALSE))) { return FALSE; }
+    pte = pObPTEs->pdw[0x3ff & (va >> 22)];
+    Ob_DECREF(pObPTEs);
+    if(!(pte & 0x01)) { return FALSE; }                     // NOT VALID
+    if(fUserOnly && !(pte & 0x04)) { return FALSE; }        // SUPERVISOR PAGE & USER MODE REQ
+    if(pte & 0x80 /* PS */) {
+        // 4MB PAGE
+        if(pte & 0x003e0000) { return FALSE; }              // RESERVED
+        *ppa = (((QWORD)(pte & 0x0001e000)) << (32 - 13)) + (pte & 0xffc00000) + (va & 0x003ff000);
+        return TRUE;
+    }
+    // PT
+    if(!(pObPTEs = VmmTlbGetPageTable(pte & 0xfffff000, FALSE))) { return FALSE; }
+    pte = pObPTEs->pdw[0x3ff & (va >> 12)];
+    Ob_DECREF(pObPTEs);
+    if(!(pte & 0x01)) {
+        *ppa = pte;                                         // NOT VALID
+        return FALSE;
+    }
+    if(fUserOnly && !(pte & 0x04)) { return FALSE; }        // SUPERVISOR PAGE & USER MODE REQ
+    *ppa = pte & 0xfffff000;                                // 4kB PAGE
+    return TRUE;
+}
+
+#endif /* __MM_WALK_H__ */
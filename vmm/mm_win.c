@@ -9,6 +9,7 @@
 #include "pe.h"
 #include "statistics.h"
 #include "util.h"
+#include "xpress.h"
 
 #define MM_BUILD_17134_LATER                        (ctxVmm->kernel.dwVersionBuild >= 17134)
 #define MM_LOOP_PROTECT_ADD(flags)                  ((flags & ~0x00ff0000) | ((((flags >> 16) & 0xff) + 1) << 16))
@@ -64,12 +65,53 @@ typedef struct tdMMWIN_MEMCOMPRESS_CONTEXT {
     MMWIN_MEMCOMPRESS_OFFSET O;
 } MMWIN_MEMCOMPRESS_CONTEXT, *PMMWIN_MEMCOMPRESS_CONTEXT;
 
+#define MMWIN_PAGEFILE_SCATTER_MAX              0x40
+
+/*
+* Set of completion events for overlapped page file reads. Sets are recycled
+* through a lock-free list in the paging context rather than created per read.
+*/
+typedef struct tdMMWIN_PAGEFILE_EVENTS {
+    SLIST_ENTRY ListEntry;
+    DWORD cEvents;
+    HANDLE hEvents[MMWIN_PAGEFILE_SCATTER_MAX];
+} MMWIN_PAGEFILE_EVENTS, *PMMWIN_PAGEFILE_EVENTS;
+
 typedef struct tdMMWIN_CONTEXT {
-    CRITICAL_SECTION Lock;
-    FILE *pPageFile[10];
+    CRITICAL_SECTION LockUpdate;            // memory compression initialization
+    HANDLE hPageFile[10];                   // opened with FILE_FLAG_OVERLAPPED
+    SLIST_HEADER ListPageFileEvents;        // free MMWIN_PAGEFILE_EVENTS
     MMWIN_MEMCOMPRESS_CONTEXT MemCompress;
+    POB_MAP pmObMemCompressStore;           // k: iSmkm+1, v: MMWINOB_MEMCOMPRESS_STORE
+    POB_MAP pmObMemCompressBTreeNode;       // k: va, v: MMWINOB_MEMCOMPRESS_BTREE_NODE
 } MMWIN_CONTEXT, *PMMWIN_CONTEXT;
 
+#define MMWIN_MEMCOMPRESS_BTREE_NODE_MAX        0x400
+#define MMWIN_MEMCOMPRESS_STORE_MAX             0x400
+#define MMWIN_MEMCOMPRESS_SCATTER_WORKERS_MAX   5
+#define MMWIN_MEMCOMPRESS_SCATTER_PAGES_THREAD  4
+
+/*
+* Cached B-tree node (one page) in the memory compression store trees and the
+* cached metadata of a SMKM store. Objects are valid as long as the physical
+* memory cache generation is unchanged - i.e. until the next refresh.
+*/
+typedef struct tdMMWINOB_MEMCOMPRESS_BTREE_NODE {
+    OB ObHdr;
+    DWORD dwGeneration;
+    DWORD _Filler;
+    BYTE pb[0x1000];
+} MMWINOB_MEMCOMPRESS_BTREE_NODE, *PMMWINOB_MEMCOMPRESS_BTREE_NODE;
+
+typedef struct tdMMWINOB_MEMCOMPRESS_STORE {
+    OB ObHdr;
+    DWORD dwGeneration;
+    DWORD iSmkm;
+    QWORD vaSmkmStore;
+    QWORD vaEPROCESS;
+    BYTE pbSmkm[0x2000];
+} MMWINOB_MEMCOMPRESS_STORE, *PMMWINOB_MEMCOMPRESS_STORE;
+
 //-----------------------------------------------------------------------------
 // BTREE FUNCTIONALITY BELOW:
 //-----------------------------------------------------------------------------
@@ -111,6 +153,48 @@ typedef struct td_BTREE64 {
     };
 } _BTREE64, *P_BTREE64;
 
+/*
+* Read a 0x1000 byte B-tree node. Nodes are cached until the next refresh (as
+* indicated by a changed physical memory cache generation) unless the read is
+* made with VMM_FLAG_NOCACHE.
+* -- pProcess
+* -- vaNode
+* -- pbNode
+* -- fVmmRead
+* -- return
+*/
+_Success_(return)
+BOOL MmWin_BTree_ReadNode(_In_ PVMM_PROCESS pProcess, _In_ QWORD vaNode, _Out_writes_(0x1000) PBYTE pbNode, _In_ QWORD fVmmRead)
+{
+    DWORD dwGeneration;
+    POB_MAP pmNode = ctxVmm->pMmContext ? ((PMMWIN_CONTEXT)ctxVmm->pMmContext)->pmObMemCompressBTreeNode : NULL;
+    PMMWINOB_MEMCOMPRESS_BTREE_NODE pObNode;
+    if(!pmNode || (fVmmRead & VMM_FLAG_NOCACHE)) {
+        return VmmRead2(pProcess, vaNode, pbNode, 0x1000, fVmmRead);
+    }
+    dwGeneration = ctxVmm->Cache.PHYS.dwGeneration;
+    if((pObNode = ObMap_GetByKey(pmNode, vaNode))) {
+        if(pObNode->dwGeneration == dwGeneration) {
+            memcpy(pbNode, pObNode->pb, 0x1000);
+            Ob_DECREF(pObNode);
+            return TRUE;
+        }
+        Ob_DECREF(pObNode);
+        Ob_DECREF(ObMap_RemoveByKey(pmNode, vaNode));
+    }
+    if(!VmmRead2(pProcess, vaNode, pbNode, 0x1000, fVmmRead)) { return FALSE; }
+    if((pObNode = Ob_Alloc('MmBt', 0, sizeof(MMWINOB_MEMCOMPRESS_BTREE_NODE), NULL, NULL))) {
+        pObNode->dwGeneration = dwGeneration;
+        memcpy(pObNode->pb, pbNode, 0x1000);
+        if(ObMap_Size(pmNode) >= MMWIN_MEMCOMPRESS_BTREE_NODE_MAX) {
+            ObMap_Clear(pmNode);
+        }
+        ObMap_Push(pmNode, vaNode, pObNode);
+        Ob_DECREF(pObNode);
+    }
+    return TRUE;
+}
+
 _Success_(return)
 BOOL MmWin_BTree32_Search(_In_ PVMM_PROCESS pProcess, _In_ QWORD vaTree, _In_ DWORD dwKey, _Out_ PDWORD pdwValue, _In_ QWORD fVmmRead);
 
@@ -262,7 +346,7 @@ BOOL MmWin_BTree32_Search(_In_ PVMM_PROCESS pProcess, _In_ QWORD vaTree, _In_ DW
     // 1: read tree
     f = !MM_LOOP_PROTECT_MAX(fVmmRead) &&
         VMM_KADDR32_PAGE(vaTree) &&
-        VmmRead2(pProcess, vaTree, pbBuffer, 0x1000, fVmmRead) &&
+        MmWin_BTree_ReadNode(pProcess, vaTree, pbBuffer, fVmmRead) &&
         pT->cEntries;
     if(!f) { return FALSE; }
     if(pT->fLeaf) {
@@ -285,7 +369,7 @@ BOOL MmWin_BTree64_Search(_In_ PVMM_PROCESS pProcess, _In_ QWORD vaTree, _In_ DW
     // 1: read tree
     f = !MM_LOOP_PROTECT_MAX(fVmmRead) &&
         VMM_KADDR64_PAGE(vaTree) &&
-        VmmRead2(pProcess, vaTree, pbBuffer, 0x1000, fVmmRead) &&
+        MmWin_BTree_ReadNode(pProcess, vaTree, pbBuffer, fVmmRead) &&
         pT->cEntries;
     if(!f) { return FALSE; }
     if(pT->fLeaf) {
@@ -489,7 +573,7 @@ VOID MmWin_MemCompress_Initialize_NoPdb64()
     PVMM_PROCESS pObSystemProcess = NULL;
     POB_VSET pObSet = NULL;
     PMMWIN_CONTEXT ctx = (PMMWIN_CONTEXT)ctxVmm->pMmContext;
-    EnterCriticalSection(&ctxVmm->MasterLock);
+    EnterCriticalSection(&ctx->LockUpdate);
     if(ctx->MemCompress.fInitialized || (ctxVmm->kernel.dwVersionBuild < 14393)) { goto finish; }
     // 1: Locate SmGlobals candidates in ntoskrnl.exe!CACHEALI section
     if(!(pObSystemProcess = VmmProcessGet(4))) { goto finish; }
@@ -533,8 +617,8 @@ VOID MmWin_MemCompress_Initialize_NoPdb64()
         }
     }
 finish:
-    LeaveCriticalSection(&ctxVmm->MasterLock);
     ctx->MemCompress.fInitialized = TRUE;
+    LeaveCriticalSection(&ctx->LockUpdate);
     Ob_DECREF(pObSystemProcess);
     Ob_DECREF(pObSet);
 }
@@ -606,6 +690,7 @@ typedef struct tdMMWINX64_COMPRESS_CONTEXT {
         QWORD vaSmkmStore;
         QWORD vaEPROCESS;
         QWORD vaOwnerEPROCESS;
+        BOOL fSmkmCached;                   // pbSmkm, vaSmkmStore and vaEPROCESS retrieved from store cache
         BYTE pbSmkm[0x2000];
         DWORD dwRegionKey;
         QWORD vaPageRecord;
@@ -743,8 +828,8 @@ BOOL MmWin_MemCompress3_SmkmStoreAndPageRecord32(_In_ PMMWINX64_COMPRESS_CONTEXT
     DWORD i, dwEncodedMetadata, iChunkPtr = 0, iChunkArray, dwPoolHdr = 0;
     P_SMHP_CHUNK_METADATA32 pc;
     PMMWIN_MEMCOMPRESS_OFFSET po = &((PMMWIN_CONTEXT)ctxVmm->pMmContext)->MemCompress.O;
-    // 1: Load SmkmStore
-    if(!VmmRead2(ctx->pSystemProcess, ctx->e.vaSmkmStore, ctx->e.pbSmkm, sizeof(ctx->e.pbSmkm), ctx->fVmmRead)) {
+    // 1: Load SmkmStore (if not already cached)
+    if(!ctx->e.fSmkmCached && !VmmRead2(ctx->pSystemProcess, ctx->e.vaSmkmStore, ctx->e.pbSmkm, sizeof(ctx->e.pbSmkm), ctx->fVmmRead)) {
         return MmWin_MemCompress_LogError(ctx, "#31 ReadSmkmStore");
     }
     // 2: Validate
@@ -805,8 +890,8 @@ BOOL MmWin_MemCompress3_SmkmStoreAndPageRecord64(_In_ PMMWINX64_COMPRESS_CONTEXT
     DWORD i, dwEncodedMetadata, iChunkPtr = 0, iChunkArray, dwPoolHdr = 0;
     P_SMHP_CHUNK_METADATA64 pc;
     PMMWIN_MEMCOMPRESS_OFFSET po = &((PMMWIN_CONTEXT)ctxVmm->pMmContext)->MemCompress.O;
-    // 1: Load SmkmStore
-    if(!VmmRead2(ctx->pSystemProcess, ctx->e.vaSmkmStore, ctx->e.pbSmkm, sizeof(ctx->e.pbSmkm), ctx->fVmmRead)) {
+    // 1: Load SmkmStore (if not already cached)
+    if(!ctx->e.fSmkmCached && !VmmRead2(ctx->pSystemProcess, ctx->e.vaSmkmStore, ctx->e.pbSmkm, sizeof(ctx->e.pbSmkm), ctx->fVmmRead)) {
         return MmWin_MemCompress_LogError(ctx, "#31 ReadSmkmStore");
     }
     // 2: Validate
@@ -924,7 +1009,7 @@ BOOL MmWin_MemCompress5_DecompressPage(_In_ PMMWINX64_COMPRESS_CONTEXT ctx, _Out
     if(ctx->e.cbCompressedData == 0x1000) {
         memcpy(pbDecompressedPage, ctx->e.pbCompressedData, 0x1000);
     } else {
-        if((VMM_STATUS_SUCCESS != ctxVmm->fn.RtlDecompressBuffer(COMPRESS_ALGORITHM_XPRESS, pbDecompressedPage, 0x1000, ctx->e.pbCompressedData, ctx->e.cbCompressedData, &cbDecompressed)) || (cbDecompressed != 0x1000)) {
+        if(!Xpress_Decompress(ctx->e.pbCompressedData, ctx->e.cbCompressedData, pbDecompressedPage, 0x1000, &cbDecompressed) || (cbDecompressed != 0x1000)) {
             return MmWin_MemCompress_LogError(ctx, "#52 Decompress");
         }
     }
@@ -932,54 +1017,183 @@ BOOL MmWin_MemCompress5_DecompressPage(_In_ PMMWINX64_COMPRESS_CONTEXT ctx, _Out
 }
 
 /*
-* Decompress a page.
-* -- pProcess
-* -- pMEM
-* -- fVmmRead = flags to VmmRead function calls.
-* -- return
+* Retrieve the SmkmStore, its virtual address and the EPROCESS from the store
+* metadata cache - replacing steps #2 and the SmkmStore read in step #3. Cache
+* entries are valid until the physical memory cache generation changes.
+* -- ctx
+* -- return = TRUE if found in cache (ctx->e.fSmkmCached is set), FALSE otherwise.
 */
 _Success_(return)
-BOOL MmWin_MemCompress(_In_ PVMM_PROCESS pProcess, _In_ QWORD va, _In_ QWORD pte, _Out_writes_(4096) PBYTE pbPage, _In_ QWORD fVmmRead)
+BOOL MmWin_MemCompress_StoreCacheGet(_In_ PMMWINX64_COMPRESS_CONTEXT ctx)
 {
-    BOOL fResult = FALSE;
-    PMMWINX64_COMPRESS_CONTEXT ctx = NULL;
-    PVMM_PROCESS pObSystemProcess = NULL, pObMemCompressProcess = NULL;
-    QWORD tm = Statistics_CallStart();
-    if(!(ctx = LocalAlloc(LMEM_ZEROINIT, sizeof(MMWINX64_COMPRESS_CONTEXT)))) { goto fail; }
-    ctx->fVmmRead = fVmmRead;
+    PMMWINOB_MEMCOMPRESS_STORE pObStore;
+    POB_MAP pmStore = ((PMMWIN_CONTEXT)ctxVmm->pMmContext)->pmObMemCompressStore;
+    ctx->e.fSmkmCached = FALSE;
+    if(!pmStore || (ctx->fVmmRead & VMM_FLAG_NOCACHE)) { return FALSE; }
+    if(!(pObStore = ObMap_GetByKey(pmStore, (QWORD)ctx->e.iSmkm + 1))) { return FALSE; }
+    if(pObStore->dwGeneration == ctxVmm->Cache.PHYS.dwGeneration) {
+        ctx->e.vaSmkmStore = pObStore->vaSmkmStore;
+        ctx->e.vaEPROCESS = pObStore->vaEPROCESS;
+        memcpy(ctx->e.pbSmkm, pObStore->pbSmkm, sizeof(ctx->e.pbSmkm));
+        ctx->e.fSmkmCached = TRUE;
+    }
+    Ob_DECREF(pObStore);
+    return ctx->e.fSmkmCached;
+}
+
+/*
+* Insert a successfully retrieved and validated SmkmStore into the cache.
+* -- ctx
+* -- dwGeneration = physical memory cache generation at time of retrieval.
+*/
+VOID MmWin_MemCompress_StoreCachePut(_In_ PMMWINX64_COMPRESS_CONTEXT ctx, _In_ DWORD dwGeneration)
+{
+    PMMWINOB_MEMCOMPRESS_STORE pObStore;
+    POB_MAP pmStore = ((PMMWIN_CONTEXT)ctxVmm->pMmContext)->pmObMemCompressStore;
+    if(!pmStore || ctx->e.fSmkmCached || (ctx->fVmmRead & VMM_FLAG_NOCACHE)) { return; }
+    if(!(pObStore = Ob_Alloc('MmCs', 0, sizeof(MMWINOB_MEMCOMPRESS_STORE), NULL, NULL))) { return; }
+    pObStore->dwGeneration = dwGeneration;
+    pObStore->iSmkm = ctx->e.iSmkm;
+    pObStore->vaSmkmStore = ctx->e.vaSmkmStore;
+    pObStore->vaEPROCESS = ctx->e.vaEPROCESS;
+    memcpy(pObStore->pbSmkm, ctx->e.pbSmkm, sizeof(pObStore->pbSmkm));
+    Ob_DECREF(ObMap_RemoveByKey(pmStore, (QWORD)ctx->e.iSmkm + 1));
+    if(ObMap_Size(pmStore) >= MMWIN_MEMCOMPRESS_STORE_MAX) {
+        ObMap_Clear(pmStore);
+    }
+    ObMap_Push(pmStore, (QWORD)ctx->e.iSmkm + 1, pObStore);
+    Ob_DECREF(pObStore);
+}
+
+/*
+* Initialize the per-page items of an already allocated compression context.
+* -- ctx
+* -- va
+* -- pte
+*/
+VOID MmWin_MemCompress_PrepareContext(_In_ PMMWINX64_COMPRESS_CONTEXT ctx, _In_ QWORD va, _In_ QWORD pte)
+{
+    ZeroMemory(&ctx->e, sizeof(ctx->e));
     ctx->e.va = va;
     ctx->e.PTE = pte;
+    ctx->e.dwPageKey = ctxVmm->f32 ? MMWINX86PAE_PTE_PAGE_KEY_COMPRESSED(pte) : MMWINX64_PTE_PAGE_KEY_COMPRESSED(pte);
+}
+
+/*
+* Decompress a page given a prepared compression context in which the process,
+* system process and memory compression process are already resolved.
+* -- ctx
+* -- pbPage
+* -- return
+*/
+_Success_(return)
+BOOL MmWin_MemCompress_DoWork(_In_ PMMWINX64_COMPRESS_CONTEXT ctx, _Out_writes_(4096) PBYTE pbPage)
+{
+    BOOL f, fCached;
+    DWORD dwGeneration = ctxVmm->Cache.PHYS.dwGeneration;
+    if(!MmWin_MemCompress1_SmkmStoreIndex(ctx)) { return FALSE; }
+    fCached = MmWin_MemCompress_StoreCacheGet(ctx);
     if(ctxVmm->f32) {
         // 32-bit system
-        ctx->e.dwPageKey = MMWINX86PAE_PTE_PAGE_KEY_COMPRESSED(pte);
-        fResult =
-            (ctx->pProcess = pProcess) &&
-            (ctx->pSystemProcess = pObSystemProcess = VmmProcessGet(4)) &&
-            (ctx->pProcessMemCompress = pObMemCompressProcess = VmmProcessGet(((PMMWIN_CONTEXT)ctxVmm->pMmContext)->MemCompress.dwPid)) &&
-            MmWin_MemCompress1_SmkmStoreIndex(ctx) &&
-            MmWin_MemCompress2_SmkmStoreMetadata32(ctx) &&
-            MmWin_MemCompress3_SmkmStoreAndPageRecord32(ctx) &&
-            MmWin_MemCompress4_CompressedRegionData(ctx) &&
-            MmWin_MemCompress5_DecompressPage(ctx, pbPage);
+        f = (fCached || MmWin_MemCompress2_SmkmStoreMetadata32(ctx)) &&
+            MmWin_MemCompress3_SmkmStoreAndPageRecord32(ctx);
     } else {
         // 64-bit system
-        ctx->e.dwPageKey = MMWINX64_PTE_PAGE_KEY_COMPRESSED(pte);
-        fResult =
-            (ctx->pProcess = pProcess) &&
-            (ctx->pSystemProcess = pObSystemProcess = VmmProcessGet(4)) &&
-            (ctx->pProcessMemCompress = pObMemCompressProcess = VmmProcessGet(((PMMWIN_CONTEXT)ctxVmm->pMmContext)->MemCompress.dwPid)) &&
-            MmWin_MemCompress1_SmkmStoreIndex(ctx) &&
-            MmWin_MemCompress2_SmkmStoreMetadata64(ctx) &&
-            MmWin_MemCompress3_SmkmStoreAndPageRecord64(ctx) &&
-            MmWin_MemCompress4_CompressedRegionData(ctx) &&
-            MmWin_MemCompress5_DecompressPage(ctx, pbPage);
+        f = (fCached || MmWin_MemCompress2_SmkmStoreMetadata64(ctx)) &&
+            MmWin_MemCompress3_SmkmStoreAndPageRecord64(ctx);
+    }
+    if(!f) { return FALSE; }
+    if(!fCached) {
+        MmWin_MemCompress_StoreCachePut(ctx, dwGeneration);
+    }
+    return
+        MmWin_MemCompress4_CompressedRegionData(ctx) &&
+        MmWin_MemCompress5_DecompressPage(ctx, pbPage);
+}
+
+typedef struct tdMMWIN_MEMCOMPRESS_SCATTER_ENTRY {
+    QWORD va;
+    QWORD pte;
+    PBYTE pbPage;
+    BOOL fResult;
+    DWORD _Filler;
+} MMWIN_MEMCOMPRESS_SCATTER_ENTRY, *PMMWIN_MEMCOMPRESS_SCATTER_ENTRY;
+
+typedef struct tdMMWIN_MEMCOMPRESS_SCATTER_CONTEXT {
+    QWORD fVmmRead;
+    PVMM_PROCESS pProcess;
+    PVMM_PROCESS pSystemProcess;
+    PVMM_PROCESS pProcessMemCompress;
+    volatile LONG iPage;
+    DWORD cPages;
+    PMMWIN_MEMCOMPRESS_SCATTER_ENTRY pPages;
+} MMWIN_MEMCOMPRESS_SCATTER_CONTEXT, *PMMWIN_MEMCOMPRESS_SCATTER_CONTEXT;
+
+/*
+* Worker function for MmWin_MemCompressScatter. Pages are pulled from the
+* shared scatter context until no pages remain. The function is executed as
+* work pool items on the calling thread and on any idle work pool threads.
+* -- ctxS
+* -- iWorker
+*/
+VOID MmWin_MemCompressScatter_WorkerCB(_In_ PMMWIN_MEMCOMPRESS_SCATTER_CONTEXT ctxS, _In_ DWORD iWorker)
+{
+    DWORD i;
+    QWORD tm;
+    PMMWIN_MEMCOMPRESS_SCATTER_ENTRY pe;
+    PMMWINX64_COMPRESS_CONTEXT ctx;
+    if(!(ctx = LocalAlloc(0, sizeof(MMWINX64_COMPRESS_CONTEXT)))) { return; }
+    ctx->fVmmRead = ctxS->fVmmRead;
+    ctx->pProcess = ctxS->pProcess;
+    ctx->pSystemProcess = ctxS->pSystemProcess;
+    ctx->pProcessMemCompress = ctxS->pProcessMemCompress;
+    while(ctxVmm->ThreadWorkers.fEnabled && ((i = (DWORD)InterlockedIncrement(&ctxS->iPage) - 1) < ctxS->cPages)) {
+        tm = Statistics_CallStart();
+        pe = ctxS->pPages + i;
+        MmWin_MemCompress_PrepareContext(ctx, pe->va, pe->pte);
+        pe->fResult = MmWin_MemCompress_DoWork(ctx, pe->pbPage);
+        Statistics_CallEnd(STATISTICS_ID_VMM_PagedCompressedMemory, tm);
     }
-fail:
     LocalFree(ctx);
+}
+
+/*
+* Decompress multiple compressed pages belonging to a single process. The
+* system and memory compression processes are resolved once and the pages are
+* processed in parallel by a bounded number of workers on the vmm work pool.
+* The result of each page is returned in its fResult.
+* -- pProcess
+* -- cPages
+* -- pPages
+* -- fVmmRead = flags to VmmRead function calls.
+*/
+VOID MmWin_MemCompressScatter(_In_ PVMM_PROCESS pProcess, _In_ DWORD cPages, _Inout_updates_(cPages) PMMWIN_MEMCOMPRESS_SCATTER_ENTRY pPages, _In_ QWORD fVmmRead)
+{
+    DWORD i, cWorkers = 1;
+    MMWIN_MEMCOMPRESS_SCATTER_CONTEXT ctxS = { 0 };
+    PVMM_PROCESS pObSystemProcess = NULL, pObMemCompressProcess = NULL;
+    for(i = 0; i < cPages; i++) {
+        pPages[i].fResult = FALSE;
+    }
+    if(!cPages) { return; }
+    InterlockedIncrement(&ctxVmm->ThreadWorkers.c);
+    if(!(pObSystemProcess = VmmProcessGet(4))) { goto fail; }
+    if(!(pObMemCompressProcess = VmmProcessGet(((PMMWIN_CONTEXT)ctxVmm->pMmContext)->MemCompress.dwPid))) { goto fail; }
+    ctxS.fVmmRead = fVmmRead;
+    ctxS.pProcess = pProcess;
+    ctxS.pSystemProcess = pObSystemProcess;
+    ctxS.pProcessMemCompress = pObMemCompressProcess;
+    ctxS.cPages = cPages;
+    ctxS.pPages = pPages;
+    // use additional workers only if there is enough work for them.
+    while((cWorkers < MMWIN_MEMCOMPRESS_SCATTER_WORKERS_MAX) && (cWorkers * MMWIN_MEMCOMPRESS_SCATTER_PAGES_THREAD < cPages)) {
+        cWorkers++;
+    }
+    VmmWorkParallel(&ctxS, cWorkers, (VOID(*)(PVOID, DWORD))MmWin_MemCompressScatter_WorkerCB);
+fail:
     Ob_DECREF(pObSystemProcess);
     Ob_DECREF(pObMemCompressProcess);
-    Statistics_CallEnd(STATISTICS_ID_VMM_PagedCompressedMemory, tm);
-    return fResult;
+    InterlockedDecrement(&ctxVmm->ThreadWorkers.c);
 }
 
 
@@ -987,68 +1201,203 @@ fail:
 // PAGE FILE FUNCTIONALITY BELOW:
 //-----------------------------------------------------------------------------
 
-_Success_(return)
-BOOL MmWin_PfReadFile(_In_ DWORD dwPfNumber, _In_ DWORD dwPfOffset, _Out_writes_(4096) PBYTE pbPage)
+typedef struct tdMMWIN_PAGEFILE_SCATTER_ENTRY {
+    DWORD dwPfNumber;
+    DWORD dwPfOffset;
+    PBYTE pbPage;
+    BOOL fResult;
+    DWORD _Filler;
+} MMWIN_PAGEFILE_SCATTER_ENTRY, *PMMWIN_PAGEFILE_SCATTER_ENTRY;
+
+/*
+* Read multiple pages from the page files. The page files are opened for
+* overlapped i/o and reads are positional - no file pointer and no lock is
+* shared between threads. Up to MMWIN_PAGEFILE_SCATTER_MAX reads are issued
+* concurrently before waiting for their completion. The completion events are
+* taken from (and returned to) the recycled event sets of the paging context.
+* -- cPages
+* -- pPages = the result of each page is returned in its fResult.
+*/
+VOID MmWin_PfReadFileScatter(_In_ DWORD cPages, _Inout_updates_(cPages) PMMWIN_PAGEFILE_SCATTER_ENTRY pPages)
 {
     PMMWIN_CONTEXT ctx = (PMMWIN_CONTEXT)ctxVmm->pMmContext;
-    DWORD cb = 0;
-    if(!ctx || !ctx->pPageFile[dwPfNumber]) { return FALSE; }
-    EnterCriticalSection(&ctx->Lock);
-    if(!_fseeki64(ctx->pPageFile[dwPfNumber], (QWORD)dwPfOffset << 12, SEEK_SET)) {
-        cb = (DWORD)fread(pbPage, 1, 0x1000, ctx->pPageFile[dwPfNumber]);
-    }
-    LeaveCriticalSection(&ctx->Lock);
-    return cb == 0x1000;
+    DWORD i, iBase, cChunk, cEvents, cbRead;
+    QWORD qwOffset;
+    PMMWIN_PAGEFILE_SCATTER_ENTRY pe;
+    PMMWIN_PAGEFILE_EVENTS pEvents;
+    BOOL fPending[MMWIN_PAGEFILE_SCATTER_MAX];
+    OVERLAPPED ov[MMWIN_PAGEFILE_SCATTER_MAX];
+    for(i = 0; i < cPages; i++) {
+        pPages[i].fResult = FALSE;
+    }
+    if(!ctx || !cPages) { return; }
+    if(!(pEvents = (PMMWIN_PAGEFILE_EVENTS)InterlockedPopEntrySList(&ctx->ListPageFileEvents))) {
+        if(!(pEvents = LocalAlloc(0, sizeof(MMWIN_PAGEFILE_EVENTS)))) { return; }
+        pEvents->cEvents = 0;
+    }
+    // events are manual-reset and reset by ReadFile when the read is issued.
+    cEvents = min(cPages, MMWIN_PAGEFILE_SCATTER_MAX);
+    while(pEvents->cEvents < cEvents) {
+        if(!(pEvents->hEvents[pEvents->cEvents] = CreateEventA(NULL, TRUE, FALSE, NULL))) { goto fail; }
+        pEvents->cEvents++;
+    }
+    for(iBase = 0; iBase < cPages; iBase += cChunk) {
+        cChunk = min(cPages - iBase, MMWIN_PAGEFILE_SCATTER_MAX);
+        // 1: issue reads
+        for(i = 0; i < cChunk; i++) {
+            pe = pPages + iBase + i;
+            fPending[i] = FALSE;
+            if((pe->dwPfNumber >= 10) || !ctx->hPageFile[pe->dwPfNumber]) { continue; }
+            qwOffset = (QWORD)pe->dwPfOffset << 12;
+            ZeroMemory(&ov[i], sizeof(OVERLAPPED));
+            ov[i].Offset = (DWORD)qwOffset;
+            ov[i].OffsetHigh = (DWORD)(qwOffset >> 32);
+            ov[i].hEvent = pEvents->hEvents[i];
+            fPending[i] = ReadFile(ctx->hPageFile[pe->dwPfNumber], pe->pbPage, 0x1000, NULL, &ov[i]) || (GetLastError() == ERROR_IO_PENDING);
+        }
+        // 2: wait for completion
+        for(i = 0; i < cChunk; i++) {
+            if(!fPending[i]) { continue; }
+            pe = pPages + iBase + i;
+            pe->fResult = GetOverlappedResult(ctx->hPageFile[pe->dwPfNumber], &ov[i], &cbRead, TRUE) && (cbRead == 0x1000);
+        }
+    }
+fail:
+    InterlockedPushEntrySList(&ctx->ListPageFileEvents, &pEvents->ListEntry);
 }
 
 _Success_(return)
-BOOL MmWin_PfRead(_In_ PVMM_PROCESS pProcess, _In_ QWORD va, _In_ QWORD pte, _In_ QWORD fVmmRead, _In_ DWORD dwPfNumber, _In_ DWORD dwPfOffset, _Out_writes_(4096) PBYTE pbPage)
+BOOL MmWin_PfReadFile(_In_ DWORD dwPfNumber, _In_ DWORD dwPfOffset, _Out_writes_(4096) PBYTE pbPage)
 {
+    MMWIN_PAGEFILE_SCATTER_ENTRY e = { 0 };
+    e.dwPfNumber = dwPfNumber;
+    e.dwPfOffset = dwPfOffset;
+    e.pbPage = pbPage;
+    MmWin_PfReadFileScatter(1, &e);
+    return e.fResult;
+}
+
+typedef struct tdMMWIN_PFREAD_SCATTER_ENTRY {
+    QWORD va;
+    QWORD pte;
+    DWORD dwPfNumber;
+    DWORD dwPfOffset;
+    PBYTE pbPage;
     BOOL fResult;
+    BOOL fCompressed;
+    DWORD i;                                // caller-defined index
+    DWORD _Filler;
+} MMWIN_PFREAD_SCATTER_ENTRY, *PMMWIN_PFREAD_SCATTER_ENTRY;
+
+/*
+* Retrieve multiple pages of a single process from the page files and/or the
+* compressed virtual store. Cached pages and cached failed pages are resolved
+* first. The remaining pages are then retrieved as two batches: concurrent
+* page file i/o and parallel decompression of compressed pages.
+* -- pProcess
+* -- pPages = the result of each page is returned in its fResult.
+* -- cPages
+* -- fVmmRead = flags to VmmRead function calls.
+*/
+VOID MmWin_PfReadScatter(_In_ PVMM_PROCESS pProcess, _Inout_updates_(cPages) PMMWIN_PFREAD_SCATTER_ENTRY pPages, _In_ DWORD cPages, _In_ QWORD fVmmRead)
+{
+    PMMWIN_CONTEXT ctx = (PMMWIN_CONTEXT)ctxVmm->pMmContext;
+    DWORD i, cCompressed = 0, cPageFile = 0;
+    PMMWIN_PFREAD_SCATTER_ENTRY pe;
     PVMMOB_MEM pObCacheEntry;
-    // cached page?
-    if((pObCacheEntry = VmmCacheGet(VMM_CACHE_TAG_PAGING, pte))) {
-        memcpy(pbPage, pObCacheEntry->pb, 0x1000);
-        Ob_DECREF(pObCacheEntry);
-        InterlockedIncrement64(&ctxVmm->stat.page.cCacheHit);
-        return TRUE;
-    }
-    // cached failed page?
-    if(ObVSet_Exists(ctxVmm->Cache.PAGING_FAILED, pte)) {
-        InterlockedIncrement64(&ctxVmm->stat.page.cFailCacheHit);
-        return FALSE;
-    }
-    // check flags: NoPagingIo, ForceCache and santity checks.
-    if(fVmmRead & (VMM_FLAG_NOPAGING_IO | VMM_FLAG_FORCECACHE_READ)) { return FALSE; }
-    if(!ctxVmm->pMmContext || (dwPfNumber >= 10)) { return FALSE; }
-    // dispatch to page file or compressed virtual store
-    if(((PMMWIN_CONTEXT)ctxVmm->pMmContext)->MemCompress.fValid && (dwPfNumber == ((PMMWIN_CONTEXT)ctxVmm->pMmContext)->MemCompress.dwPageFileNumber)) {
-        fResult = MmWin_MemCompress(pProcess, va, pte, pbPage, fVmmRead);
-        if(fResult) {
-            InterlockedIncrement64(&ctxVmm->stat.page.cCompressed);
+    PBYTE pbBuffer = NULL;
+    PMMWIN_MEMCOMPRESS_SCATTER_ENTRY peMC, pMCs = NULL;
+    PMMWIN_PAGEFILE_SCATTER_ENTRY pePF, pPFs = NULL;
+    // 1: cached pages, cached failed pages, flags and sanity checks.
+    for(i = 0; i < cPages; i++) {
+        pe = pPages + i;
+        pe->fResult = FALSE;
+        pe->fCompressed = FALSE;
+        if((pObCacheEntry = VmmCacheGet(VMM_CACHE_TAG_PAGING, pe->pte))) {
+            memcpy(pe->pbPage, pObCacheEntry->pb, 0x1000);
+            Ob_DECREF(pObCacheEntry);
+            InterlockedIncrement64(&ctxVmm->stat.page.cCacheHit);
+            pe->fResult = TRUE;
+            continue;
+        }
+        if(VmmCachePagingFailedExists(pe->pte)) {
+            InterlockedIncrement64(&ctxVmm->stat.page.cFailCacheHit);
+            pe->dwPfNumber = (DWORD)-1;
+            continue;
+        }
+        if((fVmmRead & (VMM_FLAG_NOPAGING_IO | VMM_FLAG_FORCECACHE_READ)) || !ctx || (pe->dwPfNumber >= 10)) {
+            pe->dwPfNumber = (DWORD)-1;
+            continue;
+        }
+        if(ctx->MemCompress.fValid && (pe->dwPfNumber == ctx->MemCompress.dwPageFileNumber)) {
+            pe->fCompressed = TRUE;
+            cCompressed++;
         } else {
-            InterlockedIncrement64(&ctxVmm->stat.page.cFailCompressed);
+            cPageFile++;
         }
-    } else {
-        fResult = MmWin_PfReadFile(dwPfNumber, dwPfOffset, pbPage);
-        if(fResult) {
-            InterlockedIncrement64(&ctxVmm->stat.page.cPageFile);
+    }
+    if(!cCompressed && !cPageFile) { return; }
+    // 2: dispatch to page file and compressed virtual store batches.
+    if(!(pbBuffer = LocalAlloc(0, cCompressed * sizeof(MMWIN_MEMCOMPRESS_SCATTER_ENTRY) + cPageFile * sizeof(MMWIN_PAGEFILE_SCATTER_ENTRY)))) { return; }
+    pMCs = (PMMWIN_MEMCOMPRESS_SCATTER_ENTRY)pbBuffer;
+    pPFs = (PMMWIN_PAGEFILE_SCATTER_ENTRY)(pbBuffer + cCompressed * sizeof(MMWIN_MEMCOMPRESS_SCATTER_ENTRY));
+    for(i = 0, peMC = pMCs, pePF = pPFs; i < cPages; i++) {
+        pe = pPages + i;
+        if(pe->fResult || (pe->dwPfNumber >= 10)) { continue; }
+        if(pe->fCompressed) {
+            peMC->va = pe->va;
+            peMC->pte = pe->pte;
+            peMC->pbPage = pe->pbPage;
+            peMC++;
         } else {
-            InterlockedIncrement64(&ctxVmm->stat.page.cFailPageFile);
+            pePF->dwPfNumber = pe->dwPfNumber;
+            pePF->dwPfOffset = pe->dwPfOffset;
+            pePF->pbPage = pe->pbPage;
+            pePF++;
         }
     }
-    // update cache
-    if(fResult) {
-        if((pObCacheEntry = VmmCacheReserve(VMM_CACHE_TAG_PAGING))) {
-            pObCacheEntry->h.qwA = pte;
-            pObCacheEntry->h.cb = 0x1000;
-            memcpy(pObCacheEntry->pb, pbPage, 0x1000);
-            VmmCacheReserveReturn(pObCacheEntry);
+    if(cCompressed) {
+        MmWin_MemCompressScatter(pProcess, cCompressed, pMCs, fVmmRead);
+    }
+    if(cPageFile) {
+        MmWin_PfReadFileScatter(cPageFile, pPFs);
+    }
+    // 3: collect results and update cache.
+    for(i = 0, peMC = pMCs, pePF = pPFs; i < cPages; i++) {
+        pe = pPages + i;
+        if(pe->fResult || (pe->dwPfNumber >= 10)) { continue; }
+        if(pe->fCompressed) {
+            pe->fResult = (peMC++)->fResult;
+            InterlockedIncrement64(pe->fResult ? &ctxVmm->stat.page.cCompressed : &ctxVmm->stat.page.cFailCompressed);
+        } else {
+            pe->fResult = (pePF++)->fResult;
+            InterlockedIncrement64(pe->fResult ? &ctxVmm->stat.page.cPageFile : &ctxVmm->stat.page.cFailPageFile);
+        }
+        if(pe->fResult) {
+            if((pObCacheEntry = VmmCacheReserve(VMM_CACHE_TAG_PAGING))) {
+                pObCacheEntry->h.qwA = pe->pte;
+                pObCacheEntry->h.cb = 0x1000;
+                memcpy(pObCacheEntry->pb, pe->pbPage, 0x1000);
+                VmmCacheReserveReturn(pObCacheEntry);
+            }
+        } else {
+            VmmCachePagingFailedPush(pe->pte);
         }
-        return TRUE;
     }
-    ObVSet_Push(ctxVmm->Cache.PAGING_FAILED, pte);
-    return FALSE;
+    LocalFree(pbBuffer);
+}
+
+_Success_(return)
+BOOL MmWin_PfRead(_In_ PVMM_PROCESS pProcess, _In_ QWORD va, _In_ QWORD pte, _In_ QWORD fVmmRead, _In_ DWORD dwPfNumber, _In_ DWORD dwPfOffset, _Out_writes_(4096) PBYTE pbPage)
+{
+    MMWIN_PFREAD_SCATTER_ENTRY e = { 0 };
+    e.va = va;
+    e.pte = pte;
+    e.dwPfNumber = dwPfNumber;
+    e.dwPfOffset = dwPfOffset;
+    e.pbPage = pbPage;
+    MmWin_PfReadScatter(pProcess, &e, 1, fVmmRead);
+    return e.fResult;
 }
 
 
@@ -1264,21 +1613,26 @@ fail:
 }
 
 /*
-* Read a 'paged' page from virtual memory.
+* Resolve a 'paged' page from virtual memory - prototype, transition, VAD and
+* demand-zero pages are resolved directly. Pages that must be retrieved from
+* a page file or the compressed virtual store are not read; instead they are
+* described in pePf (pePf->pbPage is set) for the caller to retrieve.
 * -- pProcess
 * -- va
 * -- pte
 * -- pbPage
 * -- ppa
 * -- flags
-* -- return
+* -- pePf
+* -- return = TRUE if the page was read into pbPage, FALSE otherwise.
 */
 _Success_(return)
-BOOL MmWinX64_ReadPaged(_In_ PVMM_PROCESS pProcess, _In_ QWORD va, _In_ QWORD pte, _Out_writes_(4096) PBYTE pbPage, _Out_ PQWORD ppa, _In_ QWORD flags)
+BOOL MmWinX64_ReadPaged_Resolve(_In_ PVMM_PROCESS pProcess, _In_ QWORD va, _In_ QWORD pte, _Out_writes_(4096) PBYTE pbPage, _Out_ PQWORD ppa, _In_ QWORD flags, _Out_ PMMWIN_PFREAD_SCATTER_ENTRY pePf)
 {
     BOOL f;
     DWORD dwPfNumber, dwPfOffset;
     *ppa = 0;
+    pePf->pbPage = NULL;
     if(MMWINX64_PTE_IS_HARDWARE(pte) || MM_LOOP_PROTECT_MAX(flags)) { goto fail; }
     flags = MM_LOOP_PROTECT_ADD(flags);
     // prototype page
@@ -1314,7 +1668,7 @@ BOOL MmWinX64_ReadPaged(_In_ PVMM_PROCESS pProcess, _In_ QWORD va, _In_ QWORD pt
             *ppa = pte & 0x0000ffff'fffff000;
             return FALSE;
         }
-        return MmWinX64_ReadPaged(pProcess, va, pte, pbPage, ppa, flags | VMM_FLAG_NOVAD);
+        return MmWinX64_ReadPaged_Resolve(pProcess, va, pte, pbPage, ppa, flags | VMM_FLAG_NOVAD, pePf);
     }
     if(!pte) { return FALSE; }
     // demand zero virtual memory [ nt!_MMPTE_SOFTWARE ]
@@ -1323,13 +1677,95 @@ BOOL MmWinX64_ReadPaged(_In_ PVMM_PROCESS pProcess, _In_ QWORD va, _In_ QWORD pt
         InterlockedIncrement64(&ctxVmm->stat.page.cDemandZero);
         return TRUE;
     }
-    // retrive from page file or compressed store
-    return MmWin_PfRead(pProcess, va, pte, flags, dwPfNumber, dwPfOffset, pbPage);
+    // retrieve from page file or compressed store (by caller)
+    pePf->va = va;
+    pePf->pte = pte;
+    pePf->dwPfNumber = dwPfNumber;
+    pePf->dwPfOffset = dwPfOffset;
+    pePf->pbPage = pbPage;
+    return FALSE;
 fail:
     InterlockedIncrement64(&ctxVmm->stat.page.cFail);
     return FALSE;
 }
 
+/*
+* Read a 'paged' page from virtual memory.
+* -- pProcess
+* -- va
+* -- pte
+* -- pbPage
+* -- ppa
+* -- flags
+* -- return
+*/
+_Success_(return)
+BOOL MmWinX64_ReadPaged(_In_ PVMM_PROCESS pProcess, _In_ QWORD va, _In_ QWORD pte, _Out_writes_(4096) PBYTE pbPage, _Out_ PQWORD ppa, _In_ QWORD flags)
+{
+    MMWIN_PFREAD_SCATTER_ENTRY ePf;
+    if(MmWinX64_ReadPaged_Resolve(pProcess, va, pte, pbPage, ppa, flags, &ePf)) { return TRUE; }
+    if(!ePf.pbPage) { return FALSE; }
+    MmWin_PfReadScatter(pProcess, &ePf, 1, MM_LOOP_PROTECT_ADD(flags));
+    return ePf.fResult;
+}
+
+/*
+* Read multiple 'paged' pages from virtual memory. All pages are classified
+* first; prototype PTEs are then prefetched in one scatter read, transition
+* and prototype pages are returned as physical addresses for the caller to
+* read in one physical scatter read, and page file / compressed pages are
+* retrieved in batch by MmWin_PfReadScatter.
+* -- pProcess
+* -- pPages
+* -- cPages
+* -- flags
+*/
+VOID MmWinX64_ReadPagedScatter(_In_ PVMM_PROCESS pProcess, _Inout_updates_(cPages) PVMM_PAGED_READ_SCATTER_ENTRY pPages, _In_ DWORD cPages, _In_ QWORD flags)
+{
+    DWORD i, cPf = 0;
+    PVMM_PAGED_READ_SCATTER_ENTRY pe;
+    PMMWIN_PFREAD_SCATTER_ENTRY pPfs = NULL;
+    PVMM_PROCESS pObSystemProcess = NULL;
+    POB_VSET pObPrototype = NULL;
+    // 1: prefetch prototype ptes
+    if(!(flags & (VMM_FLAG_NOPAGING_IO | VMM_FLAG_NOCACHE)) && !MM_LOOP_PROTECT_MAX(flags) && (pObPrototype = ObVSet_New())) {
+        for(i = 0; i < cPages; i++) {
+            if(!MMWINX64_PTE_IS_HARDWARE(pPages[i].pte) && MMWINX64_PTE_PROTOTYPE(pPages[i].pte)) {
+                ObVSet_Push(pObPrototype, MMWINX64_PTE_PROTOTYPE(pPages[i].pte));
+            }
+        }
+        if(ObVSet_Size(pObPrototype) && (pObSystemProcess = VmmProcessGet(4))) {
+            VmmCachePrefetchPages3(pObSystemProcess, pObPrototype, 8, MM_LOOP_PROTECT_ADD(flags));
+        }
+        Ob_DECREF_NULL(&pObSystemProcess);
+        Ob_DECREF_NULL(&pObPrototype);
+    }
+    // 2: classify / resolve pages
+    if(!(pPfs = LocalAlloc(0, cPages * sizeof(MMWIN_PFREAD_SCATTER_ENTRY)))) {
+        for(i = 0; i < cPages; i++) {
+            pe = pPages + i;
+            pe->fResult = MmWinX64_ReadPaged(pProcess, pe->va, pe->pte, pe->pbPage, &pe->pa, flags);
+        }
+        return;
+    }
+    for(i = 0; i < cPages; i++) {
+        pe = pPages + i;
+        pe->fResult = MmWinX64_ReadPaged_Resolve(pProcess, pe->va, pe->pte, pe->pbPage, &pe->pa, flags, pPfs + cPf);
+        if(pPfs[cPf].pbPage) {
+            pPfs[cPf].i = i;
+            cPf++;
+        }
+    }
+    // 3: retrieve page file and compressed pages in batch
+    if(cPf) {
+        MmWin_PfReadScatter(pProcess, pPfs, cPf, MM_LOOP_PROTECT_ADD(flags));
+        for(i = 0; i < cPf; i++) {
+            pPages[pPfs[i].i].fResult = pPfs[i].fResult;
+        }
+    }
+    LocalFree(pPfs);
+}
+
 
 //-----------------------------------------------------------------------------
 // INITIALIZATION FUNCTIONALITY BELOW:
@@ -1339,13 +1775,23 @@ VOID MmWin_PagingClose()
 {
     PMMWIN_CONTEXT ctx = (PMMWIN_CONTEXT)ctxVmm->pMmContext;
     DWORD i;
+    PMMWIN_PAGEFILE_EVENTS pEvents;
     if(ctx) {
         ctxVmm->pMmContext = NULL;
         for(i = 0; i < 10; i++) {
-            if(ctx->pPageFile[i]) {
-                fclose(ctx->pPageFile[i]);
+            if(ctx->hPageFile[i]) {
+                CloseHandle(ctx->hPageFile[i]);
+            }
+        }
+        while((pEvents = (PMMWIN_PAGEFILE_EVENTS)InterlockedPopEntrySList(&ctx->ListPageFileEvents))) {
+            for(i = 0; i < pEvents->cEvents; i++) {
+                CloseHandle(pEvents->hEvents[i]);
             }
+            LocalFree(pEvents);
         }
+        Ob_DECREF_NULL(&ctx->pmObMemCompressStore);
+        Ob_DECREF_NULL(&ctx->pmObMemCompressBTreeNode);
+        DeleteCriticalSection(&ctx->LockUpdate);
         LocalFree(ctx);
     }
 }
@@ -1358,6 +1804,7 @@ VOID MmWin_PagingInitialize(_In_ BOOL fModeFull)
     switch(ctxVmm->tpMemoryModel) {
         case VMM_MEMORYMODEL_X64:
             ctxVmm->fnMemoryModel.pfnPagedRead = MmWinX64_ReadPaged;
+            ctxVmm->fnMemoryModel.pfnPagedReadScatter = MmWinX64_ReadPagedScatter;
             break;
         case VMM_MEMORYMODEL_X86PAE:
             ctxVmm->fnMemoryModel.pfnPagedRead = (BOOL(*)(PVMM_PROCESS, QWORD, QWORD, PBYTE, PQWORD, QWORD))MmWinX86PAE_ReadPaged;
@@ -1372,10 +1819,15 @@ VOID MmWin_PagingInitialize(_In_ BOOL fModeFull)
     if(!ctx) {
         ctx = LocalAlloc(LMEM_ZEROINIT, sizeof(MMWIN_CONTEXT));
         if(!ctx) { return; }
-        InitializeCriticalSection(&ctx->Lock);
+        InitializeCriticalSection(&ctx->LockUpdate);
+        InitializeSListHead(&ctx->ListPageFileEvents);
+        ctx->pmObMemCompressStore = ObMap_New(OB_MAP_FLAGS_OBJECT_OB);
+        ctx->pmObMemCompressBTreeNode = ObMap_New(OB_MAP_FLAGS_OBJECT_OB);
         for(i = 0; i < 10; i++) {
             if(ctxMain->cfg.szPageFile[i][0]) {
-                if(fopen_s(&ctx->pPageFile[i], ctxMain->cfg.szPageFile[i], "rb")) {
+                ctx->hPageFile[i] = CreateFileA(ctxMain->cfg.szPageFile[i], GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_OVERLAPPED | FILE_FLAG_RANDOM_ACCESS, NULL);
+                if(ctx->hPageFile[i] == INVALID_HANDLE_VALUE) {
+                    ctx->hPageFile[i] = NULL;
                     vmmprintfv("WARNING: CANNOT OPEN PAGE FILE #%i '%s'\n", i, ctxMain->cfg.szPageFile[i]);
                 } else {
                     vmmprintfvv("Successfully opened page file #%i '%s'\n", i, ctxMain->cfg.szPageFile[i]);
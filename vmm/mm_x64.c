@@ -5,14 +5,51 @@
 //
 #include "vmm.h"
 #include "vmmproc.h"
+#include "mm_ptescan.h"
+#include <intrin.h>
+#include <immintrin.h>
 
 #define MMX64_MEMMAP_DISPLAYBUFFER_LINE_LENGTH      89
 #define MMX64_PTE_IS_TRANSITION(pte, iPML)          ((((pte & 0x0c01) == 0x0800) && (iPML == 1) && ctxVmm && (ctxVmm->tpSystem == VMM_SYSTEM_WINDOWS_X64)) ? ((pte & 0xffffdfff'fffff000) | 0x005) : 0)
 #define MMX64_PTE_IS_VALID(pte, iPML)               (pte & 0x01)
 
+/*
+* AVX2 scan of a page table for bad PTEs (valid with an address above paMax)
+* and a self referential entry. Exact handling of bad PTEs is left to the
+* scalar verification in MmX64_TlbPageTableVerify.
+* -- PTEs
+* -- pa
+* -- pfSelfRef
+* -- return = TRUE if no bad PTEs exist.
+*/
+_Success_(return)
+BOOL MmX64_TlbPageTableVerify_AVX2(_In_reads_(512) QWORD PTEs[512], _In_ QWORD pa, _Out_ PBOOL pfSelfRef)
+{
+    DWORD i;
+    __m256i v, vBad, vSelfRef, vOne, vAddrMask, vMax, vSelfMask, vPA;
+    vOne = _mm256_set1_epi64x(1);
+    vAddrMask = _mm256_set1_epi64x(0x000fffffffffffff);
+    vMax = _mm256_set1_epi64x(min(ctxMain->dev.paMax, 0x000fffffffffffff));  // signed compare ok < 2^52
+    vSelfMask = _mm256_set1_epi64x(0x0000fffffffff000);
+    vPA = _mm256_set1_epi64x(pa);
+    vBad = _mm256_setzero_si256();
+    vSelfRef = _mm256_setzero_si256();
+    for(i = 0; i < 512; i += 4) {
+        v = _mm256_loadu_si256((__m256i*)(PTEs + i));
+        vBad = _mm256_or_si256(vBad, _mm256_and_si256(
+            _mm256_cmpeq_epi64(_mm256_and_si256(v, vOne), vOne),
+            _mm256_cmpgt_epi64(_mm256_and_si256(v, vAddrMask), vMax)));
+        vSelfRef = _mm256_or_si256(vSelfRef, _mm256_cmpeq_epi64(_mm256_and_si256(v, vSelfMask), vPA));
+    }
+    *pfSelfRef = !_mm256_testz_si256(vSelfRef, vSelfRef);
+    return _mm256_testz_si256(vBad, vBad);
+}
+
 /*
 * Tries to verify that a loaded page table is correct. If just a bit strange
 * bytes/ptes supplied in pb will be altered to look better.
+* Page tables without bad entries (the common case) are verified with AVX2 if
+* supported by the CPU.
 */
 BOOL MmX64_TlbPageTableVerify(_Inout_ PBYTE pb, _In_ QWORD pa, _In_ BOOL fSelfRefReq)
 {
@@ -21,14 +58,26 @@ BOOL MmX64_TlbPageTableVerify(_Inout_ PBYTE pb, _In_ QWORD pa, _In_ BOOL fSelfRe
     BOOL fSelfRef = FALSE;
     if(!pb) { return FALSE; }
     ptes = (PQWORD)pb;
+    if(g_fMmX64PteScanAVX2 && MmX64_TlbPageTableVerify_AVX2(ptes, pa, &fSelfRef)) {
+        if(fSelfRefReq && !fSelfRef) {
+            if(ctxVmm) {
+                vmmprintfvv_fn("VMM: BAD PT PAGE at PA: %016llx\n", pa);
+            }
+            ZeroMemory(pb, 4096);
+            return FALSE;
+        }
+        return TRUE;
+    }
+    fSelfRef = FALSE;
     for(i = 0; i < 512; i++) {
         pte = *(ptes + i);
         if((pte & 0x01) && ((0x000fffffffffffff & pte) > ctxMain->dev.paMax)) {
             // A bad PTE, or memory allocated above the physical address max
             // limit. This may be just trash in the page table in which case
             // we clear this faulty entry. If too may bad PTEs are found this
-            // is most probably not a page table - zero it out but let it
-            // remain in cache to prevent performance degrading reloads...
+            // is most probably not a page table - zero it out and fail. The
+            // caller (VmmTlbGetPageTable) then drops it from the tlb cache and
+            // records it in the negative cache to prevent repeated reloads.
             vmmprintfvv_fn("VMM: BAD PTE %016llx at PA: %016llx i: %i\n", *(ptes + i), pa, i);
             *(ptes + i) = (QWORD)0;
             c++;
@@ -48,29 +97,45 @@ BOOL MmX64_TlbPageTableVerify(_Inout_ PBYTE pb, _In_ QWORD pa, _In_ BOOL fSelfRe
     return TRUE;
 }
 
-VOID MmX64_TlbSpider_Stage(_In_ QWORD pa, _In_ BYTE iPML, _In_ BOOL fUserOnly, _In_ POB_VSET pPageSet)
+/*
+* Stage uncached page tables reachable from the page table at pa. If pVisitedSet
+* is given page tables already walked (with the same fUserOnly) are skipped -
+* this is used to walk shared (kernel) page tables only once across processes.
+* Uncached child page tables are collected per page table and inserted into
+* pPageSet with one ObVSet_PushBatch() call.
+* -- pa
+* -- iPML
+* -- fUserOnly
+* -- pPageSet = set to receive the uncached page tables.
+* -- pVisitedSetOpt
+* -- return = TRUE if the page table at pa itself is uncached and should be
+*             staged by the caller.
+*/
+BOOL MmX64_TlbSpider_Stage(_In_ QWORD pa, _In_ BYTE iPML, _In_ BOOL fUserOnly, _In_ POB_VSET pPageSet, _In_opt_ POB_VSET pVisitedSetOpt)
 {
-    QWORD i, pe;
+    DWORD cStage = 0;
+    QWORD i, pe, qwBitmap[8] = { 0 }, pqwStage[512];
     PVMMOB_MEM ptObMEM = NULL;
-    // 1: retrieve from cache, add to staging if not found
+    if(pVisitedSetOpt && !ObVSet_Push(pVisitedSetOpt, pa | (fUserOnly ? 1 : 0)) && ObVSet_Exists(pVisitedSetOpt, pa | (fUserOnly ? 1 : 0))) { return FALSE; }
+    // 1: retrieve from cache, stage (by caller) if not found
     ptObMEM = VmmCacheGet(VMM_CACHE_TAG_TLB, pa);
-    if(!ptObMEM) {
-        ObVSet_Push(pPageSet, pa);
-        return;
-    }
+    if(!ptObMEM) { return TRUE; }
     if(iPML == 1) {
         Ob_DECREF(ptObMEM);
-        return;
+        return FALSE;
     }
-    // 2: walk trough all entries for PML4, PDPT, PD
-    for(i = 0; i < 512; i++) {
-        pe = ptObMEM->pqw[i];
-        if(!(pe & 0x01)) { continue; }  // not valid
-        if(pe & 0x80) { continue; }     // not valid ptr to (PDPT || PD || PT)
-        if(fUserOnly && !(pe & 0x04)) { continue; } // supervisor page when fUserOnly -> not valid
-        MmX64_TlbSpider_Stage(pe & 0x0000fffffffff000, iPML - 1, fUserOnly, pPageSet);
+    // 2: walk trough all entries for PML4, PDPT, PD which are valid, not PS
+    //    (not valid ptr to PDPT || PD || PT) and not supervisor if fUserOnly.
+    MmX64_PteScan(ptObMEM->pqw, fUserOnly ? 0x85 : 0x81, fUserOnly ? 0x05 : 0x01, qwBitmap);
+    while(MmX64_PteScanNext(qwBitmap, &i)) {
+        pe = ptObMEM->pqw[i] & 0x0000fffffffff000;
+        if(MmX64_TlbSpider_Stage(pe, iPML - 1, fUserOnly, pPageSet, pVisitedSetOpt)) {
+            pqwStage[cStage++] = pe;
+        }
     }
+    ObVSet_PushBatch(pPageSet, cStage, pqwStage);
     Ob_DECREF(ptObMEM);
+    return FALSE;
 }
 
 /*
@@ -85,28 +150,169 @@ VOID MmX64_TlbSpider(_In_ PVMM_PROCESS pProcess)
     if(!(pObPageSet = ObVSet_New())) { return; }
     Ob_DECREF(VmmTlbGetPageTable(pProcess->paDTB, FALSE));
     for(i = 0; i < 3; i++) {
-        MmX64_TlbSpider_Stage(pProcess->paDTB, 4, pProcess->fUserOnly, pObPageSet);
+        if(MmX64_TlbSpider_Stage(pProcess->paDTB, 4, pProcess->fUserOnly, pObPageSet, NULL)) {
+            ObVSet_Push(pObPageSet, pProcess->paDTB);
+        }
         VmmTlbPrefetch(pObPageSet);
     }
     pProcess->fTlbSpiderDone = TRUE;
     Ob_DECREF(pObPageSet);
 }
 
+typedef struct tdMMX64_TLBSPIDERALL_CONTEXT {
+    POB_VSET pPageSet;
+    POB_VSET pVisitedSet;
+} MMX64_TLBSPIDERALL_CONTEXT, *PMMX64_TLBSPIDERALL_CONTEXT;
+
+BOOL MmX64_TlbSpiderAll_CriteriaCB(_In_ PVMM_PROCESS pProcess, _In_opt_ PVOID ctx)
+{
+    return !pProcess->fTlbSpiderDone;
+}
+
+VOID MmX64_TlbSpiderAll_StageCB(_In_ PVMM_PROCESS pProcess, _In_ PMMX64_TLBSPIDERALL_CONTEXT ctx)
+{
+    if(MmX64_TlbSpider_Stage(pProcess->paDTB & 0x0000fffffffff000, 4, pProcess->fUserOnly, ctx->pPageSet, ctx->pVisitedSet)) {
+        ObVSet_Push(ctx->pPageSet, pProcess->paDTB & 0x0000fffffffff000);
+    }
+}
+
+/*
+* Spider the page tables of all processes not yet spidered in one go. All DTBs
+* are walked in parallel with a global visited set so that shared page tables
+* (i.e. the kernel half of the address space) are walked only once per level.
+* Uncached page tables of all processes are merged and prefetched with one
+* VmmTlbPrefetch() per paging level (PML4, PDPT, PD, PT).
+*/
+VOID MmX64_TlbSpiderAll()
+{
+    DWORD i;
+    PVMM_PROCESS pObProcess = NULL;
+    MMX64_TLBSPIDERALL_CONTEXT ctx = { 0 };
+    if(!(ctx.pPageSet = ObVSet_New())) { goto fail; }
+    if(!(ctx.pVisitedSet = ObVSet_New())) { goto fail; }
+    for(i = 0; i < 4; i++) {
+        ObVSet_Clear(ctx.pVisitedSet);
+        VmmProcessActionForeachParallel(&ctx, 0, MmX64_TlbSpiderAll_CriteriaCB, (VOID(*)(PVMM_PROCESS, PVOID))MmX64_TlbSpiderAll_StageCB);
+        if(!ObVSet_Size(ctx.pPageSet)) { break; }
+        VmmTlbPrefetch(ctx.pPageSet);
+    }
+    while((pObProcess = VmmProcessGetNext(pObProcess, VMM_FLAG_PROCESS_SHOW_TERMINATED))) {
+        pObProcess->fTlbSpiderDone = TRUE;
+    }
+fail:
+    Ob_DECREF(ctx.pPageSet);
+    Ob_DECREF(ctx.pVisitedSet);
+}
+
 const QWORD MMX64_PAGETABLEMAP_PML_REGION_SIZE[5] = { 0, 12, 21, 30, 39 };
 const QWORD MMX64_PAGETABLEMAP_PML_REGION_MASK_PG[5] = { 0, 0x0000fffffffff000, 0x0000ffffffe00000, 0x0000ffffc0000000, 0 };
 const QWORD MMX64_PAGETABLEMAP_PML_REGION_MASK_AD[5] = { 0, 0xfff, 0x1fffff, 0x3fffffff, 0 };
 
-VOID MmX64_MapInitialize_Index(_In_ PVMM_PROCESS pProcess, _In_ PVMM_MAP_PTEENTRY pMemMap, _In_ PDWORD pcMemMap, _In_ QWORD vaBase, _In_ BYTE iPML, _In_ QWORD PTEs[512], _In_ BOOL fSupervisorPML, _In_ QWORD paMax)
+// The PTE map builder remembers the map entries produced by each page table
+// (PT) together with a hash of the PT contents in the persistent process
+// object. On rebuild the entries of unchanged PTs are reused instead of being
+// re-walked. Entries are keyed on the virtual base address of the PT.
+typedef struct tdMMX64_PTEMAP_CACHE_OB {
+    OB ObHdr;
+    QWORD qwHash;
+    QWORD paMax;
+    BOOL fSupervisorPML;
+    BOOL fFirstTransition;          // first map entry started after transition pte (merge regardless of flags)
+    DWORD cMap;
+    DWORD _Filler;
+    VMM_MAP_PTEENTRY pMap[];
+} MMX64_PTEMAP_CACHE_OB, *PMMX64_PTEMAP_CACHE_OB;
+
+typedef struct tdMMX64_PTEMAP_CACHE_CONTEXT {
+    POB_MAP pmCacheOld;
+    POB_MAP pmCacheNew;
+    PVMM_MAP_PTEENTRY pMapTmp;      // temporary buffer of 512 entries
+    DWORD cReuse;
+    DWORD cBuild;
+} MMX64_PTEMAP_CACHE_CONTEXT, *PMMX64_PTEMAP_CACHE_CONTEXT;
+
+VOID MmX64_MapInitialize_Index(_In_ PVMM_PROCESS pProcess, _In_ PVMM_MAP_PTEENTRY pMemMap, _In_ PDWORD pcMemMap, _In_ QWORD vaBase, _In_ BYTE iPML, _In_ QWORD PTEs[512], _In_ BOOL fSupervisorPML, _In_ QWORD paMax, _In_opt_ PMMX64_PTEMAP_CACHE_CONTEXT pCacheCtx);
+
+/*
+* Retrieve the map entries of a page table (PT) from the PTE map cache if the
+* page table is unchanged - or walk it and insert the result into the cache.
+* The entries are then merged into the map being built in the same way as if
+* the page table would have been walked directly.
+*/
+VOID MmX64_MapInitialize_IndexPTCached(_In_ PVMM_PROCESS pProcess, _In_ PVMM_MAP_PTEENTRY pMemMap, _In_ PDWORD pcMemMap, _In_ QWORD vaBase, _In_ QWORD PTEs[512], _In_ BOOL fSupervisorPML, _In_ QWORD paMax, _In_ PMMX64_PTEMAP_CACHE_CONTEXT pCacheCtx)
+{
+    DWORD i, cMapTmp = 0;
+    QWORD pte, qwHash = 0xcbf29ce484222325;
+    PMMX64_PTEMAP_CACHE_OB pObPT = NULL;
+    PVMM_MAP_PTEENTRY pe, pMemMapEntry;
+    for(i = 0; i < 512; i++) {
+        qwHash = (qwHash ^ PTEs[i]) * 0x100000001b3;
+    }
+    pObPT = ObMap_GetByKey(pCacheCtx->pmCacheOld, vaBase | 1);
+    if(pObPT && ((pObPT->qwHash != qwHash) || (pObPT->paMax != paMax) || (pObPT->fSupervisorPML != fSupervisorPML))) {
+        Ob_DECREF_NULL(&pObPT);
+    }
+    if(pObPT) {
+        pCacheCtx->cReuse++;
+    } else {
+        pCacheCtx->cBuild++;
+        MmX64_MapInitialize_Index(pProcess, pCacheCtx->pMapTmp, &cMapTmp, vaBase, 1, PTEs, fSupervisorPML, paMax, NULL);
+        if(!(pObPT = Ob_Alloc(OB_TAG_MAP_PTE_PT, 0, sizeof(MMX64_PTEMAP_CACHE_OB) + cMapTmp * sizeof(VMM_MAP_PTEENTRY), NULL, NULL))) { return; }
+        pObPT->qwHash = qwHash;
+        pObPT->paMax = paMax;
+        pObPT->fSupervisorPML = fSupervisorPML;
+        pObPT->fFirstTransition = FALSE;
+        pObPT->cMap = cMapTmp;
+        memcpy(pObPT->pMap, pCacheCtx->pMapTmp, cMapTmp * sizeof(VMM_MAP_PTEENTRY));
+        if(cMapTmp) {
+            for(i = 0; i <= ((pObPT->pMap[0].vaBase - vaBase) >> 12); i++) {
+                pte = PTEs[i];
+                if(!MMX64_PTE_IS_VALID(pte, 1) && MMX64_PTE_IS_TRANSITION(pte, 1)) {
+                    pObPT->fFirstTransition = TRUE;
+                    break;
+                }
+            }
+        }
+    }
+    ObMap_Push(pCacheCtx->pmCacheNew, vaBase | 1, pObPT);
+    // merge entries into map
+    for(i = 0; i < pObPT->cMap; i++) {
+        pe = pObPT->pMap + i;
+        pMemMapEntry = pMemMap + *pcMemMap - 1;
+        if((i == 0) && *pcMemMap &&
+            ((pMemMapEntry->fPage == pe->fPage) || pObPT->fFirstTransition) &&
+            (pe->vaBase == pMemMapEntry->vaBase + (pMemMapEntry->cPages << 12))) {
+            pMemMapEntry->cPages += pe->cPages;
+            continue;
+        }
+        if(*pcMemMap + 1 >= VMM_MEMMAP_ENTRIES_MAX) { break; }
+        memcpy(pMemMap + *pcMemMap, pe, sizeof(VMM_MAP_PTEENTRY));
+        *pcMemMap = *pcMemMap + 1;
+        if(*pcMemMap >= VMM_MEMMAP_ENTRIES_MAX - 1) { break; }
+    }
+    Ob_DECREF(pObPT);
+}
+
+VOID MmX64_MapInitialize_Index(_In_ PVMM_PROCESS pProcess, _In_ PVMM_MAP_PTEENTRY pMemMap, _In_ PDWORD pcMemMap, _In_ QWORD vaBase, _In_ BYTE iPML, _In_ QWORD PTEs[512], _In_ BOOL fSupervisorPML, _In_ QWORD paMax, _In_opt_ PMMX64_PTEMAP_CACHE_CONTEXT pCacheCtx)
 {
     PVMMOB_MEM pObNextPT;
-    QWORD i, pte, va;
+    QWORD i, pte, va, qwBitmap[8] = { 0 };
     BOOL fUserOnly, fNextSupervisorPML, fTransition = FALSE;
     PVMM_MAP_PTEENTRY pMemMapEntry = pMemMap + *pcMemMap - 1;
     if(!pProcess->fTlbSpiderDone) {
         VmmTlbSpider(pProcess);
     }
+    if((iPML == 1) && pCacheCtx) {
+        MmX64_MapInitialize_IndexPTCached(pProcess, pMemMap, pcMemMap, vaBase, PTEs, fSupervisorPML, paMax, pCacheCtx);
+        return;
+    }
     fUserOnly = pProcess->fUserOnly;
-    for(i = 0; i < 512; i++) {
+    // only visit valid entries (and possible transition entries in the PT).
+    MmX64_PteScan(PTEs, 0x01, 0x01, qwBitmap);
+    if(iPML == 1) {
+        MmX64_PteScan(PTEs, 0x0c01, 0x0800, qwBitmap);
+    }
+    while(MmX64_PteScanNext(qwBitmap, &i)) {
         pte = PTEs[i];
         if(!MMX64_PTE_IS_VALID(pte, iPML)) {
             if(pte && MMX64_PTE_IS_TRANSITION(pte, iPML)) {
@@ -149,7 +355,7 @@ VOID MmX64_MapInitialize_Index(_In_ PVMM_PROCESS pProcess, _In_ PVMM_MAP_PTEENTR
         fNextSupervisorPML = !(pte & 0x04);
         pObNextPT = VmmTlbGetPageTable(pte & 0x0000fffffffff000, FALSE);
         if(!pObNextPT) { continue; }
-        MmX64_MapInitialize_Index(pProcess, pMemMap, pcMemMap, va, iPML - 1, pObNextPT->pqw, fNextSupervisorPML, paMax);
+        MmX64_MapInitialize_Index(pProcess, pMemMap, pcMemMap, va, iPML - 1, pObNextPT->pqw, fNextSupervisorPML, paMax, pCacheCtx);
         Ob_DECREF(pObNextPT);
         pMemMapEntry = pMemMap + *pcMemMap - 1;
     }
@@ -163,6 +369,8 @@ BOOL MmX64_PteMapInitialize(_In_ PVMM_PROCESS pProcess)
     PVMMOB_MEM pObPML4;
     PVMM_MAP_PTEENTRY pMemMap = NULL;
     PVMMOB_MAP_PTE pObMap = NULL;
+    MMX64_PTEMAP_CACHE_CONTEXT CacheCtx = { 0 };
+    PMMX64_PTEMAP_CACHE_CONTEXT pCacheCtx = NULL;
     // already existing?
     if(pProcess->Map.pObPte) { return TRUE; }
     EnterCriticalSection(&pProcess->LockUpdate);
@@ -174,27 +382,47 @@ BOOL MmX64_PteMapInitialize(_In_ PVMM_PROCESS pProcess)
     pObPML4 = VmmTlbGetPageTable(pProcess->paDTB, FALSE);
     if(pObPML4) {
         pMemMap = (PVMM_MAP_PTEENTRY)LocalAlloc(LMEM_ZEROINIT, VMM_MEMMAP_ENTRIES_MAX * sizeof(VMM_MAP_PTEENTRY));
+        // set up incremental rebuild from previous page table map results (if possible)
+        if(pProcess->pObPersistent && pProcess->pObPersistent->pObCMapPteCache) {
+            CacheCtx.pmCacheOld = ObContainer_GetOb(pProcess->pObPersistent->pObCMapPteCache);
+            CacheCtx.pmCacheNew = ObMap_New(OB_MAP_FLAGS_OBJECT_OB);
+            CacheCtx.pMapTmp = LocalAlloc(LMEM_ZEROINIT, 512 * sizeof(VMM_MAP_PTEENTRY));
+        }
+        if(CacheCtx.pmCacheNew && CacheCtx.pMapTmp) {
+            pCacheCtx = &CacheCtx;
+        }
         if(pMemMap) {
-            MmX64_MapInitialize_Index(pProcess, pMemMap, &cMemMap, 0, 4, pObPML4->pqw, FALSE, ctxMain->dev.paMax);
+            MmX64_MapInitialize_Index(pProcess, pMemMap, &cMemMap, 0, 4, pObPML4->pqw, FALSE, ctxMain->dev.paMax, pCacheCtx);
+            if(pCacheCtx) {
+                ObContainer_SetOb(pProcess->pObPersistent->pObCMapPteCache, CacheCtx.pmCacheNew);
+                vmmprintfvv_fn("PID: %i PT REUSE: %i PT WALK: %i\n", pProcess->dwPID, CacheCtx.cReuse, CacheCtx.cBuild);
+            }
             for(i = 0; i < cMemMap; i++) { // fixup sign extension for kernel addresses
                 if(pMemMap[i].vaBase & 0x0000800000000000) {
                     pMemMap[i].vaBase |= 0xffff000000000000;
                 }
             }
         }
+        Ob_DECREF(CacheCtx.pmCacheOld);
+        Ob_DECREF(CacheCtx.pmCacheNew);
+        LocalFree(CacheCtx.pMapTmp);
         Ob_DECREF(pObPML4);
     }
     // allocate VmmOb depending on result
-    pObMap = Ob_Alloc(OB_TAG_MAP_PTE, 0, sizeof(VMMOB_MAP_PTE) + cMemMap * sizeof(VMM_MAP_PTEENTRY), NULL, NULL);
+    pObMap = Ob_Alloc(OB_TAG_MAP_PTE, 0, sizeof(VMMOB_MAP_PTE) + cMemMap * sizeof(VMM_MAP_PTEENTRY), VmmMap_PteMap_CloseObCallback, NULL);
     if(!pObMap) {
-        pProcess->Map.pObPte = Ob_Alloc(OB_TAG_MAP_PTE, LMEM_ZEROINIT, sizeof(VMMOB_MAP_PTE), NULL, NULL);
+        if((pProcess->Map.pObPte = Ob_Alloc(OB_TAG_MAP_PTE, LMEM_ZEROINIT, sizeof(VMMOB_MAP_PTE), VmmMap_PteMap_CloseObCallback, NULL))) {
+            pProcess->Map.pObPte->qwGeneration = VmmGenerationNext();
+        }
         LeaveCriticalSection(&pProcess->LockUpdate);
         LocalFree(pMemMap);
         return TRUE;
     }
+    pObMap->qwGeneration = VmmGenerationNext();
     pObMap->wszMultiText = NULL;
     pObMap->cbMultiText = 0;
     pObMap->fTagScan = FALSE;
+    pObMap->pObIndex = NULL;
     pObMap->cMap = cMemMap;
     memcpy(pObMap->pMap, pMemMap, cMemMap * sizeof(VMM_MAP_PTEENTRY));
     LocalFree(pMemMap);
@@ -231,6 +459,114 @@ BOOL MmX64_Virt2Phys(_In_ QWORD paPT, _In_ BOOL fUserOnly, _In_ BYTE iPML, _In_
     return MmX64_Virt2Phys(pte, fUserOnly, iPML - 1, va, ppa);
 }
 
+/*
+* qsort compare function for sorting batch translation entries by virtual address.
+*/
+int MmX64_Virt2PhysBatch_CmpSort(_In_ PVMM_VIRT2PHYS_BATCH_ENTRY a, _In_ PVMM_VIRT2PHYS_BATCH_ENTRY b)
+{
+    return (a->va < b->va) ? -1 : ((a->va > b->va) ? 1 : 0);
+}
+
+/*
+* Translate multiple virtual addresses in one go. Entries are sorted on virtual
+* address so that each shared PML4/PDPT/PD/PT is looked up once only. Page
+* tables missing from the TLB cache are collected and prefetched in one single
+* VmmTlbPrefetch() per paging level before the walk is resumed. On failure the
+* PTE entry (if any) is returned in pa to allow for a paged memory fallback.
+* -- pProcess
+* -- pV2Ps = entries to translate (will be re-ordered).
+* -- cV2Ps
+* -- return = number of failed translations.
+*/
+DWORD MmX64_Virt2PhysBatch(_In_ PVMM_PROCESS pProcess, _Inout_updates_(cV2Ps) PVMM_VIRT2PHYS_BATCH_ENTRY pV2Ps, _In_ DWORD cV2Ps)
+{
+    BYTE iPML;
+    BOOL fCacheOnly, fDone;
+    DWORD i, iRound, cMissing = 0, cFail = 0;
+    QWORD pa, pte, qwMask, paPT[5];
+    PVMMOB_MEM pObPT[5] = { 0 };
+    PVMM_VIRT2PHYS_BATCH_ENTRY pe;
+    POB_VSET pObPrefetch = NULL;
+    PBYTE pfDone = NULL;
+    if(!(pfDone = LocalAlloc(LMEM_ZEROINIT, cV2Ps))) { goto fail; }
+    if(!(pObPrefetch = ObVSet_New())) { goto fail; }
+    qsort(pV2Ps, cV2Ps, sizeof(VMM_VIRT2PHYS_BATCH_ENTRY), (int(*)(const void*, const void*))MmX64_Virt2PhysBatch_CmpSort);
+    for(i = 0; i < cV2Ps; i++) {
+        pV2Ps[i].pa = 0;
+        pV2Ps[i].fPhys = VmmSoftTlb_Get(pProcess, pV2Ps[i].va, &pV2Ps[i].pa);
+        pfDone[i] = pV2Ps[i].fPhys ? 2 : 0;
+    }
+    // walk the page tables - at most one round per paging level is required to
+    // prefetch all missing tables. the final round reads remaining tables from
+    // the device (same as single translation) to not fail on prefetch failure.
+    for(iRound = 0; iRound < 5; iRound++) {
+        fCacheOnly = (iRound < 4);
+        cMissing = 0;
+        paPT[4] = paPT[3] = paPT[2] = paPT[1] = (QWORD)-1;
+        for(i = 0; i < cV2Ps; i++) {
+            if(pfDone[i]) { continue; }
+            pe = pV2Ps + i;
+            pa = pProcess->paDTB & 0x0000fffffffff000;
+            fDone = FALSE;
+            for(iPML = 4; iPML && !fDone; iPML--) {
+                if(pa != paPT[iPML]) {
+                    Ob_DECREF_NULL(&pObPT[iPML]);
+                    paPT[iPML] = pa;
+                    if(!(pObPT[iPML] = VmmTlbGetPageTable(pa, fCacheOnly)) && fCacheOnly) {
+                        ObVSet_Push(pObPrefetch, pa);
+                    }
+                }
+                if(!pObPT[iPML]) {
+                    if(fCacheOnly) {
+                        cMissing++;
+                    } else {
+                        pfDone[i] = 1;      // FAIL - PAGE TABLE UNREADABLE
+                    }
+                    break;
+                }
+                pte = pObPT[iPML]->pqw[0x1ff & (pe->va >> MMX64_PAGETABLEMAP_PML_REGION_SIZE[iPML])];
+                fDone = TRUE;
+                if(!MMX64_PTE_IS_VALID(pte, iPML)) {
+                    if(iPML == 1) { pe->pa = pte; }                 // NOT VALID
+                } else if(pProcess->fUserOnly && !(pte & 0x04)) {
+                    ;                                               // SUPERVISOR PAGE & USER MODE REQ
+                } else if(pte & 0x000f000000000000) {
+                    ;                                               // RESERVED
+                } else if((iPML == 1) || (pte & 0x80) /* PS */) {
+                    if(iPML == 4) { break; }                        // NO SUPPORT IN PML4
+                    qwMask = 0xffffffffffffffff << MMX64_PAGETABLEMAP_PML_REGION_SIZE[iPML];
+                    pe->pa = (pte & 0x0000fffffffff000 & qwMask) | (~qwMask & pe->va);
+                    pe->fPhys = TRUE;
+                } else {
+                    pa = pte & 0x0000fffffffff000;
+                    fDone = FALSE;
+                }
+            }
+            if(fDone) {
+                pfDone[i] = 1;
+                if(pe->fPhys) {
+                    VmmSoftTlb_Put(pProcess, pe->va, pe->pa);
+                }
+            }
+        }
+        for(iPML = 1; iPML <= 4; iPML++) {
+            Ob_DECREF_NULL(&pObPT[iPML]);
+        }
+        if(!cMissing) { break; }
+        VmmTlbPrefetch(pObPrefetch);
+    }
+fail:
+    for(i = 0; i < cV2Ps; i++) {
+        if(!pfDone || !pfDone[i]) {
+            pV2Ps[i].fPhys = VmmVirt2Phys(pProcess, pV2Ps[i].va, &pV2Ps[i].pa);
+        }
+        if(!pV2Ps[i].fPhys) { cFail++; }
+    }
+    Ob_DECREF(pObPrefetch);
+    LocalFree(pfDone);
+    return cFail;
+}
+
 VOID MmX64_Virt2PhysGetInformation_DoWork(_Inout_ PVMM_PROCESS pProcess, _Inout_ PVMM_VIRT2PHYS_INFORMATION pVirt2PhysInfo, _In_ BYTE iPML, _In_ QWORD PTEs[512])
 {
     QWORD pte, i, qwMask;
@@ -275,15 +611,15 @@ VOID MmX64_Virt2PhysGetInformation(_Inout_ PVMM_PROCESS pProcess, _Inout_ PVMM_V
 VOID MmX64_Phys2VirtGetInformation_Index(_In_ PVMM_PROCESS pProcess, _In_ QWORD vaBase, _In_ BYTE iPML, _In_ QWORD PTEs[512], _In_ QWORD paMax, _Inout_ PVMMOB_PHYS2VIRT_INFORMATION pP2V)
 {
     BOOL fUserOnly;
-    QWORD i, pte, va;
+    QWORD i, pte, va, qwBitmap[8] = { 0 };
     PVMMOB_MEM pObNextPT;
     if(!pProcess->fTlbSpiderDone) {
         VmmTlbSpider(pProcess);
     }
     fUserOnly = pProcess->fUserOnly;
-    for(i = 0; i < 512; i++) {
+    MmX64_PteScan(PTEs, 0x01, 0x01, qwBitmap);
+    while(MmX64_PteScanNext(qwBitmap, &i)) {
         pte = PTEs[i];
-        if(!MMX64_PTE_IS_VALID(pte, iPML)) { continue; }
         if((pte & 0x0000fffffffff000) > paMax) { continue; }
         if(fUserOnly && !(pte & 0x04)) { continue; }
         // maps page
@@ -318,6 +654,47 @@ VOID MmX64_Phys2VirtGetInformation(_In_ PVMM_PROCESS pProcess, _Inout_ PVMMOB_PH
     Ob_DECREF(pObPML4);
 }
 
+VOID MmX64_Phys2VirtIndex_Index(_In_ PVMM_PROCESS pProcess, _In_ QWORD vaBase, _In_ BYTE iPML, _In_ QWORD PTEs[512], _In_ QWORD paMax, _Inout_ PVMMOB_PHYS2VIRT_INDEX pIndex)
+{
+    QWORD i, pte, va, qwBitmap[8] = { 0 };
+    PVMMOB_MEM pObNextPT;
+    MmX64_PteScan(PTEs, pProcess->fUserOnly ? 0x05 : 0x01, pProcess->fUserOnly ? 0x05 : 0x01, qwBitmap);
+    while(MmX64_PteScanNext(qwBitmap, &i)) {
+        pte = PTEs[i];
+        if((pte & 0x0000fffffffff000) > paMax) { continue; }
+        if(pte & 0x000f000000000000) { continue; }
+        va = vaBase + (i << MMX64_PAGETABLEMAP_PML_REGION_SIZE[iPML]);
+        // maps page
+        if((iPML == 1) || (pte & 0x80) /* PS */) {
+            if(iPML == 4) { continue; } // not supported - PML4 cannot map page directly
+            VmmPhys2VirtIndex_Push(pIndex, iPML - 1, pte & MMX64_PAGETABLEMAP_PML_REGION_MASK_PG[iPML], va | ((va >> 47) ? 0xffff000000000000 : 0), pProcess->dwPID);
+            continue;
+        }
+        // maps page table (PDPT, PD, PT)
+        pObNextPT = VmmTlbGetPageTable(pte & 0x0000fffffffff000, FALSE);
+        if(!pObNextPT) { continue; }
+        MmX64_Phys2VirtIndex_Index(pProcess, va, iPML - 1, pObNextPT->pqw, paMax, pIndex);
+        Ob_DECREF(pObNextPT);
+    }
+}
+
+/*
+* Add all physical to virtual mappings of a process to the reverse index.
+* -- pProcess
+* -- pIndex
+*/
+VOID MmX64_Phys2VirtIndex(_In_ PVMM_PROCESS pProcess, _Inout_ PVMMOB_PHYS2VIRT_INDEX pIndex)
+{
+    PVMMOB_MEM pObPML4;
+    if(!pProcess->fTlbSpiderDone) {
+        VmmTlbSpider(pProcess);
+    }
+    pObPML4 = VmmTlbGetPageTable(pProcess->paDTB, FALSE);
+    if(!pObPML4) { return; }
+    MmX64_Phys2VirtIndex_Index(pProcess, 0, 4, pObPML4->pqw, ctxMain->dev.paMax, pIndex);
+    Ob_DECREF(pObPML4);
+}
+
 VOID MmX64_Close()
 {
     ctxVmm->f32 = FALSE;
@@ -331,11 +708,15 @@ VOID MmX64_Initialize()
         ctxVmm->fnMemoryModel.pfnClose();
     }
     ctxVmm->fnMemoryModel.pfnClose = MmX64_Close;
+    g_fMmX64PteScanAVX2 = MmX64_PteScanIsAVX2();
     ctxVmm->fnMemoryModel.pfnVirt2Phys = MmX64_Virt2Phys;
+    ctxVmm->fnMemoryModel.pfnVirt2PhysBatch = MmX64_Virt2PhysBatch;
     ctxVmm->fnMemoryModel.pfnVirt2PhysGetInformation = MmX64_Virt2PhysGetInformation;
     ctxVmm->fnMemoryModel.pfnPhys2VirtGetInformation = MmX64_Phys2VirtGetInformation;
+    ctxVmm->fnMemoryModel.pfnPhys2VirtIndex = MmX64_Phys2VirtIndex;
     ctxVmm->fnMemoryModel.pfnPteMapInitialize = MmX64_PteMapInitialize;
     ctxVmm->fnMemoryModel.pfnTlbSpider = MmX64_TlbSpider;
+    ctxVmm->fnMemoryModel.pfnTlbSpiderAll = MmX64_TlbSpiderAll;
     ctxVmm->fnMemoryModel.pfnTlbPageTableVerify = MmX64_TlbPageTableVerify;
     ctxVmm->tpMemoryModel = VMM_MEMORYMODEL_X64;
     ctxVmm->f32 = FALSE;
@@ -171,16 +171,20 @@ BOOL MmX86PAE_PteMapInitialize(_In_ PVMM_PROCESS pProcess)
         Ob_DECREF(pObPDPT);
     }
     // allocate VmmOb depending on result
-    pObMap = Ob_Alloc(OB_TAG_MAP_PTE, 0, sizeof(VMMOB_MAP_PTE) + cMemMap * sizeof(VMM_MAP_PTEENTRY), NULL, NULL);
+    pObMap = Ob_Alloc(OB_TAG_MAP_PTE, 0, sizeof(VMMOB_MAP_PTE) + cMemMap * sizeof(VMM_MAP_PTEENTRY), VmmMap_PteMap_CloseObCallback, NULL);
     if(!pObMap) {
-        pProcess->Map.pObPte = Ob_Alloc(OB_TAG_MAP_PTE, LMEM_ZEROINIT, sizeof(VMMOB_MAP_PTE), NULL, NULL);
+        if((pProcess->Map.pObPte = Ob_Alloc(OB_TAG_MAP_PTE, LMEM_ZEROINIT, sizeof(VMMOB_MAP_PTE), VmmMap_PteMap_CloseObCallback, NULL))) {
+            pProcess->Map.pObPte->qwGeneration = VmmGenerationNext();
+        }
         LeaveCriticalSection(&pProcess->LockUpdate);
         LocalFree(pMemMap);
         return TRUE;
     }
+    pObMap->qwGeneration = VmmGenerationNext();
     pObMap->wszMultiText = NULL;
     pObMap->cbMultiText = 0;
     pObMap->fTagScan = FALSE;
+    pObMap->pObIndex = NULL;
     pObMap->cMap = cMemMap;
     memcpy(pObMap->pMap, pMemMap, cMemMap * sizeof(VMM_MAP_PTEENTRY));
     LocalFree(pMemMap);
@@ -9,6 +9,7 @@
 
 typedef unsigned __int64                QWORD, *PQWORD;
 #define OB_DEBUG
+#define OB_POOL
 #define OB_HEADER_MAGIC                 0x0c0efefe
 
 #define OB_TAG_CORE_CONTAINER           'ObCo'
@@ -16,18 +17,28 @@ typedef unsigned __int64                QWORD, *PQWORD;
 #define OB_TAG_CORE_VSET                'ObVS'
 #define OB_TAG_CORE_MAP                 'ObMA'
 #define OB_TAG_MAP_PTE                  'PteM'
+#define OB_TAG_MAP_PTE_PT               'PteP'
 #define OB_TAG_MAP_VAD                  'VadM'
 #define OB_TAG_MAP_MODULE               'ModM'
 #define OB_TAG_MAP_THREAD               'ThrM'
 #define OB_TAG_MAP_HANDLE               'HndM'
+#define OB_TAG_HANDLE_TEXT              'HndT'
+#define OB_TAG_MOD_IMAGE                'ModI'
+#define OB_TAG_MOD_IMAGE_EAT            'ModE'
 #define OB_TAG_PDB_ENTRY                'PdbE'
+#define OB_TAG_PDB_SYMBOLINDEX          'PdbS'
+#define OB_TAG_PDB_TYPE                 'PdbT'
+#define OB_TAG_PE_EXPORTINDEX           'PeEx'
 #define OB_TAG_REG_HIVE                 'RegH'
 #define OB_TAG_REG_KEY                  'RegK'
 #define OB_TAG_REG_KEYVALUE             'RegV'
+#define OB_TAG_REG_PATHHASH             'RegP'
 #define OB_TAG_VMM_PROCESS              'Ps__'
 #define OB_TAG_VMM_PROCESS_PERSISTENT   'PsSt'
 #define OB_TAG_VMM_PROCESSTABLE         'PsTb'
 #define OB_TAG_VMMVFS_DUMPCONTEXT       'CDmp'
+#define OB_TAG_VMMVFS_PATH              'VfsP'
+#define OB_TAG_PLUGIN_RENDER            'PlgR'
 
 // ----------------------------------------------------------------------------
 // OBJECT MANAGER CORE FUNCTIONALITY BELOW:
@@ -74,6 +85,21 @@ typedef struct tdOB {
 */
 PVOID Ob_Alloc(_In_ DWORD tag, _In_ UINT uFlags, _In_ SIZE_T uBytes, _In_opt_ VOID(*pfnRef_0)(_In_ PVOID pOb), _In_opt_ VOID(*pfnRef_1)(_In_ PVOID pOb));
 
+/*
+* Allocate a new object manager memory object in memory allocated on the given
+* numa node (VirtualAllocExNuma). Free'd objects are re-used by later numa
+* allocations on the same node. All objects allocated on the same node must be
+* of the same size. Falls back to Ob_Alloc if a node local allocation fails.
+* -- dwNumaNode = system numa node number.
+* -- tag = tag identifying the type of object.
+* -- uFlags = flags as given by LocalAlloc.
+* -- uBytes = bytes of object (_including_ object headers).
+* -- pfnRef_0 = optional callback for cleanup o be called before object is destroyed.
+* -- pfnRef_1 = optional callback for when object reach refcount = 1 at DECREF.
+* -- return = allocated object on success, with refcount = 1, - NULL on fail.
+*/
+PVOID Ob_AllocNuma(_In_ DWORD dwNumaNode, _In_ DWORD tag, _In_ UINT uFlags, _In_ SIZE_T uBytes, _In_opt_ VOID(*pfnRef_0)(_In_ PVOID pOb), _In_opt_ VOID(*pfnRef_1)(_In_ PVOID pOb));
+
 /*
 * Increase the reference count of a object by one.
 * -- pOb
@@ -111,6 +137,31 @@ inline VOID Ob_DECREF_NULL(_In_opt_ PVOID *ppOb)
 */
 BOOL Ob_VALID_TAG(_In_ PVOID pObIn, _In_ DWORD tag);
 
+typedef struct tdOB_TAG_STATISTICS {
+    DWORD tag;
+    QWORD cAlive;               // currently alive objects
+    QWORD cAllocTotal;          // total number of allocated objects
+    QWORD cbAlive;              // bytes held by currently alive objects
+    QWORD cAlivePeak;           // peak number of alive objects (sampled)
+} OB_TAG_STATISTICS, *POB_TAG_STATISTICS;
+
+/*
+* Retrieve per-tag object manager statistics of all accounted tags. Counters
+* are updated on every Ob_Alloc and on every Ob_DECREF freeing an object.
+* -- pStat = optional buffer to receive the statistics.
+* -- cStat = number of entries in pStat.
+* -- return = the number of accounted tags (may be larger than cStat).
+*/
+DWORD Ob_TagStatistics(_Out_writes_opt_(cStat) POB_TAG_STATISTICS pStat, _In_ DWORD cStat);
+
+/*
+* Return all free blocks cached in the size class pools to the heap. Should be
+* called periodically (i.e. on total refresh) and on close so that blocks of
+* a past allocation peak are not held on to forever. No-op if OB_POOL is not
+* defined.
+*/
+VOID Ob_PoolTrim();
+
 
 
 // ----------------------------------------------------------------------------
@@ -138,12 +189,16 @@ typedef struct tdOB_DATA {
 // information. The container holds a reference count to the object that is
 // contained. The object container itself is an object manager object and
 // must be DECREF'ed when required.
+//
+// The container is lock-free. The contained object pointer is stored together
+// with a replace sequence number and a count of outstanding "borrows" and is
+// updated with 128-bit compare-and-swap.
 // ----------------------------------------------------------------------------
 
 typedef struct tdOB_CONTAINER {
     OB ObHdr;
-    CRITICAL_SECTION Lock;
-    POB pOb;
+    // [0] = contained object, [1] = [63:32] = replace sequence, [31:0] = borrows
+    DECLSPEC_ALIGN(16) volatile LONG64 Slot[2];
 } OB_CONTAINER, *POB_CONTAINER;
 
 /*
@@ -223,6 +278,49 @@ BOOL ObVSet_Exists(_In_opt_ POB_VSET pvs, _In_ QWORD value);
 _Success_(return)
 BOOL ObVSet_Push(_In_opt_ POB_VSET pvs, _In_ QWORD value);
 
+/*
+* Push / Insert multiple non-zero values into the ObVSet. The lock is taken
+* once for the whole batch and the hash table is grown at most once.
+* -- pvs
+* -- cValues
+* -- pqwValues
+* -- return = the number of values inserted (values already existing or zero
+*             values are not inserted).
+*/
+DWORD ObVSet_PushBatch(_In_opt_ POB_VSET pvs, _In_ DWORD cValues, _In_reads_(cValues) PQWORD pqwValues);
+
+/*
+* Check if multiple values exists in the ObVSet. The lock is taken once for the
+* whole batch.
+* -- pvs
+* -- cValues
+* -- pqwValues
+* -- pfExists = optional array receiving the per-value result.
+* -- return = the number of values existing in the set.
+*/
+DWORD ObVSet_ExistsBatch(_In_opt_ POB_VSET pvs, _In_ DWORD cValues, _In_reads_(cValues) PQWORD pqwValues, _Out_writes_opt_(cValues) PBOOL pfExists);
+
+/*
+* Export all values in the ObVSet into a newly allocated array sorted in
+* ascending order.
+* CALLER LocalFree: return
+* -- pvs
+* -- pcValues = the number of values in the returned array.
+* -- return = the sorted values, or NULL if the set is empty or on failure.
+*/
+_Success_(return != NULL)
+PQWORD ObVSet_GetSorted(_In_opt_ POB_VSET pvs, _Out_ PDWORD pcValues);
+
+/*
+* Enable or disable the unsynchronized builder mode. While enabled no locking
+* takes place - the caller must guarantee that the set is only accessed by a
+* single thread. Builder mode must be disabled before the set is shared with
+* other threads.
+* -- pvs
+* -- fEnable
+*/
+VOID ObVSet_BuilderMode(_In_opt_ POB_VSET pvs, _In_ BOOL fEnable);
+
 /*
 * Insert a value representing an address into the ObVSet. If the length of the
 * data read from the start of the address a traverses page boundries all the
@@ -297,6 +395,11 @@ QWORD ObVSet_Get(_In_opt_ POB_VSET pvs, _In_ DWORD index);
 // functions are called - in which order may change and on-going iterations
 // of the set with ObMap_Get/ObMap_GetNext may fail.
 // The ObMap is an object manager object and must be DECREF'ed when required.
+//
+// A map created with OB_MAP_FLAGS_SHARDED is split into lock striped shards by
+// key hash; keyed operations only lock a single shard. Iteration of a sharded
+// map is done in shard order (not in insertion order). ObMap_Snapshot() may be
+// used to retrieve a consistent and ordered copy of the map.
 // ----------------------------------------------------------------------------
 
 typedef struct tdOB_MAP *POB_MAP;
@@ -304,6 +407,7 @@ typedef struct tdOB_MAP *POB_MAP;
 #define OB_MAP_FLAGS_OBJECT_OB          0x01
 #define OB_MAP_FLAGS_OBJECT_LOCALFREE   0x02
 #define OB_MAP_FLAGS_NOKEY              0x04
+#define OB_MAP_FLAGS_SHARDED            0x08
 
 /*
 * Create a new map. A map (ObMap) provides atomic map operations and ways
@@ -474,6 +578,20 @@ PVOID ObMap_GetByIndex(_In_opt_ POB_MAP pm, _In_ DWORD index);
 _Success_(return != NULL)
 POB_DATA ObMap_GetTableKeys(_In_opt_ POB_MAP pm);
 
+/*
+* Create a point-in-time snapshot copy of the map. All locks of the map (all
+* shards if sharded) are held while copying - the resulting map is consistent
+* and may be iterated in order. The snapshot is a non-sharded map. Object
+* manager objects are INCREF'ed by the snapshot; LocalFree'd values are NOT
+* owned by the snapshot and are only valid as long as the source map holds
+* them.
+* CALLER DECREF: return
+* -- pm
+* -- return
+*/
+_Success_(return != NULL)
+POB_MAP ObMap_Snapshot(_In_opt_ POB_MAP pm);
+
 
 
 #endif /* __OB_H__ */
@@ -7,6 +7,15 @@
 // contained. The object container itself is an object manager object and
 // must be DECREF'ed when required.
 //
+// The container is lock-free and uses a split reference count. A reader first
+// "borrows" the contained object by incrementing the borrow count stored next
+// to the object pointer; while borrowed the object may not be free'd. The
+// reader then takes a proper reference with Ob_INCREF and returns the borrow.
+// A writer replacing the object increments the replace sequence, resets the
+// borrow count and converts any outstanding borrows of the old object into
+// references - which the affected readers release when they detect that the
+// sequence has changed.
+//
 // (c) Ulf Frisk, 2018-2019
 // Author: Ulf Frisk, pcileech@frizk.net
 //
@@ -22,8 +31,19 @@
 VOID ObContainer_ObCloseCallback(_In_ POB_CONTAINER pObContainer)
 {
     if(!OB_CONTAINER_IS_VALID(pObContainer)) { return; }
-    DeleteCriticalSection(&pObContainer->Lock);
-    Ob_DECREF(pObContainer->pOb);
+    Ob_DECREF((POB)pObContainer->Slot[0]);
+}
+
+/*
+* Atomically read the slot of the container.
+* -- pObContainer
+* -- pqwSlot = receives the slot value.
+*/
+inline VOID _ObContainer_SlotRead(_In_ POB_CONTAINER pObContainer, _Out_writes_(2) PLONG64 pqwSlot)
+{
+    pqwSlot[0] = 0;
+    pqwSlot[1] = 0;
+    InterlockedCompareExchange128(pObContainer->Slot, 0, 0, pqwSlot);
 }
 
 /*
@@ -39,11 +59,8 @@ POB_CONTAINER ObContainer_New(_In_opt_ PVOID pOb)
 {
     POB_CONTAINER pObContainer = Ob_Alloc(OB_TAG_CORE_CONTAINER, 0, sizeof(OB_CONTAINER), ObContainer_ObCloseCallback, NULL);
     if(!pObContainer) { return NULL; }
-    if(!InitializeCriticalSectionAndSpinCount(&pObContainer->Lock, 4096)) {
-        LocalFree(pObContainer);
-        return NULL;
-    }
-    pObContainer->pOb = Ob_INCREF(pOb);
+    pObContainer->Slot[0] = (LONG64)Ob_INCREF(pOb);
+    pObContainer->Slot[1] = 0;
     return pObContainer;
 }
 
@@ -56,10 +73,28 @@ POB_CONTAINER ObContainer_New(_In_opt_ PVOID pOb)
 PVOID ObContainer_GetOb(_In_ POB_CONTAINER pObContainer)
 {
     POB pOb;
+    DWORD dwSeq;
+    LONG64 qwSlot[2];
     if(!OB_CONTAINER_IS_VALID(pObContainer)) { return NULL; }
-    EnterCriticalSection(&pObContainer->Lock);
-    pOb = Ob_INCREF(pObContainer->pOb);
-    LeaveCriticalSection(&pObContainer->Lock);
+    // 1: borrow the contained object (increment borrow count).
+    _ObContainer_SlotRead(pObContainer, qwSlot);
+    do {
+        if(!qwSlot[0]) { return NULL; }
+    } while(!InterlockedCompareExchange128(pObContainer->Slot, qwSlot[1] + 1, qwSlot[0], qwSlot));
+    pOb = (POB)qwSlot[0];
+    dwSeq = (DWORD)((QWORD)qwSlot[1] >> 32);
+    // 2: the object is kept alive by the borrow - take a proper reference.
+    Ob_INCREF(pOb);
+    // 3: return the borrow. If the object has been replaced the borrow has
+    //    been converted into a reference by the writer - release it instead.
+    qwSlot[1]++;
+    while(TRUE) {
+        if((qwSlot[0] != (LONG64)pOb) || (dwSeq != (DWORD)((QWORD)qwSlot[1] >> 32))) {
+            Ob_DECREF(pOb);
+            break;
+        }
+        if(InterlockedCompareExchange128(pObContainer->Slot, qwSlot[1] - 1, qwSlot[0], qwSlot)) { break; }
+    }
     return pOb;
 }
 
@@ -70,11 +105,19 @@ PVOID ObContainer_GetOb(_In_ POB_CONTAINER pObContainer)
 */
 VOID ObContainer_SetOb(_In_ POB_CONTAINER pObContainer, _In_opt_ PVOID pOb)
 {
-    POB pObOld;
+    DWORD i, cBorrow;
+    LONG64 qwSlot[2];
     if(!OB_CONTAINER_IS_VALID(pObContainer)) { return; }
-    EnterCriticalSection(&pObContainer->Lock);
-    pObOld = pObContainer->pOb;
-    pObContainer->pOb = Ob_INCREF(pOb);
-    LeaveCriticalSection(&pObContainer->Lock);
-    Ob_DECREF(pObOld);
+    Ob_INCREF(pOb);
+    _ObContainer_SlotRead(pObContainer, qwSlot);
+    while(!InterlockedCompareExchange128(pObContainer->Slot, (LONG64)((((QWORD)qwSlot[1] >> 32) + 1) << 32), (LONG64)pOb, qwSlot));
+    if(qwSlot[0]) {
+        // convert outstanding borrows of the replaced object into references
+        // before releasing the reference held by the container.
+        cBorrow = (DWORD)qwSlot[1];
+        for(i = 0; i < cBorrow; i++) {
+            Ob_INCREF((POB)qwSlot[0]);
+        }
+        Ob_DECREF((POB)qwSlot[0]);
+    }
 }
@@ -14,6 +14,20 @@
 // - such as decreasing reference count of sub-objects contained in the object
 // that is to be deallocated.
 //
+// If OB_POOL is defined objects of frequently allocated short-lived core tags
+// (sets, maps, containers and data) are allocated from size class pools. Freed
+// blocks are kept on lock-free per-processor lists and re-used by subsequent
+// allocations of the same size class instead of going through the heap. The
+// lists are capped in depth and are drained by Ob_PoolTrim.
+//
+// Objects allocated with Ob_AllocNuma are placed in a per numa node arena of
+// committed memory explicitly allocated on the node (VirtualAllocExNuma) and
+// re-used within the arena once free'd.
+//
+// Allocations and frees are accounted per object tag (live objects, bytes and
+// total allocations). The counters are kept per processor and are summed up
+// once the statistics are retrieved with Ob_TagStatistics.
+//
 // (c) Ulf Frisk, 2018-2019
 // Author: Ulf Frisk, pcileech@frizk.net
 //
@@ -24,28 +38,316 @@
 #define OB_DEBUG_FOOTER_SIZE            0x20
 #define OB_DEBUG_FOOTER_MAGIC           0x001122334455667788
 
+#define OB_TAGSTAT_TAGS_MAX             0x80        // max number of accounted tags (power of 2)
+#define OB_TAGSTAT_CPU_MAX              0x20
+
+typedef struct tdOB_TAGSTAT_COUNTER {
+    volatile LONG64 cAlloc;
+    volatile LONG64 cFree;
+    volatile LONG64 cbAlloc;
+    volatile LONG64 cbFree;
+} OB_TAGSTAT_COUNTER, *POB_TAGSTAT_COUNTER;
+
+static volatile DWORD g_ObTagStatTag[OB_TAGSTAT_TAGS_MAX];
+static volatile LONG64 g_ObTagStatPeak[OB_TAGSTAT_TAGS_MAX];
+static OB_TAGSTAT_COUNTER g_ObTagStatCounter[OB_TAGSTAT_CPU_MAX][OB_TAGSTAT_TAGS_MAX];
+
 /*
-* Allocate a new object manager memory object.
-* -- tag = tag of the object to be allocated.
+* Retrieve the statistics slot of a tag - allocate a new slot if required.
+* -- tag
+* -- return = slot index, OB_TAGSTAT_TAGS_MAX if the tag table is full.
+*/
+DWORD _Ob_TagStatIndex(_In_ DWORD tag)
+{
+    DWORD i, tagSlot, iSlot = (DWORD)(((QWORD)tag * 0x9e3779b1) >> 16) & (OB_TAGSTAT_TAGS_MAX - 1);
+    for(i = 0; i < OB_TAGSTAT_TAGS_MAX; i++) {
+        tagSlot = g_ObTagStatTag[iSlot];
+        if(!tagSlot) {
+            tagSlot = InterlockedCompareExchange((volatile LONG*)&g_ObTagStatTag[iSlot], tag, 0);
+        }
+        if(!tagSlot || (tagSlot == tag)) { return iSlot; }
+        iSlot = (iSlot + 1) & (OB_TAGSTAT_TAGS_MAX - 1);
+    }
+    return OB_TAGSTAT_TAGS_MAX;
+}
+
+/*
+* Sum the per-processor counters of a tag slot and update the peak value.
+* -- iSlot
+* -- pSum = optional receives the summed counters.
+* -- return = the number of currently alive objects.
+*/
+LONG64 _Ob_TagStatSum(_In_ DWORD iSlot, _Out_opt_ POB_TAGSTAT_COUNTER pSum)
+{
+    DWORD iCpu;
+    LONG64 cAlive, cPeak;
+    OB_TAGSTAT_COUNTER Sum = { 0 };
+    for(iCpu = 0; iCpu < OB_TAGSTAT_CPU_MAX; iCpu++) {
+        Sum.cAlloc += g_ObTagStatCounter[iCpu][iSlot].cAlloc;
+        Sum.cFree += g_ObTagStatCounter[iCpu][iSlot].cFree;
+        Sum.cbAlloc += g_ObTagStatCounter[iCpu][iSlot].cbAlloc;
+        Sum.cbFree += g_ObTagStatCounter[iCpu][iSlot].cbFree;
+    }
+    cAlive = Sum.cAlloc - Sum.cFree;
+    while((cPeak = g_ObTagStatPeak[iSlot]) < cAlive) {
+        if(cPeak == InterlockedCompareExchange64(&g_ObTagStatPeak[iSlot], cAlive, cPeak)) { break; }
+    }
+    if(pSum) { *pSum = Sum; }
+    return cAlive;
+}
+
+/*
+* Account an allocation or a free of an object. The peak number of alive
+* objects is sampled on the first 0x100 allocations (per processor) of a tag
+* and after that on every 0x100th allocation and on statistics retrieval.
+* -- tag
+* -- cb
+* -- fAlloc
+*/
+VOID _Ob_TagStatUpdate(_In_ DWORD tag, _In_ DWORD cb, _In_ BOOL fAlloc)
+{
+    LONG64 c;
+    POB_TAGSTAT_COUNTER pc;
+    DWORD iSlot = _Ob_TagStatIndex(tag);
+    if(iSlot == OB_TAGSTAT_TAGS_MAX) { return; }
+    pc = &g_ObTagStatCounter[GetCurrentProcessorNumber() % OB_TAGSTAT_CPU_MAX][iSlot];
+    if(fAlloc) {
+        InterlockedAdd64(&pc->cbAlloc, cb);
+        c = InterlockedIncrement64(&pc->cAlloc);
+        if((c < 0x100) || !(c & 0xff)) {
+            _Ob_TagStatSum(iSlot, NULL);
+        }
+    } else {
+        InterlockedAdd64(&pc->cbFree, cb);
+        InterlockedIncrement64(&pc->cFree);
+    }
+}
+
+/*
+* Retrieve per-tag object manager statistics of all accounted tags.
+* -- pStat = optional buffer to receive the statistics.
+* -- cStat = number of entries in pStat.
+* -- return = the number of accounted tags (may be larger than cStat).
+*/
+DWORD Ob_TagStatistics(_Out_writes_opt_(cStat) POB_TAG_STATISTICS pStat, _In_ DWORD cStat)
+{
+    DWORD iSlot, c = 0;
+    OB_TAGSTAT_COUNTER Sum;
+    for(iSlot = 0; iSlot < OB_TAGSTAT_TAGS_MAX; iSlot++) {
+        if(!g_ObTagStatTag[iSlot]) { continue; }
+        if(pStat && (c < cStat)) {
+            pStat[c].tag = g_ObTagStatTag[iSlot];
+            pStat[c].cAlive = _Ob_TagStatSum(iSlot, &Sum);
+            pStat[c].cAllocTotal = Sum.cAlloc;
+            pStat[c].cbAlive = Sum.cbAlloc - Sum.cbFree;
+            pStat[c].cAlivePeak = g_ObTagStatPeak[iSlot];
+        }
+        c++;
+    }
+    return c;
+}
+
+#ifdef OB_POOL
+#define OB_POOL_CLASS_SHIFT_MIN         8           // smallest size class: 0x100 bytes
+#define OB_POOL_CLASS_MAX               6           // largest size class:  0x2000 bytes
+#define OB_POOL_CPU_MAX                 64
+#define OB_POOL_LIST_CB_MAX             0x8000      // max cached bytes per processor and size class
+
+static const DWORD OB_POOL_TAGS[] = { OB_TAG_CORE_VSET, OB_TAG_CORE_MAP, OB_TAG_CORE_CONTAINER, OB_TAG_CORE_DATA };
+static INIT_ONCE g_ObPoolInitOnce = INIT_ONCE_STATIC_INIT;
+static SLIST_HEADER g_ObPoolList[OB_POOL_CPU_MAX][OB_POOL_CLASS_MAX];
+
+BOOL CALLBACK _Ob_PoolInitOnce(_Inout_ PINIT_ONCE InitOnce, _Inout_opt_ PVOID Parameter, _Out_opt_ PVOID *Context)
+{
+    DWORD iCpu, iClass;
+    for(iCpu = 0; iCpu < OB_POOL_CPU_MAX; iCpu++) {
+        for(iClass = 0; iClass < OB_POOL_CLASS_MAX; iClass++) {
+            InitializeSListHead(&g_ObPoolList[iCpu][iClass]);
+        }
+    }
+    return TRUE;
+}
+
+/*
+* Retrieve the pool size class of an allocation.
+* -- tag
+* -- cb = total number of bytes of the allocation (incl. header and footer).
+* -- return = size class, OB_POOL_CLASS_MAX if not pooled.
+*/
+DWORD _Ob_PoolClass(_In_ DWORD tag, _In_ SIZE_T cb)
+{
+    DWORD i, iClass;
+    for(i = 0; i < sizeof(OB_POOL_TAGS) / sizeof(DWORD); i++) {
+        if(tag == OB_POOL_TAGS[i]) {
+            for(iClass = 0; iClass < OB_POOL_CLASS_MAX; iClass++) {
+                if(cb <= (1ULL << (OB_POOL_CLASS_SHIFT_MIN + iClass))) { return iClass; }
+            }
+            break;
+        }
+    }
+    return OB_POOL_CLASS_MAX;
+}
+
+/*
+* Allocate a block of a pooled size class. The block is taken from the list of
+* the current processor if possible, otherwise it is allocated from the heap.
+* -- iClass
 * -- uFlags = flags as given by LocalAlloc.
-* -- uBytes = bytes of object (_including_ object headers).
-* -- pfnRef_0 = optional callback for cleanup o be called before object is destroyed.
-*               (if object has references that should be decremented before destruction).
-* -- pfnRef_1 = optional callback for when object reach refcount = 1 (excl. initial).
-* -- return = allocated object on success, with refcount = 1, - NULL on fail.
+* -- return
 */
-PVOID Ob_Alloc(_In_ DWORD tag, _In_ UINT uFlags, _In_ SIZE_T uBytes, _In_opt_ VOID(*pfnRef_0)(_In_ PVOID pOb), _In_opt_ VOID(*pfnRef_1)(_In_ PVOID pOb))
+PVOID _Ob_PoolAlloc(_In_ DWORD iClass, _In_ UINT uFlags)
+{
+    PVOID pv;
+    SIZE_T cb = 1ULL << (OB_POOL_CLASS_SHIFT_MIN + iClass);
+    InitOnceExecuteOnce(&g_ObPoolInitOnce, _Ob_PoolInitOnce, NULL, NULL);
+    pv = InterlockedPopEntrySList(&g_ObPoolList[GetCurrentProcessorNumber() % OB_POOL_CPU_MAX][iClass]);
+    if(!pv) {
+        return LocalAlloc(uFlags, cb);
+    }
+    if(uFlags & LMEM_ZEROINIT) {
+        ZeroMemory(pv, cb);
+    }
+    return pv;
+}
+
+/*
+* Return a block of a pooled size class to the list of the current processor,
+* or free it to the heap if the list is full.
+* -- iClass
+* -- pv
+*/
+VOID _Ob_PoolFree(_In_ DWORD iClass, _In_ PVOID pv)
+{
+    PSLIST_HEADER pList = &g_ObPoolList[GetCurrentProcessorNumber() % OB_POOL_CPU_MAX][iClass];
+    if(QueryDepthSList(pList) < (OB_POOL_LIST_CB_MAX >> (OB_POOL_CLASS_SHIFT_MIN + iClass))) {
+        InterlockedPushEntrySList(pList, (PSLIST_ENTRY)pv);
+    } else {
+        LocalFree(pv);
+    }
+}
+#endif /* OB_POOL */
+
+VOID Ob_PoolTrim()
+{
+#ifdef OB_POOL
+    DWORD iCpu, iClass;
+    PSLIST_ENTRY pe, peNext;
+    InitOnceExecuteOnce(&g_ObPoolInitOnce, _Ob_PoolInitOnce, NULL, NULL);
+    for(iCpu = 0; iCpu < OB_POOL_CPU_MAX; iCpu++) {
+        for(iClass = 0; iClass < OB_POOL_CLASS_MAX; iClass++) {
+            pe = InterlockedFlushSList(&g_ObPoolList[iCpu][iClass]);
+            while(pe) {
+                peNext = pe->Next;
+                LocalFree(pe);
+                pe = peNext;
+            }
+        }
+    }
+#endif /* OB_POOL */
+}
+
+#define OB_NUMA_NODE_MAX                64
+#ifdef _WIN64
+#define OB_NUMA_ARENA_CB_RESERVE        0x0000001000000000  // address space reserved per node arena
+#else
+#define OB_NUMA_ARENA_CB_RESERVE        0x10000000
+#endif /* _WIN64 */
+#define OB_NUMA_ARENA_CB_COMMIT         0x00200000          // arena commit granularity
+#define OB_NUMA_ARENA_CB_ALIGN          0x40
+
+typedef struct tdOB_NUMA_ARENA {
+    SLIST_HEADER ListFree;          // free'd blocks
+    SRWLOCK LockSRW;                // protects arena creation and growth
+    PBYTE volatile pbBase;          // reserved address range of the arena
+    SIZE_T cbBlock;                 // fixed block size of the arena
+    SIZE_T cbCommit;                // committed bytes
+    SIZE_T cbUsed;                  // bytes handed out (excl. free list re-use)
+} OB_NUMA_ARENA, *POB_NUMA_ARENA;
+
+static OB_NUMA_ARENA g_ObNumaArena[OB_NUMA_NODE_MAX];     // all zero = initialized (empty)
+static volatile DWORD g_cObNumaArena = 0;
+
+/*
+* Allocate a block from the arena of a numa node. The arena address range is
+* reserved on first use and committed on the node in chunks when required.
+* All blocks of an arena share the same size.
+* -- dwNumaNode = system numa node number.
+* -- uFlags = flags as given by LocalAlloc.
+* -- cb
+* -- return = the block, or NULL if not possible to allocate from the arena.
+*/
+PVOID _Ob_NumaAlloc(_In_ DWORD dwNumaNode, _In_ UINT uFlags, _In_ SIZE_T cb)
+{
+    PVOID pv = NULL;
+    POB_NUMA_ARENA pa;
+    if(dwNumaNode >= OB_NUMA_NODE_MAX) { return NULL; }
+    pa = &g_ObNumaArena[dwNumaNode];
+    cb = (cb + OB_NUMA_ARENA_CB_ALIGN - 1) & ~(SIZE_T)(OB_NUMA_ARENA_CB_ALIGN - 1);
+    // 1: create arena (if required)
+    if(!pa->pbBase) {
+        AcquireSRWLockExclusive(&pa->LockSRW);
+        if(!pa->pbBase && (pa->pbBase = VirtualAllocExNuma(GetCurrentProcess(), NULL, OB_NUMA_ARENA_CB_RESERVE, MEM_RESERVE, PAGE_READWRITE, dwNumaNode))) {
+            pa->cbBlock = cb;
+            InterlockedIncrement(&g_cObNumaArena);
+        }
+        ReleaseSRWLockExclusive(&pa->LockSRW);
+        if(!pa->pbBase) { return NULL; }
+    }
+    if(pa->cbBlock != cb) { return NULL; }
+    // 2: re-use free'd block
+    if((pv = InterlockedPopEntrySList(&pa->ListFree))) {
+        if(uFlags & LMEM_ZEROINIT) {
+            ZeroMemory(pv, cb);
+        }
+        return pv;
+    }
+    // 3: allocate new block (freshly committed memory is zero)
+    AcquireSRWLockExclusive(&pa->LockSRW);
+    if(pa->cbUsed + cb > pa->cbCommit) {
+        if((pa->cbCommit + OB_NUMA_ARENA_CB_COMMIT > OB_NUMA_ARENA_CB_RESERVE) || !VirtualAllocExNuma(GetCurrentProcess(), pa->pbBase + pa->cbCommit, OB_NUMA_ARENA_CB_COMMIT, MEM_COMMIT, PAGE_READWRITE, dwNumaNode)) {
+            goto finish;
+        }
+        pa->cbCommit += OB_NUMA_ARENA_CB_COMMIT;
+    }
+    pv = pa->pbBase + pa->cbUsed;
+    pa->cbUsed += cb;
+finish:
+    ReleaseSRWLockExclusive(&pa->LockSRW);
+    return pv;
+}
+
+/*
+* Return a block to its numa node arena - if allocated from an arena.
+* -- pv
+* -- return = TRUE if the block belonged to an arena.
+*/
+BOOL _Ob_NumaFree(_In_ PVOID pv)
+{
+    DWORD i;
+    PBYTE pbBase;
+    if(!g_cObNumaArena) { return FALSE; }
+    for(i = 0; i < OB_NUMA_NODE_MAX; i++) {
+        pbBase = g_ObNumaArena[i].pbBase;
+        if(pbBase && ((PBYTE)pv >= pbBase) && ((PBYTE)pv < pbBase + OB_NUMA_ARENA_CB_RESERVE)) {
+            InterlockedPushEntrySList(&g_ObNumaArena[i].ListFree, (PSLIST_ENTRY)pv);
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/*
+* Initialize the object header of a newly allocated object manager object.
+*/
+PVOID _Ob_AllocInitialize(_In_ POB pOb, _In_ DWORD tag, _In_ SIZE_T uBytes, _In_opt_ VOID(*pfnRef_0)(_In_ PVOID pOb), _In_opt_ VOID(*pfnRef_1)(_In_ PVOID pOb))
 {
-    POB pOb;
-    if((uBytes > 0x40000000) || (uBytes < sizeof(OB))) { return NULL; }
-    pOb = (POB)LocalAlloc(uFlags, uBytes + OB_DEBUG_FOOTER_SIZE);
-    if(!pOb) { return NULL; }
     pOb->_magic = OB_HEADER_MAGIC;
     pOb->_count = 1;
     pOb->_tag = tag;
     pOb->_pfnRef_0 = pfnRef_0;
     pOb->_pfnRef_1 = pfnRef_1;
     pOb->cbData = (DWORD)uBytes - sizeof(OB);
+    _Ob_TagStatUpdate(tag, (DWORD)uBytes, TRUE);
 #ifdef OB_DEBUG
     DWORD i, cb = sizeof(OB) + pOb->cbData;
     PBYTE pb = (PBYTE)pOb;
@@ -56,6 +358,55 @@ PVOID Ob_Alloc(_In_ DWORD tag, _In_ UINT uFlags, _In_ SIZE_T uBytes, _In_opt_ VO
     return pOb;
 }
 
+/*
+* Allocate a new object manager memory object in memory local to a numa node.
+* The memory is taken from a per numa node arena. If that is not possible the
+* object is allocated as by Ob_Alloc.
+* -- dwNumaNode = system numa node number.
+* -- tag = tag of the object to be allocated.
+* -- uFlags = flags as given by LocalAlloc.
+* -- uBytes = bytes of object (_including_ object headers).
+* -- pfnRef_0 = optional callback for cleanup o be called before object is destroyed.
+* -- pfnRef_1 = optional callback for when object reach refcount = 1 (excl. initial).
+* -- return = allocated object on success, with refcount = 1, - NULL on fail.
+*/
+PVOID Ob_AllocNuma(_In_ DWORD dwNumaNode, _In_ DWORD tag, _In_ UINT uFlags, _In_ SIZE_T uBytes, _In_opt_ VOID(*pfnRef_0)(_In_ PVOID pOb), _In_opt_ VOID(*pfnRef_1)(_In_ PVOID pOb))
+{
+    POB pOb;
+    if((uBytes > 0x40000000) || (uBytes < sizeof(OB))) { return NULL; }
+    if(!(pOb = (POB)_Ob_NumaAlloc(dwNumaNode, uFlags, uBytes + OB_DEBUG_FOOTER_SIZE))) {
+        return Ob_Alloc(tag, uFlags, uBytes, pfnRef_0, pfnRef_1);
+    }
+    return _Ob_AllocInitialize(pOb, tag, uBytes, pfnRef_0, pfnRef_1);
+}
+
+/*
+* Allocate a new object manager memory object.
+* -- tag = tag of the object to be allocated.
+* -- uFlags = flags as given by LocalAlloc.
+* -- uBytes = bytes of object (_including_ object headers).
+* -- pfnRef_0 = optional callback for cleanup o be called before object is destroyed.
+*               (if object has references that should be decremented before destruction).
+* -- pfnRef_1 = optional callback for when object reach refcount = 1 (excl. initial).
+* -- return = allocated object on success, with refcount = 1, - NULL on fail.
+*/
+PVOID Ob_Alloc(_In_ DWORD tag, _In_ UINT uFlags, _In_ SIZE_T uBytes, _In_opt_ VOID(*pfnRef_0)(_In_ PVOID pOb), _In_opt_ VOID(*pfnRef_1)(_In_ PVOID pOb))
+{
+    POB pOb;
+#ifdef OB_POOL
+    DWORD iClass;
+#endif /* OB_POOL */
+    if((uBytes > 0x40000000) || (uBytes < sizeof(OB))) { return NULL; }
+#ifdef OB_POOL
+    iClass = _Ob_PoolClass(tag, uBytes + OB_DEBUG_FOOTER_SIZE);
+    pOb = (POB)((iClass < OB_POOL_CLASS_MAX) ? _Ob_PoolAlloc(iClass, uFlags) : LocalAlloc(uFlags, uBytes + OB_DEBUG_FOOTER_SIZE));
+#else
+    pOb = (POB)LocalAlloc(uFlags, uBytes + OB_DEBUG_FOOTER_SIZE);
+#endif /* OB_POOL */
+    if(!pOb) { return NULL; }
+    return _Ob_AllocInitialize(pOb, tag, uBytes, pfnRef_0, pfnRef_1);
+}
+
 /*
 * Increase the reference count of a object manager object.
 * -- pOb
@@ -84,6 +435,9 @@ VOID Ob_DECREF(_In_opt_ PVOID pObIn)
 {
     POB pOb = (POB)pObIn;
     DWORD c;
+#ifdef OB_POOL
+    DWORD iClass;
+#endif /* OB_POOL */
     if(pOb) {
         if(pOb->_magic == OB_HEADER_MAGIC) {
             c = InterlockedDecrement(&pOb->_count);
@@ -98,8 +452,19 @@ VOID Ob_DECREF(_In_opt_ PVOID pObIn)
 #endif /* OB_DEBUG */
             if(c == 0) {
                 if(pOb->_pfnRef_0) { pOb->_pfnRef_0(pOb); }
+                _Ob_TagStatUpdate(pOb->_tag, sizeof(OB) + pOb->cbData, FALSE);
                 pOb->_magic = 0;
+                if(_Ob_NumaFree(pOb)) { return; }
+#ifdef OB_POOL
+                iClass = _Ob_PoolClass(pOb->_tag, sizeof(OB) + pOb->cbData + OB_DEBUG_FOOTER_SIZE);
+                if(iClass < OB_POOL_CLASS_MAX) {
+                    _Ob_PoolFree(iClass, pOb);
+                } else {
+                    LocalFree(pOb);
+                }
+#else
                 LocalFree(pOb);
+#endif /* OB_POOL */
             } else if((c == 1) && pOb->_pfnRef_1) {
                 pOb->_pfnRef_1(pOb);
             }
@@ -12,6 +12,10 @@
 // of the set with ObMap_Get/ObMap_GetNext may fail.
 // The ObMap is an object manager object and must be DECREF'ed when required.
 //
+// A sharded map (OB_MAP_FLAGS_SHARDED) holds no entries itself - calls are
+// forwarded to OB_MAP_SHARDS child maps selected by key hash, each with its
+// own lock, to reduce lock contention on hot maps under parallel workloads.
+//
 // (c) Ulf Frisk, 2019
 // Author: Ulf Frisk, pcileech@frizk.net
 //
@@ -23,6 +27,8 @@
 #define OB_MAP_IS_VALID(p)          (p && (p->ObHdr._magic == OB_HEADER_MAGIC) && (p->ObHdr._tag == OB_TAG_CORE_MAP))
 #define OB_MAP_TABLE_MAX_CAPACITY   OB_MAP_ENTRIES_DIRECTORY * OB_MAP_ENTRIES_TABLE * OB_MAP_ENTRIES_STORE
 #define OB_MAP_HASH_FUNCTION(v)     (13 * (v + _rotr16((WORD)v, 13) + _rotr((DWORD)v, 17) + _rotr64(v, 23)))
+#define OB_MAP_SHARDS               0x10
+#define OB_MAP_SHARD_INDEX(k)       ((DWORD)(OB_MAP_HASH_FUNCTION((QWORD)(k)) >> 60))
 
 #define OB_MAP_INDEX_DIRECTORY(i)   ((i >> 17) & (OB_MAP_ENTRIES_DIRECTORY - 1))
 #define OB_MAP_INDEX_TABLE(i)       ((i >> 8) & (OB_MAP_ENTRIES_TABLE - 1))
@@ -43,6 +49,8 @@ typedef struct tdOB_MAP {
     BOOL fKey;
     BOOL fObjectsOb;
     BOOL fObjectsLocalFree;
+    BOOL fSharded;
+    POB_MAP pShard[OB_MAP_SHARDS];  // child maps (sharded map only)
     PDWORD pHashMapKey;
     PDWORD pHashMapValue;
     union {
@@ -74,6 +82,10 @@ typedef struct tdOB_MAP {
     return retVal;                                                                      \
 }
 
+#define OB_MAP_CALL_SHARDED(pm, fn) {                                                   \
+    if(OB_MAP_IS_VALID(pm) && pm->fSharded) { return fn; }                              \
+}
+
 /*
 * Ob_DECREF / LocalFree all objects in the map (if required)
 * -- pObMap
@@ -103,6 +115,12 @@ VOID _ObMap_ObFreeAllObjects(_In_ POB_MAP pObMap)
 VOID _ObMap_ObCloseCallback(_In_ POB_MAP pObMap)
 {
     DWORD iDirectory, iTable;
+    if(pObMap->fSharded) {
+        for(iTable = 0; iTable < OB_MAP_SHARDS; iTable++) {
+            Ob_DECREF(pObMap->pShard[iTable]);
+        }
+        return;
+    }
     _ObMap_ObFreeAllObjects(pObMap);
     if(pObMap->fLargeMode) {
         for(iDirectory = 0; iDirectory < OB_MAP_ENTRIES_DIRECTORY; iDirectory++) {
@@ -199,6 +217,158 @@ BOOL _ObMap_GetEntryIndexFromKeyOrValue(_In_ POB_MAP pm, _In_ BOOL fValueHash, _
     }
 }
 
+//-----------------------------------------------------------------------------
+// SHARDED MAP FUNCTIONALITY BELOW:
+// Calls on a map created with OB_MAP_FLAGS_SHARDED are forwarded to the child
+// map (shard) selected by key hash. Calls without a key (value lookups and
+// iteration) visit the shards in order. The child maps do their own locking.
+//-----------------------------------------------------------------------------
+
+DWORD _ObMap_Sharded_Size(_In_ POB_MAP pm)
+{
+    DWORD i, c = 0;
+    for(i = 0; i < OB_MAP_SHARDS; i++) {
+        c += ObMap_Size(pm->pShard[i]);
+    }
+    return c;
+}
+
+BOOL _ObMap_Sharded_Exists(_In_ POB_MAP pm, _In_ PVOID pvObject)
+{
+    DWORD i;
+    for(i = 0; i < OB_MAP_SHARDS; i++) {
+        if(ObMap_Exists(pm->pShard[i], pvObject)) { return TRUE; }
+    }
+    return FALSE;
+}
+
+PVOID _ObMap_Sharded_GetFirst(_In_ POB_MAP pm, _In_ DWORD iShard)
+{
+    PVOID pvObject;
+    for(; iShard < OB_MAP_SHARDS; iShard++) {
+        if((pvObject = ObMap_GetByIndex(pm->pShard[iShard], 0))) { return pvObject; }
+    }
+    return NULL;
+}
+
+PVOID _ObMap_Sharded_GetByIndex(_In_ POB_MAP pm, _In_ DWORD index)
+{
+    DWORD i, c;
+    for(i = 0; i < OB_MAP_SHARDS; i++) {
+        c = ObMap_Size(pm->pShard[i]);
+        if(index < c) {
+            return ObMap_GetByIndex(pm->pShard[i], index);
+        }
+        index -= c;
+    }
+    return NULL;
+}
+
+PVOID _ObMap_Sharded_GetNext(_In_ POB_MAP pm, _In_opt_ PVOID pvObject)
+{
+    DWORD i;
+    PVOID pvNext;
+    if(!pvObject) {
+        return _ObMap_Sharded_GetFirst(pm, 0);
+    }
+    for(i = 0; i < OB_MAP_SHARDS; i++) {
+        if(ObMap_Exists(pm->pShard[i], pvObject)) {
+            if((pvNext = ObMap_GetNext(pm->pShard[i], pvObject))) { return pvNext; }
+            return _ObMap_Sharded_GetFirst(pm, i + 1);
+        }
+    }
+    if(pm->fObjectsOb) { Ob_DECREF(pvObject); }
+    return NULL;
+}
+
+PVOID _ObMap_Sharded_GetNextByKey(_In_ POB_MAP pm, _In_ QWORD qwKey, _In_opt_ PVOID pvObject)
+{
+    PVOID pvNext;
+    DWORD iShard = OB_MAP_SHARD_INDEX(qwKey);
+    if(!pvObject) {
+        return _ObMap_Sharded_GetFirst(pm, 0);
+    }
+    if(!ObMap_ExistsKey(pm->pShard[iShard], qwKey)) {
+        if(pm->fObjectsOb) { Ob_DECREF(pvObject); }
+        return NULL;
+    }
+    if((pvNext = ObMap_GetNextByKey(pm->pShard[iShard], qwKey, pvObject))) { return pvNext; }
+    return _ObMap_Sharded_GetFirst(pm, iShard + 1);
+}
+
+PVOID _ObMap_Sharded_Peek(_In_ POB_MAP pm)
+{
+    DWORD i = OB_MAP_SHARDS;
+    PVOID pvObject;
+    while(i) {
+        i--;
+        if((pvObject = ObMap_Peek(pm->pShard[i]))) { return pvObject; }
+    }
+    return NULL;
+}
+
+QWORD _ObMap_Sharded_PeekKey(_In_ POB_MAP pm)
+{
+    DWORD i = OB_MAP_SHARDS;
+    while(i) {
+        i--;
+        if(ObMap_Size(pm->pShard[i])) { return ObMap_PeekKey(pm->pShard[i]); }
+    }
+    return 0;
+}
+
+_Success_(return != NULL)
+POB_DATA _ObMap_Sharded_GetTableKeys(_In_ POB_MAP pm)
+{
+    QWORD i, c = 0;
+    POB_DATA pObData = NULL, pObDataShard[OB_MAP_SHARDS];
+    for(i = 0; i < OB_MAP_SHARDS; i++) {
+        if((pObDataShard[i] = ObMap_GetTableKeys(pm->pShard[i]))) {
+            c += pObDataShard[i]->pqw[0];
+        }
+    }
+    if(c && (pObData = Ob_Alloc(OB_TAG_CORE_DATA, 0, sizeof(OB) + (c + 1) * sizeof(QWORD), NULL, NULL))) {
+        pObData->pqw[0] = 0;
+        for(i = 0; i < OB_MAP_SHARDS; i++) {
+            if(!pObDataShard[i]) { continue; }
+            memcpy(pObData->pqw + 1 + pObData->pqw[0], pObDataShard[i]->pqw + 1, pObDataShard[i]->pqw[0] * sizeof(QWORD));
+            pObData->pqw[0] += pObDataShard[i]->pqw[0];
+        }
+    }
+    for(i = 0; i < OB_MAP_SHARDS; i++) {
+        Ob_DECREF(pObDataShard[i]);
+    }
+    return pObData;
+}
+
+_Success_(return != NULL)
+PVOID _ObMap_Sharded_Pop(_In_ POB_MAP pm, _Out_opt_ PQWORD pKey)
+{
+    QWORD qwKey;
+    DWORD i = OB_MAP_SHARDS;
+    PVOID pvObject;
+    while(i) {
+        i--;
+        if((pvObject = ObMap_PopWithKey(pm->pShard[i], &qwKey))) {
+            if(pKey) { *pKey = qwKey; }
+            return pvObject;
+        }
+    }
+    return NULL;
+}
+
+PVOID _ObMap_Sharded_Remove(_In_ POB_MAP pm, _In_ PVOID pvObject)
+{
+    DWORD i;
+    PVOID pvRemoved;
+    for(i = 0; i < OB_MAP_SHARDS; i++) {
+        if((pvRemoved = ObMap_Remove(pm->pShard[i], pvObject))) { return pvRemoved; }
+    }
+    return NULL;
+}
+
+
+
 //-----------------------------------------------------------------------------
 // RETRIEVE/GET FUNCTIONALITY BELOW:
 // ObMap_Size, ObMap_Exists,  ObMap_ExistsKey, ObMap_GetByIndex,
@@ -218,6 +388,7 @@ inline BOOL _ObMap_Exists(_In_ POB_MAP pm, _In_ BOOL fValueHash, _In_ QWORD kv)
 */
 DWORD ObMap_Size(_In_opt_ POB_MAP pm)
 {
+    OB_MAP_CALL_SHARDED(pm, _ObMap_Sharded_Size(pm))
     OB_MAP_CALL_SYNCHRONIZED_IMPLEMENTATION_READ(pm, DWORD, 0, pm->c - 1)
 }
 
@@ -229,6 +400,7 @@ DWORD ObMap_Size(_In_opt_ POB_MAP pm)
 */
 BOOL ObMap_Exists(_In_opt_ POB_MAP pm, _In_ PVOID pvObject)
 {
+    OB_MAP_CALL_SHARDED(pm, _ObMap_Sharded_Exists(pm, pvObject))
     OB_MAP_CALL_SYNCHRONIZED_IMPLEMENTATION_READ(pm, BOOL, FALSE, _ObMap_Exists(pm, TRUE, (QWORD)pvObject))
 }
 
@@ -240,6 +412,7 @@ BOOL ObMap_Exists(_In_opt_ POB_MAP pm, _In_ PVOID pvObject)
 */
 BOOL ObMap_ExistsKey(_In_opt_ POB_MAP pm, _In_ QWORD qwKey)
 {
+    OB_MAP_CALL_SHARDED(pm, ObMap_ExistsKey(pm->pShard[OB_MAP_SHARD_INDEX(qwKey)], qwKey))
     OB_MAP_CALL_SYNCHRONIZED_IMPLEMENTATION_READ(pm, BOOL, FALSE, _ObMap_Exists(pm, FALSE, qwKey))
 }
 
@@ -305,6 +478,7 @@ POB_DATA _ObMap_GetTableKeys(_In_ POB_MAP pm)
 */
 PVOID ObMap_GetByIndex(_In_opt_ POB_MAP pm, _In_ DWORD index)
 {
+    OB_MAP_CALL_SHARDED(pm, _ObMap_Sharded_GetByIndex(pm, index))
     OB_MAP_CALL_SYNCHRONIZED_IMPLEMENTATION_READ(pm, PVOID, NULL, _ObMap_GetByEntryIndex(pm, index + 1))  // (+1 == account/adjust for index 0 (reserved))
 }
 
@@ -317,6 +491,7 @@ PVOID ObMap_GetByIndex(_In_opt_ POB_MAP pm, _In_ DWORD index)
 */
 PVOID ObMap_GetByKey(_In_opt_ POB_MAP pm, _In_ QWORD qwKey)
 {
+    OB_MAP_CALL_SHARDED(pm, ObMap_GetByKey(pm->pShard[OB_MAP_SHARD_INDEX(qwKey)], qwKey))
     OB_MAP_CALL_SYNCHRONIZED_IMPLEMENTATION_READ(pm, PVOID, NULL, _ObMap_GetByKey(pm, qwKey))
 }
 
@@ -333,6 +508,7 @@ PVOID ObMap_GetByKey(_In_opt_ POB_MAP pm, _In_ QWORD qwKey)
 */
 PVOID ObMap_GetNext(_In_opt_ POB_MAP pm, _In_opt_ PVOID pvObject)
 {
+    OB_MAP_CALL_SHARDED(pm, _ObMap_Sharded_GetNext(pm, pvObject))
     OB_MAP_CALL_SYNCHRONIZED_IMPLEMENTATION_READ(pm, PVOID, NULL, _ObMap_GetNext(pm, pvObject))
 }
 
@@ -353,6 +529,7 @@ PVOID ObMap_GetNext(_In_opt_ POB_MAP pm, _In_opt_ PVOID pvObject)
 */
 PVOID ObMap_GetNextByKey(_In_opt_ POB_MAP pm, _In_ QWORD qwKey, _In_opt_ PVOID pvObject)
 {
+    OB_MAP_CALL_SHARDED(pm, _ObMap_Sharded_GetNextByKey(pm, qwKey, pvObject))
     OB_MAP_CALL_SYNCHRONIZED_IMPLEMENTATION_READ(pm, PVOID, NULL, _ObMap_GetNextByKey(pm, qwKey, pvObject))
 }
 
@@ -364,6 +541,7 @@ PVOID ObMap_GetNextByKey(_In_opt_ POB_MAP pm, _In_ QWORD qwKey, _In_opt_ PVOID p
 */
 PVOID ObMap_Peek(_In_opt_ POB_MAP pm)
 {
+    OB_MAP_CALL_SHARDED(pm, _ObMap_Sharded_Peek(pm))
     OB_MAP_CALL_SYNCHRONIZED_IMPLEMENTATION_READ(pm, PVOID, NULL, _ObMap_GetByEntryIndex(pm, pm->c - 1))
 }
 
@@ -374,6 +552,7 @@ PVOID ObMap_Peek(_In_opt_ POB_MAP pm)
 */
 QWORD ObMap_PeekKey(_In_opt_ POB_MAP pm)
 {
+    OB_MAP_CALL_SHARDED(pm, _ObMap_Sharded_PeekKey(pm))
     OB_MAP_CALL_SYNCHRONIZED_IMPLEMENTATION_READ(pm, QWORD, 0, _ObMap_GetFromEntryIndex(pm, FALSE, pm->c - 1))
 }
 
@@ -387,6 +566,7 @@ QWORD ObMap_PeekKey(_In_opt_ POB_MAP pm)
 _Success_(return != NULL)
 POB_DATA ObMap_GetTableKeys(_In_opt_ POB_MAP pm)
 {
+    OB_MAP_CALL_SHARDED(pm, _ObMap_Sharded_GetTableKeys(pm))
     OB_MAP_CALL_SYNCHRONIZED_IMPLEMENTATION_READ(pm, POB_DATA, NULL, _ObMap_GetTableKeys(pm));
 }
 
@@ -442,6 +622,7 @@ PVOID _ObMap_RemoveOrRemoveByKey(_In_ POB_MAP pm, _In_ BOOL fValueHash, _In_ QWO
 _Success_(return != NULL)
 PVOID ObMap_Pop(_In_opt_ POB_MAP pm)
 {
+    OB_MAP_CALL_SHARDED(pm, _ObMap_Sharded_Pop(pm, NULL))
     OB_MAP_CALL_SYNCHRONIZED_IMPLEMENTATION_WRITE(pm, PVOID, NULL, _ObMap_RetrieveAndRemoveByEntryIndex(pm, pm->c - 1, NULL))
 }
 
@@ -455,6 +636,7 @@ PVOID ObMap_Pop(_In_opt_ POB_MAP pm)
 _Success_(return != NULL)
 PVOID ObMap_PopWithKey(_In_opt_ POB_MAP pm, _Out_ PQWORD pKey)
 {
+    OB_MAP_CALL_SHARDED(pm, _ObMap_Sharded_Pop(pm, pKey))
     OB_MAP_CALL_SYNCHRONIZED_IMPLEMENTATION_WRITE(pm, PVOID, NULL, _ObMap_RetrieveAndRemoveByEntryIndex(pm, pm->c - 1, pKey))
 }
 
@@ -467,6 +649,7 @@ PVOID ObMap_PopWithKey(_In_opt_ POB_MAP pm, _Out_ PQWORD pKey)
 */
 PVOID ObMap_Remove(_In_opt_ POB_MAP pm, _In_ PVOID pvObject)
 {
+    OB_MAP_CALL_SHARDED(pm, _ObMap_Sharded_Remove(pm, pvObject))
     OB_MAP_CALL_SYNCHRONIZED_IMPLEMENTATION_WRITE(pm, PVOID, NULL, _ObMap_RemoveOrRemoveByKey(pm, TRUE, (QWORD)pvObject))
 }
 
@@ -479,6 +662,7 @@ PVOID ObMap_Remove(_In_opt_ POB_MAP pm, _In_ PVOID pvObject)
 */
 PVOID ObMap_RemoveByKey(_In_opt_ POB_MAP pm, _In_ QWORD qwKey)
 {
+    OB_MAP_CALL_SHARDED(pm, ObMap_RemoveByKey(pm->pShard[OB_MAP_SHARD_INDEX(qwKey)], qwKey))
     OB_MAP_CALL_SYNCHRONIZED_IMPLEMENTATION_WRITE(pm, PVOID, NULL, _ObMap_RemoveOrRemoveByKey(pm, FALSE, qwKey))
 }
 
@@ -490,6 +674,13 @@ PVOID ObMap_RemoveByKey(_In_opt_ POB_MAP pm, _In_ QWORD qwKey)
 */
 VOID ObMap_Clear(_In_opt_ POB_MAP pm)
 {
+    DWORD i;
+    if(OB_MAP_IS_VALID(pm) && pm->fSharded) {
+        for(i = 0; i < OB_MAP_SHARDS; i++) {
+            ObMap_Clear(pm->pShard[i]);
+        }
+        return;
+    }
     if(!OB_MAP_IS_VALID(pm) || (pm->c <= 1)) { return; }
     AcquireSRWLockExclusive(&pm->LockSRW);
     if(pm->c <= 1) {
@@ -584,9 +775,47 @@ BOOL _ObMap_Push(_In_ POB_MAP pm, _In_ QWORD qwKey, _In_ PVOID pvObject)
 _Success_(return)
 BOOL ObMap_Push(_In_opt_ POB_MAP pm, _In_ QWORD qwKey, _In_ PVOID pvObject)
 {
+    OB_MAP_CALL_SHARDED(pm, ObMap_Push(pm->pShard[OB_MAP_SHARD_INDEX(qwKey)], qwKey, pvObject))
     OB_MAP_CALL_SYNCHRONIZED_IMPLEMENTATION_WRITE(pm, BOOL, FALSE, _ObMap_Push(pm, qwKey, pvObject))
 }
 
+/*
+* Create a point-in-time snapshot copy of the map. All locks of the map (all
+* shards if sharded) are held while copying - the resulting map is consistent
+* and may be iterated in order. The snapshot is a non-sharded map.
+* CALLER DECREF: return
+* -- pm
+* -- return
+*/
+_Success_(return != NULL)
+POB_MAP ObMap_Snapshot(_In_opt_ POB_MAP pm)
+{
+    DWORD i, iEntry, cMap;
+    POB_MAP pmSrc, pObMap;
+    POB_MAP_ENTRY pe;
+    if(!OB_MAP_IS_VALID(pm)) { return NULL; }
+    if(!(pObMap = ObMap_New((pm->fObjectsOb ? OB_MAP_FLAGS_OBJECT_OB : 0) | (pm->fKey ? 0 : OB_MAP_FLAGS_NOKEY)))) { return NULL; }
+    // lock all source maps (in shard order) for a consistent copy. writers only
+    // ever hold a single shard lock - hence no lock order inversion is possible.
+    cMap = pm->fSharded ? OB_MAP_SHARDS : 1;
+    for(i = 0; i < cMap; i++) {
+        pmSrc = pm->fSharded ? pm->pShard[i] : pm;
+        AcquireSRWLockShared(&pmSrc->LockSRW);
+    }
+    for(i = 0; i < cMap; i++) {
+        pmSrc = pm->fSharded ? pm->pShard[i] : pm;
+        for(iEntry = 1; iEntry < pmSrc->c; iEntry++) {
+            pe = _ObMap_GetFromIndex(pmSrc, iEntry);
+            _ObMap_Push(pObMap, pe->k, pe->v);
+        }
+    }
+    for(i = 0; i < cMap; i++) {
+        pmSrc = pm->fSharded ? pm->pShard[i] : pm;
+        ReleaseSRWLockShared(&pmSrc->LockSRW);
+    }
+    return pObMap;
+}
+
 /*
 * Create a new map. A map (ObMap) provides atomic map operations and ways
 * to optionally map key values to values, pointers or object manager objects.
@@ -597,8 +826,10 @@ BOOL ObMap_Push(_In_opt_ POB_MAP pm, _In_ QWORD qwKey, _In_ PVOID pvObject)
 */
 POB_MAP ObMap_New(_In_ QWORD flags)
 {
+    DWORD i;
     POB_MAP pObMap;
     if((flags & OB_MAP_FLAGS_OBJECT_OB) && (flags & OB_MAP_FLAGS_OBJECT_LOCALFREE)) { return NULL; }
+    if((flags & OB_MAP_FLAGS_SHARDED) && (flags & OB_MAP_FLAGS_NOKEY)) { return NULL; }
     pObMap = Ob_Alloc(OB_TAG_CORE_MAP, LMEM_ZEROINIT, sizeof(OB_MAP), _ObMap_ObCloseCallback, NULL);
     if(!pObMap) { return NULL; }
     InitializeSRWLock(&pObMap->LockSRW);
@@ -612,5 +843,14 @@ POB_MAP ObMap_New(_In_ QWORD flags)
     pObMap->cHashMax = 0x100;
     pObMap->cHashGrowThreshold = 0xc0;
     pObMap->pHashMapKey = pObMap->pHashMapValue + pObMap->cHashMax;
+    if(flags & OB_MAP_FLAGS_SHARDED) {
+        pObMap->fSharded = TRUE;
+        for(i = 0; i < OB_MAP_SHARDS; i++) {
+            if(!(pObMap->pShard[i] = ObMap_New(flags & ~OB_MAP_FLAGS_SHARDED))) {
+                Ob_DECREF(pObMap);
+                return NULL;
+            }
+        }
+    }
     return pObMap;
 }
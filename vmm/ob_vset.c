@@ -9,14 +9,24 @@
 // iterations of the set with ObVSet_Get/ObVSet_GetNext may fail.
 // The ObVSet is an object manager object and must be DECREF'ed when required.
 //
+// Hash lookups are done on a flat open-addressing (linear probing) table of
+// value indexes. A parallel array of one byte hash tags per slot allows SSE2
+// probing of 16 slots at a time - only slots with a matching tag are compared
+// against the value store. Bulk operations (ObVSet_PushBatch/ExistsBatch) take
+// the lock once per batch and an optional unsynchronized builder mode removes
+// locking completely for sets only accessed by one thread during construction.
+//
 // (c) Ulf Frisk, 2019
 // Author: Ulf Frisk, pcileech@frizk.net
 //
 #include "ob.h"
+#include <emmintrin.h>
 
 #define OB_VSET_ENTRIES_DIRECTORY      0x100
 #define OB_VSET_ENTRIES_TABLE          0x80
 #define OB_VSET_ENTRIES_STORE          0x200
+#define OB_VSET_HASH_GROUP             0x10        // slots probed per SSE2 group
+#define OB_VSET_HASH_MAX               0x02000000
 
 typedef struct tdOB_VSET_TABLE_ENTRY {
     PQWORD pValues;                 // ptr to QWORD[0x200]
@@ -33,21 +43,26 @@ typedef struct tdOB_VSET {
     DWORD cHashMax;
     DWORD cHashGrowThreshold;
     BOOL fLargeMode;
+    BOOL fBuilder;                  // unsynchronized builder mode - single thread access only
     PDWORD pHashMapLarge;
+    PBYTE pbHashTag;                // tag per hash slot (0 = empty) + OB_VSET_HASH_GROUP mirrored slots
     union {
         WORD pHashMapSmall[0x400];
         OB_VSET_TABLE_DIRECTORY_ENTRY pDirectory[OB_VSET_ENTRIES_DIRECTORY];
     };
     OB_VSET_TABLE_ENTRY pTable0[OB_VSET_ENTRIES_TABLE];
     QWORD pStore00[OB_VSET_ENTRIES_STORE];
+    BYTE pbHashTagSmall[0x400 + OB_VSET_HASH_GROUP];
 } OB_VSET, *POB_VSET;
 
 #define OB_VSET_IS_VALID(p)         (p && (p->ObHdr._magic == OB_HEADER_MAGIC) && (p->ObHdr._tag == OB_TAG_CORE_VSET))
 #define TABLE_MAX_CAPACITY          VSET_ENTRIES_DIRECTORY * VSET_ENTRIES_TABLE * VSET_ENTRIES_STORE
 #define HASH_FUNCTION(v)            (13 * (v + _rotr16((WORD)v, 13) + _rotr((DWORD)v, 17) + _rotr64(v, 23)))
+#define HASH_TAG(h)                 ((BYTE)(0x80 | ((QWORD)(h) >> 57)))
 
 #define OB_VSET_CALL_SYNCHRONIZED_IMPLEMENTATION_WRITE(pvs, RetTp, RetValFail, fn) {    \
     if(!OB_VSET_IS_VALID(pvs)) { return RetValFail; }                                   \
+    if(pvs->fBuilder) { return fn; }                                                    \
     RetTp retVal;                                                                       \
     AcquireSRWLockExclusive(&pvs->LockSRW);                                             \
     retVal = fn;                                                                        \
@@ -57,6 +72,7 @@ typedef struct tdOB_VSET {
 
 #define OB_VSET_CALL_SYNCHRONIZED_IMPLEMENTATION_READ(pvs, RetTp, RetValFail, fn) {     \
     if(!OB_VSET_IS_VALID(pvs)) { return RetValFail; }                                   \
+    if(pvs->fBuilder) { return fn; }                                                    \
     RetTp retVal;                                                                       \
     AcquireSRWLockShared(&pvs->LockSRW);                                                \
     retVal = fn;                                                                        \
@@ -110,6 +126,7 @@ POB_VSET ObVSet_New()
     pObVSet->cHashMax = 0x400;
     pObVSet->cHashGrowThreshold = 0x300;
     pObVSet->pTable0[0].pValues = pObVSet->pStore00;
+    pObVSet->pbHashTag = pObVSet->pbHashTagSmall;
     return pObVSet;
 }
 
@@ -141,26 +158,32 @@ inline DWORD _ObVSet_GetIndexFromHash(_In_ POB_VSET pvs, _In_ DWORD iHash)
     return pvs->fLargeMode ? pvs->pHashMapLarge[iHash] : pvs->pHashMapSmall[iHash];
 }
 
-inline VOID _ObVSet_SetHashIndex(_In_ POB_VSET pvs, _In_ DWORD iHash, _In_ DWORD iValue)
+inline VOID _ObVSet_SetHashIndex(_In_ POB_VSET pvs, _In_ DWORD iHash, _In_ DWORD iValue, _In_ BYTE bTag)
 {
     if(pvs->fLargeMode) {
         pvs->pHashMapLarge[iHash] = iValue;
     } else {
         pvs->pHashMapSmall[iHash] = (WORD)iValue;
     }
+    pvs->pbHashTag[iHash] = bTag;
+    if(iHash < OB_VSET_HASH_GROUP) {    // mirror first group after end of table
+        pvs->pbHashTag[pvs->cHashMax + iHash] = bTag;
+    }
 }
 
 VOID _ObVSet_InsertHash(_In_ POB_VSET pvs, _In_ DWORD iValue)
 {
     DWORD iHash;
+    QWORD qwHash;
     DWORD dwHashMask = pvs->cHashMax - 1;
     QWORD qwValueToHash = _ObVSet_GetValueFromIndex(pvs, iValue);
     if(!qwValueToHash) { return; }
-    iHash = HASH_FUNCTION(qwValueToHash) & dwHashMask;
-    while(_ObVSet_GetIndexFromHash(pvs, iHash)) {
+    qwHash = HASH_FUNCTION(qwValueToHash);
+    iHash = qwHash & dwHashMask;
+    while(pvs->pbHashTag[iHash]) {
         iHash = (iHash + 1) & dwHashMask;
     }
-    _ObVSet_SetHashIndex(pvs, iHash, iValue);
+    _ObVSet_SetHashIndex(pvs, iHash, iValue, HASH_TAG(qwHash));
 }
 
 VOID _ObVSet_RemoveHash(_In_ POB_VSET pvs, _In_ DWORD iHash)
@@ -168,7 +191,7 @@ VOID _ObVSet_RemoveHash(_In_ POB_VSET pvs, _In_ DWORD iHash)
     DWORD dwHashMask = pvs->cHashMax - 1;
     DWORD iNextHash, iNextEntry, iNextHashPreferred;
     // clear existing hash entry
-    _ObVSet_SetHashIndex(pvs, iHash, 0);
+    _ObVSet_SetHashIndex(pvs, iHash, 0, 0);
     // re-hash any entries following
     iNextHash = iHash;
     while(TRUE) {
@@ -176,32 +199,47 @@ VOID _ObVSet_RemoveHash(_In_ POB_VSET pvs, _In_ DWORD iHash)
         iNextEntry = _ObVSet_GetIndexFromHash(pvs, iNextHash);
         if(0 == iNextEntry) { return; }
         iNextHashPreferred = HASH_FUNCTION(_ObVSet_GetValueFromIndex(pvs, iNextEntry)) & dwHashMask;
-        if(iNextHash == iNextHashPreferred) { return; }
-        if(pvs->fLargeMode) {
-            pvs->pHashMapLarge[iNextHash] = 0;
-        } else {
-            pvs->pHashMapSmall[iNextHash] = 0;
-        }
+        if(iNextHash == iNextHashPreferred) { continue; }
+        _ObVSet_SetHashIndex(pvs, iNextHash, 0, 0);
         _ObVSet_InsertHash(pvs, iNextEntry);
     }
 }
 
+/*
+* Locate a value by probing the hash tags 16 slots at a time with SSE2. Since
+* linear probing is used a value is always located before the first empty
+* slot following its preferred slot - only matching tags before the first
+* empty slot in a group are compared against the value store.
+*/
 _Success_(return)
 BOOL _ObVSet_GetIndexFromValue(_In_ POB_VSET pvs, _In_ QWORD v, _Out_opt_ PDWORD pdwIndexValue, _Out_opt_ PDWORD pdwIndexHash)
 {
-    DWORD dwIndex;
+    DWORD dwIndex, dwHashSlot, dwMatch, dwEmpty, iBit;
     DWORD dwHashMask = pvs->cHashMax - 1;
-    DWORD dwHash = HASH_FUNCTION(v) & dwHashMask;
+    QWORD qwHash = HASH_FUNCTION(v);
+    DWORD dwHash = qwHash & dwHashMask;
+    __m128i vTags, vTag = _mm_set1_epi8((char)HASH_TAG(qwHash)), vZero = _mm_setzero_si128();
     // scan hash table to find entry
     while(TRUE) {
-        dwIndex = _ObVSet_GetIndexFromHash(pvs, dwHash);
-        if(0 == dwIndex) { return FALSE; }
-        if(v == _ObVSet_GetValueFromIndex(pvs, dwIndex)) { 
-            if(pdwIndexValue) { *pdwIndexValue = dwIndex; }
-            if(pdwIndexHash) { *pdwIndexHash = dwHash; }
-            return TRUE;
+        vTags = _mm_loadu_si128((__m128i*)(pvs->pbHashTag + dwHash));
+        dwMatch = _mm_movemask_epi8(_mm_cmpeq_epi8(vTags, vTag));
+        dwEmpty = _mm_movemask_epi8(_mm_cmpeq_epi8(vTags, vZero));
+        if(dwEmpty) {
+            dwMatch &= dwEmpty ^ (dwEmpty - 1);     // slots up to the first empty slot
+        }
+        while(dwMatch) {
+            _BitScanForward(&iBit, dwMatch);
+            dwMatch &= dwMatch - 1;
+            dwHashSlot = (dwHash + iBit) & dwHashMask;
+            dwIndex = _ObVSet_GetIndexFromHash(pvs, dwHashSlot);
+            if(v == _ObVSet_GetValueFromIndex(pvs, dwIndex)) {
+                if(pdwIndexValue) { *pdwIndexValue = dwIndex; }
+                if(pdwIndexHash) { *pdwIndexHash = dwHashSlot; }
+                return TRUE;
+            }
         }
-        dwHash = (dwHash + 1) & dwHashMask;
+        if(dwEmpty) { return FALSE; }
+        dwHash = (dwHash + OB_VSET_HASH_GROUP) & dwHashMask;
     }
 }
 
@@ -303,18 +341,17 @@ BOOL ObVSet_Remove(_In_opt_ POB_VSET pvs, _In_ QWORD value)
 VOID ObVSet_Clear(_In_opt_ POB_VSET pvs)
 {
     if(!OB_VSET_IS_VALID(pvs) || (pvs->c <= 1)) { return; }
-    AcquireSRWLockExclusive(&pvs->LockSRW);
-    if(pvs->c <= 1) {
-        ReleaseSRWLockExclusive(&pvs->LockSRW);
-        return;
-    }
-    if(pvs->fLargeMode) {
-        ZeroMemory(pvs->pHashMapLarge, pvs->cHashMax * sizeof(DWORD));
-    } else {
-        ZeroMemory(pvs->pHashMapSmall, sizeof(pvs->pHashMapSmall));
+    if(!pvs->fBuilder) { AcquireSRWLockExclusive(&pvs->LockSRW); }
+    if(pvs->c > 1) {
+        if(pvs->fLargeMode) {
+            ZeroMemory(pvs->pHashMapLarge, pvs->cHashMax * sizeof(DWORD));
+        } else {
+            ZeroMemory(pvs->pHashMapSmall, sizeof(pvs->pHashMapSmall));
+        }
+        ZeroMemory(pvs->pbHashTag, pvs->cHashMax + OB_VSET_HASH_GROUP);
+        pvs->c = 1;     // item zero is reserved - hence the initialization of count to 1
     }
-    pvs->c = 1;     // item zero is reserved - hence the initialization of count to 1
-    ReleaseSRWLockExclusive(&pvs->LockSRW);
+    if(!pvs->fBuilder) { ReleaseSRWLockExclusive(&pvs->LockSRW); }
 }
 
 QWORD _ObVSet_Pop(_In_ POB_VSET pvs)
@@ -343,25 +380,33 @@ QWORD ObVSet_Pop(_In_opt_ POB_VSET pvs)
 }
 
 /*
-* Grow the Table for hash lookups by a factor of *2.
+* Grow the Table for hash lookups to (at least) hold the requested number of
+* values - the table size is doubled until that is the case. The hash tags
+* are allocated together with the hash map.
 * -- pvs
+* -- cValues
 * -- return
 */
 _Success_(return)
-BOOL _ObVSet_Grow(_In_ POB_VSET pvs)
+BOOL _ObVSet_Grow(_In_ POB_VSET pvs, _In_ DWORD cValues)
 {
-    DWORD iValue;
+    DWORD iValue, cHashMax = pvs->cHashMax * 2, cHashGrowThreshold = pvs->cHashGrowThreshold * 2;
     PDWORD pdwNewAllocHashMap;
-    if(!(pdwNewAllocHashMap = LocalAlloc(LMEM_ZEROINIT, 2 * sizeof(DWORD) * pvs->cHashMax))) { return FALSE; }
+    while((cValues >= cHashGrowThreshold) && (cHashMax < OB_VSET_HASH_MAX)) {
+        cHashMax *= 2;
+        cHashGrowThreshold *= 2;
+    }
+    if(!(pdwNewAllocHashMap = LocalAlloc(LMEM_ZEROINIT, (sizeof(DWORD) + 1) * cHashMax + OB_VSET_HASH_GROUP))) { return FALSE; }
     if(!pvs->fLargeMode) {
         ZeroMemory(pvs->pDirectory, OB_VSET_ENTRIES_DIRECTORY * sizeof(OB_VSET_TABLE_DIRECTORY_ENTRY));
         pvs->pDirectory[0].pTable = pvs->pTable0;
         pvs->fLargeMode = TRUE;
     }
-    pvs->cHashMax *= 2;
-    pvs->cHashGrowThreshold *= 2;
+    pvs->cHashMax = cHashMax;
+    pvs->cHashGrowThreshold = cHashGrowThreshold;
     LocalFree(pvs->pHashMapLarge);
     pvs->pHashMapLarge = pdwNewAllocHashMap;
+    pvs->pbHashTag = (PBYTE)(pdwNewAllocHashMap + cHashMax);
     for(iValue = 1; iValue < pvs->c; iValue++) {
         _ObVSet_InsertHash(pvs, iValue);
     }
@@ -379,7 +424,7 @@ BOOL _ObVSet_Push(_In_ POB_VSET pvs, _In_ QWORD value)
     if((value == 0) || _ObVSet_Exists(pvs, value)) { return FALSE; }
     if(iValue == OB_VSET_ENTRIES_DIRECTORY * OB_VSET_ENTRIES_TABLE * OB_VSET_ENTRIES_STORE) { return FALSE; }
     if(iValue == pvs->cHashGrowThreshold) {
-        if(!_ObVSet_Grow(pvs)) {
+        if(!_ObVSet_Grow(pvs, iValue)) {
             return FALSE;
         }
     }
@@ -411,6 +456,128 @@ BOOL ObVSet_Push(_In_opt_ POB_VSET pvs, _In_ QWORD value)
     OB_VSET_CALL_SYNCHRONIZED_IMPLEMENTATION_WRITE(pvs, BOOL, FALSE, _ObVSet_Push(pvs, value))
 }
 
+DWORD _ObVSet_PushBatch(_In_ POB_VSET pvs, _In_ DWORD cValues, _In_reads_(cValues) PQWORD pqwValues)
+{
+    DWORD i, cPushed = 0;
+    // grow hash table once up front rather than multiple times during insert.
+    if((pvs->c + cValues > pvs->cHashGrowThreshold) && (pvs->cHashMax < OB_VSET_HASH_MAX)) {
+        _ObVSet_Grow(pvs, pvs->c + cValues);
+    }
+    for(i = 0; i < cValues; i++) {
+        if(_ObVSet_Push(pvs, pqwValues[i])) { cPushed++; }
+    }
+    return cPushed;
+}
+
+/*
+* Push / Insert multiple non-zero values into the ObVSet. The lock is taken
+* once for the whole batch and the hash table is grown at most once.
+* -- pvs
+* -- cValues
+* -- pqwValues
+* -- return = the number of values inserted (values already existing or zero
+*             values are not inserted).
+*/
+DWORD ObVSet_PushBatch(_In_opt_ POB_VSET pvs, _In_ DWORD cValues, _In_reads_(cValues) PQWORD pqwValues)
+{
+    OB_VSET_CALL_SYNCHRONIZED_IMPLEMENTATION_WRITE(pvs, DWORD, 0, _ObVSet_PushBatch(pvs, cValues, pqwValues))
+}
+
+DWORD _ObVSet_ExistsBatch(_In_ POB_VSET pvs, _In_ DWORD cValues, _In_reads_(cValues) PQWORD pqwValues, _Out_writes_opt_(cValues) PBOOL pfExists)
+{
+    BOOL f;
+    DWORD i, cExists = 0;
+    for(i = 0; i < cValues; i++) {
+        f = _ObVSet_Exists(pvs, pqwValues[i]);
+        if(pfExists) { pfExists[i] = f; }
+        if(f) { cExists++; }
+    }
+    return cExists;
+}
+
+/*
+* Check if multiple values exists in the ObVSet. The lock is taken once for the
+* whole batch.
+* -- pvs
+* -- cValues
+* -- pqwValues
+* -- pfExists = optional array receiving the per-value result.
+* -- return = the number of values existing in the set.
+*/
+DWORD ObVSet_ExistsBatch(_In_opt_ POB_VSET pvs, _In_ DWORD cValues, _In_reads_(cValues) PQWORD pqwValues, _Out_writes_opt_(cValues) PBOOL pfExists)
+{
+    if(pfExists && !OB_VSET_IS_VALID(pvs)) { ZeroMemory(pfExists, cValues * sizeof(BOOL)); }
+    OB_VSET_CALL_SYNCHRONIZED_IMPLEMENTATION_READ(pvs, DWORD, 0, _ObVSet_ExistsBatch(pvs, cValues, pqwValues, pfExists))
+}
+
+int _ObVSet_GetSorted_CmpSort(_In_ PQWORD pqw1, _In_ PQWORD pqw2)
+{
+    return (*pqw1 < *pqw2) ? -1 : ((*pqw1 > *pqw2) ? 1 : 0);
+}
+
+PQWORD _ObVSet_GetSorted(_In_ POB_VSET pvs, _Out_ PDWORD pcValues)
+{
+    DWORD i, iTable;
+    PQWORD pqwValues;
+    *pcValues = 0;
+    if(pvs->c <= 1) { return NULL; }
+    if(!(pqwValues = LocalAlloc(0, (pvs->c - 1ULL) * sizeof(QWORD)))) { return NULL; }
+    // copy whole value stores at a time (value #0 is reserved).
+    for(i = 1; i < pvs->c; i += iTable) {
+        iTable = min(OB_VSET_ENTRIES_STORE - (i & (OB_VSET_ENTRIES_STORE - 1)), pvs->c - i);
+        memcpy(pqwValues + i - 1, pvs->fLargeMode ?
+            pvs->pDirectory[(i >> 14) & (OB_VSET_ENTRIES_DIRECTORY - 1)].pTable[(i >> 9) & (OB_VSET_ENTRIES_TABLE - 1)].pValues + (i & (OB_VSET_ENTRIES_STORE - 1)) :
+            pvs->pTable0[(i >> 9) & (OB_VSET_ENTRIES_TABLE - 1)].pValues + (i & (OB_VSET_ENTRIES_STORE - 1)),
+            iTable * sizeof(QWORD));
+    }
+    *pcValues = pvs->c - 1;
+    return pqwValues;
+}
+
+/*
+* Export all values in the ObVSet into a newly allocated array sorted in
+* ascending order.
+* CALLER LocalFree: return
+* -- pvs
+* -- pcValues = the number of values in the returned array.
+* -- return = the sorted values, or NULL if the set is empty or on failure.
+*/
+_Success_(return != NULL)
+PQWORD ObVSet_GetSorted(_In_opt_ POB_VSET pvs, _Out_ PDWORD pcValues)
+{
+    PQWORD pqwValues = NULL;
+    *pcValues = 0;
+    if(!OB_VSET_IS_VALID(pvs)) { return NULL; }
+    if(!pvs->fBuilder) { AcquireSRWLockShared(&pvs->LockSRW); }
+    pqwValues = _ObVSet_GetSorted(pvs, pcValues);
+    if(!pvs->fBuilder) { ReleaseSRWLockShared(&pvs->LockSRW); }
+    if(pqwValues) {
+        qsort(pqwValues, *pcValues, sizeof(QWORD), (int(*)(const void*, const void*))_ObVSet_GetSorted_CmpSort);
+    }
+    return pqwValues;
+}
+
+/*
+* Enable or disable the unsynchronized builder mode. While enabled no locking
+* takes place - the caller must guarantee that the set is only accessed by a
+* single thread. Builder mode must be disabled before the set is shared with
+* other threads.
+* -- pvs
+* -- fEnable
+*/
+VOID ObVSet_BuilderMode(_In_opt_ POB_VSET pvs, _In_ BOOL fEnable)
+{
+    if(!OB_VSET_IS_VALID(pvs)) { return; }
+    if(fEnable) {
+        AcquireSRWLockExclusive(&pvs->LockSRW);
+        pvs->fBuilder = TRUE;
+        ReleaseSRWLockExclusive(&pvs->LockSRW);
+    } else {
+        pvs->fBuilder = FALSE;
+        MemoryBarrier();
+    }
+}
+
 /*
 * Insert a value representing an address into the ObVSet. If the length of the
 * data read from the start of the address a traverses page boundries all the
@@ -10,6 +10,7 @@
 #include "pe.h"
 #include "util.h"
 #include "vmmwininit.h"
+#include "vmmtrace.h"
 #include <dbghelp.h>
 #include <winreg.h>
 #include <io.h>
@@ -18,6 +19,7 @@
 #define VMMWIN_PDB_LOAD_ADDRESS_BASE    0x0000511f'00000000;
 #define VMMWIN_PDB_FAKEPROCHANDLE       (HANDLE)0x00005fed'6fed7fed
 #define VMMWIN_PDB_WARN_DEFAULT         "WARNING: Functionality may be limited. Extended debug information disabled.\n"
+#define PDB_INDEX_TYPE_MAX              0x1000
 
 typedef struct tdPDB_ENTRY {
     OB ObHdr;
@@ -31,8 +33,45 @@ typedef struct tdPDB_ENTRY {
     BOOL fLoadFailed;
     LPSTR szPath;
     QWORD qwLoadAddress;
+    // lookup index below (lazy built on first query - read lock-free)
+    BOOL fSymbolIndexFailed;
+    POB volatile pObSymbolIndex;    // POB_PDB_SYMBOL_INDEX
+    POB_MAP pmObType;               // POB_PDB_TYPE by upper-case type query hash
+    POB_MAP pmSymbolQuery;          // PPDB_SYMBOL_QUERY (LocalAlloc) by upper-case symbol query hash
+    // symbol pack below
+    BOOL fPackTried;
+    BOOL fPackLoaded;
+    BOOL fPackDirty;
 } PDB_ENTRY, *PPDB_ENTRY;
 
+typedef struct tdPDB_SYMBOL_INDEX_ENTRY {
+    LPSTR szName;
+    DWORD dwRVA;
+    DWORD iOrdinal;                 // dbghelp enumeration order (stable sort)
+} PDB_SYMBOL_INDEX_ENTRY, *PPDB_SYMBOL_INDEX_ENTRY;
+
+typedef struct tdOB_PDB_SYMBOL_INDEX {
+    OB ObHdr;
+    DWORD cSymbols;
+    DWORD cbNames;
+    PBYTE pbNames;
+    PPDB_SYMBOL_INDEX_ENTRY pSymbols; // sorted case-insensitive by name
+} OB_PDB_SYMBOL_INDEX, *POB_PDB_SYMBOL_INDEX;
+
+typedef struct tdPDB_TYPE_CHILD {
+    LPWSTR wszName;
+    DWORD dwOffset;
+} PDB_TYPE_CHILD, *PPDB_TYPE_CHILD;
+
+typedef struct tdOB_PDB_TYPE {
+    OB ObHdr;
+    BOOL fValid;                    // FALSE = negative cache entry - type not found
+    DWORD dwSize;
+    DWORD cChild;
+    LPSTR szTypeName;
+    PDB_TYPE_CHILD pChild[];
+} OB_PDB_TYPE, *POB_PDB_TYPE;
+
 const LPSTR szVMMWIN_PDB_FUNCTIONS[] = {
     "SymGetOptions",
     "SymSetOptions",
@@ -65,9 +104,17 @@ typedef struct tdVMMWIN_PDB_CONTEXT {
     HMODULE hModuleSymSrv;
     HMODULE hModuleDbgHelp;
     CRITICAL_SECTION Lock;
+    CRITICAL_SECTION LockPack;      // symbol pack load - may be taken while holding Lock (not the reverse)
     POB_MAP pmPdbByHash;
     POB_MAP pmPdbByModule;
     QWORD qwLoadAddressNext;
+    struct {
+        BOOL fEnabled;
+        volatile LONG cThreads;
+        HANDLE hEvent;
+        POB_VSET psHigh;            // pdb handles of queried (touched) modules
+        POB_VSET psLow;             // pdb handles of registered modules
+    } Loader;
     union {
         VMMWIN_PDB_FUNCTIONS pfn;
         QWORD vafn[sizeof(VMMWIN_PDB_FUNCTIONS) / sizeof(PVOID)];
@@ -106,6 +153,9 @@ VOID PDB_CallbackCleanup_ObPdbEntry(PPDB_ENTRY pOb)
     LocalFree(pOb->szModuleName);
     LocalFree(pOb->szName);
     LocalFree(pOb->szPath);
+    Ob_DECREF(pOb->pObSymbolIndex);
+    Ob_DECREF(pOb->pmObType);
+    Ob_DECREF(pOb->pmSymbolQuery);
 }
 
 /*
@@ -135,9 +185,14 @@ VMMWIN_PDB_HANDLE PDB_AddModuleEntry(_In_ QWORD vaModuleBase, _In_ LPSTR szModul
         pObPdbEntry->szName = Util_StrDupA(szPdbName);
         pObPdbEntry->szModuleName = Util_StrDupA(szModuleName);
         pObPdbEntry->vaModuleBase = vaModuleBase;
+        pObPdbEntry->pmObType = ObMap_New(OB_MAP_FLAGS_OBJECT_OB);
+        pObPdbEntry->pmSymbolQuery = ObMap_New(OB_MAP_FLAGS_OBJECT_LOCALFREE);
         ObMap_Push(ctx->pmPdbByHash, qwPdbHash, pObPdbEntry);
         ObMap_Push(ctx->pmPdbByModule, PDB_HashModuleName(szModuleName), pObPdbEntry);
         Ob_DECREF(pObPdbEntry);
+        if(ctx->Loader.fEnabled && ObVSet_Push(ctx->Loader.psLow, qwPdbHash)) {
+            SetEvent(ctx->Loader.hEvent);
+        }
     }
     return qwPdbHash;
 }
@@ -179,19 +234,695 @@ BOOL PDB_PdbLoadEnsure(_In_ PPDB_ENTRY pPdbEntry)
 {
     PVMMWIN_PDB_CONTEXT ctx = (PVMMWIN_PDB_CONTEXT)ctxVmm->pPdbContext;
     CHAR szPdbPath[MAX_PATH + 1];
+    QWORD tmTrace;
     if(!ctx || pPdbEntry->fLoadFailed) { return FALSE; }
     if(pPdbEntry->qwLoadAddress) { return TRUE; }
+    tmTrace = VMMTRACE_IS_ENABLED() ? VmmTrace_Start() : 0;
     if(!ctx->pfn.SymFindFileInPath(ctx->hSym, NULL, pPdbEntry->szName, &pPdbEntry->pbGUID, pPdbEntry->dwAge, 0, SSRVOPT_GUIDPTR, szPdbPath, NULL, NULL)) { goto fail; }
     pPdbEntry->szPath = Util_StrDupA(szPdbPath);
     pPdbEntry->qwLoadAddress = ctx->pfn.SymLoadModuleEx(ctx->hSym, NULL, szPdbPath, NULL, ctx->qwLoadAddressNext, 0, NULL, 0);
     ctx->qwLoadAddressNext += VMMWIN_PDB_LOAD_ADDRESS_STEP;
     if(!pPdbEntry->szPath || !pPdbEntry->qwLoadAddress) { goto fail; }
+    if(tmTrace) { VmmTrace_Event(VMMTRACE_EVENT_PDB_LOAD, 0, pPdbEntry->qwLoadAddress, TRUE, tmTrace); }
     return TRUE;
 fail:
+    if(tmTrace) { VmmTrace_Event(VMMTRACE_EVENT_PDB_LOAD, 0, pPdbEntry->qwLoadAddress, FALSE, tmTrace); }
     pPdbEntry->fLoadFailed = TRUE;
     return FALSE;
 }
 
+// ----------------------------------------------------------------------------
+// BACKGROUND LOADER FUNCTIONALITY BELOW:
+// Once the kernel PDB is loaded PDBs of other modules are located/downloaded
+// and loaded by a background loader thread instead of by the first caller to
+// query them. Modules that have been queried are loaded before modules that
+// only have been registered. Queries against a PDB not yet loaded - and
+// without a symbol pack - return immediately (PDB_GetStatus() ==
+// PDB_STATUS_PENDING). API callers wait for the PDB instead (PDB_LoadWait).
+// ----------------------------------------------------------------------------
+
+BOOL PDB_Pack_Load(_In_ PPDB_ENTRY pPdbEntry);
+POB_PDB_SYMBOL_INDEX PDB_SymbolIndex_Build(_In_ PPDB_ENTRY pPdbEntry);
+
+DWORD PDB_Loader_ThreadProc(_In_ PVMMWIN_PDB_CONTEXT ctx)
+{
+    QWORD qwPdbHash;
+    PPDB_ENTRY pObPdbEntry;
+    while(ctx->Loader.fEnabled && ctxVmm->ThreadWorkers.fEnabled) {
+        if(!(qwPdbHash = ObVSet_Pop(ctx->Loader.psHigh)) && !(qwPdbHash = ObVSet_Pop(ctx->Loader.psLow))) {
+            WaitForSingleObject(ctx->Loader.hEvent, 500);
+            continue;
+        }
+        if(!(pObPdbEntry = ObMap_GetByKey(ctx->pmPdbByHash, qwPdbHash))) { continue; }
+        EnterCriticalSection(&ctx->Lock);
+        if(ctx->Loader.fEnabled && !PDB_Pack_Load(pObPdbEntry) && PDB_PdbLoadEnsure(pObPdbEntry)) {
+            PDB_SymbolIndex_Build(pObPdbEntry);
+            vmmprintfvv_fn("Loaded '%s' [%s]\n", pObPdbEntry->szName, pObPdbEntry->szModuleName);
+        }
+        LeaveCriticalSection(&ctx->Lock);
+        Ob_DECREF(pObPdbEntry);
+    }
+    InterlockedDecrement(&ctx->Loader.cThreads);
+    return 1;
+}
+
+/*
+* Start the background loader. Should be called once the kernel PDB is loaded.
+* NB! dbghelp.dll is single-threaded - a single loader thread is used.
+*/
+VOID PDB_Loader_Start(_In_ PVMMWIN_PDB_CONTEXT ctx)
+{
+    HANDLE hThread;
+    if(ctx->Loader.fEnabled) { return; }
+    if(!(ctx->Loader.hEvent = CreateEvent(NULL, FALSE, FALSE, NULL))) { goto fail; }
+    if(!(ctx->Loader.psHigh = ObVSet_New())) { goto fail; }
+    if(!(ctx->Loader.psLow = ObVSet_New())) { goto fail; }
+    ctx->Loader.fEnabled = TRUE;
+    InterlockedIncrement(&ctx->Loader.cThreads);
+    if(!(hThread = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)PDB_Loader_ThreadProc, ctx, 0, NULL))) {
+        InterlockedDecrement(&ctx->Loader.cThreads);
+        ctx->Loader.fEnabled = FALSE;
+        goto fail;
+    }
+    CloseHandle(hThread);
+    return;
+fail:
+    if(ctx->Loader.hEvent) { CloseHandle(ctx->Loader.hEvent); }
+    Ob_DECREF_NULL(&ctx->Loader.psHigh);
+    Ob_DECREF_NULL(&ctx->Loader.psLow);
+    ctx->Loader.hEvent = NULL;
+}
+
+/*
+* Stop the background loader and wait for the loader thread to exit.
+*/
+VOID PDB_Loader_Stop(_In_ PVMMWIN_PDB_CONTEXT ctx)
+{
+    if(!ctx->Loader.hEvent) { return; }
+    ctx->Loader.fEnabled = FALSE;
+    SetEvent(ctx->Loader.hEvent);
+    while(ctx->Loader.cThreads) {
+        SwitchToThread();
+    }
+    CloseHandle(ctx->Loader.hEvent);
+    Ob_DECREF_NULL(&ctx->Loader.psHigh);
+    Ob_DECREF_NULL(&ctx->Loader.psLow);
+    ctx->Loader.hEvent = NULL;
+}
+
+/*
+* Defer loading of a not yet loaded PDB to the background loader (with high
+* priority since it's queried). The symbol pack of the PDB - which is quick to
+* load and does not require dbghelp - is tried first.
+* -- ctx
+* -- pPdbEntry
+* -- return = TRUE if deferred - i.e. symbols are not yet ready.
+*/
+BOOL PDB_Loader_Defer(_In_ PVMMWIN_PDB_CONTEXT ctx, _In_ PPDB_ENTRY pPdbEntry)
+{
+    if(!ctx->Loader.fEnabled || pPdbEntry->qwLoadAddress || pPdbEntry->fLoadFailed || pPdbEntry->fPackLoaded) { return FALSE; }
+    if(PDB_Pack_Load(pPdbEntry)) { return FALSE; }
+    ObVSet_Push(ctx->Loader.psHigh, pPdbEntry->qwHash);
+    SetEvent(ctx->Loader.hEvent);
+    return TRUE;
+}
+
+/*
+* Retrieve the load status of a PDB.
+* -- hPDB
+* -- return = PDB_STATUS_*
+*/
+DWORD PDB_GetStatus(_In_opt_ VMMWIN_PDB_HANDLE hPDB)
+{
+    PVMMWIN_PDB_CONTEXT ctx = (PVMMWIN_PDB_CONTEXT)ctxVmm->pPdbContext;
+    PPDB_ENTRY pObPdbEntry;
+    DWORD dwStatus = PDB_STATUS_FAILED;
+    if(!ctx || !hPDB) { return PDB_STATUS_FAILED; }
+    if(ctx->fDisabled) { return ctxMain->pdb.fEnable ? PDB_STATUS_PENDING : PDB_STATUS_FAILED; }
+    if(hPDB == VMMWIN_PDB_HANDLE_KERNEL) { hPDB = PDB_GetHandleFromModuleName("ntoskrnl.exe"); }
+    if(!(pObPdbEntry = ObMap_GetByKey(ctx->pmPdbByHash, hPDB))) { return PDB_STATUS_FAILED; }
+    if(pObPdbEntry->qwLoadAddress || pObPdbEntry->fPackLoaded) {
+        dwStatus = PDB_STATUS_READY;
+    } else if(!pObPdbEntry->fLoadFailed) {
+        dwStatus = PDB_STATUS_PENDING;
+    }
+    Ob_DECREF(pObPdbEntry);
+    return dwStatus;
+}
+
+/*
+* Wait for the PDB subsystem to be initialized and load a not yet loaded PDB
+* (or its symbol pack) synchronously on the caller thread - bypassing the
+* background loader. This may take some time if the PDB has to be downloaded.
+* -- hPDB
+* -- return = PDB_STATUS_*
+*/
+DWORD PDB_LoadWait(_In_opt_ VMMWIN_PDB_HANDLE hPDB)
+{
+    PVMMWIN_PDB_CONTEXT ctx = (PVMMWIN_PDB_CONTEXT)ctxVmm->pPdbContext;
+    PPDB_ENTRY pObPdbEntry;
+    DWORD dwStatus;
+    if(!ctx || !hPDB) { return PDB_STATUS_FAILED; }
+    PDB_Initialize_WaitComplete();
+    if((dwStatus = PDB_GetStatus(hPDB)) != PDB_STATUS_PENDING) { return dwStatus; }
+    if(hPDB == VMMWIN_PDB_HANDLE_KERNEL) { hPDB = PDB_GetHandleFromModuleName("ntoskrnl.exe"); }
+    if(!(pObPdbEntry = ObMap_GetByKey(ctx->pmPdbByHash, hPDB))) { return PDB_STATUS_FAILED; }
+    EnterCriticalSection(&ctx->Lock);
+    if(!PDB_Pack_Load(pObPdbEntry) && PDB_PdbLoadEnsure(pObPdbEntry)) {
+        PDB_SymbolIndex_Build(pObPdbEntry);
+    }
+    LeaveCriticalSection(&ctx->Lock);
+    Ob_DECREF(pObPdbEntry);
+    return PDB_GetStatus(hPDB);
+}
+
+// ----------------------------------------------------------------------------
+// SYMBOL AND TYPE INDEX FUNCTIONALITY BELOW:
+// Symbols of a loaded PDB are indexed in a case-insensitive sorted name array
+// on first query. Types are indexed (size and data member offsets) when first
+// queried. Once indexed lookups are served lock-free without dbghelp.
+// ----------------------------------------------------------------------------
+
+/*
+* Index key of a symbol/type query - upper-case hash and length.
+*/
+QWORD PDB_IndexKey(_In_ LPSTR sz)
+{
+    return ((QWORD)Util_HashStringUpperA(sz) << 32) | (DWORD)strlen(sz);
+}
+
+typedef struct tdPDB_SYMBOL_INDEX_BUILD_CONTEXT {
+    BOOL fFail;
+    DWORD c;
+    DWORD cMax;
+    DWORD cb;
+    DWORD cbMax;
+    PBYTE pb;
+    PPDB_SYMBOL_INDEX_ENTRY pe;
+} PDB_SYMBOL_INDEX_BUILD_CONTEXT, *PPDB_SYMBOL_INDEX_BUILD_CONTEXT;
+
+VOID PDB_CallbackCleanup_ObSymbolIndex(POB_PDB_SYMBOL_INDEX pOb)
+{
+    LocalFree(pOb->pbNames);
+    LocalFree(pOb->pSymbols);
+}
+
+VOID PDB_CallbackCleanup_ObType(POB_PDB_TYPE pOb)
+{
+    LocalFree(pOb->szTypeName);
+}
+
+int PDB_SymbolIndex_CmpSort(PPDB_SYMBOL_INDEX_ENTRY a, PPDB_SYMBOL_INDEX_ENTRY b)
+{
+    int i = _stricmp(a->szName, b->szName);
+    return i ? i : (int)(a->iOrdinal - b->iOrdinal);
+}
+
+/*
+* Callback function for PDB_SymbolIndex_Build() / SymEnumSymbols()
+*/
+BOOL PDB_SymbolIndex_Build_Callback(_In_ PSYMBOL_INFO pSymInfo, _In_ ULONG SymbolSize, _In_ PPDB_SYMBOL_INDEX_BUILD_CONTEXT ctx)
+{
+    PVOID pvNew;
+    DWORD cMaxNew, cch;
+    if(pSymInfo->Address - pSymInfo->ModBase >= 0x10000000) { return TRUE; }
+    cch = (DWORD)strnlen_s(pSymInfo->Name, min(pSymInfo->NameLen, pSymInfo->MaxNameLen));
+    if(!cch) { return TRUE; }
+    if(ctx->c == ctx->cMax) {
+        cMaxNew = ctx->cMax ? 2 * ctx->cMax : 0x4000;
+        pvNew = ctx->pe ? LocalReAlloc(ctx->pe, cMaxNew * sizeof(PDB_SYMBOL_INDEX_ENTRY), LMEM_MOVEABLE) : LocalAlloc(0, cMaxNew * sizeof(PDB_SYMBOL_INDEX_ENTRY));
+        if(!pvNew) { goto fail; }
+        ctx->pe = pvNew;
+        ctx->cMax = cMaxNew;
+    }
+    if(ctx->cb + cch + 1 > ctx->cbMax) {
+        cMaxNew = max(2 * ctx->cbMax, 0x00100000);
+        pvNew = ctx->pb ? LocalReAlloc(ctx->pb, cMaxNew, LMEM_MOVEABLE) : LocalAlloc(0, cMaxNew);
+        if(!pvNew) { goto fail; }
+        ctx->pb = pvNew;
+        ctx->cbMax = cMaxNew;
+    }
+    memcpy(ctx->pb + ctx->cb, pSymInfo->Name, cch);
+    ctx->pb[ctx->cb + cch] = 0;
+    ctx->pe[ctx->c].szName = (LPSTR)(SIZE_T)ctx->cb;    // offset - fixed up once complete
+    ctx->pe[ctx->c].dwRVA = (DWORD)(pSymInfo->Address - pSymInfo->ModBase);
+    ctx->pe[ctx->c].iOrdinal = ctx->c;
+    ctx->c++;
+    ctx->cb += cch + 1;
+    return TRUE;
+fail:
+    ctx->fFail = TRUE;
+    return FALSE;
+}
+
+/*
+* Build the symbol index of a loaded PDB and publish it in the PDB entry.
+* NB! must be called with ctx->Lock held and with the PDB loaded.
+* -- pPdbEntry
+* -- return = the symbol index, NULL on fail. NB! no INCREF.
+*/
+POB_PDB_SYMBOL_INDEX PDB_SymbolIndex_Build(_In_ PPDB_ENTRY pPdbEntry)
+{
+    PVMMWIN_PDB_CONTEXT ctx = (PVMMWIN_PDB_CONTEXT)ctxVmm->pPdbContext;
+    PDB_SYMBOL_INDEX_BUILD_CONTEXT ctxBuild = { 0 };
+    POB_PDB_SYMBOL_INDEX pObIndex = NULL;
+    DWORD i;
+    if(pPdbEntry->pObSymbolIndex) { return (POB_PDB_SYMBOL_INDEX)pPdbEntry->pObSymbolIndex; }
+    if(pPdbEntry->fSymbolIndexFailed) { return NULL; }
+    if(!ctx->pfn.SymEnumSymbols(ctx->hSym, pPdbEntry->qwLoadAddress, "*", (PSYM_ENUMERATESYMBOLS_CALLBACK)PDB_SymbolIndex_Build_Callback, &ctxBuild) || ctxBuild.fFail || !ctxBuild.c) { goto fail; }
+    if(!(pObIndex = Ob_Alloc(OB_TAG_PDB_SYMBOLINDEX, LMEM_ZEROINIT, sizeof(OB_PDB_SYMBOL_INDEX), PDB_CallbackCleanup_ObSymbolIndex, NULL))) { goto fail; }
+    for(i = 0; i < ctxBuild.c; i++) {
+        ctxBuild.pe[i].szName = (LPSTR)(ctxBuild.pb + (SIZE_T)ctxBuild.pe[i].szName);
+    }
+    qsort(ctxBuild.pe, ctxBuild.c, sizeof(PDB_SYMBOL_INDEX_ENTRY), (int(*)(const void*, const void*))PDB_SymbolIndex_CmpSort);
+    pObIndex->cSymbols = ctxBuild.c;
+    pObIndex->pSymbols = ctxBuild.pe;
+    pObIndex->cbNames = ctxBuild.cb;
+    pObIndex->pbNames = ctxBuild.pb;
+    vmmprintfvv_fn("Indexed %i symbols in '%s'.\n", pObIndex->cSymbols, pPdbEntry->szName);
+    InterlockedExchangePointer(&pPdbEntry->pObSymbolIndex, pObIndex);
+    return pObIndex;
+fail:
+    LocalFree(ctxBuild.pe);
+    LocalFree(ctxBuild.pb);
+    pPdbEntry->fSymbolIndexFailed = TRUE;
+    return NULL;
+}
+
+/*
+* Look up a symbol in the symbol index. Exact names are located by a binary
+* search. Names with wildcard '?*' characters are matched against the name
+* range sharing the literal prefix of the pattern - the 1st symbol in name
+* order is returned.
+* -- pIndex
+* -- szSymbolName
+* -- pdwSymbolOffset
+* -- return
+*/
+_Success_(return)
+BOOL PDB_SymbolIndex_Lookup(_In_ POB_PDB_SYMBOL_INDEX pIndex, _In_ LPSTR szSymbolName, _Out_ PDWORD pdwSymbolOffset)
+{
+    int iCmp;
+    DWORD cchPrefix, iLo = 0, iHi = pIndex->cSymbols, iMid;
+    cchPrefix = (DWORD)strcspn(szSymbolName, "*?");
+    // 1: locate the 1st entry >= the literal prefix (or the exact name).
+    while(iLo < iHi) {
+        iMid = (iLo + iHi) / 2;
+        iCmp = szSymbolName[cchPrefix] ?
+            _strnicmp(pIndex->pSymbols[iMid].szName, szSymbolName, cchPrefix) :
+            _stricmp(pIndex->pSymbols[iMid].szName, szSymbolName);
+        if(iCmp < 0) {
+            iLo = iMid + 1;
+        } else {
+            iHi = iMid;
+        }
+    }
+    // 2: exact match
+    if(!szSymbolName[cchPrefix]) {
+        if((iLo < pIndex->cSymbols) && !_stricmp(pIndex->pSymbols[iLo].szName, szSymbolName)) {
+            *pdwSymbolOffset = pIndex->pSymbols[iLo].dwRVA;
+            return *pdwSymbolOffset != 0;
+        }
+        return FALSE;
+    }
+    // 3: wildcard match within the prefix range
+    for(; (iLo < pIndex->cSymbols) && !_strnicmp(pIndex->pSymbols[iLo].szName, szSymbolName, cchPrefix); iLo++) {
+        if(pIndex->pSymbols[iLo].dwRVA && Util_WildcardMatchA(szSymbolName, pIndex->pSymbols[iLo].szName)) {
+            *pdwSymbolOffset = pIndex->pSymbols[iLo].dwRVA;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/*
+* Callback function for PDB_TypeIndex_Build() / SymEnumTypesByName()
+*/
+BOOL PDB_TypeIndex_Build_Callback(_In_ PSYMBOL_INFO pSymInfo, _In_ ULONG SymbolSize, _Inout_ PDWORD pdw)
+{
+    pdw[0] = pSymInfo->Size;
+    pdw[1] = pSymInfo->Index;
+    return FALSE;
+}
+
+/*
+* Create a type index entry and add it to the type index of the PDB entry.
+* CALLER DECREF: return
+* -- pPdbEntry
+* -- szTypeName
+* -- fValid = FALSE for negative entries (type not found).
+* -- dwSize
+* -- cChild
+* -- pChild = data members - names are copied.
+* -- return
+*/
+POB_PDB_TYPE PDB_TypeIndex_Push(_In_ PPDB_ENTRY pPdbEntry, _In_ LPSTR szTypeName, _In_ BOOL fValid, _In_ DWORD dwSize, _In_ DWORD cChild, _In_reads_(cChild) PPDB_TYPE_CHILD pChild)
+{
+    DWORD i, cch, cwszNames = 0;
+    LPWSTR wszNames;
+    POB_PDB_TYPE pObType;
+    for(i = 0; i < cChild; i++) {
+        cwszNames += (DWORD)wcslen(pChild[i].wszName) + 1;
+    }
+    pObType = Ob_Alloc(OB_TAG_PDB_TYPE, LMEM_ZEROINIT, sizeof(OB_PDB_TYPE) + cChild * sizeof(PDB_TYPE_CHILD) + cwszNames * sizeof(WCHAR), PDB_CallbackCleanup_ObType, NULL);
+    if(!pObType) { return NULL; }
+    if(!(pObType->szTypeName = Util_StrDupA(szTypeName))) {
+        Ob_DECREF(pObType);
+        return NULL;
+    }
+    pObType->fValid = fValid;
+    pObType->dwSize = dwSize;
+    pObType->cChild = cChild;
+    wszNames = (LPWSTR)(pObType->pChild + cChild);
+    for(i = 0; i < cChild; i++) {
+        cch = (DWORD)wcslen(pChild[i].wszName) + 1;
+        pObType->pChild[i].wszName = wszNames;
+        pObType->pChild[i].dwOffset = pChild[i].dwOffset;
+        wcscpy_s(wszNames, cwszNames, pChild[i].wszName);
+        cwszNames -= cch;
+        wszNames += cch;
+    }
+    if(ObMap_Size(pPdbEntry->pmObType) >= PDB_INDEX_TYPE_MAX) {
+        ObMap_Clear(pPdbEntry->pmObType);
+    }
+    ObMap_Push(pPdbEntry->pmObType, PDB_IndexKey(szTypeName), pObType);
+    return pObType;
+}
+
+/*
+* Retrieve a type (size and data member offsets) from the type index. If the
+* type is not yet indexed it is resolved through dbghelp and added to the index.
+* Types not found are added to the index as negative entries.
+* CALLER DECREF: return
+* -- pPdbEntry
+* -- szTypeName = wildcard type name.
+* -- return
+*/
+POB_PDB_TYPE PDB_TypeIndex_Get(_In_ PPDB_ENTRY pPdbEntry, _In_ LPSTR szTypeName)
+{
+    PVMMWIN_PDB_CONTEXT ctx = (PVMMWIN_PDB_CONTEXT)ctxVmm->pPdbContext;
+    DWORD i, cChild = 0, cTypeChildren = 0, dwOffset, dwSizeAndId[2] = { 0 };
+    QWORD qwKey;
+    LPWSTR wszChild;
+    POB_PDB_TYPE pObType = NULL;
+    PPDB_TYPE_CHILD pChildTmp = NULL;
+    TI_FINDCHILDREN_PARAMS *pFindChildren = NULL;
+    qwKey = PDB_IndexKey(szTypeName);
+    // 1: lock-free fast path - already indexed (or loaded from symbol pack)
+    if((pObType = ObMap_GetByKey(pPdbEntry->pmObType, qwKey))) {
+        if(!_stricmp(pObType->szTypeName, szTypeName)) { return pObType; }
+        Ob_DECREF_NULL(&pObType);
+    }
+    // 2: resolve type through dbghelp and index it (unless deferred to background loader)
+    if(PDB_Loader_Defer(ctx, pPdbEntry)) { return NULL; }
+    EnterCriticalSection(&ctx->Lock);
+    PDB_Pack_Load(pPdbEntry);
+    if((pObType = ObMap_GetByKey(pPdbEntry->pmObType, qwKey))) { goto finish; }
+    if(!PDB_PdbLoadEnsure(pPdbEntry)) { goto finish; }
+    if(ctx->pfn.SymEnumTypesByName(ctx->hSym, pPdbEntry->qwLoadAddress, szTypeName, PDB_TypeIndex_Build_Callback, dwSizeAndId) && dwSizeAndId[1]) {
+        if(ctx->pfn.SymGetTypeInfo(ctx->hSym, pPdbEntry->qwLoadAddress, dwSizeAndId[1], TI_GET_CHILDRENCOUNT, &cTypeChildren) && cTypeChildren) {
+            pFindChildren = LocalAlloc(LMEM_ZEROINIT, sizeof(TI_FINDCHILDREN_PARAMS) + cTypeChildren * sizeof(ULONG));
+            pChildTmp = LocalAlloc(LMEM_ZEROINIT, cTypeChildren * sizeof(PDB_TYPE_CHILD));
+            if(pFindChildren && pChildTmp) {
+                pFindChildren->Count = cTypeChildren;
+                if(ctx->pfn.SymGetTypeInfo(ctx->hSym, pPdbEntry->qwLoadAddress, dwSizeAndId[1], TI_FINDCHILDREN, pFindChildren)) {
+                    for(i = 0; i < cTypeChildren; i++) {
+                        if(!ctx->pfn.SymGetTypeInfo(ctx->hSym, pPdbEntry->qwLoadAddress, pFindChildren->ChildId[i], TI_GET_SYMNAME, &wszChild)) { continue; }
+                        if(!ctx->pfn.SymGetTypeInfo(ctx->hSym, pPdbEntry->qwLoadAddress, pFindChildren->ChildId[i], TI_GET_OFFSET, &dwOffset)) {
+                            LocalFree(wszChild);
+                            continue;
+                        }
+                        pChildTmp[cChild].wszName = wszChild;
+                        pChildTmp[cChild].dwOffset = dwOffset;
+                        cChild++;
+                    }
+                }
+            }
+        }
+    }
+    if((pObType = PDB_TypeIndex_Push(pPdbEntry, szTypeName, (dwSizeAndId[1] != 0), dwSizeAndId[0], cChild, pChildTmp))) {
+        pPdbEntry->fPackDirty = TRUE;
+    }
+finish:
+    LeaveCriticalSection(&ctx->Lock);
+    if(pChildTmp) {
+        for(i = 0; i < cChild; i++) {
+            LocalFree(pChildTmp[i].wszName);
+        }
+    }
+    LocalFree(pChildTmp);
+    LocalFree(pFindChildren);
+    if(pObType && _stricmp(pObType->szTypeName, szTypeName)) {
+        Ob_DECREF_NULL(&pObType);       // hash collision with other indexed type
+    }
+    return pObType;
+}
+
+// ----------------------------------------------------------------------------
+// SYMBOL QUERY INDEX FUNCTIONALITY BELOW:
+// Resolved symbol queries (incl. wildcard queries and not found symbols) are
+// remembered per PDB so that repeated queries as well as symbol pack backed
+// queries are served lock-free.
+// ----------------------------------------------------------------------------
+
+typedef struct tdPDB_SYMBOL_QUERY {
+    DWORD dwRVA;                    // 0 = symbol not found
+    CHAR szName[];
+} PDB_SYMBOL_QUERY, *PPDB_SYMBOL_QUERY;
+
+_Success_(return)
+BOOL PDB_SymbolQuery_Get(_In_ PPDB_ENTRY pPdbEntry, _In_ LPSTR szSymbolName, _Out_ PDWORD pdwRVA)
+{
+    PPDB_SYMBOL_QUERY pq = ObMap_GetByKey(pPdbEntry->pmSymbolQuery, PDB_IndexKey(szSymbolName));
+    if(!pq || _stricmp(pq->szName, szSymbolName)) { return FALSE; }
+    *pdwRVA = pq->dwRVA;
+    return TRUE;
+}
+
+/*
+* Remember a resolved symbol query. The query index is never cleared since
+* its entries are accessed lock-free - it stops growing once full.
+*/
+_Success_(return)
+BOOL PDB_SymbolQuery_Push(_In_ PPDB_ENTRY pPdbEntry, _In_ LPSTR szSymbolName, _In_ DWORD dwRVA)
+{
+    PPDB_SYMBOL_QUERY pq;
+    DWORD cch = (DWORD)strlen(szSymbolName);
+    if(ObMap_Size(pPdbEntry->pmSymbolQuery) >= PDB_INDEX_TYPE_MAX) { return FALSE; }
+    if(!(pq = LocalAlloc(0, sizeof(PDB_SYMBOL_QUERY) + cch + 1))) { return FALSE; }
+    pq->dwRVA = dwRVA;
+    memcpy(pq->szName, szSymbolName, cch + 1);
+    if(!ObMap_Push(pPdbEntry->pmSymbolQuery, PDB_IndexKey(szSymbolName), pq)) {
+        LocalFree(pq);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// ----------------------------------------------------------------------------
+// SYMBOL PACK FUNCTIONALITY BELOW:
+// A symbol pack is a compact binary file in the local symbol cache directory
+// keyed by PDB name, GUID and age. It contains the symbol queries and types
+// used by MemProcFS. If a symbol pack exists the PDB itself is only loaded if
+// a symbol or type missing in the pack is queried. Symbol packs are enabled
+// by the -symbolpack option and are (re-)written on close if new symbols or
+// types have been resolved.
+// File format: header followed by cSymbol symbol records followed by cType
+// type records:
+//   symbol: WORD cch, CHAR[cch] name, DWORD rva (0 = not found).
+//   type:   WORD cch, CHAR[cch] name, DWORD fValid, DWORD cb, DWORD cChild,
+//           cChild * { WORD cch, WCHAR[cch] name, DWORD offset }.
+// ----------------------------------------------------------------------------
+
+#define PDB_PACK_MAGIC                  0x50595350      // 'PSYP'
+#define PDB_PACK_VERSION                1
+#define PDB_PACK_MAX_SIZE               0x00400000
+
+typedef struct tdPDB_PACK_HEADER {
+    DWORD dwMagic;
+    DWORD dwVersion;
+    BYTE pbGUID[16];
+    DWORD dwAge;
+    DWORD cSymbol;
+    DWORD cType;
+    DWORD cbData;
+} PDB_PACK_HEADER, *PPDB_PACK_HEADER;
+
+/*
+* Retrieve the symbol pack file path of a PDB entry.
+* -- pPdbEntry
+* -- szPath
+* -- return
+*/
+_Success_(return)
+BOOL PDB_Pack_Path(_In_ PPDB_ENTRY pPdbEntry, _Out_writes_(MAX_PATH) LPSTR szPath)
+{
+    if(!pPdbEntry->szName || !pPdbEntry->szName[0] || strpbrk(pPdbEntry->szName, "\\/:*?\"<>|")) { return FALSE; }
+    return _snprintf_s(szPath, MAX_PATH, _TRUNCATE, "%s\\%s-%016llx%016llx-%i.sympack",
+        ctxMain->pdb.szLocal,
+        pPdbEntry->szName,
+        _byteswap_uint64(*(PQWORD)pPdbEntry->pbGUID),
+        _byteswap_uint64(*(PQWORD)(pPdbEntry->pbGUID + 8)),
+        pPdbEntry->dwAge) > 0;
+}
+
+/*
+* Read a NULL terminated string (cch incl. terminator) from a symbol pack buffer.
+*/
+_Success_(return)
+BOOL PDB_Pack_ReadString(_In_ PBYTE pb, _In_ DWORD cb, _Inout_ PDWORD po, _In_ DWORD cbChar, _Out_ PVOID *ppv)
+{
+    WORD cch;
+    if(*po + sizeof(WORD) > cb) { return FALSE; }
+    cch = *(PWORD)(pb + *po);
+    if(!cch || (*po + sizeof(WORD) + (QWORD)cch * cbChar > cb)) { return FALSE; }
+    *ppv = pb + *po + sizeof(WORD);
+    if(memcmp((PBYTE)*ppv + (cch - 1) * cbChar, "\0\0", cbChar)) { return FALSE; }
+    *po += sizeof(WORD) + cch * cbChar;
+    return TRUE;
+}
+
+/*
+* Load the symbol pack of a PDB entry (if enabled and existing) into the symbol
+* query index and the type index. The symbol pack is only tried once.
+* NB! must be called with ctx->LockPack held.
+* -- pPdbEntry
+* -- return = TRUE if a symbol pack is loaded.
+*/
+BOOL PDB_Pack_Load_DoWork(_In_ PPDB_ENTRY pPdbEntry)
+{
+    FILE *hFile = NULL;
+    PBYTE pb = NULL;
+    DWORD i, j, o = 0, cChild, fValid, dwSize;
+    LPSTR szName;
+    PDB_PACK_HEADER hdr;
+    CHAR szPath[MAX_PATH];
+    PPDB_TYPE_CHILD pChild = NULL;
+    if(!ctxMain->cfg.fSymbolPack || pPdbEntry->fPackTried) { return pPdbEntry->fPackLoaded; }
+    pPdbEntry->fPackTried = TRUE;
+    if(!PDB_Pack_Path(pPdbEntry, szPath)) { return FALSE; }
+    if(fopen_s(&hFile, szPath, "rb") || !hFile) { return FALSE; }
+    if((1 != fread(&hdr, sizeof(PDB_PACK_HEADER), 1, hFile)) || (hdr.dwMagic != PDB_PACK_MAGIC) || (hdr.dwVersion != PDB_PACK_VERSION)) { goto fail; }
+    if(memcmp(hdr.pbGUID, pPdbEntry->pbGUID, 16) || (hdr.dwAge != pPdbEntry->dwAge) || (hdr.cbData > PDB_PACK_MAX_SIZE)) { goto fail; }
+    if(!(pb = LocalAlloc(0, max(1, hdr.cbData)))) { goto fail; }
+    if(hdr.cbData != fread(pb, 1, hdr.cbData, hFile)) { goto fail; }
+    // 1: symbols
+    for(i = 0; i < hdr.cSymbol; i++) {
+        if(!PDB_Pack_ReadString(pb, hdr.cbData, &o, sizeof(CHAR), (PVOID*)&szName) || (o + sizeof(DWORD) > hdr.cbData)) { goto fail; }
+        PDB_SymbolQuery_Push(pPdbEntry, szName, *(PDWORD)(pb + o));
+        o += sizeof(DWORD);
+    }
+    // 2: types
+    for(i = 0; i < hdr.cType; i++) {
+        if(!PDB_Pack_ReadString(pb, hdr.cbData, &o, sizeof(CHAR), (PVOID*)&szName) || (o + 3 * sizeof(DWORD) > hdr.cbData)) { goto fail; }
+        fValid = *(PDWORD)(pb + o + 0);
+        dwSize = *(PDWORD)(pb + o + 4);
+        cChild = *(PDWORD)(pb + o + 8);
+        o += 3 * sizeof(DWORD);
+        if(cChild > 0xffff) { goto fail; }
+        LocalFree(pChild);
+        if(!(pChild = LocalAlloc(0, max(1, cChild) * sizeof(PDB_TYPE_CHILD)))) { goto fail; }
+        for(j = 0; j < cChild; j++) {
+            if(!PDB_Pack_ReadString(pb, hdr.cbData, &o, sizeof(WCHAR), (PVOID*)&pChild[j].wszName) || (o + sizeof(DWORD) > hdr.cbData)) { goto fail; }
+            pChild[j].dwOffset = *(PDWORD)(pb + o);
+            o += sizeof(DWORD);
+        }
+        Ob_DECREF(PDB_TypeIndex_Push(pPdbEntry, szName, fValid, dwSize, cChild, pChild));
+    }
+    pPdbEntry->fPackLoaded = TRUE;
+    vmmprintfv_fn("Loaded symbol pack '%s'.\n", szPath);
+fail:
+    if(!pPdbEntry->fPackLoaded) {
+        vmmprintfv_fn("Symbol pack '%s' is invalid - ignoring.\n", szPath);
+    }
+    LocalFree(pChild);
+    LocalFree(pb);
+    fclose(hFile);
+    return pPdbEntry->fPackLoaded;
+}
+
+/*
+* Load the symbol pack of a PDB entry (if enabled and existing). The pack may
+* be loaded with or without ctx->Lock held.
+* -- pPdbEntry
+* -- return = TRUE if a symbol pack is loaded.
+*/
+BOOL PDB_Pack_Load(_In_ PPDB_ENTRY pPdbEntry)
+{
+    BOOL fResult;
+    PVMMWIN_PDB_CONTEXT ctx = (PVMMWIN_PDB_CONTEXT)ctxVmm->pPdbContext;
+    if(!ctxMain->cfg.fSymbolPack || pPdbEntry->fPackTried || !ctx) { return pPdbEntry->fPackLoaded; }
+    EnterCriticalSection(&ctx->LockPack);
+    fResult = PDB_Pack_Load_DoWork(pPdbEntry);
+    LeaveCriticalSection(&ctx->LockPack);
+    return fResult;
+}
+
+BOOL PDB_Pack_WriteString(_In_ FILE *hFile, _In_ PVOID pv, _In_ DWORD cch, _In_ DWORD cbChar, _Inout_ PDWORD pcb)
+{
+    WORD wcch = (WORD)(cch + 1);
+    if(cch >= 0xffff) { return FALSE; }
+    *pcb += sizeof(WORD) + wcch * cbChar;
+    return (1 == fwrite(&wcch, sizeof(WORD), 1, hFile)) && (wcch == fwrite(pv, cbChar, wcch, hFile));
+}
+
+/*
+* Write the symbol pack of a PDB entry if new symbol queries or types have been
+* resolved since the symbol pack was loaded (or if no symbol pack existed).
+* The pack is written to a temporary file which replaces any existing pack.
+* -- pPdbEntry
+*/
+VOID PDB_Pack_Write(_In_ PPDB_ENTRY pPdbEntry)
+{
+    FILE *hFile = NULL;
+    BOOL fError;
+    DWORD i, dw[3];
+    CHAR szPath[MAX_PATH], szPathTmp[MAX_PATH];
+    PDB_PACK_HEADER hdr = { 0 };
+    PPDB_SYMBOL_QUERY pq = NULL;
+    POB_PDB_TYPE pObType = NULL;
+    if(!ctxMain->cfg.fSymbolPack || !pPdbEntry->fPackDirty) { return; }
+    if(!ObMap_Size(pPdbEntry->pmSymbolQuery) && !ObMap_Size(pPdbEntry->pmObType)) { return; }
+    if(!PDB_Pack_Path(pPdbEntry, szPath)) { return; }
+    if(_snprintf_s(szPathTmp, MAX_PATH, _TRUNCATE, "%s.tmp", szPath) < 0) { return; }
+    if(fopen_s(&hFile, szPathTmp, "wb") || !hFile) {
+        vmmprintfv_fn("Unable to create symbol pack '%s'.\n", szPathTmp);
+        return;
+    }
+    hdr.dwMagic = PDB_PACK_MAGIC;
+    hdr.dwVersion = PDB_PACK_VERSION;
+    hdr.dwAge = pPdbEntry->dwAge;
+    memcpy(hdr.pbGUID, pPdbEntry->pbGUID, 16);
+    fError = (1 != fwrite(&hdr, sizeof(PDB_PACK_HEADER), 1, hFile));
+    while(!fError && (pq = ObMap_GetNext(pPdbEntry->pmSymbolQuery, pq))) {
+        fError = !PDB_Pack_WriteString(hFile, pq->szName, (DWORD)strlen(pq->szName), sizeof(CHAR), &hdr.cbData) || (1 != fwrite(&pq->dwRVA, sizeof(DWORD), 1, hFile));
+        hdr.cbData += sizeof(DWORD);
+        hdr.cSymbol++;
+    }
+    while(!fError && (pObType = ObMap_GetNext(pPdbEntry->pmObType, pObType))) {
+        dw[0] = pObType->fValid;
+        dw[1] = pObType->dwSize;
+        dw[2] = pObType->cChild;
+        fError = !PDB_Pack_WriteString(hFile, pObType->szTypeName, (DWORD)strlen(pObType->szTypeName), sizeof(CHAR), &hdr.cbData) || (3 != fwrite(dw, sizeof(DWORD), 3, hFile));
+        hdr.cbData += 3 * sizeof(DWORD);
+        for(i = 0; !fError && (i < pObType->cChild); i++) {
+            fError = !PDB_Pack_WriteString(hFile, pObType->pChild[i].wszName, (DWORD)wcslen(pObType->pChild[i].wszName), sizeof(WCHAR), &hdr.cbData) || (1 != fwrite(&pObType->pChild[i].dwOffset, sizeof(DWORD), 1, hFile));
+            hdr.cbData += sizeof(DWORD);
+        }
+        hdr.cType++;
+    }
+    Ob_DECREF_NULL(&pObType);
+    fError = fError || (hdr.cbData > PDB_PACK_MAX_SIZE) || _fseeki64(hFile, 0, SEEK_SET) || (1 != fwrite(&hdr, sizeof(PDB_PACK_HEADER), 1, hFile));
+    fError = fclose(hFile) || fError;
+    if(fError || !MoveFileExA(szPathTmp, szPath, MOVEFILE_REPLACE_EXISTING)) {
+        vmmprintfv_fn("Unable to write symbol pack '%s'.\n", szPath);
+        DeleteFileA(szPathTmp);
+        return;
+    }
+    pPdbEntry->fPackDirty = FALSE;
+    vmmprintfv_fn("Wrote symbol pack '%s' (%i symbols, %i types).\n", szPath, hdr.cSymbol, hdr.cType);
+}
+
 /*
 * Callback function for PDB_GetSymbolOffset() / SymEnumSymbols()
 */
@@ -217,20 +948,38 @@ BOOL PDB_GetSymbolOffset(_In_opt_ VMMWIN_PDB_HANDLE hPDB, _In_ LPSTR szSymbolNam
 {
     PVMMWIN_PDB_CONTEXT ctx = (PVMMWIN_PDB_CONTEXT)ctxVmm->pPdbContext;
     PPDB_ENTRY pObPdbEntry = NULL;
-    BOOL fResult = FALSE;
+    POB_PDB_SYMBOL_INDEX pIndex;
+    DWORD dwRVA = 0;
     if(!ctx || ctx->fDisabled || !hPDB) { return FALSE; }
     if(hPDB == VMMWIN_PDB_HANDLE_KERNEL) { hPDB = PDB_GetHandleFromModuleName("ntoskrnl.exe"); }
     if(!(pObPdbEntry = ObMap_GetByKey(ctx->pmPdbByHash, hPDB))) { return FALSE; }
+    // 1: lock-free fast path - already resolved query (or loaded from symbol pack)
+    if(PDB_SymbolQuery_Get(pObPdbEntry, szSymbolName, &dwRVA)) { goto finish; }
+    // 2: lock-free fast path - symbol index already built
+    if((pIndex = (POB_PDB_SYMBOL_INDEX)pObPdbEntry->pObSymbolIndex)) {
+        if(!PDB_SymbolIndex_Lookup(pIndex, szSymbolName, &dwRVA)) { dwRVA = 0; }
+        if(PDB_SymbolQuery_Push(pObPdbEntry, szSymbolName, dwRVA)) { pObPdbEntry->fPackDirty = TRUE; }
+        goto finish;
+    }
+    // 3: load symbol pack or pdb and build symbol index - fall back to dbghelp on fail
+    //    (unless deferred to background loader - symbols not yet ready)
+    if(PDB_Loader_Defer(ctx, pObPdbEntry)) { goto finish; }
     EnterCriticalSection(&ctx->Lock);
-    if(!PDB_PdbLoadEnsure(pObPdbEntry)) { goto fail; }
-    *pdwSymbolOffset = 0;
-    if(!ctx->pfn.SymEnumSymbols(ctx->hSym, pObPdbEntry->qwLoadAddress, szSymbolName, PDB_GetSymbolOffset_Callback, pdwSymbolOffset)) { goto fail; }
-    if(!*pdwSymbolOffset) { goto fail; }
-    fResult = TRUE;
-fail:
+    PDB_Pack_Load(pObPdbEntry);
+    if(!PDB_SymbolQuery_Get(pObPdbEntry, szSymbolName, &dwRVA) && PDB_PdbLoadEnsure(pObPdbEntry)) {
+        if((pIndex = PDB_SymbolIndex_Build(pObPdbEntry))) {
+            if(!PDB_SymbolIndex_Lookup(pIndex, szSymbolName, &dwRVA)) { dwRVA = 0; }
+        } else if(!ctx->pfn.SymEnumSymbols(ctx->hSym, pObPdbEntry->qwLoadAddress, szSymbolName, PDB_GetSymbolOffset_Callback, &dwRVA)) {
+            dwRVA = 0;
+        }
+        if(PDB_SymbolQuery_Push(pObPdbEntry, szSymbolName, dwRVA)) { pObPdbEntry->fPackDirty = TRUE; }
+    }
     LeaveCriticalSection(&ctx->Lock);
+finish:
     Ob_DECREF(pObPdbEntry);
-    return fResult;
+    if(!dwRVA) { return FALSE; }
+    *pdwSymbolOffset = dwRVA;
+    return TRUE;
 }
 
 /*
@@ -285,15 +1034,6 @@ BOOL PDB_GetSymbolPBYTE(_In_opt_ VMMWIN_PDB_HANDLE hPDB, _In_ LPSTR szSymbolName
     return fResult;
 }
 
-/*
-* Callback function for PDB_GetTypeSize() / SymEnumTypesByName()
-*/
-BOOL PDB_GetTypeSize_Callback(_In_ PSYMBOL_INFO pSymInfo, _In_ ULONG SymbolSize, _In_ PDWORD pdwTypeSize)
-{
-    *pdwTypeSize = pSymInfo->Size;
-    return FALSE;
-}
-
 /*
 * Query the PDB for the size of a type. If szTypeName contains wildcard '?*'
 * characters and matches multiple types the size of the 1st type is returned.
@@ -307,32 +1047,20 @@ BOOL PDB_GetTypeSize(_In_opt_ VMMWIN_PDB_HANDLE hPDB, _In_ LPSTR szTypeName, _Ou
 {
     PVMMWIN_PDB_CONTEXT ctx = (PVMMWIN_PDB_CONTEXT)ctxVmm->pPdbContext;
     PPDB_ENTRY pObPdbEntry = NULL;
+    POB_PDB_TYPE pObType = NULL;
     BOOL fResult = FALSE;
     if(!ctx || ctx->fDisabled || !hPDB) { return FALSE; }
     if(hPDB == VMMWIN_PDB_HANDLE_KERNEL) { hPDB = PDB_GetHandleFromModuleName("ntoskrnl.exe"); }
     if(!(pObPdbEntry = ObMap_GetByKey(ctx->pmPdbByHash, hPDB))) { return FALSE; }
-    EnterCriticalSection(&ctx->Lock);
-    if(!PDB_PdbLoadEnsure(pObPdbEntry)) { goto fail; }
-    *pdwTypeSize = 0;
-    if(!ctx->pfn.SymEnumTypesByName(ctx->hSym, pObPdbEntry->qwLoadAddress, szTypeName, PDB_GetTypeSize_Callback, pdwTypeSize)) { goto fail; }
-    if(!*pdwTypeSize) { goto fail; }
-    fResult = TRUE;
-fail:
-    LeaveCriticalSection(&ctx->Lock);
+    if((pObType = PDB_TypeIndex_Get(pObPdbEntry, szTypeName)) && pObType->fValid && pObType->dwSize) {
+        *pdwTypeSize = pObType->dwSize;
+        fResult = TRUE;
+    }
+    Ob_DECREF(pObType);
     Ob_DECREF(pObPdbEntry);
     return fResult;
 }
 
-/*
-* Callback function for PDB_GetTypeChildOffset()
-*/
-BOOL PDB_GetTypeChildOffset_Callback(_In_ PSYMBOL_INFO pSymInfo, _In_ ULONG SymbolSize, _In_ PDWORD pdwTypeId)
-{
-    *pdwTypeId = pSymInfo->Index;
-    pSymInfo->Index;
-    return FALSE;
-}
-
 /*
 * Query the PDB for the offset of a child inside a type - often inside a struct.
 * If szTypeName contains wildcard '?*' characters and matches multiple types the
@@ -347,35 +1075,23 @@ _Success_(return)
 BOOL PDB_GetTypeChildOffset(_In_opt_ VMMWIN_PDB_HANDLE hPDB, _In_ LPSTR szTypeName, _In_ LPWSTR wszTypeChildName, _Out_ PDWORD pdwTypeOffset)
 {
     PVMMWIN_PDB_CONTEXT ctx = (PVMMWIN_PDB_CONTEXT)ctxVmm->pPdbContext;
-    BOOL fResult = FALSE;
-    LPWSTR wszTypeChildSymName;
     PPDB_ENTRY pObPdbEntry = NULL;
-    DWORD dwTypeId, cTypeChildren, iTypeChild;
-    TI_FINDCHILDREN_PARAMS *pFindChildren = NULL;
+    POB_PDB_TYPE pObType = NULL;
+    BOOL fResult = FALSE;
+    DWORD i;
     if(!ctx || ctx->fDisabled || !hPDB) { return FALSE; }
     if(hPDB == VMMWIN_PDB_HANDLE_KERNEL) { hPDB = PDB_GetHandleFromModuleName("ntoskrnl.exe"); }
     if(!(pObPdbEntry = ObMap_GetByKey(ctx->pmPdbByHash, hPDB))) { return FALSE; }
-    EnterCriticalSection(&ctx->Lock);
-    if(!PDB_PdbLoadEnsure(pObPdbEntry)) { goto fail; }
-    if(!ctx->pfn.SymEnumTypesByName(ctx->hSym, pObPdbEntry->qwLoadAddress, szTypeName, PDB_GetTypeChildOffset_Callback, &dwTypeId) || !dwTypeId) { goto fail; }
-    if(!ctx->pfn.SymGetTypeInfo(ctx->hSym, pObPdbEntry->qwLoadAddress, dwTypeId, TI_GET_CHILDRENCOUNT, &cTypeChildren) || !cTypeChildren) { goto fail; }
-    if(!(pFindChildren = LocalAlloc(LMEM_ZEROINIT, sizeof(TI_FINDCHILDREN_PARAMS) + cTypeChildren * sizeof(ULONG)))) { goto fail; }
-    pFindChildren->Count = cTypeChildren;
-    if(!ctx->pfn.SymGetTypeInfo(ctx->hSym, pObPdbEntry->qwLoadAddress, dwTypeId, TI_FINDCHILDREN, pFindChildren)) { goto fail; }
-    for(iTypeChild = 0; iTypeChild < cTypeChildren; iTypeChild++) {
-        if(!ctx->pfn.SymGetTypeInfo(ctx->hSym, pObPdbEntry->qwLoadAddress, pFindChildren->ChildId[iTypeChild], TI_GET_SYMNAME, &wszTypeChildSymName)) { continue; }
-        if(!wcscmp(wszTypeChildName, wszTypeChildSymName)) {
-            if(ctx->pfn.SymGetTypeInfo(ctx->hSym, pObPdbEntry->qwLoadAddress, pFindChildren->ChildId[iTypeChild], TI_GET_OFFSET, pdwTypeOffset)) {
-                LocalFree(wszTypeChildSymName);
+    if((pObType = PDB_TypeIndex_Get(pObPdbEntry, szTypeName)) && pObType->fValid) {
+        for(i = 0; i < pObType->cChild; i++) {
+            if(!wcscmp(wszTypeChildName, pObType->pChild[i].wszName)) {
+                *pdwTypeOffset = pObType->pChild[i].dwOffset;
                 fResult = TRUE;
                 break;
             }
         }
-        LocalFree(wszTypeChildSymName);
     }
-fail:
-    LocalFree(pFindChildren);
-    LeaveCriticalSection(&ctx->Lock);
+    Ob_DECREF(pObType);
     Ob_DECREF(pObPdbEntry);
     return fResult;
 }
@@ -401,11 +1117,17 @@ BOOL PDB_GetTypeChildOffsetShort(_In_opt_ VMMWIN_PDB_HANDLE hPDB, _In_ LPSTR szT
 VOID PDB_Close()
 {
     PVMMWIN_PDB_CONTEXT ctx = (PVMMWIN_PDB_CONTEXT)ctxVmm->pPdbContext;
+    PPDB_ENTRY pObPdbEntry = NULL;
     if(!ctx) { return; }
+    PDB_Loader_Stop(ctx);
     ctxVmm->pPdbContext = NULL;
     EnterCriticalSection(&ctx->Lock);
+    while((pObPdbEntry = ObMap_GetNext(ctx->pmPdbByHash, pObPdbEntry))) {
+        PDB_Pack_Write(pObPdbEntry);
+    }
     LeaveCriticalSection(&ctx->Lock);
     DeleteCriticalSection(&ctx->Lock);
+    DeleteCriticalSection(&ctx->LockPack);
     if(ctx->hSym) {
         ctx->pfn.SymCleanup(ctx->hSym);
     }
@@ -494,12 +1216,13 @@ DWORD PDB_Initialize_Async_Kernel(LPVOID lpParameter)
         vmmprintf("%s         Reason: Failed creating initial PDB entry.\n", VMMWIN_PDB_WARN_DEFAULT);
         goto fail;
     }
-    if(!PDB_PdbLoadEnsure(pObKernelEntry)) {
+    if(!PDB_Pack_Load(pObKernelEntry) && !PDB_PdbLoadEnsure(pObKernelEntry)) {
         vmmprintf("%s         Reason: Unable to download kernel symbols to cache from Symbol Server.\n", VMMWIN_PDB_WARN_DEFAULT);
         goto fail;
     }
     vmmprintfvv_fn("Initialization of debug symbol .pdb functionality completed.\n    [ %s ]\n", ctxMain->pdb.szSymbolPath);
     ctx->fDisabled = FALSE;
+    PDB_Loader_Start(ctx);
     dwReturnStatus = 1;
     // fall-through to fail for cleanup
 fail:
@@ -585,10 +1308,12 @@ VOID PDB_ConfigChange()
         }
         RegCloseKey(hKey);
     }
-    // refresh values and reload!
+    // refresh values and reload! (process refreshes may use kernel symbols)
     EnterCriticalSection(&ctxVmm->MasterLock);
+    EnterCriticalSection(&ctxVmm->LockUpdateProc);
     PDB_Close();
     PDB_Initialize(NULL, FALSE);
+    LeaveCriticalSection(&ctxVmm->LockUpdateProc);
     LeaveCriticalSection(&ctxVmm->MasterLock);
 }
 
@@ -606,7 +1331,7 @@ VOID PDB_Initialize(_In_opt_ PIMAGE_DEBUG_TYPE_CODEVIEW_PDBINFO pPdbInfoOpt, _In
     PDB_Initialize_InitialValues();
     if(!ctxMain->pdb.fEnable) { goto fail; }
     if(!(ctx = LocalAlloc(LMEM_ZEROINIT, sizeof(VMMWIN_PDB_CONTEXT)))) { goto fail; }
-    if(!(ctx->pmPdbByHash = ObMap_New(OB_MAP_FLAGS_OBJECT_OB))) { goto fail; }
+    if(!(ctx->pmPdbByHash = ObMap_New(OB_MAP_FLAGS_OBJECT_OB | OB_MAP_FLAGS_SHARDED))) { goto fail; }
     if(!(ctx->pmPdbByModule = ObMap_New(OB_MAP_FLAGS_OBJECT_OB))) { goto fail; }
     // 1: dynamic load of dbghelp.dll and symsrv.dll from directory of vmm.dll - i.e. not from system32
     Util_GetPathDll(szPathSymSrv, ctxVmm->hModuleVmm);
@@ -650,6 +1375,7 @@ VOID PDB_Initialize(_In_opt_ PIMAGE_DEBUG_TYPE_CODEVIEW_PDBINFO pPdbInfoOpt, _In
         memcpy(&pKernelParameters->PdbInfo, pPdbInfoOpt, sizeof(IMAGE_DEBUG_TYPE_CODEVIEW_PDBINFO));
     }
     InitializeCriticalSection(&ctx->Lock);
+    InitializeCriticalSection(&ctx->LockPack);
     ctx->qwLoadAddressNext = VMMWIN_PDB_LOAD_ADDRESS_BASE;
     ctx->fDisabled = TRUE;
     ctxVmm->pPdbContext = ctx;
@@ -657,6 +1383,7 @@ VOID PDB_Initialize(_In_opt_ PIMAGE_DEBUG_TYPE_CODEVIEW_PDBINFO pPdbInfoOpt, _In
         hThreadAsyncKernel = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)PDB_Initialize_Async_Kernel, (LPVOID)pKernelParameters, 0, NULL);
         if(!hThreadAsyncKernel) {
             DeleteCriticalSection(&ctx->Lock);
+            DeleteCriticalSection(&ctx->LockPack);
             goto fail;
         }
         WaitForSingleObject(hEventThreadStarted, 500);  // wait for async thread initialize thread to start (and acquire PDB lock).
@@ -12,6 +12,10 @@
 
 #define VMMWIN_PDB_HANDLE_KERNEL            ((QWORD)-1)
 
+#define PDB_STATUS_READY                    0
+#define PDB_STATUS_PENDING                  1   // symbols not yet ready - queued for background load
+#define PDB_STATUS_FAILED                   2
+
 /*
 * Initialize the PDB sub-system. This should ideally be done on Vmm Init().
 * -- pPdbInfoOpt
@@ -38,8 +42,9 @@ VOID PDB_ConfigChange();
 
 /*
 * Add a module to the PDB database and return its handle. The PDB for the added
-* module won't be loaded until required. If the module already exists in the
-* PDB database the handle will also be returned.
+* module is loaded by the background loader once the kernel PDB is loaded. The
+* PDB is prioritized in the background loader once it's queried. If the module
+* already exists in the PDB database the handle will also be returned.
 * -- vaModuleBase
 * -- szModuleName
 * -- szPdbName
@@ -49,6 +54,24 @@ VOID PDB_ConfigChange();
 */
 VMMWIN_PDB_HANDLE PDB_AddModuleEntry(_In_ QWORD vaModuleBase, _In_ LPSTR szModuleName, _In_ LPSTR szPdbName, _In_reads_(16) PBYTE pbPdbGUID, _In_ DWORD dwPdbAge);
 
+/*
+* Retrieve the load status of a PDB. Symbol and type queries against a PDB not
+* yet loaded by the background loader fail immediately with PDB_STATUS_PENDING.
+* -- hPDB
+* -- return = PDB_STATUS_*
+*/
+DWORD PDB_GetStatus(_In_opt_ VMMWIN_PDB_HANDLE hPDB);
+
+/*
+* Wait for the PDB subsystem to be initialized and load a not yet loaded PDB
+* synchronously on the caller thread instead of deferring it to the background
+* loader. Used by API callers which expect a result rather than a pending
+* status. NB! may take some time if the PDB has to be downloaded.
+* -- hPDB
+* -- return = PDB_STATUS_*
+*/
+DWORD PDB_LoadWait(_In_opt_ VMMWIN_PDB_HANDLE hPDB);
+
 /*
 * Retrieve a PDB handle from an already added module.
 * NB! If multiple modules exists with the same name the 1st module to be added
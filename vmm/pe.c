@@ -134,22 +134,71 @@ fail:
     return FALSE;
 }
 
-_Success_(return)
-BOOL PE_GetThunkInfoEAT(_In_ PVMM_PROCESS pProcess, _In_ QWORD vaModuleBase, _In_ LPSTR szProcName, _Out_ PPE_THUNKINFO_EAT pThunkInfoEAT)
+#define PE_EXPORTINDEX_MODULES_MAX      0x400
+
+typedef struct tdPEOB_EXPORTINDEX {
+    OB ObHdr;
+    QWORD vaExportDirectory;
+    DWORD cbExportDirectory;
+    DWORD oExportDirectory;         // export directory offset (RVA) from module base
+    DWORD cNames;
+    DWORD cFunctions;
+    DWORD oFunctions;               // AddressOfFunctions offset into pbExportDirectory
+    DWORD dwHashMask;
+    PDWORD pdwRVAAddrNames;         // ptr into pbExportDirectory
+    PDWORD pdwRVAAddrFunctions;     // ptr into pbExportDirectory
+    PWORD pwNameOrdinals;           // ptr into pbExportDirectory
+    PDWORD pdwHashTable;            // [dwHashMask + 1] name index + 1, 0 = empty
+    PBYTE pbExportDirectory;
+} PEOB_EXPORTINDEX, *PPEOB_EXPORTINDEX;
+
+VOID PE_ExportIndex_CloseObCallback(_In_ PVOID pOb)
+{
+    LocalFree(((PPEOB_EXPORTINDEX)pOb)->pdwHashTable);
+}
+
+/*
+* 32-bit FNV-1a hash of a null-terminated export name of max cbMax bytes.
+* -- sz
+* -- cbMax
+* -- pcb = length of name including terminating null (0 if not terminated).
+* -- return
+*/
+DWORD PE_ExportIndex_HashName(_In_ LPSTR sz, _In_ DWORD cbMax, _Out_ PDWORD pcb)
+{
+    DWORD i, dwHash = 0x811c9dc5;
+    for(i = 0; i < cbMax; i++) {
+        if(!sz[i]) {
+            *pcb = i + 1;
+            return dwHash;
+        }
+        dwHash = (dwHash ^ (BYTE)sz[i]) * 0x01000193;
+    }
+    *pcb = 0;
+    return dwHash;
+}
+
+/*
+* Create a new export index by reading the export directory of the module and
+* building an open addressing hash table over the exported names.
+* CALLER DECREF: return
+* -- pProcess
+* -- vaModuleBase
+* -- pfComplete = TRUE if the whole export directory was read successfully.
+* -- return
+*/
+PPEOB_EXPORTINDEX PE_ExportIndex_New(_In_ PVMM_PROCESS pProcess, _In_ QWORD vaModuleBase, _Out_ PBOOL pfComplete)
 {
     BYTE pbModuleHeader[0x1000] = { 0 };
     PIMAGE_NT_HEADERS32 ntHeader32;
     PIMAGE_NT_HEADERS64 ntHeader64;
-    PDWORD pdwRVAAddrNames, pdwRVAAddrFunctions;
-    PWORD pwNameOrdinals;
-    DWORD i, cbProcName, cbExportDirectoryOffset, cbRead = 0;
-    LPSTR sz;
-    QWORD vaExportDirectory;
-    DWORD cbExportDirectory;
-    PBYTE pbExportDirectory = NULL;
-    QWORD vaRVAAddrNames, vaNameOrdinals, vaRVAAddrFunctions;
+    PIMAGE_EXPORT_DIRECTORY exp;
+    PPEOB_EXPORTINDEX pObIndex = NULL;
+    QWORD vaExportDirectory, vaRVAAddrNames, vaNameOrdinals, vaRVAAddrFunctions;
+    DWORD i, iSlot, dwHash, cbName, cbExportDirectory, cbRead = 0, cHashTable = 1;
     BOOL f32;
-    if(!(ntHeader64 = PE_HeaderGetVerify(pProcess, vaModuleBase, pbModuleHeader, &f32))) { goto cleanup; }
+    *pfComplete = FALSE;
+    if(!(ntHeader64 = PE_HeaderGetVerify(pProcess, vaModuleBase, pbModuleHeader, &f32))) { return NULL; }
     if(f32) { // 32-bit PE
         ntHeader32 = (PIMAGE_NT_HEADERS32)ntHeader64;
         vaExportDirectory = vaModuleBase + ntHeader32->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT].VirtualAddress;
@@ -158,40 +207,126 @@ BOOL PE_GetThunkInfoEAT(_In_ PVMM_PROCESS pProcess, _In_ QWORD vaModuleBase, _In
         vaExportDirectory = vaModuleBase + ntHeader64->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT].VirtualAddress;
         cbExportDirectory = ntHeader64->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT].Size;
     }
-    if((cbExportDirectory < sizeof(IMAGE_EXPORT_DIRECTORY)) || (cbExportDirectory > 0x01000000) || (vaExportDirectory == vaModuleBase) || (vaExportDirectory > vaModuleBase + 0x80000000)) { goto cleanup; }
-    if(!(pbExportDirectory = LocalAlloc(0, cbExportDirectory))) { goto cleanup; }
-    VmmReadEx(pProcess, vaExportDirectory, pbExportDirectory, cbExportDirectory, &cbRead, VMM_FLAG_ZEROPAD_ON_FAIL);
-    if(!cbRead) { goto cleanup; }
-    PIMAGE_EXPORT_DIRECTORY exp = (PIMAGE_EXPORT_DIRECTORY)pbExportDirectory;
-    if(!exp || !exp->NumberOfNames || !exp->AddressOfNames) { goto cleanup; }
+    if((cbExportDirectory < sizeof(IMAGE_EXPORT_DIRECTORY)) || (cbExportDirectory > 0x01000000) || (vaExportDirectory == vaModuleBase) || (vaExportDirectory > vaModuleBase + 0x80000000)) { return NULL; }
+    if(!(pObIndex = Ob_Alloc(OB_TAG_PE_EXPORTINDEX, LMEM_ZEROINIT, sizeof(PEOB_EXPORTINDEX) + cbExportDirectory, PE_ExportIndex_CloseObCallback, NULL))) { return NULL; }
+    pObIndex->pbExportDirectory = (PBYTE)pObIndex + sizeof(PEOB_EXPORTINDEX);
+    pObIndex->vaExportDirectory = vaExportDirectory;
+    pObIndex->cbExportDirectory = cbExportDirectory;
+    pObIndex->oExportDirectory = (DWORD)(vaExportDirectory - vaModuleBase);
+    VmmReadEx(pProcess, vaExportDirectory, pObIndex->pbExportDirectory, cbExportDirectory, &cbRead, VMM_FLAG_ZEROPAD_ON_FAIL);
+    if(!cbRead) { goto fail; }
+    *pfComplete = (cbRead == cbExportDirectory);
+    exp = (PIMAGE_EXPORT_DIRECTORY)pObIndex->pbExportDirectory;
+    if(!exp->NumberOfNames || !exp->AddressOfNames) { goto fail; }
     vaRVAAddrNames = vaModuleBase + exp->AddressOfNames;
     vaNameOrdinals = vaModuleBase + exp->AddressOfNameOrdinals;
     vaRVAAddrFunctions = vaModuleBase + exp->AddressOfFunctions;
-    if((vaRVAAddrNames < vaExportDirectory) || (vaRVAAddrNames > vaExportDirectory + cbExportDirectory - exp->NumberOfNames * sizeof(DWORD))) { goto cleanup; }
-    if((vaNameOrdinals < vaExportDirectory) || (vaNameOrdinals > vaExportDirectory + cbExportDirectory - exp->NumberOfNames * sizeof(WORD))) { goto cleanup; }
-    if((vaRVAAddrFunctions < vaExportDirectory) || (vaRVAAddrFunctions > vaExportDirectory + cbExportDirectory - exp->NumberOfNames * sizeof(DWORD))) { goto cleanup; }
-    cbProcName = (DWORD)strnlen_s(szProcName, MAX_PATH) + 1;
-    cbExportDirectoryOffset = (DWORD)(vaExportDirectory - vaModuleBase);
-    pdwRVAAddrNames = (PDWORD)(pbExportDirectory + exp->AddressOfNames - cbExportDirectoryOffset);
-    pwNameOrdinals = (PWORD)(pbExportDirectory + exp->AddressOfNameOrdinals - cbExportDirectoryOffset);
-    pdwRVAAddrFunctions = (PDWORD)(pbExportDirectory + exp->AddressOfFunctions - cbExportDirectoryOffset);
-    for(i = 0; i < exp->NumberOfNames; i++) {
-        if(pdwRVAAddrNames[i] - cbExportDirectoryOffset + cbProcName > cbExportDirectory) { continue; }
-        sz = (LPSTR)(pbExportDirectory + pdwRVAAddrNames[i] - cbExportDirectoryOffset);
-        if(0 == memcmp(sz, szProcName, cbProcName)) {
-            if(pwNameOrdinals[i] >= exp->NumberOfFunctions) { goto cleanup; }
+    if((vaRVAAddrNames < vaExportDirectory) || (vaRVAAddrNames > vaExportDirectory + cbExportDirectory - exp->NumberOfNames * sizeof(DWORD))) { goto fail; }
+    if((vaNameOrdinals < vaExportDirectory) || (vaNameOrdinals > vaExportDirectory + cbExportDirectory - exp->NumberOfNames * sizeof(WORD))) { goto fail; }
+    if((vaRVAAddrFunctions < vaExportDirectory) || (vaRVAAddrFunctions > vaExportDirectory + cbExportDirectory - exp->NumberOfNames * sizeof(DWORD))) { goto fail; }
+    pObIndex->cNames = exp->NumberOfNames;
+    pObIndex->cFunctions = exp->NumberOfFunctions;
+    pObIndex->oFunctions = exp->AddressOfFunctions - pObIndex->oExportDirectory;
+    pObIndex->pdwRVAAddrNames = (PDWORD)(pObIndex->pbExportDirectory + exp->AddressOfNames - pObIndex->oExportDirectory);
+    pObIndex->pwNameOrdinals = (PWORD)(pObIndex->pbExportDirectory + exp->AddressOfNameOrdinals - pObIndex->oExportDirectory);
+    pObIndex->pdwRVAAddrFunctions = (PDWORD)(pObIndex->pbExportDirectory + pObIndex->oFunctions);
+    // build name hash table (sized to at least twice the number of names) - first
+    // occurrence of a duplicate name is found first (same as a linear scan).
+    while(cHashTable < (pObIndex->cNames << 1)) { cHashTable <<= 1; }
+    if(!(pObIndex->pdwHashTable = LocalAlloc(LMEM_ZEROINIT, cHashTable * sizeof(DWORD)))) { goto fail; }
+    pObIndex->dwHashMask = cHashTable - 1;
+    for(i = 0; i < pObIndex->cNames; i++) {
+        if(pObIndex->pdwRVAAddrNames[i] - pObIndex->oExportDirectory >= cbExportDirectory) { continue; }
+        dwHash = PE_ExportIndex_HashName(
+            (LPSTR)(pObIndex->pbExportDirectory + pObIndex->pdwRVAAddrNames[i] - pObIndex->oExportDirectory),
+            min(MAX_PATH, cbExportDirectory - (pObIndex->pdwRVAAddrNames[i] - pObIndex->oExportDirectory)),
+            &cbName);
+        if(!cbName) { continue; }
+        iSlot = dwHash & pObIndex->dwHashMask;
+        while(pObIndex->pdwHashTable[iSlot]) {
+            iSlot = (iSlot + 1) & pObIndex->dwHashMask;
+        }
+        pObIndex->pdwHashTable[iSlot] = i + 1;
+    }
+    return pObIndex;
+fail:
+    Ob_DECREF(pObIndex);
+    return NULL;
+}
+
+/*
+* Retrieve the export index of a module. If the module is part of the process
+* module map the index is built once and cached in the module map object; it's
+* thus invalidated whenever the module map is refreshed. Modules not in the
+* module map (or if caching is disabled) get a temporary uncached index.
+* CALLER DECREF: return
+* -- pProcess
+* -- vaModuleBase
+* -- return
+*/
+PPEOB_EXPORTINDEX PE_ExportIndex_Get(_In_ PVMM_PROCESS pProcess, _In_ QWORD vaModuleBase)
+{
+    BOOL fComplete;
+    DWORD i;
+    POB_MAP pmObNew;
+    PVMMOB_MAP_MODULE pObModuleMap = NULL;
+    PPEOB_EXPORTINDEX pObIndex = NULL;
+    // only use an already existing module map - the module map must not be
+    // initialized as a side effect since export lookups are used during init.
+    if(pProcess->Map.pObModule && !(ctxVmm->flags & VMM_FLAG_NOCACHE) && VmmMap_GetModule(pProcess, &pObModuleMap)) {
+        for(i = 0; i < pObModuleMap->cMap; i++) {
+            if(pObModuleMap->pMap[i].vaBase == vaModuleBase) { break; }
+        }
+        if(i == pObModuleMap->cMap) {
+            Ob_DECREF_NULL(&pObModuleMap);
+        } else if(!pObModuleMap->pmObExportIndex && (pmObNew = ObMap_New(OB_MAP_FLAGS_OBJECT_OB))) {
+            if(InterlockedCompareExchangePointer(&pObModuleMap->pmObExportIndex, pmObNew, NULL)) {
+                Ob_DECREF(pmObNew);
+            }
+        }
+    }
+    if(pObModuleMap && (pObIndex = ObMap_GetByKey(pObModuleMap->pmObExportIndex, vaModuleBase))) {
+        Ob_DECREF(pObModuleMap);
+        return pObIndex;
+    }
+    pObIndex = PE_ExportIndex_New(pProcess, vaModuleBase, &fComplete);
+    if(pObModuleMap && pObIndex && fComplete && (ObMap_Size(pObModuleMap->pmObExportIndex) < PE_EXPORTINDEX_MODULES_MAX)) {
+        ObMap_Push(pObModuleMap->pmObExportIndex, vaModuleBase, pObIndex);     // if concurrent insertion fails - index is used uncached.
+    }
+    Ob_DECREF(pObModuleMap);
+    return pObIndex;
+}
+
+_Success_(return)
+BOOL PE_GetThunkInfoEAT(_In_ PVMM_PROCESS pProcess, _In_ QWORD vaModuleBase, _In_ LPSTR szProcName, _Out_ PPE_THUNKINFO_EAT pThunkInfoEAT)
+{
+    BOOL fResult = FALSE;
+    DWORD i, iSlot, iName, dwHash, cbProcName, oName;
+    WORD wOrdinal;
+    PPEOB_EXPORTINDEX pObIndex = NULL;
+    dwHash = PE_ExportIndex_HashName(szProcName, MAX_PATH, &cbProcName);
+    if(!cbProcName) { return FALSE; }
+    if(!(pObIndex = PE_ExportIndex_Get(pProcess, vaModuleBase))) { return FALSE; }
+    iSlot = dwHash & pObIndex->dwHashMask;
+    for(i = 0; i <= pObIndex->dwHashMask; i++) {
+        if(!(iName = pObIndex->pdwHashTable[iSlot])) { break; }
+        iName--;
+        oName = pObIndex->pdwRVAAddrNames[iName] - pObIndex->oExportDirectory;
+        if((oName + cbProcName <= pObIndex->cbExportDirectory) && !memcmp(pObIndex->pbExportDirectory + oName, szProcName, cbProcName)) {
+            wOrdinal = pObIndex->pwNameOrdinals[iName];
+            if((wOrdinal >= pObIndex->cFunctions) || (pObIndex->oFunctions + sizeof(DWORD) * (wOrdinal + 1ULL) > pObIndex->cbExportDirectory)) { break; }
             pThunkInfoEAT->fValid = TRUE;
-            pThunkInfoEAT->vaFunction = (QWORD)(vaModuleBase + pdwRVAAddrFunctions[pwNameOrdinals[i]]);
-            pThunkInfoEAT->valueThunk = pdwRVAAddrFunctions[pwNameOrdinals[i]];
-            pThunkInfoEAT->vaThunk = vaExportDirectory + exp->AddressOfFunctions - cbExportDirectoryOffset + sizeof(DWORD) * pwNameOrdinals[i];
-            pThunkInfoEAT->vaNameFunction = vaExportDirectory + pdwRVAAddrNames[i] - cbExportDirectoryOffset;
-            LocalFree(pbExportDirectory);
-            return TRUE;
+            pThunkInfoEAT->vaFunction = (QWORD)(vaModuleBase + pObIndex->pdwRVAAddrFunctions[wOrdinal]);
+            pThunkInfoEAT->valueThunk = pObIndex->pdwRVAAddrFunctions[wOrdinal];
+            pThunkInfoEAT->vaThunk = pObIndex->vaExportDirectory + pObIndex->oFunctions + sizeof(DWORD) * wOrdinal;
+            pThunkInfoEAT->vaNameFunction = pObIndex->vaExportDirectory + oName;
+            fResult = TRUE;
+            break;
         }
+        iSlot = (iSlot + 1) & pObIndex->dwHashMask;
     }
-cleanup:
-    LocalFree(pbExportDirectory);
-    return FALSE;
+    Ob_DECREF(pObIndex);
+    return fResult;
 }
 
 QWORD PE_GetProcAddress(_In_ PVMM_PROCESS pProcess, _In_ QWORD vaModuleBase, _In_ LPSTR lpProcName)
@@ -506,70 +641,164 @@ DWORD PE_FileRaw_Size(_In_ PVMM_PROCESS pProcess, _In_opt_ QWORD vaModuleBase, _
     return cbModuleFile;
 }
 
-_Success_(return)
-BOOL PE_FileRaw_Read(_In_ PVMM_PROCESS pProcess, _In_ QWORD vaModuleBase, _Out_ PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbRead, _In_ DWORD cbOffset)
+#define PE_FILERAW_SIZE_MAX             0x02000000  // max supported reconstructed file size (32MB)
+#define PE_FILERAW_PREFETCH_MIN         0x4000      // reads of this size or larger prefetch all pages in one scatter
+#define PE_FILERAW_DUMP_CHUNK           0x00100000  // chunk size of streamed module dumps
+
+typedef struct tdPEOB_FILERAW_LAYOUT {
+    OB ObHdr;
+    PE_SECTION_FILEREGIONS_RAW Regions;     // all file regions of the reconstructed file
+} PEOB_FILERAW_LAYOUT, *PPEOB_FILERAW_LAYOUT;
+
+/*
+* Retrieve the complete file region layout of a reconstructed 'raw' PE file.
+* The layout is computed once from the PE header and cached per process (for
+* the lifetime of the process object and its module map).
+* CALLER DECREF: return
+* -- pProcess
+* -- vaModuleBase
+* -- return
+*/
+PPEOB_FILERAW_LAYOUT PE_FileRaw_Layout(_In_ PVMM_PROCESS pProcess, _In_ QWORD vaModuleBase)
 {
-    BOOL result;
-    DWORD iRegion;
-    PE_SECTION_FILEREGIONS_RAW PERegions;
-    DWORD cbOffsetBuffer, cbRead;
-    *pcbRead = 0;
-    result = PE_FileRaw_FileRegions(pProcess, vaModuleBase, NULL, cbOffset, cb, &PERegions);
-    if(!result) { return FALSE; }
+    PPEOB_FILERAW_LAYOUT pObLayout;
+    if((pObLayout = ObMap_GetByKey(pProcess->Plugin.pmObPeFileRawLayout, vaModuleBase))) { return pObLayout; }
+    if(!(pObLayout = Ob_Alloc('PeFR', LMEM_ZEROINIT, sizeof(PEOB_FILERAW_LAYOUT), NULL, NULL))) { return NULL; }
+    if(!PE_FileRaw_FileRegions(pProcess, vaModuleBase, NULL, 0, PE_FILERAW_SIZE_MAX, &pObLayout->Regions)) {
+        Ob_DECREF(pObLayout);
+        return NULL;
+    }
+    ObMap_Push(pProcess->Plugin.pmObPeFileRawLayout, vaModuleBase, pObLayout);
+    return pObLayout;
+}
+
+/*
+* Clip a file region of a layout to the file range [cbOffset, cbOffset + cb).
+* -- pRegions
+* -- iRegion
+* -- cbOffset
+* -- cb
+* -- pcbOffsetBuffer = offset of the clipped region in the buffer.
+* -- pcbOffsetVMem = offset of the clipped region from the module base.
+* -- return = byte size of the clipped region, zero if not overlapping.
+*/
+DWORD PE_FileRaw_RegionClip(_In_ PPE_SECTION_FILEREGIONS_RAW pRegions, _In_ DWORD iRegion, _In_ DWORD cbOffset, _In_ DWORD cb, _Out_ PDWORD pcbOffsetBuffer, _Out_ PDWORD pcbOffsetVMem)
+{
+    DWORD cbStart, cbEnd;
+    cbStart = max(cbOffset, pRegions->Region[iRegion].cbOffsetFile);
+    cbEnd = min(cbOffset + cb, pRegions->Region[iRegion].cbOffsetFile + pRegions->Region[iRegion].cb);
+    if(cbStart >= cbEnd) { return 0; }
+    *pcbOffsetBuffer = cbStart - cbOffset;
+    *pcbOffsetVMem = pRegions->Region[iRegion].cbOffsetVMem + cbStart - pRegions->Region[iRegion].cbOffsetFile;
+    return cbEnd - cbStart;
+}
+
+/*
+* Read from a reconstructed PE file given its layout. Larger reads prefetch all
+* overlapping section pages into the cache in one single scatter read.
+*/
+DWORD PE_FileRaw_Read_Layout(_In_ PVMM_PROCESS pProcess, _In_ QWORD vaModuleBase, _In_ PPE_SECTION_FILEREGIONS_RAW pRegions, _Out_writes_(cb) PBYTE pb, _In_ DWORD cb, _In_ DWORD cbOffset)
+{
+    DWORD iRegion, cbRegion, cbOffsetBuffer, cbOffsetVMem, cbRead;
+    POB_VSET psObPrefetch = NULL;
+    if(cbOffset >= pRegions->cbTotalSize) { return 0; }
+    cb = min(cb, pRegions->cbTotalSize - cbOffset);
     ZeroMemory(pb, cb);
-    if(cbOffset + cb > PERegions.cbTotalSize) {
-        if(cbOffset >= PERegions.cbTotalSize) {
-            *pcbRead = 0;
-            return TRUE;
+    if((cb >= PE_FILERAW_PREFETCH_MIN) && (psObPrefetch = ObVSet_New())) {
+        for(iRegion = 0; iRegion < pRegions->cRegions; iRegion++) {
+            if((cbRegion = PE_FileRaw_RegionClip(pRegions, iRegion, cbOffset, cb, &cbOffsetBuffer, &cbOffsetVMem))) {
+                ObVSet_Push_PageAlign(psObPrefetch, vaModuleBase + cbOffsetVMem, cbRegion);
+            }
         }
-        cb = PERegions.cbTotalSize - cbOffset;
+        VmmCachePrefetchPages(pProcess, psObPrefetch, 0);
+        Ob_DECREF(psObPrefetch);
     }
-    for(iRegion = 0; iRegion < PERegions.cRegions; iRegion++) {
-        cbOffsetBuffer = PERegions.Region[iRegion].cbOffsetFile - cbOffset;
-        if(cbOffsetBuffer + PERegions.Region[iRegion].cb > cb) {
-            vmmprintf_fn("WARNING: SHOULD NOT HAPPEN! potential buffer overflow avoided reading module at PID=%i BASE=%016llx\n", pProcess->dwPID, vaModuleBase);
-            continue;
+    for(iRegion = 0; iRegion < pRegions->cRegions; iRegion++) {
+        if((cbRegion = PE_FileRaw_RegionClip(pRegions, iRegion, cbOffset, cb, &cbOffsetBuffer, &cbOffsetVMem))) {
+            VmmReadEx(pProcess, vaModuleBase + cbOffsetVMem, pb + cbOffsetBuffer, cbRegion, &cbRead, VMM_FLAG_ZEROPAD_ON_FAIL);
         }
-        VmmReadEx(
-            pProcess,
-            vaModuleBase + PERegions.Region[iRegion].cbOffsetVMem,
-            pb + cbOffsetBuffer,
-            PERegions.Region[iRegion].cb,
-            &cbRead,
-            VMM_FLAG_ZEROPAD_ON_FAIL);
     }
-    *pcbRead = cb;
+    return cb;
+}
+
+_Success_(return)
+BOOL PE_FileRaw_Read(_In_ PVMM_PROCESS pProcess, _In_ QWORD vaModuleBase, _Out_ PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbRead, _In_ DWORD cbOffset)
+{
+    PPEOB_FILERAW_LAYOUT pObLayout;
+    *pcbRead = 0;
+    if(!(pObLayout = PE_FileRaw_Layout(pProcess, vaModuleBase))) { return FALSE; }
+    *pcbRead = PE_FileRaw_Read_Layout(pProcess, vaModuleBase, &pObLayout->Regions, pb, cb, cbOffset);
+    Ob_DECREF(pObLayout);
     return TRUE;
 }
 
 _Success_(return)
 BOOL PE_FileRaw_Write(_In_ PVMM_PROCESS pProcess, _In_ QWORD vaModuleBase, _In_ PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbWrite, _In_ DWORD cbOffset)
 {
-    BOOL result;
-    DWORD iRegion, cbOffsetBuffer;
-    PE_SECTION_FILEREGIONS_RAW PERegions;
+    DWORD iRegion, cbRegion, cbOffsetBuffer, cbOffsetVMem;
+    PPEOB_FILERAW_LAYOUT pObLayout;
     *pcbWrite = 0;
-    result = PE_FileRaw_FileRegions(pProcess, vaModuleBase, NULL, cbOffset, cb, &PERegions);
-    if(!result) { return FALSE; }
-    if(cbOffset + cb > PERegions.cbTotalSize) {
-        if(cbOffset >= PERegions.cbTotalSize) {
-            *pcbWrite = 0;
-            return TRUE;
+    if(!(pObLayout = PE_FileRaw_Layout(pProcess, vaModuleBase))) { return FALSE; }
+    if(cbOffset < pObLayout->Regions.cbTotalSize) {
+        cb = min(cb, pObLayout->Regions.cbTotalSize - cbOffset);
+        for(iRegion = 0; iRegion < pObLayout->Regions.cRegions; iRegion++) {
+            if((cbRegion = PE_FileRaw_RegionClip(&pObLayout->Regions, iRegion, cbOffset, cb, &cbOffsetBuffer, &cbOffsetVMem))) {
+                VmmWrite(pProcess, vaModuleBase + cbOffsetVMem, pb + cbOffsetBuffer, cbRegion);
+            }
+        }
+        *pcbWrite = cb;
+    }
+    Ob_DECREF(pObLayout);
+    return TRUE;
+}
+
+typedef struct tdPE_FILERAW_DUMP_CONTEXT {
+    PVMM_PROCESS pProcess;
+    PVMMOB_MAP_MODULE pModuleMap;
+    PVOID ctx;
+    PE_FILERAW_DUMP_CALLBACK pfnCallback;
+    volatile BOOL fAbort;
+} PE_FILERAW_DUMP_CONTEXT, *PPE_FILERAW_DUMP_CONTEXT;
+
+VOID PE_FileRaw_DumpModules_DoWork(_In_ PPE_FILERAW_DUMP_CONTEXT ctx, _In_ DWORD iModule)
+{
+    PBYTE pb = NULL;
+    DWORD cbOffset, cb;
+    PPEOB_FILERAW_LAYOUT pObLayout = NULL;
+    PVMM_MAP_MODULEENTRY pModule = ctx->pModuleMap->pMap + iModule;
+    if(ctx->fAbort || !(pObLayout = PE_FileRaw_Layout(ctx->pProcess, pModule->vaBase)) || !pObLayout->Regions.cbTotalSize) { goto fail; }
+    if(!(pb = LocalAlloc(0, min(PE_FILERAW_DUMP_CHUNK, pObLayout->Regions.cbTotalSize)))) { goto fail; }
+    for(cbOffset = 0; !ctx->fAbort && (cbOffset < pObLayout->Regions.cbTotalSize); cbOffset += cb) {
+        cb = PE_FileRaw_Read_Layout(ctx->pProcess, pModule->vaBase, &pObLayout->Regions, pb, PE_FILERAW_DUMP_CHUNK, cbOffset);
+        if(!cb) { break; }
+        if(!ctx->pfnCallback(ctx->ctx, pModule, pObLayout->Regions.cbTotalSize, cbOffset, pb, cb)) {
+            ctx->fAbort = TRUE;
         }
-        cb = PERegions.cbTotalSize - cbOffset;
     }
-    for(iRegion = 0; iRegion < PERegions.cRegions; iRegion++) {
-        cbOffsetBuffer = PERegions.Region[iRegion].cbOffsetFile - cbOffset;
-        if(cbOffsetBuffer + PERegions.Region[iRegion].cb > cb) {
-            vmmprintf_fn("WARNING: SHOULD NOT HAPPEN! potential buffer overflow avoided writing module at PID=%i BASE=%016llx\n", pProcess->dwPID, vaModuleBase);
-            continue;
+fail:
+    LocalFree(pb);
+    Ob_DECREF(pObLayout);
+}
+
+_Success_(return)
+BOOL PE_FileRaw_DumpModules(_In_ PVMM_PROCESS pProcess, _In_ PE_FILERAW_DUMP_CALLBACK pfnCallback, _In_opt_ PVOID ctx)
+{
+    DWORD iModule;
+    POB_VSET psObPrefetch = NULL;
+    PE_FILERAW_DUMP_CONTEXT ctxDump = { 0 };
+    if(!VmmMap_GetModule(pProcess, &ctxDump.pModuleMap)) { return FALSE; }
+    // prefetch all module headers in one scatter read before layouts are computed in parallel
+    if((psObPrefetch = ObVSet_New())) {
+        for(iModule = 0; iModule < ctxDump.pModuleMap->cMap; iModule++) {
+            ObVSet_Push(psObPrefetch, ctxDump.pModuleMap->pMap[iModule].vaBase);
         }
-        VmmWrite(
-            pProcess,
-            vaModuleBase + PERegions.Region[iRegion].cbOffsetVMem,
-            pb + cbOffsetBuffer,
-            PERegions.Region[iRegion].cb);
+        VmmCachePrefetchPages(pProcess, psObPrefetch, 0);
+        Ob_DECREF(psObPrefetch);
     }
-    *pcbWrite = cb;
-    return TRUE;
+    ctxDump.pProcess = pProcess;
+    ctxDump.pfnCallback = pfnCallback;
+    ctxDump.ctx = ctx;
+    VmmWorkParallel(&ctxDump, ctxDump.pModuleMap->cMap, (VOID(*)(PVOID, DWORD))PE_FileRaw_DumpModules_DoWork);
+    Ob_DECREF(ctxDump.pModuleMap);
+    return !ctxDump.fAbort;
 }
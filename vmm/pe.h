@@ -222,4 +222,33 @@ BOOL PE_FileRaw_Write(
     _In_ DWORD cbOffset
 );
 
+/*
+* Callback function for PE_FileRaw_DumpModules. The callback may be called in
+* parallel from multiple threads (for different modules). Chunks of a single
+* module are delivered in file offset order.
+* -- ctx
+* -- pModule
+* -- cbFile = total size of the reconstructed file.
+* -- cbOffset = file offset of the chunk.
+* -- pb
+* -- cb
+* -- return = TRUE to continue, FALSE to stop the dump.
+*/
+typedef BOOL(*PE_FILERAW_DUMP_CALLBACK)(_In_opt_ PVOID ctx, _In_ PVMM_MAP_MODULEENTRY pModule, _In_ DWORD cbFile, _In_ DWORD cbOffset, _In_reads_(cb) PBYTE pb, _In_ DWORD cb);
+
+/*
+* Stream the re-constructed PE files of all modules of a process in chunks to
+* a callback function. Modules are reconstructed in parallel.
+* -- pProcess
+* -- pfnCallback
+* -- ctx = optional context forwarded to pfnCallback.
+* -- return = TRUE on completion, FALSE on fail or if stopped by the callback.
+*/
+_Success_(return)
+BOOL PE_FileRaw_DumpModules(
+    _In_ PVMM_PROCESS pProcess,
+    _In_ PE_FILERAW_DUMP_CALLBACK pfnCallback,
+    _In_opt_ PVOID ctx
+);
+
 #endif /* __PE_H__ */
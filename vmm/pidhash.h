@@ -0,0 +1,102 @@
+// pidhash.h : definitions related to the open addressing PID hash index used
+//             by the process table. The index does not depend on the vmm
+//             context and may be used stand-alone (vmm_bench).
+//
+// The index keeps the PIDs in a dense key array in insertion order - parallel
+// to the process table object array - and an open addressing hash index into
+// it. Lookups compare keys only and never dereference the process objects.
+//
+// (c) Ulf Frisk, 2018-2019
+// Author: Ulf Frisk, pcileech@frizk.net
+//
+#ifndef __PIDHASH_H__
+#define __PIDHASH_H__
+#include <windows.h>
+
+#define PIDHASH_INDEX_NONE                      ((DWORD)-1)
+
+typedef struct tdPIDHASH {
+    DWORD cMax;                     // # of keys (power of two)
+    DWORD c;                        // # of keys inserted
+    DWORD dwHashShift;              // hash shift for the hash index (2*cMax slots)
+    PDWORD pdwKey;                  // [cMax] PIDs in insertion order [0..c)
+    PDWORD piSlot;                  // [2*cMax] open addressing index into pdwKey (index+1, 0 = empty)
+} PIDHASH, *PPIDHASH;
+
+/*
+* Calculate the number of bytes required by the key array and the hash index
+* of a PIDHASH with cMax keys.
+* -- cMax = number of keys (power of two).
+* -- return
+*/
+inline SIZE_T PidHash_Size(_In_ DWORD cMax)
+{
+    return 3ULL * cMax * sizeof(DWORD);
+}
+
+/*
+* Initialize an empty PIDHASH on top of a zero initialized buffer of at least
+* PidHash_Size(cMax) bytes.
+* -- ph
+* -- cMax = number of keys (power of two).
+* -- pbZeroBuffer
+*/
+inline VOID PidHash_Initialize(_Out_ PPIDHASH ph, _In_ DWORD cMax, _In_ PBYTE pbZeroBuffer)
+{
+    DWORD dwHashShift = 31;
+    for(; (1ULL << (32 - dwHashShift)) < 2ULL * cMax; dwHashShift--);
+    ph->cMax = cMax;
+    ph->c = 0;
+    ph->dwHashShift = dwHashShift;
+    ph->pdwKey = (PDWORD)pbZeroBuffer;
+    ph->piSlot = ph->pdwKey + cMax;
+}
+
+/*
+* Retrieve the start slot in the hash index given a PID. Fibonacci hashing
+* spreads the PIDs, which are generally multiples of four, evenly over the
+* hash index.
+*/
+inline DWORD PidHash_Hash(_In_ PPIDHASH ph, _In_ DWORD dwPID)
+{
+    return (DWORD)(dwPID * 0x9E3779B1) >> ph->dwHashShift;
+}
+
+/*
+* Retrieve the insertion index of a given PID. The hash index is never more
+* than half full so the probing always ends.
+* -- ph
+* -- dwPID
+* -- return = the insertion index, or PIDHASH_INDEX_NONE if not found.
+*/
+inline DWORD PidHash_Find(_In_ PPIDHASH ph, _In_ DWORD dwPID)
+{
+    DWORD i, iM, dwMask = 2 * ph->cMax - 1;
+    i = PidHash_Hash(ph, dwPID);
+    while((iM = ph->piSlot[i])) {
+        if(ph->pdwKey[iM - 1] == dwPID) { return iM - 1; }
+        i = (i + 1) & dwMask;
+    }
+    return PIDHASH_INDEX_NONE;
+}
+
+/*
+* Insert a PID at the next insertion index. The PID must not already exist.
+* -- ph
+* -- dwPID
+* -- return = the insertion index, or PIDHASH_INDEX_NONE if full.
+*/
+inline DWORD PidHash_Insert(_In_ PPIDHASH ph, _In_ DWORD dwPID)
+{
+    DWORD i, dwMask = 2 * ph->cMax - 1;
+    if(ph->c >= ph->cMax) { return PIDHASH_INDEX_NONE; }
+    i = PidHash_Hash(ph, dwPID);
+    while(ph->piSlot[i]) {
+        i = (i + 1) & dwMask;
+    }
+    ph->pdwKey[ph->c] = dwPID;
+    ph->piSlot[i] = ++ph->c;
+    return ph->c - 1;
+}
+
+#endif /* __PIDHASH_H__ */
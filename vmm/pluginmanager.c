@@ -45,6 +45,23 @@ typedef struct tdPLUGIN_LISTENTRY {
     VOID(*pfnClose)();
 } PLUGIN_LISTENTRY, *PPLUGIN_LISTENTRY;
 
+#define PLUGINMANAGER_RENDER_CACHE_MAX      0x40
+#define PLUGINMANAGER_RENDER_CB_MAX         0x04000000      // max size of a single cached file
+#define PLUGINMANAGER_RENDER_CB_TOTAL_MAX   0x10000000      // max total size of cached files
+
+typedef struct tdOB_PLUGIN_RENDER {
+    OB ObHdr;
+    DWORD dwPID;
+    DWORD cb;
+    PBYTE pb;
+    PFN_PLUGINMANAGER_RENDER pfnRender;
+    PVOID pvObGeneration;
+    QWORD qwGeneration;
+    WCHAR wszPath[MAX_PATH];
+} OB_PLUGIN_RENDER, *POB_PLUGIN_RENDER;
+
+static volatile LONG64 g_cbPluginManagerRender = 0;
+
 // ----------------------------------------------------------------------------
 // MODULES CORE FUNCTIONALITY - IMPLEMENTATION BELOW:
 // ----------------------------------------------------------------------------
@@ -71,73 +88,131 @@ VOID PluginManager_ListAll(_In_opt_ PVMM_PROCESS pProcess, _Inout_ PHANDLE pFile
     }
 }
 
-BOOL PluginManager_List(_In_opt_ PVMM_PROCESS pProcess, _In_ LPWSTR wszModule, _In_ LPWSTR wszPath, _Inout_ PHANDLE pFileList)
+PVOID PluginManager_ModuleGet(_In_ BOOL fProcess, _In_opt_ LPWSTR wszModule)
 {
-    QWORD tmStart = Statistics_CallStart();
-    BOOL result;
-    VMMDLL_PLUGIN_CONTEXT ctx;
     PPLUGIN_LISTENTRY pModule = (PPLUGIN_LISTENTRY)ctxVmm->pVmmVfsModuleList;
+    if(!wszModule) { return NULL; }
     while(pModule) {
-        if(!((pProcess && pModule->fProcessModule) || (!pProcess && pModule->fRootModule))) {
-            pModule = pModule->FLink;
-            continue;
-        }
-        if(pModule->pfnList && !_wcsicmp(wszModule, pModule->wszModuleName)) {
-            PluginManager_ContextInitialize(&ctx, pModule, pProcess, (wszPath ? wszPath : L""));
-            result = pModule->pfnList(&ctx, pFileList);
-            Statistics_CallEnd(STATISTICS_ID_PluginManager_List, tmStart);
-            return result;
+        if(((fProcess && pModule->fProcessModule) || (!fProcess && pModule->fRootModule)) && !_wcsicmp(wszModule, pModule->wszModuleName)) {
+            return pModule;
         }
         pModule = pModule->FLink;
     }
+    return NULL;
+}
+
+BOOL PluginManager_ListModule(_In_opt_ PVOID hModule, _In_opt_ PVMM_PROCESS pProcess, _In_opt_ LPWSTR wszPath, _Inout_ PHANDLE pFileList)
+{
+    QWORD tmStart = Statistics_CallStart();
+    BOOL result = FALSE;
+    VMMDLL_PLUGIN_CONTEXT ctx;
+    PPLUGIN_LISTENTRY pModule = (PPLUGIN_LISTENTRY)hModule;
+    if(pModule && pModule->pfnList) {
+        PluginManager_ContextInitialize(&ctx, pModule, pProcess, (wszPath ? wszPath : L""));
+        result = pModule->pfnList(&ctx, pFileList);
+    }
     Statistics_CallEnd(STATISTICS_ID_PluginManager_List, tmStart);
-    return FALSE;
+    return result;
 }
 
-NTSTATUS PluginManager_Read(_In_opt_ PVMM_PROCESS pProcess, _In_ LPWSTR wszModule, _In_ LPWSTR wszPath, _Out_writes_(cb) PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbRead, _In_ QWORD cbOffset)
+NTSTATUS PluginManager_ReadModule(_In_opt_ PVOID hModule, _In_opt_ PVMM_PROCESS pProcess, _In_opt_ LPWSTR wszPath, _Out_writes_(cb) PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbRead, _In_ QWORD cbOffset)
 {
     QWORD tmStart = Statistics_CallStart();
-    NTSTATUS nt;
+    NTSTATUS nt = VMMDLL_STATUS_FILE_INVALID;
     VMMDLL_PLUGIN_CONTEXT ctx;
-    PPLUGIN_LISTENTRY pModule = (PPLUGIN_LISTENTRY)ctxVmm->pVmmVfsModuleList;
-    while(pModule) {
-        if(!((pProcess && pModule->fProcessModule) || (!pProcess && pModule->fRootModule))) {
-            pModule = pModule->FLink;
-            continue;
-        }
-        if(pModule->pfnRead && !_wcsicmp(wszModule, pModule->wszModuleName)) {
-            PluginManager_ContextInitialize(&ctx, pModule, pProcess, (wszPath ? wszPath : L""));
-            nt = pModule->pfnRead(&ctx, pb, cb, pcbRead, cbOffset);
-            Statistics_CallEnd(STATISTICS_ID_PluginManager_Read, tmStart);
-            return nt;
-        }
-        pModule = pModule->FLink;
+    PPLUGIN_LISTENTRY pModule = (PPLUGIN_LISTENTRY)hModule;
+    if(pModule && pModule->pfnRead) {
+        PluginManager_ContextInitialize(&ctx, pModule, pProcess, (wszPath ? wszPath : L""));
+        nt = pModule->pfnRead(&ctx, pb, cb, pcbRead, cbOffset);
     }
     Statistics_CallEnd(STATISTICS_ID_PluginManager_Read, tmStart);
-    return VMMDLL_STATUS_FILE_INVALID;
+    return nt;
 }
 
-NTSTATUS PluginManager_Write(_In_opt_ PVMM_PROCESS pProcess, _In_ LPWSTR wszModule, _In_ LPWSTR wszPath, _In_reads_(cb) PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbWrite, _In_ QWORD cbOffset)
+NTSTATUS PluginManager_WriteModule(_In_opt_ PVOID hModule, _In_opt_ PVMM_PROCESS pProcess, _In_opt_ LPWSTR wszPath, _In_reads_(cb) PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbWrite, _In_ QWORD cbOffset)
 {
     QWORD tmStart = Statistics_CallStart();
-    NTSTATUS nt;
+    NTSTATUS nt = VMMDLL_STATUS_FILE_INVALID;
     VMMDLL_PLUGIN_CONTEXT ctx;
-    PPLUGIN_LISTENTRY pModule = (PPLUGIN_LISTENTRY)ctxVmm->pVmmVfsModuleList;
-    while(pModule) {
-        if(!((pProcess && pModule->fProcessModule) || (!pProcess && pModule->fRootModule))) {
-            pModule = pModule->FLink;
-            continue;
-        }
-        if(pModule->pfnWrite && !_wcsicmp(wszModule, pModule->wszModuleName)) {
-            PluginManager_ContextInitialize(&ctx, pModule, pProcess, (wszPath ? wszPath : L""));
-            nt = pModule->pfnWrite(&ctx, pb, cb, pcbWrite, cbOffset);
-            Statistics_CallEnd(STATISTICS_ID_PluginManager_Write, tmStart);
+    PPLUGIN_LISTENTRY pModule = (PPLUGIN_LISTENTRY)hModule;
+    if(pModule && pModule->pfnWrite) {
+        PluginManager_ContextInitialize(&ctx, pModule, pProcess, (wszPath ? wszPath : L""));
+        nt = pModule->pfnWrite(&ctx, pb, cb, pcbWrite, cbOffset);
+    }
+    Statistics_CallEnd(STATISTICS_ID_PluginManager_Write, tmStart);
+    return nt;
+}
+
+BOOL PluginManager_List(_In_opt_ PVMM_PROCESS pProcess, _In_ LPWSTR wszModule, _In_ LPWSTR wszPath, _Inout_ PHANDLE pFileList)
+{
+    return PluginManager_ListModule(PluginManager_ModuleGet(pProcess ? TRUE : FALSE, wszModule), pProcess, wszPath, pFileList);
+}
+
+NTSTATUS PluginManager_Read(_In_opt_ PVMM_PROCESS pProcess, _In_ LPWSTR wszModule, _In_ LPWSTR wszPath, _Out_writes_(cb) PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbRead, _In_ QWORD cbOffset)
+{
+    return PluginManager_ReadModule(PluginManager_ModuleGet(pProcess ? TRUE : FALSE, wszModule), pProcess, wszPath, pb, cb, pcbRead, cbOffset);
+}
+
+NTSTATUS PluginManager_Write(_In_opt_ PVMM_PROCESS pProcess, _In_ LPWSTR wszModule, _In_ LPWSTR wszPath, _In_reads_(cb) PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbWrite, _In_ QWORD cbOffset)
+{
+    return PluginManager_WriteModule(PluginManager_ModuleGet(pProcess ? TRUE : FALSE, wszModule), pProcess, wszPath, pb, cb, pcbWrite, cbOffset);
+}
+
+VOID PluginManager_RenderRead_CallbackCleanup(_In_ POB_PLUGIN_RENDER pOb)
+{
+    InterlockedAdd64(&g_cbPluginManagerRender, -(LONG64)pOb->cb);
+    Ob_DECREF(pOb->pvObGeneration);
+    LocalFree(pOb->pb);
+}
+
+NTSTATUS PluginManager_RenderRead(
+    _In_ PVMMDLL_PLUGIN_CONTEXT ctx,
+    _In_opt_ PVOID pvObGeneration,
+    _In_ QWORD qwGeneration,
+    _In_ PFN_PLUGINMANAGER_RENDER pfnRender,
+    _Out_writes_(cb) PBYTE pb,
+    _In_ DWORD cb,
+    _Out_ PDWORD pcbRead,
+    _In_ QWORD cbOffset
+) {
+    NTSTATUS nt;
+    QWORD qwKey;
+    POB_PLUGIN_RENDER pObRender;
+    qwKey = ((QWORD)ctx->dwPID << 32) | (DWORD)(Util_HashStringUpperW(ctx->wszModule) + 31 * Util_HashStringUpperW(ctx->wszPath));
+    // 1: serve from cache (if rendered from same generation)
+    if((pObRender = ObMap_GetByKey(ctxVmm->pmObPluginRender, qwKey))) {
+        if((pObRender->pfnRender == pfnRender) && (pObRender->dwPID == ctx->dwPID) && (pObRender->pvObGeneration == pvObGeneration) && (pObRender->qwGeneration == qwGeneration) && !_wcsicmp(pObRender->wszPath, ctx->wszPath)) {
+            nt = Util_VfsReadFile_FromPBYTE(pObRender->pb, pObRender->cb, pb, cb, pcbRead, cbOffset);
+            Ob_DECREF(pObRender);
             return nt;
         }
-        pModule = pModule->FLink;
+        Ob_DECREF_NULL(&pObRender);
+        Ob_DECREF(ObMap_RemoveByKey(ctxVmm->pmObPluginRender, qwKey));
     }
-    Statistics_CallEnd(STATISTICS_ID_PluginManager_Write, tmStart);
-    return VMMDLL_STATUS_FILE_INVALID;
+    // 2: render file
+    if(!(pObRender = Ob_Alloc(OB_TAG_PLUGIN_RENDER, LMEM_ZEROINIT, sizeof(OB_PLUGIN_RENDER), PluginManager_RenderRead_CallbackCleanup, NULL))) { return VMMDLL_STATUS_FILE_INVALID; }
+    if(!pfnRender(ctx, pvObGeneration, &pObRender->pb, &pObRender->cb)) {
+        pObRender->pb = NULL;
+        pObRender->cb = 0;
+        Ob_DECREF(pObRender);
+        return VMMDLL_STATUS_FILE_INVALID;
+    }
+    InterlockedAdd64(&g_cbPluginManagerRender, pObRender->cb);
+    pObRender->dwPID = ctx->dwPID;
+    pObRender->pfnRender = pfnRender;
+    pObRender->pvObGeneration = Ob_INCREF(pvObGeneration);
+    pObRender->qwGeneration = qwGeneration;
+    wcsncpy_s(pObRender->wszPath, MAX_PATH, ctx->wszPath, _TRUNCATE);
+    nt = Util_VfsReadFile_FromPBYTE(pObRender->pb, pObRender->cb, pb, cb, pcbRead, cbOffset);
+    // 3: store in cache (cache is cleared when full)
+    if(pObRender->cb <= PLUGINMANAGER_RENDER_CB_MAX) {
+        if((ObMap_Size(ctxVmm->pmObPluginRender) >= PLUGINMANAGER_RENDER_CACHE_MAX) || (g_cbPluginManagerRender > PLUGINMANAGER_RENDER_CB_TOTAL_MAX)) {
+            ObMap_Clear(ctxVmm->pmObPluginRender);
+        }
+        ObMap_Push(ctxVmm->pmObPluginRender, qwKey, pObRender);
+    }
+    Ob_DECREF(pObRender);
+    return nt;
 }
 
 BOOL PluginManager_Notify(_In_ DWORD fEvent, _In_opt_ PVOID pvEvent, _In_opt_ DWORD cbEvent)
@@ -193,6 +268,8 @@ BOOL PluginManager_Register(_In_ PVMMDLL_PLUGIN_REGINFO pRegInfo)
 VOID PluginManager_Close()
 {
     PPLUGIN_LISTENTRY pm;
+    ObMap_Clear(ctxVmm->pmObVfsPath);
+    ObMap_Clear(ctxVmm->pmObPluginRender);
     while((pm = (PPLUGIN_LISTENTRY)ctxVmm->pVmmVfsModuleList)) {
         // 1: Detach current module list entry from list
         ctxVmm->pVmmVfsModuleList = pm->FLink;
@@ -372,6 +449,8 @@ BOOL PluginManager_Initialize()
     }
     // 3: process 'special status' python plugin manager.
     PluginManager_Initialize_Python();
+    // 4: invalidate resolved vfs paths (may reference modules - or lack thereof)
+    ObMap_Clear(ctxVmm->pmObVfsPath);
     LeaveCriticalSection(&ctxVmm->MasterLock);
     return TRUE;
 }
@@ -8,6 +8,7 @@
 
 #include <Windows.h>
 #include "vmm.h"
+#include "vmmdll.h"
 
 /*
 * Initialize built-in and external modules.
@@ -27,6 +28,28 @@ VOID PluginManager_Close();
 */
 VOID PluginManager_ListAll(_In_opt_ PVMM_PROCESS pProcess, _Inout_ PHANDLE pFileList);
 
+/*
+* Retrieve a handle to a module by its name. The handle may be used with the
+* handle based List/Read/Write functions below to skip the module name lookup.
+* Handles are valid until the plugin manager is (re-)initialized or closed.
+* -- fProcess = TRUE: process module, FALSE: root module.
+* -- wszModule
+* -- return = module handle or NULL if not found.
+*/
+PVOID PluginManager_ModuleGet(_In_ BOOL fProcess, _In_opt_ LPWSTR wszModule);
+
+/*
+* Send a List/Read/Write command to a module given by its module handle.
+* -- hModule = module handle as retrieved by PluginManager_ModuleGet.
+* -- pProcess
+* -- wszPath
+* -- pFileList / pb, cb, pcbRead, cbOffset / pb, cb, pcbWrite, cbOffset
+* -- return
+*/
+BOOL PluginManager_ListModule(_In_opt_ PVOID hModule, _In_opt_ PVMM_PROCESS pProcess, _In_opt_ LPWSTR wszPath, _Inout_ PHANDLE pFileList);
+NTSTATUS PluginManager_ReadModule(_In_opt_ PVOID hModule, _In_opt_ PVMM_PROCESS pProcess, _In_opt_ LPWSTR wszPath, _Out_writes_(cb) PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbRead, _In_ QWORD cbOffset);
+NTSTATUS PluginManager_WriteModule(_In_opt_ PVOID hModule, _In_opt_ PVMM_PROCESS pProcess, _In_opt_ LPWSTR wszPath, _In_reads_(cb) PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbWrite, _In_ QWORD cbOffset);
+
 /*
 * Send a List command down the module chain to the appropriate module.
 * -- pProcess
@@ -63,6 +86,45 @@ NTSTATUS PluginManager_Read(_In_opt_ PVMM_PROCESS pProcess, _In_ LPWSTR wszModul
 */
 NTSTATUS PluginManager_Write(_In_opt_ PVMM_PROCESS pProcess, _In_ LPWSTR wszModule, _In_ LPWSTR wszPath, _In_reads_(cb) PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbWrite, _In_ QWORD cbOffset);
 
+/*
+* Render function for PluginManager_RenderRead. Render the complete file into a
+* buffer allocated with LocalAlloc.
+* -- ctx
+* -- pvObGeneration = the generation object given to PluginManager_RenderRead.
+* -- ppb = ptr to receive the rendered file (LocalAlloc'ed - freed by caller).
+* -- pcb = ptr to receive the byte length of the rendered file.
+* -- return
+*/
+typedef _Success_(return) BOOL(*PFN_PLUGINMANAGER_RENDER)(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _In_opt_ PVOID pvObGeneration, _Out_ PBYTE *ppb, _Out_ PDWORD pcb);
+
+/*
+* Read from a rendered text file through the shared render cache. The file is
+* rendered in full by pfnRender once and cached keyed by (pid, module, path)
+* together with its generation. Subsequent reads at any offset are served from
+* the cached buffer as long as the generation is unchanged. The generation is
+* given by an object the file is rendered from, such as a process map (a ref
+* is kept while cached), and/or by an additional generation value.
+* -- ctx
+* -- pvObGeneration = optional object the file is rendered from.
+* -- qwGeneration = additional generation value (0 if not used).
+* -- pfnRender
+* -- pb
+* -- cb
+* -- pcbRead
+* -- cbOffset
+* -- return
+*/
+NTSTATUS PluginManager_RenderRead(
+    _In_ PVMMDLL_PLUGIN_CONTEXT ctx,
+    _In_opt_ PVOID pvObGeneration,
+    _In_ QWORD qwGeneration,
+    _In_ PFN_PLUGINMANAGER_RENDER pfnRender,
+    _Out_writes_(cb) PBYTE pb,
+    _In_ DWORD cb,
+    _Out_ PDWORD pcbRead,
+    _In_ QWORD cbOffset
+);
+
 /*
 * Send a notification event to plugins that registered to receive notifications.
 * Officially supported events are listed in vmmdll.h!VMMDLL_PLUGIN_EVENT_*
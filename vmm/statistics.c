@@ -227,19 +227,57 @@ const LPSTR NAMES_VMM_STATISTICS_CALL[] = {
     "VMMDLL_PdbTypeSize",
     "VMMDLL_PdbTypeChildOffset",
     "VMM_PagedCompressedMemory",
+    "VMMDLL_MemReadPageRef",
+    "VMMDLL_MemReadScatterAsync",
+    "VMMDLL_MemPhys2VirtIndex",
+    "VMMDLL_ProcessMap_GetThreadChanged",
+    "VMMDLL_WinReg_Search",
+    "VMMDLL_DumpToFile",
+    "VMMDLL_ProcessMap_GetPteEntry",
+    "VMMDLL_ProcessMap_GetVadEntry",
+    "VMMDLL_MemSearch",
+    "VMMDLL_MemSnapshot",
+    "VMMDLL_MemSnapshotDiff",
+    "VMMDLL_MemWriteBatch",
+    "VMMDLL_ProcessGetInformationAll",
+    "VMMDLL_ProcessMap_EnumHeapEntries",
+    "VMMDLL_ProcessDumpModules",
+    "VMMDLL_NotifySubscribe",
+    "VMMDLL_NotifyUnsubscribe",
+    "VMMDLL_ProcessGetGeneration",
 };
 
+/*
+* Function call statistics are kept in per-cpu shards to avoid contention on
+* shared counters. Each shard holds, per function id, the call count, total
+* and max time and a log2 bucketed latency histogram (nanoseconds). Bucket 0
+* holds calls < 1ns; bucket i holds calls in the range [2^(i-1), 2^i) ns. The
+* shards are merged on read.
+*/
+#define STATISTICS_CALL_SHARDS              16
+#define STATISTICS_CALL_HISTOGRAM_BUCKETS   40
+
 typedef struct tdCALLSTAT {
     QWORD c;
     QWORD tm;
+    QWORD tmMax;
+    QWORD cHistogram[STATISTICS_CALL_HISTOGRAM_BUCKETS];
 } CALLSTAT, *PCALLSTAT;
 
+typedef struct tdCALLSTAT_CONTEXT {
+    QWORD qwFreq;
+    CALLSTAT Shard[STATISTICS_CALL_SHARDS][STATISTICS_ID_MAX + 1];
+} CALLSTAT_CONTEXT, *PCALLSTAT_CONTEXT;
+
 VOID Statistics_CallSetEnabled(_In_ BOOL fEnabled)
 {
+    PCALLSTAT_CONTEXT ctx;
     if(fEnabled && ctxMain->pvStatistics) { return; }
     if(!fEnabled && !ctxMain->pvStatistics) { return; }
     if(fEnabled) {
-        ctxMain->pvStatistics = LocalAlloc(LMEM_ZEROINIT, (STATISTICS_ID_MAX + 1) * sizeof(CALLSTAT));
+        if(!(ctx = LocalAlloc(LMEM_ZEROINIT, sizeof(CALLSTAT_CONTEXT)))) { return; }
+        QueryPerformanceFrequency((PLARGE_INTEGER)&ctx->qwFreq);
+        ctxMain->pvStatistics = ctx;
     } else {
         LocalFree(ctxMain->pvStatistics);
         ctxMain->pvStatistics = NULL;
@@ -261,64 +299,131 @@ QWORD Statistics_CallStart()
 
 QWORD Statistics_CallEnd(_In_ DWORD fId, QWORD tmCallStart)
 {
-    QWORD tmNow;
+    DWORD iBucket;
+    QWORD tmNow, tm, tmMax, ns;
     PCALLSTAT pStat;
-    if(!ctxMain->pvStatistics) { return 0; }
+    PCALLSTAT_CONTEXT ctx = (PCALLSTAT_CONTEXT)ctxMain->pvStatistics;
+    if(!ctx) { return 0; }
     if(fId > STATISTICS_ID_MAX) { return 0; }
     if(tmCallStart == 0) { return 0; }
-    pStat = ((PCALLSTAT)ctxMain->pvStatistics) + fId;
-    InterlockedIncrement64(&pStat->c);
     QueryPerformanceCounter((PLARGE_INTEGER)&tmNow);
-    InterlockedAdd64(&pStat->tm, tmNow - tmCallStart);
-    return tmNow - tmCallStart;
+    tm = tmNow - tmCallStart;
+    ns = (tm / ctx->qwFreq) * 1000000000ULL + ((tm % ctx->qwFreq) * 1000000000ULL) / ctx->qwFreq;
+    iBucket = 0;
+    if(ns && _BitScanReverse64(&iBucket, ns)) {
+        iBucket = min(iBucket + 1, STATISTICS_CALL_HISTOGRAM_BUCKETS - 1);
+    }
+    pStat = &ctx->Shard[GetCurrentProcessorNumber() % STATISTICS_CALL_SHARDS][fId];
+    InterlockedIncrement64(&pStat->c);
+    InterlockedAdd64(&pStat->tm, tm);
+    InterlockedIncrement64(&pStat->cHistogram[iBucket]);
+    while((tmMax = pStat->tmMax) < tm) {
+        if(tmMax == (QWORD)InterlockedCompareExchange64(&pStat->tmMax, tm, tmMax)) { break; }
+    }
+    return tm;
+}
+
+/*
+* Retrieve the quantile q (in per mille) from a merged histogram.
+* -- c = total count.
+* -- cHistogram
+* -- qwMaxUs = max time in microseconds - quantiles are clamped to this value.
+* -- qPerMille
+* -- return = upper bound of the quantile bucket in microseconds.
+*/
+QWORD Statistics_CallGetInfo_Quantile(_In_ QWORD c, _In_ PQWORD cHistogram, _In_ QWORD qwMaxUs, _In_ QWORD qPerMille)
+{
+    DWORD i;
+    QWORD cAcc = 0, cTarget = max(1, (c * qPerMille + 999) / 1000);
+    for(i = 0; i < STATISTICS_CALL_HISTOGRAM_BUCKETS; i++) {
+        cAcc += cHistogram[i];
+        if(cAcc >= cTarget) {
+            return min(qwMaxUs, (1ULL << i) / 1000);
+        }
+    }
+    return qwMaxUs;
+}
+
+_Success_(return)
+BOOL Statistics_CallGetInfo(_In_ DWORD fId, _Out_ PSTATISTICS_CALL_INFO pInfo)
+{
+    DWORD iShard, i;
+    QWORD tm = 0, tmMax = 0;
+    QWORD cHistogram[STATISTICS_CALL_HISTOGRAM_BUCKETS] = { 0 };
+    PCALLSTAT pStat;
+    PCALLSTAT_CONTEXT ctx = (PCALLSTAT_CONTEXT)ctxMain->pvStatistics;
+    ZeroMemory(pInfo, sizeof(STATISTICS_CALL_INFO));
+    if(!ctx || (fId > STATISTICS_ID_MAX)) { return FALSE; }
+    for(iShard = 0; iShard < STATISTICS_CALL_SHARDS; iShard++) {
+        pStat = &ctx->Shard[iShard][fId];
+        pInfo->c += pStat->c;
+        tm += pStat->tm;
+        tmMax = max(tmMax, pStat->tmMax);
+        for(i = 0; i < STATISTICS_CALL_HISTOGRAM_BUCKETS; i++) {
+            cHistogram[i] += pStat->cHistogram[i];
+        }
+    }
+    pInfo->qwTotalUs = (tm * 1000000ULL) / ctx->qwFreq;
+    pInfo->qwMaxUs = (tmMax * 1000000ULL) / ctx->qwFreq;
+    if(pInfo->c) {
+        pInfo->qwP50Us = Statistics_CallGetInfo_Quantile(pInfo->c, cHistogram, pInfo->qwMaxUs, 500);
+        pInfo->qwP99Us = Statistics_CallGetInfo_Quantile(pInfo->c, cHistogram, pInfo->qwMaxUs, 990);
+        pInfo->qwP999Us = Statistics_CallGetInfo_Quantile(pInfo->c, cHistogram, pInfo->qwMaxUs, 999);
+    }
+    return TRUE;
 }
 
+#define STATISTICS_CALL_LINELENGTH          121
+
 VOID Statistics_CallToString(_In_opt_ PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcb)
 {
     BOOL result;
-    QWORD qwFreq, uS;
+    QWORD uS;
     DWORD i, o = 0;
-    PCALLSTAT pStat;
+    STATISTICS_CALL_INFO Info;
     LEECHCORE_STATISTICS LeechCoreStatistics = { 0 };
     DWORD cbLeechCoreStatistics = sizeof(LEECHCORE_STATISTICS);
     if(!pb) { 
-        *pcb = 79 * (STATISTICS_ID_MAX + LEECHCORE_STATISTICS_ID_MAX + 6);
+        *pcb = STATISTICS_CALL_LINELENGTH * (STATISTICS_ID_MAX + LEECHCORE_STATISTICS_ID_MAX + 6);
         return;
     }
-    QueryPerformanceFrequency((PLARGE_INTEGER)&qwFreq);
     o += snprintf(
         pb + o,
         cb - o,
-        "FUNCTION CALL STATISTICS:                                                     \n" \
-        "VALUES IN DECIMAL, TIME IN MICROSECONDS uS, STATISTICS = %s             \n" \
-        "FUNCTION CALL NAME                           CALLS  TIME AVG        TIME TOTAL\n" \
-        "==============================================================================\n",
-        ctxMain->pvStatistics ? "ENABLED " : "DISABLED"
-        );
+        "%-120s\nVALUES IN DECIMAL, TIME IN MICROSECONDS uS, STATISTICS = %s%55s\n%-40.40s  %8s  %8s  %16s  %8s  %8s  %8s  %10s\n",
+        "FUNCTION CALL STATISTICS:",
+        ctxMain->pvStatistics ? "ENABLED " : "DISABLED",
+        "",
+        "FUNCTION CALL NAME", "CALLS", "TIME AVG", "TIME TOTAL", "P50 uS", "P99 uS", "P999 uS", "MAX uS"
+    );
+    for(i = 0; (i < STATISTICS_CALL_LINELENGTH - 1) && (o < cb); i++) {
+        pb[o++] = '=';
+    }
+    if(o < cb) { pb[o++] = '\n'; }
     // statistics
     for(i = 0; i <= STATISTICS_ID_MAX; i++) {
-        if(ctxMain->pvStatistics) {
-            pStat = ((PCALLSTAT)ctxMain->pvStatistics) + i;
-            if(pStat->c) {
-                uS = (pStat->tm * 1000000ULL) / qwFreq;
-                o += snprintf(
-                    pb + o,
-                    cb - o,
-                    "%-40.40s  %8i  %8i  %16lli\n",
-                    NAMES_VMM_STATISTICS_CALL[i],
-                    (DWORD)pStat->c,
-                    (DWORD)(uS / pStat->c),
-                    uS
-                );
-                continue;
-            }
+        if(Statistics_CallGetInfo(i, &Info) && Info.c) {
+            o += snprintf(
+                pb + o,
+                cb - o,
+                "%-40.40s  %8i  %8i  %16lli  %8lli  %8lli  %8lli  %10lli\n",
+                NAMES_VMM_STATISTICS_CALL[i],
+                (DWORD)Info.c,
+                (DWORD)(Info.qwTotalUs / Info.c),
+                Info.qwTotalUs,
+                Info.qwP50Us,
+                Info.qwP99Us,
+                Info.qwP999Us,
+                Info.qwMaxUs
+            );
+            continue;
         }
         o += snprintf(
             pb + o,
             cb - o,
-            "%-40.40s  %8i  %8i  %16lli\n",
+            "%-40.40s  %8i  %8i  %16lli  %8lli  %8lli  %8lli  %10lli\n",
             NAMES_VMM_STATISTICS_CALL[i],
-            0, 0, 0ULL);
+            0, 0, 0ULL, 0ULL, 0ULL, 0ULL, 0ULL);
     }
     // leechcore statistics
     result = LeechCore_CommandData(LEECHCORE_COMMANDDATA_STATISTICS_GET, NULL, 0, (PBYTE)&LeechCoreStatistics, cbLeechCoreStatistics, &cbLeechCoreStatistics);
@@ -329,19 +434,20 @@ VOID Statistics_CallToString(_In_opt_ PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcb)
                 o += snprintf(
                     pb + o,
                     cb - o,
-                    "%-40.40s  %8i  %8i  %16lli\n",
+                    "%-40.40s  %8i  %8i  %16lli%42s\n",
                     LEECHCORE_STATISTICS_NAME[i],
                     (DWORD)LeechCoreStatistics.Call[i].c,
                     (DWORD)(uS / LeechCoreStatistics.Call[i].c),
-                    uS
+                    uS,
+                    ""
                 );
             } else {
                 o += snprintf(
                     pb + o,
                     cb - o,
-                    "%-40.40s  %8i  %8i  %16lli\n",
+                    "%-40.40s  %8i  %8i  %16lli%42s\n",
                     LEECHCORE_STATISTICS_NAME[i],
-                    0, 0, 0ULL);
+                    0, 0, 0ULL, "");
             }
         }
     }
@@ -114,13 +114,51 @@ VOID PageStatUpdate(_In_opt_ PPAGE_STATISTICS pPageStat, _In_ QWORD qwAddr, _In_
 #define STATISTICS_ID_VMMDLL_PdbTypeSize                        0x2c
 #define STATISTICS_ID_VMMDLL_PdbTypeChildOffset                 0x2d
 #define STATISTICS_ID_VMM_PagedCompressedMemory                 0x2e
-#define STATISTICS_ID_MAX                                       0x2e
+#define STATISTICS_ID_VMMDLL_MemReadPageRef                     0x2f
+#define STATISTICS_ID_VMMDLL_MemReadScatterAsync                0x30
+#define STATISTICS_ID_VMMDLL_MemPhys2VirtIndex                  0x31
+#define STATISTICS_ID_VMMDLL_ProcessMap_GetThreadChanged        0x32
+#define STATISTICS_ID_VMMDLL_WinReg_Search                      0x33
+#define STATISTICS_ID_VMMDLL_DumpToFile                         0x34
+#define STATISTICS_ID_VMMDLL_ProcessMap_GetPteEntry             0x35
+#define STATISTICS_ID_VMMDLL_ProcessMap_GetVadEntry             0x36
+#define STATISTICS_ID_VMMDLL_MemSearch                          0x37
+#define STATISTICS_ID_VMMDLL_MemSnapshot                        0x38
+#define STATISTICS_ID_VMMDLL_MemSnapshotDiff                    0x39
+#define STATISTICS_ID_VMMDLL_MemWriteBatch                      0x3a
+#define STATISTICS_ID_VMMDLL_ProcessGetInformationAll           0x3b
+#define STATISTICS_ID_VMMDLL_ProcessMap_EnumHeapEntries         0x3c
+#define STATISTICS_ID_VMMDLL_ProcessDumpModules                 0x3d
+#define STATISTICS_ID_VMMDLL_NotifySubscribe                    0x3e
+#define STATISTICS_ID_VMMDLL_NotifyUnsubscribe                  0x3f
+#define STATISTICS_ID_VMMDLL_ProcessGetGeneration               0x40
+#define STATISTICS_ID_MAX                                       0x40
 #define STATISTICS_ID_NOLOG                                     0xffffffff
 
+typedef struct tdSTATISTICS_CALL_INFO {
+    QWORD c;
+    QWORD qwTotalUs;
+    QWORD qwP50Us;
+    QWORD qwP99Us;
+    QWORD qwP999Us;
+    QWORD qwMaxUs;
+} STATISTICS_CALL_INFO, *PSTATISTICS_CALL_INFO;
+
 VOID Statistics_CallSetEnabled(_In_ BOOL fEnabled);
 BOOL Statistics_CallGetEnabled();
 QWORD Statistics_CallStart();
 QWORD Statistics_CallEnd(_In_ DWORD fId, QWORD tmCallStart);
 VOID Statistics_CallToString(_In_opt_ PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcb);
 
+/*
+* Retrieve the merged function call statistics for a function id. Quantiles
+* are approximated from log2 bucketed latency histograms and are given as the
+* upper bound of the bucket (clamped to the max time).
+* -- fId = STATISTICS_ID_*
+* -- pInfo
+* -- return = FALSE if statistics are not enabled or on invalid id.
+*/
+_Success_(return)
+BOOL Statistics_CallGetInfo(_In_ DWORD fId, _Out_ PSTATISTICS_CALL_INFO pInfo);
+
 #endif /* __STATISTICS_H__ */
@@ -5,6 +5,9 @@
 //
 #include "util.h"
 #include <math.h>
+#include <intrin.h>
+#include <emmintrin.h>
+#include <tmmintrin.h>
 
 /*
 * Calculate the number of digits of an integer number.
@@ -44,6 +47,21 @@ DWORD Util_HashStringA(_In_opt_ LPCSTR sz)
     }
 }
 
+DWORD Util_HashStringUpperA(_In_opt_ LPCSTR sz)
+{
+    CHAR c;
+    DWORD i = 0, dwHash = 0;
+    if(!sz) { return 0; }
+    while(TRUE) {
+        c = sz[i++];
+        if(!c) { return dwHash; }
+        if(c >= 'a' && c <= 'z') {
+            c += 'A' - 'a';
+        }
+        dwHash = ((dwHash >> 13) | (dwHash << 19)) + c;
+    }
+}
+
 DWORD Util_HashStringUpperW(_In_opt_ LPCWSTR wsz)
 {
     WCHAR c;
@@ -59,8 +77,148 @@ DWORD Util_HashStringUpperW(_In_opt_ LPCWSTR wsz)
     }
 }
 
+#define UTIL_HASH64_PRIME1      0x9e3779b185ebca87
+#define UTIL_HASH64_PRIME2      0xc2b2ae3d27d4eb4f
+
+QWORD Util_Hash64(_In_reads_(cb) PBYTE pb, _In_ DWORD cb)
+{
+    DWORD i;
+    PQWORD pqw = (PQWORD)pb;
+    QWORD h0 = UTIL_HASH64_PRIME1, h1 = UTIL_HASH64_PRIME2, h2 = ~UTIL_HASH64_PRIME1, h3 = ~UTIL_HASH64_PRIME2;
+    for(i = 0; i < (cb >> 3); i += 4) {
+        h0 = _rotl64(h0 + pqw[i + 0] * UTIL_HASH64_PRIME2, 31) * UTIL_HASH64_PRIME1;
+        h1 = _rotl64(h1 + pqw[i + 1] * UTIL_HASH64_PRIME2, 31) * UTIL_HASH64_PRIME1;
+        h2 = _rotl64(h2 + pqw[i + 2] * UTIL_HASH64_PRIME2, 31) * UTIL_HASH64_PRIME1;
+        h3 = _rotl64(h3 + pqw[i + 3] * UTIL_HASH64_PRIME2, 31) * UTIL_HASH64_PRIME1;
+    }
+    h0 = _rotl64(h0, 1) + _rotl64(h1, 7) + _rotl64(h2, 12) + _rotl64(h3, 18) + cb;
+    h0 = (h0 ^ (h0 >> 33)) * UTIL_HASH64_PRIME2;
+    return h0 ^ (h0 >> 29);
+}
+
+BOOL Util_IsZeroBuffer(_In_reads_(cb) PBYTE pb, _In_ DWORD cb)
+{
+    DWORD i;
+    __m128i v;
+    for(i = 0; i < cb; i += 64) {
+        v = _mm_or_si128(
+            _mm_or_si128(_mm_loadu_si128((__m128i*)(pb + i + 0x00)), _mm_loadu_si128((__m128i*)(pb + i + 0x10))),
+            _mm_or_si128(_mm_loadu_si128((__m128i*)(pb + i + 0x20)), _mm_loadu_si128((__m128i*)(pb + i + 0x30))));
+        if(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0xffff) { return FALSE; }
+    }
+    return TRUE;
+}
+
+BOOL Util_WildcardMatchA(_In_ LPCSTR szPattern, _In_ LPCSTR sz)
+{
+    LPCSTR szPatternStar = NULL, szStar = NULL;
+    while(*sz) {
+        if(*szPattern == '*') {
+            szPatternStar = ++szPattern;
+            szStar = sz;
+            continue;
+        }
+        if(*szPattern && ((*szPattern == '?') || (toupper(*szPattern) == toupper(*sz)))) {
+            szPattern++;
+            sz++;
+            continue;
+        }
+        if(!szPatternStar) { return FALSE; }
+        szPattern = szPatternStar;
+        sz = ++szStar;
+    }
+    while(*szPattern == '*') {
+        szPattern++;
+    }
+    return !*szPattern;
+}
+
+BOOL Util_WildcardMatchW(_In_ LPCWSTR wszPattern, _In_ LPCWSTR wsz)
+{
+    LPCWSTR wszPatternStar = NULL, wszStar = NULL;
+    while(*wsz) {
+        if(*wszPattern == '*') {
+            wszPatternStar = ++wszPattern;
+            wszStar = wsz;
+            continue;
+        }
+        if(*wszPattern && ((*wszPattern == '?') || (towupper(*wszPattern) == towupper(*wsz)))) {
+            wszPattern++;
+            wsz++;
+            continue;
+        }
+        if(!wszPatternStar) { return FALSE; }
+        wszPattern = wszPatternStar;
+        wsz = ++wszStar;
+    }
+    while(*wszPattern == '*') {
+        wszPattern++;
+    }
+    return !*wszPattern;
+}
+
 #define Util_2HexChar(x) (((((x) & 0xf) <= 9) ? '0' : ('a' - 10)) + ((x) & 0xf))
 
+/*
+* Check whether the CPU supports SSSE3 (required by the vectorized hexdump).
+* The result is cached after the first call.
+*/
+BOOL Util_IsCpuSupportedSSSE3()
+{
+    static DWORD dwSupportSSSE3 = 0;    // 0: unknown, 1: unsupported, 2: supported
+    int CPUInfo[4];
+    if(!dwSupportSSSE3) {
+        __cpuid(CPUInfo, 1);
+        dwSupportSSSE3 = (CPUInfo[2] & (1 << 9)) ? 2 : 1;
+    }
+    return dwSupportSSSE3 == 2;
+}
+
+/*
+* Fill one complete 16-byte hexdump row (76 chars) using SSSE3. The nibbles are
+* converted to hex with a pshufb table lookup and spread out into the "xx "
+* layout with a second shuffle; the ascii column is masked on printable chars.
+* -- pb = 16 bytes.
+* -- iMod = row address (low 16 bits are displayed).
+* -- sz = buffer to fill with the row, must be able to hold 76 chars.
+*/
+VOID Util_FillHexAscii_RowSSSE3(_In_reads_(16) PBYTE pb, _In_ DWORD iMod, _Out_writes_(76) LPSTR sz)
+{
+    const __m128i vHex = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+    const __m128i vMaskNibble = _mm_set1_epi8(0x0f);
+    const __m128i vShuffle0 = _mm_setr_epi8(0, 1, -1, 2, 3, -1, 4, 5, -1, 6, 7, -1, 8, 9, -1, 10);
+    const __m128i vShuffle1 = _mm_setr_epi8(11, -1, 12, 13, -1, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i vSpace0 = _mm_setr_epi8(0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0);
+    const __m128i vSpace1 = _mm_setr_epi8(0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, 0, 0, 0, 0, 0, 0);
+    __m128i v, vHi, vLo, vPrintable;
+    v = _mm_loadu_si128((__m128i*)pb);
+    // hex: two 8-byte groups of "xx " separated by an extra space
+    vHi = _mm_shuffle_epi8(vHex, _mm_and_si128(_mm_srli_epi16(v, 4), vMaskNibble));
+    vLo = _mm_shuffle_epi8(vHex, _mm_and_si128(v, vMaskNibble));
+    _mm_storeu_si128((__m128i*)(sz + 8), _mm_or_si128(_mm_shuffle_epi8(_mm_unpacklo_epi8(vHi, vLo), vShuffle0), vSpace0));
+    _mm_storel_epi64((__m128i*)(sz + 24), _mm_or_si128(_mm_shuffle_epi8(_mm_unpacklo_epi8(vHi, vLo), vShuffle1), vSpace1));
+    _mm_storeu_si128((__m128i*)(sz + 33), _mm_or_si128(_mm_shuffle_epi8(_mm_unpackhi_epi8(vHi, vLo), vShuffle0), vSpace0));
+    _mm_storel_epi64((__m128i*)(sz + 49), _mm_or_si128(_mm_shuffle_epi8(_mm_unpackhi_epi8(vHi, vLo), vShuffle1), vSpace1));
+    // ascii: 0x20-0x7e as-is, 0x7f as space, everything else as '.' (as UTIL_PRINTASCII)
+    vPrintable = _mm_cmpgt_epi8(v, _mm_set1_epi8(0x1f));
+    v = _mm_or_si128(_mm_and_si128(vPrintable, v), _mm_andnot_si128(vPrintable, _mm_set1_epi8('.')));
+    v = _mm_xor_si128(v, _mm_and_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(0x7f)), _mm_set1_epi8(0x7f ^ ' ')));
+    _mm_storeu_si128((__m128i*)(sz + 59), v);
+    // address and separators
+    sz[0] = Util_2HexChar(iMod >> 12);
+    sz[1] = Util_2HexChar(iMod >> 8);
+    sz[2] = Util_2HexChar(iMod >> 4);
+    sz[3] = Util_2HexChar(iMod);
+    sz[4] = ' ';
+    sz[5] = ' ';
+    sz[6] = ' ';
+    sz[7] = ' ';
+    sz[32] = ' ';
+    sz[57] = ' ';
+    sz[58] = ' ';
+    sz[75] = '\n';
+}
+
 _Success_(return)
 BOOL Util_FillHexAscii(_In_opt_ PBYTE pb, _In_ DWORD cb, _In_ DWORD cbInitialOffset, _Out_opt_ LPSTR sz, _Inout_ PDWORD pcsz)
 {
@@ -73,8 +231,16 @@ BOOL Util_FillHexAscii(_In_opt_ PBYTE pb, _In_ DWORD cb, _In_ DWORD cbInitialOff
         return TRUE;
     }
     if(!pb || (*pcsz <= cRows * 76)) { return FALSE; }
-    // fill buffer with bytes
-    for(i = cbInitialOffset; i < cb + ((cb % 16) ? (16 - cb % 16) : 0); i++)
+    // fill complete rows with SSSE3 (if supported)
+    i = cbInitialOffset;
+    if(Util_IsCpuSupportedSSSE3()) {
+        for(; i + 16 <= cb; i += 16) {
+            Util_FillHexAscii_RowSSSE3(pb + i, i % 0x10000, sz + o);
+            o += 76;
+        }
+    }
+    // fill buffer with remaining bytes
+    for(; i < cb + ((cb % 16) ? (16 - cb % 16) : 0); i++)
     {
         // address
         if(0 == i % 16) {
@@ -436,3 +602,4 @@ PVOID Util_qfind(_In_ PVOID pvFind, _In_ DWORD cMap, _In_ PVOID pvMap, _In_ DWOR
     }
     return NULL;
 }
+
@@ -46,11 +46,39 @@ DWORD Util_HashStringA(_In_opt_ LPCSTR sz);
 
 /*
 * Hash the uppercase version of a string with the ROT13 algorithm.
-* -- wsz
+* -- sz/wsz
 * -- return
 */
+DWORD Util_HashStringUpperA(_In_opt_ LPCSTR sz);
 DWORD Util_HashStringUpperW(_In_opt_ LPCWSTR wsz);
 
+/*
+* Fast non-cryptographic 64-bit hash of a buffer (i.e. a memory page). The
+* buffer is processed as four independent 64-bit lanes.
+* -- pb
+* -- cb = buffer length - must be a multiple of 32 bytes.
+* -- return
+*/
+QWORD Util_Hash64(_In_reads_(cb) PBYTE pb, _In_ DWORD cb);
+
+/*
+* Check whether a buffer (i.e. a memory page) is zero-filled (SSE2).
+* -- pb
+* -- cb = buffer length - must be a multiple of 64 bytes.
+* -- return
+*/
+BOOL Util_IsZeroBuffer(_In_reads_(cb) PBYTE pb, _In_ DWORD cb);
+
+/*
+* Match a string against a wildcard pattern (case insensitive). The pattern may
+* contain '*' (any number of characters) and '?' (any single character).
+* -- szPattern/wszPattern
+* -- sz/wsz
+* -- return
+*/
+BOOL Util_WildcardMatchA(_In_ LPCSTR szPattern, _In_ LPCSTR sz);
+BOOL Util_WildcardMatchW(_In_ LPCWSTR wszPattern, _In_ LPCWSTR wsz);
+
 /*
 * Print a maximum of 8192 bytes of binary data as hexascii on the screen.
 * -- pb
@@ -6,14 +6,73 @@
 
 #include "vmm.h"
 #include "mm.h"
+#include "mm_walk.h"
 #include "ob.h"
 #include "pdb.h"
 #include "vmmproc.h"
+#include "vmmcachefile.h"
+#include "vmmmemmap.h"
+#include "vmmprofile.h"
+#include "vmmtrace.h"
 #include "vmmwin.h"
 #include "vmmwinreg.h"
 #include "pluginmanager.h"
 #include "util.h"
 
+// ----------------------------------------------------------------------------
+// NUMA FUNCTIONALITY:
+// In numa mode cache entries are kept on per-node empty lists so that entries
+// are re-used by the node that first touched (and thus allocated) them, and
+// the work pool threads are pinned to the nodes.
+// ----------------------------------------------------------------------------
+
+/*
+* Initialize the numa topology. A single node is used unless numa mode is
+* enabled and the system has more than one node with processors.
+*/
+VOID VmmNuma_Initialize()
+{
+    ULONG ulNodeHighest = 0;
+    USHORT wNode;
+    GROUP_AFFINITY Affinity;
+    DWORD i, iNode = 0, iProcessor;
+    ctxVmm->Numa.cNode = 1;
+    if(!ctxMain->cfg.fNUMA || !GetNumaHighestNodeNumber(&ulNodeHighest) || !ulNodeHighest) { return; }
+    for(wNode = 0; (wNode <= ulNodeHighest) && (iNode < VMM_NUMA_NODES_MAX); wNode++) {
+        if(!GetNumaNodeProcessorMaskEx(wNode, &Affinity) || !Affinity.Mask) { continue; }
+        ctxVmm->Numa.wNode[iNode] = wNode;
+        ctxVmm->Numa.Affinity[iNode] = Affinity;
+        for(i = 0; i < 64; i++) {
+            iProcessor = Affinity.Group * 64 + i;
+            if(((Affinity.Mask >> i) & 1) && (iProcessor < VMM_NUMA_PROCESSORS_MAX)) {
+                ctxVmm->Numa.iNodeProcessor[iProcessor] = (BYTE)iNode;
+            }
+        }
+        iNode++;
+    }
+    if(iNode > 1) {
+        ctxVmm->Numa.cNode = iNode;
+        ctxVmm->Numa.fEnabled = TRUE;
+    } else {
+        ZeroMemory(ctxVmm->Numa.iNodeProcessor, sizeof(ctxVmm->Numa.iNodeProcessor));
+    }
+    vmmprintfv("VMM: NUMA mode: %i nodes used.\n", ctxVmm->Numa.cNode);
+}
+
+/*
+* Retrieve the numa node index of the processor the calling thread runs on.
+* -- return = the node index, 0 if not in numa mode.
+*/
+DWORD VmmNuma_CurrentNode()
+{
+    DWORD iProcessor;
+    PROCESSOR_NUMBER ProcessorNumber;
+    if(!ctxVmm->Numa.fEnabled) { return 0; }
+    GetCurrentProcessorNumberEx(&ProcessorNumber);
+    iProcessor = ProcessorNumber.Group * 64 + ProcessorNumber.Number;
+    return (iProcessor < VMM_NUMA_PROCESSORS_MAX) ? ctxVmm->Numa.iNodeProcessor[iProcessor] : 0;
+}
+
 // ----------------------------------------------------------------------------
 // CACHE FUNCTIONALITY:
 // PHYSICAL MEMORY CACHING FOR READS AND PAGE TABLES
@@ -22,9 +81,9 @@
 /*
 * Retrieve cache table from ctxVmm given a specific tag.
 */
-PVMM_CACHE_TABLE VmmCacheTableGet(_In_ DWORD wTblTag)
+PVMM_CACHE_TABLE VmmCacheTableGet(_In_ DWORD dwTblTag)
 {
-    switch(wTblTag) {
+    switch(dwTblTag) {
         case VMM_CACHE_TAG_PHYS:
             return &ctxVmm->Cache.PHYS;
         case VMM_CACHE_TAG_TLB:
@@ -38,6 +97,149 @@ PVMM_CACHE_TABLE VmmCacheTableGet(_In_ DWORD wTblTag)
 
 #define VMM_CACHE2_GET_REGION(qwA)      ((qwA >> 12) % VMM_CACHE2_REGIONS)
 #define VMM_CACHE2_GET_BUCKET(qwA)      ((qwA >> 12) % VMM_CACHE2_BUCKETS)
+#define VMM_CACHE2_LOCKFREE_RETRY       4
+#define VMM_CACHE2_LOCKFREE_MAXHOP      0x100
+
+/*
+* Region writers must hold the region lock and bracket any modification of the
+* bucket or age lists by VMM_CACHE2_SEQ_BEGIN / VMM_CACHE2_SEQ_END. Lock-free
+* readers in VmmCacheGet use the resulting sequence number to detect changes.
+*/
+#define VMM_CACHE2_SEQ_BEGIN(t, iR)     { InterlockedIncrement((volatile LONG*)&t->R[iR].dwSeq); }
+#define VMM_CACHE2_SEQ_END(t, iR)       { InterlockedIncrement((volatile LONG*)&t->R[iR].dwSeq); }
+
+/*
+* Acquire a region lock. Contended acquisitions are counted and the time spent
+* waiting for the lock is accumulated per region (in performance counter ticks).
+* Statistics are updated while holding the lock so no interlocked ops are used.
+* -- t
+* -- iR
+*/
+VOID VmmCacheRegion_Lock(_In_ PVMM_CACHE_TABLE t, _In_ DWORD iR)
+{
+    QWORD tmStart, tmEnd;
+    if(TryEnterCriticalSection(&t->R[iR].Lock)) { return; }
+    QueryPerformanceCounter((PLARGE_INTEGER)&tmStart);
+    EnterCriticalSection(&t->R[iR].Lock);
+    QueryPerformanceCounter((PLARGE_INTEGER)&tmEnd);
+    t->R[iR].stat.cLockContended++;
+    t->R[iR].stat.qwLockWaitQPC += tmEnd - tmStart;
+}
+
+/*
+* Detach an object from its bucket list and age list (probationary or hot) in
+* a region. Caller must hold region lock and be inside a region write sequence.
+* The region reference of the object is overtaken by the caller.
+* -- t
+* -- iR
+* -- pOb
+*/
+VOID VmmCacheRegion_Detach(_In_ PVMM_CACHE_TABLE t, _In_ DWORD iR, _In_ PVMMOB_MEM pOb)
+{
+    // detach bucket
+    if(pOb->BLink) {
+        pOb->BLink->FLink = pOb->FLink;
+    } else {
+        t->R[iR].B[VMM_CACHE2_GET_BUCKET(pOb->h.qwA)] = pOb->FLink;
+    }
+    if(pOb->FLink) {
+        pOb->FLink->BLink = pOb->BLink;
+    }
+    // detach age list
+    if(pOb->AgeBLink) {
+        pOb->AgeBLink->AgeFLink = pOb->AgeFLink;
+    } else if(pOb->fHot) {
+        t->R[iR].HotFLink = pOb->AgeFLink;
+    } else {
+        t->R[iR].AgeFLink = pOb->AgeFLink;
+    }
+    if(pOb->AgeFLink) {
+        pOb->AgeFLink->AgeBLink = pOb->AgeBLink;
+    } else if(pOb->fHot) {
+        t->R[iR].HotBLink = pOb->AgeBLink;
+    } else {
+        t->R[iR].AgeBLink = pOb->AgeBLink;
+    }
+    if(pOb->fHot) {
+        pOb->fHot = FALSE;
+        t->R[iR].cHot--;
+    }
+    InterlockedDecrement(&t->R[iR].c);
+}
+
+/*
+* Move an object to the head of the hot or the probationary age list of a
+* region. Caller must hold region lock and be inside a region write sequence.
+* -- t
+* -- iR
+* -- pOb
+* -- fHot
+*/
+VOID VmmCacheRegion_AgeMove(_In_ PVMM_CACHE_TABLE t, _In_ DWORD iR, _In_ PVMMOB_MEM pOb, _In_ BOOL fHot)
+{
+    PPVMMOB_MEM ppFLink, ppBLink;
+    // detach from current age list
+    if(pOb->AgeBLink) {
+        pOb->AgeBLink->AgeFLink = pOb->AgeFLink;
+    } else if(pOb->fHot) {
+        t->R[iR].HotFLink = pOb->AgeFLink;
+    } else {
+        t->R[iR].AgeFLink = pOb->AgeFLink;
+    }
+    if(pOb->AgeFLink) {
+        pOb->AgeFLink->AgeBLink = pOb->AgeBLink;
+    } else if(pOb->fHot) {
+        t->R[iR].HotBLink = pOb->AgeBLink;
+    } else {
+        t->R[iR].AgeBLink = pOb->AgeBLink;
+    }
+    if(pOb->fHot) { t->R[iR].cHot--; }
+    // insert at head of new age list
+    ppFLink = fHot ? &t->R[iR].HotFLink : &t->R[iR].AgeFLink;
+    ppBLink = fHot ? &t->R[iR].HotBLink : &t->R[iR].AgeBLink;
+    pOb->AgeBLink = NULL;
+    pOb->AgeFLink = *ppFLink;
+    if(pOb->AgeFLink) { pOb->AgeFLink->AgeBLink = pOb; }
+    *ppFLink = pOb;
+    if(!*ppBLink) { *ppBLink = pOb; }
+    pOb->fHot = fHot;
+    if(fHot) { t->R[iR].cHot++; }
+}
+
+// ----------------------------------------------------------------------------
+// PHYS CACHE CONTENT DEDUPLICATION:
+// Zero-filled physical pages are not stored as full 4kB cache entries - only
+// their physical address is recorded in a value set. Optionally pages with a
+// content identical to another cached (canonical) page are also recorded as a
+// reference to the canonical page by content hash. On lookup a deduplicated
+// page is materialized into a transient cache entry which is not inserted into
+// the cache table - it's returned to the empty list once released by caller.
+// Deduplication records share the lifetime of the PHYS cache generation.
+// ----------------------------------------------------------------------------
+
+/*
+* Remove any deduplication record of a physical page.
+* -- pa
+*/
+VOID VmmCacheDedup_Remove(_In_ QWORD pa)
+{
+    if(ObVSet_Size(ctxVmm->Cache.Dedup.psZero)) {
+        ObVSet_Remove(ctxVmm->Cache.Dedup.psZero, pa | 1);
+    }
+    if(ObMap_Size(ctxVmm->Cache.Dedup.pmDupPage)) {
+        ObMap_RemoveByKey(ctxVmm->Cache.Dedup.pmDupPage, pa);
+    }
+}
+
+/*
+* Remove all deduplication records.
+*/
+VOID VmmCacheDedup_Clear()
+{
+    ObVSet_Clear(ctxVmm->Cache.Dedup.psZero);
+    ObMap_Clear(ctxVmm->Cache.Dedup.pmDupPage);
+    ObMap_Clear(ctxVmm->Cache.Dedup.pmDupHash);
+}
 
 /*
 * Invalidate a cache entry (if exists)
@@ -51,93 +253,229 @@ VOID VmmCacheInvalidate_2(_In_ DWORD dwTblTag, _In_ QWORD qwA)
     if(!t || !t->fActive) { return; }
     iR = VMM_CACHE2_GET_REGION(qwA);
     iB = VMM_CACHE2_GET_BUCKET(qwA);
-    EnterCriticalSection(&t->R[iR].Lock);
+    VmmCacheRegion_Lock(t, iR);
+    VMM_CACHE2_SEQ_BEGIN(t, iR);
     pOb = t->R[iR].B[iB];
     while(pOb) {
         pObNext = pOb->FLink;
         if(pOb->h.qwA == qwA) {
-            // detach bucket
-            if(pOb->BLink) {
-                pOb->BLink->FLink = pOb->FLink;
-            } else {
-                t->R[iR].B[iB] = pOb->FLink;
-            }
-            if(pOb->FLink) {
-                pOb->FLink->BLink = pOb->BLink;
-            }
-            // detach age list
-            if(pOb->AgeBLink) {
-                pOb->AgeBLink->AgeFLink = pOb->AgeFLink;
-            } else {
-                t->R[iR].AgeFLink = pOb->AgeFLink;
-            }
-            if(pOb->AgeFLink) {
-                pOb->AgeFLink->AgeBLink = pOb->AgeBLink;
-            } else {
-                t->R[iR].AgeBLink = pOb->AgeBLink;
-            }
-            // decrease count & decref
-            InterlockedDecrement(&t->R[iR].c);
+            VmmCacheRegion_Detach(t, iR, pOb);
             Ob_DECREF(pOb);
         }
         pOb = pObNext;
     }
+    VMM_CACHE2_SEQ_END(t, iR);
     LeaveCriticalSection(&t->R[iR].Lock);
+    if(dwTblTag == VMM_CACHE_TAG_PHYS) {
+        VmmCacheDedup_Remove(qwA);
+    }
 }
 
 VOID VmmCacheInvalidate(_In_ QWORD pa)
 {
     VmmCacheInvalidate_2(VMM_CACHE_TAG_TLB, pa);
     VmmCacheInvalidate_2(VMM_CACHE_TAG_PHYS, pa);
+    InterlockedIncrement(&ctxVmm->Cache.dwSoftTlbInvalidateGeneration);
+}
+
+// ----------------------------------------------------------------------------
+// PER-PROCESS SOFTWARE TLB (VIRTUAL TO PHYSICAL TRANSLATION CACHE)
+// The software tlb is a small direct mapped va->pa translation cache located
+// in each process object. It is accessed lock-free - each entry is protected
+// by its own sequence number. Writers that fail to acquire an entry skip the
+// insert (it's just a cache). Only successful translations are cached on a
+// 4kB page granularity (also for large pages).
+// ----------------------------------------------------------------------------
+
+#define VMM_SOFTTLB_INDEX(va)           ((DWORD)(va >> 12) & (VMM_PROCESS_SOFTTLB_ENTRIES - 1))
+
+_Success_(return)
+BOOL VmmSoftTlb_Get(_In_ PVMM_PROCESS pProcess, _In_ QWORD va, _Out_ PQWORD ppa)
+{
+    DWORD dwSeq;
+    QWORD vaPage, paPage;
+    BOOL fValid;
+    PVMM_SOFTTLB_ENTRY pe = &pProcess->SoftTlb[VMM_SOFTTLB_INDEX(va)];
+    dwSeq = pe->dwSeq;
+    if(dwSeq & 1) { return FALSE; }
+    MemoryBarrier();
+    vaPage = pe->vaPage;
+    paPage = pe->paPage;
+    fValid =
+        (pe->dwTlbGeneration == ctxVmm->Cache.TLB.dwGeneration) &&
+        (pe->dwInvalidateGeneration == ctxVmm->Cache.dwSoftTlbInvalidateGeneration);
+    MemoryBarrier();
+    if((dwSeq != pe->dwSeq) || !fValid || !dwSeq || (vaPage != (va & ~0xfff))) { return FALSE; }
+    *ppa = paPage | (va & 0xfff);
+    return TRUE;
+}
+
+VOID VmmSoftTlb_Put(_In_ PVMM_PROCESS pProcess, _In_ QWORD va, _In_ QWORD pa)
+{
+    DWORD dwSeq;
+    PVMM_SOFTTLB_ENTRY pe = &pProcess->SoftTlb[VMM_SOFTTLB_INDEX(va)];
+    dwSeq = pe->dwSeq;
+    if((dwSeq & 1) || (dwSeq != (DWORD)InterlockedCompareExchange((volatile LONG*)&pe->dwSeq, dwSeq + 1, dwSeq))) { return; }
+    pe->dwTlbGeneration = ctxVmm->Cache.TLB.dwGeneration;
+    pe->dwInvalidateGeneration = ctxVmm->Cache.dwSoftTlbInvalidateGeneration;
+    pe->vaPage = va & ~0xfff;
+    pe->paPage = pa & ~0xfff;
+    MemoryBarrier();
+    pe->dwSeq = dwSeq + 2;
+}
+
+// ----------------------------------------------------------------------------
+// SPECIALIZED PAGE TABLE WALKERS:
+// The common virtual to physical translation path is dispatched directly to
+// walkers specialized per memory model and user-only option (see mm_walk.h)
+// instead of through the recursive memory model pfnVirt2Phys function.
+// ----------------------------------------------------------------------------
+
+MMWALK_DEFINE(VmmVirt2PhysWalk_X64, MmWalk_X64, FALSE)
+MMWALK_DEFINE(VmmVirt2PhysWalk_X64_User, MmWalk_X64, TRUE)
+MMWALK_DEFINE(VmmVirt2PhysWalk_X86PAE, MmWalk_X86PAE, FALSE)
+MMWALK_DEFINE(VmmVirt2PhysWalk_X86PAE_User, MmWalk_X86PAE, TRUE)
+MMWALK_DEFINE(VmmVirt2PhysWalk_X86, MmWalk_X86, FALSE)
+MMWALK_DEFINE(VmmVirt2PhysWalk_X86_User, MmWalk_X86, TRUE)
+
+_Success_(return)
+BOOL VmmVirt2PhysWalk(_In_ QWORD paDTB, _In_ BOOL fUserOnly, _In_ QWORD va, _Out_ PQWORD ppa)
+{
+    switch(ctxVmm->tpMemoryModel) {
+        case VMM_MEMORYMODEL_X64:
+            return fUserOnly ? VmmVirt2PhysWalk_X64_User(paDTB, va, ppa) : VmmVirt2PhysWalk_X64(paDTB, va, ppa);
+        case VMM_MEMORYMODEL_X86PAE:
+            return fUserOnly ? VmmVirt2PhysWalk_X86PAE_User(paDTB, va, ppa) : VmmVirt2PhysWalk_X86PAE(paDTB, va, ppa);
+        case VMM_MEMORYMODEL_X86:
+            return fUserOnly ? VmmVirt2PhysWalk_X86_User(paDTB, va, ppa) : VmmVirt2PhysWalk_X86(paDTB, va, ppa);
+        default:
+            return FALSE;
+    }
+}
+
+/*
+* Select the next victim for eviction from a region according to the cache
+* eviction policy of the table.
+* VMM_CACHE_POLICY_AGE: oldest entry in the age list.
+* VMM_CACHE_POLICY_2Q:  new entries enter a probationary list. Entries that are
+*   referenced while on the probationary list are promoted to the hot list when
+*   they reach its tail. The hot list is bounded to a share of the region and
+*   overflowing entries are demoted back to the probationary list (referenced
+*   hot entries get a second chance). One-shot scan traffic thus only cycles
+*   through the probationary list while frequently used pages stay resident.
+* Caller must hold region lock and be inside a region write sequence.
+* -- t
+* -- iR
+* -- return = victim or NULL if region is empty.
+*/
+PVMMOB_MEM VmmCacheReclaim_Victim(_In_ PVMM_CACHE_TABLE t, _In_ DWORD iR)
+{
+    PVMMOB_MEM pOb;
+    DWORD cLoopProtect = 0;
+    if(t->tpPolicy != VMM_CACHE_POLICY_2Q) {
+        return t->R[iR].AgeBLink ? t->R[iR].AgeBLink : t->R[iR].HotBLink;
+    }
+    while(cLoopProtect++ < 0x100) {
+        // demote from hot list if over its share of the region
+        if(t->R[iR].cHot > ((t->R[iR].c * VMM_CACHE2_2Q_HOT_PERCENT) / 100)) {
+            pOb = t->R[iR].HotBLink;
+            if(pOb->fReferenced) {
+                pOb->fReferenced = FALSE;
+                VmmCacheRegion_AgeMove(t, iR, pOb, TRUE);
+            } else {
+                VmmCacheRegion_AgeMove(t, iR, pOb, FALSE);
+            }
+            continue;
+        }
+        if(!(pOb = t->R[iR].AgeBLink)) { break; }
+        if(!pOb->fReferenced) { return pOb; }
+        // referenced on probationary list -> promote to hot list
+        pOb->fReferenced = FALSE;
+        VmmCacheRegion_AgeMove(t, iR, pOb, TRUE);
+    }
+    return t->R[iR].AgeBLink ? t->R[iR].AgeBLink : t->R[iR].HotBLink;
 }
 
 VOID VmmCacheReclaim(_In_ PVMM_CACHE_TABLE t, _In_ DWORD iR, _In_ BOOL fTotal)
 {
     DWORD cThreshold;
     PVMMOB_MEM pOb;
-    EnterCriticalSection(&t->R[iR].Lock);
+    QWORD tmTrace = VMMTRACE_IS_ENABLED() ? VmmTrace_Start() : 0;
+    VmmCacheRegion_Lock(t, iR);
+    VMM_CACHE2_SEQ_BEGIN(t, iR);
     cThreshold = fTotal ? 0 : max(0x10, t->R[iR].c >> 1);
     while(t->R[iR].c > cThreshold) {
         // get
-        pOb = t->R[iR].AgeBLink;
+        pOb = fTotal ?
+            (t->R[iR].AgeBLink ? t->R[iR].AgeBLink : t->R[iR].HotBLink) :
+            VmmCacheReclaim_Victim(t, iR);
         if(!pOb) {
             vmmprintf_fn("ERROR - SHOULD NOT HAPPEN - NULL OBJECT RETRIEVED\n");
             break;
         }
-        // detach from age list
-        t->R[iR].AgeBLink = pOb->AgeBLink;
-        if(pOb->AgeBLink) {
-            pOb->AgeBLink->AgeFLink = NULL;
-        } else {
-            t->R[iR].AgeFLink = NULL;
-        }
-        // detach from bucket list
-        if(pOb->BLink) {
-            pOb->BLink->FLink = NULL;
-        } else {
-            t->R[iR].B[VMM_CACHE2_GET_BUCKET(pOb->h.qwA)] = NULL;
-        }
+        VmmCacheRegion_Detach(t, iR, pOb);
+        t->R[iR].stat.cEvict++;
         // remove region refcount of object - callback will take care of
         // re-insertion into empty list when refcount becomes low enough.
         Ob_DECREF(pOb);
-        InterlockedDecrement(&t->R[iR].c);
     }
+    VMM_CACHE2_SEQ_END(t, iR);
+    LeaveCriticalSection(&t->R[iR].Lock);
+    if(tmTrace) { VmmTrace_Event(VMMTRACE_EVENT_CACHE_RECLAIM, 0, t->tag, iR, tmTrace); }
+}
+
+/*
+* Reclaim entries from previous generations from the tails of the age lists of
+* a region. Since entries are inserted at the age list heads stale entries will
+* accumulate at the tails.
+* -- t
+* -- iR
+*/
+VOID VmmCacheReclaimStale_Region(_In_ PVMM_CACHE_TABLE t, _In_ DWORD iR)
+{
+    PVMMOB_MEM pOb;
+    DWORD dwGeneration = t->dwGeneration;
+    VmmCacheRegion_Lock(t, iR);
+    VMM_CACHE2_SEQ_BEGIN(t, iR);
+    while((pOb = t->R[iR].AgeBLink) && (pOb->dwGeneration != dwGeneration)) {
+        VmmCacheRegion_Detach(t, iR, pOb);
+        t->R[iR].stat.cEvictStale++;
+        Ob_DECREF(pOb);
+    }
+    while((pOb = t->R[iR].HotBLink) && (pOb->dwGeneration != dwGeneration)) {
+        VmmCacheRegion_Detach(t, iR, pOb);
+        t->R[iR].stat.cEvictStale++;
+        Ob_DECREF(pOb);
+    }
+    VMM_CACHE2_SEQ_END(t, iR);
     LeaveCriticalSection(&t->R[iR].Lock);
 }
 
+VOID VmmCacheReclaimStale(_In_ DWORD dwTblTag)
+{
+    DWORD iR;
+    PVMM_CACHE_TABLE t;
+    t = VmmCacheTableGet(dwTblTag);
+    if(!t || !t->fActive) { return; }
+    iR = InterlockedIncrement(&t->iReclaimStaleLast) % VMM_CACHE2_REGIONS;
+    VmmCacheReclaimStale_Region(t, iR);
+}
+
 /*
 * Clear the specified cache from all entries.
 * -- wTblTag
 */
 VOID VmmCacheClear(_In_ DWORD dwTblTag)
 {
-    DWORD i;
     PVMM_CACHE_TABLE t;
     PVMM_PROCESS pObProcess = NULL;
-    // 1: clear cache
+    // 1: clear cache - bump generation, stale entries are reclaimed lazily.
     t = VmmCacheTableGet(dwTblTag);
-    for(i = 0; i < VMM_CACHE2_REGIONS; i++) {
-        VmmCacheReclaim(t, i, TRUE);
+    if(!t || !t->fActive) { return; }
+    InterlockedIncrement(&t->dwGeneration);
+    if(VMMTRACE_IS_ENABLED()) { VmmTrace_Event(VMMTRACE_EVENT_CACHE_CLEAR, 0, dwTblTag, 0, 0); }
+    if(dwTblTag == VMM_CACHE_TAG_PHYS) {
+        VmmCacheDedup_Clear();
     }
     // 2: if tlb cache clear -> update process 'is spider done' flag
     if(dwTblTag == VMM_CACHE_TAG_TLB) {
@@ -151,6 +489,74 @@ VOID VmmCacheClear(_In_ DWORD dwTblTag)
     }
 }
 
+/*
+* Retire a cache object that is no longer needed due to a shrinking budget or
+* cache close. The object is not free'd immediately since lock-free readers may
+* still be inspecting it; it's free'd by VmmCacheRetirePurge once all readers
+* which may have observed it have left their reader epoch.
+* -- t
+* -- pOb = object with only the cache "base" reference remaining.
+*/
+VOID VmmCacheRetire(_In_ PVMM_CACHE_TABLE t, _In_ PVMMOB_MEM pOb)
+{
+    InterlockedDecrement(&t->cTotal);
+    InterlockedPushEntrySList(&t->ListHeadRetire, &pOb->SListEmpty);
+    InterlockedIncrement(&t->cRetire);
+}
+
+/*
+* Free retired cache objects using epoch-based reclamation. Lock-free readers
+* register in the reader count of the current epoch parity (VmmCacheEpoch_Enter)
+* for the duration of a lookup. A retired object is already detached from the
+* regions, so only readers active at the time it was retired may reference it.
+* Objects retired before the last epoch advance (the grace list) are free'd
+* once no reader of the previous epoch remains - after which the retire list
+* becomes the grace list and the epoch is advanced. If readers of the previous
+* epoch are still active the purge is retried at a later reserve.
+* -- t
+* -- fForce = free all retired objects regardless of readers (on close).
+*/
+VOID VmmCacheRetirePurge(_In_ PVMM_CACHE_TABLE t, _In_ BOOL fForce)
+{
+    DWORD iShard, iEpochPrev;
+    PSLIST_ENTRY e, eNext;
+    PVMMOB_MEM pOb;
+    if(!fForce) {
+        if(InterlockedCompareExchange((volatile LONG*)&t->fRetirePurge, 1, 0)) { return; }
+        iEpochPrev = (DWORD)((t->qwEpoch + 1) & 1);
+        for(iShard = 0; iShard < VMM_CACHE2_READER_SHARDS; iShard++) {
+            if(t->Shard[iShard].cEpochReader[iEpochPrev]) { goto finish; }
+        }
+    }
+    // 1: free objects from grace list
+    e = InterlockedFlushSList(&t->ListHeadRetireGrace);
+    while(e) {
+        eNext = e->Next;
+        pOb = CONTAINING_RECORD(e, VMMOB_MEM, SListEmpty);
+        InterlockedDecrement(&t->cRetire);
+        Ob_DECREF(pOb);
+        e = eNext;
+    }
+    // 2: move objects from retire list to grace list (or free directly if forced)
+    e = InterlockedFlushSList(&t->ListHeadRetire);
+    while(e) {
+        eNext = e->Next;
+        if(fForce) {
+            pOb = CONTAINING_RECORD(e, VMMOB_MEM, SListEmpty);
+            InterlockedDecrement(&t->cRetire);
+            Ob_DECREF(pOb);
+        } else {
+            InterlockedPushEntrySList(&t->ListHeadRetireGrace, e);
+        }
+        e = eNext;
+    }
+    if(fForce) { return; }
+    // 3: advance epoch - new readers register in the now drained reader count.
+    InterlockedIncrement64((volatile LONG64*)&t->qwEpoch);
+finish:
+    InterlockedExchange((volatile LONG*)&t->fRetirePurge, 0);
+}
+
 VOID VmmCache_CallbackRefCount1(PVMMOB_MEM pOb)
 {
     PVMM_CACHE_TABLE t;
@@ -159,51 +565,32 @@ VOID VmmCache_CallbackRefCount1(PVMMOB_MEM pOb)
         vmmprintf_fn("ERROR - SHOULD NOT HAPPEN - INVALID OBJECT TAG %02X\n", ((POB)pOb)->_tag);
         return;
     }
-    if(!t->fActive) { return; }
+    if(!t->fActive || (t->cTotal > t->cMaxEntries)) {
+        VmmCacheRetire(t, pOb);
+        return;
+    }
     Ob_INCREF(pOb);
-    InterlockedPushEntrySList(&t->ListHeadEmpty, &pOb->SListEmpty);
+    InterlockedPushEntrySList(&t->ListHeadEmpty[pOb->iNode], &pOb->SListEmpty);
     InterlockedIncrement(&t->cEmpty);
 }
 
 /*
-* Return an entry retrieved with VmmCacheReserve to the cache.
-* NB! no other items may be returned with this function!
-* FUNCTION DECREF: pOb
-* -- pOb
+* Pop an entry from the empty list of any numa node other than iNode.
+* -- t
+* -- iNode
+* -- return
 */
-VOID VmmCacheReserveReturn(_In_opt_ PVMMOB_MEM pOb)
+PSLIST_ENTRY VmmCacheReserve_PopEmptyRemote(_In_ PVMM_CACHE_TABLE t, _In_ DWORD iNode)
 {
-    DWORD iR, iB;
-    PVMM_CACHE_TABLE t;
-    if(!pOb) { return; }
-    t = VmmCacheTableGet(((POB)pOb)->_tag);
-    if(!t) {
-        vmmprintf_fn("ERROR - SHOULD NOT HAPPEN - INVALID OBJECT TAG %02X\n", ((POB)pOb)->_tag);
-        return;
-    }
-    if((pOb->h.cb != 0x1000) || (pOb->h.qwA == (QWORD)-1) || !t->fActive) {
-        // decrement refcount of object - callback will take care of
-        // re-insertion into empty list when refcount becomes low enough.
-        Ob_DECREF(pOb);
-        return;
+    DWORD i;
+    PSLIST_ENTRY e;
+    for(i = 1; i < ctxVmm->Numa.cNode; i++) {
+        if((e = InterlockedPopEntrySList(&t->ListHeadEmpty[(iNode + i) % ctxVmm->Numa.cNode]))) {
+            InterlockedIncrement64(&t->cReserveNumaRemote);
+            return e;
+        }
     }
-    // insert into map - refcount will be overtaken by "cache region".
-    iR = VMM_CACHE2_GET_REGION(pOb->h.qwA);
-    iB = VMM_CACHE2_GET_BUCKET(pOb->h.qwA);
-    EnterCriticalSection(&t->R[iR].Lock);
-    // insert into "bucket"
-    pOb->BLink = NULL;
-    pOb->FLink = t->R[iR].B[iB];
-    if(pOb->FLink) { pOb->FLink->BLink = pOb; }
-    t->R[iR].B[iB] = pOb;
-    // insert into "age list"
-    pOb->AgeFLink = t->R[iR].AgeFLink;
-    if(pOb->AgeFLink) { pOb->AgeFLink->AgeBLink = pOb; }
-    pOb->AgeBLink = NULL;
-    t->R[iR].AgeFLink = pOb;
-    if(!t->R[iR].AgeBLink) { t->R[iR].AgeBLink = pOb; }
-    InterlockedIncrement(&t->R[iR].c);
-    LeaveCriticalSection(&t->R[iR].Lock);
+    return NULL;
 }
 
 PVMMOB_MEM VmmCacheReserve(_In_ DWORD dwTblTag)
@@ -211,24 +598,35 @@ PVMMOB_MEM VmmCacheReserve(_In_ DWORD dwTblTag)
     PVMM_CACHE_TABLE t;
     PVMMOB_MEM pOb;
     PSLIST_ENTRY e;
+    DWORD iNode;
     WORD iReclaimLast, cLoopProtect = 0;
     t = VmmCacheTableGet(dwTblTag);
     if(!t || !t->fActive) { return NULL; }
-    while(!(e = InterlockedPopEntrySList(&t->ListHeadEmpty))) {
-        if(t->cTotal < VMM_CACHE2_MAX_ENTRIES) {
-            // below max threshold -> create new
-            pOb = Ob_Alloc(t->tag, LMEM_ZEROINIT, sizeof(VMMOB_MEM), NULL, VmmCache_CallbackRefCount1);
+    if(t->cRetire) {
+        VmmCacheRetirePurge(t, FALSE);
+    }
+    iNode = VmmNuma_CurrentNode();
+    while(!(e = InterlockedPopEntrySList(&t->ListHeadEmpty[iNode]))) {
+        if(t->cTotal < t->cMaxEntries) {
+            // below max threshold -> create new (numa mode: allocated on the
+            // numa node of the current thread)
+            pOb = ctxVmm->Numa.fEnabled ?
+                Ob_AllocNuma(ctxVmm->Numa.wNode[iNode], t->tag, LMEM_ZEROINIT, sizeof(VMMOB_MEM), NULL, VmmCache_CallbackRefCount1) :
+                Ob_Alloc(t->tag, LMEM_ZEROINIT, sizeof(VMMOB_MEM), NULL, VmmCache_CallbackRefCount1);
             if(!pOb) { return NULL; }
+            pOb->iNode = iNode;
             pOb->h.magic = MEM_IO_SCATTER_HEADER_MAGIC;
             pOb->h.version = MEM_IO_SCATTER_HEADER_VERSION;
             pOb->h.cbMax = 0x1000;
             pOb->h.pb = pOb->pb;
             pOb->h.qwA = (QWORD)-1;
-            Ob_INCREF(pOb);  // "total list" reference
-            InterlockedPushEntrySList(&t->ListHeadTotal, &pOb->SListTotal);
+            pOb->dwGeneration = t->dwGeneration;
+            Ob_INCREF(pOb);  // "cache base" reference - released on retire
             InterlockedIncrement(&t->cTotal);
             return pOb;         // return fresh object - refcount = 2.
         }
+        // numa mode: re-use an empty entry of another node before reclaiming
+        if(ctxVmm->Numa.fEnabled && (e = VmmCacheReserve_PopEmptyRemote(t, iNode))) { break; }
         // reclaim existing entries
         iReclaimLast = InterlockedIncrement16(&t->iReclaimLast);
         VmmCacheReclaim(t, iReclaimLast % VMM_CACHE2_REGIONS, FALSE);
@@ -241,24 +639,289 @@ PVMMOB_MEM VmmCacheReserve(_In_ DWORD dwTblTag)
     pOb = CONTAINING_RECORD(e, VMMOB_MEM, SListEmpty);
     pOb->h.qwA = (QWORD)-1;
     pOb->h.cb = 0;
+    pOb->dwGeneration = t->dwGeneration;
+    if(pOb->fSpeculative) {
+        pOb->fSpeculative = FALSE;
+        InterlockedIncrement64(&ctxVmm->stat.cPhysReadAheadMiss);
+    }
     return pOb; // reference overtaken by callee (from EmptyList)
 }
 
-PVMMOB_MEM VmmCacheGet(_In_ DWORD dwTblTag, _In_ QWORD qwA)
+/*
+* Enter / exit a lock-free reader epoch. Cache objects observed by the reader
+* in between are not free'd by VmmCacheRetirePurge. The reader counts are kept
+* in per-processor shards so that lookups only write processor-local cache
+* lines. The shard is remembered for the exit since the thread may migrate.
+* -- pShard = the reader shard of the current processor.
+* -- iEpoch = the epoch parity returned by VmmCacheEpoch_Enter.
+* -- return
+*/
+inline DWORD VmmCacheEpoch_Enter(_In_ PVMM_CACHE_TABLE t, _In_ PVMM_CACHE_READER_SHARD pShard)
+{
+    DWORD iEpoch = (DWORD)(t->qwEpoch & 1);
+    InterlockedIncrement((volatile LONG*)&pShard->cEpochReader[iEpoch]);
+    return iEpoch;
+}
+
+inline VOID VmmCacheEpoch_Exit(_In_ PVMM_CACHE_READER_SHARD pShard, _In_ DWORD iEpoch)
+{
+    InterlockedDecrement((volatile LONG*)&pShard->cEpochReader[iEpoch]);
+}
+
+/*
+* Try to increase the reference count of a cache object found by a lock-free
+* reader. Cache objects are never free'd while the cache is active, but they
+* may be in transit to the empty list - in which case the reference count may
+* temporarily be one. A reference is only taken if the count is at least two
+* to ensure the refcount-1 callback is never triggered twice for one detach.
+* -- pOb
+* -- return
+*/
+_Success_(return)
+BOOL VmmCacheGet_TryIncRef(_In_ PVMMOB_MEM pOb)
+{
+    DWORD c;
+    while((c = *(volatile DWORD*)&pOb->Ob._count) >= 2) {
+        if(c == (DWORD)InterlockedCompareExchange((volatile LONG*)&pOb->Ob._count, c + 1, c)) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/*
+* Lock-free cache lookup protected by the region sequence number. The bucket
+* chain is walked without taking the region lock. The result is only accepted
+* if no writer touched the region during the walk.
+* -- t
+* -- iR
+* -- qwA
+* -- ppOb = the found object (or NULL if not found) on success.
+* -- return = TRUE if the lookup was consistent, FALSE if caller should retry.
+*/
+_Success_(return)
+BOOL VmmCacheGet_LockFree(_In_ PVMM_CACHE_TABLE t, _In_ DWORD iR, _In_ QWORD qwA, _Out_ PVMMOB_MEM *ppOb)
+{
+    DWORD dwSeq, cHop = 0;
+    PVMMOB_MEM pOb;
+    dwSeq = *(volatile DWORD*)&t->R[iR].dwSeq;
+    if(dwSeq & 1) { return FALSE; }
+    MemoryBarrier();
+    pOb = *(PVMMOB_MEM volatile*)&t->R[iR].B[VMM_CACHE2_GET_BUCKET(qwA)];
+    while(pOb && (qwA != pOb->h.qwA)) {
+        if(++cHop > VMM_CACHE2_LOCKFREE_MAXHOP) { return FALSE; }
+        pOb = *(PVMMOB_MEM volatile*)&pOb->FLink;
+    }
+    if(pOb && !VmmCacheGet_TryIncRef(pOb)) { return FALSE; }
+    MemoryBarrier();
+    if((dwSeq != *(volatile DWORD*)&t->R[iR].dwSeq) || (pOb && (qwA != pOb->h.qwA))) {
+        Ob_DECREF(pOb);
+        return FALSE;
+    }
+    *ppOb = pOb;
+    return TRUE;
+}
+
+PVMMOB_MEM VmmCacheGet_Table(_In_ DWORD dwTblTag, _In_ QWORD qwA)
 {
     PVMM_CACHE_TABLE t;
-    DWORD iR;
+    DWORD iR, iRetry, iEpoch;
     PVMMOB_MEM pOb;
+    PVMM_CACHE_READER_SHARD pShard;
     t = VmmCacheTableGet(dwTblTag);
     if(!t || !t->fActive) { return NULL; }
     iR = VMM_CACHE2_GET_REGION(qwA);
-    EnterCriticalSection(&t->R[iR].Lock);
+    pShard = &t->Shard[GetCurrentProcessorNumber() % VMM_CACHE2_READER_SHARDS];
+    // 1: lock-free lookup (read-mostly fast path) inside reader epoch
+    iEpoch = VmmCacheEpoch_Enter(t, pShard);
+    for(iRetry = 0; iRetry < VMM_CACHE2_LOCKFREE_RETRY; iRetry++) {
+        if(VmmCacheGet_LockFree(t, iR, qwA, &pOb)) {
+            VmmCacheEpoch_Exit(pShard, iEpoch);
+            goto finish;
+        }
+        InterlockedIncrement64(&ctxVmm->stat.cCacheLockFreeRetry);
+        YieldProcessor();
+    }
+    VmmCacheEpoch_Exit(pShard, iEpoch);
+    // 2: heavy writer contention on region -> fall back to locked lookup
+    InterlockedIncrement64(&ctxVmm->stat.cCacheLockFallback);
+    VmmCacheRegion_Lock(t, iR);
     pOb = t->R[iR].B[VMM_CACHE2_GET_BUCKET(qwA)];
     while(pOb && (qwA != pOb->h.qwA)) {
         pOb = pOb->FLink;
     }
     Ob_INCREF(pOb);
     LeaveCriticalSection(&t->R[iR].Lock);
+finish:
+    // entries from a previous cache generation are stale - treat as a miss.
+    // newer entries are inserted at the bucket head so they are found first.
+    if(pOb && (pOb->dwGeneration != t->dwGeneration)) {
+        Ob_DECREF_NULL(&pOb);
+    }
+    InterlockedIncrement64((volatile LONG64*)(pOb ? &pShard->cHit[iR] : &pShard->cMiss[iR]));
+    // mark as referenced for the eviction policy (avoid needless cache line writes).
+    if(pOb && !pOb->fReferenced) {
+        pOb->fReferenced = TRUE;
+    }
+    return pOb;
+}
+
+/*
+* Try to deduplicate a valid PHYS cache entry which is about to be inserted.
+* Only entries reserved in the current cache generation may be deduplicated.
+* A record pushed while the cache is concurrently cleared is removed again if
+* the generation changed - VmmCacheClear bumps the generation before it clears
+* the deduplication records.
+* -- t
+* -- pOb
+* -- return = TRUE if deduplicated - the entry should not be inserted.
+*/
+_Success_(return)
+BOOL VmmCacheDedup_Insert(_In_ PVMM_CACHE_TABLE t, _In_ PVMMOB_MEM pOb)
+{
+    BOOL fEqual, fResult;
+    QWORD qwHash, qwCanonical, pa = pOb->h.qwA;
+    PVMMOB_MEM pObCanonical;
+    // 1: zero page
+    if(Util_IsZeroBuffer(pOb->pb, 0x1000)) {
+        if(ObVSet_Size(ctxVmm->Cache.Dedup.psZero) >= VMM_CACHE_DEDUP_MAX_ENTRIES) {
+            ObVSet_Clear(ctxVmm->Cache.Dedup.psZero);
+        }
+        VmmCacheInvalidate_2(VMM_CACHE_TAG_PHYS, pa);
+        fResult = ObVSet_Push(ctxVmm->Cache.Dedup.psZero, pa | 1);
+        goto finish;
+    }
+    if(ctxVmm->Cache.Dedup.tp < VMM_CACHE_DEDUP_DUPLICATE) { goto insert; }
+    // 2: duplicate of cached canonical page
+    qwHash = Util_Hash64(pOb->pb, 0x1000);
+    qwCanonical = (QWORD)ObMap_GetByKey(ctxVmm->Cache.Dedup.pmDupHash, qwHash);
+    if(qwCanonical == (pa | 1)) { goto insert; }
+    if(qwCanonical && (qwHash ^ pa) && (pObCanonical = VmmCacheGet_Table(VMM_CACHE_TAG_PHYS, qwCanonical & ~1))) {
+        fEqual = !memcmp(pObCanonical->pb, pOb->pb, 0x1000);
+        Ob_DECREF(pObCanonical);
+        if(fEqual) {
+            if(ObMap_Size(ctxVmm->Cache.Dedup.pmDupPage) >= VMM_CACHE_DEDUP_MAX_ENTRIES) {
+                ObMap_Clear(ctxVmm->Cache.Dedup.pmDupPage);
+            }
+            VmmCacheInvalidate_2(VMM_CACHE_TAG_PHYS, pa);
+            fResult = ObMap_Push(ctxVmm->Cache.Dedup.pmDupPage, pa, (PVOID)(qwHash ^ pa));
+            goto finish;
+        }
+    }
+    // 3: page becomes the canonical page of its content hash
+    if(qwCanonical) {
+        ObMap_RemoveByKey(ctxVmm->Cache.Dedup.pmDupHash, qwHash);
+    }
+    if(ObMap_Size(ctxVmm->Cache.Dedup.pmDupHash) >= VMM_CACHE_DEDUP_MAX_ENTRIES) {
+        ObMap_Clear(ctxVmm->Cache.Dedup.pmDupHash);
+    }
+    ObMap_Push(ctxVmm->Cache.Dedup.pmDupHash, qwHash, (PVOID)(pa | 1));
+insert:
+    VmmCacheDedup_Remove(pa);
+    return FALSE;
+finish:
+    if(pOb->dwGeneration != t->dwGeneration) {
+        VmmCacheDedup_Remove(pa);
+    }
+    return fResult;
+}
+
+/*
+* Materialize a deduplicated PHYS cache page into a transient cache entry.
+* CALLER DECREF: return
+* -- pa
+* -- return
+*/
+PVMMOB_MEM VmmCacheDedup_Get(_In_ QWORD pa)
+{
+    QWORD qwHash, qwCanonical;
+    PVMMOB_MEM pOb = NULL, pObCanonical = NULL;
+    // 1: zero page
+    if(ObVSet_Size(ctxVmm->Cache.Dedup.psZero) && ObVSet_Exists(ctxVmm->Cache.Dedup.psZero, pa | 1)) {
+        if(!(pOb = VmmCacheReserve(VMM_CACHE_TAG_PHYS))) { return NULL; }
+        ZeroMemory(pOb->pb, 0x1000);
+        InterlockedIncrement64(&ctxVmm->stat.cPhysCacheDedupZero);
+        goto finish;
+    }
+    // 2: duplicate page - the canonical page must still be cached and unchanged.
+    if(!ObMap_Size(ctxVmm->Cache.Dedup.pmDupPage)) { return NULL; }
+    if(!(qwHash = (QWORD)ObMap_GetByKey(ctxVmm->Cache.Dedup.pmDupPage, pa))) { return NULL; }
+    qwHash = qwHash ^ pa;
+    if((qwCanonical = (QWORD)ObMap_GetByKey(ctxVmm->Cache.Dedup.pmDupHash, qwHash))) {
+        pObCanonical = VmmCacheGet_Table(VMM_CACHE_TAG_PHYS, qwCanonical & ~1);
+    }
+    if(!pObCanonical || (qwHash != Util_Hash64(pObCanonical->pb, 0x1000)) || !(pOb = VmmCacheReserve(VMM_CACHE_TAG_PHYS))) {
+        ObMap_RemoveByKey(ctxVmm->Cache.Dedup.pmDupPage, pa);
+        Ob_DECREF(pObCanonical);
+        return NULL;
+    }
+    memcpy(pOb->pb, pObCanonical->pb, 0x1000);
+    Ob_DECREF(pObCanonical);
+    InterlockedIncrement64(&ctxVmm->stat.cPhysCacheDedupDuplicate);
+finish:
+    pOb->h.qwA = pa;
+    pOb->h.cb = 0x1000;
+    return pOb;
+}
+
+/*
+* Return an entry retrieved with VmmCacheReserve to the cache.
+* NB! no other items may be returned with this function!
+* FUNCTION DECREF: pOb
+* -- pOb
+*/
+VOID VmmCacheReserveReturn(_In_opt_ PVMMOB_MEM pOb)
+{
+    DWORD iR, iB;
+    PVMM_CACHE_TABLE t;
+    if(!pOb) { return; }
+    t = VmmCacheTableGet(((POB)pOb)->_tag);
+    if(!t) {
+        vmmprintf_fn("ERROR - SHOULD NOT HAPPEN - INVALID OBJECT TAG %02X\n", ((POB)pOb)->_tag);
+        return;
+    }
+    if((pOb->h.cb != 0x1000) || (pOb->h.qwA == (QWORD)-1) || !t->fActive) {
+        // decrement refcount of object - callback will take care of
+        // re-insertion into empty list when refcount becomes low enough.
+        Ob_DECREF(pOb);
+        return;
+    }
+    if((t->tag == VMM_CACHE_TAG_PHYS) && ctxVmm->Cache.Dedup.tp && (pOb->dwGeneration == t->dwGeneration) && VmmCacheDedup_Insert(t, pOb)) {
+        // deduplicated - page is tracked without occupying a cache entry.
+        pOb->fSpeculative = FALSE;
+        Ob_DECREF(pOb);
+        return;
+    }
+    // insert into map - refcount will be overtaken by "cache region".
+    iR = VMM_CACHE2_GET_REGION(pOb->h.qwA);
+    iB = VMM_CACHE2_GET_BUCKET(pOb->h.qwA);
+    VmmCacheRegion_Lock(t, iR);
+    VMM_CACHE2_SEQ_BEGIN(t, iR);
+    // insert into "bucket"
+    pOb->BLink = NULL;
+    pOb->FLink = t->R[iR].B[iB];
+    if(pOb->FLink) { pOb->FLink->BLink = pOb; }
+    t->R[iR].B[iB] = pOb;
+    // insert into "age list" (probationary list if 2Q policy)
+    pOb->fHot = FALSE;
+    pOb->fReferenced = FALSE;
+    pOb->AgeFLink = t->R[iR].AgeFLink;
+    if(pOb->AgeFLink) { pOb->AgeFLink->AgeBLink = pOb; }
+    pOb->AgeBLink = NULL;
+    t->R[iR].AgeFLink = pOb;
+    if(!t->R[iR].AgeBLink) { t->R[iR].AgeBLink = pOb; }
+    InterlockedIncrement(&t->R[iR].c);
+    t->R[iR].stat.cInsert++;
+    VMM_CACHE2_SEQ_END(t, iR);
+    LeaveCriticalSection(&t->R[iR].Lock);
+}
+
+PVMMOB_MEM VmmCacheGet(_In_ DWORD dwTblTag, _In_ QWORD qwA)
+{
+    PVMMOB_MEM pOb = VmmCacheGet_Table(dwTblTag, qwA);
+    if(!pOb && (dwTblTag == VMM_CACHE_TAG_PHYS) && ctxVmm->Cache.Dedup.tp) {
+        pOb = VmmCacheDedup_Get(qwA);
+    }
     return pOb;
 }
 
@@ -278,7 +941,11 @@ PVMMOB_MEM VmmCacheGet_FromDeviceOnMiss(_In_ DWORD dwTblTag, _In_ DWORD dwTblTag
             pObMEM = NULL;
         }
         if(pMEM->cb != 0x1000) {
-            LeechCore_ReadScatter(&pMEM, 1);
+            if(ctxVmm->MemMap.fEnabled) {
+                VmmMemMap_ReadScatter(&pMEM, 1);
+            } else {
+                LeechCore_ReadScatter(&pMEM, 1);
+            }
         }
         if(pMEM->cb == 0x1000) {
             Ob_INCREF(pObReservedMEM);
@@ -300,6 +967,109 @@ BOOL VmmCacheExists(_In_ DWORD dwTblTag, _In_ QWORD qwA)
     return result;
 }
 
+_Success_(return)
+BOOL VmmCacheGetStatistics(_In_ DWORD dwTblTag, _Out_ PVMM_CACHE_STATISTICS pStatistics)
+{
+    DWORD iR, iShard;
+    QWORD qwFreq;
+    PVMM_CACHE_TABLE t;
+    PVMM_CACHE_STATISTICS_REGION pR, pT = &pStatistics->Total;
+    ZeroMemory(pStatistics, sizeof(VMM_CACHE_STATISTICS));
+    t = VmmCacheTableGet(dwTblTag);
+    if(!t || !t->fActive) { return FALSE; }
+    QueryPerformanceFrequency((PLARGE_INTEGER)&qwFreq);
+    pStatistics->tag = t->tag;
+    pStatistics->tpPolicy = t->tpPolicy;
+    pStatistics->cMaxEntries = t->cMaxEntries;
+    pStatistics->cTotal = t->cTotal;
+    pStatistics->cEmpty = t->cEmpty;
+    pStatistics->cRetire = t->cRetire;
+    pStatistics->cNumaNode = ctxVmm->Numa.cNode;
+    pStatistics->cReserveNumaRemote = t->cReserveNumaRemote;
+    for(iR = 0; iR < VMM_CACHE2_REGIONS; iR++) {
+        pR = &pStatistics->R[iR];
+        pR->cEntries = t->R[iR].c;
+        pR->cHot = t->R[iR].cHot;
+        for(iShard = 0; iShard < VMM_CACHE2_READER_SHARDS; iShard++) {
+            pR->cHit += t->Shard[iShard].cHit[iR];
+            pR->cMiss += t->Shard[iShard].cMiss[iR];
+        }
+        pR->cInsert = t->R[iR].stat.cInsert;
+        pR->cEvict = t->R[iR].stat.cEvict;
+        pR->cEvictStale = t->R[iR].stat.cEvictStale;
+        pR->cLockContended = t->R[iR].stat.cLockContended;
+        pR->qwLockWaitUs = qwFreq ? ((t->R[iR].stat.qwLockWaitQPC * 1000000) / qwFreq) : 0;
+        pT->cEntries += pR->cEntries;
+        pT->cHot += pR->cHot;
+        pT->cHit += pR->cHit;
+        pT->cMiss += pR->cMiss;
+        pT->cInsert += pR->cInsert;
+        pT->cEvict += pR->cEvict;
+        pT->cEvictStale += pR->cEvictStale;
+        pT->cLockContended += pR->cLockContended;
+        pT->qwLockWaitUs += pR->qwLockWaitUs;
+    }
+    return TRUE;
+}
+
+/*
+* Enumerate all valid (non-stale) entries in a cache table. The callback is
+* called with the cache region lock held and must not call into the cache.
+* -- dwTblTag
+* -- ctx = optional context to pass along to the callback function.
+* -- pfnCB = callback function called once for each valid cache entry.
+*/
+VOID VmmCacheEnumerate(_In_ DWORD dwTblTag, _In_opt_ PVOID ctx, _In_ VOID(*pfnCB)(_In_opt_ PVOID ctx, _In_ PVMMOB_MEM pOb))
+{
+    DWORD iR, iB;
+    PVMMOB_MEM pOb;
+    PVMM_CACHE_TABLE t;
+    t = VmmCacheTableGet(dwTblTag);
+    if(!t || !t->fActive) { return; }
+    for(iR = 0; iR < VMM_CACHE2_REGIONS; iR++) {
+        VmmCacheRegion_Lock(t, iR);
+        for(iB = 0; iB < VMM_CACHE2_BUCKETS; iB++) {
+            pOb = t->R[iR].B[iB];
+            while(pOb) {
+                if((pOb->dwGeneration == t->dwGeneration) && (pOb->h.cb == 0x1000)) {
+                    pfnCB(ctx, pOb);
+                }
+                pOb = pOb->FLink;
+            }
+        }
+        LeaveCriticalSection(&t->R[iR].Lock);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// NEGATIVE TLB CACHE:
+// Page tables rejected by the memory model page table verification are kept
+// in a small direct mapped lock-free array so that they are not re-read and
+// re-verified on each subsequent walk/spider pass. Each entry is tagged with
+// the TLB cache generation + the physical write invalidation generation, i.e.
+// entries become stale when the TLB cache is refreshed or memory is written.
+// ----------------------------------------------------------------------------
+
+#define VMM_TLBNEG_INDEX(pa)            ((DWORD)(pa >> 12) & (VMM_TLB_NEGATIVE_ENTRIES - 1))
+
+QWORD VmmTlbNegative_Tag(_In_ QWORD pa)
+{
+    DWORD dwGen = ctxVmm->Cache.TLB.dwGeneration + ctxVmm->Cache.dwSoftTlbInvalidateGeneration;
+    return (pa & 0x000ffffffffff000) | (dwGen & 0xfff) | ((QWORD)(dwGen & 0x00fff000) << 40);
+}
+
+BOOL VmmTlbNegative_Exists(_In_ QWORD pa)
+{
+    QWORD qwTag = VmmTlbNegative_Tag(pa);
+    return qwTag && (ctxVmm->Cache.TlbNegative[VMM_TLBNEG_INDEX(pa)] == qwTag);
+}
+
+VOID VmmTlbNegative_Put(_In_ QWORD pa)
+{
+    InterlockedIncrement64(&ctxVmm->stat.cTlbVerifyFail);
+    ctxVmm->Cache.TlbNegative[VMM_TLBNEG_INDEX(pa)] = VmmTlbNegative_Tag(pa);
+}
+
 /*
 * Retrieve a page table from a given physical address (if possible).
 * CALLER DECREF: return
@@ -316,6 +1086,10 @@ PVMMOB_MEM VmmTlbGetPageTable(_In_ QWORD pa, _In_ BOOL fCacheOnly)
         return pObMEM;
     }
     if(fCacheOnly) { return NULL; }
+    if(VmmTlbNegative_Exists(pa)) {
+        InterlockedIncrement64(&ctxVmm->stat.cTlbNegativeHit);
+        return NULL;
+    }
     // try retrieve from (1) TLB cache, (2) PHYS cache, (3) device
     pObMEM = VmmCacheGet_FromDeviceOnMiss(VMM_CACHE_TAG_TLB, VMM_CACHE_TAG_PHYS, pa);
     if(!pObMEM) {
@@ -326,6 +1100,9 @@ PVMMOB_MEM VmmTlbGetPageTable(_In_ QWORD pa, _In_ BOOL fCacheOnly)
     if(VmmTlbPageTableVerify(pObMEM->h.pb, pObMEM->h.qwA, FALSE)) {
         return pObMEM;
     }
+    // rejected: drop the (zeroed) page table from the tlb cache and remember it
+    VmmCacheInvalidate_2(VMM_CACHE_TAG_TLB, pObMEM->h.qwA);
+    VmmTlbNegative_Put(pObMEM->h.qwA);
     Ob_DECREF(pObMEM);
     return NULL;
 }
@@ -344,18 +1121,138 @@ VOID VmmCache2Close(_In_ DWORD dwTblTag)
         VmmCacheReclaim(t, i, TRUE);
         DeleteCriticalSection(&t->R[i].Lock);
     }
-    // remove from "empty list"
-    while(e = InterlockedPopEntrySList(&t->ListHeadEmpty)) {
-        pOb = CONTAINING_RECORD(e, VMMOB_MEM, SListEmpty);
-        Ob_DECREF(pOb);
-        InterlockedDecrement(&t->cEmpty);
+    // remove from "empty lists" - callback will retire object.
+    for(i = 0; i < VMM_NUMA_NODES_MAX; i++) {
+        while(e = InterlockedPopEntrySList(&t->ListHeadEmpty[i])) {
+            pOb = CONTAINING_RECORD(e, VMMOB_MEM, SListEmpty);
+            InterlockedDecrement(&t->cEmpty);
+            Ob_DECREF(pOb);
+        }
     }
-    // remove from "total list"
-    while(e = InterlockedPopEntrySList(&t->ListHeadTotal)) {
-        pOb = CONTAINING_RECORD(e, VMMOB_MEM, SListTotal);
-        Ob_DECREF(pOb);
-        InterlockedDecrement(&t->cTotal);
+    // free retired objects
+    VmmCacheRetirePurge(t, TRUE);
+}
+
+/*
+* Shrink a cache table to its maximum number of entries by retiring entries
+* from the empty list and, if required, by reclaiming entries in use.
+* -- t
+*/
+VOID VmmCacheShrink(_In_ PVMM_CACHE_TABLE t)
+{
+    DWORD i;
+    PSLIST_ENTRY e;
+    PVMMOB_MEM pOb;
+    for(i = 0; i < VMM_NUMA_NODES_MAX; i++) {
+        while((t->cTotal > t->cMaxEntries) && (e = InterlockedPopEntrySList(&t->ListHeadEmpty[i]))) {
+            pOb = CONTAINING_RECORD(e, VMMOB_MEM, SListEmpty);
+            InterlockedDecrement(&t->cEmpty);
+            Ob_DECREF(pOb);
+        }
     }
+    for(i = 0; (i < VMM_CACHE2_REGIONS) && (t->cTotal > t->cMaxEntries); i++) {
+        VmmCacheReclaim(t, i, FALSE);
+    }
+}
+
+VOID VmmCacheSetPolicy(_In_ DWORD tpPolicy)
+{
+    if(tpPolicy > VMM_CACHE_POLICY_MAX) { return; }
+    ctxVmm->Cache.PHYS.tpPolicy = tpPolicy;
+    ctxVmm->Cache.TLB.tpPolicy = tpPolicy;
+    ctxVmm->Cache.PAGING.tpPolicy = tpPolicy;
+}
+
+VOID VmmCacheSetDedup(_In_ DWORD tpDedup)
+{
+    BOOL fClear;
+    if(tpDedup > VMM_CACHE_DEDUP_MAX) { return; }
+    fClear = tpDedup < ctxVmm->Cache.Dedup.tp;
+    ctxVmm->Cache.Dedup.tp = tpDedup;
+    if(fClear) {
+        VmmCacheDedup_Clear();
+    }
+}
+
+// Negative paging cache - a set-associative table of pte fingerprints with a
+// per-entry insertion tick. Slots are single 64-bit words written atomically,
+// a lost update due to concurrent writers only results in a later retry.
+#define VMM_PAGING_FAILED_TICK_MASK     0x00ffffff
+
+QWORD VmmCachePagingFailed_Hash(_In_ QWORD pte)
+{
+    pte ^= pte >> 33;
+    pte *= 0xff51afd7ed558ccd;
+    pte ^= pte >> 33;
+    pte *= 0xc4ceb9fe1a85ec53;
+    return pte ^ (pte >> 33);
+}
+
+DWORD VmmCachePagingFailed_Tick()
+{
+    return (DWORD)(GetTickCount64() >> VMM_PAGING_FAILED_TICK_SHIFT) & VMM_PAGING_FAILED_TICK_MASK;
+}
+
+BOOL VmmCachePagingFailedExists(_In_ QWORD pte)
+{
+    QWORD h, qw;
+    DWORD i, dwTick;
+    PVMM_PAGING_FAILED_BUCKET pb;
+    if(!ctxVmm->Cache.PAGING_FAILED.pBucket) { return FALSE; }
+    h = VmmCachePagingFailed_Hash(pte);
+    pb = ctxVmm->Cache.PAGING_FAILED.pBucket + (h & (VMM_PAGING_FAILED_BUCKETS - 1));
+    dwTick = VmmCachePagingFailed_Tick();
+    for(i = 0; i < VMM_PAGING_FAILED_WAYS; i++) {
+        qw = pb->qw[i];
+        if(qw && ((qw >> 24) == (h >> 24))) {
+            return ((dwTick - (DWORD)qw) & VMM_PAGING_FAILED_TICK_MASK) < ctxVmm->Cache.PAGING_FAILED.dwTTL;
+        }
+    }
+    return FALSE;
+}
+
+VOID VmmCachePagingFailedPush(_In_ QWORD pte)
+{
+    QWORD h, qw, qwNew;
+    DWORD i, iSlot = 0, dwTick, dwAge, dwAgeMax = 0;
+    PVMM_PAGING_FAILED_BUCKET pb;
+    if(!ctxVmm->Cache.PAGING_FAILED.pBucket) { return; }
+    h = VmmCachePagingFailed_Hash(pte);
+    pb = ctxVmm->Cache.PAGING_FAILED.pBucket + (h & (VMM_PAGING_FAILED_BUCKETS - 1));
+    dwTick = VmmCachePagingFailed_Tick();
+    for(i = 0; i < VMM_PAGING_FAILED_WAYS; i++) {
+        qw = pb->qw[i];
+        if(!qw || ((qw >> 24) == (h >> 24))) {
+            iSlot = i;
+            break;
+        }
+        dwAge = (dwTick - (DWORD)qw) & VMM_PAGING_FAILED_TICK_MASK;
+        if(dwAge >= dwAgeMax) {
+            dwAgeMax = dwAge;
+            iSlot = i;
+        }
+    }
+    qwNew = (h & ~(QWORD)VMM_PAGING_FAILED_TICK_MASK) | dwTick;
+    InterlockedExchange64((volatile LONG64*)&pb->qw[iSlot], (LONG64)(qwNew ? qwNew : 1));   // zero = empty slot
+}
+
+VOID VmmCachePagingFailedSetTTL(_In_ DWORD cMs)
+{
+    ctxVmm->Cache.PAGING_FAILED.dwTTL = min(VMM_PAGING_FAILED_TICK_MASK, max(1, cMs >> VMM_PAGING_FAILED_TICK_SHIFT));
+}
+
+VOID VmmCacheSetBudget(_In_ DWORD cMB)
+{
+    DWORD cEntries;
+    cMB = max(VMM_CACHE_BUDGET_MB_MIN, min(VMM_CACHE_BUDGET_MB_MAX, cMB));
+    cEntries = max(VMM_CACHE2_MIN_ENTRIES, (DWORD)(((QWORD)cMB << 8) / 3));   // 4kB pages split over 3 caches
+    ctxVmm->Cache.cMB_Budget = cMB;
+    ctxVmm->Cache.PHYS.cMaxEntries = cEntries;
+    ctxVmm->Cache.TLB.cMaxEntries = cEntries;
+    ctxVmm->Cache.PAGING.cMaxEntries = cEntries;
+    VmmCacheShrink(&ctxVmm->Cache.PHYS);
+    VmmCacheShrink(&ctxVmm->Cache.TLB);
+    VmmCacheShrink(&ctxVmm->Cache.PAGING);
 }
 
 VOID VmmCache2Initialize(_In_ DWORD dwTblTag)
@@ -367,38 +1264,105 @@ VOID VmmCache2Initialize(_In_ DWORD dwTblTag)
     for(i = 0; i < VMM_CACHE2_REGIONS; i++) {
         InitializeCriticalSection(&t->R[i].Lock);
     }
-    InitializeSListHead(&t->ListHeadEmpty);
-    InitializeSListHead(&t->ListHeadTotal);
+    for(i = 0; i < VMM_NUMA_NODES_MAX; i++) {
+        InitializeSListHead(&t->ListHeadEmpty[i]);
+    }
+    InitializeSListHead(&t->ListHeadRetire);
+    InitializeSListHead(&t->ListHeadRetireGrace);
+    t->cMaxEntries = VMM_CACHE2_MIN_ENTRIES;
     t->fActive = TRUE;
     t->tag = dwTblTag;
 }
 
+VOID VmmTlbSpiderAll_FallbackCB(_In_ PVMM_PROCESS pProcess, _In_opt_ PVOID ctx)
+{
+    VmmTlbSpider(pProcess);
+}
+
+VOID VmmTlbSpiderAll()
+{
+    if(ctxVmm->tpMemoryModel == VMM_MEMORYMODEL_NA) { return; }
+    if(ctxVmm->fnMemoryModel.pfnTlbSpiderAll) {
+        ctxVmm->fnMemoryModel.pfnTlbSpiderAll();
+    } else {
+        VmmProcessActionForeachParallel(NULL, 0, NULL, VmmTlbSpiderAll_FallbackCB);
+    }
+}
+
+typedef struct tdVMM_TLBPREFETCH_VERIFY_CONTEXT {
+    PPMEM_IO_SCATTER_HEADER ppMEMs;
+    DWORD cpMEMs;
+} VMM_TLBPREFETCH_VERIFY_CONTEXT, *PVMM_TLBPREFETCH_VERIFY_CONTEXT;
+
+/*
+* Verify a chunk of freshly read page tables - rejected page tables are marked
+* as failed reads (not inserted into the tlb cache) and remembered in the
+* negative tlb cache. Called on the work pool by VmmTlbPrefetch().
+*/
+VOID VmmTlbPrefetch_VerifyItem(_In_ PVMM_TLBPREFETCH_VERIFY_CONTEXT ctx, _In_ DWORD iItem)
+{
+    DWORD i, iMax;
+    PMEM_IO_SCATTER_HEADER pMEM;
+    i = iItem * VMM_TLB_VERIFY_PARALLEL_CHUNK;
+    iMax = min(ctx->cpMEMs, i + VMM_TLB_VERIFY_PARALLEL_CHUNK);
+    for(; i < iMax; i++) {
+        pMEM = ctx->ppMEMs[i];
+        if((pMEM->cb == 0x1000) && !VmmTlbPageTableVerify(pMEM->pb, pMEM->qwA, FALSE)) {
+            pMEM->cb = 0;   // "fail" invalid page table read
+            VmmTlbNegative_Put(pMEM->qwA);
+        }
+    }
+}
+
 /*
 * Prefetch a set of physical addresses contained in pTlbPrefetch into the Tlb.
+* Page tables known to be invalid (negative tlb cache) are skipped. Verification
+* of the fetched page tables is done in parallel on the work pool.
 * NB! pTlbPrefetch must not be updated/altered during the function call.
 * -- pProcess
 * -- pTlbPrefetch = the page table addresses to prefetch (on entry) and empty set on exit.
 */
 VOID VmmTlbPrefetch(_In_ POB_VSET pTlbPrefetch)
 {
-    QWORD pbTlb = 0;
-    DWORD cTlbs, i = 0;
+    QWORD qwA;
+    DWORD cTlbs, c, cItem, i = 0;
     PPVMMOB_MEM ppObMEMs = NULL;
     PPMEM_IO_SCATTER_HEADER ppMEMs = NULL;
+    VMM_TLBPREFETCH_VERIFY_CONTEXT ctxVerify;
     if(!(cTlbs = ObVSet_Size(pTlbPrefetch))) { goto fail; }
     if(!(ppMEMs = LocalAlloc(0, cTlbs * sizeof(PMEM_IO_SCATTER_HEADER)))) { goto fail; }
     if(!(ppObMEMs = LocalAlloc(0, cTlbs * sizeof(PVMMOB_MEM)))) { goto fail; }
     while((cTlbs = min(0x2000, ObVSet_Size(pTlbPrefetch)))) {   // protect cache bleed -> max 0x2000 pages/round
-        for(i = 0; i < cTlbs; i++) {
-            ppObMEMs[i] = VmmCacheReserve(VMM_CACHE_TAG_TLB);
-            ppMEMs[i] = &ppObMEMs[i]->h;
-            ppMEMs[i]->qwA = ObVSet_Pop(pTlbPrefetch);
-        }
-        LeechCore_ReadScatter(ppMEMs, cTlbs);
-        for(i = 0; i < cTlbs; i++) {
-            if((ppMEMs[i]->cb == 0x1000) && !VmmTlbPageTableVerify(ppMEMs[i]->pb, ppMEMs[i]->qwA, FALSE)) {
-                ppMEMs[i]->cb = 0;  // "fail" invalid page table read
+        for(i = 0, c = 0; i < cTlbs; i++) {
+            qwA = ObVSet_Pop(pTlbPrefetch);
+            if(VmmTlbNegative_Exists(qwA)) {
+                InterlockedIncrement64(&ctxVmm->stat.cTlbNegativeHit);
+                continue;
             }
+            ppObMEMs[c] = VmmCacheReserve(VMM_CACHE_TAG_TLB);
+            ppMEMs[c] = &ppObMEMs[c]->h;
+            ppMEMs[c]->qwA = qwA;
+            c++;
+        }
+        if(!c) { continue; }
+        VmmReadScatterPhysical_DeviceScatter(ppMEMs, c);
+        ctxVerify.ppMEMs = ppMEMs;
+        ctxVerify.cpMEMs = c;
+        cItem = (c + VMM_TLB_VERIFY_PARALLEL_CHUNK - 1) / VMM_TLB_VERIFY_PARALLEL_CHUNK;
+        if((cItem > 1) && ctxVmm->ThreadWorkers.fEnabled) {
+            VmmWorkParallel(&ctxVerify, cItem, (VOID(*)(PVOID, DWORD))VmmTlbPrefetch_VerifyItem);
+            if(!ctxVmm->ThreadWorkers.fEnabled) {
+                // shutting down: work items may have been skipped - don't cache unverified page tables
+                for(i = 0; i < c; i++) {
+                    ppMEMs[i]->cb = 0;
+                }
+            }
+        } else {
+            for(i = 0; i < cItem; i++) {
+                VmmTlbPrefetch_VerifyItem(&ctxVerify, i);
+            }
+        }
+        for(i = 0; i < c; i++) {
             VmmCacheReserveReturn(ppObMEMs[i]);
         }
     }
@@ -418,15 +1382,19 @@ fail:
 */
 VOID VmmCachePrefetchPages(_In_opt_ PVMM_PROCESS pProcess, _In_opt_ POB_VSET pPrefetchPages, _In_ QWORD flags)
 {
-    QWORD qwA = 0;
-    DWORD cPages, iMEM = 0;
+    PQWORD pqwA;
+    DWORD cPages, iMEM;
     PPMEM_IO_SCATTER_HEADER ppMEMs = NULL;
-    cPages = ObVSet_Size(pPrefetchPages);
-    if(!cPages || (ctxVmm->flags & VMM_FLAG_NOCACHE)) { return; }
-    if(!LeechCore_AllocScatterEmpty(cPages, &ppMEMs)) { return; }
-    while((qwA = ObVSet_GetNext(pPrefetchPages, qwA))) {
-        ppMEMs[iMEM++]->qwA = qwA & ~0xfff;
+    if(!ObVSet_Size(pPrefetchPages) || (ctxVmm->flags & VMM_FLAG_NOCACHE)) { return; }
+    if(!(pqwA = ObVSet_GetSorted(pPrefetchPages, &cPages))) { return; }
+    if(!LeechCore_AllocScatterEmpty(cPages, &ppMEMs)) {
+        LocalFree(pqwA);
+        return;
     }
+    for(iMEM = 0; iMEM < cPages; iMEM++) {
+        ppMEMs[iMEM]->qwA = pqwA[iMEM] & ~0xfff;
+    }
+    LocalFree(pqwA);
     if(pProcess) {
         VmmReadScatterVirtual(pProcess, ppMEMs, iMEM, flags);
     } else {
@@ -499,8 +1467,122 @@ VOID VmmCachePrefetchPages4(_In_opt_ PVMM_PROCESS pProcess, _In_ DWORD cAddresse
             ObVSet_Push_PageAlign(pObVSet, pqwAddresses[cAddresses], cb);
         }
     }
-    VmmCachePrefetchPages(pProcess, pObVSet, 0);
-    Ob_DECREF(pObVSet);
+    VmmCachePrefetchPages(pProcess, pObVSet, 0);
+    Ob_DECREF(pObVSet);
+}
+
+typedef struct tdVMM_PREFETCH_ASYNC_CONTEXT {
+    DWORD iSlot;
+    PVMM_PROCESS pProcess;
+    POB_VSET pPrefetchPages;
+    QWORD flags;
+} VMM_PREFETCH_ASYNC_CONTEXT, *PVMM_PREFETCH_ASYNC_CONTEXT;
+
+/*
+* Work pool item of VmmCachePrefetchPagesAsync - prefetch the pages and release
+* the prefetch slot (which wakes up any reader waiting for the pages).
+*/
+VOID VmmCachePrefetchPagesAsync_Item(_In_ PVMM_PREFETCH_ASYNC_CONTEXT ctx, _In_ DWORD iItem)
+{
+    if(ctxVmm->ThreadWorkers.fEnabled) {
+        VmmCachePrefetchPages(ctx->pProcess, ctx->pPrefetchPages, ctx->flags | VMM_FLAG_NOPREFETCHWAIT);
+    }
+    AcquireSRWLockExclusive(&ctxVmm->Remote.LockPrefetchSRW);
+    ctxVmm->Remote.Prefetch[ctx->iSlot].fActive = FALSE;
+    Ob_DECREF_NULL(&ctxVmm->Remote.Prefetch[ctx->iSlot].psPages);
+    InterlockedDecrement(&ctxVmm->Remote.cPrefetchInFlight);
+    SetEvent(ctxVmm->Remote.Prefetch[ctx->iSlot].hEventIdle);
+    ReleaseSRWLockExclusive(&ctxVmm->Remote.LockPrefetchSRW);
+    Ob_DECREF(ctx->pProcess);
+    Ob_DECREF(ctx->pPrefetchPages);
+    LocalFree(ctx);
+}
+
+/*
+* Prefetch a set of addresses contained in pPrefetchPages into the cache as a
+* prefetch hint. Towards remote devices the prefetch is issued on the work pool
+* and the function returns immediately - the caller may continue processing
+* while the pages are on the wire. The pages are tracked in one of the prefetch
+* slots until retrieved; reads of any of them wait for the prefetch so that the
+* pages are never requested twice. Towards other devices, or if asynchronous
+* prefetching is disabled or all slots are in use, the prefetch is synchronous.
+* NB! pPrefetchPages must contain page aligned addresses only and must not be
+*     updated/altered after the function call.
+* -- pProcess
+* -- pPrefetchPages
+* -- flags
+*/
+VOID VmmCachePrefetchPagesAsync(_In_opt_ PVMM_PROCESS pProcess, _In_opt_ POB_VSET pPrefetchPages, _In_ QWORD flags)
+{
+    DWORD iSlot;
+    PVMM_PREFETCH_ASYNC_CONTEXT ctx = NULL;
+    if(!ObVSet_Size(pPrefetchPages)) { return; }
+    if(!ctxMain->dev.fRemote || !ctxVmm->Remote.fPrefetchAsync || (ctxVmm->flags & VMM_FLAG_NOCACHE)) { goto fail; }
+    if(!(ctx = LocalAlloc(0, sizeof(VMM_PREFETCH_ASYNC_CONTEXT)))) { goto fail; }
+    // 1: claim a prefetch slot
+    AcquireSRWLockExclusive(&ctxVmm->Remote.LockPrefetchSRW);
+    for(iSlot = 0; (iSlot < VMM_REMOTE_PREFETCH_INFLIGHT_MAX) && ctxVmm->Remote.Prefetch[iSlot].fActive; iSlot++);
+    if(iSlot < VMM_REMOTE_PREFETCH_INFLIGHT_MAX) {
+        ctxVmm->Remote.Prefetch[iSlot].fActive = TRUE;
+        ctxVmm->Remote.Prefetch[iSlot].dwPID = pProcess ? pProcess->dwPID : (DWORD)-1;
+        ctxVmm->Remote.Prefetch[iSlot].psPages = Ob_INCREF(pPrefetchPages);
+        ResetEvent(ctxVmm->Remote.Prefetch[iSlot].hEventIdle);
+        InterlockedIncrement(&ctxVmm->Remote.cPrefetchInFlight);
+    }
+    ReleaseSRWLockExclusive(&ctxVmm->Remote.LockPrefetchSRW);
+    if(iSlot == VMM_REMOTE_PREFETCH_INFLIGHT_MAX) { goto fail; }
+    // 2: submit to the work pool (or execute synchronously on failure)
+    ctx->iSlot = iSlot;
+    ctx->pProcess = Ob_INCREF(pProcess);
+    ctx->pPrefetchPages = Ob_INCREF(pPrefetchPages);
+    ctx->flags = flags;
+    if(VmmWorkAsync(ctx, (VOID(*)(PVOID, DWORD))VmmCachePrefetchPagesAsync_Item)) {
+        InterlockedIncrement64(&ctxVmm->stat.cRemotePrefetchAsync);
+    } else {
+        VmmCachePrefetchPagesAsync_Item(ctx, 0);
+    }
+    return;
+fail:
+    LocalFree(ctx);
+    VmmCachePrefetchPages(pProcess, pPrefetchPages, flags);
+}
+
+/*
+* Wait for outstanding asynchronous remote prefetches of any of the pages about
+* to be read. Reads of pages not being prefetched never wait. The wait is
+* bounded by VMM_REMOTE_PREFETCH_WAIT_MS - pages of a prefetch which is still
+* outstanding after that are just read from the device.
+* -- dwPID = PID of the process being read, or (DWORD)-1 for physical memory.
+* -- ppMEMs
+* -- cpMEMs
+* -- flags
+*/
+VOID VmmCachePrefetchWait(_In_ DWORD dwPID, _In_ PPMEM_IO_SCATTER_HEADER ppMEMs, _In_ DWORD cpMEMs, _In_ QWORD flags)
+{
+    DWORD i, iSlot, cPages = 0, cWait = 0;
+    PQWORD pqwPages;
+    HANDLE hWait[VMM_REMOTE_PREFETCH_INFLIGHT_MAX];
+    if(!ctxVmm->Remote.cPrefetchInFlight || (flags & VMM_FLAG_NOPREFETCHWAIT)) { return; }
+    // gather the pages not yet read - each prefetch slot page set is then
+    // looked up in one batch (one set lock acquisition per slot).
+    if(!(pqwPages = LocalAlloc(0, cpMEMs * sizeof(QWORD)))) { return; }
+    for(i = 0; i < cpMEMs; i++) {
+        if(ppMEMs[i]->cb != ppMEMs[i]->cbMax) {
+            pqwPages[cPages++] = ppMEMs[i]->qwA & ~0xfff;
+        }
+    }
+    AcquireSRWLockShared(&ctxVmm->Remote.LockPrefetchSRW);
+    for(iSlot = 0; cPages && (iSlot < VMM_REMOTE_PREFETCH_INFLIGHT_MAX); iSlot++) {
+        if(!ctxVmm->Remote.Prefetch[iSlot].fActive || (ctxVmm->Remote.Prefetch[iSlot].dwPID != dwPID)) { continue; }
+        if(ObVSet_ExistsBatch(ctxVmm->Remote.Prefetch[iSlot].psPages, cPages, pqwPages, NULL)) {
+            hWait[cWait++] = ctxVmm->Remote.Prefetch[iSlot].hEventIdle;
+        }
+    }
+    ReleaseSRWLockShared(&ctxVmm->Remote.LockPrefetchSRW);
+    LocalFree(pqwPages);
+    if(cWait) {
+        WaitForMultipleObjects(cWait, hWait, TRUE, VMM_REMOTE_PREFETCH_WAIT_MS);
+    }
 }
 
 // ----------------------------------------------------------------------------
@@ -519,11 +1601,110 @@ VOID VmmCachePrefetchPages4(_In_opt_ PVMM_PROCESS pProcess, _In_ DWORD cAddresse
 _Success_(return)
 BOOL VmmMap_GetPte(_In_ PVMM_PROCESS pProcess, _Out_ PVMMOB_MAP_PTE *ppObPteMap, _In_ BOOL fExtendedText)
 {
-    return
+    BOOL fResult;
+    QWORD tmTrace = (pProcess->Map.pObPte || !VMMTRACE_IS_ENABLED()) ? 0 : VmmTrace_Start();
+    fResult =
         (ctxVmm->tpMemoryModel != VMM_MEMORYMODEL_NA) &&
         ctxVmm->fnMemoryModel.pfnPteMapInitialize(pProcess) &&
         (!fExtendedText || VmmWin_InitializePteMapText(pProcess)) &&
         (*ppObPteMap = Ob_INCREF(pProcess->Map.pObPte));
+    if(tmTrace) { VmmTrace_Event(VMMTRACE_EVENT_MAP_BUILD, pProcess->dwPID, VMMTRACE_MAP_PTE, fResult, tmTrace); }
+    return fResult;
+}
+
+/*
+* Build a compact search index over the start addresses of a sorted map.
+* CALLER DECREF: return
+* -- cMap
+* -- pqwFirstKey = ptr to the start address of the first map entry.
+* -- cbEntry = map entry size (stride between keys).
+* -- return
+*/
+PVMMOB_MAP_INDEX VmmMap_Index_Build(_In_ DWORD cMap, _In_ PQWORD pqwFirstKey, _In_ DWORD cbEntry)
+{
+    DWORD i, cBlock, cKeys;
+    PVMMOB_MAP_INDEX pObIndex;
+    cBlock = (cMap + VMM_MAP_INDEX_BLOCK - 1) / VMM_MAP_INDEX_BLOCK;
+    cKeys = cBlock * VMM_MAP_INDEX_BLOCK;
+    if(!(pObIndex = Ob_Alloc('MapI', 0, sizeof(VMMOB_MAP_INDEX) + (cKeys + cBlock) * sizeof(QWORD), NULL, NULL))) { return NULL; }
+    pObIndex->cMap = cMap;
+    pObIndex->cBlock = cBlock;
+    pObIndex->pvaBlock = pObIndex->pva + cKeys;
+    for(i = 0; i < cMap; i++) {
+        pObIndex->pva[i] = *(PQWORD)((PBYTE)pqwFirstKey + (SIZE_T)i * cbEntry);
+    }
+    for(; i < cKeys; i++) {
+        pObIndex->pva[i] = (QWORD)-1;
+    }
+    for(i = 0; i < cBlock; i++) {
+        pObIndex->pvaBlock[i] = pObIndex->pva[i * VMM_MAP_INDEX_BLOCK];
+    }
+    return pObIndex;
+}
+
+/*
+* Retrieve the search index of a map - building it on first use. The index is
+* published atomically into the map and lives as long as the map object.
+* -- ppObIndex = ptr to the map pObIndex member.
+* -- cMap
+* -- pqwFirstKey
+* -- cbEntry
+* -- return = the index (no reference taken) or NULL if not available.
+*/
+PVMMOB_MAP_INDEX VmmMap_Index_Get(_Inout_ PVMMOB_MAP_INDEX volatile *ppObIndex, _In_ DWORD cMap, _In_ PQWORD pqwFirstKey, _In_ DWORD cbEntry)
+{
+    PVMMOB_MAP_INDEX pObIndex;
+    if(*ppObIndex) { return *ppObIndex; }
+    if(cMap < VMM_MAP_INDEX_MIN) { return NULL; }
+    if(!(pObIndex = VmmMap_Index_Build(cMap, pqwFirstKey, cbEntry))) { return NULL; }
+    if(InterlockedCompareExchangePointer((PVOID volatile*)ppObIndex, pObIndex, NULL)) {
+        Ob_DECREF(pObIndex);
+    }
+    return *ppObIndex;
+}
+
+/*
+* Find the index of the last map entry with start address <= va. The blocks
+* are binary searched over the compact block key array and the keys of the
+* found block (one cache line) are then compared branch-free.
+* -- pIndex
+* -- va
+* -- pi
+* -- return
+*/
+_Success_(return)
+BOOL VmmMap_Index_Find(_In_ PVMMOB_MAP_INDEX pIndex, _In_ QWORD va, _Out_ PDWORD pi)
+{
+    DWORD iLo = 0, iHi, iMid, c = 0;
+    PQWORD pva;
+    if(!pIndex->cMap || (va < pIndex->pva[0])) { return FALSE; }
+    iHi = pIndex->cBlock;
+    while(iHi - iLo > 1) {
+        iMid = (iLo + iHi) >> 1;
+        if(pIndex->pvaBlock[iMid] <= va) {
+            iLo = iMid;
+        } else {
+            iHi = iMid;
+        }
+    }
+    pva = pIndex->pva + (QWORD)iLo * VMM_MAP_INDEX_BLOCK;
+    c += (pva[0] <= va);
+    c += (pva[1] <= va);
+    c += (pva[2] <= va);
+    c += (pva[3] <= va);
+    c += (pva[4] <= va);
+    c += (pva[5] <= va);
+    c += (pva[6] <= va);
+    c += (pva[7] <= va);
+    *pi = min(iLo * VMM_MAP_INDEX_BLOCK + c, pIndex->cMap) - 1;
+    return TRUE;
+}
+
+VOID VmmMap_PteMap_CloseObCallback(_In_ PVOID pVmmOb)
+{
+    PVMMOB_MAP_PTE pOb = (PVMMOB_MAP_PTE)pVmmOb;
+    LocalFree(pOb->wszMultiText);
+    Ob_DECREF(pOb->pObIndex);
 }
 
 int VmmMap_GetPteEntry_CmpFind(_In_ QWORD vaFind, _In_ PVMM_MAP_PTEENTRY pEntry)
@@ -542,7 +1723,15 @@ int VmmMap_GetPteEntry_CmpFind(_In_ QWORD vaFind, _In_ PVMM_MAP_PTEENTRY pEntry)
 */
 PVMM_MAP_PTEENTRY VmmMap_GetPteEntry(_In_ PVMMOB_MAP_PTE pPteMap, _In_ QWORD va)
 {
+    DWORD i;
+    PVMM_MAP_PTEENTRY pe;
+    PVMMOB_MAP_INDEX pIndex;
     if(!pPteMap) { return NULL; }
+    if((pIndex = VmmMap_Index_Get(&pPteMap->pObIndex, pPteMap->cMap, &pPteMap->pMap[0].vaBase, sizeof(VMM_MAP_PTEENTRY)))) {
+        if(!VmmMap_Index_Find(pIndex, va, &i)) { return NULL; }
+        pe = pPteMap->pMap + i;
+        return (va < pe->vaBase + (pe->cPages << 12)) ? pe : NULL;
+    }
     return Util_qfind((PVOID)va, pPteMap->cMap, pPteMap->pMap, sizeof(VMM_MAP_PTEENTRY), (int(*)(PVOID, PVOID))VmmMap_GetPteEntry_CmpFind);
 }
 
@@ -557,7 +1746,12 @@ PVMM_MAP_PTEENTRY VmmMap_GetPteEntry(_In_ PVMMOB_MAP_PTE pPteMap, _In_ QWORD va)
 _Success_(return)
 BOOL VmmMap_GetVad(_In_ PVMM_PROCESS pProcess, _Out_ PVMMOB_MAP_VAD *ppObVadMap, _In_ BOOL fExtendedText)
 {
-    if(!MmVad_MapInitialize(pProcess, fExtendedText, 0)) { return FALSE; }
+    QWORD tmTrace = (pProcess->Map.pObVad || !VMMTRACE_IS_ENABLED()) ? 0 : VmmTrace_Start();
+    if(!MmVad_MapInitialize(pProcess, fExtendedText, 0)) {
+        if(tmTrace) { VmmTrace_Event(VMMTRACE_EVENT_MAP_BUILD, pProcess->dwPID, VMMTRACE_MAP_VAD, FALSE, tmTrace); }
+        return FALSE;
+    }
+    if(tmTrace) { VmmTrace_Event(VMMTRACE_EVENT_MAP_BUILD, pProcess->dwPID, VMMTRACE_MAP_VAD, TRUE, tmTrace); }
     *ppObVadMap = Ob_INCREF(pProcess->Map.pObVad);
     return TRUE;
 }
@@ -577,7 +1771,15 @@ int VmmMap_GetVadEntry_CmpFind(_In_ QWORD vaFind, _In_ PVMM_MAP_VADENTRY pEntry)
 */
 PVMM_MAP_VADENTRY VmmMap_GetVadEntry(_In_opt_ PVMMOB_MAP_VAD pVadMap, _In_ QWORD va)
 {
+    DWORD i;
+    PVMM_MAP_VADENTRY pe;
+    PVMMOB_MAP_INDEX pIndex;
     if(!pVadMap) { return NULL; }
+    if((pIndex = VmmMap_Index_Get(&pVadMap->pObIndex, pVadMap->cMap, &pVadMap->pMap[0].vaStart, sizeof(VMM_MAP_VADENTRY)))) {
+        if(!VmmMap_Index_Find(pIndex, va, &i)) { return NULL; }
+        pe = pVadMap->pMap + i;
+        return (va <= pe->vaEnd) ? pe : NULL;
+    }
     return Util_qfind((PVOID)va, pVadMap->cMap, pVadMap->pMap, sizeof(VMM_MAP_VADENTRY), (int(*)(PVOID, PVOID))VmmMap_GetVadEntry_CmpFind);
 }
 
@@ -591,7 +1793,14 @@ PVMM_MAP_VADENTRY VmmMap_GetVadEntry(_In_opt_ PVMMOB_MAP_VAD pVadMap, _In_ QWORD
 _Success_(return)
 BOOL VmmMap_GetModule(_In_ PVMM_PROCESS pProcess, _Out_ PVMMOB_MAP_MODULE *ppObModuleMap)
 {
-    if(!pProcess->Map.pObModule && !VmmWin_InitializeLdrModules(pProcess)) { return FALSE; }
+    BOOL fResult;
+    QWORD tmTrace;
+    if(!pProcess->Map.pObModule) {
+        tmTrace = VMMTRACE_IS_ENABLED() ? VmmTrace_Start() : 0;
+        fResult = VmmWin_InitializeLdrModules(pProcess);
+        if(tmTrace) { VmmTrace_Event(VMMTRACE_EVENT_MAP_BUILD, pProcess->dwPID, VMMTRACE_MAP_MODULE, fResult, tmTrace); }
+        if(!fResult) { return FALSE; }
+    }
     *ppObModuleMap = Ob_INCREF(pProcess->Map.pObModule);
     return TRUE;
 }
@@ -629,22 +1838,27 @@ PVMM_MAP_MODULEENTRY VmmMap_GetModuleEntry(_In_ PVMMOB_MAP_MODULE pModuleMap, _I
 _Success_(return)
 BOOL VmmMap_GetHeap(_In_ PVMM_PROCESS pProcess, _Out_ PVMMOB_MAP_HEAP *ppObHeapMap)
 {
-    if(!pProcess->Map.pObHeap && !VmmWinHeap_Initialize(pProcess)) { return FALSE; }
+    BOOL fResult;
+    QWORD tmTrace;
+    if(!pProcess->Map.pObHeap) {
+        tmTrace = VMMTRACE_IS_ENABLED() ? VmmTrace_Start() : 0;
+        fResult = VmmWinHeap_Initialize(pProcess);
+        if(tmTrace) { VmmTrace_Event(VMMTRACE_EVENT_MAP_BUILD, pProcess->dwPID, VMMTRACE_MAP_HEAP, fResult, tmTrace); }
+        if(!fResult) { return FALSE; }
+    }
     *ppObHeapMap = Ob_INCREF(pProcess->Map.pObHeap);
     return TRUE;
 }
 
 /*
-* LPTHREAD_START_ROUTINE for VmmMap_GetThreadAsync.
+* VmmWorkAsync callback for VmmMap_GetThreadAsync.
 */
-DWORD VmmMap_GetThreadAsync_Thread(_In_ PVMM_PROCESS pProcess)
+VOID VmmMap_GetThreadAsync_ItemCB(_In_ PVMM_PROCESS pProcess, _In_ DWORD iItem)
 {
     if(ctxVmm->ThreadWorkers.fEnabled) {
-        InterlockedIncrement(&ctxVmm->ThreadWorkers.c);
         VmmWinThread_Initialize(pProcess, TRUE);
-        InterlockedDecrement(&ctxVmm->ThreadWorkers.c);
     }
-    return 1;
+    Ob_DECREF(pProcess);
 }
 
 /*
@@ -652,12 +1866,16 @@ DWORD VmmMap_GetThreadAsync_Thread(_In_ PVMM_PROCESS pProcess)
 * retrieval of the thread map in the future since processing to retrieve it
 * has already been progressing for a while. This may be useful for processes
 * with large amount of threads - such as the system process.
+* Only the thread map of the given process is initialized - on the work pool.
 * -- pProcess
 */
 VOID VmmMap_GetThreadAsync(_In_ PVMM_PROCESS pProcess)
 {
-    HANDLE hThread = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)VmmMap_GetThreadAsync_Thread, pProcess, 0, NULL);
-    if(hThread) { CloseHandle(hThread); }
+    if(pProcess->Map.pObThread || !ctxVmm->fThreadMapEnabled) { return; }
+    Ob_INCREF(pProcess);
+    if(!VmmWorkAsync(pProcess, (VOID(*)(PVOID, DWORD))VmmMap_GetThreadAsync_ItemCB)) {
+        Ob_DECREF(pProcess);
+    }
 }
 
 /*
@@ -670,7 +1888,14 @@ VOID VmmMap_GetThreadAsync(_In_ PVMM_PROCESS pProcess)
 _Success_(return)
 BOOL VmmMap_GetThread(_In_ PVMM_PROCESS pProcess, _Out_ PVMMOB_MAP_THREAD *ppObThreadMap)
 {
-    if(!pProcess->Map.pObThread && !VmmWinThread_Initialize(pProcess, FALSE)) { return FALSE; }
+    BOOL fResult;
+    QWORD tmTrace;
+    if(!pProcess->Map.pObThread) {
+        tmTrace = VMMTRACE_IS_ENABLED() ? VmmTrace_Start() : 0;
+        fResult = VmmWinThread_Initialize(pProcess, FALSE);
+        if(tmTrace) { VmmTrace_Event(VMMTRACE_EVENT_MAP_BUILD, pProcess->dwPID, VMMTRACE_MAP_THREAD, fResult, tmTrace); }
+        if(!fResult) { return FALSE; }
+    }
     *ppObThreadMap = Ob_INCREF(pProcess->Map.pObThread);
     return TRUE;
 }
@@ -705,11 +1930,161 @@ PVMM_MAP_THREADENTRY VmmMap_GetThreadEntry(_In_ PVMMOB_MAP_THREAD pThreadMap, _I
 _Success_(return)
 BOOL VmmMap_GetHandle(_In_ PVMM_PROCESS pProcess, _Out_ PVMMOB_MAP_HANDLE *ppObHandleMap, _In_ BOOL fExtendedText)
 {
-    if(!VmmWinHandle_Initialize(pProcess, fExtendedText)) { return FALSE; }
+    QWORD tmTrace = (pProcess->Map.pObHandle || !VMMTRACE_IS_ENABLED()) ? 0 : VmmTrace_Start();
+    if(!VmmWinHandle_Initialize(pProcess, fExtendedText)) {
+        if(tmTrace) { VmmTrace_Event(VMMTRACE_EVENT_MAP_BUILD, pProcess->dwPID, VMMTRACE_MAP_HANDLE, FALSE, tmTrace); }
+        return FALSE;
+    }
+    if(tmTrace) { VmmTrace_Event(VMMTRACE_EVENT_MAP_BUILD, pProcess->dwPID, VMMTRACE_MAP_HANDLE, TRUE, tmTrace); }
     *ppObHandleMap = Ob_INCREF(pProcess->Map.pObHandle);
     return TRUE;
 }
 
+// ----------------------------------------------------------------------------
+// CHANGE NOTIFICATION FUNCTIONALITY:
+// Process tables and map objects carry monotonically increasing generations.
+// Finer grained change events than the total refresh (process create/exit and
+// module/handle map changed) are queued as they are detected by the core and
+// dispatched on the refresh thread to plugins (pfnNotify) and to subscribers.
+// ----------------------------------------------------------------------------
+
+#define VMM_NOTIFY_PENDING_MAX          0x4000
+
+VOID VmmNotify_Post(_In_ DWORD fEvent, _In_ DWORD dwPID)
+{
+    if(ObVSet_Size(ctxVmm->Notify.psPending) < VMM_NOTIFY_PENDING_MAX) {
+        ObVSet_Push(ctxVmm->Notify.psPending, ((QWORD)fEvent << 32) | dwPID);
+    }
+}
+
+QWORD VmmNotify_MapGeneration(_In_ PVMM_PROCESS pProcess, _In_ DWORD fEvent, _Inout_ PVMM_MAP_GENERATION pGeneration, _In_ QWORD qwHash)
+{
+    QWORD qwHashPrev, qwGeneration;
+    // the persistent object is shared with the process object of the previous
+    // refresh - which is locked by its own LockUpdate - use a dedicated lock.
+    AcquireSRWLockExclusive(&pProcess->pObPersistent->MapGeneration.LockSRW);
+    qwHashPrev = pGeneration->qwHash;
+    if(!qwHashPrev || (qwHashPrev != qwHash)) {
+        pGeneration->qwGeneration = VmmGenerationNext();
+        pGeneration->qwHash = qwHash;
+    }
+    qwGeneration = pGeneration->qwGeneration;
+    ReleaseSRWLockExclusive(&pProcess->pObPersistent->MapGeneration.LockSRW);
+    if(qwHashPrev && (qwHashPrev != qwHash)) {
+        VmmNotify_Post(fEvent, pProcess->dwPID);
+    }
+    return qwGeneration;
+}
+
+int VmmNotify_CmpSort(_In_ PQWORD pqw1, _In_ PQWORD pqw2)
+{
+    return
+        (*pqw1 < *pqw2) ? -1 :
+        (*pqw1 > *pqw2) ? 1 : 0;
+}
+
+VOID VmmNotify_Dispatch()
+{
+    QWORD qw;
+    PQWORD pqwEvents;
+    DWORD i, iSub, iCur, c, cMax, cSub, fEvent;
+    BOOL fSubscribed;
+    PVMM_PROCESS pObProcess;
+    PVMMOB_PROCESS_TABLE pObPT;
+    VMMDLL_PLUGIN_NOTIFY_PROCESS e;
+    PVMM_NOTIFY_SUBSCRIPTION pSub;
+    VMM_NOTIFY_SUBSCRIPTION Sub[VMM_NOTIFY_SUBSCRIPTIONS_MAX];
+    if(!(cMax = ObVSet_Size(ctxVmm->Notify.psPending))) { return; }
+    if(!(pqwEvents = LocalAlloc(0, cMax * sizeof(QWORD)))) { return; }
+    for(c = 0; (c < cMax) && (qw = ObVSet_Pop(ctxVmm->Notify.psPending)); c++) {
+        pqwEvents[c] = qw;
+    }
+    // sort by event (terminate before create) - then by pid.
+    qsort(pqwEvents, c, sizeof(QWORD), (int(*)(const void*, const void*))VmmNotify_CmpSort);
+    pObPT = (PVMMOB_PROCESS_TABLE)ObContainer_GetOb(ctxVmm->pObCPROC);
+    // snapshot the subscriptions - callbacks are called without the lock held
+    // so that they may (un)subscribe. VmmNotify_Unsubscribe waits for the
+    // dispatch to complete (dwDispatchTID) unless called from a callback.
+    AcquireSRWLockExclusive(&ctxVmm->Notify.LockSRW);
+    ctxVmm->Notify.dwDispatchTID = GetCurrentThreadId();
+    cSub = ctxVmm->Notify.cSubscription;
+    memcpy(Sub, ctxVmm->Notify.Subscription, cSub * sizeof(VMM_NOTIFY_SUBSCRIPTION));
+    ReleaseSRWLockExclusive(&ctxVmm->Notify.LockSRW);
+    for(i = 0; i < c; i++) {
+        fEvent = (DWORD)(pqwEvents[i] >> 32);
+        ZeroMemory(&e, sizeof(VMMDLL_PLUGIN_NOTIFY_PROCESS));
+        e.dwPID = (DWORD)pqwEvents[i];
+        e.qwGeneration = pObPT ? pObPT->qwGeneration : 0;
+        if((fEvent & (VMM_NOTIFY_MAP_MODULE | VMM_NOTIFY_MAP_HANDLE)) && (pObProcess = VmmProcessGet(e.dwPID))) {
+            AcquireSRWLockShared(&pObProcess->pObPersistent->MapGeneration.LockSRW);
+            e.qwGeneration = (fEvent == VMM_NOTIFY_MAP_MODULE) ?
+                pObProcess->pObPersistent->MapGeneration.Module.qwGeneration :
+                pObProcess->pObPersistent->MapGeneration.Handle.qwGeneration;
+            ReleaseSRWLockShared(&pObProcess->pObPersistent->MapGeneration.LockSRW);
+            Ob_DECREF(pObProcess);
+        }
+        PluginManager_Notify(fEvent, &e, sizeof(VMMDLL_PLUGIN_NOTIFY_PROCESS));
+        for(iSub = 0; iSub < cSub; iSub++) {
+            pSub = &Sub[iSub];
+            if(!(pSub->fEventMask & fEvent)) { continue; }
+            // skip subscriptions removed by an earlier callback of this dispatch.
+            AcquireSRWLockShared(&ctxVmm->Notify.LockSRW);
+            for(iCur = 0, fSubscribed = FALSE; !fSubscribed && (iCur < ctxVmm->Notify.cSubscription); iCur++) {
+                fSubscribed = (ctxVmm->Notify.Subscription[iCur].pfnCB == pSub->pfnCB) && (ctxVmm->Notify.Subscription[iCur].ctx == pSub->ctx);
+            }
+            ReleaseSRWLockShared(&ctxVmm->Notify.LockSRW);
+            if(fSubscribed) {
+                pSub->pfnCB(pSub->ctx, fEvent, &e, sizeof(VMMDLL_PLUGIN_NOTIFY_PROCESS));
+            }
+        }
+    }
+    ctxVmm->Notify.dwDispatchTID = 0;
+    Ob_DECREF(pObPT);
+    LocalFree(pqwEvents);
+}
+
+_Success_(return)
+BOOL VmmNotify_Subscribe(_In_ DWORD fEventMask, _In_ VOID(*pfnCB)(_In_opt_ PVOID ctx, _In_ DWORD fEvent, _In_opt_ PVOID pvEvent, _In_opt_ DWORD cbEvent), _In_opt_ PVOID ctx)
+{
+    BOOL fResult = FALSE;
+    PVMM_NOTIFY_SUBSCRIPTION pSub;
+    if(!pfnCB || !(fEventMask & VMM_NOTIFY_MASK)) { return FALSE; }
+    AcquireSRWLockExclusive(&ctxVmm->Notify.LockSRW);
+    if(ctxVmm->Notify.cSubscription < VMM_NOTIFY_SUBSCRIPTIONS_MAX) {
+        pSub = &ctxVmm->Notify.Subscription[ctxVmm->Notify.cSubscription];
+        pSub->fEventMask = fEventMask & VMM_NOTIFY_MASK;
+        pSub->ctx = ctx;
+        pSub->pfnCB = pfnCB;
+        ctxVmm->Notify.cSubscription++;
+        fResult = TRUE;
+    }
+    ReleaseSRWLockExclusive(&ctxVmm->Notify.LockSRW);
+    return fResult;
+}
+
+_Success_(return)
+BOOL VmmNotify_Unsubscribe(_In_ VOID(*pfnCB)(_In_opt_ PVOID ctx, _In_ DWORD fEvent, _In_opt_ PVOID pvEvent, _In_opt_ DWORD cbEvent), _In_opt_ PVOID ctx)
+{
+    DWORD i, dwTID;
+    BOOL fResult = FALSE;
+    AcquireSRWLockExclusive(&ctxVmm->Notify.LockSRW);
+    for(i = 0; i < ctxVmm->Notify.cSubscription; i++) {
+        if((ctxVmm->Notify.Subscription[i].pfnCB == pfnCB) && (ctxVmm->Notify.Subscription[i].ctx == ctx)) {
+            ctxVmm->Notify.cSubscription--;
+            ctxVmm->Notify.Subscription[i] = ctxVmm->Notify.Subscription[ctxVmm->Notify.cSubscription];
+            fResult = TRUE;
+            break;
+        }
+    }
+    ReleaseSRWLockExclusive(&ctxVmm->Notify.LockSRW);
+    // wait for an ongoing dispatch (which may hold a snapshot of the removed
+    // subscription) to complete - unless called from one of its callbacks.
+    while(fResult && (dwTID = ctxVmm->Notify.dwDispatchTID) && (dwTID != GetCurrentThreadId())) {
+        SwitchToThread();
+    }
+    return fResult;
+}
+
 // ----------------------------------------------------------------------------
 // PROCESS MANAGEMENT FUNCTIONALITY:
 //
@@ -731,12 +2106,44 @@ BOOL VmmMap_GetHandle(_In_ PVMM_PROCESS pProcess, _Out_ PVMMOB_MAP_HANDLE *ppObH
 // Once all processes are enumerated the function 'VmmProcessCreateFinish' is
 // called and replaces the 'old' table with the 'new' table which becomes the
 // active table. The 'old' replaced table is refcount-decreased and possibly
-// free'd as a result.
+// free'd as a result. On a partial refresh unchanged processes are shared
+// between the tables and if no process differs the 'old' table is retained.
+// The table is sized dynamically from the number of processes in the 'old'
+// table and grows, while not yet committed, if more processes are added.
+// Processes are kept in a contiguous array in insertion order which is used
+// for iteration; PID lookups use an open addressing hash index into it.
 //
 // The process object: VMM_PROCESS
 // The process table object (only used internally): VMMOB_PROCESS_TABLE
 // ----------------------------------------------------------------------------
 
+/*
+* Retrieve the index of a given PID in a PVMMOB_PROCESS_TABLE.
+* -- pt
+* -- dwPID
+* -- return = the index into pt->_M, or VMM_PROCESSTABLE_INDEX_NONE if not found.
+*/
+DWORD VmmProcessTable_Find(_In_ PVMMOB_PROCESS_TABLE pt, _In_ DWORD dwPID)
+{
+    return PidHash_Find(&pt->_Hash, dwPID);
+}
+
+/*
+* Insert a process into a PVMMOB_PROCESS_TABLE. The table takes ownership of
+* the callers pProcess reference on success. The PID must not already exist.
+* -- pt
+* -- pProcess
+* -- return
+*/
+_Success_(return)
+BOOL VmmProcessTable_Insert(_In_ PVMMOB_PROCESS_TABLE pt, _In_ PVMM_PROCESS pProcess)
+{
+    if(PidHash_Insert(&pt->_Hash, pProcess->dwPID) == PIDHASH_INDEX_NONE) { return FALSE; }
+    pt->_M[pt->c++] = pProcess;
+    pt->cActive += (pProcess->dwState == 0) ? 1 : 0;
+    return TRUE;
+}
+
 /*
 * Retrieve pProcess for a given PVMMOB_PROCESS_TABLE.
 * CALLER DECREF: return
@@ -746,16 +2153,8 @@ BOOL VmmMap_GetHandle(_In_ PVMM_PROCESS pProcess, _Out_ PVMMOB_MAP_HANDLE *ppObH
 */
 PVMM_PROCESS VmmProcessGetEx(_In_ PVMMOB_PROCESS_TABLE pt, _In_ DWORD dwPID)
 {
-    DWORD i, iStart;
-    i = iStart = dwPID % VMM_PROCESSTABLE_ENTRIES_MAX;
-    while(TRUE) {
-        if(!pt->_M[i]) { return NULL; }
-        if(pt->_M[i]->dwPID == dwPID) {
-            return (PVMM_PROCESS)Ob_INCREF(pt->_M[i]);
-        }
-        if(++i == VMM_PROCESSTABLE_ENTRIES_MAX) { i = 0; }
-        if(i == iStart) { return NULL; }
-    }
+    DWORD i = VmmProcessTable_Find(pt, dwPID);
+    return (i == VMM_PROCESSTABLE_INDEX_NONE) ? NULL : (PVMM_PROCESS)Ob_INCREF(pt->_M[i]);
 }
 
 /*
@@ -790,7 +2189,7 @@ PVMM_PROCESS VmmProcessGetNextEx(_In_opt_ PVMMOB_PROCESS_TABLE pt, _In_opt_ PVMM
 {
     BOOL fShowTerminated = ((flags | ctxVmm->flags) & VMM_FLAG_PROCESS_SHOW_TERMINATED);
     PVMM_PROCESS pProcessNew;
-    DWORD i, iStart;
+    DWORD i;
     if(!pt) {
         pt = (PVMMOB_PROCESS_TABLE)ObContainer_GetOb(ctxVmm->pObCPROC);
         if(!pt) { goto fail; }
@@ -800,30 +2199,19 @@ PVMM_PROCESS VmmProcessGetNextEx(_In_opt_ PVMMOB_PROCESS_TABLE pt, _In_opt_ PVMM
     }
 restart:
     if(!pProcess) {
-        i = pt->_iFLink;
-        if(!pt->_M[i]) { goto fail; }
-        pProcessNew = (PVMM_PROCESS)Ob_INCREF(pt->_M[i]);
-        Ob_DECREF(pProcess);
-        pProcess = pProcessNew;
-        if(pProcess && pProcess->dwState && !fShowTerminated) { goto restart; }
-        return pProcess;
-    }
-    i = iStart = pProcess->dwPID % VMM_PROCESSTABLE_ENTRIES_MAX;
-    while(TRUE) {
-        if(!pt->_M[i]) { goto fail; }
-        if(pt->_M[i]->dwPID == pProcess->dwPID) {
-            // current process -> retrieve next!
-            i = pt->_iFLinkM[i];
-            if(!pt->_M[i]) { goto fail; }
-            pProcessNew = (PVMM_PROCESS)Ob_INCREF(pt->_M[i]);
-            Ob_DECREF(pProcess);
-            pProcess = pProcessNew;
-            if(pProcess && pProcess->dwState && !fShowTerminated) { goto restart; }
-            return pProcess;
-        }
-        if(++i == VMM_PROCESSTABLE_ENTRIES_MAX) { i = 0; }
-        if(i == iStart) { goto fail; }
+        i = 0;
+    } else {
+        // current process -> retrieve next!
+        i = VmmProcessTable_Find(pt, pProcess->dwPID);
+        if(i == VMM_PROCESSTABLE_INDEX_NONE) { goto fail; }
+        i++;
     }
+    if(i >= pt->c) { goto fail; }
+    pProcessNew = (PVMM_PROCESS)Ob_INCREF(pt->_M[i]);
+    Ob_DECREF(pProcess);
+    pProcess = pProcessNew;
+    if(pProcess && pProcess->dwState && !fShowTerminated) { goto restart; }
+    return pProcess;
 fail:
     Ob_DECREF(pProcess);
     return NULL;
@@ -840,6 +2228,8 @@ VOID VmmProcessStatic_CloseObCallback(_In_ PVOID pVmmOb)
     Ob_DECREF_NULL(&pProcessStatic->pObCLdrModulesPrefetch32);
     Ob_DECREF_NULL(&pProcessStatic->pObCLdrModulesPrefetch64);
     Ob_DECREF_NULL(&pProcessStatic->pObCMapThreadPrefetch);
+    Ob_DECREF_NULL(&pProcessStatic->pObCMapThreadPrevious);
+    Ob_DECREF_NULL(&pProcessStatic->pObCMapPteCache);
     LocalFree(pProcessStatic->UserProcessParams.szCommandLine);
     LocalFree(pProcessStatic->UserProcessParams.szImagePathName);
 }
@@ -858,6 +2248,9 @@ VOID VmmProcessStatic_Initialize(_In_ PVMM_PROCESS pProcess)
         pProcess->pObPersistent->pObCLdrModulesPrefetch32 = ObContainer_New(NULL);
         pProcess->pObPersistent->pObCLdrModulesPrefetch64 = ObContainer_New(NULL);
         pProcess->pObPersistent->pObCMapThreadPrefetch = ObContainer_New(NULL);
+        pProcess->pObPersistent->pObCMapThreadPrevious = ObContainer_New(NULL);
+        pProcess->pObPersistent->pObCMapPteCache = ObContainer_New(NULL);
+        InitializeSRWLock(&pProcess->pObPersistent->MapGeneration.LockSRW);
     }
     LeaveCriticalSection(&pProcess->LockUpdate);
 }
@@ -881,6 +2274,7 @@ VOID VmmProcess_CloseObCallback(_In_ PVOID pVmmOb)
     Ob_DECREF(pProcess->Plugin.pObCLdrModulesDisplayCache);
     Ob_DECREF(pProcess->Plugin.pObCPeDumpDirCache);
     Ob_DECREF(pProcess->Plugin.pObCPhys2Virt);
+    Ob_DECREF(pProcess->Plugin.pmObPeFileRawLayout);
     // delete lock
     DeleteCriticalSection(&pProcess->LockUpdate);
     DeleteCriticalSection(&pProcess->Map.LockUpdateThreadMap);
@@ -894,19 +2288,84 @@ VOID VmmProcess_CloseObCallback(_In_ PVOID pVmmOb)
 VOID VmmProcessTable_CloseObCallback(_In_ PVOID pVmmOb)
 {
     PVMMOB_PROCESS_TABLE pt = (PVMMOB_PROCESS_TABLE)pVmmOb;
-    PVMM_PROCESS pProcess;
-    WORD iProcess;
+    SIZE_T iProcess;
     // Close NewPROC
     Ob_DECREF_NULL(&pt->pObCNewPROC);
     // DECREF all pProcess in table
-    iProcess = pt->_iFLink;
-    pProcess = pt->_M[iProcess];
-    while(pProcess) {
-        Ob_DECREF(pProcess);
-        iProcess = pt->_iFLinkM[iProcess];
-        pProcess = pt->_M[iProcess];
-        if(!pProcess || iProcess == pt->_iFLink) { break; }
+    for(iProcess = 0; iProcess < pt->c; iProcess++) {
+        Ob_DECREF(pt->_M[iProcess]);
+    }
+}
+
+/*
+* Allocate a new empty process table. The process array and the PID hash
+* index are allocated together with the table object. The process array is
+* sized to hold the expected number of processes with some headroom, the hash
+* index is twice the size of the process array to keep its load factor below
+* 50%.
+* CALLER DECREF: return
+* -- cProcessHint = expected number of processes in table.
+* -- return
+*/
+PVMMOB_PROCESS_TABLE VmmProcessTable_New(_In_ SIZE_T cProcessHint)
+{
+    PVMMOB_PROCESS_TABLE pt;
+    DWORD cMax = VMM_PROCESSTABLE_ENTRIES_MIN;
+    while((cMax < VMM_PROCESSTABLE_ENTRIES_MAX) && (cMax < cProcessHint + (cProcessHint >> 2))) {
+        cMax <<= 1;
+    }
+    pt = (PVMMOB_PROCESS_TABLE)Ob_Alloc(OB_TAG_VMM_PROCESSTABLE, LMEM_ZEROINIT, sizeof(VMMOB_PROCESS_TABLE) + cMax * sizeof(PVMM_PROCESS) + PidHash_Size(cMax), VmmProcessTable_CloseObCallback, NULL);
+    if(!pt) { return NULL; }
+    pt->cMax = cMax;
+    pt->_M = (PVMM_PROCESS*)(pt + 1);
+    PidHash_Initialize(&pt->_Hash, cMax, (PBYTE)(pt->_M + cMax));
+    if(!(pt->pObCNewPROC = ObContainer_New(NULL))) {
+        Ob_DECREF(pt);
+        return NULL;
+    }
+    return pt;
+}
+
+/*
+* Grow a not yet committed 'new' process table by re-inserting its processes,
+* in order, into a table with double the capacity. The grown table replaces
+* the 'new' table in the 'old' table container.
+* CALLER DECREF: return
+* -- ptOld = the currently active process table.
+* -- ptNew = the 'new' process table to grow.
+* -- return = the grown table, or NULL on fail.
+*/
+PVMMOB_PROCESS_TABLE VmmProcessTable_Grow(_In_ PVMMOB_PROCESS_TABLE ptOld, _In_ PVMMOB_PROCESS_TABLE ptNew)
+{
+    PVMMOB_PROCESS_TABLE ptGrow;
+    SIZE_T iProcess;
+    if(!(ptGrow = VmmProcessTable_New(ptNew->cMax))) { return NULL; }
+    for(iProcess = 0; iProcess < ptNew->c; iProcess++) {
+        VmmProcessTable_Insert(ptGrow, (PVMM_PROCESS)Ob_INCREF(ptNew->_M[iProcess]));
     }
+    ObContainer_SetOb(ptOld->pObCNewPROC, ptGrow);
+    return ptGrow;
+}
+
+/*
+* Check whether an existing process object may be shared as-is with the 'new'
+* table on a partial refresh, i.e. check that the process is unchanged.
+* -- pProcess
+* -- dwPPID
+* -- dwState
+* -- paDTB
+* -- paDTB_UserOpt
+* -- szName
+* -- return
+*/
+BOOL VmmProcess_IsUnchanged(_In_ PVMM_PROCESS pProcess, _In_ DWORD dwPPID, _In_ DWORD dwState, _In_ QWORD paDTB, _In_ QWORD paDTB_UserOpt, _In_ CHAR szName[16])
+{
+    return
+        (pProcess->dwPPID == dwPPID) &&
+        (pProcess->dwState == dwState) &&
+        (pProcess->paDTB == paDTB) &&
+        (pProcess->paDTB_UserOpt == paDTB_UserOpt) &&
+        !memcmp(pProcess->szName, szName, 15);
 }
 
 /*
@@ -916,6 +2375,7 @@ VOID VmmProcessTable_CloseObCallback(_In_ PVOID pVmmOb)
 * CALLER DECREF: return
 * -- fTotalRefresh = create a completely new entry - i.e. do not copy any form
 *                    of data from the old entry such as module and memory maps.
+*                    If FALSE an unchanged old entry is shared with the new table.
 * -- dwPID
 * -- dwPPID = parent PID (if any)
 * -- dwState
@@ -929,8 +2389,7 @@ VOID VmmProcessTable_CloseObCallback(_In_ PVOID pVmmOb)
 */
 PVMM_PROCESS VmmProcessCreateEntry(_In_ BOOL fTotalRefresh, _In_ DWORD dwPID, _In_ DWORD dwPPID, _In_ DWORD dwState, _In_ QWORD paDTB, _In_ QWORD paDTB_UserOpt, _In_ CHAR szName[16], _In_ BOOL fUserOnly, _In_reads_opt_(cbEPROCESS) PBYTE pbEPROCESS, _In_ DWORD cbEPROCESS)
 {
-    PVMMOB_PROCESS_TABLE ptOld = NULL, ptNew = NULL;
-    QWORD i, iStart, cEmpty = 0, cValid = 0;
+    PVMMOB_PROCESS_TABLE ptOld = NULL, ptNew = NULL, ptGrow;
     PVMM_PROCESS pProcess = NULL, pProcessOld = NULL;
     PVMMOB_MEM pObDTB = NULL;
     BOOL result;
@@ -947,17 +2406,16 @@ PVMM_PROCESS VmmProcessCreateEntry(_In_ BOOL fTotalRefresh, _In_ DWORD dwPID, _I
     if(!ptOld) { goto fail; }
     ptNew = (PVMMOB_PROCESS_TABLE)ObContainer_GetOb(ptOld->pObCNewPROC);
     if(!ptNew) {
-        ptNew = (PVMMOB_PROCESS_TABLE)Ob_Alloc(OB_TAG_VMM_PROCESSTABLE, LMEM_ZEROINIT, sizeof(VMMOB_PROCESS_TABLE), VmmProcessTable_CloseObCallback, NULL);
-        if(!ptNew) { goto fail; }
-        ptNew->pObCNewPROC = ObContainer_New(NULL);
+        if(!(ptNew = VmmProcessTable_New(ptOld->c))) { goto fail; }
         ObContainer_SetOb(ptOld->pObCNewPROC, ptNew);
     }
     // 3: Sanity check - process to create not already in 'new' table.
-    pProcess = VmmProcessGetEx(ptNew, dwPID);
-    if(pProcess) { goto fail; }
-    // 4: Prepare existing item, or create new item, for new PID
-    if(!fTotalRefresh) {
-        pProcess = VmmProcessGetEx(ptOld, dwPID);
+    if(VmmProcessTable_Find(ptNew, dwPID) != VMM_PROCESSTABLE_INDEX_NONE) { goto fail; }
+    // 4: Share existing unchanged item, or create new item, for new PID
+    pProcessOld = VmmProcessGetEx(ptOld, dwPID);
+    if(pProcessOld && !fTotalRefresh && VmmProcess_IsUnchanged(pProcessOld, dwPPID, dwState, paDTB, paDTB_UserOpt, szName)) {
+        pProcess = pProcessOld;
+        pProcessOld = NULL;
     }
     if(!pProcess) {
         pProcess = (PVMM_PROCESS)Ob_Alloc(OB_TAG_VMM_PROCESS, LMEM_ZEROINIT, sizeof(VMM_PROCESS), VmmProcess_CloseObCallback, NULL);
@@ -977,47 +2435,95 @@ PVMM_PROCESS VmmProcessCreateEntry(_In_ BOOL fTotalRefresh, _In_ DWORD dwPID, _I
         pProcess->Plugin.pObCLdrModulesDisplayCache = ObContainer_New(NULL);
         pProcess->Plugin.pObCPeDumpDirCache = ObContainer_New(NULL);
         pProcess->Plugin.pObCPhys2Virt = ObContainer_New(NULL);
+        pProcess->Plugin.pmObPeFileRawLayout = ObMap_New(OB_MAP_FLAGS_OBJECT_OB);
         if(pbEPROCESS && cbEPROCESS) {
             pProcess->win.EPROCESS.cb = min(sizeof(pProcess->win.EPROCESS.pb), cbEPROCESS);
             memcpy(pProcess->win.EPROCESS.pb, pbEPROCESS, pProcess->win.EPROCESS.cb);
         }
-        // attach pre-existing static process info entry or create new
-        pProcessOld = VmmProcessGet(dwPID);
-        if(pProcessOld) {
+        // attach pre-existing static process info entry (if same process) or create new
+        if(pProcessOld && (pProcessOld->paDTB == paDTB)) {
             pProcess->pObPersistent = (PVMMOB_PROCESS_PERSISTENT)Ob_INCREF(pProcessOld->pObPersistent);
         } else {
             VmmProcessStatic_Initialize(pProcess);
         }
-        Ob_DECREF(pProcessOld);
-        pProcessOld = NULL;
     }
-    // 5: Install new PID
-    i = iStart = dwPID % VMM_PROCESSTABLE_ENTRIES_MAX;
-    while(TRUE) {
-        if(!ptNew->_M[i]) {
-            ptNew->_M[i] = pProcess;
-            ptNew->_iFLinkM[i] = ptNew->_iFLink;
-            ptNew->_iFLink = (WORD)i;
-            ptNew->c++;
-            ptNew->cActive += (pProcess->dwState == 0) ? 1 : 0;
-            Ob_DECREF(ptOld);
+    Ob_DECREF_NULL(&pProcessOld);
+    // 5: Grow 'new' table if required
+    if((ptNew->c == ptNew->cMax) && (ptNew->cMax < VMM_PROCESSTABLE_ENTRIES_MAX)) {
+        if((ptGrow = VmmProcessTable_Grow(ptOld, ptNew))) {
             Ob_DECREF(ptNew);
-            // pProcess already "consumed" by table insertion so increase before returning ... 
-            return (PVMM_PROCESS)Ob_INCREF(pProcess);
+            ptNew = ptGrow;
         }
-        if(++i == VMM_PROCESSTABLE_ENTRIES_MAX) { i = 0; }
-        if(i == iStart) { goto fail; }
     }
+    // 6: Install new PID
+    if(!VmmProcessTable_Insert(ptNew, pProcess)) { goto fail; }
+    Ob_DECREF(ptOld);
+    Ob_DECREF(ptNew);
+    // pProcess already "consumed" by table insertion so increase before returning ... 
+    return (PVMM_PROCESS)Ob_INCREF(pProcess);
 fail:
+    Ob_DECREF(pProcessOld);
     Ob_DECREF(pProcess);
     Ob_DECREF(ptOld);
     Ob_DECREF(ptNew);
     return NULL;
 }
 
+/*
+* Check whether two process tables contain the exact same process objects.
+* -- pt1
+* -- pt2
+* -- return
+*/
+BOOL VmmProcessTable_IsEqual(_In_ PVMMOB_PROCESS_TABLE pt1, _In_ PVMMOB_PROCESS_TABLE pt2)
+{
+    SIZE_T iProcess;
+    DWORD iProcess1;
+    if((pt1->c != pt2->c) || (pt1->cActive != pt2->cActive)) { return FALSE; }
+    for(iProcess = 0; iProcess < pt2->c; iProcess++) {
+        iProcess1 = VmmProcessTable_Find(pt1, pt2->_M[iProcess]->dwPID);
+        if((iProcess1 == VMM_PROCESSTABLE_INDEX_NONE) || (pt1->_M[iProcess1] != pt2->_M[iProcess])) { return FALSE; }
+    }
+    return TRUE;
+}
+
+/*
+* Queue process create/terminate change notifications for the difference in
+* active processes between the old and the about to be published new table.
+* A re-used PID with a new DTB is reported as both terminated and created.
+* -- ptOld
+* -- ptNew
+*/
+VOID VmmProcessCreateFinish_Notify(_In_ PVMMOB_PROCESS_TABLE ptOld, _In_ PVMMOB_PROCESS_TABLE ptNew)
+{
+    SIZE_T iProcess;
+    DWORD iOther;
+    PVMM_PROCESS pProcess;
+    if(!ptOld->c) { return; }   // initial process table population - not an event
+    for(iProcess = 0; iProcess < ptNew->c; iProcess++) {
+        pProcess = ptNew->_M[iProcess];
+        if(pProcess->dwState) { continue; }
+        iOther = VmmProcessTable_Find(ptOld, pProcess->dwPID);
+        if((iOther == VMM_PROCESSTABLE_INDEX_NONE) || ptOld->_M[iOther]->dwState || (ptOld->_M[iOther]->paDTB != pProcess->paDTB)) {
+            VmmNotify_Post(VMM_NOTIFY_PROCESS_CREATE, pProcess->dwPID);
+        }
+    }
+    for(iProcess = 0; iProcess < ptOld->c; iProcess++) {
+        pProcess = ptOld->_M[iProcess];
+        if(pProcess->dwState) { continue; }
+        iOther = VmmProcessTable_Find(ptNew, pProcess->dwPID);
+        if((iOther == VMM_PROCESSTABLE_INDEX_NONE) || ptNew->_M[iOther]->dwState || (ptNew->_M[iOther]->paDTB != pProcess->paDTB)) {
+            VmmNotify_Post(VMM_NOTIFY_PROCESS_TERMINATE, pProcess->dwPID);
+        }
+    }
+}
+
 /*
 * Activate the pending, not yet active, processes added by VmmProcessCreateEntry.
-* This will also clear any previous processes.
+* This will also clear any previous processes. If the pending processes are all
+* shared unchanged with the active table the active table is retained as-is.
+* A published table is assigned a new generation and process create/terminate
+* change notifications are queued.
 */
 VOID VmmProcessCreateFinish()
 {
@@ -1029,7 +2535,16 @@ VOID VmmProcessCreateFinish()
         Ob_DECREF(ptOld);
         return;
     }
+    if(VmmProcessTable_IsEqual(ptOld, ptNew)) {
+        // Nothing changed - discard "new" process table and keep existing.
+        ObContainer_SetOb(ptOld->pObCNewPROC, NULL);
+        Ob_DECREF(ptNew);
+        Ob_DECREF(ptOld);
+        return;
+    }
     // Replace "existing" old process table with new.
+    VmmProcessCreateFinish_Notify(ptOld, ptNew);
+    ptNew->qwGeneration = VmmGenerationNext();
     ObContainer_SetOb(ctxVmm->pObCPROC, ptNew);
     Ob_DECREF(ptNew);
     Ob_DECREF(ptOld);
@@ -1041,16 +2556,10 @@ VOID VmmProcessCreateFinish()
 VOID VmmProcessTlbClear()
 {
     PVMMOB_PROCESS_TABLE pt = (PVMMOB_PROCESS_TABLE)ObContainer_GetOb(ctxVmm->pObCPROC);
-    PVMM_PROCESS pProcess;
-    WORD iProcess;
+    SIZE_T iProcess;
     if(!pt) { return; }
-    iProcess = pt->_iFLink;
-    pProcess = pt->_M[iProcess];
-    while(pProcess) {
-        pProcess->fTlbSpiderDone = FALSE;
-        iProcess = pt->_iFLinkM[iProcess];
-        pProcess = pt->_M[iProcess];
-        if(!pProcess || iProcess == pt->_iFLink) { break; }
+    for(iProcess = 0; iProcess < pt->c; iProcess++) {
+        pt->_M[iProcess]->fTlbSpiderDone = FALSE;
     }
     Ob_DECREF(pt);
 }
@@ -1066,7 +2575,7 @@ VOID VmmProcessListPIDs(_Out_writes_opt_(*pcPIDs) PDWORD pPIDs, _Inout_ PSIZE_T
     PVMMOB_PROCESS_TABLE pt = (PVMMOB_PROCESS_TABLE)ObContainer_GetOb(ctxVmm->pObCPROC);
     BOOL fShowTerminated = ((flags | ctxVmm->flags) & VMM_FLAG_PROCESS_SHOW_TERMINATED);
     PVMM_PROCESS pProcess;
-    WORD iProcess;
+    SIZE_T iProcess;
     DWORD i = 0;
     if(!pPIDs) {
         *pcPIDs = fShowTerminated ? pt->c : pt->cActive;
@@ -1079,16 +2588,12 @@ VOID VmmProcessListPIDs(_Out_writes_opt_(*pcPIDs) PDWORD pPIDs, _Inout_ PSIZE_T
         return;
     }
     // copy all PIDs
-    iProcess = pt->_iFLink;
-    pProcess = pt->_M[iProcess];
-    while(pProcess) {
+    for(iProcess = 0; iProcess < pt->c; iProcess++) {
+        pProcess = pt->_M[iProcess];
         if(!pProcess->dwState || fShowTerminated) {
             *(pPIDs + i) = pProcess->dwPID;
             i++;
         }
-        iProcess = pt->_iFLinkM[iProcess];
-        pProcess = pt->_M[iProcess];
-        if(!pProcess || (iProcess == pt->_iFLink)) { break; }
     }
     *pcPIDs = i;
     Ob_DECREF(pt);
@@ -1099,48 +2604,218 @@ VOID VmmProcessListPIDs(_Out_writes_opt_(*pcPIDs) PDWORD pPIDs, _Inout_ PSIZE_T
 */
 BOOL VmmProcessTableCreateInitial()
 {
-    PVMMOB_PROCESS_TABLE pt = (PVMMOB_PROCESS_TABLE)Ob_Alloc(OB_TAG_VMM_PROCESSTABLE, LMEM_ZEROINIT, sizeof(VMMOB_PROCESS_TABLE), VmmProcessTable_CloseObCallback, NULL);
+    PVMMOB_PROCESS_TABLE pt = VmmProcessTable_New(0);
     if(!pt) { return FALSE; }
-    pt->pObCNewPROC = ObContainer_New(NULL);
+    pt->qwGeneration = VmmGenerationNext();
     ctxVmm->pObCPROC = ObContainer_New(pt);
     Ob_DECREF(pt);
     return TRUE;
 }
 
 // ----------------------------------------------------------------------------
-// PROCESS PARALLELIZATION FUNCTIONALITY:
+// WORK POOL FUNCTIONALITY:
+// The work pool consists of persistent threads (sized to the processor core
+// count) which are started on first use and live until the vmm is closed.
+// Parallel work is submitted as jobs of individually scheduled items. Idle
+// pool threads attach to the oldest job with unclaimed items and claim items
+// one at a time; the submitting thread claims items of its own job as well.
 // ----------------------------------------------------------------------------
 
-#define VMM_PROCESS_ACTION_FOREACH_THREADS_PARALLEL     0x00c
+/*
+* Claim and execute items of a job until no unclaimed items remain.
+* -- pJob
+*/
+VOID VmmWork_ExecuteJob(_In_ PVMM_WORK_JOB pJob)
+{
+    DWORD i;
+    while((i = (DWORD)InterlockedIncrement(&pJob->iItemNext) - 1) < pJob->cItems) {
+        if(ctxVmm->ThreadWorkers.fEnabled) {
+            pJob->pfnItem(pJob->ctx, i);
+        }
+        if(0 == InterlockedDecrement(&pJob->cItemsRemaining)) {
+            SetEvent(pJob->hEventDone);
+        }
+    }
+}
+
+/*
+* Work pool thread main loop. Attach to the oldest queued job with unclaimed
+* items, execute items and detach. If no such job exists wait for new work.
+*/
+DWORD VmmWork_ThreadProc(_In_ LPVOID lpThreadParameter)
+{
+    PVMM_WORK_JOB pJob, *ppJob;
+    while(TRUE) {
+        WaitForSingleObject(ctxVmm->WorkPool.hEventWork, INFINITE);
+        if(ctxVmm->WorkPool.fTerminate) { break; }
+        EnterCriticalSection(&ctxVmm->WorkPool.Lock);
+        ppJob = &ctxVmm->WorkPool.pJobs;
+        while(*ppJob && ((*ppJob)->iItemNext >= (LONG)(*ppJob)->cItems)) {
+            ppJob = &(*ppJob)->FLink;
+        }
+        if((pJob = *ppJob)) {
+            if(pJob->fAsync) {
+                // async job: claim and dequeue - owned by this thread from now on.
+                pJob->iItemNext = 1;
+                *ppJob = pJob->FLink;
+            } else {
+                InterlockedIncrement(&pJob->cWorkers);
+            }
+        } else {
+            ResetEvent(ctxVmm->WorkPool.hEventWork);
+        }
+        LeaveCriticalSection(&ctxVmm->WorkPool.Lock);
+        if(pJob && pJob->fAsync) {
+            pJob->pfnItem(pJob->ctx, 0);
+            LocalFree(pJob);
+            InterlockedDecrement(&ctxVmm->ThreadWorkers.c);
+        } else if(pJob) {
+            VmmWork_ExecuteJob(pJob);
+            InterlockedDecrement(&pJob->cWorkers);      // NB! last access to pJob.
+        }
+    }
+    return 1;
+}
 
-typedef struct tdVMMOB_PROCESS_ACTION_FOREACH {
-    OB ObHdr;
-    DWORD Reserved;
-    DWORD cProcess;
-    HANDLE hSemaphore;
-    VOID(*pfnAction)(_In_ PVMM_PROCESS pProcess, _In_ PVOID ctx);
-    PVOID ctx;
-    PVMM_PROCESS pProcesses[];
-} VMMOB_PROCESS_ACTION_FOREACH, *PVMMOB_PROCESS_ACTION_FOREACH;
+/*
+* Start the work pool threads (if not already started).
+* -- return
+*/
+_Success_(return)
+BOOL VmmWork_Start()
+{
+    SYSTEM_INFO SystemInfo = { 0 };
+    DWORD cThreads;
+    if(ctxVmm->WorkPool.fStarted) { return ctxVmm->WorkPool.cThreads > 0; }
+    EnterCriticalSection(&ctxVmm->WorkPool.Lock);
+    if(!ctxVmm->WorkPool.fStarted && !ctxVmm->WorkPool.fTerminate) {
+        GetSystemInfo(&SystemInfo);
+        cThreads = min(VMM_WORK_THREADS_MAX, max(VMM_WORK_THREADS_MIN, SystemInfo.dwNumberOfProcessors));
+        if((ctxVmm->WorkPool.hEventWork = CreateEvent(NULL, TRUE, FALSE, NULL))) {
+            while(ctxVmm->WorkPool.cThreads < cThreads) {
+                if(!(ctxVmm->WorkPool.hThreads[ctxVmm->WorkPool.cThreads] = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)VmmWork_ThreadProc, NULL, 0, NULL))) { break; }
+                if(ctxVmm->Numa.fEnabled) {
+                    // numa mode: pin pool threads round-robin to the nodes
+                    SetThreadGroupAffinity(ctxVmm->WorkPool.hThreads[ctxVmm->WorkPool.cThreads], &ctxVmm->Numa.Affinity[ctxVmm->WorkPool.cThreads % ctxVmm->Numa.cNode], NULL);
+                }
+                ctxVmm->WorkPool.cThreads++;
+            }
+        }
+        ctxVmm->WorkPool.fStarted = TRUE;
+    }
+    LeaveCriticalSection(&ctxVmm->WorkPool.Lock);
+    return ctxVmm->WorkPool.cThreads > 0;
+}
 
-DWORD VmmProcessActionForeachParallel_ThreadProc(PVMMOB_PROCESS_ACTION_FOREACH ctxObForeach)
+/*
+* Terminate the work pool threads. Must be called after all users of the work
+* pool have completed, i.e. after ThreadWorkers.c have reached zero.
+*/
+VOID VmmWork_Close()
 {
     DWORD i;
-    WaitForSingleObject(ctxObForeach->hSemaphore, INFINITE);
-    for(i = 0; i < ctxObForeach->cProcess && ctxVmm->ThreadWorkers.fEnabled; i++) {
-        ctxObForeach->pfnAction(ctxObForeach->pProcesses[i], ctxObForeach->ctx);
+    if(!ctxVmm->WorkPool.fStarted) { return; }
+    ctxVmm->WorkPool.fTerminate = TRUE;
+    if(ctxVmm->WorkPool.hEventWork) {
+        SetEvent(ctxVmm->WorkPool.hEventWork);
+    }
+    if(ctxVmm->WorkPool.cThreads) {
+        WaitForMultipleObjects(ctxVmm->WorkPool.cThreads, ctxVmm->WorkPool.hThreads, TRUE, INFINITE);
+    }
+    for(i = 0; i < ctxVmm->WorkPool.cThreads; i++) {
+        CloseHandle(ctxVmm->WorkPool.hThreads[i]);
+    }
+    ctxVmm->WorkPool.cThreads = 0;
+    if(ctxVmm->WorkPool.hEventWork) {
+        CloseHandle(ctxVmm->WorkPool.hEventWork);
+        ctxVmm->WorkPool.hEventWork = NULL;
     }
-    ReleaseSemaphore(ctxObForeach->hSemaphore, 1, NULL);
-    Ob_DECREF(ctxObForeach);
-    return 1;
 }
 
-VOID VmmProcessActionForeachParallel_CloseObCallback(_In_ PVMMOB_PROCESS_ACTION_FOREACH ctxObForeach)
+VOID VmmWorkParallel(_In_opt_ PVOID ctx, _In_ DWORD cItems, _In_ VOID(*pfnItem)(_In_opt_ PVOID ctx, _In_ DWORD iItem))
 {
     DWORD i;
-    for(i = 0; i < ctxObForeach->cProcess; i++) {
-        Ob_DECREF(ctxObForeach->pProcesses[i]);
+    PVMM_WORK_JOB *ppJob;
+    VMM_WORK_JOB Job = { 0 };
+    if(!cItems) { return; }
+    InterlockedIncrement(&ctxVmm->ThreadWorkers.c);
+    // single item or no work pool -> execute on calling thread
+    if((cItems == 1) || !VmmWork_Start() || !(Job.hEventDone = CreateEvent(NULL, TRUE, FALSE, NULL))) {
+        for(i = 0; (i < cItems) && ctxVmm->ThreadWorkers.fEnabled; i++) {
+            pfnItem(ctx, i);
+        }
+        InterlockedDecrement(&ctxVmm->ThreadWorkers.c);
+        return;
+    }
+    Job.ctx = ctx;
+    Job.pfnItem = pfnItem;
+    Job.cItems = cItems;
+    Job.cItemsRemaining = cItems;
+    // queue job last and wake up pool threads
+    EnterCriticalSection(&ctxVmm->WorkPool.Lock);
+    ppJob = &ctxVmm->WorkPool.pJobs;
+    while(*ppJob) {
+        ppJob = &(*ppJob)->FLink;
+    }
+    *ppJob = &Job;
+    SetEvent(ctxVmm->WorkPool.hEventWork);
+    LeaveCriticalSection(&ctxVmm->WorkPool.Lock);
+    // execute on calling thread and wait for items claimed by pool threads
+    VmmWork_ExecuteJob(&Job);
+    WaitForSingleObject(Job.hEventDone, INFINITE);
+    // dequeue job and wait for any attached pool threads to detach
+    EnterCriticalSection(&ctxVmm->WorkPool.Lock);
+    ppJob = &ctxVmm->WorkPool.pJobs;
+    while(*ppJob && (*ppJob != &Job)) {
+        ppJob = &(*ppJob)->FLink;
+    }
+    if(*ppJob) { *ppJob = Job.FLink; }
+    LeaveCriticalSection(&ctxVmm->WorkPool.Lock);
+    while(Job.cWorkers) {
+        SwitchToThread();
+    }
+    CloseHandle(Job.hEventDone);
+    InterlockedDecrement(&ctxVmm->ThreadWorkers.c);
+}
+
+_Success_(return)
+BOOL VmmWorkAsync(_In_opt_ PVOID ctx, _In_ VOID(*pfnItem)(_In_opt_ PVOID ctx, _In_ DWORD iItem))
+{
+    PVMM_WORK_JOB pJob, *ppJob;
+    if(!ctxVmm->ThreadWorkers.fEnabled || !VmmWork_Start()) { return FALSE; }
+    if(!(pJob = LocalAlloc(LMEM_ZEROINIT, sizeof(VMM_WORK_JOB)))) { return FALSE; }
+    pJob->ctx = ctx;
+    pJob->pfnItem = pfnItem;
+    pJob->cItems = 1;
+    pJob->cItemsRemaining = 1;
+    pJob->fAsync = TRUE;
+    InterlockedIncrement(&ctxVmm->ThreadWorkers.c);
+    // queue job last and wake up pool threads
+    EnterCriticalSection(&ctxVmm->WorkPool.Lock);
+    ppJob = &ctxVmm->WorkPool.pJobs;
+    while(*ppJob) {
+        ppJob = &(*ppJob)->FLink;
     }
+    *ppJob = pJob;
+    SetEvent(ctxVmm->WorkPool.hEventWork);
+    LeaveCriticalSection(&ctxVmm->WorkPool.Lock);
+    return TRUE;
+}
+
+// ----------------------------------------------------------------------------
+// PROCESS PARALLELIZATION FUNCTIONALITY:
+// ----------------------------------------------------------------------------
+
+typedef struct tdVMM_PROCESS_ACTION_FOREACH {
+    DWORD cProcess;
+    VOID(*pfnAction)(_In_ PVMM_PROCESS pProcess, _In_opt_ PVOID ctx);
+    PVOID ctx;
+    PVMM_PROCESS *ppProcesses;
+} VMM_PROCESS_ACTION_FOREACH, *PVMM_PROCESS_ACTION_FOREACH;
+
+VOID VmmProcessActionForeachParallel_ItemCB(_In_ PVMM_PROCESS_ACTION_FOREACH ctxForeach, _In_ DWORD iItem)
+{
+    ctxForeach->pfnAction(ctxForeach->ppProcesses[iItem], ctxForeach->ctx);
 }
 
 BOOL VmmProcessActionForeachParallel_CriteriaActiveOnly(_In_ PVMM_PROCESS pProcess, _In_opt_ PVOID ctx)
@@ -1150,74 +2825,131 @@ BOOL VmmProcessActionForeachParallel_CriteriaActiveOnly(_In_ PVMM_PROCESS pProce
 
 VOID VmmProcessActionForeachParallel(_In_opt_ PVOID ctx, _In_opt_ DWORD dwThreadLoadFactor, _In_opt_ BOOL(*pfnCriteria)(_In_ PVMM_PROCESS pProcess, _In_opt_ PVOID ctx), _In_ VOID(*pfnAction)(_In_ PVMM_PROCESS pProcess, _In_opt_ PVOID ctx))
 {
-    HANDLE hSemaphore;
-    DWORD dwPID, cThreads = 0;
-    HANDLE hThreads[MAXIMUM_WAIT_OBJECTS];
-    PVMMOB_PROCESS_ACTION_FOREACH ctxObForeach = NULL;
+    DWORD i;
+    VMM_PROCESS_ACTION_FOREACH ctxForeach = { 0 };
+    PVMMOB_PROCESS_TABLE ptObCurrent = NULL;
     PVMM_PROCESS pObProcess = NULL;
-    POB_VSET pObProcessSelectedSet = NULL;
-    InterlockedIncrement(&ctxVmm->ThreadWorkers.c);
-    hSemaphore = CreateSemaphore(NULL, VMM_PROCESS_ACTION_FOREACH_THREADS_PARALLEL, VMM_PROCESS_ACTION_FOREACH_THREADS_PARALLEL, NULL);
-    if(!hSemaphore) { goto fail; }
-    if(!(pObProcessSelectedSet = ObVSet_New())) { goto fail; }
-    // 1: select processes to queue using criteria function
-    while(pObProcess = VmmProcessGetNext(pObProcess, VMM_FLAG_PROCESS_SHOW_TERMINATED)) {
+    if(!(ptObCurrent = (PVMMOB_PROCESS_TABLE)ObContainer_GetOb(ctxVmm->pObCPROC))) { return; }
+    if(!ptObCurrent->c || !(ctxForeach.ppProcesses = LocalAlloc(0, ptObCurrent->c * sizeof(PVMM_PROCESS)))) { goto fail; }
+    // 1: select processes using criteria function
+    while((pObProcess = VmmProcessGetNextEx(ptObCurrent, pObProcess, VMM_FLAG_PROCESS_SHOW_TERMINATED))) {
         if(!pfnCriteria || pfnCriteria(pObProcess, ctx)) {
-            ObVSet_Push(pObProcessSelectedSet, pObProcess->dwPID);
-        }
-    }
-    if(!ObVSet_Size(pObProcessSelectedSet)) { goto fail; }
-    dwThreadLoadFactor = max(dwThreadLoadFactor, 1 + (ObVSet_Size(pObProcessSelectedSet) / MAXIMUM_WAIT_OBJECTS));
-    // 2: queue selected processes onto threads and start execute
-    while(ctxVmm->ThreadWorkers.fEnabled && (dwPID = (DWORD)ObVSet_Pop(pObProcessSelectedSet))) {
-        pObProcess = VmmProcessGet(dwPID);
-        if(pObProcess) {
-            if(!ctxObForeach) {
-                ctxObForeach = Ob_Alloc('ea__', 0, sizeof(VMMOB_PROCESS_ACTION_FOREACH) + dwThreadLoadFactor * sizeof(PVMM_PROCESS), VmmProcessActionForeachParallel_CloseObCallback, NULL);
-                if(!ctxObForeach) { goto fail; }
-                ctxObForeach->ctx = ctx;
-                ctxObForeach->hSemaphore = hSemaphore;
-                ctxObForeach->pfnAction = pfnAction;
-                ctxObForeach->Reserved = cThreads;
-                ctxObForeach->cProcess = 0;
-            }
-            ctxObForeach->pProcesses[ctxObForeach->cProcess++] = pObProcess;
-            pObProcess = NULL;          // object reference responsibility already passed on to ctxObForeach object.
-            if(ctxObForeach->cProcess == dwThreadLoadFactor) {
-                hThreads[cThreads] = CreateThread(NULL, 0, VmmProcessActionForeachParallel_ThreadProc, ctxObForeach, 0, NULL);
-                if(!hThreads[cThreads]) { goto fail; }
-                cThreads++;
-                ctxObForeach = NULL;    // object reference responsibility already passed on to CreateThread function call.
-            }
+            ctxForeach.ppProcesses[ctxForeach.cProcess++] = (PVMM_PROCESS)Ob_INCREF(pObProcess);
         }
     }
-    if(ctxObForeach) {          // process any remaining objects
-        hThreads[cThreads] = CreateThread(NULL, 0, VmmProcessActionForeachParallel_ThreadProc, ctxObForeach, 0, NULL);
-        if(!hThreads[cThreads]) { goto fail; }
-        cThreads++;
-        ctxObForeach = NULL;    // object reference responsibility already passed on to CreateThread function call.
-    }
+    // 2: execute action on selected processes in parallel
+    ctxForeach.ctx = ctx;
+    ctxForeach.pfnAction = pfnAction;
+    VmmWorkParallel(&ctxForeach, ctxForeach.cProcess, (VOID(*)(PVOID, DWORD))VmmProcessActionForeachParallel_ItemCB);
 fail:
-    WaitForMultipleObjects(cThreads, hThreads, TRUE, INFINITE);
-    while(cThreads) {
-        cThreads--;
-        if(hThreads[cThreads]) { CloseHandle(hThreads[cThreads]); }
-    }
-    if(hSemaphore) { CloseHandle(hSemaphore); }
-    Ob_DECREF(pObProcess);
-    Ob_DECREF(pObProcessSelectedSet);
-    Ob_DECREF(ctxObForeach);
-    InterlockedDecrement(&ctxVmm->ThreadWorkers.c);
+    for(i = 0; i < ctxForeach.cProcess; i++) {
+        Ob_DECREF(ctxForeach.ppProcesses[i]);
+    }
+    LocalFree(ctxForeach.ppProcesses);
+    Ob_DECREF(ptObCurrent);
 }
 
 // ----------------------------------------------------------------------------
 // INTERNAL VMMU FUNCTIONALITY: VIRTUAL MEMORY ACCESS.
 // ----------------------------------------------------------------------------
 
+DWORD VmmStatDevice_Bucket(_In_ QWORD qw)
+{
+    DWORD i;
+    if(!qw || !_BitScanReverse64(&i, qw)) { return 0; }
+    return min(i + 1, VMM_STATISTICS_DEVICE_BUCKETS - 1);
+}
+
+/*
+* Record a completed device operation in the device I/O telemetry.
+* -- pOp
+* -- cPage = number of pages in the device call.
+* -- cb = number of bytes successfully transferred.
+* -- tmStart = performance counter at start of the device call.
+*/
+VOID VmmStatDevice_Record(_In_ PVMM_STATISTICS_DEVICE_OP pOp, _In_ DWORD cPage, _In_ QWORD cb, _In_ QWORD tmStart)
+{
+    QWORD tmNow, tm;
+    QueryPerformanceCounter((PLARGE_INTEGER)&tmNow);
+    tm = tmNow - tmStart;
+    InterlockedIncrement64(&pOp->cCall);
+    InterlockedAdd64(&pOp->cPage, cPage);
+    InterlockedAdd64(&pOp->cb, cb);
+    InterlockedAdd64(&pOp->tm, tm);
+    InterlockedIncrement64(&pOp->cHistBatch[VmmStatDevice_Bucket(cPage)]);
+    InterlockedIncrement64(&pOp->cHistLatency[VmmStatDevice_Bucket((tm * 1000000ULL) / ctxVmm->stat.dev.qwFreq)]);
+}
+
+typedef struct tdVMM_READSCATTER_PIPELINE_CONTEXT {
+    PPMEM_IO_SCATTER_HEADER ppMEMs;
+    DWORD cpMEMs;
+    DWORD cpMEMsPerItem;
+} VMM_READSCATTER_PIPELINE_CONTEXT, *PVMM_READSCATTER_PIPELINE_CONTEXT;
+
+VOID VmmReadScatterPhysical_DeviceScatter_PipelineItem(_In_ PVMM_READSCATTER_PIPELINE_CONTEXT ctx, _In_ DWORD iItem)
+{
+    DWORD o = iItem * ctx->cpMEMsPerItem;
+    if(o >= ctx->cpMEMs) { return; }
+    LeechCore_ReadScatter(ctx->ppMEMs + o, min(ctx->cpMEMsPerItem, ctx->cpMEMs - o));
+}
+
+/*
+* Read scatter physical memory from the device (LeechCore). Remote devices are
+* latency bound - a single synchronous round trip per scatter batch leaves the
+* link idle most of the time. Large batches towards remote devices are instead
+* split into up to ctxVmm->Remote.cPipelineDepth requests which are issued on
+* the work pool so that several requests are outstanding the same time.
+* LeechCore compresses the remote page payload (unless disabled by the
+* LEECHCORE_CONFIG_FLAG_REMOTE_NO_COMPRESS flag) - zero-filled pages thus cost
+* next to nothing on the wire and are recorded by address only in the PHYS
+* cache (VmmCacheDedup). Prefetch hints are issued on the work pool by
+* VmmCachePrefetchPagesAsync.
+* -- ppMEMs
+* -- cpMEMs
+*/
+VOID VmmReadScatterPhysical_DeviceScatter(_Inout_ PPMEM_IO_SCATTER_HEADER ppMEMs, _In_ DWORD cpMEMs)
+{
+    DWORD i, cItem;
+    QWORD tmStart, cb = 0;
+    VMM_READSCATTER_PIPELINE_CONTEXT ctxPipeline;
+    if(ctxVmm->MemMap.fEnabled) {
+        VmmMemMap_ReadScatter(ppMEMs, cpMEMs);
+        return;
+    }
+    QueryPerformanceCounter((PLARGE_INTEGER)&tmStart);
+    cItem = min(ctxVmm->Remote.cPipelineDepth, cpMEMs / VMM_REMOTE_PIPELINE_MINPAGES);
+    if(ctxMain->dev.fRemote && (cItem > 1)) {
+        ctxPipeline.ppMEMs = ppMEMs;
+        ctxPipeline.cpMEMs = cpMEMs;
+        ctxPipeline.cpMEMsPerItem = (cpMEMs + cItem - 1) / cItem;
+        VmmWorkParallel(&ctxPipeline, cItem, (VOID(*)(PVOID, DWORD))VmmReadScatterPhysical_DeviceScatter_PipelineItem);
+    } else {
+        LeechCore_ReadScatter(ppMEMs, cpMEMs);
+    }
+    for(i = 0; i < cpMEMs; i++) {
+        cb += ppMEMs[i]->cb;
+    }
+    VmmStatDevice_Record(&ctxVmm->stat.dev.ReadScatter, cpMEMs, cb, tmStart);
+}
+
+/*
+* Read physically contiguous memory directly from the device (LeechCore) while
+* recording device I/O telemetry.
+*/
+DWORD VmmReadScatterPhysical_DeviceContiguous(_In_ QWORD pa, _Out_writes_(cb) PBYTE pb, _In_ DWORD cb)
+{
+    QWORD tmStart;
+    DWORD cbRead;
+    QueryPerformanceCounter((PLARGE_INTEGER)&tmStart);
+    cbRead = LeechCore_Read(pa, pb, cb);
+    VmmStatDevice_Record(&ctxVmm->stat.dev.ReadContiguous, cb >> 12, cbRead, tmStart);
+    return cbRead;
+}
+
 VOID VmmWriteScatterVirtual(_In_ PVMM_PROCESS pProcess, _Inout_ PPMEM_IO_SCATTER_HEADER ppMEMsVirt, _In_ DWORD cpMEMsVirt)
 {
     BOOL result;
-    QWORD i, qwPA;
+    QWORD i, qwPA, tmStart;
     PMEM_IO_SCATTER_HEADER pMEM_Virt;
     // loop over the items, this may not be very efficient compared to a true
     // scatter write, but since underlying hardware implementation does not
@@ -1229,7 +2961,9 @@ VOID VmmWriteScatterVirtual(_In_ PVMM_PROCESS pProcess, _Inout_ PPMEM_IO_SCATTER
         result = VmmVirt2Phys(pProcess, pMEM_Virt->qwA, &qwPA);
         if(!result) { continue; }
         InterlockedIncrement64(&ctxVmm->stat.cPhysWrite);
+        QueryPerformanceCounter((PLARGE_INTEGER)&tmStart);
         result = LeechCore_Write(qwPA, pMEM_Virt->pb, pMEM_Virt->cbMax);
+        VmmStatDevice_Record(&ctxVmm->stat.dev.Write, (pMEM_Virt->cbMax + 0xfff) >> 12, result ? pMEM_Virt->cbMax : 0, tmStart);
         if(result) {
             pMEM_Virt->cb = pMEM_Virt->cbMax;
             VmmCacheInvalidate(qwPA & ~0xfff);
@@ -1240,7 +2974,7 @@ VOID VmmWriteScatterVirtual(_In_ PVMM_PROCESS pProcess, _Inout_ PPMEM_IO_SCATTER
 VOID VmmWriteScatterPhysical(_Inout_ PPMEM_IO_SCATTER_HEADER ppMEMsPhys, _In_ DWORD cpMEMsPhys)
 {
     BOOL result;
-    QWORD i;
+    QWORD i, tmStart;
     PMEM_IO_SCATTER_HEADER pMEM_Phys;
     // loop over the items, this may not be very efficient compared to a true
     // scatter write, but since underlying hardware implementation does not
@@ -1249,7 +2983,9 @@ VOID VmmWriteScatterPhysical(_Inout_ PPMEM_IO_SCATTER_HEADER ppMEMsPhys, _In_ DW
     for(i = 0; i < cpMEMsPhys; i++) {
         pMEM_Phys = ppMEMsPhys[i];
         InterlockedIncrement64(&ctxVmm->stat.cPhysWrite);
+        QueryPerformanceCounter((PLARGE_INTEGER)&tmStart);
         result = LeechCore_Write(pMEM_Phys->qwA, pMEM_Phys->pb, pMEM_Phys->cbMax);
+        VmmStatDevice_Record(&ctxVmm->stat.dev.Write, (pMEM_Phys->cbMax + 0xfff) >> 12, result ? pMEM_Phys->cbMax : 0, tmStart);
         if(result) {
             pMEM_Phys->cb = pMEM_Phys->cbMax;
             VmmCacheInvalidate(pMEM_Phys->qwA & ~0xfff);
@@ -1257,18 +2993,383 @@ VOID VmmWriteScatterPhysical(_Inout_ PPMEM_IO_SCATTER_HEADER ppMEMsPhys, _In_ DW
     }
 }
 
+#define VMM_WRITEBATCH_MAX_CHUNKS       0x00100000
+#define VMM_WRITEBATCH_MAX_RUN          0x00100000
+
+typedef struct tdVMM_WRITEBATCH_CHUNK {
+    QWORD pa;
+    DWORD iEntry;
+    DWORD oEntry;
+    DWORD cb;
+    BOOL fWrite;
+} VMM_WRITEBATCH_CHUNK, *PVMM_WRITEBATCH_CHUNK;
+
+/*
+* qsort compare function for sorting write batch chunks by physical address.
+* Chunks at the same physical address are kept in batch order.
+*/
+int VmmWriteBatch_CmpSort(_In_ PVMM_WRITEBATCH_CHUNK pc1, _In_ PVMM_WRITEBATCH_CHUNK pc2)
+{
+    if(pc1->pa != pc2->pa) { return (pc1->pa < pc2->pa) ? -1 : 1; }
+    if(pc1->iEntry != pc2->iEntry) { return (pc1->iEntry < pc2->iEntry) ? -1 : 1; }
+    return (pc1->oEntry < pc2->oEntry) ? -1 : ((pc1->oEntry > pc2->oEntry) ? 1 : 0);
+}
+
+/*
+* Write a single physically contiguous run to the device and update statistics.
+* -- pa
+* -- pb
+* -- cb
+* -- return
+*/
+BOOL VmmWriteBatch_DeviceWrite(_In_ QWORD pa, _In_reads_(cb) PBYTE pb, _In_ DWORD cb)
+{
+    BOOL result;
+    QWORD tmStart;
+    InterlockedIncrement64(&ctxVmm->stat.cPhysWrite);
+    QueryPerformanceCounter((PLARGE_INTEGER)&tmStart);
+    result = LeechCore_Write(pa, pb, cb);
+    VmmStatDevice_Record(&ctxVmm->stat.dev.Write, (DWORD)((((pa & 0xfff) + cb + 0xfff) >> 12)), result ? cb : 0, tmStart);
+    return result;
+}
+
+/*
+* Verify a written batch by reading back all affected pages in one scatter
+* read bypassing the cache. Chunks must be sorted by physical address.
+* -- pEntries
+* -- cChunks
+* -- pChunks
+*/
+VOID VmmWriteBatch_Verify(_Inout_ PVMM_WRITEBATCH_ENTRY pEntries, _In_ DWORD cChunks, _In_ PVMM_WRITEBATCH_CHUNK pChunks)
+{
+    DWORD i, iPage, cPages = 0;
+    QWORD paPage, paPageLast = (QWORD)-1;
+    PBYTE pbBuffer;
+    PMEM_IO_SCATTER_HEADER pMEMs, *ppMEMs;
+    PVMM_WRITEBATCH_CHUNK pc;
+    for(i = 0; i < cChunks; i++) {
+        paPage = pChunks[i].pa & ~0xfff;
+        if(pChunks[i].fWrite && (paPage != paPageLast)) {
+            paPageLast = paPage;
+            cPages++;
+        }
+    }
+    if(!cPages) { return; }
+    pbBuffer = LocalAlloc(LMEM_ZEROINIT, cPages * (0x1000 + sizeof(MEM_IO_SCATTER_HEADER) + sizeof(PMEM_IO_SCATTER_HEADER)));
+    if(!pbBuffer) {
+        for(i = 0; i < cChunks; i++) {
+            pEntries[pChunks[i].iEntry].fVerified = FALSE;
+        }
+        return;
+    }
+    pMEMs = (PMEM_IO_SCATTER_HEADER)(pbBuffer + cPages * 0x1000);
+    ppMEMs = (PPMEM_IO_SCATTER_HEADER)(pbBuffer + cPages * (0x1000 + sizeof(MEM_IO_SCATTER_HEADER)));
+    for(i = 0, iPage = 0, paPageLast = (QWORD)-1; i < cChunks; i++) {
+        paPage = pChunks[i].pa & ~0xfff;
+        if(pChunks[i].fWrite && (paPage != paPageLast)) {
+            paPageLast = paPage;
+            ppMEMs[iPage] = &pMEMs[iPage];
+            pMEMs[iPage].magic = MEM_IO_SCATTER_HEADER_MAGIC;
+            pMEMs[iPage].version = MEM_IO_SCATTER_HEADER_VERSION;
+            pMEMs[iPage].qwA = paPage;
+            pMEMs[iPage].cbMax = 0x1000;
+            pMEMs[iPage].pb = pbBuffer + (QWORD)iPage * 0x1000;
+            iPage++;
+        }
+    }
+    VmmReadScatterPhysical(ppMEMs, cPages, VMM_FLAG_NOCACHE);
+    // chunks never cross a page boundary and are sorted - walk pages in step.
+    for(i = 0, iPage = 0; i < cChunks; i++) {
+        pc = pChunks + i;
+        if(!pc->fWrite) { continue; }
+        while(pMEMs[iPage].qwA != (pc->pa & ~0xfff)) { iPage++; }
+        if((pMEMs[iPage].cb != 0x1000) || memcmp(pMEMs[iPage].pb + (pc->pa & 0xfff), pEntries[pc->iEntry].pb + pc->oEntry, pc->cb)) {
+            pEntries[pc->iEntry].fVerified = FALSE;
+        }
+    }
+    LocalFree(pbBuffer);
+}
+
+DWORD VmmWriteBatch(_In_ DWORD cEntries, _Inout_updates_(cEntries) PVMM_WRITEBATCH_ENTRY pEntries, _In_ DWORD flags)
+{
+    BOOL fVerify = (flags & VMM_WRITEBATCH_FLAG_VERIFY) ? TRUE : FALSE;
+    DWORD i, j, k, o, cbP, cbRun, cChunks = 0, cResult = 0;
+    QWORD cChunksMax = 0, pa, paPage, paPageLast = (QWORD)-1;
+    PBYTE pbRun = NULL;
+    PVMM_WRITEBATCH_ENTRY pe;
+    PVMM_WRITEBATCH_CHUNK pc, pChunks = NULL;
+    PVMM_PROCESS pObProcess = NULL;
+    // 1: reset result and count the number of page chunks.
+    for(i = 0; i < cEntries; i++) {
+        pe = pEntries + i;
+        pe->cbWrite = 0;
+        pe->fVerified = fVerify;
+        if(pe->cb && pe->pb) {
+            cChunksMax += ((pe->qwA & 0xfff) + pe->cb + 0xfff) >> 12;
+        }
+    }
+    if(!ctxMain->dev.fWritable || !cChunksMax || (cChunksMax > VMM_WRITEBATCH_MAX_CHUNKS)) { goto fail; }
+    if(!(pChunks = LocalAlloc(0, (SIZE_T)cChunksMax * sizeof(VMM_WRITEBATCH_CHUNK)))) { goto fail; }
+    if(!(pbRun = LocalAlloc(0, VMM_WRITEBATCH_MAX_RUN))) { goto fail; }
+    // 2: split into page chunks and translate to physical addresses up front.
+    //    the process object is kept between entries of the same process.
+    for(i = 0; i < cEntries; i++) {
+        pe = pEntries + i;
+        if(!pe->cb || !pe->pb) { continue; }
+        if(pe->dwPID != (DWORD)-1) {
+            if(!pObProcess || (pObProcess->dwPID != pe->dwPID)) {
+                Ob_DECREF_NULL(&pObProcess);
+                pObProcess = VmmProcessGet(pe->dwPID);
+            }
+            if(!pObProcess) { continue; }
+        }
+        for(o = 0; o < pe->cb; o += cbP) {
+            cbP = min(0x1000 - (DWORD)((pe->qwA + o) & 0xfff), pe->cb - o);
+            if(pe->dwPID == (DWORD)-1) {
+                pa = pe->qwA + o;
+            } else if(!VmmVirt2Phys(pObProcess, pe->qwA + o, &pa)) {
+                continue;
+            }
+            pc = pChunks + cChunks++;
+            pc->pa = pa;
+            pc->iEntry = i;
+            pc->oEntry = o;
+            pc->cb = cbP;
+            pc->fWrite = FALSE;
+        }
+    }
+    Ob_DECREF_NULL(&pObProcess);
+    if(!cChunks) { goto fail; }
+    qsort(pChunks, cChunks, sizeof(VMM_WRITEBATCH_CHUNK), (int(*)(const void*, const void*))VmmWriteBatch_CmpSort);
+    // 3: merge exactly adjacent chunks into runs and write each run once. if
+    //    a merged write fails the chunks are re-written one by one to retain
+    //    per-chunk results. overlapping chunks always start a new run.
+    for(i = 0; i < cChunks; i = j) {
+        cbRun = pChunks[i].cb;
+        for(j = i + 1; j < cChunks; j++) {
+            if(pChunks[j].pa != pChunks[j - 1].pa + pChunks[j - 1].cb) { break; }
+            if(cbRun + pChunks[j].cb > VMM_WRITEBATCH_MAX_RUN) { break; }
+            cbRun += pChunks[j].cb;
+        }
+        if(j - i == 1) {
+            pc = pChunks + i;
+            pc->fWrite = VmmWriteBatch_DeviceWrite(pc->pa, pEntries[pc->iEntry].pb + pc->oEntry, pc->cb);
+        } else {
+            for(k = i, o = 0; k < j; k++) {
+                pc = pChunks + k;
+                memcpy(pbRun + o, pEntries[pc->iEntry].pb + pc->oEntry, pc->cb);
+                o += pc->cb;
+            }
+            if(VmmWriteBatch_DeviceWrite(pChunks[i].pa, pbRun, cbRun)) {
+                for(k = i; k < j; k++) {
+                    pChunks[k].fWrite = TRUE;
+                }
+            } else {
+                for(k = i; k < j; k++) {
+                    pc = pChunks + k;
+                    pc->fWrite = VmmWriteBatch_DeviceWrite(pc->pa, pbRun + (pc->pa - pChunks[i].pa), pc->cb);
+                }
+            }
+        }
+    }
+    // 4: tally results and invalidate each affected page only once.
+    for(i = 0; i < cChunks; i++) {
+        pc = pChunks + i;
+        if(!pc->fWrite) { continue; }
+        pEntries[pc->iEntry].cbWrite += pc->cb;
+        paPage = pc->pa & ~0xfff;
+        if(paPage != paPageLast) {
+            paPageLast = paPage;
+            VmmCacheInvalidate(paPage);
+        }
+    }
+    // 5: optional verify by batched read-back.
+    if(fVerify) {
+        VmmWriteBatch_Verify(pEntries, cChunks, pChunks);
+    }
+fail:
+    for(i = 0; i < cEntries; i++) {
+        pe = pEntries + i;
+        if(pe->cbWrite != pe->cb) {
+            pe->fVerified = FALSE;
+        } else if(!fVerify || pe->fVerified) {
+            cResult++;
+        }
+    }
+    LocalFree(pChunks);
+    LocalFree(pbRun);
+    return cResult;
+}
+
+/*
+* Access pattern detector for physical memory read-ahead. Reads are matched
+* against a small table of recently seen access streams. A stream with a stable
+* stride (sequential or strided access) gets its speculative window doubled on
+* each confirmed stride, a broken pattern halves the window. Reads not matching
+* any stream (random access) get the minimum window.
+* The streams are sharded per processor to avoid a global lock on cache misses;
+* a reading thread usually stays on its processor long enough to build up its
+* stream while concurrent readers on other processors don't contend.
+* -- paFirst = first page not in cache of the read.
+* -- paLast = last page not in cache of the read.
+* -- piStride = stride in pages to use for read-ahead.
+* -- return = number of pages to read ahead.
+*/
+DWORD VmmReadAhead_Predict(_In_ QWORD paFirst, _In_ QWORD paLast, _Out_ PLONG piStride)
+{
+    DWORD i, cWindow;
+    LONG iStride, iStrideBest = 0;
+    PVMM_READAHEAD_STREAM ps, psBest = NULL, psLRU = NULL;
+    PVMM_READAHEAD_SHARD pShard = &ctxVmm->ReadAhead.Shard[GetCurrentProcessorNumber() % VMM_READAHEAD_SHARDS];
+    paFirst &= ~0xfff;
+    paLast &= ~0xfff;
+    AcquireSRWLockExclusive(&pShard->LockSRW);
+    pShard->qwTick++;
+    // 1: find closest preceding stream (or least recently used stream)
+    for(i = 0; i < VMM_READAHEAD_STREAMS; i++) {
+        ps = &pShard->S[i];
+        if(!psLRU || (ps->qwTickLast < psLRU->qwTickLast)) { psLRU = ps; }
+        if(!ps->qwTickLast || (paFirst <= ps->paLast)) { continue; }
+        iStride = (LONG)((paFirst - ps->paLast) >> 12);
+        if((iStride > VMM_READAHEAD_STRIDE_MAX) || (psBest && (iStride >= iStrideBest))) { continue; }
+        psBest = ps;
+        iStrideBest = iStride;
+    }
+    // 2: update stream - confirmed stride -> grow window, broken -> shrink.
+    if((ps = psBest)) {
+        if(iStrideBest == ps->iStride) {
+            ps->cConfidence++;
+            ps->cWindow = min(VMM_READAHEAD_WINDOW_MAX, ps->cWindow << 1);
+        } else {
+            ps->iStride = iStrideBest;
+            ps->cConfidence = 0;
+            ps->cWindow = max(VMM_READAHEAD_WINDOW_MIN, ps->cWindow >> 1);
+        }
+    } else {
+        // no matching stream (random access) - replace least recently used stream
+        ps = psLRU;
+        ps->iStride = 1;
+        ps->cConfidence = 0;
+        ps->cWindow = VMM_READAHEAD_WINDOW_MIN;
+    }
+    // multi-page reads are sequential within the read itself
+    if((paLast > paFirst) && !ps->cConfidence) {
+        ps->iStride = 1;
+    }
+    ps->paLast = paLast;
+    ps->qwTickLast = pShard->qwTick;
+    *piStride = ps->iStride;
+    cWindow = ps->cWindow;
+    ReleaseSRWLockExclusive(&pShard->LockSRW);
+    return cWindow;
+}
+
+/*
+* qsort compare function for sorting scatter headers by physical address.
+*/
+int VmmReadScatterPhysical_Device_CmpSort(_In_ PPMEM_IO_SCATTER_HEADER ppMEM1, _In_ PPMEM_IO_SCATTER_HEADER ppMEM2)
+{
+    if((*ppMEM1)->qwA < (*ppMEM2)->qwA) { return -1; }
+    return ((*ppMEM1)->qwA > (*ppMEM2)->qwA) ? 1 : 0;
+}
+
+/*
+* Read physical memory from the device. Page sized reads are sorted by physical
+* address and deduplicated. Runs of physically contiguous pages are merged into
+* larger contiguous device reads and the result is fanned out to the original
+* scatter headers. If a merged read fails partially the pages in the run are
+* re-read as individual scatter reads to preserve per-page results.
+* -- ppMEMs
+* -- cpMEMs
+*/
+VOID VmmReadScatterPhysical_Device(_Inout_ PPMEM_IO_SCATTER_HEADER ppMEMs, _In_ DWORD cpMEMs)
+{
+    DWORD i, j, k, cRun, cSort = 0, cScatter = 0, cDedup = 0, cCoalesced = 0;
+    PBYTE pbRun = NULL;
+    PMEM_IO_SCATTER_HEADER pMEM;
+    PPMEM_IO_SCATTER_HEADER ppSort = NULL, ppScatter;
+    if((cpMEMs < 2) || !(ppSort = LocalAlloc(0, 2 * (SIZE_T)cpMEMs * sizeof(PMEM_IO_SCATTER_HEADER)))) {
+        InterlockedAdd64(&ctxVmm->stat.dev.cHistRun[1], cpMEMs);
+        VmmReadScatterPhysical_DeviceScatter(ppMEMs, cpMEMs);
+        return;
+    }
+    ppScatter = ppSort + cpMEMs;
+    // 1: split into page aligned page sized reads (sort candidates) and other
+    //    reads. already completed reads (i.e. cache hits) are skipped - they
+    //    are not part of any run, which also splits runs at them.
+    for(i = 0; i < cpMEMs; i++) {
+        pMEM = ppMEMs[i];
+        if(pMEM->cb == pMEM->cbMax) { continue; }
+        if((pMEM->cbMax == 0x1000) && !(pMEM->qwA & 0xfff)) {
+            ppSort[cSort++] = pMEM;
+        } else {
+            ppScatter[cScatter++] = pMEM;
+        }
+    }
+    // 2: sort by physical address - duplicates and contiguous pages are now adjacent
+    qsort(ppSort, cSort, sizeof(PMEM_IO_SCATTER_HEADER), (int(*)(const void*, const void*))VmmReadScatterPhysical_Device_CmpSort);
+    // 3: locate runs of contiguous pages [i, j) and merge into one device read
+    //    if long enough. short runs and failed merged runs are scatter read.
+    for(i = 0; i < cSort; i = j) {
+        cRun = 1;
+        for(j = i + 1; j < cSort; j++) {
+            if(ppSort[j]->qwA == ppSort[j - 1]->qwA) { continue; }
+            if((ppSort[j]->qwA != ppSort[j - 1]->qwA + 0x1000) || (cRun == VMM_SCATTER_COALESCE_MAX)) { break; }
+            cRun++;
+        }
+        InterlockedIncrement64(&ctxVmm->stat.dev.cHistRun[VmmStatDevice_Bucket(cRun)]);
+        if((cRun >= VMM_SCATTER_COALESCE_MIN) && (pbRun || (pbRun = LocalAlloc(0, VMM_SCATTER_COALESCE_MAX << 12)))) {
+            if(VmmReadScatterPhysical_DeviceContiguous(ppSort[i]->qwA, pbRun, cRun << 12) == (cRun << 12)) {
+                for(k = i; k < j; k++) {
+                    memcpy(ppSort[k]->pb, pbRun + (ppSort[k]->qwA - ppSort[i]->qwA), 0x1000);
+                    ppSort[k]->cb = 0x1000;
+                }
+                cCoalesced += cRun;
+                continue;
+            }
+        }
+        for(k = i; k < j; k++) {
+            if((k > i) && (ppSort[k]->qwA == ppSort[k - 1]->qwA)) {
+                cDedup++;
+                continue;
+            }
+            ppScatter[cScatter++] = ppSort[k];
+        }
+    }
+    // 4: scatter read remaining
+    if(cScatter) {
+        VmmReadScatterPhysical_DeviceScatter(ppScatter, cScatter);
+    }
+    // 5: fan out result to deduplicated pages
+    for(i = 1; i < cSort; i++) {
+        if((ppSort[i]->qwA == ppSort[i - 1]->qwA) && (ppSort[i]->cb != 0x1000)) {
+            ppSort[i]->cb = ppSort[i - 1]->cb;
+            if(ppSort[i]->cb) {
+                memcpy(ppSort[i]->pb, ppSort[i - 1]->pb, ppSort[i]->cb);
+            }
+        }
+    }
+    if(cCoalesced) { InterlockedAdd64(&ctxVmm->stat.cPhysReadCoalesced, cCoalesced); }
+    if(cDedup) { InterlockedAdd64(&ctxVmm->stat.cPhysReadDedup, cDedup); }
+    LocalFree(pbRun);
+    LocalFree(ppSort);
+}
+
 VOID VmmReadScatterPhysical(_Inout_ PPMEM_IO_SCATTER_HEADER ppMEMsPhys, _In_ DWORD cpMEMsPhys, _In_ QWORD flags)
 {
     DWORD i, c;
     BOOL fCache;
+    QWORD paSpeculative;
+    LONG iStride;
     PMEM_IO_SCATTER_HEADER pMEM;
     PVMMOB_MEM pObCacheEntry, pObReservedMEM;
-    DWORD cSpeculative;
-    PMEM_IO_SCATTER_HEADER ppMEMsSpeculative[0x18];
-    PVMMOB_MEM ppObCacheSpeculative[0x18];
-    fCache = !(VMM_FLAG_NOCACHE & (flags | ctxVmm->flags));
-    // 1: cache read
+    DWORD cSpeculative, cSpeculativeRequested = 0, cWindow;
+    PMEM_IO_SCATTER_HEADER ppMEMsSpeculative[VMM_READAHEAD_WINDOW_MAX];
+    PVMMOB_MEM ppObCacheSpeculative[VMM_READAHEAD_WINDOW_MAX];
+    fCache = !(VMM_FLAG_NOCACHE & (flags | ctxVmm->flags)) && !ctxVmm->MemMap.fEnabled;
+    // 1: cache read (after overlapping remote prefetch hints have landed)
     if(fCache) {
+        VmmCachePrefetchWait((DWORD)-1, ppMEMsPhys, cpMEMsPhys, flags);
         c = 0, cSpeculative = 0;
         for(i = 0; i < cpMEMsPhys; i++) {
             pMEM = ppMEMsPhys[i];
@@ -1285,35 +3386,48 @@ VOID VmmReadScatterPhysical(_Inout_ PPMEM_IO_SCATTER_HEADER ppMEMsPhys, _In_ DWO
                 pMEM->pvReserved2 = (PVOID)2;  // 2 == cache hit
                 pMEM->cb = 0x1000;
                 memcpy(pMEM->pb, pObCacheEntry->pb, 0x1000);
+                if(pObCacheEntry->fSpeculative && InterlockedExchange((volatile LONG*)&pObCacheEntry->fSpeculative, FALSE)) {
+                    InterlockedIncrement64(&ctxVmm->stat.cPhysReadAheadHit);
+                }
                 Ob_DECREF(pObCacheEntry);
                 InterlockedIncrement64(&ctxVmm->stat.cPhysCacheHit);
                 c++;
                 continue;
             }
             // add to potential speculative read map if read is small enough...
-            if(cSpeculative < 0x18) {
+            if(cSpeculative < VMM_READAHEAD_WINDOW_MAX) {
                 ppMEMsSpeculative[cSpeculative++] = pMEM;
             }
         }
         if(c == cpMEMsPhys) { return; }                     // all found in cache -> return!
         if(VMM_FLAG_FORCECACHE_READ & flags) { return; }    // only cached reads allowed -> return!
+        cSpeculativeRequested = cSpeculative;
     }
-    // 2: speculative future read if negligible performance loss
-    if(fCache && cSpeculative && (cSpeculative < 0x18)) {
-        while(cSpeculative < 0x18) {
-            if((ppObCacheSpeculative[cSpeculative] = VmmCacheReserve(VMM_CACHE_TAG_PHYS))) {
-                ppMEMsSpeculative[cSpeculative] = &ppObCacheSpeculative[cSpeculative]->h;
-                ppMEMsSpeculative[cSpeculative]->cb = 0;
-                ppMEMsSpeculative[cSpeculative]->qwA = ((QWORD)ppMEMsSpeculative[cSpeculative - 1]->qwA & ~0xfff) + 0x1000;
-                ppMEMsSpeculative[cSpeculative]->pvReserved2 = (PVOID)3;  // 3 == speculative & backed by cache reserved
-                cSpeculative++;
-            }
+    // 2: speculative future read according to predicted access pattern
+    if(fCache && cSpeculative && (cSpeculative < VMM_READAHEAD_WINDOW_MAX)) {
+        cWindow = VmmReadAhead_Predict(ppMEMsSpeculative[0]->qwA, ppMEMsSpeculative[cSpeculative - 1]->qwA, &iStride);
+        paSpeculative = ppMEMsSpeculative[cSpeculative - 1]->qwA & ~0xfff;
+        for(i = 0; (i < cWindow) && (cSpeculative < VMM_READAHEAD_WINDOW_MAX); i++) {
+            paSpeculative += (QWORD)iStride << 12;
+            if(paSpeculative >= ctxMain->dev.paMax) { break; }
+            if(VmmCacheExists(VMM_CACHE_TAG_PHYS, paSpeculative)) { continue; }
+            if(!(ppObCacheSpeculative[cSpeculative] = VmmCacheReserve(VMM_CACHE_TAG_PHYS))) { break; }
+            ppMEMsSpeculative[cSpeculative] = &ppObCacheSpeculative[cSpeculative]->h;
+            ppMEMsSpeculative[cSpeculative]->cb = 0;
+            ppMEMsSpeculative[cSpeculative]->qwA = paSpeculative;
+            ppMEMsSpeculative[cSpeculative]->pvReserved2 = (PVOID)3;  // 3 == speculative & backed by cache reserved
+            cSpeculative++;
         }
+        InterlockedAdd64(&ctxVmm->stat.cPhysReadAhead, cSpeculative - cSpeculativeRequested);
         ppMEMsPhys = ppMEMsSpeculative;
         cpMEMsPhys = cSpeculative;
     }
-    // 3: read!
-    LeechCore_ReadScatter(ppMEMsPhys, cpMEMsPhys);
+    // 3: read! (sorted, deduplicated and coalesced - or from memory mapped file)
+    if(ctxVmm->MemMap.fEnabled) {
+        VmmMemMap_ReadScatter(ppMEMsPhys, cpMEMsPhys);
+    } else {
+        VmmReadScatterPhysical_Device(ppMEMsPhys, cpMEMsPhys);
+    }
     // 4: statistics and read fail zero fixups (if required)
     for(i = 0; i < cpMEMsPhys; i++) {
         pMEM = ppMEMsPhys[i];
@@ -1334,6 +3448,7 @@ VOID VmmReadScatterPhysical(_Inout_ PPMEM_IO_SCATTER_HEADER ppMEMsPhys, _In_ DWO
         for(i = 0; i < cpMEMsPhys; i++) {
             pMEM = ppMEMsPhys[i];
             if(3 == (QWORD)pMEM->pvReserved2) { // 3 == speculative & backed by cache reserved
+                ppObCacheSpeculative[i]->fSpeculative = (pMEM->cb == 0x1000);
                 VmmCacheReserveReturn(ppObCacheSpeculative[i]);
             }
             if((0 == (QWORD)pMEM->pvReserved2) && (pMEM->cb == 0x1000)) { // 0 = default
@@ -1348,18 +3463,40 @@ VOID VmmReadScatterPhysical(_Inout_ PPMEM_IO_SCATTER_HEADER ppMEMsPhys, _In_ DWO
     }
 }
 
+/*
+* Add a physical page to the physical scatter read list of VmmReadScatterVirtual.
+*/
+inline VOID VmmReadScatterVirtual_AddPhys(_Inout_ PPMEM_IO_SCATTER_HEADER ppMEMsPhys, _In_ PBYTE pbBufferMEMs, _Inout_ PDWORD piPA, _In_ PMEM_IO_SCATTER_HEADER pIoVA, _In_ QWORD qwPA)
+{
+    PMEM_IO_SCATTER_HEADER pIoPA;
+    pIoPA = ppMEMsPhys[*piPA] = (PMEM_IO_SCATTER_HEADER)pbBufferMEMs + *piPA;
+    (*piPA)++;
+    pIoPA->magic = MEM_IO_SCATTER_HEADER_MAGIC;
+    pIoPA->version = MEM_IO_SCATTER_HEADER_VERSION;
+    pIoPA->qwA = qwPA;
+    pIoPA->cbMax = 0x1000;
+    pIoPA->cb = 0;
+    pIoPA->pb = pIoVA->pb;
+    pIoPA->pvReserved1 = (PVOID)pIoVA;
+}
+
 VOID VmmReadScatterVirtual(_In_ PVMM_PROCESS pProcess, _Inout_updates_(cpMEMsVirt) PPMEM_IO_SCATTER_HEADER ppMEMsVirt, _In_ DWORD cpMEMsVirt, _In_ QWORD flags)
 {
     // NB! the buffers pIoPA / ppMEMsPhys are used for both:
     //     - physical memory (grows from 0 upwards)
     //     - paged memory (grows from top downwards).
-    BOOL fVirt2Phys;
-    DWORD i = 0, iVA, iPA;
-    QWORD qwPA, qwPagedPA = 0;
+    BOOL fVirt2Phys, fPaged;
+    DWORD iVA, iPA, iPR, cPR = 0, cPRData;
+    QWORD qwPA, qwPagedPA = 0, tmTrace;
     BYTE pbBufferSmall[0x20 * (sizeof(MEM_IO_SCATTER_HEADER) + sizeof(PMEM_IO_SCATTER_HEADER))];
     PBYTE pbBufferMEMs, pbBufferLarge = NULL;
-    PMEM_IO_SCATTER_HEADER pIoPA, pIoVA;
+    PMEM_IO_SCATTER_HEADER pIoVA;
     PPMEM_IO_SCATTER_HEADER ppMEMsPhys = NULL;
+    PVMM_VIRT2PHYS_BATCH_ENTRY pV2Ps = NULL;
+    PVMM_PAGED_READ_SCATTER_ENTRY pePR, pPRs = NULL;
+    if(!(VMM_FLAG_NOCACHE & (flags | ctxVmm->flags))) {
+        VmmCachePrefetchWait(pProcess->dwPID, ppMEMsVirt, cpMEMsVirt, flags);
+    }
     // 1: allocate / set up buffers (if needed)
     if(cpMEMsVirt < 0x20) {
         ppMEMsPhys = (PPMEM_IO_SCATTER_HEADER)pbBufferSmall;
@@ -1369,41 +3506,90 @@ VOID VmmReadScatterVirtual(_In_ PVMM_PROCESS pProcess, _Inout_updates_(cpMEMsVir
         ppMEMsPhys = (PPMEM_IO_SCATTER_HEADER)pbBufferLarge;
         pbBufferMEMs = pbBufferLarge + cpMEMsVirt * sizeof(PMEM_IO_SCATTER_HEADER);
     }
-    // 2: translate virt2phys
+    fPaged = !(VMM_FLAG_NOPAGING & (flags | ctxVmm->flags)) && ctxVmm->fnMemoryModel.pfnPagedRead;
+    if(fPaged && (cpMEMsVirt > 1) && ctxVmm->fnMemoryModel.pfnPagedReadScatter) {
+        pPRs = LocalAlloc(0, cpMEMsVirt * sizeof(VMM_PAGED_READ_SCATTER_ENTRY));
+    }
+    // 2: translate virt2phys - batch translation walks shared page tables once
+    //    and prefetches missing page tables in one go (if supported by model).
+    if((cpMEMsVirt >= VMM_VIRT2PHYS_BATCH_MIN) && ctxVmm->fnMemoryModel.pfnVirt2PhysBatch) {
+        if((pV2Ps = LocalAlloc(0, cpMEMsVirt * sizeof(VMM_VIRT2PHYS_BATCH_ENTRY)))) {
+            for(iVA = 0; iVA < cpMEMsVirt; iVA++) {
+                pV2Ps[iVA].va = ppMEMsVirt[iVA]->qwA;
+                pV2Ps[iVA].i = iVA;
+            }
+            ctxVmm->fnMemoryModel.pfnVirt2PhysBatch(pProcess, pV2Ps, cpMEMsVirt);
+        }
+    }
     for(iVA = 0, iPA = 0; iVA < cpMEMsVirt; iVA++) {
-        pIoVA = ppMEMsVirt[iVA];
-        qwPA = 0;
-        fVirt2Phys = VmmVirt2Phys(pProcess, pIoVA->qwA, &qwPA);
+        if(pV2Ps) {
+            pIoVA = ppMEMsVirt[pV2Ps[iVA].i];
+            qwPA = pV2Ps[iVA].pa;
+            fVirt2Phys = pV2Ps[iVA].fPhys;
+        } else {
+            pIoVA = ppMEMsVirt[iVA];
+            qwPA = 0;
+            fVirt2Phys = VmmVirt2Phys(pProcess, pIoVA->qwA, &qwPA);
+        }
         // PAGED MEMORY
-        if(!fVirt2Phys && !(VMM_FLAG_NOPAGING & (flags | ctxVmm->flags)) && (pIoVA->cbMax == 0x1000) && ctxVmm->fnMemoryModel.pfnPagedRead) {
+        if(!fVirt2Phys && fPaged && (pIoVA->cbMax == 0x1000)) {
+            if(pPRs) {
+                // defer to scatter paged read below
+                pePR = pPRs + cPR++;
+                pePR->va = pIoVA->qwA;
+                pePR->pte = qwPA;
+                pePR->pbPage = pIoVA->pb;
+                pePR->pvCtx = pIoVA;
+                continue;
+            }
+            tmTrace = VMMTRACE_IS_ENABLED() ? VmmTrace_Start() : 0;
             if(ctxVmm->fnMemoryModel.pfnPagedRead(pProcess, pIoVA->qwA, qwPA, pIoVA->pb, &qwPagedPA, flags)) {
+                if(tmTrace) { VmmTrace_Event(VMMTRACE_EVENT_PAGED_READ, pProcess->dwPID, pIoVA->qwA, VMMTRACE_PAGED_DATA, tmTrace); }
                 pIoVA->cb = 0x1000;
                 continue;
             }
+            if(tmTrace) { VmmTrace_Event(VMMTRACE_EVENT_PAGED_READ, pProcess->dwPID, pIoVA->qwA, (qwPagedPA ? VMMTRACE_PAGED_PHYS : VMMTRACE_PAGED_FAIL), tmTrace); }
             if(qwPagedPA) {
                 qwPA = qwPagedPA;
                 fVirt2Phys = TRUE;
             }
         }
         if(fVirt2Phys) {    // PHYS MEMORY
-            pIoPA = ppMEMsPhys[iPA] = (PMEM_IO_SCATTER_HEADER)pbBufferMEMs + iPA;
-            iPA++;
+            VmmReadScatterVirtual_AddPhys(ppMEMsPhys, pbBufferMEMs, &iPA, pIoVA, qwPA);
         } else {            // NO TRANSLATION MEMORY / FAILED PAGED MEMORY
             pIoVA->cb = 0;
             if(VMM_FLAG_ZEROPAD_ON_FAIL & (flags | ctxVmm->flags)) {
                 ZeroMemory(pIoVA->pb, pIoVA->cbMax);
             }
-            continue;
         }
-        pIoPA->magic = MEM_IO_SCATTER_HEADER_MAGIC;
-        pIoPA->version = MEM_IO_SCATTER_HEADER_VERSION;
-        pIoPA->qwA = qwPA;
-        pIoPA->cbMax = 0x1000;
-        pIoPA->cb = 0;
-        pIoPA->pb = pIoVA->pb;
-        pIoPA->pvReserved1 = (PVOID)pIoVA;
     }
-    // 3: read and check result
+    // 3: resolve deferred paged memory in one go - transition and prototype
+    //    pages are added to the physical read below.
+    if(cPR) {
+        tmTrace = VMMTRACE_IS_ENABLED() ? VmmTrace_Start() : 0;
+        ctxVmm->fnMemoryModel.pfnPagedReadScatter(pProcess, pPRs, cPR, flags);
+        if(tmTrace) {
+            for(iPR = 0, cPRData = 0; iPR < cPR; iPR++) {
+                if(pPRs[iPR].fResult) { cPRData++; }
+            }
+            if(tmTrace) { VmmTrace_Event(VMMTRACE_EVENT_PAGED_READ_BATCH, pProcess->dwPID, cPR, cPRData, tmTrace); }
+        }
+        for(iPR = 0; iPR < cPR; iPR++) {
+            pePR = pPRs + iPR;
+            pIoVA = (PMEM_IO_SCATTER_HEADER)pePR->pvCtx;
+            if(pePR->fResult) {
+                pIoVA->cb = 0x1000;
+            } else if(pePR->pa) {
+                VmmReadScatterVirtual_AddPhys(ppMEMsPhys, pbBufferMEMs, &iPA, pIoVA, pePR->pa);
+            } else {
+                pIoVA->cb = 0;
+                if(VMM_FLAG_ZEROPAD_ON_FAIL & (flags | ctxVmm->flags)) {
+                    ZeroMemory(pIoVA->pb, pIoVA->cbMax);
+                }
+            }
+        }
+    }
+    // 4: read and check result
     if(iPA) {
         VmmReadScatterPhysical(ppMEMsPhys, iPA, flags);
         while(iPA > 0) {
@@ -1412,6 +3598,8 @@ VOID VmmReadScatterVirtual(_In_ PVMM_PROCESS pProcess, _Inout_updates_(cpMEMsVir
         }
     }
     LocalFree(pbBufferLarge);
+    LocalFree(pV2Ps);
+    LocalFree(pPRs);
 }
 
 /*
@@ -1465,12 +3653,123 @@ PVMMOB_PHYS2VIRT_INFORMATION VmmPhys2VirtGetInformation(_In_ PVMM_PROCESS pProce
     return pObP2V;
 }
 
+// ----------------------------------------------------------------------------
+// GLOBAL REVERSE PHYSICAL TO VIRTUAL INDEX:
+// A sorted array per page size level (4kB/2MB/1GB) mapping physical pages to
+// the processes and virtual addresses mapping them. Built on demand in one
+// page table walk of all active processes - lookups are binary searches.
+// ----------------------------------------------------------------------------
+
+VOID VmmPhys2VirtIndex_CloseObCallback(_In_ PVMMOB_PHYS2VIRT_INDEX pOb)
+{
+    DWORD i;
+    for(i = 0; i < VMM_PHYS2VIRT_INDEX_LEVELS; i++) {
+        LocalFree(pOb->pe[i]);
+    }
+}
+
+VOID VmmPhys2VirtIndex_Push(_Inout_ PVMMOB_PHYS2VIRT_INDEX pIndex, _In_ DWORD iLevel, _In_ QWORD pa, _In_ QWORD va, _In_ DWORD dwPID)
+{
+    DWORD cMaxNew;
+    PVMM_PHYS2VIRT_INDEX_ENTRY peNew, pe;
+    if(pIndex->c[iLevel] == pIndex->cMax[iLevel]) {
+        cMaxNew = pIndex->cMax[iLevel] ? min(VMM_PHYS2VIRT_INDEX_MAX_ENTRIES, 2 * pIndex->cMax[iLevel]) : 0x1000;
+        if(cMaxNew == pIndex->cMax[iLevel]) {
+            pIndex->fTruncated = TRUE;
+            return;
+        }
+        peNew = pIndex->pe[iLevel] ?
+            LocalReAlloc(pIndex->pe[iLevel], cMaxNew * sizeof(VMM_PHYS2VIRT_INDEX_ENTRY), LMEM_MOVEABLE) :
+            LocalAlloc(0, cMaxNew * sizeof(VMM_PHYS2VIRT_INDEX_ENTRY));
+        if(!peNew) {
+            pIndex->fTruncated = TRUE;
+            return;
+        }
+        pIndex->pe[iLevel] = peNew;
+        pIndex->cMax[iLevel] = cMaxNew;
+    }
+    pe = pIndex->pe[iLevel] + pIndex->c[iLevel]++;
+    pe->pa = pa;
+    pe->va = va;
+    pe->dwPID = dwPID;
+    pe->_Filler = 0;
+}
+
+int VmmPhys2VirtIndex_CmpSort(_In_ PVMM_PHYS2VIRT_INDEX_ENTRY a, _In_ PVMM_PHYS2VIRT_INDEX_ENTRY b)
+{
+    if(a->pa != b->pa) { return (a->pa < b->pa) ? -1 : 1; }
+    if(a->dwPID != b->dwPID) { return (a->dwPID < b->dwPID) ? -1 : 1; }
+    if(a->va != b->va) { return (a->va < b->va) ? -1 : 1; }
+    return 0;
+}
+
+PVMMOB_PHYS2VIRT_INDEX VmmPhys2VirtIndex_Get(_In_ BOOL fBuildOnMiss)
+{
+    DWORD i;
+    PVMM_PROCESS pObProcess = NULL;
+    PVMMOB_PHYS2VIRT_INDEX pObIndex = NULL;
+    if((pObIndex = ObContainer_GetOb(ctxVmm->pObCPhys2VirtIndex)) || !fBuildOnMiss) { return pObIndex; }
+    if(!ctxVmm->fnMemoryModel.pfnPhys2VirtIndex) { return NULL; }
+    EnterCriticalSection(&ctxVmm->LockUpdatePhys2Virt);
+    if(!(pObIndex = ObContainer_GetOb(ctxVmm->pObCPhys2VirtIndex))) {
+        pObIndex = Ob_Alloc('P2VI', LMEM_ZEROINIT, sizeof(VMMOB_PHYS2VIRT_INDEX), (VOID(*)(PVOID))VmmPhys2VirtIndex_CloseObCallback, NULL);
+        if(pObIndex) {
+            while((pObProcess = VmmProcessGetNext(pObProcess, 0))) {
+                ctxVmm->fnMemoryModel.pfnPhys2VirtIndex(pObProcess, pObIndex);
+            }
+            for(i = 0; i < VMM_PHYS2VIRT_INDEX_LEVELS; i++) {
+                if(pObIndex->c[i]) {
+                    qsort(pObIndex->pe[i], pObIndex->c[i], sizeof(VMM_PHYS2VIRT_INDEX_ENTRY), (int(*)(const void*, const void*))VmmPhys2VirtIndex_CmpSort);
+                }
+            }
+            vmmprintfv_fn("Phys2Virt index built: 4kB: %i 2MB: %i 1GB: %i %s\n", pObIndex->c[0], pObIndex->c[1], pObIndex->c[2], pObIndex->fTruncated ? "(TRUNCATED)" : "");
+            ObContainer_SetOb(ctxVmm->pObCPhys2VirtIndex, pObIndex);
+        }
+    }
+    LeaveCriticalSection(&ctxVmm->LockUpdatePhys2Virt);
+    return pObIndex;
+}
+
+DWORD VmmPhys2VirtIndex_Query(_In_ PVMMOB_PHYS2VIRT_INDEX pIndex, _In_ QWORD pa, _Out_writes_opt_(cMax) PVMM_PHYS2VIRT_INDEX_ENTRY pe, _In_ DWORD cMax)
+{
+    const QWORD PAGE_MASK[VMM_PHYS2VIRT_INDEX_LEVELS] = { 0xfff, 0x1fffff, 0x3fffffff };
+    DWORD iLevel, iLo, iHi, iMid, cResult = 0;
+    QWORD paBase;
+    PVMM_PHYS2VIRT_INDEX_ENTRY peLevel;
+    for(iLevel = 0; iLevel < VMM_PHYS2VIRT_INDEX_LEVELS; iLevel++) {
+        paBase = pa & ~PAGE_MASK[iLevel];
+        peLevel = pIndex->pe[iLevel];
+        // binary search for the first entry with pa >= paBase
+        iLo = 0;
+        iHi = pIndex->c[iLevel];
+        while(iLo < iHi) {
+            iMid = iLo + ((iHi - iLo) >> 1);
+            if(peLevel[iMid].pa < paBase) {
+                iLo = iMid + 1;
+            } else {
+                iHi = iMid;
+            }
+        }
+        for(; (iLo < pIndex->c[iLevel]) && (peLevel[iLo].pa == paBase); iLo++) {
+            if(pe && (cResult < cMax)) {
+                pe[cResult].pa = pa;
+                pe[cResult].va = peLevel[iLo].va + (pa & PAGE_MASK[iLevel]);
+                pe[cResult].dwPID = peLevel[iLo].dwPID;
+                pe[cResult]._Filler = 0;
+            }
+            cResult++;
+        }
+    }
+    return cResult;
+}
+
 // ----------------------------------------------------------------------------
 // PUBLICALLY VISIBLE FUNCTIONALITY RELATED TO VMMU.
 // ----------------------------------------------------------------------------
 
 VOID VmmClose()
 {
+    DWORD i;
     if(!ctxVmm) { return; }
     if(ctxVmm->pVmmVfsModuleList) { PluginManager_Close(); }
     ctxVmm->ThreadWorkers.fEnabled = FALSE;
@@ -1483,6 +3782,14 @@ VOID VmmClose()
     while(ctxVmm->ThreadWorkers.c) {
         SwitchToThread();
     }
+    VmmWork_Close();
+    if(ctxVmm->ReadScatterAsync.hEventComplete) { CloseHandle(ctxVmm->ReadScatterAsync.hEventComplete); }
+    for(i = 0; i < VMM_REMOTE_PREFETCH_INFLIGHT_MAX; i++) {
+        if(ctxVmm->Remote.Prefetch[i].hEventIdle) { CloseHandle(ctxVmm->Remote.Prefetch[i].hEventIdle); }
+    }
+    VmmCacheFile_Close();
+    VmmMemMap_Close();
+    VmmProfile_Close();
     VmmWinReg_Close();
     PDB_Close();
     Ob_DECREF_NULL(&ctxVmm->pObVfsDumpContext);
@@ -1494,15 +3801,34 @@ VOID VmmClose()
     VmmCache2Close(VMM_CACHE_TAG_PHYS);
     VmmCache2Close(VMM_CACHE_TAG_TLB);
     VmmCache2Close(VMM_CACHE_TAG_PAGING);
-    Ob_DECREF_NULL(&ctxVmm->Cache.PAGING_FAILED);
-    Ob_DECREF_NULL(&ctxVmm->Cache.pmPrototypePte);
+    ctxVmm->Cache.PAGING_FAILED.pBucket = NULL;
+    LocalFree(ctxVmm->Cache.PAGING_FAILED.pbAlloc);
+    ctxVmm->Cache.PAGING_FAILED.pbAlloc = NULL;
+    Ob_DECREF_NULL(&ctxVmm->Cache.Dedup.psZero);
+    Ob_DECREF_NULL(&ctxVmm->Cache.Dedup.pmDupPage);
+    Ob_DECREF_NULL(&ctxVmm->Cache.Dedup.pmDupHash);
+    Ob_DECREF_NULL(&ctxVmm->Cache.PrototypePte.pmHot);
+    Ob_DECREF_NULL(&ctxVmm->Cache.PrototypePte.pmCold);
     Ob_DECREF_NULL(&ctxVmm->pObCCachePrefetchEPROCESS);
     Ob_DECREF_NULL(&ctxVmm->pObCCachePrefetchRegistry);
+    Ob_DECREF_NULL(&ctxVmm->pObCPhys2VirtIndex);
+    Ob_DECREF_NULL(&ctxVmm->pmObModuleImage);
+    Ob_DECREF_NULL(&ctxVmm->pmObHandleText);
+    Ob_DECREF_NULL(&ctxVmm->pmObVfsPath);
+    Ob_DECREF_NULL(&ctxVmm->pmObPluginRender);
+    Ob_DECREF_NULL(&ctxVmm->Notify.psPending);
+    Ob_DECREF_NULL(&ctxVmm->TcpIp.pObTcHT);
+    Ob_DECREF_NULL(&ctxVmm->TcpIp.pmTcpE);
     DeleteCriticalSection(&ctxVmm->TcpIp.LockUpdate);
     DeleteCriticalSection(&ctxVmm->MasterLock);
+    DeleteCriticalSection(&ctxVmm->LockUpdateProc);
+    DeleteCriticalSection(&ctxVmm->LockUpdatePhys2Virt);
+    DeleteCriticalSection(&ctxVmm->ObjectTypeTable.LockUpdate);
+    DeleteCriticalSection(&ctxVmm->WorkPool.Lock);
     LocalFree(ctxVmm->ObjectTypeTable.wszMultiText);
     LocalFree(ctxVmm);
     ctxVmm = NULL;
+    Ob_PoolTrim();
 }
 
 VOID VmmWriteEx(_In_opt_ PVMM_PROCESS pProcess, _In_ QWORD qwA, _In_ PBYTE pb, _In_ DWORD cb, _Out_opt_ PDWORD pcbWrite)
@@ -1551,16 +3877,76 @@ BOOL VmmWrite(_In_opt_ PVMM_PROCESS pProcess, _In_ QWORD qwA, _In_reads_(cb) PBY
     return (cbWrite == cb);
 }
 
+/*
+* Fast path of VmmReadEx for small reads (at most one page - possibly straddling
+* two pages). The read is served directly from the PHYS cache - after address
+* translation via the software tlb / TLB cache - without setting up any scatter
+* headers or bounce buffers. If any page is not in the cache (or cannot be
+* translated to a physical address) nothing is read and the caller must fall
+* back to the scatter read path.
+* -- pProcess
+* -- qwA
+* -- pb
+* -- cb = 1-0x1000 bytes.
+* -- return = TRUE if the whole read was served from the cache.
+*/
+_Success_(return)
+BOOL VmmReadEx_SmallCached(_In_opt_ PVMM_PROCESS pProcess, _In_ QWORD qwA, _Out_writes_(cb) PBYTE pb, _In_ DWORD cb)
+{
+    DWORD i, cPages, cbP;
+    QWORD pa, va[2];
+    PVMMOB_MEM pObCache[2] = { 0 };
+    cPages = (((qwA & 0xfff) + cb) > 0x1000) ? 2 : 1;
+    va[0] = qwA & ~0xfff;
+    va[1] = va[0] + 0x1000;
+    for(i = 0; i < cPages; i++) {
+        if(pProcess) {
+            if(!VmmVirt2Phys(pProcess, va[i], &pa)) { goto fail; }
+        } else {
+            pa = va[i];
+        }
+        if(!(pObCache[i] = VmmCacheGet(VMM_CACHE_TAG_PHYS, pa & ~0xfff))) { goto fail; }
+    }
+    cbP = min(cb, 0x1000 - (DWORD)(qwA & 0xfff));
+    memcpy(pb, pObCache[0]->pb + (qwA & 0xfff), cbP);
+    if(cPages == 2) {
+        memcpy(pb + cbP, pObCache[1]->pb, cb - cbP);
+    }
+    for(i = 0; i < cPages; i++) {
+        if(pObCache[i]->fSpeculative && InterlockedExchange((volatile LONG*)&pObCache[i]->fSpeculative, FALSE)) {
+            InterlockedIncrement64(&ctxVmm->stat.cPhysReadAheadHit);
+        }
+        InterlockedIncrement64(&ctxVmm->stat.cPhysCacheHit);
+        Ob_DECREF(pObCache[i]);
+    }
+    return TRUE;
+fail:
+    Ob_DECREF(pObCache[0]);
+    return FALSE;
+}
+
 VOID VmmReadEx(_In_opt_ PVMM_PROCESS pProcess, _In_ QWORD qwA, _Out_writes_(cb) PBYTE pb, _In_ DWORD cb, _Out_opt_ PDWORD pcbReadOpt, _In_ QWORD flags)
 {
     DWORD cbP, cMEMs, cbRead = 0;
     PBYTE pbBuffer;
     PMEM_IO_SCATTER_HEADER pMEMs, *ppMEMs;
     QWORD i, oA;
+    BYTE pbBufferSmall[0x2000 + 2 * (sizeof(MEM_IO_SCATTER_HEADER) + sizeof(PMEM_IO_SCATTER_HEADER))];
     if(pcbReadOpt) { *pcbReadOpt = 0; }
     if(!cb) { return; }
+    // 1: small read fast path - served directly from cache pages (if possible)
+    if((cb <= 0x1000) && !(VMM_FLAG_NOCACHE & (flags | ctxVmm->flags)) && VmmReadEx_SmallCached(pProcess, qwA, pb, cb)) {
+        if(pcbReadOpt) { *pcbReadOpt = cb; }
+        return;
+    }
+    // 2: scatter read - small reads (max two pages) use a stack buffer
     cMEMs = (DWORD)(((qwA & 0xfff) + cb + 0xfff) >> 12);
-    pbBuffer = (PBYTE)LocalAlloc(LMEM_ZEROINIT, 0x2000 + cMEMs * (sizeof(MEM_IO_SCATTER_HEADER) + sizeof(PMEM_IO_SCATTER_HEADER)));
+    if(cMEMs <= 2) {
+        pbBuffer = pbBufferSmall;
+        ZeroMemory(pbBuffer + 0x2000, cMEMs * (sizeof(MEM_IO_SCATTER_HEADER) + sizeof(PMEM_IO_SCATTER_HEADER)));
+    } else {
+        pbBuffer = (PBYTE)LocalAlloc(LMEM_ZEROINIT, 0x2000 + cMEMs * (sizeof(MEM_IO_SCATTER_HEADER) + sizeof(PMEM_IO_SCATTER_HEADER)));
+    }
     if(!pbBuffer) {
         ZeroMemory(pb, cb);
         return;
@@ -1616,7 +4002,9 @@ VOID VmmReadEx(_In_opt_ PVMM_PROCESS pProcess, _In_ QWORD qwA, _Out_writes_(cb)
         }
     }
     if(pcbReadOpt) { *pcbReadOpt = cbRead; }
-    LocalFree(pbBuffer);
+    if(pbBuffer != pbBufferSmall) {
+        LocalFree(pbBuffer);
+    }
 }
 
 #define STATUS_SUCCESS                   ((NTSTATUS)0x00000000L)
@@ -1730,6 +4118,57 @@ BOOL VmmRead_U2A_Alloc(_In_ PVMM_PROCESS pProcess, _In_ BOOL f32, _In_ QWORD fla
     return TRUE;
 }
 
+VOID VmmReadPlan_Execute(_In_opt_ PVMM_PROCESS pProcess, _In_ BOOL f32, _In_ QWORD flags, _In_ DWORD cEntries, _Inout_updates_(cEntries) PVMM_READPLAN_ENTRY pEntries)
+{
+    DWORD i;
+    WORD cch;
+    PVMM_READPLAN_ENTRY pe;
+    POB_VSET pObPrefetch = NULL;
+    BOOL fPrefetch = !(VMM_FLAG_NOCACHE & (flags | ctxVmm->flags)) && (pObPrefetch = ObVSet_New());
+    // 1: stage 1 - prefetch & read data and _UNICODE_STRING headers
+    for(i = 0; fPrefetch && (i < cEntries); i++) {
+        pe = pEntries + i;
+        ObVSet_Push_PageAlign(pObPrefetch, pe->va, (pe->tp == VMM_READPLAN_TP_U2A_ALLOC) ? (f32 ? 8 : 16) : pe->cb);
+    }
+    VmmCachePrefetchPages(pProcess, pObPrefetch, flags);
+    for(i = 0; i < cEntries; i++) {
+        pe = pEntries + i;
+        pe->fResult = FALSE;
+        if(pe->tp == VMM_READPLAN_TP_U2A_ALLOC) {
+            *pe->psz = NULL;
+            if(pe->pcch) { *pe->pcch = 0; }
+            if(!VmmRead_U2A_Size(pProcess, f32, flags, pe->va, &pe->_vaStr, &pe->_cbStr)) {
+                pe->_cbStr = 0;
+            }
+        } else {
+            pe->fResult = VmmRead2(pProcess, pe->va, pe->pb, pe->cb, flags);
+        }
+    }
+    // 2: stage 2 - prefetch & read string buffers
+    if(fPrefetch) {
+        ObVSet_Clear(pObPrefetch);
+        for(i = 0; i < cEntries; i++) {
+            pe = pEntries + i;
+            if((pe->tp == VMM_READPLAN_TP_U2A_ALLOC) && pe->_cbStr) {
+                ObVSet_Push_PageAlign(pObPrefetch, pe->_vaStr, pe->_cbStr);
+            }
+        }
+        VmmCachePrefetchPages(pProcess, pObPrefetch, flags);
+    }
+    for(i = 0; i < cEntries; i++) {
+        pe = pEntries + i;
+        if((pe->tp != VMM_READPLAN_TP_U2A_ALLOC) || !pe->_cbStr) { continue; }
+        cch = (pe->_cbStr >> 1) + 1;
+        if(!(*pe->psz = LocalAlloc(0, cch))) { continue; }
+        pe->fResult = VmmRead_U2A_RawStr(pProcess, flags, pe->_vaStr, pe->_cbStr, *pe->psz, cch, pe->pcch, NULL);
+        if(!pe->fResult) {
+            LocalFree(*pe->psz);
+            *pe->psz = NULL;
+        }
+    }
+    Ob_DECREF(pObPrefetch);
+}
+
 _Success_(return)
 BOOL VmmRead(_In_opt_ PVMM_PROCESS pProcess, _In_ QWORD qwA, _Out_writes_(cb) PBYTE pb, _In_ DWORD cb)
 {
@@ -1754,6 +4193,47 @@ BOOL VmmReadPage(_In_opt_ PVMM_PROCESS pProcess, _In_ QWORD qwA, _Out_writes_(40
     return cb == 0x1000;
 }
 
+PVMMOB_MEM VmmReadPageRef(_In_opt_ PVMM_PROCESS pProcess, _In_ QWORD qwA, _In_ QWORD flags)
+{
+    QWORD pa;
+    DWORD cbRead;
+    PVMMOB_MEM pObMEM;
+    PMEM_IO_SCATTER_HEADER pMEM;
+    qwA &= ~0xfff;
+    // 1: physical memory backed page -> retrieve from PHYS cache (or device)
+    if(!(VMM_FLAG_NOCACHE & (flags | ctxVmm->flags)) && (!pProcess || VmmVirt2Phys(pProcess, qwA, &pa))) {
+        if(!pProcess) { pa = qwA; }
+        if((pObMEM = VmmCacheGet(VMM_CACHE_TAG_PHYS, pa))) {
+            InterlockedIncrement64(&ctxVmm->stat.cPhysCacheHit);
+            return pObMEM;
+        }
+        if(VMM_FLAG_FORCECACHE_READ & flags) { return NULL; }
+        if(!(pObMEM = VmmCacheReserve(VMM_CACHE_TAG_PHYS))) { return NULL; }
+        pMEM = &pObMEM->h;
+        pMEM->qwA = pa;
+        LeechCore_ReadScatter(&pMEM, 1);
+        if(pMEM->cb == 0x1000) {
+            InterlockedIncrement64(&ctxVmm->stat.cPhysReadSuccess);
+            Ob_INCREF(pObMEM);
+            VmmCacheReserveReturn(pObMEM);
+            return pObMEM;
+        }
+        InterlockedIncrement64(&ctxVmm->stat.cPhysReadFail);
+        VmmCacheReserveReturn(pObMEM);
+        if(!(flags & VMM_FLAG_ZEROPAD_ON_FAIL)) { return NULL; }
+    }
+    // 2: paged out, non-cached or failed page -> read into private cache object.
+    //    the private object is never inserted into the cache; once released it
+    //    is returned to the cache empty list by the refcount-1 callback.
+    if(!(pObMEM = VmmCacheReserve(VMM_CACHE_TAG_PHYS))) { return NULL; }
+    VmmReadEx(pProcess, qwA, pObMEM->pb, 0x1000, &cbRead, flags);
+    if(cbRead != 0x1000) {
+        Ob_DECREF(pObMEM);
+        return NULL;
+    }
+    return pObMEM;
+}
+
 VOID VmmInitializeMemoryModel(_In_ VMM_MEMORYMODEL_TP tp)
 {
     switch(tp) {
@@ -1784,11 +4264,15 @@ VOID VmmInitializeFunctions()
 
 BOOL VmmInitialize()
 {
+    DWORD i;
     // 1: allocate & initialize
     if(ctxVmm) { VmmClose(); }
     ctxVmm = (PVMM_CONTEXT)LocalAlloc(LMEM_ZEROINIT, sizeof(VMM_CONTEXT));
     if(!ctxVmm) { goto fail; }
     ctxVmm->hModuleVmm = GetModuleHandleA("vmm");
+    QueryPerformanceFrequency((PLARGE_INTEGER)&ctxVmm->stat.dev.qwFreq);
+    QueryPerformanceCounter((PLARGE_INTEGER)&ctxVmm->stat.dev.tmInitialize);
+    VmmNuma_Initialize();
     // 2: CACHE INIT: Process Table
     if(!VmmProcessTableCreateInitial()) { goto fail; }
     // 3: CACHE INIT: Translation Lookaside Buffer (TLB) Cache Table
@@ -1797,17 +4281,47 @@ BOOL VmmInitialize()
     // 4: CACHE INIT: Physical Memory Cache Table
     VmmCache2Initialize(VMM_CACHE_TAG_PHYS);
     if(!ctxVmm->Cache.PHYS.fActive) { goto fail; }
+    if(!(ctxVmm->Cache.Dedup.psZero = ObVSet_New())) { goto fail; }
+    if(!(ctxVmm->Cache.Dedup.pmDupPage = ObMap_New(OB_MAP_FLAGS_SHARDED))) { goto fail; }
+    if(!(ctxVmm->Cache.Dedup.pmDupHash = ObMap_New(OB_MAP_FLAGS_SHARDED))) { goto fail; }
+    ctxVmm->Cache.Dedup.tp = VMM_CACHE_DEDUP_ZERO;
     // 5: CACHE INIT: Paged Memory Cache Table
     VmmCache2Initialize(VMM_CACHE_TAG_PAGING);
     if(!ctxVmm->Cache.PAGING.fActive) { goto fail; }
-    if(!(ctxVmm->Cache.PAGING_FAILED = ObVSet_New())) { goto fail; }
+    if(!(ctxVmm->Cache.PAGING_FAILED.pbAlloc = LocalAlloc(LMEM_ZEROINIT, VMM_PAGING_FAILED_BUCKETS * sizeof(VMM_PAGING_FAILED_BUCKET) + 0x40))) { goto fail; }
+    ctxVmm->Cache.PAGING_FAILED.pBucket = (PVMM_PAGING_FAILED_BUCKET)(((QWORD)ctxVmm->Cache.PAGING_FAILED.pbAlloc + 0x3f) & ~0x3f);
+    VmmCachePagingFailedSetTTL(VMM_PAGING_FAILED_TTL_MS_DEFAULT);
+    VmmCacheSetBudget(ctxMain->cfg.cMB_CacheBudget ? ctxMain->cfg.cMB_CacheBudget : VMM_CACHE_BUDGET_MB_DEFAULT);
+    VmmCacheSetPolicy(ctxMain->cfg.tpCachePolicy);
     // 6: CACHE INIT: Prototype PTE Cache Map
-    if(!(ctxVmm->Cache.pmPrototypePte = ObMap_New(OB_MAP_FLAGS_OBJECT_OB))) { goto fail; }
+    InitializeSRWLock(&ctxVmm->Cache.PrototypePte.LockSRW);
+    if(!(ctxVmm->Cache.PrototypePte.pmHot = ObMap_New(OB_MAP_FLAGS_OBJECT_OB | OB_MAP_FLAGS_SHARDED))) { goto fail; }
+    if(!(ctxVmm->Cache.PrototypePte.pmCold = ObMap_New(OB_MAP_FLAGS_OBJECT_OB | OB_MAP_FLAGS_SHARDED))) { goto fail; }
+    ctxVmm->Cache.PrototypePte.cbMax = (QWORD)VMM_PROTOTYPEPTE_CACHE_MB_DEFAULT << 20;
     // 7: OTHER INIT:
     ctxVmm->pObCCachePrefetchEPROCESS = ObContainer_New(NULL);
     ctxVmm->pObCCachePrefetchRegistry = ObContainer_New(NULL);
+    ctxVmm->pObCPhys2VirtIndex = ObContainer_New(NULL);
+    ctxVmm->pmObModuleImage = ObMap_New(OB_MAP_FLAGS_OBJECT_OB);
+    ctxVmm->pmObHandleText = ObMap_New(OB_MAP_FLAGS_OBJECT_OB);
+    ctxVmm->pmObVfsPath = ObMap_New(OB_MAP_FLAGS_OBJECT_OB);
+    ctxVmm->pmObPluginRender = ObMap_New(OB_MAP_FLAGS_OBJECT_OB);
+    ctxVmm->Notify.psPending = ObVSet_New();
+    InitializeSRWLock(&ctxVmm->Notify.LockSRW);
     InitializeCriticalSection(&ctxVmm->MasterLock);
+    InitializeCriticalSection(&ctxVmm->LockUpdateProc);
+    InitializeCriticalSection(&ctxVmm->LockUpdatePhys2Virt);
+    InitializeCriticalSection(&ctxVmm->ObjectTypeTable.LockUpdate);
     InitializeCriticalSection(&ctxVmm->TcpIp.LockUpdate);
+    InitializeCriticalSection(&ctxVmm->WorkPool.Lock);
+    if(!(ctxVmm->ReadScatterAsync.hEventComplete = CreateEvent(NULL, FALSE, FALSE, NULL))) { goto fail; }
+    ctxVmm->ReadScatterAsync.cMaxInFlight = VMM_READSCATTER_ASYNC_INFLIGHT_DEFAULT;
+    InitializeSRWLock(&ctxVmm->Remote.LockPrefetchSRW);
+    for(i = 0; i < VMM_REMOTE_PREFETCH_INFLIGHT_MAX; i++) {
+        if(!(ctxVmm->Remote.Prefetch[i].hEventIdle = CreateEvent(NULL, TRUE, TRUE, NULL))) { goto fail; }
+    }
+    ctxVmm->Remote.cPipelineDepth = VMM_REMOTE_PIPELINE_DEPTH_DEFAULT;
+    ctxVmm->Remote.fPrefetchAsync = TRUE;
     VmmInitializeFunctions();
     return TRUE;
 fail:
@@ -9,6 +9,7 @@
 #include <stdio.h>
 #include "leechcore.h"
 #include "ob.h"
+#include "pidhash.h"
 
 typedef unsigned __int64                QWORD, *PQWORD;
 
@@ -22,7 +23,9 @@ typedef unsigned __int64                QWORD, *PQWORD;
 #define VMM_STATUS_FILE_INVALID                 ((NTSTATUS)0xC0000098L)
 #define VMM_STATUS_FILE_SYSTEM_LIMITATION       ((NTSTATUS)0xC0000427L)
 
-#define VMM_PROCESSTABLE_ENTRIES_MAX            0x4000
+#define VMM_PROCESSTABLE_ENTRIES_MAX            0x00100000
+#define VMM_PROCESSTABLE_ENTRIES_MIN            0x100
+#define VMM_PROCESSTABLE_INDEX_NONE             ((DWORD)-1)
 #define VMM_PROCESS_OS_ALLOC_PTR_MAX            0x4    // max number of operating system specific pointers that must be free'd
 #define VMM_MEMMAP_ENTRIES_MAX                  0x4000
 
@@ -35,9 +38,21 @@ typedef unsigned __int64                QWORD, *PQWORD;
 #define VMM_MEMMAP_FLAG_SCAN_PE                 0x0002
 #define VMM_MEMMAP_FLAG_ALL                     (VMM_MEMMAP_FLAG_MODULES | VMM_MEMMAP_FLAG_SCAN_PE)
 
-#define VMM_CACHE_TABLESIZE                     0x4011  // (not even # to prevent clogging at specific table 'hash' buckets)
-#define VMM_CACHE_TLB_ENTRIES                   0x4000  // -> 64MB of cached data
-#define VMM_CACHE_PHYS_ENTRIES                  0x4000  // -> 64MB of cached data
+#define VMM_CACHE_BUDGET_MB_DEFAULT             384     // -> 128MB of cached data per PHYS/TLB/PAGING cache
+#define VMM_CACHE_BUDGET_MB_MIN                 12
+#define VMM_CACHE_BUDGET_MB_MAX                 0x00100000
+
+#define VMM_READSCATTER_ASYNC_INFLIGHT_DEFAULT  4
+#define VMM_READSCATTER_ASYNC_INFLIGHT_MAX      64
+
+#define VMM_REMOTE_PIPELINE_DEPTH_DEFAULT       4
+#define VMM_REMOTE_PIPELINE_DEPTH_MAX           16
+#define VMM_REMOTE_PIPELINE_MINPAGES            0x40    // min pages per pipelined remote request
+#define VMM_REMOTE_PREFETCH_INFLIGHT_MAX        4       // max outstanding asynchronous remote prefetches
+#define VMM_REMOTE_PREFETCH_WAIT_MS             5000    // max time a read waits for an overlapping remote prefetch
+
+#define VMM_WORK_THREADS_MIN                    4
+#define VMM_WORK_THREADS_MAX                    0x20
 
 #define VMM_FLAG_NOCACHE                        0x00000001  // do not use the data cache (force reading from memory acquisition device).
 #define VMM_FLAG_ZEROPAD_ON_FAIL                0x00000002  // zero pad failed physical memory reads and report success if read within range of physical memory.
@@ -47,6 +62,7 @@ typedef unsigned __int64                QWORD, *PQWORD;
 #define VMM_FLAG_NOPAGING_IO                    0x00000020  // do not try to retrieve memory from paged out memory if read would incur additional I/O (even if possible).
 #define VMM_FLAG_PAGING_LOOP_PROTECT_BITS       0x00ff0000  // placeholder bits for paging loop protect counter.
 #define VMM_FLAG_NOVAD                          0x01000000  // do not try to retrieve memory from backing VAD even if otherwise possible.
+#define VMM_FLAG_NOPREFETCHWAIT                 0x02000000  // do not wait for overlapping asynchronous remote prefetches (used by the prefetch itself).
 
 #define PAGE_SIZE                               0x1000
 #define VMM_POOLTAG(v, tag)                     (v == _byteswap_ulong(tag))
@@ -171,6 +187,9 @@ typedef struct tdVMM_MAP_HEAPENTRY {
         };
         QWORD qwHeapData;
     };
+    QWORD vaHeap;                   // heap (_HEAP) the segment belongs to
+    QWORD vaFirstEntry;             // segment range: first heap entry
+    QWORD vaLastValidEntry;         // segment range: end of last valid entry
 } VMM_MAP_HEAPENTRY, *PVMM_MAP_HEAPENTRY;
 
 typedef struct tdVMM_MAP_THREADENTRY {
@@ -190,7 +209,8 @@ typedef struct tdVMM_MAP_THREADENTRY {
     QWORD vaStackLimitUser;         // value from _NT_TIB / _TEB
     QWORD vaStackBaseKernel;
     QWORD vaStackLimitKernel;
-    DWORD _FutureUse[10];
+    DWORD dwGeneration;             // thread map change generation (VMMOB_MAP_THREAD.dwThreadGeneration) in which entry was added or last changed
+    DWORD _FutureUse[9];
 } VMM_MAP_THREADENTRY, *PVMM_MAP_THREADENTRY;
 
 typedef struct tdVMM_MAP_HANDLEENTRY {
@@ -211,47 +231,70 @@ typedef struct tdVMM_MAP_HANDLEENTRY {
     QWORD _Reserved2;
 } VMM_MAP_HANDLEENTRY, *PVMM_MAP_HANDLEENTRY;
 
+#define VMM_MAP_INDEX_MIN           0x20    // min # map entries to build search index for
+#define VMM_MAP_INDEX_BLOCK         8       // # keys per (cache line sized) index block
+
+// Compact search index of the sorted start addresses of a map. The keys are
+// stored separately from the (large) map entries in cache line sized blocks
+// (padded with -1). The first key of each block is also stored in pvaBlock.
+typedef struct tdVMMOB_MAP_INDEX {
+    OB ObHdr;
+    DWORD cMap;                     // # keys (= # map entries).
+    DWORD cBlock;                   // # blocks.
+    PQWORD pvaBlock;                // first key of each block.
+    QWORD pva[];                    // keys: cBlock * VMM_MAP_INDEX_BLOCK.
+} VMMOB_MAP_INDEX, *PVMMOB_MAP_INDEX;
+
 typedef struct tdVMMOB_MAP_PTE {
     OB ObHdr;
+    QWORD qwGeneration;             // map object generation (VmmGenerationNext).
     LPWSTR wszMultiText;            // NULL or multi-wstr pointed into by VMM_MAP_PTEENTRY.wszText
     DWORD cbMultiText;
     BOOL fTagScan;                  // map contains tags from modules and scan.
+    PVMMOB_MAP_INDEX volatile pObIndex; // NULL or search index (built on first lookup).
     DWORD cMap;                     // # map entries.
     VMM_MAP_PTEENTRY pMap[];        // map entries.
 } VMMOB_MAP_PTE, *PVMMOB_MAP_PTE;
 
 typedef struct tdVMMOB_MAP_VAD {
     OB ObHdr;
-    BOOL fSpiderPrototypePte;
+    QWORD qwGeneration;             // map object generation (VmmGenerationNext).
     LPWSTR wszMultiText;            // NULL or multi-wstr pointed into by VMM_MAP_VADENTRY.wszText
     DWORD cbMultiText;
+    PVMMOB_MAP_INDEX volatile pObIndex; // NULL or search index (built on first lookup).
     DWORD cMap;                     // # map entries.
     VMM_MAP_VADENTRY pMap[];        // map entries.
 } VMMOB_MAP_VAD, *PVMMOB_MAP_VAD;
 
 typedef struct tdVMMOB_MAP_MODULE {
     OB ObHdr;
+    QWORD qwGeneration;             // map generation - retained across rebuilds if unchanged.
     PQWORD pHashTableLookup;
     LPWSTR wszMultiText;            // multi-wstr pointed into by VMM_MAP_MODULEENTRY.wszText
     DWORD cbMultiText;
     DWORD cMap;                     // # map entries.
+    POB_MAP volatile pmObExportIndex;   // lazy loaded export indexes by module base (pe.c)
     VMM_MAP_MODULEENTRY pMap[];     // map entries.
 } VMMOB_MAP_MODULE, *PVMMOB_MAP_MODULE;
 
 typedef struct tdVMMOB_MAP_HEAP {
     OB ObHdr;
+    QWORD qwGeneration;              // map object generation (VmmGenerationNext).
     DWORD cMap;                      // # map entries.
     VMM_MAP_HEAPENTRY pMap[];        // map entries.
 } VMMOB_MAP_HEAP, *PVMMOB_MAP_HEAP;
 
 typedef struct tdVMMOB_MAP_THREAD {
     OB ObHdr;
+    QWORD qwGeneration;              // map object generation (VmmGenerationNext) - shared with all maps and process tables.
+    DWORD dwThreadGeneration;        // thread change generation (ctxVmm->dwThreadMapGeneration) for VMMDLL_ProcessMap_GetThreadChanged.
     DWORD cMap;                      // # map entries.
     VMM_MAP_THREADENTRY pMap[];      // map entries.
 } VMMOB_MAP_THREAD, *PVMMOB_MAP_THREAD;
 
 typedef struct tdVMMOB_MAP_HANDLE {
     OB ObHdr;
+    QWORD qwGeneration;             // map generation - retained across rebuilds if unchanged.
     LPWSTR wszMultiText;            // multi-wstr pointed into by VMM_MAP_HANDLEENTRY.wszText
     DWORD cbMultiText;
     DWORD cMap;                     // # map entries.
@@ -277,12 +320,35 @@ typedef struct tdVMMOB_PHYS2VIRT_INFORMATION {
     QWORD pvaList[VMM_PHYS2VIRT_INFORMATION_MAX_PROCESS_RESULT];
 } VMMOB_PHYS2VIRT_INFORMATION, *PVMMOB_PHYS2VIRT_INFORMATION;
 
+#define VMM_PHYS2VIRT_INDEX_LEVELS                      3           // 4kB, 2MB, 1GB pages
+#define VMM_PHYS2VIRT_INDEX_MAX_ENTRIES                 0x01000000  // max entries per level
+
+typedef struct tdVMM_PHYS2VIRT_INDEX_ENTRY {
+    QWORD pa;
+    QWORD va;
+    DWORD dwPID;
+    DWORD _Filler;
+} VMM_PHYS2VIRT_INDEX_ENTRY, *PVMM_PHYS2VIRT_INDEX_ENTRY;
+
+typedef struct tdVMMOB_PHYS2VIRT_INDEX {
+    OB ObHdr;
+    BOOL fTruncated;                // too many entries - index is incomplete
+    DWORD c[VMM_PHYS2VIRT_INDEX_LEVELS];
+    DWORD cMax[VMM_PHYS2VIRT_INDEX_LEVELS];
+    PVMM_PHYS2VIRT_INDEX_ENTRY pe[VMM_PHYS2VIRT_INDEX_LEVELS];  // sorted on pa, dwPID, va
+} VMMOB_PHYS2VIRT_INDEX, *PVMMOB_PHYS2VIRT_INDEX;
+
 // 'static' process information that should be kept even in the ase of a total
 // process refresh. Only use for information that may never change or things
 // that may not affect analysis (like cache preload addresses that only may
 // speed things up - but not change analysis result). May also be used by
 // internal plugins to store persistent information in various plugin-internal
 // thread safe ways. Use with extreme care!
+typedef struct tdVMM_MAP_GENERATION {
+    QWORD qwHash;                   // content hash of most recently built map (0 = not yet built)
+    QWORD qwGeneration;             // generation of most recently built map
+} VMM_MAP_GENERATION, *PVMM_MAP_GENERATION;
+
 typedef struct tdVMMOB_PROCESS_PERSISTENT {
     OB ObHdr;
     BOOL fIsPostProcessingComplete;
@@ -290,6 +356,13 @@ typedef struct tdVMMOB_PROCESS_PERSISTENT {
     POB_CONTAINER pObCLdrModulesPrefetch32;
     POB_CONTAINER pObCLdrModulesPrefetch64;
     POB_CONTAINER pObCMapThreadPrefetch;
+    POB_CONTAINER pObCMapThreadPrevious;    // most recent thread map (generation tracking across refreshes)
+    POB_CONTAINER pObCMapPteCache;      // memory model specific page table -> pte map entries cache (incremental pte map rebuild)
+    struct {                            // map generation tracking across refreshes (change notifications)
+        SRWLOCK LockSRW;                // shared by old/new process objects - LockUpdate is per process object
+        VMM_MAP_GENERATION Module;
+        VMM_MAP_GENERATION Handle;
+    } MapGeneration;
     VMMWIN_USER_PROCESS_PARAMETERS UserProcessParams;
     // kernel path and long name (from EPROCESS.SeAuditProcessCreationInfo)
     WORD cchNameLong;
@@ -303,6 +376,17 @@ typedef struct tdVMMOB_PROCESS_PERSISTENT {
     } Plugin;
 } VMMOB_PROCESS_PERSISTENT, *PVMMOB_PROCESS_PERSISTENT;
 
+#define VMM_PROCESS_SOFTTLB_ENTRIES     0x80    // # entries in process software tlb (power of 2)
+
+typedef struct tdVMM_SOFTTLB_ENTRY {
+    volatile DWORD dwSeq;           // seqlock: odd while entry is updated
+    DWORD dwTlbGeneration;          // TLB cache generation at time of insert
+    DWORD dwInvalidateGeneration;   // page table invalidation generation at time of insert
+    DWORD _Filler;
+    QWORD vaPage;
+    QWORD paPage;
+} VMM_SOFTTLB_ENTRY, *PVMM_SOFTTLB_ENTRY;
+
 typedef struct tdVMM_PROCESS {
     OB ObHdr;
     CRITICAL_SECTION LockUpdate;
@@ -342,22 +426,59 @@ typedef struct tdVMM_PROCESS {
         POB_CONTAINER pObCLdrModulesDisplayCache;
         POB_CONTAINER pObCPeDumpDirCache;
         POB_CONTAINER pObCPhys2Virt;
+        POB_MAP pmObPeFileRawLayout;    // module base -> reconstructed raw pe file layout (pe.c)
     } Plugin;
+    // direct mapped va->pa translation cache in front of the page table walk.
+    VMM_SOFTTLB_ENTRY SoftTlb[VMM_PROCESS_SOFTTLB_ENTRIES];
 } VMM_PROCESS, *PVMM_PROCESS;
 
 typedef struct tdVMMOB_PROCESS_TABLE {
     OB ObHdr;
+    QWORD qwGeneration;             // process table generation (VmmGenerationNext) - assigned on publish
     SIZE_T c;                       // Total # of processes in table
     SIZE_T cActive;                 // # of active processes (state = 0) in table
-    WORD _iFLink;
-    WORD _iFLinkM[VMM_PROCESSTABLE_ENTRIES_MAX];
-    PVMM_PROCESS _M[VMM_PROCESSTABLE_ENTRIES_MAX];
+    DWORD cMax;                     // # of process entries in table (power of two, sized from previous table)
+    PIDHASH _Hash;                  // PID hash index - key i is the PID of _M[i]
+    PVMM_PROCESS *_M;               // [cMax] contiguous processes in insertion order [0..c)
     POB_CONTAINER pObCNewPROC;      // contains VMM_PROCESS_TABLE
 } VMMOB_PROCESS_TABLE, *PVMMOB_PROCESS_TABLE;
 
 #define VMM_CACHE2_REGIONS      17
 #define VMM_CACHE2_BUCKETS      2039
-#define VMM_CACHE2_MAX_ENTRIES  0x8000
+#define VMM_CACHE2_MIN_ENTRIES  0x400
+#define VMM_CACHE2_READER_SHARDS    16  // per-processor lock-free reader state shards
+
+#define VMM_CACHE2_2Q_HOT_PERCENT   75
+
+#define VMM_NUMA_NODES_MAX          8
+#define VMM_NUMA_PROCESSORS_MAX     0x100   // processor index = group * 64 + number
+
+#define VMM_CACHE_POLICY_AGE    0   // evict oldest inserted entry
+#define VMM_CACHE_POLICY_2Q     1   // scan resistant 2Q - probationary + hot list
+#define VMM_CACHE_POLICY_MAX    1
+
+#define VMM_CACHE_DEDUP_NONE        0   // no phys cache content deduplication
+#define VMM_CACHE_DEDUP_ZERO        1   // zero-filled pages are tracked by address only (default)
+#define VMM_CACHE_DEDUP_DUPLICATE   2   // + pages identical to a cached page (by content hash)
+#define VMM_CACHE_DEDUP_MAX         2
+#define VMM_CACHE_DEDUP_MAX_ENTRIES 0x00400000
+
+#define VMM_PAGING_FAILED_BUCKETS       0x4000      // negative paging cache: # buckets (power of 2)
+#define VMM_PAGING_FAILED_WAYS          4           // negative paging cache: slots per bucket (one 32-byte probe)
+#define VMM_PAGING_FAILED_TICK_SHIFT    6           // negative paging cache: age unit = 2^6 ms
+#define VMM_PAGING_FAILED_TTL_MS_DEFAULT    60000
+#define VMM_PAGING_FAILED_TTL_MS_MAX        0x0fffffff
+
+#define VMM_TLB_NEGATIVE_ENTRIES        0x400       // negative tlb cache: # direct mapped entries (power of 2)
+#define VMM_TLB_VERIFY_PARALLEL_CHUNK   0x100       // tlb prefetch: # page tables verified per work item
+
+typedef struct tdVMM_PAGING_FAILED_BUCKET {
+    volatile QWORD qw[VMM_PAGING_FAILED_WAYS];  // [63:24] = pte fingerprint, [23:0] = tick of insertion (0 = empty)
+} VMM_PAGING_FAILED_BUCKET, *PVMM_PAGING_FAILED_BUCKET;
+
+#define VMM_PROTOTYPEPTE_CACHE_MB_DEFAULT   64
+#define VMM_PROTOTYPEPTE_CACHE_MB_MIN       1
+#define VMM_PROTOTYPEPTE_CACHE_MB_MAX       4096
 
 #define VMM_CACHE_TAG_PHYS      'CaPh'
 #define VMM_CACHE_TAG_PAGING    'CaPg'
@@ -365,8 +486,12 @@ typedef struct tdVMMOB_PROCESS_TABLE {
 
 typedef struct tdVMMOB_MEM {
     OB Ob;
-    SLIST_ENTRY SListTotal;
-    SLIST_ENTRY SListEmpty;
+    SLIST_ENTRY SListEmpty;         // empty list or retire list
+    DWORD dwGeneration;             // cache generation at time of reserve
+    DWORD iNode;                    // numa node index of the empty list the entry belongs to
+    DWORD fSpeculative;             // speculative read-ahead not yet accessed
+    volatile DWORD fReferenced;     // referenced since insert/promotion (eviction policy)
+    DWORD fHot;                     // on hot age list (2Q eviction policy)
     struct tdVMMOB_MEM *FLink;
     struct tdVMMOB_MEM *BLink;
     struct tdVMMOB_MEM *AgeFLink;
@@ -379,24 +504,101 @@ typedef struct tdVMMOB_MEM {
     };
 } VMMOB_MEM, *PVMMOB_MEM, **PPVMMOB_MEM;
 
+// lock-free reader state - sharded by current processor to keep the lookup
+// fast path from writing cache lines shared between processors.
+typedef struct DECLSPEC_ALIGN(64) tdVMM_CACHE_READER_SHARD {
+    volatile DWORD cEpochReader[2];         // active lock-free readers per epoch parity
+    volatile QWORD cHit[VMM_CACHE2_REGIONS];    // per region lookup counters
+    volatile QWORD cMiss[VMM_CACHE2_REGIONS];
+} VMM_CACHE_READER_SHARD, *PVMM_CACHE_READER_SHARD;
+
 typedef struct tdVMM_CACHE_TABLE {
     BOOL fActive;
     DWORD tag;
-    SLIST_HEADER ListHeadEmpty;
-    SLIST_HEADER ListHeadTotal;
+    volatile DWORD dwGeneration;        // entries with other generation are stale
+    DWORD iReclaimStaleLast;
+    DWORD tpPolicy;                     // VMM_CACHE_POLICY_*
+    SLIST_HEADER ListHeadEmpty[VMM_NUMA_NODES_MAX];     // per numa node - only [0] if not numa mode
+    SLIST_HEADER ListHeadRetire;        // entries released due to shrink - retired in current epoch
+    SLIST_HEADER ListHeadRetireGrace;   // entries retired before the last epoch advance
     DWORD cEmpty;
     DWORD cTotal;
+    DWORD cMaxEntries;
+    DWORD cRetire;
     WORD iReclaimLast;
+    volatile QWORD qwEpoch;             // reclamation epoch - advanced by VmmCacheRetirePurge
+    volatile DWORD fRetirePurge;        // retire purge in progress
+    volatile QWORD cReserveNumaRemote;  // reserves served from the empty list of another numa node
+    VMM_CACHE_READER_SHARD Shard[VMM_CACHE2_READER_SHARDS];
     struct {
         DWORD c;
-        DWORD dwFuture;
+        volatile DWORD dwSeq;       // seqlock: odd while writer modifies region
         CRITICAL_SECTION Lock;
-        PVMMOB_MEM AgeFLink;
+        DWORD cHot;
+        PVMMOB_MEM AgeFLink;        // age list (probationary list if 2Q)
         PVMMOB_MEM AgeBLink;
+        PVMMOB_MEM HotFLink;        // hot list (2Q only)
+        PVMMOB_MEM HotBLink;
+        struct {
+            QWORD cInsert;          // counters updated under region lock (lookup counters in Shard)
+            QWORD cEvict;
+            QWORD cEvictStale;
+            QWORD cLockContended;
+            QWORD qwLockWaitQPC;    // time waited for region lock (performance counter ticks)
+        } stat;
         PVMMOB_MEM B[VMM_CACHE2_BUCKETS];
     } R[VMM_CACHE2_REGIONS];
 } VMM_CACHE_TABLE, *PVMM_CACHE_TABLE;
 
+typedef struct tdVMM_CACHE_STATISTICS_REGION {
+    DWORD cEntries;
+    DWORD cHot;
+    QWORD cHit;
+    QWORD cMiss;
+    QWORD cInsert;
+    QWORD cEvict;
+    QWORD cEvictStale;
+    QWORD cLockContended;
+    QWORD qwLockWaitUs;
+} VMM_CACHE_STATISTICS_REGION, *PVMM_CACHE_STATISTICS_REGION;
+
+typedef struct tdVMM_CACHE_STATISTICS {
+    DWORD tag;
+    DWORD tpPolicy;
+    DWORD cMaxEntries;
+    DWORD cTotal;
+    DWORD cEmpty;
+    DWORD cRetire;
+    DWORD cNumaNode;
+    QWORD cReserveNumaRemote;
+    VMM_CACHE_STATISTICS_REGION Total;
+    VMM_CACHE_STATISTICS_REGION R[VMM_CACHE2_REGIONS];
+} VMM_CACHE_STATISTICS, *PVMM_CACHE_STATISTICS;
+
+#define VMM_READAHEAD_SHARDS            16      // per-processor detector shards
+#define VMM_READAHEAD_STREAMS           16      // streams per shard
+#define VMM_READAHEAD_WINDOW_MIN        0x04
+#define VMM_READAHEAD_WINDOW_MAX        0x100
+#define VMM_READAHEAD_STRIDE_MAX        0x40
+
+#define VMM_SCATTER_COALESCE_MIN        0x04    // min # of contiguous pages to merge into one device read
+#define VMM_SCATTER_COALESCE_MAX        0x100   // max # of contiguous pages in one merged device read
+
+typedef struct tdVMM_READAHEAD_STREAM {
+    QWORD paLast;                   // last page read in stream
+    QWORD qwTickLast;               // last access (for LRU replacement)
+    LONG iStride;                   // stride in pages
+    DWORD cConfidence;              // number of consecutive stride matches
+    DWORD cWindow;                  // current speculative window in pages
+    DWORD _Filler;
+} VMM_READAHEAD_STREAM, *PVMM_READAHEAD_STREAM;
+
+typedef struct DECLSPEC_ALIGN(64) tdVMM_READAHEAD_SHARD {
+    SRWLOCK LockSRW;
+    QWORD qwTick;
+    VMM_READAHEAD_STREAM S[VMM_READAHEAD_STREAMS];
+} VMM_READAHEAD_SHARD, *PVMM_READAHEAD_SHARD;
+
 typedef struct tdVMM_VIRT2PHYS_INFORMATION {
     VMM_MEMORYMODEL_TP tpMemoryModel;
     QWORD va;
@@ -405,15 +607,38 @@ typedef struct tdVMM_VIRT2PHYS_INFORMATION {
     WORD  iPTEs[5]; // Index of PTE in page table
 } VMM_VIRT2PHYS_INFORMATION, *PVMM_VIRT2PHYS_INFORMATION;
 
+#define VMM_VIRT2PHYS_BATCH_MIN         4       // min # of pages in scatter read to use batch translation
+
+typedef struct tdVMM_VIRT2PHYS_BATCH_ENTRY {
+    QWORD va;       // [in] virtual address to translate.
+    QWORD pa;       // [out] physical address on success, PTE (if any) on fail.
+    DWORD i;        // [in] caller-defined index - entries are re-ordered by the batch translation.
+    BOOL fPhys;     // [out] translation success.
+} VMM_VIRT2PHYS_BATCH_ENTRY, *PVMM_VIRT2PHYS_BATCH_ENTRY;
+
+typedef struct tdVMM_PAGED_READ_SCATTER_ENTRY {
+    QWORD va;
+    QWORD pte;                      // in: pte of the non-translatable page
+    PBYTE pbPage;
+    QWORD pa;                       // out: physical address to read on !fResult (0 = fail)
+    PVOID pvCtx;                    // caller context - not used by memory model
+    BOOL fResult;                   // out: page read into pbPage
+    DWORD _Filler;
+} VMM_PAGED_READ_SCATTER_ENTRY, *PVMM_PAGED_READ_SCATTER_ENTRY;
+
 typedef struct tdVMM_MEMORYMODEL_FUNCTIONS {
     VOID(*pfnClose)();
     BOOL(*pfnVirt2Phys)(_In_ QWORD paDTB, _In_ BOOL fUserOnly, _In_ BYTE iPML, _In_ QWORD va, _Out_ PQWORD ppa);
+    DWORD(*pfnVirt2PhysBatch)(_In_ PVMM_PROCESS pProcess, _Inout_updates_(cV2Ps) PVMM_VIRT2PHYS_BATCH_ENTRY pV2Ps, _In_ DWORD cV2Ps);
     VOID(*pfnVirt2PhysGetInformation)(_Inout_ PVMM_PROCESS pProcess, _Inout_ PVMM_VIRT2PHYS_INFORMATION pVirt2PhysInfo);
     VOID(*pfnPhys2VirtGetInformation)(_In_ PVMM_PROCESS pProcess, _Inout_ PVMMOB_PHYS2VIRT_INFORMATION pP2V);
+    VOID(*pfnPhys2VirtIndex)(_In_ PVMM_PROCESS pProcess, _Inout_ PVMMOB_PHYS2VIRT_INDEX pIndex);
     BOOL(*pfnPteMapInitialize)(_In_ PVMM_PROCESS pProcess);
     VOID(*pfnTlbSpider)(_In_ PVMM_PROCESS pProcess);
+    VOID(*pfnTlbSpiderAll)();
     BOOL(*pfnTlbPageTableVerify)(_Inout_ PBYTE pb, _In_ QWORD pa, _In_ BOOL fSelfRefReq);
     BOOL(*pfnPagedRead)(_In_ PVMM_PROCESS pProcess, _In_ QWORD va, _In_ QWORD pte, _Out_writes_(4096) PBYTE pbPage, _Out_ PQWORD ppa, _In_ QWORD flags);
+    VOID(*pfnPagedReadScatter)(_In_ PVMM_PROCESS pProcess, _Inout_updates_(cPages) PVMM_PAGED_READ_SCATTER_ENTRY pPages, _In_ DWORD cPages, _In_ QWORD flags);
 } VMM_MEMORYMODEL_FUNCTIONS;
 
 // ----------------------------------------------------------------------------
@@ -432,17 +657,57 @@ typedef struct tdVmmConfig {
     BOOL fDisableLeechCoreClose;    // when device 'existing'
     BOOL fDisableSymbolServerOnStartup;
     BOOL fWaitInitialize;
+    BOOL fSymbolPack;               // use/write compact symbol packs in the symbol cache directory
+    BOOL fStagedInit;               // return after process list init - other subsystems init in background
+    BOOL fDisableProfile;           // do not use/write kernel offset profiles in the profile directory
+    BOOL fNUMA;                     // numa mode: node local cache entries and node pinned work pool threads
+    BOOL fMemMap;                   // memory map local raw dump files - physical reads bypass device and PHYS cache
+    BOOL fRemoteNoCompress;         // do not compress remote (LeechAgent) page payloads
+    // values below
+    DWORD cMB_CacheBudget;
+    DWORD tpCachePolicy;
     // strings below
     CHAR szPythonPath[MAX_PATH];
+    CHAR szCacheFile[MAX_PATH];
     CHAR szPageFile[10][MAX_PATH];
 } VMMCONFIG, *PVMMCONFIG;
 
+#define VMM_STATISTICS_DEVICE_BUCKETS       24
+
+/*
+* Device I/O telemetry for one kind of device operation. Histograms are log2
+* bucketed: bucket 0 = value 0, bucket i = values in the range [2^(i-1), 2^i).
+*/
+typedef struct tdVMM_STATISTICS_DEVICE_OP {
+    QWORD cCall;
+    QWORD cPage;
+    QWORD cb;
+    QWORD tm;                                       // total device time (performance counter ticks)
+    QWORD cHistBatch[VMM_STATISTICS_DEVICE_BUCKETS];    // pages per device call
+    QWORD cHistLatency[VMM_STATISTICS_DEVICE_BUCKETS];  // device call latency (microseconds)
+} VMM_STATISTICS_DEVICE_OP, *PVMM_STATISTICS_DEVICE_OP;
+
+typedef struct tdVMM_STATISTICS_DEVICE {
+    QWORD qwFreq;
+    QWORD tmInitialize;
+    VMM_STATISTICS_DEVICE_OP ReadScatter;           // LeechCore_ReadScatter
+    VMM_STATISTICS_DEVICE_OP ReadContiguous;        // LeechCore_Read of coalesced runs
+    VMM_STATISTICS_DEVICE_OP Write;                 // LeechCore_Write
+    QWORD cHistRun[VMM_STATISTICS_DEVICE_BUCKETS];  // physically contiguous run length (pages) of requested reads
+} VMM_STATISTICS_DEVICE, *PVMM_STATISTICS_DEVICE;
+
 typedef struct tdVMM_STATISTICS {
     QWORD cPhysCacheHit;
     QWORD cPhysReadSuccess;
     QWORD cPhysReadFail;
     QWORD cPhysWrite;
     QWORD cPhysRefreshCache;
+    QWORD cPhysReadAhead;
+    QWORD cPhysReadAheadHit;
+    QWORD cPhysReadAheadMiss;
+    QWORD cPhysReadCoalesced;
+    QWORD cPhysReadDedup;
+    QWORD cPhysReadMemMap;
     struct {
         QWORD cPrototype;
         QWORD cTransition;
@@ -461,9 +726,21 @@ typedef struct tdVMM_STATISTICS {
     QWORD cTlbCacheHit;
     QWORD cTlbReadSuccess;
     QWORD cTlbReadFail;
+    QWORD cTlbVerifyFail;
+    QWORD cTlbNegativeHit;
     QWORD cTlbRefreshCache;
     QWORD cProcessRefreshPartial;
     QWORD cProcessRefreshFull;
+    QWORD cCacheLockFreeRetry;
+    QWORD cCacheLockFallback;
+    QWORD cPhysCacheDedupZero;
+    QWORD cPhysCacheDedupDuplicate;
+    QWORD cRemotePrefetchAsync;
+    QWORD cPrototypePteCacheHit;
+    QWORD cPrototypePteCacheMiss;
+    QWORD cPrototypePteCacheEvict;
+    QWORD cPrototypePteCachePrefetch;
+    VMM_STATISTICS_DEVICE dev;
 } VMM_STATISTICS, *PVMM_STATISTICS;
 
 typedef struct tdVMM_WIN_EPROCESS_OFFSET {
@@ -515,6 +792,32 @@ typedef struct tdVMM_WIN_THREADINFO {
     WORD oTebStackLimit;
 } VMM_WIN_THREADINFO, *PVMM_WIN_THEADINFO;
 
+typedef struct tdVMMWIN_REGISTRY_OFFSET {
+    QWORD vaHintCMHIVE;
+    struct {
+        WORD Signature;
+        WORD FLink;
+        WORD Length;
+        WORD StorageMap;
+        WORD StorageSmallDir;
+        WORD BaseBlock;
+        WORD FileFullPathOpt;
+        WORD FileUserNameOpt;
+        WORD HiveRootPathOpt;
+        WORD _Size;
+    } CM;
+    struct {
+        WORD Signature;
+        WORD Length;
+        WORD Major;
+        WORD Minor;
+        WORD FileName;
+    } BB;
+    struct {
+        WORD _Size;
+    } HE;
+} VMMWIN_REGISTRY_OFFSET, *PVMMWIN_REGISTRY_OFFSET;
+
 typedef struct tdVMMWIN_REGISTRY_CONTEXT    *PVMMWIN_REGISTRY_CONTEXT;
 typedef QWORD                               VMMWIN_PDB_HANDLE;
 
@@ -538,6 +841,9 @@ typedef struct tdVMMWIN_TCPIP_CONTEXT {
     BOOL fInitialized;
     QWORD vaPartitionTable;
     VMMWIN_TCPIP_OFFSET_TcpE OTcpE;
+    DWORD oStartHT;                 // offset of hash tables in TcHT (derived from partition table)
+    POB_VSET pObTcHT;               // cached TcHT addresses (derived from partition table)
+    POB_MAP pmTcpE;                 // cached resolved TCP endpoints (LocalAlloc) keyed by vaTcpE
 } VMMWIN_TCPIP_CONTEXT, *PVMMWIN_TCPIP_CONTEXT;
 
 typedef struct tdVMMWIN_OPTIONAL_KERNEL_CONTEXT {
@@ -596,6 +902,7 @@ typedef struct tdVMMWIN_OBJECT_TYPE {
 } VMMWIN_OBJECT_TYPE, *PVMMWIN_OBJECT_TYPE;
 
 typedef struct tdVMMWIN_OBJECT_TYPE_TABLE {
+    CRITICAL_SECTION LockUpdate;
     BOOL fInitialized;
     BOOL fInitializedFailed;
     BYTE bObjectHeaderCookie;
@@ -605,14 +912,83 @@ typedef struct tdVMMWIN_OBJECT_TYPE_TABLE {
     VMMWIN_OBJECT_TYPE h[256];
 } VMMWIN_OBJECT_TYPE_TABLE, *PVMMWIN_OBJECT_TYPE_TABLE;
 
+// Initialization stages (VmmWinInit). Stages after VMM_INIT_STAGE_PROCESS are
+// brought up in the background by parallel threads in staged init mode.
+#define VMM_INIT_STAGE_KERNEL       0   // DTB, memory model and ntoskrnl.exe
+#define VMM_INIT_STAGE_PROCESS      1   // process list
+#define VMM_INIT_STAGE_KERNELINFO   2   // PsLoadedModuleList and KDBG
+#define VMM_INIT_STAGE_REGISTRY     3   // registry hive map
+#define VMM_INIT_STAGE_PDB          4   // debug symbol subsystem
+#define VMM_INIT_STAGE_PAGING       5   // full paging - page files and memory compression
+#define VMM_INIT_STAGE_THREADING    6   // thread map
+#define VMM_INIT_STAGE_KERNELOPT    7   // optional kernel values
+#define VMM_INIT_STAGE_MAX          8
+
+static const LPSTR VMM_INIT_STAGE_TOSTRING[VMM_INIT_STAGE_MAX] = { "KERNEL", "PROCESS", "KERNELINFO", "REGISTRY", "PDB", "PAGING", "THREADING", "KERNELOPT" };
+
+typedef struct tdVMM_INIT_STAGE {
+    volatile BOOL fReady;
+    QWORD tmStart;                  // QueryPerformanceCounter
+    QWORD tmEnd;                    // QueryPerformanceCounter
+} VMM_INIT_STAGE, *PVMM_INIT_STAGE;
+
+// A parallel work job executed by the persistent work pool. Items are claimed
+// one at a time by the submitting thread and any idle pool thread.
+typedef struct tdVMM_WORK_JOB {
+    struct tdVMM_WORK_JOB *FLink;
+    PVOID ctx;
+    VOID(*pfnItem)(_In_opt_ PVOID ctx, _In_ DWORD iItem);
+    DWORD cItems;
+    volatile LONG iItemNext;
+    volatile LONG cItemsRemaining;
+    volatile LONG cWorkers;         // # pool threads currently attached to job
+    HANDLE hEventDone;              // manual-reset - signalled when all items are completed
+    BOOL fAsync;                    // single item job owned (and freed) by the executing pool thread
+} VMM_WORK_JOB, *PVMM_WORK_JOB;
+
+#define VMM_REFRESH_PHYS                0
+#define VMM_REFRESH_TLB                 1
+#define VMM_REFRESH_PROC_PARTIAL        2
+#define VMM_REFRESH_PROC_TOTAL          3
+#define VMM_REFRESH_REGISTRY            4
+#define VMM_REFRESH_MAX                 5
+
+#define VMM_REFRESH_CHANGE_UNKNOWN      0xffffffff
+
+typedef struct tdVMM_REFRESH_SCHEDULE {
+    DWORD cTick;                    // current (adaptive) refresh interval in ticks
+    DWORD dwChangePct;              // last measured change rate in percent (or VMM_REFRESH_CHANGE_UNKNOWN)
+    QWORD iTickLast;                // tick count at last refresh
+    QWORD tcLast;                   // GetTickCount64() at last refresh
+} VMM_REFRESH_SCHEDULE, *PVMM_REFRESH_SCHEDULE;
+
+// change notification events - values equal to VMMDLL_PLUGIN_EVENT_* and also
+// used as the bit mask of events to subscribe to.
+#define VMM_NOTIFY_PROCESS_TERMINATE    0x04
+#define VMM_NOTIFY_PROCESS_CREATE       0x08
+#define VMM_NOTIFY_MAP_MODULE           0x10
+#define VMM_NOTIFY_MAP_HANDLE           0x20
+#define VMM_NOTIFY_MASK                 0x3c
+#define VMM_NOTIFY_SUBSCRIPTIONS_MAX    16
+
+typedef struct tdVMM_NOTIFY_SUBSCRIPTION {
+    DWORD fEventMask;
+    PVOID ctx;
+    VOID(*pfnCB)(_In_opt_ PVOID ctx, _In_ DWORD fEvent, _In_opt_ PVOID pvEvent, _In_opt_ DWORD cbEvent);
+} VMM_NOTIFY_SUBSCRIPTION, *PVMM_NOTIFY_SUBSCRIPTION;
+
 typedef struct tdVMM_CONTEXT {
     HMODULE hModuleVmm;             // do not call FreeLibrary on hModuleVmm
-    CRITICAL_SECTION MasterLock;
+    CRITICAL_SECTION MasterLock;    // global reconfiguration (plugins, pdb) and plugin refresh notifications
+    CRITICAL_SECTION LockUpdateProc;        // serializes process list refreshes - new tables are built off to the side and published by pointer swap
+    CRITICAL_SECTION LockUpdatePhys2Virt;   // serializes builds of the phys2virt index
     POB_CONTAINER pObCPROC;         // contains VMM_PROCESS_TABLE
     VMM_MEMORYMODEL_FUNCTIONS fnMemoryModel;
     VMM_MEMORYMODEL_TP tpMemoryModel;
     BOOL f32;
     BOOL fThreadMapEnabled;         // Thread Map subsystem is enabled / available
+    volatile DWORD dwThreadMapGeneration;   // thread map generation counter (VMM_MAP_THREADENTRY.dwGeneration)
+    volatile QWORD qwGeneration;    // monotonic generation counter of process tables and map objects
     VMM_SYSTEM_TP tpSystem;
     DWORD flags;                    // VMM_FLAG_*
     struct {
@@ -624,6 +1000,12 @@ typedef struct tdVMM_CONTEXT {
         DWORD cTick_ProcPartial;
         DWORD cTick_ProcTotal;
         DWORD cTick_Registry;
+        BOOL fAdaptive;             // adapt refresh intervals to measured change rates
+        BOOL fIdle;                 // refreshes suspended due to no api activity
+        DWORD cMs_Idle;             // suspend refreshes after ms without api activity (0 = never)
+        volatile QWORD tcActivity;  // GetTickCount64() at last api call
+        volatile QWORD iTick;       // ticks since refresh thread start
+        VMM_REFRESH_SCHEDULE Schedule[VMM_REFRESH_MAX];
     } ThreadProcCache;
     VMM_STATISTICS stat;
     VMM_KERNELINFO kernel;
@@ -631,25 +1013,138 @@ typedef struct tdVMM_CONTEXT {
     PVOID pPdbContext;
     PVOID pMmContext;
     PVMMWIN_REGISTRY_CONTEXT pRegistry;
+    BOOL fRegistryLazy;                 // registry key listings resolve subkey lists only - no full hive scan
     VMMWIN_TCPIP_CONTEXT TcpIp;
     QWORD paPluginPhys2VirtRoot;
     VMM_DYNAMIC_LOAD_FUNCTIONS fn;
     PVOID pVmmVfsModuleList;
+    POB_MAP pmObVfsPath;                // resolved vfs path cache (vmmvfs.c)
+    POB_MAP pmObPluginRender;           // rendered plugin text file cache (pluginmanager.c)
     POB_CONTAINER pObCCachePrefetchEPROCESS;
     POB_CONTAINER pObCCachePrefetchRegistry;
+    POB_CONTAINER pObCPhys2VirtIndex;   // global reverse pa -> (pid, va) index (built on demand)
+    POB_MAP pmObModuleImage;            // global cross-process module image metadata cache (vmmwin.c)
+    POB_MAP pmObHandleText;             // global object address -> handle object name cache (vmmwin.c)
     // page caches
     struct {
         VMM_CACHE_TABLE PHYS;
         VMM_CACHE_TABLE TLB;
         VMM_CACHE_TABLE PAGING;
-        POB_VSET PAGING_FAILED;
-        POB_MAP pmPrototypePte;     // map with mm_vad.c managed data
+        struct {                    // fixed-size lock-free negative cache of failed paged reads (by pte)
+            PBYTE pbAlloc;
+            PVMM_PAGING_FAILED_BUCKET pBucket;  // [VMM_PAGING_FAILED_BUCKETS] cache line aligned
+            DWORD dwTTL;            // time to live in VMM_PAGING_FAILED_TICK_SHIFT units
+        } PAGING_FAILED;
+        struct {                    // bounded two-generation (approximate lru) prototype pte array cache (mm_vad.c)
+            SRWLOCK LockSRW;        // shared: lookup, exclusive: promotion and generation rotation
+            POB_MAP pmHot;          // current generation: vaPrototypePte -> OB_DATA
+            POB_MAP pmCold;         // previous generation - promoted to hot on hit, dropped on rotation
+            QWORD cbHot;
+            QWORD cbCold;
+            QWORD cbMax;            // memory budget of hot + cold generations
+        } PrototypePte;
+        volatile DWORD dwSoftTlbInvalidateGeneration;   // bumped on physical writes (may alter page tables)
+        volatile QWORD TlbNegative[VMM_TLB_NEGATIVE_ENTRIES];  // lock-free negative cache of rejected page tables (pa | generation tag)
+        struct {
+            DWORD tp;               // VMM_CACHE_DEDUP_*
+            POB_VSET psZero;        // zero-filled phys pages (pa | 1)
+            POB_MAP pmDupPage;      // duplicate phys page: pa -> (content hash ^ pa)
+            POB_MAP pmDupHash;      // content hash -> canonical cached phys page (pa | 1)
+        } Dedup;
+        DWORD cMB_Budget;           // total memory budget of PHYS/TLB/PAGING
     } Cache;
+    // persistent page table / initialization cache file (static memory only)
+    struct {
+        BOOL fEnabled;
+        BOOL fLoaded;
+        QWORD qwKey;                // hash of memory dump file header
+        QWORD paDTB;                // initialization hints below (if loaded)
+        QWORD vaKernelBase;
+        QWORD vaSystemEPROCESS;
+    } CacheFile;
+    // memory mapped local raw dump file - physical reads bypass the device and the PHYS cache (vmmmemmap.c)
+    struct {
+        BOOL fEnabled;
+        HANDLE hFile;
+        HANDLE hMapping;
+        PBYTE pbView;
+        QWORD cbView;               // mapped and used size: min(file size, max address)
+    } MemMap;
+    // persisted kernel structure offset profiles keyed by ntoskrnl pdb (vmmprofile.c)
+    struct {
+        BOOL fEnabled;
+        BOOL fLoaded;               // profile matching the kernel was loaded
+        BOOL fEPROCESS;             // ctxVmm->kernel.OffsetEPROCESS originates from profile
+        BOOL fRegistry;             // Registry below is valid
+        BOOL fDirty;                // new offsets located - write profile on close
+        DWORD dwVersionBuild;       // build number recorded in the loaded profile
+        DWORD dwPdbAge;
+        BYTE pbPdbGUID[16];
+        VMMWIN_REGISTRY_OFFSET Registry;
+        CHAR szFile[MAX_PATH];
+    } Profile;
+    // physical memory read-ahead access pattern detector - sharded per processor
+    struct {
+        VMM_READAHEAD_SHARD Shard[VMM_READAHEAD_SHARDS];
+    } ReadAhead;
+    // asynchronous scatter reads (VMMDLL_MemReadScatterAsync)
+    struct {
+        volatile DWORD cInFlight;
+        DWORD cMaxInFlight;
+        HANDLE hEventComplete;      // auto-reset event - signalled on batch completion
+    } ReadScatterAsync;
+    // remote device (ctxMain->dev.fRemote) scatter read request pipelining
+    struct {
+        DWORD cPipelineDepth;       // max outstanding requests per scatter read (1 = no pipelining)
+        BOOL fPrefetchAsync;        // prefetch hints (VMMDLL_MemPrefetchPages) are issued in the background
+        volatile DWORD cPrefetchInFlight;   // # active prefetch slots
+        SRWLOCK LockPrefetchSRW;
+        struct {
+            BOOL fActive;
+            DWORD dwPID;            // (DWORD)-1 = physical memory
+            POB_VSET psPages;       // page addresses being prefetched
+            HANDLE hEventIdle;      // manual-reset - signalled while slot is idle
+        } Prefetch[VMM_REMOTE_PREFETCH_INFLIGHT_MAX];
+    } Remote;
+    // initialization stage readiness and timings
+    struct {
+        BOOL fStaged;               // staged init - return once process list is ready
+        QWORD tmStart;              // QueryPerformanceCounter at init start
+        HANDLE hEventKernelInfo;    // staged init - set once KERNELINFO is ready (closed by the KERNELOPT stage)
+        VMM_INIT_STAGE Stage[VMM_INIT_STAGE_MAX];
+    } Init;
     // thread worker count
     struct {
         BOOL fEnabled;
         DWORD c;
     } ThreadWorkers;
+    // persistent work pool (VmmWorkParallel) - threads are started on first use
+    struct {
+        CRITICAL_SECTION Lock;
+        BOOL fStarted;
+        BOOL fTerminate;
+        DWORD cThreads;
+        HANDLE hEventWork;          // manual-reset - signalled while jobs with unclaimed items are queued
+        PVMM_WORK_JOB pJobs;        // queued jobs, oldest first
+        HANDLE hThreads[VMM_WORK_THREADS_MAX];
+    } WorkPool;
+    // numa topology - a single node unless numa mode is enabled on a multi-node system
+    struct {
+        BOOL fEnabled;
+        DWORD cNode;
+        WORD wNode[VMM_NUMA_NODES_MAX];                 // system numa node number of node index
+        GROUP_AFFINITY Affinity[VMM_NUMA_NODES_MAX];    // processors of node index
+        BYTE iNodeProcessor[VMM_NUMA_PROCESSORS_MAX];   // node index of processor index
+    } Numa;
+    // change notifications - events are queued by the core and dispatched on
+    // the refresh thread to plugins and api subscribers (VmmNotify_Dispatch).
+    struct {
+        SRWLOCK LockSRW;            // protects subscriptions - not held during subscriber callbacks
+        POB_VSET psPending;         // pending events: (fEvent << 32) | dwPID
+        volatile DWORD dwDispatchTID;   // thread id of ongoing subscriber dispatch (0 = none)
+        DWORD cSubscription;
+        VMM_NOTIFY_SUBSCRIPTION Subscription[VMM_NOTIFY_SUBSCRIPTIONS_MAX];
+    } Notify;
     WCHAR _EmptyWCHAR;
     VMMWIN_OBJECT_TYPE_TABLE ObjectTypeTable;
 } VMM_CONTEXT, *PVMM_CONTEXT;
@@ -693,6 +1188,33 @@ PVMM_MAIN_CONTEXT ctxMain;
 // CACHE AND TLB FUNCTIONALITY BELOW:
 // ----------------------------------------------------------------------------
 
+/*
+* Retrieve the cache table given a cache tag.
+* -- dwTblTag = VMM_CACHE_TAG_*
+* -- return = the table, or NULL if not a valid tag.
+*/
+PVMM_CACHE_TABLE VmmCacheTableGet(_In_ DWORD dwTblTag);
+
+/*
+* Retrieve a snapshot of the statistics of a cache table - both in total and
+* per cache region. Counters are collected without locking and may therefore
+* be slightly inconsistent with each other.
+* -- dwTblTag
+* -- pStatistics
+* -- return
+*/
+_Success_(return)
+BOOL VmmCacheGetStatistics(_In_ DWORD dwTblTag, _Out_ PVMM_CACHE_STATISTICS pStatistics);
+
+/*
+* Enumerate all valid (non-stale) entries in a cache table. The callback is
+* called with the cache region lock held and must not call into the cache.
+* -- dwTblTag
+* -- ctx = optional context to pass along to the callback function.
+* -- pfnCB = callback function called once for each valid cache entry.
+*/
+VOID VmmCacheEnumerate(_In_ DWORD dwTblTag, _In_opt_ PVOID ctx, _In_ VOID(*pfnCB)(_In_opt_ PVOID ctx, _In_ PVMMOB_MEM pOb));
+
 /*
 * Retrieve an item from the cache.
 * CALLER DECREF: return
@@ -752,6 +1274,31 @@ VOID VmmCacheReserveReturn(_In_opt_ PVMMOB_MEM pOb);
 */
 BOOL VmmWrite(_In_opt_ PVMM_PROCESS pProcess, _In_ QWORD qwA, _In_reads_(cb) PBYTE pb, _In_ DWORD cb);
 
+#define VMM_WRITEBATCH_FLAG_VERIFY      0x01    // verify written data by a batched read-back (bypassing cache)
+
+// NB! layout must be identical to VMMDLL_MEM_WRITE_ENTRY.
+typedef struct tdVMM_WRITEBATCH_ENTRY {
+    DWORD dwPID;                    // [in] PID, (DWORD)-1 for physical memory
+    DWORD cb;                       // [in] number of bytes to write
+    QWORD qwA;                      // [in] address to write
+    PBYTE pb;                       // [in] data to write
+    DWORD cbWrite;                  // [out] number of bytes successfully written
+    BOOL fVerified;                 // [out] all bytes written and verified (if VMM_WRITEBATCH_FLAG_VERIFY)
+} VMM_WRITEBATCH_ENTRY, *PVMM_WRITEBATCH_ENTRY;
+
+/*
+* Write a batch of (pid, address, data) writes. All writes are translated to
+* physical addresses up front; physically adjacent chunks are merged into
+* single device writes and only the PHYS/TLB cache pages actually written are
+* invalidated. The batch may optionally be verified by a batched read-back.
+* NB! the order of overlapping writes within a batch is undefined.
+* -- cEntries
+* -- pEntries
+* -- flags = VMM_WRITEBATCH_FLAG_*
+* -- return = the number of entries fully written (and verified if requested).
+*/
+DWORD VmmWriteBatch(_In_ DWORD cEntries, _Inout_updates_(cEntries) PVMM_WRITEBATCH_ENTRY pEntries, _In_ DWORD flags);
+
 /*
 * Read a virtually contigious arbitrary amount of memory containing cch number of
 * unicode characters and convert them into ansi characters. If the default char
@@ -798,6 +1345,38 @@ BOOL VmmRead_U2A(_In_ PVMM_PROCESS pProcess, _In_ BOOL f32, _In_ QWORD flags, _I
 _Success_(return)
 BOOL VmmRead_U2A_Alloc(_In_ PVMM_PROCESS pProcess, _In_ BOOL f32, _In_ QWORD flags, _In_ QWORD vaUS, _Out_ LPSTR *psz, _Out_ PDWORD pcch, _Out_opt_ PBOOL pfDefaultChar);
 
+#define VMM_READPLAN_TP_DATA            1   // read cb bytes at va into pb
+#define VMM_READPLAN_TP_U2A_ALLOC       2   // read _UNICODE_STRING at va into a LocalAlloc'ed ascii string *psz
+
+typedef struct tdVMM_READPLAN_ENTRY {
+    DWORD tp;                       // VMM_READPLAN_TP_*
+    DWORD cb;                       // TP_DATA: number of bytes to read
+    QWORD va;                       // TP_DATA: address to read, TP_U2A_ALLOC: address of _UNICODE_STRING
+    union {
+        PBYTE pb;                   // TP_DATA: buffer to receive cb bytes
+        LPSTR *psz;                 // TP_U2A_ALLOC: ptr to receive string - CALLER LocalFree: *psz
+    };
+    PDWORD pcch;                    // TP_U2A_ALLOC: optional number of characters read (excluding null terminator)
+    BOOL fResult;                   // result of read
+    // internal use only:
+    WORD _cbStr;
+    QWORD _vaStr;
+} VMM_READPLAN_ENTRY, *PVMM_READPLAN_ENTRY;
+
+/*
+* Execute a read plan - a batch of independent small reads and _UNICODE_STRING
+* reads. Each read stage - (1) data and _UNICODE_STRING headers and (2) string
+* buffers - is performed as one prefetch of all required pages followed by
+* cache reads. This replaces a chain of dependent reads (and two round trips
+* per _UNICODE_STRING) with two device round trips in total.
+* -- pProcess
+* -- f32 = _UNICODE_STRING is 32-bit _UNICODE_STRING or 64-bit _UNICODE_STRING.
+* -- flags = flags as in VMM_FLAG_*
+* -- cEntries
+* -- pEntries = read plan entries - results are returned in the entries.
+*/
+VOID VmmReadPlan_Execute(_In_opt_ PVMM_PROCESS pProcess, _In_ BOOL f32, _In_ QWORD flags, _In_ DWORD cEntries, _Inout_updates_(cEntries) PVMM_READPLAN_ENTRY pEntries);
+
 /*
 * Read a Windows _UNICODE_STRING buffer from an address into a buffer as an ascii-string.
 * Conversion from unicode characters to ascii-characters are done automatically
@@ -869,6 +1448,20 @@ VOID VmmReadEx(_In_opt_ PVMM_PROCESS pProcess, _In_ QWORD qwA, _Out_writes_(cb)
 _Success_(return)
 BOOL VmmReadPage(_In_opt_ PVMM_PROCESS pProcess, _In_ QWORD qwA, _Out_writes_(4096) PBYTE pbPage);
 
+/*
+* Retrieve a read-only reference to a single 4096-byte page of memory, virtual
+* or physical, without copying the page. Physical memory backed pages are taken
+* directly from the PHYS cache. Other pages, such as paged out pages or reads
+* with VMM_FLAG_NOCACHE, are read into a private (non-cached) object.
+* Referenced pages are pinned - they should be DECREF'ed as soon as possible.
+* CALLER DECREF: return
+* -- pProcess = NULL=='physical memory read', PTR=='virtual memory read'
+* -- qwA = address (will be page aligned)
+* -- flags = flags as in VMM_FLAG_*
+* -- return = page object (read-only!) on success, NULL on fail.
+*/
+PVMMOB_MEM VmmReadPageRef(_In_opt_ PVMM_PROCESS pProcess, _In_ QWORD qwA, _In_ QWORD flags);
+
 /*
 * Scatter read virtual memory. Non contiguous 4096-byte pages.
 * -- pProcess
@@ -886,6 +1479,21 @@ VOID VmmReadScatterVirtual(_In_ PVMM_PROCESS pProcess, _Inout_updates_(cpMEMsVir
 */
 VOID VmmReadScatterPhysical(_Inout_ PPMEM_IO_SCATTER_HEADER ppMEMsPhys, _In_ DWORD cpMEMsPhys, _In_ QWORD flags);
 
+/*
+* Retrieve the log2 bucket of a value for the device telemetry histograms.
+* -- qw
+* -- return = bucket index in the range [0, VMM_STATISTICS_DEVICE_BUCKETS).
+*/
+DWORD VmmStatDevice_Bucket(_In_ QWORD qw);
+
+/*
+* Scatter read physical memory directly from the device (LeechCore) without
+* any caching while recording device I/O telemetry (batch size and latency).
+* -- ppMEMs
+* -- cpMEMs
+*/
+VOID VmmReadScatterPhysical_DeviceScatter(_Inout_ PPMEM_IO_SCATTER_HEADER ppMEMs, _In_ DWORD cpMEMs);
+
 /*
 * Read a memory segment as a file. This function is mainly a helper function
 * for various file system functionality.
@@ -914,6 +1522,19 @@ NTSTATUS VmmReadAsFile(_In_opt_ PVMM_PROCESS pProcess, _In_ QWORD qwMemoryAddres
 */
 NTSTATUS VmmWriteAsFile(_In_opt_ PVMM_PROCESS pProcess, _In_ QWORD qwMemoryAddress, _In_ QWORD cbMemorySize, _In_reads_(cb) PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbWrite, _In_ QWORD cbOffset);
 
+/*
+* Translate a virtual address to a physical address using the page table walker
+* specialized for the active memory model and the fUserOnly option. Semantics
+* are identical to the memory model pfnVirt2Phys function for a full walk.
+* -- paDTB
+* -- fUserOnly
+* -- va
+* -- ppa
+* -- return
+*/
+_Success_(return)
+BOOL VmmVirt2PhysWalk(_In_ QWORD paDTB, _In_ BOOL fUserOnly, _In_ QWORD va, _Out_ PQWORD ppa);
+
 /*
 * Translate a virtual address to a physical address by walking the page tables.
 * The successfully translated Physical Address (PA) is returned in ppa.
@@ -929,10 +1550,29 @@ _Success_(return)
 inline BOOL VmmVirt2PhysEx(_In_ QWORD paDTB, _In_ BOOL fUserOnly, _In_ QWORD va, _Out_ PQWORD ppa)
 {
     *ppa = 0;
-    if(ctxVmm->tpMemoryModel == VMM_MEMORYMODEL_NA) { return FALSE; }
-    return ctxVmm->fnMemoryModel.pfnVirt2Phys(paDTB, fUserOnly, -1, va, ppa);
+    return VmmVirt2PhysWalk(paDTB, fUserOnly, va, ppa);
 }
 
+/*
+* Retrieve a translation from the per-process software tlb (if existing and not
+* stale). Software tlb entries become stale when the TLB cache is cleared or if
+* physical memory is written (page tables may have been altered).
+* -- pProcess
+* -- va
+* -- ppa
+* -- return
+*/
+_Success_(return)
+BOOL VmmSoftTlb_Get(_In_ PVMM_PROCESS pProcess, _In_ QWORD va, _Out_ PQWORD ppa);
+
+/*
+* Insert a successful translation into the per-process software tlb.
+* -- pProcess
+* -- va
+* -- pa
+*/
+VOID VmmSoftTlb_Put(_In_ PVMM_PROCESS pProcess, _In_ QWORD va, _In_ QWORD pa);
+
 /*
 * Translate a virtual address to a physical address by walking the page tables.
 * The successfully translated Physical Address (PA) is returned in ppa.
@@ -948,7 +1588,10 @@ inline BOOL VmmVirt2Phys(_In_ PVMM_PROCESS pProcess, _In_ QWORD va, _Out_ PQWORD
 {
     *ppa = 0;
     if(ctxVmm->tpMemoryModel == VMM_MEMORYMODEL_NA) { return FALSE; }
-    return ctxVmm->fnMemoryModel.pfnVirt2Phys(pProcess->paDTB, pProcess->fUserOnly, -1, va, ppa);
+    if(VmmSoftTlb_Get(pProcess, va, ppa)) { return TRUE; }
+    if(!VmmVirt2PhysWalk(pProcess->paDTB, pProcess->fUserOnly, va, ppa)) { return FALSE; }
+    VmmSoftTlb_Put(pProcess, va, *ppa);
+    return TRUE;
 }
 
 /*
@@ -963,6 +1606,13 @@ inline VOID VmmTlbSpider(_In_ PVMM_PROCESS pProcess)
     ctxVmm->fnMemoryModel.pfnTlbSpider(pProcess);
 }
 
+/*
+* Spider the TLB (page table cache) of all processes not already spidered in a
+* single system-wide pass. Shared page tables are only walked and fetched once.
+* Memory models not supporting a system-wide spider fall back on per-process.
+*/
+VOID VmmTlbSpiderAll();
+
 /*
 * Try verify that a supplied page table in pb is valid by analyzing it.
 * -- pb = 0x1000 bytes containing the page table page.
@@ -1010,6 +1660,38 @@ inline VOID VmmVirt2PhysGetInformation(_Inout_ PVMM_PROCESS pProcess, _Inout_ PV
 */
 PVMMOB_PHYS2VIRT_INFORMATION VmmPhys2VirtGetInformation(_In_ PVMM_PROCESS pProcess, _In_ QWORD paTarget);
 
+/*
+* Add a physical to virtual mapping to the reverse index being built. This is
+* called by the memory model specific page table walker pfnPhys2VirtIndex.
+* -- pIndex
+* -- iLevel = 0: 4kB page, 1: 2MB page, 2: 1GB page.
+* -- pa = physical base address of the page.
+* -- va = virtual base address of the page.
+* -- dwPID
+*/
+VOID VmmPhys2VirtIndex_Push(_Inout_ PVMMOB_PHYS2VIRT_INDEX pIndex, _In_ DWORD iLevel, _In_ QWORD pa, _In_ QWORD va, _In_ DWORD dwPID);
+
+/*
+* Retrieve the global reverse physical to virtual index. The index is built in
+* a single page table walk of all active processes on first use and is kept
+* until the next total process refresh.
+* CALLER DECREF: return
+* -- fBuildOnMiss = build the index if not already existing.
+* -- return
+*/
+PVMMOB_PHYS2VIRT_INDEX VmmPhys2VirtIndex_Get(_In_ BOOL fBuildOnMiss);
+
+/*
+* Query the reverse physical to virtual index for all virtual addresses which
+* map a physical address. Virtual addresses returned include the page offset.
+* -- pIndex
+* -- pa
+* -- pe = buffer to receive up to cMax entries (or NULL).
+* -- cMax
+* -- return = total number of matching entries (may be larger than cMax).
+*/
+DWORD VmmPhys2VirtIndex_Query(_In_ PVMMOB_PHYS2VIRT_INDEX pIndex, _In_ QWORD pa, _Out_writes_opt_(cMax) PVMM_PHYS2VIRT_INDEX_ENTRY pe, _In_ DWORD cMax);
+
 /*
 * Retrieve the PTE hardware page table memory map.
 * CALLER DECREF: ppObPteMap
@@ -1021,6 +1703,12 @@ PVMMOB_PHYS2VIRT_INFORMATION VmmPhys2VirtGetInformation(_In_ PVMM_PROCESS pProce
 _Success_(return)
 BOOL VmmMap_GetPte(_In_ PVMM_PROCESS pProcess, _Out_ PVMMOB_MAP_PTE *ppObPteMap, _In_ BOOL fExtendedText);
 
+/*
+* Object manager callback function for cleanup of PTE maps (VMMOB_MAP_PTE).
+* -- pVmmOb
+*/
+VOID VmmMap_PteMap_CloseObCallback(_In_ PVOID pVmmOb);
+
 /*
 * Retrieve a single PVMM_MAP_PTEENTRY from the PTE hardware page table memory map.
 * -- pProcess
@@ -1220,8 +1908,10 @@ VOID VmmProcessListPIDs(_Out_writes_opt_(*pcPIDs) PDWORD pPIDs, _Inout_ PSIZE_T
 * NB! Manipulation of ctx in pfnAction callback function must be thread-safe!
 * NB! For fast actions VmmProcessGetNext in single-threaded mode is recommended
 *     over the use of this function!
+* The processes are scheduled one at a time on the persistent work pool (see
+* VmmWorkParallel) so that a single slow process does not stall other work.
 * -- ctx = optional context forwarded to callback functions pfnCriteria / pfnAction.
-* -- dwThreadLoadFactor = number of processed queued on each thread, or 0 for auto-select.
+* -- dwThreadLoadFactor = not used - processes are scheduled individually.
 * -- pfnCriteria = optional callback function selecting which processes to process.
 * -- pfnAction = processing function to be called in multi-threaded context.
 */
@@ -1241,12 +1931,152 @@ VOID VmmProcessActionForeachParallel(
 */
 BOOL VmmProcessActionForeachParallel_CriteriaActiveOnly(_In_ PVMM_PROCESS pProcess, _In_opt_ PVOID ctx);
 
+/*
+* Execute the function pfnItem once for each item index in [0, cItems) in
+* parallel on the persistent process-wide work pool. The pool is sized to the
+* number of processor cores and started on first use. Items are claimed one at
+* a time by the calling thread and by any idle pool thread, which balances the
+* load and allows nested calls from within pfnItem. The function returns once
+* all items have completed. Items are skipped if the vmm is shutting down.
+* NB! Manipulation of ctx in pfnItem callback function must be thread-safe!
+* -- ctx = optional context forwarded to pfnItem.
+* -- cItems
+* -- pfnItem
+*/
+VOID VmmWorkParallel(_In_opt_ PVOID ctx, _In_ DWORD cItems, _In_ VOID(*pfnItem)(_In_opt_ PVOID ctx, _In_ DWORD iItem));
+
+/*
+* Execute the function pfnItem(ctx, 0) asynchronously on the persistent work
+* pool and return immediately. The item is always executed - also if the vmm
+* is shutting down - so that it's able to release ctx; pfnItem should check
+* ctxVmm->ThreadWorkers.fEnabled before doing any actual work.
+* NB! pfnItem must never wait for work submitted after itself.
+* -- ctx = optional context forwarded to pfnItem.
+* -- pfnItem
+* -- return = TRUE if submitted, FALSE if the caller should execute the work.
+*/
+_Success_(return)
+BOOL VmmWorkAsync(_In_opt_ PVOID ctx, _In_ VOID(*pfnItem)(_In_opt_ PVOID ctx, _In_ DWORD iItem));
+
+/*
+* Retrieve the next value of the monotonic generation counter used by process
+* tables and map objects. Newer objects always have a higher generation.
+* -- return
+*/
+inline QWORD VmmGenerationNext()
+{
+    return (QWORD)InterlockedIncrement64((volatile LONG64*)&ctxVmm->qwGeneration);
+}
+
+/*
+* Assign a generation to a newly built module/handle map of a process. If the
+* content hash is unchanged since the map was most recently built for the same
+* (persistent) process the previous generation is retained. Otherwise a new
+* generation is assigned and, if a previous map existed, the map changed event
+* is queued.
+* -- pProcess
+* -- fEvent = VMM_NOTIFY_MAP_MODULE or VMM_NOTIFY_MAP_HANDLE
+* -- pGeneration = the generation tracking entry in pProcess->pObPersistent.
+* -- qwHash = content hash of the new map.
+* -- return = the generation to assign to the new map.
+*/
+QWORD VmmNotify_MapGeneration(_In_ PVMM_PROCESS pProcess, _In_ DWORD fEvent, _Inout_ PVMM_MAP_GENERATION pGeneration, _In_ QWORD qwHash);
+
+/*
+* Queue a change notification event for later dispatch by VmmNotify_Dispatch.
+* -- fEvent = VMM_NOTIFY_*
+* -- dwPID
+*/
+VOID VmmNotify_Post(_In_ DWORD fEvent, _In_ DWORD dwPID);
+
+/*
+* Dispatch all queued change notification events to plugins and subscribers.
+* Process terminate events are dispatched before process create events. The
+* caller should hold ctxVmm->MasterLock (serialize against plugin changes).
+*/
+VOID VmmNotify_Dispatch();
+
+/*
+* Subscribe to change notification events.
+* -- fEventMask = VMM_NOTIFY_* events to subscribe to.
+* -- pfnCB
+* -- ctx = optional context to pass along to the callback function.
+* -- return
+*/
+_Success_(return)
+BOOL VmmNotify_Subscribe(_In_ DWORD fEventMask, _In_ VOID(*pfnCB)(_In_opt_ PVOID ctx, _In_ DWORD fEvent, _In_opt_ PVOID pvEvent, _In_opt_ DWORD cbEvent), _In_opt_ PVOID ctx);
+
+/*
+* Remove a change notification subscription previously added with the same
+* callback function and context by VmmNotify_Subscribe. Waits for an ongoing
+* dispatch to the subscribers to complete - the callback is never called after
+* this function has returned. May be called from within a subscriber callback
+* in which case the wait is skipped.
+* -- pfnCB
+* -- ctx
+* -- return
+*/
+_Success_(return)
+BOOL VmmNotify_Unsubscribe(_In_ VOID(*pfnCB)(_In_opt_ PVOID ctx, _In_ DWORD fEvent, _In_opt_ PVOID pvEvent, _In_opt_ DWORD cbEvent), _In_opt_ PVOID ctx);
+
 /* 
-* Clear the specified cache from all entries.
+* Clear the specified cache from all entries. The clear is O(1) - the cache
+* generation is increased and entries from previous generations are treated as
+* misses on lookup and are lazily reclaimed (see VmmCacheReclaimStale).
 * -- dwTblTag
 */
 VOID VmmCacheClear(_In_ DWORD dwTblTag);
 
+/*
+* Reclaim stale entries (from previous cache generations) in one region of the
+* specified cache. Regions are processed round-robin. This is meant to be called
+* periodically by a background thread to free up stale entries incrementally.
+* -- dwTblTag
+*/
+VOID VmmCacheReclaimStale(_In_ DWORD dwTblTag);
+
+/*
+* Set the total memory budget (in MB) of the PHYS/TLB/PAGING caches. The budget
+* is split evenly between the caches. Caches grow on demand up to their share
+* of the budget; surplus entries are released lazily if the budget shrinks.
+* -- cMB
+*/
+VOID VmmCacheSetBudget(_In_ DWORD cMB);
+
+/*
+* Set the eviction policy of the PHYS/TLB/PAGING caches.
+* -- tpPolicy = VMM_CACHE_POLICY_*
+*/
+VOID VmmCacheSetPolicy(_In_ DWORD tpPolicy);
+
+/*
+* Set the content deduplication mode of the PHYS cache. Lowering the mode
+* removes all existing deduplication records.
+* -- tpDedup = VMM_CACHE_DEDUP_*
+*/
+VOID VmmCacheSetDedup(_In_ DWORD tpDedup);
+
+/*
+* Check whether a paged memory read of a pte recently failed. Entries expire
+* after the negative cache time to live. Lock-free, single bucket probe.
+* -- pte
+* -- return
+*/
+BOOL VmmCachePagingFailedExists(_In_ QWORD pte);
+
+/*
+* Record a failed paged memory read of a pte in the fixed-size negative cache.
+* If the bucket is full the oldest (or an expired) entry is replaced.
+* -- pte
+*/
+VOID VmmCachePagingFailedPush(_In_ QWORD pte);
+
+/*
+* Set the time to live of entries in the negative paging cache.
+* -- cMs
+*/
+VOID VmmCachePagingFailedSetTTL(_In_ DWORD cMs);
+
 /*
 * Invalidate cache entries belonging to a specific physical address.
 * -- pa
@@ -1264,6 +2094,20 @@ VOID VmmCacheInvalidate(_In_ QWORD pa);
 */
 VOID VmmCachePrefetchPages(_In_opt_ PVMM_PROCESS pProcess, _In_opt_ POB_VSET pPrefetchPages, _In_ QWORD flags);
 
+/*
+* Prefetch a set of addresses contained in pPrefetchPages into the cache as a
+* prefetch hint. Towards remote devices the prefetch is issued in the background
+* and the function returns immediately; subsequent reads of pages which are
+* being prefetched wait for it. Towards other devices the prefetch is
+* synchronous (VmmCachePrefetchPages).
+* NB! pPrefetchPages must contain page aligned addresses only and must not be
+*     updated/altered after the function call.
+* -- pProcess
+* -- pPrefetchPages
+* -- flags
+*/
+VOID VmmCachePrefetchPagesAsync(_In_opt_ PVMM_PROCESS pProcess, _In_opt_ POB_VSET pPrefetchPages, _In_ QWORD flags);
+
 /*
 * Prefetch a set of addresses. This is useful when reading data from somewhat
 * known addresses over higher latency connections.
@@ -0,0 +1,245 @@
+// vmmcachefile.c : implementation of the persistent on-disk page table and
+//                  initialization cache ("sidecar" cache file) used to speed
+//                  up repeated opens of the same static memory dump file.
+//
+// The cache file is only used for static (non-volatile) memory dump files.
+// It is keyed by a hash of the memory dump file identity, last write time,
+// size, header and a number of sampled blocks spread across the file. A sample
+// of the loaded page tables is also verified against the dump. It contains
+// the verified page tables of the TLB cache and the results of the windows
+// initialization (DTB, kernel base, system EPROCESS and EPROCESS offsets).
+//
+// (c) Ulf Frisk, 2019
+// Author: Ulf Frisk, pcileech@frizk.net
+//
+
+#include "vmmcachefile.h"
+
+#define VMMCACHEFILE_MAGIC          0x46434d56      // 'VMCF'
+#define VMMCACHEFILE_VERSION        2
+#define VMMCACHEFILE_CB_KEYHEADER   0x2000
+#define VMMCACHEFILE_CB_KEYSAMPLE   0x1000
+#define VMMCACHEFILE_C_KEYSAMPLE    64
+#define VMMCACHEFILE_C_VERIFY       16
+
+typedef struct tdVMMCACHEFILE_HEADER {
+    DWORD dwMagic;
+    DWORD dwVersion;
+    QWORD qwKey;
+    DWORD tpMemoryModel;
+    DWORD cPageTables;
+    QWORD paDTB;
+    QWORD vaKernelBase;
+    QWORD vaSystemEPROCESS;
+    VMM_WIN_EPROCESS_OFFSET OffsetEPROCESS;
+} VMMCACHEFILE_HEADER, *PVMMCACHEFILE_HEADER;
+
+typedef struct tdVMMCACHEFILE_WRITE_CONTEXT {
+    FILE *hFile;
+    DWORD cPageTables;
+    BOOL fError;
+} VMMCACHEFILE_WRITE_CONTEXT, *PVMMCACHEFILE_WRITE_CONTEXT;
+
+VOID VmmCacheFile_CalculateKey_Hash(_Inout_ PQWORD pqwKey, _In_reads_(cb) PBYTE pb, _In_ DWORD cb)
+{
+    DWORD i;
+    QWORD qwKey = *pqwKey;
+    for(i = 0; i < cb; i++) {
+        qwKey = (qwKey ^ pb[i]) * 0x100000001b3;
+    }
+    *pqwKey = qwKey;
+}
+
+/*
+* Calculate the cache file key from the memory dump file. The key is a 64-bit
+* FNV-1a hash of the dump file identity (volume serial and file index), last
+* write time, size, the dump file header, blocks sampled evenly across the
+* dump file and the max address.
+* -- pqwKey
+* -- return
+*/
+_Success_(return)
+BOOL VmmCacheFile_CalculateKey(_Out_ PQWORD pqwKey)
+{
+    BOOL fResult = FALSE;
+    HANDLE hFile;
+    LPSTR szFile;
+    DWORD i, cbRead;
+    QWORD cbFile, qwOffset, qwKey = 0xcbf29ce484222325;
+    OVERLAPPED ov = { 0 };
+    BY_HANDLE_FILE_INFORMATION FileInfo;
+    BYTE pb[VMMCACHEFILE_CB_KEYHEADER];
+    szFile = ctxMain->dev.szDevice;
+    if(0 == _strnicmp(szFile, "file://", 7)) { szFile += 7; }
+    hFile = CreateFileA(szFile, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(hFile == INVALID_HANDLE_VALUE) { return FALSE; }
+    if(!GetFileInformationByHandle(hFile, &FileInfo)) { goto fail; }
+    cbFile = ((QWORD)FileInfo.nFileSizeHigh << 32) | FileInfo.nFileSizeLow;
+    if(!cbFile) { goto fail; }
+    // 1: file identity, last write time, size and max address
+    VmmCacheFile_CalculateKey_Hash(&qwKey, (PBYTE)&FileInfo.dwVolumeSerialNumber, sizeof(DWORD));
+    VmmCacheFile_CalculateKey_Hash(&qwKey, (PBYTE)&FileInfo.nFileIndexHigh, sizeof(DWORD));
+    VmmCacheFile_CalculateKey_Hash(&qwKey, (PBYTE)&FileInfo.nFileIndexLow, sizeof(DWORD));
+    VmmCacheFile_CalculateKey_Hash(&qwKey, (PBYTE)&FileInfo.ftLastWriteTime, sizeof(FILETIME));
+    VmmCacheFile_CalculateKey_Hash(&qwKey, (PBYTE)&cbFile, sizeof(QWORD));
+    VmmCacheFile_CalculateKey_Hash(&qwKey, (PBYTE)&ctxMain->dev.paMaxNative, sizeof(QWORD));
+    // 2: header
+    if(!ReadFile(hFile, pb, VMMCACHEFILE_CB_KEYHEADER, &cbRead, &ov) || !cbRead) { goto fail; }
+    VmmCacheFile_CalculateKey_Hash(&qwKey, pb, cbRead);
+    // 3: blocks sampled evenly across the file
+    for(i = 1; i <= VMMCACHEFILE_C_KEYSAMPLE; i++) {
+        qwOffset = (cbFile / (VMMCACHEFILE_C_KEYSAMPLE + 1) * i) & ~(QWORD)(VMMCACHEFILE_CB_KEYSAMPLE - 1);
+        ov.Offset = (DWORD)qwOffset;
+        ov.OffsetHigh = (DWORD)(qwOffset >> 32);
+        if(!ReadFile(hFile, pb, VMMCACHEFILE_CB_KEYSAMPLE, &cbRead, &ov)) { goto fail; }
+        VmmCacheFile_CalculateKey_Hash(&qwKey, pb, cbRead);
+    }
+    *pqwKey = qwKey;
+    fResult = TRUE;
+fail:
+    CloseHandle(hFile);
+    return fResult;
+}
+
+/*
+* Verify a page table loaded from the cache file against the memory dump.
+* -- pObMEM
+* -- return
+*/
+_Success_(return)
+BOOL VmmCacheFile_Load_Verify(_In_ PVMMOB_MEM pObMEM)
+{
+    DWORD cbRead = 0;
+    BYTE pb[0x1000];
+    VmmReadEx(NULL, pObMEM->h.qwA, pb, 0x1000, &cbRead, VMM_FLAG_NOCACHE);
+    return (cbRead == 0x1000) && !memcmp(pb, pObMEM->pb, 0x1000);
+}
+
+/*
+* Load page tables and initialization hints from an existing cache file. A
+* sample of the loaded page tables is verified against the memory dump; on a
+* mismatch the loaded page tables are discarded and the cache file ignored.
+* -- return
+*/
+_Success_(return)
+BOOL VmmCacheFile_Load()
+{
+    FILE *hFile = NULL;
+    BOOL fMismatch = FALSE;
+    DWORD i, cPageTables, cVerifyStep;
+    VMMCACHEFILE_HEADER hdr;
+    PVMMOB_MEM pObMEM;
+    if(fopen_s(&hFile, ctxMain->cfg.szCacheFile, "rb") || !hFile) { return FALSE; }
+    if((1 != fread(&hdr, sizeof(VMMCACHEFILE_HEADER), 1, hFile)) || (hdr.dwMagic != VMMCACHEFILE_MAGIC) || (hdr.dwVersion != VMMCACHEFILE_VERSION)) {
+        vmmprintfv_fn("Cache file '%s' is invalid - ignoring.\n", ctxMain->cfg.szCacheFile);
+        goto fail;
+    }
+    if(hdr.qwKey != ctxVmm->CacheFile.qwKey) {
+        vmmprintfv_fn("Cache file '%s' does not match memory dump - ignoring.\n", ctxMain->cfg.szCacheFile);
+        goto fail;
+    }
+    // load verified page tables into the tlb cache (up to the cache size)
+    cPageTables = min(hdr.cPageTables, ctxVmm->Cache.TLB.cMaxEntries);
+    cVerifyStep = max(1, cPageTables / VMMCACHEFILE_C_VERIFY);
+    for(i = 0; i < cPageTables; i++) {
+        if(!(pObMEM = VmmCacheReserve(VMM_CACHE_TAG_TLB))) { break; }
+        if((1 != fread(&pObMEM->h.qwA, sizeof(QWORD), 1, hFile)) || (0x1000 != fread(pObMEM->pb, 1, 0x1000, hFile)) || (pObMEM->h.qwA & 0xfff) || (pObMEM->h.qwA >= ctxMain->dev.paMax)) {
+            pObMEM->h.qwA = (QWORD)-1;
+            VmmCacheReserveReturn(pObMEM);
+            break;
+        }
+        if((i % cVerifyStep == 0) && !VmmCacheFile_Load_Verify(pObMEM)) {
+            pObMEM->h.qwA = (QWORD)-1;
+            VmmCacheReserveReturn(pObMEM);
+            fMismatch = TRUE;
+            break;
+        }
+        pObMEM->h.cb = 0x1000;
+        VmmCacheReserveReturn(pObMEM);
+    }
+    if(fMismatch) {
+        vmmprintfv_fn("Cache file '%s' page table mismatch with memory dump - ignoring.\n", ctxMain->cfg.szCacheFile);
+        VmmCacheClear(VMM_CACHE_TAG_TLB);
+        goto fail;
+    }
+    // initialization hints
+    ctxVmm->CacheFile.paDTB = hdr.paDTB;
+    ctxVmm->CacheFile.vaKernelBase = hdr.vaKernelBase;
+    ctxVmm->CacheFile.vaSystemEPROCESS = hdr.vaSystemEPROCESS;
+    if(hdr.OffsetEPROCESS.fValid) {
+        memcpy(&ctxVmm->kernel.OffsetEPROCESS, &hdr.OffsetEPROCESS, sizeof(VMM_WIN_EPROCESS_OFFSET));
+    }
+    ctxVmm->CacheFile.fLoaded = TRUE;
+    fclose(hFile);
+    vmmprintfv_fn("Loaded %i page tables from cache file '%s'.\n", i, ctxMain->cfg.szCacheFile);
+    return TRUE;
+fail:
+    fclose(hFile);
+    return FALSE;
+}
+
+BOOL VmmCacheFile_Initialize()
+{
+    if(!ctxMain->cfg.szCacheFile[0]) { return FALSE; }
+    if(ctxMain->dev.fVolatile || (ctxMain->dev.tpDevice != LEECHCORE_DEVICE_FILE)) {
+        vmmprintfv_fn("Cache file only supported on static memory dump files - ignoring.\n");
+        return FALSE;
+    }
+    if(!VmmCacheFile_CalculateKey(&ctxVmm->CacheFile.qwKey)) {
+        vmmprintfv_fn("Unable to read memory dump file - ignoring cache file.\n");
+        return FALSE;
+    }
+    ctxVmm->CacheFile.fEnabled = TRUE;
+    return VmmCacheFile_Load();
+}
+
+VOID VmmCacheFile_Close_WriteCB(_In_opt_ PVMMCACHEFILE_WRITE_CONTEXT ctx, _In_ PVMMOB_MEM pObMEM)
+{
+    if(ctx->fError) { return; }
+    if((1 != fwrite(&pObMEM->h.qwA, sizeof(QWORD), 1, ctx->hFile)) || (0x1000 != fwrite(pObMEM->pb, 1, 0x1000, ctx->hFile))) {
+        ctx->fError = TRUE;
+        return;
+    }
+    ctx->cPageTables++;
+}
+
+VOID VmmCacheFile_Close()
+{
+    CHAR szFileTmp[MAX_PATH];
+    VMMCACHEFILE_HEADER hdr = { 0 };
+    VMMCACHEFILE_WRITE_CONTEXT ctx = { 0 };
+    PVMM_PROCESS pObSystemProcess = NULL;
+    if(!ctxVmm->CacheFile.fEnabled) { return; }
+    ctxVmm->CacheFile.fEnabled = FALSE;
+    // only write cache file if windows is initialized and new page tables
+    // have been read from the memory dump since the cache file was loaded.
+    if((ctxVmm->tpSystem != VMM_SYSTEM_WINDOWS_X64) && (ctxVmm->tpSystem != VMM_SYSTEM_WINDOWS_X86)) { return; }
+    if(ctxVmm->CacheFile.fLoaded && !ctxVmm->stat.cTlbReadSuccess) { return; }
+    if(!(pObSystemProcess = VmmProcessGet(4))) { return; }
+    hdr.dwMagic = VMMCACHEFILE_MAGIC;
+    hdr.dwVersion = VMMCACHEFILE_VERSION;
+    hdr.qwKey = ctxVmm->CacheFile.qwKey;
+    hdr.tpMemoryModel = ctxVmm->tpMemoryModel;
+    hdr.paDTB = ctxVmm->kernel.paDTB;
+    hdr.vaKernelBase = ctxVmm->kernel.vaBase;
+    hdr.vaSystemEPROCESS = pObSystemProcess->win.EPROCESS.va;
+    memcpy(&hdr.OffsetEPROCESS, &ctxVmm->kernel.OffsetEPROCESS, sizeof(VMM_WIN_EPROCESS_OFFSET));
+    Ob_DECREF_NULL(&pObSystemProcess);
+    // write to temporary file and replace any existing cache file on success.
+    if(_snprintf_s(szFileTmp, MAX_PATH, _TRUNCATE, "%s.tmp", ctxMain->cfg.szCacheFile) < 0) { return; }
+    if(fopen_s(&ctx.hFile, szFileTmp, "wb") || !ctx.hFile) {
+        vmmprintfv_fn("Unable to create cache file '%s'.\n", szFileTmp);
+        return;
+    }
+    ctx.fError = (1 != fwrite(&hdr, sizeof(VMMCACHEFILE_HEADER), 1, ctx.hFile));
+    VmmCacheEnumerate(VMM_CACHE_TAG_TLB, &ctx, (VOID(*)(PVOID, PVMMOB_MEM))VmmCacheFile_Close_WriteCB);
+    hdr.cPageTables = ctx.cPageTables;
+    ctx.fError = ctx.fError || _fseeki64(ctx.hFile, 0, SEEK_SET) || (1 != fwrite(&hdr, sizeof(VMMCACHEFILE_HEADER), 1, ctx.hFile));
+    ctx.fError = fclose(ctx.hFile) || ctx.fError;
+    if(ctx.fError || !MoveFileExA(szFileTmp, ctxMain->cfg.szCacheFile, MOVEFILE_REPLACE_EXISTING)) {
+        vmmprintfv_fn("Unable to write cache file '%s'.\n", ctxMain->cfg.szCacheFile);
+        DeleteFileA(szFileTmp);
+        return;
+    }
+    vmmprintfv_fn("Wrote %i page tables to cache file '%s'.\n", ctx.cPageTables, ctxMain->cfg.szCacheFile);
+}
@@ -0,0 +1,35 @@
+// vmmcachefile.h : declarations of the persistent on-disk page table and
+//                  initialization cache ("sidecar" cache file) used to speed
+//                  up repeated opens of the same static memory dump file.
+//
+// (c) Ulf Frisk, 2019
+// Author: Ulf Frisk, pcileech@frizk.net
+//
+
+#ifndef __VMMCACHEFILE_H__
+#define __VMMCACHEFILE_H__
+#include "vmm.h"
+
+/*
+* Initialize the cache file functionality. If a cache file is specified in the
+* configuration and the memory source is a static (non-volatile) dump file the
+* cache file key is calculated from a hash of the dump file identity, last
+* write time, size, header and sampled blocks across the file. If a valid
+* cache file with a matching key exists it is loaded; verified page tables are
+* inserted into the TLB cache and initialization hints are made available in
+* ctxVmm->CacheFile for use by the windows initialization.
+* This function should be called after VmmInitialize() and before the operating
+* system specific initialization takes place.
+* -- return = TRUE if a matching cache file was loaded, FALSE otherwise.
+*/
+BOOL VmmCacheFile_Initialize();
+
+/*
+* Write the cache file (if enabled and the contents have changed since load)
+* containing the current verified page tables in the TLB cache together with
+* the initialization results. This function should be called on close while
+* the process table and the TLB cache are still valid.
+*/
+VOID VmmCacheFile_Close();
+
+#endif /* __VMMCACHEFILE_H__ */
@@ -14,21 +14,27 @@
 #include "version.h"
 #include "vmm.h"
 #include "vmmproc.h"
+#include "vmmsearch.h"
+#include "vmmsnapshot.h"
 #include "vmmwin.h"
+#include "vmmwininit.h"
 #include "vmmwinreg.h"
 #include "vmmwintcpip.h"
+#include "vmmtrace.h"
 #include "vmmvfs.h"
+#include "m_vmmvfs_dump.h"
 
 // ----------------------------------------------------------------------------
-// Synchronization macro below. The VMM isn't thread safe so it's important to
-// serialize access to it over the VMM MasterLock. This master lock is shared
-// with internal VMM housekeeping functionality.
+// Synchronization macro below. The VMM is thread safe - api calls are not
+// serialized. Refreshes take per-subsystem locks (process list, registry) and
+// publish new state by pointer swap so api calls are never blocked by them.
 // ----------------------------------------------------------------------------
 
 #define CALL_IMPLEMENTATION_VMM(id, fn) {                               \
     QWORD tm;                                                           \
     BOOL result;                                                        \
     if(!ctxVmm) { return FALSE; }                                       \
+    VmmProcRefresh_Activity();                                          \
     tm = Statistics_CallStart();                                        \
     result = fn;                                                        \
     Statistics_CallEnd(id, tm);                                         \
@@ -39,6 +45,7 @@
     QWORD tm;                                                           \
     RetTp retVal;                                                       \
     if(!ctxVmm) { return ((RetTp)RetValFail); } /* UNSUCCESSFUL */      \
+    VmmProcRefresh_Activity();                                          \
     tm = Statistics_CallStart();                                        \
     retVal = fn;                                                        \
     Statistics_CallEnd(id, tm);                                         \
@@ -86,6 +93,22 @@ BOOL VmmDll_ConfigIntialize(_In_ DWORD argc, _In_ char* argv[])
             ctxMain->cfg.fDisableSymbolServerOnStartup = TRUE;
             i++;
             continue;
+        } else if(0 == _stricmp(argv[i], "-symbolpack")) {
+            ctxMain->cfg.fSymbolPack = TRUE;
+            i++;
+            continue;
+        } else if(0 == _stricmp(argv[i], "-noprofile")) {
+            ctxMain->cfg.fDisableProfile = TRUE;
+            i++;
+            continue;
+        } else if(0 == _stricmp(argv[i], "-numa")) {
+            ctxMain->cfg.fNUMA = TRUE;
+            i++;
+            continue;
+        } else if(0 == _stricmp(argv[i], "-memmap")) {
+            ctxMain->cfg.fMemMap = TRUE;
+            i++;
+            continue;
         } else if(0 == _stricmp(argv[i], "-norefresh")) {
             ctxMain->cfg.fDisableBackgroundRefresh = TRUE;
             i++;
@@ -94,12 +117,34 @@ BOOL VmmDll_ConfigIntialize(_In_ DWORD argc, _In_ char* argv[])
             ctxMain->cfg.fWaitInitialize = TRUE;
             i++;
             continue;
+        } else if(0 == _stricmp(argv[i], "-stagedinit")) {
+            ctxMain->cfg.fStagedInit = TRUE;
+            i++;
+            continue;
+        } else if(0 == _stricmp(argv[i], "-remotenocompress")) {
+            ctxMain->cfg.fRemoteNoCompress = TRUE;
+            i++;
+            continue;
         } else if(i + 1 >= argc) {
             return FALSE;
         } else if(0 == _stricmp(argv[i], "-cr3")) {
             ctxMain->cfg.paCR3 = Util_GetNumericA(argv[i + 1]);
             i += 2;
             continue;
+        } else if(0 == _stricmp(argv[i], "-cachesize")) {
+            ctxMain->cfg.cMB_CacheBudget = (DWORD)Util_GetNumericA(argv[i + 1]);
+            i += 2;
+            continue;
+        } else if(0 == _stricmp(argv[i], "-cachepolicy")) {
+            if(0 == _stricmp(argv[i + 1], "2q")) {
+                ctxMain->cfg.tpCachePolicy = VMM_CACHE_POLICY_2Q;
+            } else if(0 == _stricmp(argv[i + 1], "age")) {
+                ctxMain->cfg.tpCachePolicy = VMM_CACHE_POLICY_AGE;
+            } else {
+                return FALSE;
+            }
+            i += 2;
+            continue;
         } else if(0 == _stricmp(argv[i], "-max")) {
             ctxMain->dev.paMax = Util_GetNumericA(argv[i + 1]);
             i += 2;
@@ -112,6 +157,10 @@ BOOL VmmDll_ConfigIntialize(_In_ DWORD argc, _In_ char* argv[])
             strcpy_s(ctxMain->dev.szRemote, MAX_PATH, argv[i + 1]);
             i += 2;
             continue;
+        } else if(0 == _stricmp(argv[i], "-cachefile")) {
+            strcpy_s(ctxMain->cfg.szCacheFile, MAX_PATH, argv[i + 1]);
+            i += 2;
+            continue;
         } else if(0 == _stricmp(argv[i], "-pythonpath")) {
             strcpy_s(ctxMain->cfg.szPythonPath, MAX_PATH, argv[i + 1]);
             i += 2;
@@ -147,6 +196,7 @@ BOOL VmmDll_ConfigIntialize(_In_ DWORD argc, _In_ char* argv[])
     ctxMain->dev.flags |= ctxMain->cfg.fVerbose ? LEECHCORE_CONFIG_FLAG_PRINTF_VERBOSE_1 : 0;
     ctxMain->dev.flags |= ctxMain->cfg.fVerboseExtra ? LEECHCORE_CONFIG_FLAG_PRINTF_VERBOSE_2 : 0;
     ctxMain->dev.flags |= ctxMain->cfg.fVerboseExtraTlp ? LEECHCORE_CONFIG_FLAG_PRINTF_VERBOSE_3 : 0;
+    ctxMain->dev.flags |= ctxMain->cfg.fRemoteNoCompress ? LEECHCORE_CONFIG_FLAG_REMOTE_NO_COMPRESS : 0;
     return (ctxMain->dev.szDevice[0] != 0);
 }
 
@@ -190,6 +240,9 @@ VOID VmmDll_PrintHelp()
         "          Please see https://github.com/ufrisk/LeechCore for additional info.  \n" \
         "   -remote : connect to a remote host running the LeechAgent. Please see the   \n" \
         "          LeechCore documentation for more information.                        \n" \
+        "   -remotenocompress : do not compress memory transferred from the remote host.\n" \
+        "          Compression is on by default - zero-filled pages are next to free.   \n" \
+        "          Only useful on very fast links. Example: -remotenocompress           \n" \
         "   -v   : verbose option. Additional information is displayed in the output.   \n" \
         "          Option has no value. Example: -v                                     \n" \
         "   -vv  : extra verbose option. More detailed additional information is shown  \n" \
@@ -199,6 +252,16 @@ VOID VmmDll_PrintHelp()
         "   -cr3 : base address of kernel/process page table (PML4) / CR3 CPU register. \n" \
         "   -max : memory max address, valid range: 0x0 .. 0xffffffffffffffff           \n" \
         "          default: auto-detect (max supported by device / target system).      \n" \
+        "   -cachesize : total memory budget in MB of the physical memory, page table   \n" \
+        "          and paged memory caches. The budget is split evenly between caches.  \n" \
+        "          default: 384   Example: -cachesize 4096                              \n" \
+        "   -cachepolicy : cache eviction policy. Valid options: age, 2q. The 2q policy \n" \
+        "          keeps frequently used pages cached during large memory scans.        \n" \
+        "          default: age   Example: -cachepolicy 2q                              \n" \
+        "   -cachefile : persistent page table and initialization cache file. Speeds up \n" \
+        "          repeated opens of the same static memory dump file. The file is      \n" \
+        "          created on close and only used if it matches the memory dump.        \n" \
+        "          Example: -cachefile c:\\temp\\memdump-win10x64.vmmcache              \n" \
         "   -pagefile0..9 : specify specify page file / swap file. By default pagefile  \n" \
         "          have index 0 - example: -pagefile0 pagefile.sys while swapfile have  \n" \
         "          have index 1 - example: -pagefile1 swapfile.sys                      \n" \
@@ -213,8 +276,22 @@ VOID VmmDll_PrintHelp()
         "   -symbolserverdisable : disable any integrations with the Microsoft Symbol   \n" \
         "          Server used by the debugging .pdb symbol subsystem. Functionality    \n" \
         "          will be limited if this is activated. Example: -symbolserverdisable  \n" \
+        "   -symbolpack : use compact symbol packs stored in the symbol cache directory.\n" \
+        "          Symbols and types used are written to a small pack on close. If the  \n" \
+        "          pack exists the .pdb is only loaded if symbols are missing in it.    \n" \
+        "          Speeds up startup and works on offline hosts. Example: -symbolpack   \n" \
         "   -waitinitialize : wait debugging .pdb symbol subsystem to fully start before\n" \
         "          mounting file system and fully starting MemProcFS.                   \n" \
+        "   -stagedinit : return as soon as the kernel and the process list are ready.  \n" \
+        "          Registry, symbols, paging and threading are initialized in parallel  \n" \
+        "          in the background. Stage timings are shown in .status/init_stages.   \n" \
+        "          Example: -stagedinit                                                 \n" \
+        "   -numa : numa mode for multi-socket hosts. Cache entries are re-used on the  \n" \
+        "          numa node that allocated them and the work pool threads are pinned   \n" \
+        "          round-robin to the numa nodes. Example: -numa                        \n" \
+        "   -memmap : memory map a local raw memory dump file. Physical memory reads    \n" \
+        "          are copied directly from the mapped file and are not cached by the   \n" \
+        "          VMM - the operating system file cache is used instead. Example: -memmap\n" \
         "                                                                               \n",
         VERSION_MAJOR, VERSION_MINOR, VERSION_REVISION
     );
@@ -233,15 +310,24 @@ VOID VmmDll_FreeContext()
         LocalFree(ctxMain);
         ctxMain = NULL;
     }
+    VmmTrace_Close();
 }
 
 _Success_(return)
 BOOL VMMDLL_Initialize(_In_ DWORD argc, _In_ LPSTR argv[])
 {
+    // state is process-wide - a previous instance must be closed before a new
+    // instance is initialized (overwriting it would leak the instance and its
+    // memory acquisition device while its threads are still running).
+    if(ctxMain) {
+        vmmprintf("MemProcFS: Failed to initialize - already initialized - call VMMDLL_Close first.\n");
+        return FALSE;
+    }
     ctxMain = LocalAlloc(LMEM_ZEROINIT, sizeof(VMM_MAIN_CONTEXT));
     if(!ctxMain) {
         return FALSE;
     }
+    VmmTrace_Initialize();
     // initialize configuration
     if(!VmmDll_ConfigIntialize((DWORD)argc, argv)) {
         VmmDll_PrintHelp();
@@ -278,9 +364,170 @@ BOOL VMMDLL_Close()
 // CONFIGURATION SETTINGS BELOW:
 //-----------------------------------------------------------------------------
 
+_Success_(return)
+BOOL VMMDLL_ConfigGet_VmmCore_CacheStatistics(_In_ ULONG64 fOption, _Out_ PULONG64 pqwValue)
+{
+    DWORD dwTblTag;
+    VMM_CACHE_STATISTICS Stat;
+    switch(fOption & 0xfffff000) {
+        case VMMDLL_OPT_CONFIG_CACHESTAT_PHYS:
+            dwTblTag = VMM_CACHE_TAG_PHYS;
+            break;
+        case VMMDLL_OPT_CONFIG_CACHESTAT_TLB:
+            dwTblTag = VMM_CACHE_TAG_TLB;
+            break;
+        case VMMDLL_OPT_CONFIG_CACHESTAT_PAGING:
+            dwTblTag = VMM_CACHE_TAG_PAGING;
+            break;
+        default:
+            return FALSE;
+    }
+    if(!VmmCacheGetStatistics(dwTblTag, &Stat)) { return FALSE; }
+    switch(fOption & 0xff) {
+        case VMMDLL_OPT_CACHESTAT_HIT:
+            *pqwValue = Stat.Total.cHit;
+            break;
+        case VMMDLL_OPT_CACHESTAT_MISS:
+            *pqwValue = Stat.Total.cMiss;
+            break;
+        case VMMDLL_OPT_CACHESTAT_INSERT:
+            *pqwValue = Stat.Total.cInsert;
+            break;
+        case VMMDLL_OPT_CACHESTAT_EVICT:
+            *pqwValue = Stat.Total.cEvict;
+            break;
+        case VMMDLL_OPT_CACHESTAT_EVICT_STALE:
+            *pqwValue = Stat.Total.cEvictStale;
+            break;
+        case VMMDLL_OPT_CACHESTAT_ENTRIES:
+            *pqwValue = Stat.Total.cEntries;
+            break;
+        case VMMDLL_OPT_CACHESTAT_ENTRIES_MAX:
+            *pqwValue = Stat.cMaxEntries;
+            break;
+        case VMMDLL_OPT_CACHESTAT_LOCK_CONTENDED:
+            *pqwValue = Stat.Total.cLockContended;
+            break;
+        case VMMDLL_OPT_CACHESTAT_LOCK_WAIT_US:
+            *pqwValue = Stat.Total.qwLockWaitUs;
+            break;
+        default:
+            return FALSE;
+    }
+    return TRUE;
+}
+
+_Success_(return)
+BOOL VMMDLL_ConfigGet_VmmCore_InitStage(_In_ ULONG64 fOption, _Out_ PULONG64 pqwValue)
+{
+    BOOL fReady;
+    DWORD iStage = (DWORD)(fOption & 0xff);
+    if(iStage > VMM_INIT_STAGE_MAX) { return FALSE; }
+    iStage = iStage ? iStage - 1 : VMM_INIT_STAGE_MAX;      // VMMDLL_OPT_INIT_STAGE_ALL
+    switch(fOption & 0xfffff000) {
+        case VMMDLL_OPT_CONFIG_INIT_READY:
+            fReady = VmmWinInit_StageGet(iStage, NULL, NULL);
+            *pqwValue = fReady ? 1 : 0;
+            return TRUE;
+        case VMMDLL_OPT_CONFIG_INIT_TIME_MS:
+            VmmWinInit_StageGet(iStage, NULL, pqwValue);
+            return TRUE;
+        default:
+            return FALSE;
+    }
+}
+
+_Success_(return)
+BOOL VMMDLL_ConfigGet_VmmCore_Objects(_In_ ULONG64 fOption, _Out_ PULONG64 pqwValue)
+{
+    DWORD i, cStat, tag = (DWORD)(fOption >> 32);
+    QWORD qwValue = 0;
+    BOOL fFound = !tag;
+    OB_TAG_STATISTICS Stat[0x80];
+    if(!(fOption & 0xff) || ((fOption & 0xff) > VMMDLL_OPT_OBJECTS_TAGS)) { return FALSE; }
+    cStat = min(Ob_TagStatistics(Stat, sizeof(Stat) / sizeof(OB_TAG_STATISTICS)), sizeof(Stat) / sizeof(OB_TAG_STATISTICS));
+    if((fOption & 0xff) == VMMDLL_OPT_OBJECTS_TAGS) {
+        *pqwValue = cStat;
+        return TRUE;
+    }
+    for(i = 0; i < cStat; i++) {
+        if(tag && (tag != Stat[i].tag)) { continue; }
+        fFound = TRUE;
+        switch(fOption & 0xff) {
+            case VMMDLL_OPT_OBJECTS_ALIVE:
+                qwValue += Stat[i].cAlive;
+                break;
+            case VMMDLL_OPT_OBJECTS_ALLOC_TOTAL:
+                qwValue += Stat[i].cAllocTotal;
+                break;
+            case VMMDLL_OPT_OBJECTS_BYTES:
+                qwValue += Stat[i].cbAlive;
+                break;
+            case VMMDLL_OPT_OBJECTS_PEAK:
+                qwValue += Stat[i].cAlivePeak;      // sum of per-tag peaks if all tags
+                break;
+        }
+    }
+    if(!fFound) { return FALSE; }
+    *pqwValue = qwValue;
+    return TRUE;
+}
+
+_Success_(return)
+BOOL VMMDLL_ConfigGet_VmmCore_StatisticsCall(_In_ ULONG64 fOption, _Out_ PULONG64 pqwValue)
+{
+    STATISTICS_CALL_INFO Info;
+    if((fOption & 0xff) == VMMDLL_OPT_STATISTICS_CALL_IDS) {
+        *pqwValue = STATISTICS_ID_MAX + 1;
+        return TRUE;
+    }
+    if(!Statistics_CallGetInfo((DWORD)(fOption >> 32), &Info)) { return FALSE; }
+    switch(fOption & 0xff) {
+        case VMMDLL_OPT_STATISTICS_CALL_COUNT:
+            *pqwValue = Info.c;
+            return TRUE;
+        case VMMDLL_OPT_STATISTICS_CALL_TIME_TOTAL_US:
+            *pqwValue = Info.qwTotalUs;
+            return TRUE;
+        case VMMDLL_OPT_STATISTICS_CALL_TIME_P50_US:
+            *pqwValue = Info.qwP50Us;
+            return TRUE;
+        case VMMDLL_OPT_STATISTICS_CALL_TIME_P99_US:
+            *pqwValue = Info.qwP99Us;
+            return TRUE;
+        case VMMDLL_OPT_STATISTICS_CALL_TIME_P999_US:
+            *pqwValue = Info.qwP999Us;
+            return TRUE;
+        case VMMDLL_OPT_STATISTICS_CALL_TIME_MAX_US:
+            *pqwValue = Info.qwMaxUs;
+            return TRUE;
+        default:
+            return FALSE;
+    }
+}
+
 _Success_(return)
 BOOL VMMDLL_ConfigGet_VmmCore(_In_ ULONG64 fOption, _Out_ PULONG64 pqwValue)
 {
+    // options with a sub-option in bits 0-11 are routed on their exact range
+    // (plain options such as VMMDLL_OPT_WIN_VERSION_* have bits 12-15 clear).
+    switch(fOption & 0xfffff000) {
+        case VMMDLL_OPT_CONFIG_CACHESTAT_PHYS:
+        case VMMDLL_OPT_CONFIG_CACHESTAT_TLB:
+        case VMMDLL_OPT_CONFIG_CACHESTAT_PAGING:
+            return VMMDLL_ConfigGet_VmmCore_CacheStatistics(fOption, pqwValue);
+        case VMMDLL_OPT_CONFIG_INIT_READY:
+        case VMMDLL_OPT_CONFIG_INIT_TIME_MS:
+            return VMMDLL_ConfigGet_VmmCore_InitStage(fOption, pqwValue);
+        case VMMDLL_OPT_CONFIG_OBJECTS:
+            return VMMDLL_ConfigGet_VmmCore_Objects(fOption, pqwValue);
+        case VMMDLL_OPT_CONFIG_STATISTICS_CALL:
+            return VMMDLL_ConfigGet_VmmCore_StatisticsCall(fOption, pqwValue);
+        case 0x40000000:
+            break;
+        default:
+            return FALSE;
+    }
     switch(fOption) {
         case VMMDLL_OPT_CONFIG_IS_REFRESH_ENABLED:
             *pqwValue = ctxVmm->ThreadProcCache.fEnabled ? 1 : 0;
@@ -306,6 +553,48 @@ BOOL VMMDLL_ConfigGet_VmmCore(_In_ ULONG64 fOption, _Out_ PULONG64 pqwValue)
         case VMMDLL_OPT_CONFIG_STATISTICS_FUNCTIONCALL:
             *pqwValue = Statistics_CallGetEnabled() ? 1 : 0;
             break;
+        case VMMDLL_OPT_CONFIG_CACHE_BUDGET_MB:
+            *pqwValue = ctxVmm->Cache.cMB_Budget;
+            break;
+        case VMMDLL_OPT_CONFIG_CACHE_POLICY:
+            *pqwValue = ctxVmm->Cache.PHYS.tpPolicy;
+            break;
+        case VMMDLL_OPT_CONFIG_CACHE_DEDUP:
+            *pqwValue = ctxVmm->Cache.Dedup.tp;
+            break;
+        case VMMDLL_OPT_CONFIG_PROTOTYPEPTE_CACHE_MB:
+            *pqwValue = ctxVmm->Cache.PrototypePte.cbMax >> 20;
+            break;
+        case VMMDLL_OPT_CONFIG_PAGING_FAILED_TTL_MS:
+            *pqwValue = (QWORD)ctxVmm->Cache.PAGING_FAILED.dwTTL << VMM_PAGING_FAILED_TICK_SHIFT;
+            break;
+        case VMMDLL_OPT_CONFIG_READSCATTER_ASYNC_INFLIGHT:
+            *pqwValue = ctxVmm->ReadScatterAsync.cMaxInFlight;
+            break;
+        case VMMDLL_OPT_CONFIG_REMOTE_PIPELINE_DEPTH:
+            *pqwValue = ctxVmm->Remote.cPipelineDepth;
+            break;
+        case VMMDLL_OPT_CONFIG_REMOTE_COMPRESS:
+            *pqwValue = (ctxMain->dev.fRemote && !(ctxMain->dev.flags & LEECHCORE_CONFIG_FLAG_REMOTE_NO_COMPRESS)) ? 1 : 0;
+            break;
+        case VMMDLL_OPT_CONFIG_REMOTE_PREFETCH_ASYNC:
+            *pqwValue = ctxVmm->Remote.fPrefetchAsync ? 1 : 0;
+            break;
+        case VMMDLL_OPT_CONFIG_REGISTRY_LAZY:
+            *pqwValue = ctxVmm->fRegistryLazy ? 1 : 0;
+            break;
+        case VMMDLL_OPT_CONFIG_INIT_STAGED:
+            *pqwValue = ctxVmm->Init.fStaged ? 1 : 0;
+            break;
+        case VMMDLL_OPT_CONFIG_TRACE_RING:
+            *pqwValue = VmmTrace_RingGetEnabled() ? 1 : 0;
+            break;
+        case VMMDLL_OPT_CONFIG_REFRESH_ADAPTIVE:
+            *pqwValue = ctxVmm->ThreadProcCache.fAdaptive ? 1 : 0;
+            break;
+        case VMMDLL_OPT_CONFIG_REFRESH_IDLE_MS:
+            *pqwValue = ctxVmm->ThreadProcCache.cMs_Idle;
+            break;
         case VMMDLL_OPT_WIN_VERSION_MAJOR:
             *pqwValue = ctxVmm->kernel.dwVersionMajor;
             break;
@@ -399,6 +688,50 @@ BOOL VMMDLL_ConfigSet_VmmCore(_In_ ULONG64 fOption, _In_ ULONG64 qwValue)
         case VMMDLL_OPT_CONFIG_STATISTICS_FUNCTIONCALL:
             Statistics_CallSetEnabled(qwValue ? TRUE : FALSE);
             return TRUE;
+        case VMMDLL_OPT_CONFIG_CACHE_BUDGET_MB:
+            if((qwValue < VMM_CACHE_BUDGET_MB_MIN) || (qwValue > VMM_CACHE_BUDGET_MB_MAX)) { return FALSE; }
+            VmmCacheSetBudget((DWORD)qwValue);
+            break;
+        case VMMDLL_OPT_CONFIG_CACHE_POLICY:
+            if(qwValue > VMM_CACHE_POLICY_MAX) { return FALSE; }
+            VmmCacheSetPolicy((DWORD)qwValue);
+            break;
+        case VMMDLL_OPT_CONFIG_CACHE_DEDUP:
+            if(qwValue > VMM_CACHE_DEDUP_MAX) { return FALSE; }
+            VmmCacheSetDedup((DWORD)qwValue);
+            break;
+        case VMMDLL_OPT_CONFIG_PROTOTYPEPTE_CACHE_MB:
+            if((qwValue < VMM_PROTOTYPEPTE_CACHE_MB_MIN) || (qwValue > VMM_PROTOTYPEPTE_CACHE_MB_MAX)) { return FALSE; }
+            ctxVmm->Cache.PrototypePte.cbMax = qwValue << 20;
+            break;
+        case VMMDLL_OPT_CONFIG_PAGING_FAILED_TTL_MS:
+            if(qwValue > VMM_PAGING_FAILED_TTL_MS_MAX) { return FALSE; }
+            VmmCachePagingFailedSetTTL((DWORD)qwValue);
+            break;
+        case VMMDLL_OPT_CONFIG_READSCATTER_ASYNC_INFLIGHT:
+            if(!qwValue || (qwValue > VMM_READSCATTER_ASYNC_INFLIGHT_MAX)) { return FALSE; }
+            ctxVmm->ReadScatterAsync.cMaxInFlight = (DWORD)qwValue;
+            SetEvent(ctxVmm->ReadScatterAsync.hEventComplete);
+            break;
+        case VMMDLL_OPT_CONFIG_REMOTE_PIPELINE_DEPTH:
+            if(!qwValue || (qwValue > VMM_REMOTE_PIPELINE_DEPTH_MAX)) { return FALSE; }
+            ctxVmm->Remote.cPipelineDepth = (DWORD)qwValue;
+            break;
+        case VMMDLL_OPT_CONFIG_REMOTE_PREFETCH_ASYNC:
+            ctxVmm->Remote.fPrefetchAsync = qwValue ? TRUE : FALSE;
+            break;
+        case VMMDLL_OPT_CONFIG_REGISTRY_LAZY:
+            ctxVmm->fRegistryLazy = qwValue ? TRUE : FALSE;
+            break;
+        case VMMDLL_OPT_CONFIG_TRACE_RING:
+            VmmTrace_RingSetEnabled(qwValue ? TRUE : FALSE);
+            break;
+        case VMMDLL_OPT_CONFIG_REFRESH_ADAPTIVE:
+            ctxVmm->ThreadProcCache.fAdaptive = qwValue ? TRUE : FALSE;
+            break;
+        case VMMDLL_OPT_CONFIG_REFRESH_IDLE_MS:
+            ctxVmm->ThreadProcCache.cMs_Idle = (DWORD)qwValue;
+            break;
         default:
             return FALSE;
     }
@@ -479,6 +812,14 @@ NTSTATUS VMMDLL_VfsWrite(_In_ LPCWSTR wcsFileName, _In_ LPVOID pb, _In_ DWORD cb
         VmmVfs_Write(wcsFileName, pb, cb, pcbWrite, cbOffset))
 }
 
+_Success_(return)
+BOOL VMMDLL_DumpToFile(_In_ LPSTR szFileName, _In_ DWORD flags)
+{
+    CALL_IMPLEMENTATION_VMM(
+        STATISTICS_ID_VMMDLL_DumpToFile,
+        MVmmVfsDump_DumpToFile(szFileName, (flags & VMMDLL_DUMP_FLAG_CRASHDUMP) ? TRUE : FALSE))
+}
+
 NTSTATUS VMMDLL_UtilVfsReadFile_FromPBYTE(_In_ PBYTE pbFile, _In_ ULONG64 cbFile, _Out_ PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbRead, _In_ ULONG64 cbOffset)
 {
     return Util_VfsReadFile_FromPBYTE(pbFile, cbFile, pb, cb, pcbRead, cbOffset);
@@ -523,6 +864,22 @@ BOOL VMMDLL_VfsInitializePlugins()
         PluginManager_Initialize())
 }
 
+_Success_(return)
+BOOL VMMDLL_NotifySubscribe(_In_ DWORD fEventMask, _In_ VMMDLL_NOTIFY_CALLBACK pfnCallback, _In_opt_ PVOID ctx)
+{
+    CALL_IMPLEMENTATION_VMM(
+        STATISTICS_ID_VMMDLL_NotifySubscribe,
+        VmmNotify_Subscribe(fEventMask, pfnCallback, ctx))
+}
+
+_Success_(return)
+BOOL VMMDLL_NotifyUnsubscribe(_In_ VMMDLL_NOTIFY_CALLBACK pfnCallback, _In_opt_ PVOID ctx)
+{
+    CALL_IMPLEMENTATION_VMM(
+        STATISTICS_ID_VMMDLL_NotifyUnsubscribe,
+        VmmNotify_Unsubscribe(pfnCallback, ctx))
+}
+
 
 
 //-----------------------------------------------------------------------------
@@ -530,31 +887,11 @@ BOOL VMMDLL_VfsInitializePlugins()
 //-----------------------------------------------------------------------------
 
 _Success_(return)
-BOOL VMMDLL_Refresh_Impl(_In_ DWORD dwReserved)
-{
-    ULONG64 paMax;
-    // enforce global lock even if 'multi thread' is enabled
-    // we wish to avoid parallel process refreshes ...
-    EnterCriticalSection(&ctxVmm->MasterLock);
-    VmmCacheClear(VMM_CACHE_TAG_PHYS);
-    VmmCacheClear(VMM_CACHE_TAG_TLB);
-    VmmProc_RefreshProcesses(TRUE);
-    // update max physical address (if volatile).
-    if(ctxMain->dev.fVolatileMaxAddress) {
-        if(LeechCore_GetOption(LEECHCORE_OPT_MEMORYINFO_ADDR_MAX, &paMax) && (paMax > 0x01000000)) {
-            ctxMain->dev.paMax = paMax;
-        }
-    }
-    LeaveCriticalSection(&ctxVmm->MasterLock);
-    return TRUE;
-}
-
-_Success_(return)
-BOOL VMMDLL_Refresh(_In_ DWORD dwReserved)
+BOOL VMMDLL_Refresh(_In_ DWORD dwMaxAgeMs)
 {
     CALL_IMPLEMENTATION_VMM(
         STATISTICS_ID_VMMDLL_Refresh,
-        VMMDLL_Refresh_Impl(dwReserved))
+        VmmProcRefresh_OnDemand(dwMaxAgeMs))
 }
 
 /*
@@ -602,6 +939,160 @@ DWORD VMMDLL_MemReadScatter(_In_ DWORD dwPID, _Inout_ PPMEM_IO_SCATTER_HEADER pp
         VMMDLL_MemReadScatter_Impl(dwPID, ppMEMs, cpMEMs, flags))
 }
 
+typedef struct tdVMMDLL_MEMREADSCATTERASYNC_CONTEXT {
+    DWORD dwPID;
+    DWORD cpMEMs;
+    DWORD flags;
+    PPMEM_IO_SCATTER_HEADER ppMEMs;
+    VMMDLL_MEM_SCATTER_ASYNC_CALLBACK pfnCallback;
+    PVOID ctx;
+    HANDLE hEventDone;              // manual-reset - the caller holds a duplicate handle
+} VMMDLL_MEMREADSCATTERASYNC_CONTEXT, *PVMMDLL_MEMREADSCATTERASYNC_CONTEXT;
+
+/*
+* Work pool item callback for VMMDLL_MemReadScatterAsync.
+*/
+VOID VMMDLL_MemReadScatterAsync_ItemCB(_In_ PVMMDLL_MEMREADSCATTERASYNC_CONTEXT ctx, _In_ DWORD iItem)
+{
+    DWORD cMEMsRead = 0;
+    if(ctxVmm->ThreadWorkers.fEnabled) {
+        cMEMsRead = VMMDLL_MemReadScatter_Impl(ctx->dwPID, ctx->ppMEMs, ctx->cpMEMs, ctx->flags);
+    }
+    if(ctx->pfnCallback) {
+        ctx->pfnCallback(ctx->ctx, ctx->ppMEMs, ctx->cpMEMs, cMEMsRead);
+    }
+    SetEvent(ctx->hEventDone);
+    CloseHandle(ctx->hEventDone);
+    LocalFree(ctx);
+    InterlockedDecrement(&ctxVmm->ReadScatterAsync.cInFlight);
+    SetEvent(ctxVmm->ReadScatterAsync.hEventComplete);
+}
+
+_Success_(return != NULL)
+HANDLE VMMDLL_MemReadScatterAsync_Impl(_In_ DWORD dwPID, _Inout_ PPMEM_IO_SCATTER_HEADER ppMEMs, _In_ DWORD cpMEMs, _In_ DWORD flags, _In_opt_ VMMDLL_MEM_SCATTER_ASYNC_CALLBACK pfnCallback, _In_opt_ PVOID ctx)
+{
+    HANDLE hEventDone = NULL;
+    PVMMDLL_MEMREADSCATTERASYNC_CONTEXT ctxAsync;
+    if(!ctxVmm->ThreadWorkers.fEnabled) { return NULL; }
+    if(!(ctxAsync = LocalAlloc(0, sizeof(VMMDLL_MEMREADSCATTERASYNC_CONTEXT)))) { return NULL; }
+    if(!(ctxAsync->hEventDone = CreateEvent(NULL, TRUE, FALSE, NULL))) {
+        LocalFree(ctxAsync);
+        return NULL;
+    }
+    // the caller may close its handle before completion - give it a duplicate.
+    if(!DuplicateHandle(GetCurrentProcess(), ctxAsync->hEventDone, GetCurrentProcess(), &hEventDone, 0, FALSE, DUPLICATE_SAME_ACCESS)) {
+        CloseHandle(ctxAsync->hEventDone);
+        LocalFree(ctxAsync);
+        return NULL;
+    }
+    ctxAsync->dwPID = dwPID;
+    ctxAsync->ppMEMs = ppMEMs;
+    ctxAsync->cpMEMs = cpMEMs;
+    ctxAsync->flags = flags;
+    ctxAsync->pfnCallback = pfnCallback;
+    ctxAsync->ctx = ctx;
+    // wait for an in-flight slot to become available
+    while(InterlockedIncrement(&ctxVmm->ReadScatterAsync.cInFlight) > ctxVmm->ReadScatterAsync.cMaxInFlight) {
+        InterlockedDecrement(&ctxVmm->ReadScatterAsync.cInFlight);
+        if(!ctxVmm->ThreadWorkers.fEnabled) { goto fail; }
+        WaitForSingleObject(ctxVmm->ReadScatterAsync.hEventComplete, 10);
+    }
+    // the batch is read by the persistent work pool (no thread per batch).
+    if(!VmmWorkAsync(ctxAsync, (VOID(*)(PVOID, DWORD))VMMDLL_MemReadScatterAsync_ItemCB)) {
+        InterlockedDecrement(&ctxVmm->ReadScatterAsync.cInFlight);
+        goto fail;
+    }
+    return hEventDone;
+fail:
+    CloseHandle(hEventDone);
+    CloseHandle(ctxAsync->hEventDone);
+    LocalFree(ctxAsync);
+    return NULL;
+}
+
+_Success_(return != NULL)
+HANDLE VMMDLL_MemReadScatterAsync(_In_ DWORD dwPID, _Inout_ PPMEM_IO_SCATTER_HEADER ppMEMs, _In_ DWORD cpMEMs, _In_ DWORD flags, _In_opt_ VMMDLL_MEM_SCATTER_ASYNC_CALLBACK pfnCallback, _In_opt_ PVOID ctx)
+{
+    if(!ppMEMs || !cpMEMs) { return NULL; }
+    CALL_IMPLEMENTATION_VMM_RETURN(
+        STATISTICS_ID_VMMDLL_MemReadScatterAsync,
+        HANDLE,
+        NULL,
+        VMMDLL_MemReadScatterAsync_Impl(dwPID, ppMEMs, cpMEMs, flags, pfnCallback, ctx))
+}
+
+_Success_(return)
+BOOL VMMDLL_MemReadPageRef_Impl(_In_ DWORD dwPID, _In_ ULONG64 qwA, _Out_ PBYTE *ppbPage, _In_ DWORD flags)
+{
+    PVMMOB_MEM pObMEM;
+    PVMM_PROCESS pObProcess = NULL;
+    if(dwPID != -1) {
+        pObProcess = VmmProcessGet(dwPID);
+        if(!pObProcess) { return FALSE; }
+    }
+    pObMEM = VmmReadPageRef(pObProcess, qwA, flags);
+    Ob_DECREF(pObProcess);
+    if(!pObMEM) { return FALSE; }
+    *ppbPage = pObMEM->pb;          // reference overtaken by caller
+    return TRUE;
+}
+
+_Success_(return)
+BOOL VMMDLL_MemReadPageRef(_In_ DWORD dwPID, _In_ ULONG64 qwA, _Out_ PBYTE *ppbPage, _In_ DWORD flags)
+{
+    if(!ppbPage) { return FALSE; }
+    CALL_IMPLEMENTATION_VMM(
+        STATISTICS_ID_VMMDLL_MemReadPageRef,
+        VMMDLL_MemReadPageRef_Impl(dwPID, qwA, ppbPage, flags))
+}
+
+DWORD VMMDLL_MemReadScatterPageRef_Impl(_In_ DWORD dwPID, _In_reads_(cPages) PULONG64 pqwA, _In_ DWORD cPages, _Out_writes_(cPages) PBYTE *ppbPages, _In_ DWORD flags)
+{
+    DWORD i, cPagesRead = 0;
+    PVMMOB_MEM pObMEM;
+    PVMM_PROCESS pObProcess = NULL;
+    ZeroMemory(ppbPages, cPages * sizeof(PBYTE));
+    if(dwPID != -1) {
+        pObProcess = VmmProcessGet(dwPID);
+        if(!pObProcess) { return 0; }
+    }
+    // 1: pull pages not already in cache into cache in one scatter read
+    if(!(VMM_FLAG_NOCACHE & (flags | ctxVmm->flags))) {
+        VmmCachePrefetchPages4(pObProcess, cPages, pqwA, 0x1000, flags);
+    }
+    // 2: take page references
+    for(i = 0; i < cPages; i++) {
+        if((pObMEM = VmmReadPageRef(pObProcess, pqwA[i], flags))) {
+            ppbPages[i] = pObMEM->pb;   // reference overtaken by caller
+            cPagesRead++;
+        }
+    }
+    Ob_DECREF(pObProcess);
+    return cPagesRead;
+}
+
+DWORD VMMDLL_MemReadScatterPageRef(_In_ DWORD dwPID, _In_reads_(cPages) PULONG64 pqwA, _In_ DWORD cPages, _Out_writes_(cPages) PBYTE *ppbPages, _In_ DWORD flags)
+{
+    if(!pqwA || !ppbPages) { return 0; }
+    CALL_IMPLEMENTATION_VMM_RETURN(
+        STATISTICS_ID_VMMDLL_MemReadPageRef,
+        DWORD,
+        0,
+        VMMDLL_MemReadScatterPageRef_Impl(dwPID, pqwA, cPages, ppbPages, flags))
+}
+
+VOID VMMDLL_MemPageRelease(_In_opt_ PBYTE pbPage)
+{
+    PVMMOB_MEM pObMEM;
+    if(!pbPage || !ctxVmm) { return; }
+    pObMEM = CONTAINING_RECORD(pbPage, VMMOB_MEM, pb);
+    if((pObMEM->Ob._magic != OB_HEADER_MAGIC) || !VmmCacheTableGet(pObMEM->Ob._tag)) {
+        vmmprintf_fn("ERROR - INVALID PAGE RELEASED: %p\n", pbPage);
+        return;
+    }
+    Ob_DECREF(pObMEM);
+}
+
 _Success_(return)
 BOOL VMMDLL_MemReadEx_Impl(_In_ DWORD dwPID, _In_ ULONG64 qwA, _Out_writes_(cb) PBYTE pb, _In_ DWORD cb, _Out_opt_ PDWORD pcbReadOpt, _In_ ULONG64 flags)
 {
@@ -652,7 +1143,7 @@ BOOL VMMDLL_MemPrefetchPages_Impl(_In_ DWORD dwPID, _In_reads_(cPrefetchAddresse
     for(i = 0; i < cPrefetchAddresses; i++) {
         ObVSet_Push(pObVSet_PrefetchAddresses, pPrefetchAddresses[i] & ~0xfff);
     }
-    VmmCachePrefetchPages(pObProcess, pObVSet_PrefetchAddresses, 0);
+    VmmCachePrefetchPagesAsync(pObProcess, pObVSet_PrefetchAddresses, 0);
     result = TRUE;
 fail:
     Ob_DECREF(pObVSet_PrefetchAddresses);
@@ -690,6 +1181,15 @@ BOOL VMMDLL_MemWrite(_In_ DWORD dwPID, _In_ ULONG64 qwA, _In_reads_(cb) PBYTE pb
         VMMDLL_MemWrite_Impl(dwPID, qwA, pb, cb))
 }
 
+DWORD VMMDLL_MemWriteBatch(_In_ DWORD cEntries, _Inout_updates_(cEntries) PVMMDLL_MEM_WRITE_ENTRY pEntries, _In_ DWORD flags)
+{
+    CALL_IMPLEMENTATION_VMM_RETURN(
+        STATISTICS_ID_VMMDLL_MemWriteBatch,
+        DWORD,
+        0,
+        VmmWriteBatch(cEntries, (PVMM_WRITEBATCH_ENTRY)pEntries, flags))
+}
+
 _Success_(return)
 BOOL VMMDLL_MemVirt2Phys_Impl(_In_ DWORD dwPID, _In_ ULONG64 qwVA, _Out_ PULONG64 pqwPA)
 {
@@ -709,6 +1209,66 @@ BOOL VMMDLL_MemVirt2Phys(_In_ DWORD dwPID, _In_ ULONG64 qwVA, _Out_ PULONG64 pqw
         VMMDLL_MemVirt2Phys_Impl(dwPID, qwVA, pqwPA))
 }
 
+_Success_(return)
+BOOL VMMDLL_MemSearch(_Inout_ PVMMDLL_MEM_SEARCH_CONTEXT ctx)
+{
+    CALL_IMPLEMENTATION_VMM(
+        STATISTICS_ID_VMMDLL_MemSearch,
+        VmmSearch(ctx))
+}
+
+PVMMDLL_MEM_SNAPSHOT VMMDLL_MemSnapshot(_In_ DWORD dwPID, _In_ ULONG64 qwAddrMin, _In_ ULONG64 qwAddrMax, _In_ ULONG64 flags)
+{
+    CALL_IMPLEMENTATION_VMM_RETURN(
+        STATISTICS_ID_VMMDLL_MemSnapshot,
+        PVMMDLL_MEM_SNAPSHOT,
+        NULL,
+        VmmSnapshot_Create(dwPID, qwAddrMin, qwAddrMax, flags))
+}
+
+PVMMDLL_MEM_SNAPSHOT_DIFF VMMDLL_MemSnapshotDiff(_In_ PVMMDLL_MEM_SNAPSHOT pSnapshot, _Out_opt_ PVMMDLL_MEM_SNAPSHOT *ppSnapshotNew)
+{
+    CALL_IMPLEMENTATION_VMM_RETURN(
+        STATISTICS_ID_VMMDLL_MemSnapshotDiff,
+        PVMMDLL_MEM_SNAPSHOT_DIFF,
+        NULL,
+        VmmSnapshot_Diff(pSnapshot, ppSnapshotNew))
+}
+
+_Success_(return)
+BOOL VMMDLL_MemPhys2VirtIndex_Impl(_In_ DWORD cPAs, _In_reads_(cPAs) PULONG64 pPAs, _Out_writes_opt_(*pcEntries) PVMMDLL_PHYS2VIRT_ENTRY pEntries, _Inout_ PDWORD pcEntries)
+{
+    BOOL fResult = FALSE;
+    DWORD i, c, cTotal = 0;
+    PVMMOB_PHYS2VIRT_INDEX pObIndex = NULL;
+    if(!(pObIndex = VmmPhys2VirtIndex_Get(TRUE))) { goto fail; }
+    for(i = 0; i < cPAs; i++) {
+        cTotal += VmmPhys2VirtIndex_Query(pObIndex, pPAs[i], NULL, 0);
+    }
+    if(!pEntries) {
+        *pcEntries = cTotal;
+        fResult = TRUE;
+        goto fail;
+    }
+    if(*pcEntries < cTotal) { goto fail; }
+    for(i = 0, c = 0; i < cPAs; i++) {
+        c += VmmPhys2VirtIndex_Query(pObIndex, pPAs[i], (PVMM_PHYS2VIRT_INDEX_ENTRY)pEntries + c, cTotal - c);
+    }
+    *pcEntries = cTotal;
+    fResult = TRUE;
+fail:
+    Ob_DECREF(pObIndex);
+    return fResult;
+}
+
+_Success_(return)
+BOOL VMMDLL_MemPhys2VirtIndex(_In_ DWORD cPAs, _In_reads_(cPAs) PULONG64 pPAs, _Out_writes_opt_(*pcEntries) PVMMDLL_PHYS2VIRT_ENTRY pEntries, _Inout_ PDWORD pcEntries)
+{
+    CALL_IMPLEMENTATION_VMM(
+        STATISTICS_ID_VMMDLL_MemPhys2VirtIndex,
+        VMMDLL_MemPhys2VirtIndex_Impl(cPAs, pPAs, pEntries, pcEntries))
+}
+
 //-----------------------------------------------------------------------------
 // VMM PROCESS FUNCTIONALITY BELOW:
 //-----------------------------------------------------------------------------
@@ -818,6 +1378,62 @@ BOOL VMMDLL_ProcessMap_GetVad(_In_ DWORD dwPID, _Out_writes_bytes_opt_(*pcbVadMa
         VMMDLL_ProcessMap_GetVad_Impl(dwPID, pVadMap, pcbVadMap, fIdentifyModules))
 }
 
+_Success_(return)
+BOOL VMMDLL_ProcessMap_GetPteEntry_Impl(_In_ DWORD dwPID, _In_ QWORD va, _Out_ PVMMDLL_MAP_PTEENTRY pPteEntry)
+{
+    BOOL fResult = FALSE;
+    PVMMOB_MAP_PTE pObMap = NULL;
+    PVMM_PROCESS pObProcess = NULL;
+    PVMM_MAP_PTEENTRY pe;
+    if(!(pObProcess = VmmProcessGet(dwPID))) { goto fail; }
+    if(!VmmMap_GetPte(pObProcess, &pObMap, FALSE)) { goto fail; }
+    if(!(pe = VmmMap_GetPteEntry(pObMap, va))) { goto fail; }
+    memcpy(pPteEntry, pe, sizeof(VMMDLL_MAP_PTEENTRY));
+    pPteEntry->wszText = NULL;
+    pPteEntry->cwszText = 0;
+    fResult = TRUE;
+fail:
+    Ob_DECREF(pObProcess);
+    Ob_DECREF(pObMap);
+    return fResult;
+}
+
+_Success_(return)
+BOOL VMMDLL_ProcessMap_GetPteEntry(_In_ DWORD dwPID, _In_ ULONG64 va, _Out_ PVMMDLL_MAP_PTEENTRY pPteEntry)
+{
+    CALL_IMPLEMENTATION_VMM(
+        STATISTICS_ID_VMMDLL_ProcessMap_GetPteEntry,
+        VMMDLL_ProcessMap_GetPteEntry_Impl(dwPID, va, pPteEntry))
+}
+
+_Success_(return)
+BOOL VMMDLL_ProcessMap_GetVadEntry_Impl(_In_ DWORD dwPID, _In_ QWORD va, _Out_ PVMMDLL_MAP_VADENTRY pVadEntry)
+{
+    BOOL fResult = FALSE;
+    PVMMOB_MAP_VAD pObMap = NULL;
+    PVMM_PROCESS pObProcess = NULL;
+    PVMM_MAP_VADENTRY pe;
+    if(!(pObProcess = VmmProcessGet(dwPID))) { goto fail; }
+    if(!VmmMap_GetVad(pObProcess, &pObMap, FALSE)) { goto fail; }
+    if(!(pe = VmmMap_GetVadEntry(pObMap, va))) { goto fail; }
+    memcpy(pVadEntry, pe, sizeof(VMMDLL_MAP_VADENTRY));
+    pVadEntry->wszText = NULL;
+    pVadEntry->cwszText = 0;
+    fResult = TRUE;
+fail:
+    Ob_DECREF(pObProcess);
+    Ob_DECREF(pObMap);
+    return fResult;
+}
+
+_Success_(return)
+BOOL VMMDLL_ProcessMap_GetVadEntry(_In_ DWORD dwPID, _In_ ULONG64 va, _Out_ PVMMDLL_MAP_VADENTRY pVadEntry)
+{
+    CALL_IMPLEMENTATION_VMM(
+        STATISTICS_ID_VMMDLL_ProcessMap_GetVadEntry,
+        VMMDLL_ProcessMap_GetVadEntry_Impl(dwPID, va, pVadEntry))
+}
+
 _Success_(return)
 BOOL VMMDLL_ProcessMap_GetModule_Impl(_In_ DWORD dwPID, _Out_writes_bytes_opt_(*pcbModuleMap) PVMMDLL_MAP_MODULE pModuleMap, _Inout_ PDWORD pcbModuleMap)
 {
@@ -923,6 +1539,34 @@ BOOL VMMDLL_ProcessMap_GetHeap(_In_ DWORD dwPID, _Out_writes_bytes_opt_(*pcbHeap
         VMMDLL_ProcessMap_GetHeap_Impl(dwPID, pHeapMap, pcbHeapMap))
 }
 
+_Success_(return)
+BOOL VMMDLL_ProcessMap_EnumHeapEntries_Impl(_In_ DWORD dwPID, _In_ VMMDLL_HEAP_ENTRY_CALLBACK pfnCallback, _In_opt_ PVOID ctx)
+{
+    VMMWINHEAP_ENTRY e;
+    PVMM_PROCESS pObProcess = NULL;
+    PVMMOB_WINHEAP_ITERATOR pObIterator = NULL;
+    if(!pfnCallback) { return FALSE; }
+    if(!(pObProcess = VmmProcessGet(dwPID))) { return FALSE; }
+    if(!(pObIterator = VmmWinHeap_EntryIterator(pObProcess))) {
+        Ob_DECREF(pObProcess);
+        return FALSE;
+    }
+    while(VmmWinHeap_EntryNext(pObIterator, &e) && pfnCallback(ctx, (PVMMDLL_HEAP_ENTRY)&e)) {
+        ;
+    }
+    Ob_DECREF(pObIterator);
+    Ob_DECREF(pObProcess);
+    return TRUE;
+}
+
+_Success_(return)
+BOOL VMMDLL_ProcessMap_EnumHeapEntries(_In_ DWORD dwPID, _In_ VMMDLL_HEAP_ENTRY_CALLBACK pfnCallback, _In_opt_ PVOID ctx)
+{
+    CALL_IMPLEMENTATION_VMM(
+        STATISTICS_ID_VMMDLL_ProcessMap_EnumHeapEntries,
+        VMMDLL_ProcessMap_EnumHeapEntries_Impl(dwPID, pfnCallback, ctx))
+}
+
 _Success_(return)
 BOOL VMMDLL_ProcessMap_GetThread_Impl(_In_ DWORD dwPID, _Out_writes_bytes_opt_(*pcbThreadMap) PVMMDLL_MAP_THREAD pThreadMap, _Inout_ PDWORD pcbThreadMap)
 {
@@ -957,6 +1601,55 @@ BOOL VMMDLL_ProcessMap_GetThread(_In_ DWORD dwPID, _Out_writes_bytes_opt_(*pcbTh
         VMMDLL_ProcessMap_GetThread_Impl(dwPID, pThreadMap, pcbThreadMap))
 }
 
+_Success_(return)
+BOOL VMMDLL_ProcessMap_GetThreadChanged_Impl(_In_ DWORD dwGeneration, _Out_writes_bytes_opt_(*pcbThreadMap) PVMMDLL_MAP_THREAD pThreadMap, _Inout_ PDWORD pcbThreadMap, _Out_opt_ PDWORD pdwGeneration)
+{
+    BOOL fResult = FALSE;
+    DWORD i, cMap = 0, cMapMax = 0, dwGenerationCurrent;
+    PVMMOB_MAP_THREAD pObMap = NULL;
+    PVMM_PROCESS pObProcess = NULL;
+    if(pThreadMap) {
+        if(*pcbThreadMap < sizeof(VMMDLL_MAP_THREAD)) { goto fail; }
+        cMapMax = (*pcbThreadMap - sizeof(VMMDLL_MAP_THREAD)) / sizeof(VMMDLL_MAP_THREADENTRY);
+    }
+    VmmWinThread_InitializeAll();
+    // current generation is fetched before the maps are read - entries newer
+    // than the returned generation may thus be returned again in next call.
+    dwGenerationCurrent = ctxVmm->dwThreadMapGeneration;
+    while((pObProcess = VmmProcessGetNext(pObProcess, 0))) {
+        if(!VmmMap_GetThread(pObProcess, &pObMap)) { continue; }
+        if(pObMap->dwThreadGeneration > dwGeneration) {
+            for(i = 0; i < pObMap->cMap; i++) {
+                if(pObMap->pMap[i].dwGeneration <= dwGeneration) { continue; }
+                if(cMap < cMapMax) {
+                    memcpy(pThreadMap->pMap + cMap, pObMap->pMap + i, sizeof(VMMDLL_MAP_THREADENTRY));
+                }
+                cMap++;
+            }
+        }
+        Ob_DECREF_NULL(&pObMap);
+    }
+    if(pThreadMap) {
+        if(cMap > cMapMax) { goto fail; }
+        ZeroMemory(pThreadMap, sizeof(VMMDLL_MAP_THREAD));
+        pThreadMap->dwVersion = VMMDLL_MAP_THREAD_VERSION;
+        pThreadMap->cMap = cMap;
+    }
+    if(pdwGeneration) { *pdwGeneration = dwGenerationCurrent; }
+    fResult = TRUE;
+fail:
+    *pcbThreadMap = sizeof(VMMDLL_MAP_THREAD) + cMap * sizeof(VMMDLL_MAP_THREADENTRY);
+    return fResult;
+}
+
+_Success_(return)
+BOOL VMMDLL_ProcessMap_GetThreadChanged(_In_ DWORD dwGeneration, _Out_writes_bytes_opt_(*pcbThreadMap) PVMMDLL_MAP_THREAD pThreadMap, _Inout_ PDWORD pcbThreadMap, _Out_opt_ PDWORD pdwGeneration)
+{
+    CALL_IMPLEMENTATION_VMM(
+        STATISTICS_ID_VMMDLL_ProcessMap_GetThreadChanged,
+        VMMDLL_ProcessMap_GetThreadChanged_Impl(dwGeneration, pThreadMap, pcbThreadMap, pdwGeneration))
+}
+
 _Success_(return)
 BOOL VMMDLL_ProcessMap_GetHandle_Impl(_In_ DWORD dwPID, _Out_writes_bytes_opt_(*pcbHandleMap) PVMMDLL_MAP_HANDLE pHandleMap, _Inout_ PDWORD pcbHandleMap)
 {
@@ -1013,6 +1706,63 @@ BOOL VMMDLL_ProcessMap_GetHandle(_In_ DWORD dwPID, _Out_writes_bytes_opt_(*pcbHa
         VMMDLL_ProcessMap_GetHandle_Impl(dwPID, pHandleMap, pcbHandleMap))
 }
 
+_Success_(return)
+BOOL VMMDLL_ProcessGetGeneration_Impl(_In_ DWORD dwPID, _In_ DWORD tp, _Out_ PULONG64 pqwGeneration)
+{
+    BOOL fResult = FALSE;
+    PVMM_PROCESS pObProcess = NULL;
+    PVMMOB_PROCESS_TABLE pObPT = NULL;
+    PVMMOB_MAP_PTE pObPteMap = NULL;
+    PVMMOB_MAP_VAD pObVadMap = NULL;
+    PVMMOB_MAP_MODULE pObModuleMap = NULL;
+    PVMMOB_MAP_HEAP pObHeapMap = NULL;
+    PVMMOB_MAP_THREAD pObThreadMap = NULL;
+    PVMMOB_MAP_HANDLE pObHandleMap = NULL;
+    if(tp == VMMDLL_GENERATION_TP_PROCESSTABLE) {
+        if(!(pObPT = (PVMMOB_PROCESS_TABLE)ObContainer_GetOb(ctxVmm->pObCPROC))) { return FALSE; }
+        *pqwGeneration = pObPT->qwGeneration;
+        Ob_DECREF(pObPT);
+        return TRUE;
+    }
+    if(!(pObProcess = VmmProcessGet(dwPID))) { return FALSE; }
+    switch(tp) {
+        case VMMDLL_GENERATION_TP_PTE:
+            if((fResult = VmmMap_GetPte(pObProcess, &pObPteMap, FALSE))) { *pqwGeneration = pObPteMap->qwGeneration; }
+            break;
+        case VMMDLL_GENERATION_TP_VAD:
+            if((fResult = VmmMap_GetVad(pObProcess, &pObVadMap, FALSE))) { *pqwGeneration = pObVadMap->qwGeneration; }
+            break;
+        case VMMDLL_GENERATION_TP_MODULE:
+            if((fResult = VmmMap_GetModule(pObProcess, &pObModuleMap))) { *pqwGeneration = pObModuleMap->qwGeneration; }
+            break;
+        case VMMDLL_GENERATION_TP_HEAP:
+            if((fResult = VmmMap_GetHeap(pObProcess, &pObHeapMap))) { *pqwGeneration = pObHeapMap->qwGeneration; }
+            break;
+        case VMMDLL_GENERATION_TP_THREAD:
+            if((fResult = VmmMap_GetThread(pObProcess, &pObThreadMap))) { *pqwGeneration = pObThreadMap->qwGeneration; }
+            break;
+        case VMMDLL_GENERATION_TP_HANDLE:
+            if((fResult = VmmMap_GetHandle(pObProcess, &pObHandleMap, FALSE))) { *pqwGeneration = pObHandleMap->qwGeneration; }
+            break;
+    }
+    Ob_DECREF(pObPteMap);
+    Ob_DECREF(pObVadMap);
+    Ob_DECREF(pObModuleMap);
+    Ob_DECREF(pObHeapMap);
+    Ob_DECREF(pObThreadMap);
+    Ob_DECREF(pObHandleMap);
+    Ob_DECREF(pObProcess);
+    return fResult;
+}
+
+_Success_(return)
+BOOL VMMDLL_ProcessGetGeneration(_In_ DWORD dwPID, _In_ DWORD tp, _Out_ PULONG64 pqwGeneration)
+{
+    CALL_IMPLEMENTATION_VMM(
+        STATISTICS_ID_VMMDLL_ProcessGetGeneration,
+        VMMDLL_ProcessGetGeneration_Impl(dwPID, tp, pqwGeneration))
+}
+
 _Success_(return)
 BOOL VMMDLL_PidList_Impl(_Out_writes_opt_(*pcPIDs) PDWORD pPIDs, _Inout_ PULONG64 pcPIDs)
 {
@@ -1059,6 +1809,41 @@ BOOL VMMDLL_PidGetFromName(_In_ LPSTR szProcName, _Out_ PDWORD pdwPID)
         VMMDLL_PidGetFromName_Impl(szProcName, pdwPID))
 }
 
+/*
+* Fill process information (except the magic) from a process object.
+* -- pProcess
+* -- pInfo
+*/
+VOID VMMDLL_ProcessGetInformation_Impl_Fill(_In_ PVMM_PROCESS pProcess, _Inout_ PVMMDLL_PROCESS_INFORMATION pInfo)
+{
+    // set general parameters
+    pInfo->wVersion = VMMDLL_PROCESS_INFORMATION_VERSION;
+    pInfo->wSize = sizeof(VMMDLL_PROCESS_INFORMATION);
+    pInfo->tpMemoryModel = ctxVmm->tpMemoryModel;
+    pInfo->tpSystem = ctxVmm->tpSystem;
+    pInfo->fUserOnly = pProcess->fUserOnly;
+    pInfo->dwPID = pProcess->dwPID;
+    pInfo->dwPPID = pProcess->dwPPID;
+    pInfo->dwState = pProcess->dwState;
+    pInfo->paDTB = pProcess->paDTB;
+    pInfo->paDTB_UserOpt = pProcess->paDTB_UserOpt;
+    memcpy(pInfo->szName, pProcess->szName, sizeof(pInfo->szName));
+    strncpy_s(pInfo->szNameLong, sizeof(pInfo->szNameLong), pProcess->pObPersistent->szNameLong, _TRUNCATE);
+    // set operating system specific parameters
+    switch(ctxVmm->tpSystem) {
+        case VMM_SYSTEM_WINDOWS_X64:
+            pInfo->os.win.fWow64 = pProcess->win.fWow64;
+            pInfo->os.win.vaEPROCESS = pProcess->win.EPROCESS.va;
+            pInfo->os.win.vaPEB = pProcess->win.vaPEB;
+            pInfo->os.win.vaPEB32 = pProcess->win.vaPEB32;
+            break;
+        case VMM_SYSTEM_WINDOWS_X86:
+            pInfo->os.win.vaEPROCESS = pProcess->win.EPROCESS.va;
+            pInfo->os.win.vaPEB = pProcess->win.vaPEB;
+            break;
+    }
+}
+
 _Success_(return)
 BOOL VMMDLL_ProcessGetInformation_Impl(_In_ DWORD dwPID, _Inout_opt_ PVMMDLL_PROCESS_INFORMATION pInfo, _In_ PSIZE_T pcbProcessInfo)
 {
@@ -1073,32 +1858,7 @@ BOOL VMMDLL_ProcessGetInformation_Impl(_In_ DWORD dwPID, _Inout_opt_ PVMMDLL_PRO
     if(pInfo->wVersion != VMMDLL_PROCESS_INFORMATION_VERSION) { return FALSE; }
     if(!(pObProcess = VmmProcessGet(dwPID))) { return FALSE; }
     ZeroMemory(pInfo, sizeof(VMMDLL_PROCESS_INFORMATION_MAGIC));
-    // set general parameters
-    pInfo->wVersion = VMMDLL_PROCESS_INFORMATION_VERSION;
-    pInfo->wSize = sizeof(VMMDLL_PROCESS_INFORMATION);
-    pInfo->tpMemoryModel = ctxVmm->tpMemoryModel;
-    pInfo->tpSystem = ctxVmm->tpSystem;
-    pInfo->fUserOnly = pObProcess->fUserOnly;
-    pInfo->dwPID = dwPID;
-    pInfo->dwPPID = pObProcess->dwPPID;
-    pInfo->dwState = pObProcess->dwState;
-    pInfo->paDTB = pObProcess->paDTB;
-    pInfo->paDTB_UserOpt = pObProcess->paDTB_UserOpt;
-    memcpy(pInfo->szName, pObProcess->szName, sizeof(pInfo->szName));
-    strncpy_s(pInfo->szNameLong, sizeof(pInfo->szNameLong), pObProcess->pObPersistent->szNameLong, _TRUNCATE);
-    // set operating system specific parameters
-    switch(ctxVmm->tpSystem) {
-        case VMM_SYSTEM_WINDOWS_X64:
-            pInfo->os.win.fWow64 = pObProcess->win.fWow64;
-            pInfo->os.win.vaEPROCESS = pObProcess->win.EPROCESS.va;
-            pInfo->os.win.vaPEB = pObProcess->win.vaPEB;
-            pInfo->os.win.vaPEB32 = pObProcess->win.vaPEB32;
-            break;
-        case VMM_SYSTEM_WINDOWS_X86:
-            pInfo->os.win.vaEPROCESS = pObProcess->win.EPROCESS.va;
-            pInfo->os.win.vaPEB = pObProcess->win.vaPEB;
-            break;
-    }
+    VMMDLL_ProcessGetInformation_Impl_Fill(pObProcess, pInfo);
     Ob_DECREF(pObProcess);
     return TRUE;
 }
@@ -1158,6 +1918,80 @@ LPSTR VMMDLL_ProcessGetInformationString(_In_ DWORD dwPID, _In_ DWORD fOptionStr
         VMMDLL_ProcessGetInformationString_Impl(dwPID, fOptionString))
 }
 
+/*
+* Copy a string into the shared string blob. If the string is missing, or does
+* not fit, (i.e. the process parameters were read concurrently after the size
+* was calculated) the empty string at the start of the blob is returned.
+*/
+LPSTR VMMDLL_ProcessGetInformationAll_Impl_String(_In_ LPSTR szMultiText, _In_ DWORD cbMultiText, _Inout_ PDWORD pcbo, _In_opt_ LPSTR sz, _In_ DWORD cch)
+{
+    LPSTR szResult;
+    if(!sz || !cch || (*pcbo + cch + 1 > cbMultiText)) { return szMultiText; }
+    szResult = szMultiText + *pcbo;
+    memcpy(szResult, sz, cch);
+    *pcbo += cch + 1;
+    return szResult;
+}
+
+PVMMDLL_PROCESS_INFORMATION_ALL VMMDLL_ProcessGetInformationAll_Impl()
+{
+    SIZE_T cProcess = 0;
+    DWORD i, c = 0, cbMultiText = 1, cbo = 1;
+    PVMM_PROCESS pObProcess = NULL, *ppProcess = NULL;
+    PVMMDLL_PROCESS_INFORMATION_ALL pAll = NULL;
+    PVMMDLL_PROCESS_INFORMATION_ALL_ENTRY pe;
+    LPSTR szMultiText;
+    // 1: fetch user process parameters of all processes in one parallel pass.
+    VmmProcessActionForeachParallel(NULL, 5, VMMDLL_ProcessGetInformationString_Impl_CallbackCriteria, VMMDLL_ProcessGetInformationString_Impl_CallbackAction);
+    // 2: take a reference on all processes and calculate the string size.
+    VmmProcessListPIDs(NULL, &cProcess, 0);
+    if(!cProcess || !(ppProcess = LocalAlloc(LMEM_ZEROINIT, cProcess * sizeof(PVMM_PROCESS)))) { goto fail; }
+    while((pObProcess = VmmProcessGetNext(pObProcess, 0))) {
+        if(c == cProcess) {
+            Ob_DECREF_NULL(&pObProcess);
+            break;
+        }
+        ppProcess[c++] = Ob_INCREF(pObProcess);
+        cbMultiText += pObProcess->pObPersistent->cchPathKernel + 1;
+        cbMultiText += pObProcess->pObPersistent->UserProcessParams.cchImagePathName + 1;
+        cbMultiText += pObProcess->pObPersistent->UserProcessParams.cchCommandLine + 1;
+    }
+    // 3: allocate and fill result.
+    pAll = LocalAlloc(LMEM_ZEROINIT, sizeof(VMMDLL_PROCESS_INFORMATION_ALL) + c * sizeof(VMMDLL_PROCESS_INFORMATION_ALL_ENTRY) + cbMultiText);
+    if(!pAll) { goto fail; }
+    szMultiText = (LPSTR)((PBYTE)pAll + sizeof(VMMDLL_PROCESS_INFORMATION_ALL) + c * sizeof(VMMDLL_PROCESS_INFORMATION_ALL_ENTRY));
+    pAll->dwVersion = VMMDLL_PROCESS_INFORMATION_ALL_VERSION;
+    pAll->cbMultiText = cbMultiText;
+    pAll->szMultiText = szMultiText;
+    pAll->cProcess = c;
+    for(i = 0; i < c; i++) {
+        pObProcess = ppProcess[i];
+        pe = pAll->pProcess + i;
+        pe->info.magic = VMMDLL_PROCESS_INFORMATION_MAGIC;
+        VMMDLL_ProcessGetInformation_Impl_Fill(pObProcess, &pe->info);
+        pe->ftCreateTime = VmmProcess_GetCreateTimeOpt(pObProcess);
+        pe->ftExitTime = VmmProcess_GetExitTimeOpt(pObProcess);
+        pe->szPathKernel = VMMDLL_ProcessGetInformationAll_Impl_String(szMultiText, cbMultiText, &cbo, pObProcess->pObPersistent->szPathKernel, pObProcess->pObPersistent->cchPathKernel);
+        pe->szPathUserImage = VMMDLL_ProcessGetInformationAll_Impl_String(szMultiText, cbMultiText, &cbo, pObProcess->pObPersistent->UserProcessParams.szImagePathName, pObProcess->pObPersistent->UserProcessParams.cchImagePathName);
+        pe->szCommandLine = VMMDLL_ProcessGetInformationAll_Impl_String(szMultiText, cbMultiText, &cbo, pObProcess->pObPersistent->UserProcessParams.szCommandLine, pObProcess->pObPersistent->UserProcessParams.cchCommandLine);
+    }
+fail:
+    for(i = 0; i < c; i++) {
+        Ob_DECREF(ppProcess[i]);
+    }
+    LocalFree(ppProcess);
+    return pAll;
+}
+
+PVMMDLL_PROCESS_INFORMATION_ALL VMMDLL_ProcessGetInformationAll()
+{
+    CALL_IMPLEMENTATION_VMM_RETURN(
+        STATISTICS_ID_VMMDLL_ProcessGetInformationAll,
+        PVMMDLL_PROCESS_INFORMATION_ALL,
+        NULL,
+        VMMDLL_ProcessGetInformationAll_Impl())
+}
+
 _Success_(return)
 BOOL VMMDLL_ProcessGet_Directories_Sections_IAT_EAT_Impl(
     _In_ DWORD dwPID,
@@ -1260,6 +2094,39 @@ BOOL VMMDLL_ProcessGetIAT(_In_ DWORD dwPID, _In_ LPWSTR wszModule, _Out_opt_ PVM
         VMMDLL_ProcessGet_Directories_Sections_IAT_EAT_Impl(dwPID, wszModule, cData, pcData, NULL, NULL, NULL, pData, FALSE, FALSE, FALSE, TRUE))
 }
 
+typedef struct tdVMMDLL_PROCESSDUMPMODULES_CONTEXT {
+    VMMDLL_PE_DUMP_CALLBACK pfnCallback;
+    PVOID ctx;
+} VMMDLL_PROCESSDUMPMODULES_CONTEXT, *PVMMDLL_PROCESSDUMPMODULES_CONTEXT;
+
+BOOL VMMDLL_ProcessDumpModules_Callback(_In_opt_ PVMMDLL_PROCESSDUMPMODULES_CONTEXT ctx, _In_ PVMM_MAP_MODULEENTRY pModule, _In_ DWORD cbFile, _In_ DWORD cbOffset, _In_reads_(cb) PBYTE pb, _In_ DWORD cb)
+{
+    return ctx->pfnCallback(ctx->ctx, pModule->vaBase, pModule->wszText, cbFile, cbOffset, pb, cb);
+}
+
+_Success_(return)
+BOOL VMMDLL_ProcessDumpModules_Impl(_In_ DWORD dwPID, _In_ VMMDLL_PE_DUMP_CALLBACK pfnCallback, _In_opt_ PVOID ctx)
+{
+    BOOL fResult;
+    PVMM_PROCESS pObProcess = NULL;
+    VMMDLL_PROCESSDUMPMODULES_CONTEXT ctxDump;
+    if(!pfnCallback) { return FALSE; }
+    if(!(pObProcess = VmmProcessGet(dwPID))) { return FALSE; }
+    ctxDump.pfnCallback = pfnCallback;
+    ctxDump.ctx = ctx;
+    fResult = PE_FileRaw_DumpModules(pObProcess, (PE_FILERAW_DUMP_CALLBACK)VMMDLL_ProcessDumpModules_Callback, &ctxDump);
+    Ob_DECREF(pObProcess);
+    return fResult;
+}
+
+_Success_(return)
+BOOL VMMDLL_ProcessDumpModules(_In_ DWORD dwPID, _In_ VMMDLL_PE_DUMP_CALLBACK pfnCallback, _In_opt_ PVOID ctx)
+{
+    CALL_IMPLEMENTATION_VMM(
+        STATISTICS_ID_VMMDLL_ProcessDumpModules,
+        VMMDLL_ProcessDumpModules_Impl(dwPID, pfnCallback, ctx))
+}
+
 ULONG64 VMMDLL_ProcessGetProcAddress_Impl(_In_ DWORD dwPID, _In_ LPWSTR wszModuleName, _In_ LPSTR szFunctionName)
 {
     QWORD vaFn = 0;
@@ -1498,6 +2365,14 @@ BOOL VMMDLL_WinReg_QueryValueExW( _In_ LPWSTR wszFullPathKeyValue, _Out_opt_ LPD
         VmmWinReg_ValueQuery2(wszFullPathKeyValue, lpType, lpData, lpcbData ? *lpcbData : 0, lpcbData))
 }
 
+_Success_(return)
+BOOL VMMDLL_WinReg_Search(_In_opt_ LPWSTR wszKeyPathGlob, _In_opt_ LPWSTR wszValueNameGlob, _In_reads_opt_(cbDataPattern) PBYTE pbDataPattern, _In_ DWORD cbDataPattern, _In_ VMMDLL_WINREG_SEARCH_CALLBACK pfnCallback, _In_opt_ PVOID ctx)
+{
+    CALL_IMPLEMENTATION_VMM(
+        STATISTICS_ID_VMMDLL_WinReg_Search,
+        VmmWinReg_Search(wszKeyPathGlob, wszValueNameGlob, pbDataPattern, cbDataPattern, ctx, (BOOL(*)(PVOID, PVMM_REGISTRY_SEARCH_MATCH))pfnCallback))
+}
+
 
 
 //-----------------------------------------------------------------------------
@@ -1598,6 +2473,7 @@ _Success_(return)
 BOOL VMMDLL_PdbSymbolAddress_Impl(_In_ LPSTR szModule, _In_ LPSTR szSymbolName, _Out_ PULONG64 pvaSymbolAddress)
 {
     VMMWIN_PDB_HANDLE hPdb = PDB_GetHandleFromModuleName(szModule);
+    PDB_LoadWait(hPdb);
     return PDB_GetSymbolAddress(hPdb, szSymbolName, pvaSymbolAddress);
 }
 
@@ -1613,6 +2489,7 @@ _Success_(return)
 BOOL VMMDLL_PdbTypeSize_Impl(_In_ LPSTR szModule, _In_ LPSTR szTypeName, _Out_ PDWORD pcbTypeSize)
 {
     VMMWIN_PDB_HANDLE hPdb = PDB_GetHandleFromModuleName(szModule);
+    PDB_LoadWait(hPdb);
     return PDB_GetTypeSize(hPdb, szTypeName, pcbTypeSize);
 }
 
@@ -1628,6 +2505,7 @@ _Success_(return)
 BOOL VMMDLL_PdbTypeChildOffset_Impl(_In_ LPSTR szModule, _In_ LPSTR szTypeName, _In_ LPWSTR wszTypeChildName, _Out_ PDWORD pcbTypeChildOffset)
 {
     VMMWIN_PDB_HANDLE hPdb = PDB_GetHandleFromModuleName(szModule);
+    PDB_LoadWait(hPdb);
     return PDB_GetTypeChildOffset(hPdb, szTypeName, wszTypeChildName, pcbTypeChildOffset);
 }
 
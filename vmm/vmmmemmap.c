@@ -0,0 +1,127 @@
+// vmmmemmap.c : implementation of the memory mapped direct access to local raw
+//               memory dump files.
+//
+// For raw memory dump files the physical memory "device" is just a file. When
+// memory mapped the physical memory reads are copied directly from the mapped
+// dump file and are not cached in the PHYS cache - the OS page cache already
+// holds the data. Page table reads are still verified and cached in the TLB
+// cache. The mapping is read-only and is only used for static (non-volatile)
+// and non-writable dump files which are verified to be raw memory images.
+//
+// (c) Ulf Frisk, 2019
+// Author: Ulf Frisk, pcileech@frizk.net
+//
+
+#include "vmmmemmap.h"
+
+#define VMMMEMMAP_VERIFY_PAGES      64
+
+/*
+* Copy from the mapped dump file. The mapped file may fail to page in (i.e. on
+* i/o errors) - which will raise an in-page exception that must be handled.
+* -- pa
+* -- pb
+* -- cb
+* -- return
+*/
+_Success_(return)
+BOOL VmmMemMap_Read(_In_ QWORD pa, _Out_writes_(cb) PBYTE pb, _In_ DWORD cb)
+{
+    if((pa >= ctxVmm->MemMap.cbView) || (cb > ctxVmm->MemMap.cbView - pa)) { return FALSE; }
+    __try {
+        memcpy(pb, ctxVmm->MemMap.pbView + pa, cb);
+    } __except(GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH) {
+        return FALSE;
+    }
+    return TRUE;
+}
+
+VOID VmmMemMap_ReadScatter(_Inout_ PPMEM_IO_SCATTER_HEADER ppMEMs, _In_ DWORD cpMEMs)
+{
+    DWORD i, cRead = 0;
+    PMEM_IO_SCATTER_HEADER pMEM;
+    for(i = 0; i < cpMEMs; i++) {
+        pMEM = ppMEMs[i];
+        if(pMEM->cb == pMEM->cbMax) { continue; }
+        if(VmmMemMap_Read(pMEM->qwA, pMEM->pb, pMEM->cbMax)) {
+            pMEM->cb = pMEM->cbMax;
+            cRead++;
+        }
+    }
+    InterlockedAdd64(&ctxVmm->stat.cPhysReadMemMap, cRead);
+}
+
+/*
+* Verify that the mapped dump file is a raw memory image by comparing sampled
+* pages of the mapping with reads from the device. All successfully read pages
+* must be identical and at least one of them must be non-zero - zero pages are
+* common to both raw and non-raw dump files and don't prove anything.
+* -- return
+*/
+_Success_(return)
+BOOL VmmMemMap_Verify()
+{
+    DWORD i, o;
+    BOOL fNonZero = FALSE;
+    QWORD pa, cPages = ctxVmm->MemMap.cbView >> 12;
+    BYTE pbDevice[0x1000], pbMap[0x1000];
+    for(i = 0; i < VMMMEMMAP_VERIFY_PAGES; i++) {
+        pa = ((cPages - 1) * i / (VMMMEMMAP_VERIFY_PAGES - 1)) << 12;
+        if(0x1000 != LeechCore_Read(pa, pbDevice, 0x1000)) { continue; }
+        if(!VmmMemMap_Read(pa, pbMap, 0x1000) || memcmp(pbDevice, pbMap, 0x1000)) { return FALSE; }
+        for(o = 0; !fNonZero && (o < 0x1000); o += 8) {
+            fNonZero = *(PQWORD)(pbDevice + o) ? TRUE : FALSE;
+        }
+    }
+    return fNonZero;
+}
+
+BOOL VmmMemMap_Initialize()
+{
+    LPSTR szFile;
+    LARGE_INTEGER cbFile;
+    if(!ctxMain->cfg.fMemMap) { return FALSE; }
+    if(ctxMain->dev.fVolatile || ctxMain->dev.fWritable || ctxMain->dev.fRemote || (ctxMain->dev.tpDevice != LEECHCORE_DEVICE_FILE)) {
+        vmmprintfv_fn("Memory mapping only supported on local static memory dump files - ignoring.\n");
+        return FALSE;
+    }
+    szFile = ctxMain->dev.szDevice;
+    if(0 == _strnicmp(szFile, "file://", 7)) { szFile += 7; }
+    ctxVmm->MemMap.hFile = CreateFileA(szFile, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, NULL);
+    if(ctxVmm->MemMap.hFile == INVALID_HANDLE_VALUE) {
+        ctxVmm->MemMap.hFile = NULL;
+        goto fail;
+    }
+    if(!GetFileSizeEx(ctxVmm->MemMap.hFile, &cbFile) || (cbFile.QuadPart < 0x1000)) { goto fail; }
+    if(!(ctxVmm->MemMap.hMapping = CreateFileMappingA(ctxVmm->MemMap.hFile, NULL, PAGE_READONLY, 0, 0, NULL))) { goto fail; }
+    if(!(ctxVmm->MemMap.pbView = MapViewOfFile(ctxVmm->MemMap.hMapping, FILE_MAP_READ, 0, 0, 0))) { goto fail; }
+    ctxVmm->MemMap.cbView = min((QWORD)cbFile.QuadPart, ctxMain->dev.paMax) & ~0xfff;
+    if(!VmmMemMap_Verify()) {
+        vmmprintfv_fn("Memory dump file is not a raw memory image - ignoring memory mapping.\n");
+        goto fail;
+    }
+    ctxVmm->MemMap.fEnabled = TRUE;
+    vmmprintfv_fn("Physical memory reads are served from memory mapped file '%s'.\n", szFile);
+    return TRUE;
+fail:
+    VmmMemMap_Close();
+    return FALSE;
+}
+
+VOID VmmMemMap_Close()
+{
+    ctxVmm->MemMap.fEnabled = FALSE;
+    if(ctxVmm->MemMap.pbView) {
+        UnmapViewOfFile(ctxVmm->MemMap.pbView);
+        ctxVmm->MemMap.pbView = NULL;
+    }
+    if(ctxVmm->MemMap.hMapping) {
+        CloseHandle(ctxVmm->MemMap.hMapping);
+        ctxVmm->MemMap.hMapping = NULL;
+    }
+    if(ctxVmm->MemMap.hFile) {
+        CloseHandle(ctxVmm->MemMap.hFile);
+        ctxVmm->MemMap.hFile = NULL;
+    }
+    ctxVmm->MemMap.cbView = 0;
+}
@@ -0,0 +1,42 @@
+// vmmmemmap.h : declarations of the memory mapped direct access to local raw
+//               memory dump files. Physical memory reads are copied directly
+//               from a read-only mapping of the dump file and bypass both the
+//               device (LeechCore) and the PHYS cache.
+//
+// (c) Ulf Frisk, 2019
+// Author: Ulf Frisk, pcileech@frizk.net
+//
+
+#ifndef __VMMMEMMAP_H__
+#define __VMMMEMMAP_H__
+#include "vmm.h"
+
+/*
+* Initialize the memory mapped direct access (if enabled by the -memmap option).
+* The memory source must be a local, static, read-only dump file which is a raw
+* image of physical memory. This is verified by comparing sampled pages of the
+* mapping with reads from the device. If the verification fails the device is
+* used as usual.
+* This function should be called after VmmInitialize() and before the operating
+* system specific initialization takes place.
+* -- return = TRUE if physical memory reads are served from the mapping.
+*/
+BOOL VmmMemMap_Initialize();
+
+/*
+* Read scatter physical memory from the memory mapped dump file. Headers which
+* are already read (cb == cbMax) are left untouched. Headers outside the mapped
+* range, or which fail due to an i/o error of the mapped file, are left unread.
+* NB! the memory mapped direct access must be enabled.
+* -- ppMEMs
+* -- cpMEMs
+*/
+VOID VmmMemMap_ReadScatter(_Inout_ PPMEM_IO_SCATTER_HEADER ppMEMs, _In_ DWORD cpMEMs);
+
+/*
+* Unmap and close the memory mapped dump file (if mapped). Must be called when
+* no more physical memory reads may take place.
+*/
+VOID VmmMemMap_Close();
+
+#endif /* __VMMMEMMAP_H__ */
@@ -6,11 +6,14 @@
 
 #include "vmmdll.h"
 #include "vmmproc.h"
+#include "vmmcachefile.h"
+#include "vmmmemmap.h"
 #include "vmmwin.h"
 #include "vmmwininit.h"
 #include "vmmwinreg.h"
 #include "pluginmanager.h"
 #include "statistics.h"
+#include "vmmtrace.h"
 #include "util.h"
 
 // ----------------------------------------------------------------------------
@@ -63,12 +66,20 @@ BOOL VmmProc_RefreshProcesses(_In_ BOOL fRefreshTotal)
         }
         result = VmmWin_EnumerateEPROCESS(pObProcessSystem, fRefreshTotal);
         Ob_DECREF(pObProcessSystem);
+        // warm up the page table cache for all new processes in one pass.
+        if(fRefreshTotal) {
+            VmmTlbSpiderAll();
+            ObContainer_SetOb(ctxVmm->pObCPhys2VirtIndex, NULL);
+        }
     }
     return TRUE;
 }
 
 // Initial hard coded values that seems to be working nicely below. These values
 // may be changed in config options or by editing files in the .status directory.
+// The values are the base refresh intervals - if the adaptive scheduler is
+// enabled the intervals are stretched (quiet target) or shortened (busy target)
+// within [base / VMMPROC_REFRESH_ADAPT_DIV_MIN, base * VMMPROC_REFRESH_ADAPT_MUL_MAX].
 
 #define VMMPROC_UPDATERTHREAD_LOCAL_PERIOD              100
 #define VMMPROC_UPDATERTHREAD_LOCAL_PHYSCACHE           (500 / VMMPROC_UPDATERTHREAD_LOCAL_PERIOD)                // 0.5s
@@ -84,11 +95,197 @@ BOOL VmmProc_RefreshProcesses(_In_ BOOL fRefreshTotal)
 #define VMMPROC_UPDATERTHREAD_REMOTE_PROC_REFRESHTOTAL  (3 * 60 * 1000 / VMMPROC_UPDATERTHREAD_REMOTE_PERIOD)    // 3m
 #define VMMPROC_UPDATERTHREAD_REMOTE_REGISTRY           (10 * 60 * 1000 / VMMPROC_UPDATERTHREAD_LOCAL_PERIOD)    // 10m
 
-DWORD VmmProcCacheUpdaterThread()
+#define VMMPROC_UPDATERTHREAD_IDLE_MS                   (30 * 1000)                                              // 30s
+
+#define VMMPROC_REFRESH_ADAPT_MUL_MAX                   8       // max stretch of base interval on a quiet target
+#define VMMPROC_REFRESH_ADAPT_DIV_MIN                   2       // max shortening of base interval on a busy target
+#define VMMPROC_REFRESH_ADAPT_PCT_LOW                   5       // change rate (%) at or below which the interval is doubled
+#define VMMPROC_REFRESH_ADAPT_PCT_HIGH                  25      // change rate (%) at or above which the interval is halved
+#define VMMPROC_REFRESH_SAMPLES                         16      // max number of cached pages sampled per measurement
+
+// ----------------------------------------------------------------------------
+// ADAPTIVE REFRESH SCHEDULER BELOW:
+// Each refresh type (PHYS, TLB, PROC_PARTIAL, PROC_TOTAL, REGISTRY) has its
+// own schedule. When a refresh is due the change rate is measured and the
+// interval of the schedule is stretched or shortened accordingly:
+// - PHYS/TLB: a sample of the currently cached pages is re-read directly from
+//   the device and compared against the cached contents.
+// - PROC: the process list (PID, EPROCESS address) before and after the
+//   refresh is compared.
+// Refreshes are suspended while there is no api activity (idle).
+// ----------------------------------------------------------------------------
+
+typedef struct tdVMMPROC_REFRESH_SAMPLE_CONTEXT {
+    DWORD i;
+    DWORD cStride;
+    DWORD iSeed;
+    DWORD c;
+    PVMMOB_MEM pObMEMs[VMMPROC_REFRESH_SAMPLES];
+} VMMPROC_REFRESH_SAMPLE_CONTEXT, *PVMMPROC_REFRESH_SAMPLE_CONTEXT;
+
+DWORD VmmProcRefresh_BaseTick(_In_ DWORD tpRefresh)
 {
-    QWORD i = 0, paMax;
-    BOOL fPHYS, fTLB, fProcPartial, fProcTotal, fRegistry;
-    vmmprintfv("VmmProc: Start periodic cache flushing.\n");
+    DWORD cTick = 0;
+    switch(tpRefresh) {
+        case VMM_REFRESH_PHYS:          cTick = ctxVmm->ThreadProcCache.cTick_Phys; break;
+        case VMM_REFRESH_TLB:           cTick = ctxVmm->ThreadProcCache.cTick_TLB; break;
+        case VMM_REFRESH_PROC_PARTIAL:  cTick = ctxVmm->ThreadProcCache.cTick_ProcPartial; break;
+        case VMM_REFRESH_PROC_TOTAL:    cTick = ctxVmm->ThreadProcCache.cTick_ProcTotal; break;
+        case VMM_REFRESH_REGISTRY:      cTick = ctxVmm->ThreadProcCache.cTick_Registry; break;
+    }
+    return max(1, cTick);
+}
+
+/*
+* Retrieve the currently effective refresh interval (in ticks) of a refresh
+* type. If adaptive refresh is disabled this is the configured base interval.
+* -- tpRefresh = VMM_REFRESH_*
+* -- return
+*/
+DWORD VmmProcRefresh_GetTick(_In_ DWORD tpRefresh)
+{
+    DWORD cTickBase = VmmProcRefresh_BaseTick(tpRefresh);
+    DWORD cTick = ctxVmm->ThreadProcCache.Schedule[tpRefresh].cTick;
+    if(!ctxVmm->ThreadProcCache.fAdaptive || !cTick) { return cTickBase; }
+    // base interval may have been changed by the user -> clamp to new limits.
+    cTick = min(cTick, cTickBase * VMMPROC_REFRESH_ADAPT_MUL_MAX);
+    return max(cTick, max(1, cTickBase / VMMPROC_REFRESH_ADAPT_DIV_MIN));
+}
+
+VOID VmmProcRefresh_SetDone(_In_ DWORD tpRefresh, _In_ QWORD iTick, _In_ QWORD tcNow)
+{
+    ctxVmm->ThreadProcCache.Schedule[tpRefresh].iTickLast = iTick;
+    ctxVmm->ThreadProcCache.Schedule[tpRefresh].tcLast = tcNow;
+}
+
+BOOL VmmProcRefresh_IsDue(_In_ DWORD tpRefresh, _In_ QWORD iTick)
+{
+    return iTick >= ctxVmm->ThreadProcCache.Schedule[tpRefresh].iTickLast + VmmProcRefresh_GetTick(tpRefresh);
+}
+
+/*
+* Update the interval of a schedule given a measured change rate.
+* -- tpRefresh = VMM_REFRESH_*
+* -- dwChangePct = change rate in percent, or VMM_REFRESH_CHANGE_UNKNOWN.
+*/
+VOID VmmProcRefresh_Adapt(_In_ DWORD tpRefresh, _In_ DWORD dwChangePct)
+{
+    PVMM_REFRESH_SCHEDULE ps = &ctxVmm->ThreadProcCache.Schedule[tpRefresh];
+    DWORD cTickBase = VmmProcRefresh_BaseTick(tpRefresh);
+    DWORD cTick = VmmProcRefresh_GetTick(tpRefresh);
+    ps->dwChangePct = dwChangePct;
+    if(!ctxVmm->ThreadProcCache.fAdaptive || (dwChangePct == VMM_REFRESH_CHANGE_UNKNOWN)) { return; }
+    if(dwChangePct <= VMMPROC_REFRESH_ADAPT_PCT_LOW) {
+        cTick = cTick * 2;
+    } else if(dwChangePct >= VMMPROC_REFRESH_ADAPT_PCT_HIGH) {
+        cTick = cTick / 2;
+    } else {
+        cTick = (cTick + cTickBase) / 2;
+    }
+    cTick = min(cTick, cTickBase * VMMPROC_REFRESH_ADAPT_MUL_MAX);
+    ps->cTick = max(cTick, max(1, cTickBase / VMMPROC_REFRESH_ADAPT_DIV_MIN));
+}
+
+VOID VmmProcRefresh_SampleCache_CB(_In_opt_ PVMMPROC_REFRESH_SAMPLE_CONTEXT ctx, _In_ PVMMOB_MEM pOb)
+{
+    if((ctx->c < VMMPROC_REFRESH_SAMPLES) && !((ctx->i++ + ctx->iSeed) % ctx->cStride)) {
+        ctx->pObMEMs[ctx->c++] = Ob_INCREF(pOb);
+    }
+}
+
+/*
+* Measure the change rate of a cache by re-reading a sample of the cached pages
+* directly from the device and comparing them with the cached contents.
+* NB! cache region locks are not held during the device read.
+* -- dwTblTag
+* -- return = change rate in percent, or VMM_REFRESH_CHANGE_UNKNOWN.
+*/
+DWORD VmmProcRefresh_SampleCache(_In_ DWORD dwTblTag)
+{
+    DWORD i, cChanged = 0, cCompared = 0;
+    PPMEM_IO_SCATTER_HEADER ppMEMs = NULL;
+    VMM_CACHE_STATISTICS CacheStat;
+    VMMPROC_REFRESH_SAMPLE_CONTEXT ctx = { 0 };
+    if(!VmmCacheGetStatistics(dwTblTag, &CacheStat) || !CacheStat.cTotal) { return VMM_REFRESH_CHANGE_UNKNOWN; }
+    ctx.cStride = max(1, CacheStat.cTotal / VMMPROC_REFRESH_SAMPLES);
+    ctx.iSeed = (DWORD)ctxVmm->ThreadProcCache.iTick;
+    VmmCacheEnumerate(dwTblTag, &ctx, (VOID(*)(PVOID, PVMMOB_MEM))VmmProcRefresh_SampleCache_CB);
+    if(ctx.c && LeechCore_AllocScatterEmpty(ctx.c, &ppMEMs)) {
+        for(i = 0; i < ctx.c; i++) {
+            ppMEMs[i]->qwA = ctx.pObMEMs[i]->h.qwA;
+        }
+        VmmReadScatterPhysical_DeviceScatter(ppMEMs, ctx.c);
+        for(i = 0; i < ctx.c; i++) {
+            if(ppMEMs[i]->cb != 0x1000) { continue; }
+            cCompared++;
+            if(memcmp(ppMEMs[i]->pb, ctx.pObMEMs[i]->pb, 0x1000)) { cChanged++; }
+        }
+        LeechCore_MemFree(ppMEMs);
+    }
+    for(i = 0; i < ctx.c; i++) {
+        Ob_DECREF(ctx.pObMEMs[i]);
+    }
+    return cCompared ? (cChanged * 100 / cCompared) : VMM_REFRESH_CHANGE_UNKNOWN;
+}
+
+/*
+* Calculate an order independent hash of the process list.
+* -- return
+*/
+QWORD VmmProcRefresh_HashProcesses()
+{
+    QWORD qwHash = 0;
+    PVMM_PROCESS pObProcess = NULL;
+    while((pObProcess = VmmProcessGetNext(pObProcess, 0))) {
+        qwHash += (((QWORD)pObProcess->dwPID * 0x9e3779b97f4a7c15) ^ pObProcess->win.EPROCESS.va);
+    }
+    return qwHash;
+}
+
+/*
+* Invalidate the memory caches on resume from idle. The periodic refreshes of
+* the caches were suspended while idle and the cached memory may be stale.
+* -- tcNow
+*/
+VOID VmmProcRefresh_Resume(_In_ QWORD tcNow)
+{
+    QWORD iTick = ctxVmm->ThreadProcCache.iTick;
+    VmmCacheClear(VMM_CACHE_TAG_PHYS);
+    InterlockedIncrement64(&ctxVmm->stat.cPhysRefreshCache);
+    VmmCacheClear(VMM_CACHE_TAG_PAGING);
+    InterlockedIncrement64(&ctxVmm->stat.cPageRefreshCache);
+    VmmProcRefresh_SetDone(VMM_REFRESH_PHYS, iTick, tcNow);
+    VmmCacheClear(VMM_CACHE_TAG_TLB);
+    InterlockedIncrement64(&ctxVmm->stat.cTlbRefreshCache);
+    VmmProcRefresh_SetDone(VMM_REFRESH_TLB, iTick, tcNow);
+}
+
+/*
+* Register api activity with the refresh scheduler - called on api entry. On
+* the idle -> active transition the memory caches are invalidated before the
+* api call is served; only the thread winning the transition clears them.
+*/
+VOID VmmProcRefresh_Activity()
+{
+    QWORD tc = GetTickCount64(), tcPrev = ctxVmm->ThreadProcCache.tcActivity;
+    // only write on change to avoid cache line contention between api threads.
+    if(tcPrev == tc) { return; }
+    if(ctxVmm->ThreadProcCache.fEnabled && ctxVmm->ThreadProcCache.cMs_Idle && (tc > tcPrev + ctxVmm->ThreadProcCache.cMs_Idle)) {
+        if(tcPrev == (QWORD)InterlockedCompareExchange64((volatile LONG64*)&ctxVmm->ThreadProcCache.tcActivity, tc, tcPrev)) {
+            VmmProcRefresh_Resume(tc);
+        }
+        return;
+    }
+    ctxVmm->ThreadProcCache.tcActivity = tc;
+}
+
+/*
+* Initialize the refresh schedules with default values.
+*/
+VOID VmmProcRefresh_Initialize()
+{
+    DWORD i;
+    QWORD tcNow = GetTickCount64();
     if(ctxMain->dev.fRemote) {
         ctxVmm->ThreadProcCache.cMs_TickPeriod = VMMPROC_UPDATERTHREAD_REMOTE_PERIOD;
         ctxVmm->ThreadProcCache.cTick_Phys = VMMPROC_UPDATERTHREAD_REMOTE_PHYSCACHE;
@@ -104,50 +301,164 @@ DWORD VmmProcCacheUpdaterThread()
         ctxVmm->ThreadProcCache.cTick_ProcTotal = VMMPROC_UPDATERTHREAD_LOCAL_PROC_REFRESHTOTAL;
         ctxVmm->ThreadProcCache.cTick_Registry = VMMPROC_UPDATERTHREAD_LOCAL_REGISTRY;
     }
+    ctxVmm->ThreadProcCache.fAdaptive = TRUE;
+    ctxVmm->ThreadProcCache.cMs_Idle = VMMPROC_UPDATERTHREAD_IDLE_MS;
+    ctxVmm->ThreadProcCache.tcActivity = tcNow;
+    for(i = 0; i < VMM_REFRESH_MAX; i++) {
+        ctxVmm->ThreadProcCache.Schedule[i].cTick = VmmProcRefresh_BaseTick(i);
+        ctxVmm->ThreadProcCache.Schedule[i].dwChangePct = VMM_REFRESH_CHANGE_UNKNOWN;
+        ctxVmm->ThreadProcCache.Schedule[i].tcLast = tcNow;
+    }
+}
+
+/*
+* Refresh the caches and the process list on-demand. Only refresh types whose
+* last refresh is older than dwMaxAgeMs are refreshed.
+* -- dwMaxAgeMs = max age in ms of the caches/process list, 0 = force refresh.
+* -- return
+*/
+BOOL VmmProcRefresh_OnDemand(_In_ DWORD dwMaxAgeMs)
+{
+    QWORD paMax, tmTrace, iTick, tcNow;
+    BOOL fPHYS, fTLB, fProc;
+    PVMM_REFRESH_SCHEDULE ps = ctxVmm->ThreadProcCache.Schedule;
+    iTick = ctxVmm->ThreadProcCache.iTick;
+    tcNow = GetTickCount64();
+    fPHYS = !dwMaxAgeMs || (tcNow - ps[VMM_REFRESH_PHYS].tcLast > dwMaxAgeMs);
+    fTLB = !dwMaxAgeMs || (tcNow - ps[VMM_REFRESH_TLB].tcLast > dwMaxAgeMs);
+    fProc = !dwMaxAgeMs || (tcNow - ps[VMM_REFRESH_PROC_TOTAL].tcLast > dwMaxAgeMs);
+    if(fPHYS) {
+        VmmCacheClear(VMM_CACHE_TAG_PHYS);
+        VmmProcRefresh_SetDone(VMM_REFRESH_PHYS, iTick, tcNow);
+    }
+    if(fTLB) {
+        VmmCacheClear(VMM_CACHE_TAG_TLB);
+        VmmProcRefresh_SetDone(VMM_REFRESH_TLB, iTick, tcNow);
+    }
+    if(fProc) {
+        // avoid parallel process refreshes - readers are not blocked since the
+        // new process table is published by pointer swap once complete.
+        EnterCriticalSection(&ctxVmm->LockUpdateProc);
+        tmTrace = VMMTRACE_IS_ENABLED() ? VmmTrace_Start() : 0;
+        VmmProc_RefreshProcesses(TRUE);
+        VmmProcRefresh_SetDone(VMM_REFRESH_PROC_PARTIAL, iTick, tcNow);
+        VmmProcRefresh_SetDone(VMM_REFRESH_PROC_TOTAL, iTick, tcNow);
+        // update max physical address (if volatile).
+        if(ctxMain->dev.fVolatileMaxAddress) {
+            if(LeechCore_GetOption(LEECHCORE_OPT_MEMORYINFO_ADDR_MAX, &paMax) && (paMax > 0x01000000)) {
+                ctxMain->dev.paMax = paMax;
+            }
+        }
+        if(tmTrace) { VmmTrace_Event(VMMTRACE_EVENT_MASTERLOCK, 0, VMMTRACE_MASTERLOCK_REFRESH_FORCE, 0, tmTrace); }
+        LeaveCriticalSection(&ctxVmm->LockUpdateProc);
+    }
+    return TRUE;
+}
+
+DWORD VmmProcCacheUpdaterThread()
+{
+    QWORD i, paMax, tmTrace, tmTraceLock, tcNow, qwHashProc;
+    BOOL fPHYS, fTLB, fProcPartial, fProcTotal, fRegistry, fIdle;
+    DWORD dwChangePct;
+    vmmprintfv("VmmProc: Start periodic cache flushing.\n");
     while(ctxVmm->ThreadProcCache.fEnabled) {
         Sleep(ctxVmm->ThreadProcCache.cMs_TickPeriod);
-        i++;
-        fTLB = !(i % ctxVmm->ThreadProcCache.cTick_TLB);
-        fPHYS = !(i % ctxVmm->ThreadProcCache.cTick_Phys);
-        fProcTotal = !(i % ctxVmm->ThreadProcCache.cTick_ProcTotal);
-        fProcPartial = !(i % ctxVmm->ThreadProcCache.cTick_ProcPartial) && !fProcTotal;
-        fRegistry = !(i % ctxVmm->ThreadProcCache.cTick_Registry);
-        EnterCriticalSection(&ctxVmm->MasterLock);
-        // PHYS / TLB cache clear
+        i = ++ctxVmm->ThreadProcCache.iTick;
+        tmTrace = VMMTRACE_IS_ENABLED() ? VmmTrace_Start() : 0;
+        // incremental reclaim of stale cache entries (no MasterLock required)
+        VmmCacheReclaimStale(VMM_CACHE_TAG_PHYS);
+        VmmCacheReclaimStale(VMM_CACHE_TAG_TLB);
+        VmmCacheReclaimStale(VMM_CACHE_TAG_PAGING);
+        // suspend refreshes while idle - overdue refreshes are performed on
+        // the first tick after api activity is resumed.
+        tcNow = GetTickCount64();
+        fIdle = ctxVmm->ThreadProcCache.cMs_Idle && (tcNow > ctxVmm->ThreadProcCache.tcActivity + ctxVmm->ThreadProcCache.cMs_Idle);
+        if(fIdle != ctxVmm->ThreadProcCache.fIdle) {
+            ctxVmm->ThreadProcCache.fIdle = fIdle;
+            vmmprintfvv("VmmProc: Periodic refresh %s.\n", (fIdle ? "suspended (idle)" : "resumed"));
+        }
+        if(fIdle) { continue; }
+        fTLB = VmmProcRefresh_IsDue(VMM_REFRESH_TLB, i);
+        fPHYS = VmmProcRefresh_IsDue(VMM_REFRESH_PHYS, i);
+        fProcTotal = VmmProcRefresh_IsDue(VMM_REFRESH_PROC_TOTAL, i);
+        fProcPartial = VmmProcRefresh_IsDue(VMM_REFRESH_PROC_PARTIAL, i) && !fProcTotal;
+        fRegistry = VmmProcRefresh_IsDue(VMM_REFRESH_REGISTRY, i);
+        if(!fTLB && !fPHYS && !fProcTotal && !fProcPartial && !fRegistry) { continue; }
+        // measure cache change rates before the caches are cleared.
+        // (device reads - no lock required)
+        if(ctxVmm->ThreadProcCache.fAdaptive) {
+            if(fPHYS) { VmmProcRefresh_Adapt(VMM_REFRESH_PHYS, VmmProcRefresh_SampleCache(VMM_CACHE_TAG_PHYS)); }
+            if(fTLB) { VmmProcRefresh_Adapt(VMM_REFRESH_TLB, VmmProcRefresh_SampleCache(VMM_CACHE_TAG_TLB)); }
+        }
+        // PHYS / TLB cache clear - bumps the cache generation (no lock required)
         if(fPHYS) {
             VmmCacheClear(VMM_CACHE_TAG_PHYS);
             InterlockedIncrement64(&ctxVmm->stat.cPhysRefreshCache);
             VmmCacheClear(VMM_CACHE_TAG_PAGING);
             InterlockedIncrement64(&ctxVmm->stat.cPageRefreshCache);
-            ObVSet_Clear(ctxVmm->Cache.PAGING_FAILED);
+            VmmProcRefresh_SetDone(VMM_REFRESH_PHYS, i, tcNow);
         }
         if(fTLB) {
             VmmCacheClear(VMM_CACHE_TAG_TLB);
             InterlockedIncrement64(&ctxVmm->stat.cTlbRefreshCache);
+            VmmProcRefresh_SetDone(VMM_REFRESH_TLB, i, tcNow);
         }
-        // refresh proc list
+        // refresh proc list - the new process table is built off to the side
+        // and published by pointer swap - readers are never blocked.
         if(fProcPartial || fProcTotal) {
+            EnterCriticalSection(&ctxVmm->LockUpdateProc);
+            tmTraceLock = VMMTRACE_IS_ENABLED() ? VmmTrace_Start() : 0;
+            qwHashProc = VmmProcRefresh_HashProcesses();
             if(!VmmProc_RefreshProcesses(fProcTotal)) {
                 vmmprintf("VmmProc: Failed to refresh memory process file system - aborting.\n");
-                LeaveCriticalSection(&ctxVmm->MasterLock);
+                LeaveCriticalSection(&ctxVmm->LockUpdateProc);
                 goto fail;
             }
+            dwChangePct = (qwHashProc == VmmProcRefresh_HashProcesses()) ? 0 : 100;
+            VmmProcRefresh_Adapt(VMM_REFRESH_PROC_PARTIAL, dwChangePct);
+            VmmProcRefresh_SetDone(VMM_REFRESH_PROC_PARTIAL, i, tcNow);
+            if(fProcTotal) {
+                VmmProcRefresh_Adapt(VMM_REFRESH_PROC_TOTAL, dwChangePct);
+                VmmProcRefresh_SetDone(VMM_REFRESH_PROC_TOTAL, i, tcNow);
+            }
             // update max physical address (if volatile).
             if(ctxMain->dev.fVolatileMaxAddress) {
                 if(LeechCore_GetOption(LEECHCORE_OPT_MEMORYINFO_ADDR_MAX, &paMax) && (paMax > 0x01000000)) {
                     ctxMain->dev.paMax = paMax;
                 }
             }
-            // send notify
+            if(tmTraceLock) { VmmTrace_Event(VMMTRACE_EVENT_MASTERLOCK, 0, VMMTRACE_MASTERLOCK_REFRESH_TICK, 0, tmTraceLock); }
+            LeaveCriticalSection(&ctxVmm->LockUpdateProc);
+            // send notify - MasterLock serializes against plugin (re)initialization.
+            // queued process create/terminate and map change events are sent
+            // after the total refresh event.
+            EnterCriticalSection(&ctxVmm->MasterLock);
             if(fProcTotal) {
                 PluginManager_Notify(VMMDLL_PLUGIN_EVENT_TOTALREFRESH, NULL, 0);
             }
+            VmmNotify_Dispatch();
+            LeaveCriticalSection(&ctxVmm->MasterLock);
+            // the previous process table and its maps are released by now -
+            // return cached object pool blocks of the refresh to the heap.
+            if(fProcTotal) {
+                Ob_PoolTrim();
+            }
         }
-        // refresh registry
+        // refresh registry - the hive map is rebuilt on next access and
+        // published by pointer swap (registry LockUpdate held only briefly).
         if(fRegistry) {
             VmmWinReg_Refresh();
+            VmmProcRefresh_SetDone(VMM_REFRESH_REGISTRY, i, tcNow);
+        }
+        if(tmTrace) {
+            VmmTrace_Event(VMMTRACE_EVENT_REFRESH_TICK, 0,
+                (fPHYS ? VMMTRACE_REFRESH_PHYS : 0) |
+                (fTLB ? VMMTRACE_REFRESH_TLB : 0) |
+                (fProcPartial ? VMMTRACE_REFRESH_PROC_PARTIAL : 0) |
+                (fProcTotal ? VMMTRACE_REFRESH_PROC_TOTAL : 0) |
+                (fRegistry ? VMMTRACE_REFRESH_REGISTRY : 0),
+                i, tmTrace);
         }
-        LeaveCriticalSection(&ctxVmm->MasterLock);
     }
 fail:
     vmmprintfv("VmmProc: Exit periodic cache flushing.\n");
@@ -160,6 +471,10 @@ BOOL VmmProcInitialize()
 {
     BOOL result = FALSE;
     if(!VmmInitialize()) { return FALSE; }
+    // 0: memory map raw dump file (if enabled) and load page tables and
+    //    initialization hints from cache file (if any)
+    VmmMemMap_Initialize();
+    VmmCacheFile_Initialize();
     // 1: try initialize 'windows' with an optionally supplied CR3
     result = VmmWinInit_TryInitialize(ctxMain->cfg.paCR3);
     if(!result) {
@@ -174,6 +489,9 @@ BOOL VmmProcInitialize()
     // the backend is a volatile device (FPGA). If the underlying device isn't
     // volatile then there is no need to update! NB! Files are not considered
     // to be volatile.
+    if(result) {
+        VmmProcRefresh_Initialize();
+    }
     if(result && ctxMain->dev.fVolatile && !ctxMain->cfg.fDisableBackgroundRefresh) {
         ctxVmm->ThreadProcCache.fEnabled = TRUE;
         ctxVmm->ThreadProcCache.hThread = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)VmmProcCacheUpdaterThread, ctxVmm, 0, NULL);
@@ -14,6 +14,35 @@
 */
 BOOL VmmProc_RefreshProcesses(_In_ BOOL fRefreshTotal);
 
+/*
+* Initialize the refresh schedules of the background refresh thread with the
+* default base intervals (depending on whether the device is local or remote).
+*/
+VOID VmmProcRefresh_Initialize();
+
+/*
+* Register api activity with the refresh scheduler. Background refreshes are
+* suspended if there is no api activity within the configured idle period.
+* The first api call after an idle period invalidates the memory caches.
+*/
+VOID VmmProcRefresh_Activity();
+
+/*
+* Retrieve the currently effective refresh interval (in ticks) of a refresh
+* type. If adaptive refresh is disabled this is the configured base interval.
+* -- tpRefresh = VMM_REFRESH_*
+* -- return
+*/
+DWORD VmmProcRefresh_GetTick(_In_ DWORD tpRefresh);
+
+/*
+* Refresh the caches and the process list on-demand. Only refresh types whose
+* last refresh is older than dwMaxAgeMs are refreshed.
+* -- dwMaxAgeMs = max age in ms of the caches/process list, 0 = force refresh.
+* -- return
+*/
+BOOL VmmProcRefresh_OnDemand(_In_ DWORD dwMaxAgeMs);
+
 /*
 * Tries to automatically identify the operating system given by the supplied
 * memory device (fpga hardware or file). If an operating system is successfully
@@ -0,0 +1,160 @@
+// vmmprofile.c : implementation of persisted kernel structure offset profiles.
+//
+// Offsets located by the heuristic EPROCESS offset locators and the registry
+// CMHIVE offset fuzzer are saved in a per-kernel profile in the 'Profiles'
+// directory next to vmm.dll. Profiles are keyed by the ntoskrnl PDB GUID/age
+// and also record the kernel build number. On later starts against the same
+// kernel build the profile is loaded and the offset fuzzing is skipped. Any
+// profile offsets failing validation fall back to the heuristic locators.
+// Profiles for common builds may be bundled by placing them in the directory.
+//
+// (c) Ulf Frisk, 2019
+// Author: Ulf Frisk, pcileech@frizk.net
+//
+
+#include "vmmprofile.h"
+#include "pe.h"
+#include "util.h"
+
+#define VMMPROFILE_MAGIC            0x46504d56      // 'VMPF'
+#define VMMPROFILE_VERSION          2
+
+typedef struct tdVMMPROFILE_FILE {
+    DWORD dwMagic;
+    DWORD dwVersion;
+    BYTE pbPdbGUID[16];
+    DWORD dwPdbAge;
+    DWORD dwVersionBuild;
+    DWORD tpMemoryModel;
+    BOOL fRegistry;
+    DWORD cbOffsetEPROCESS;
+    DWORD cbRegistry;
+    VMM_WIN_EPROCESS_OFFSET OffsetEPROCESS;
+    VMMWIN_REGISTRY_OFFSET Registry;
+} VMMPROFILE_FILE, *PVMMPROFILE_FILE;
+
+/*
+* Load the profile file. Profiles not matching the kernel PDB or memory model
+* are ignored. The sizes of the stored offset structures are validated against
+* the current structure sizes before the offsets are used.
+* -- return
+*/
+_Success_(return)
+BOOL VmmProfile_Load()
+{
+    FILE *hFile = NULL;
+    VMMPROFILE_FILE prf;
+    if(fopen_s(&hFile, ctxVmm->Profile.szFile, "rb") || !hFile) { return FALSE; }
+    if((1 != fread(&prf, sizeof(VMMPROFILE_FILE), 1, hFile)) || (prf.dwMagic != VMMPROFILE_MAGIC) || (prf.dwVersion != VMMPROFILE_VERSION) || (fgetc(hFile) != EOF)) {
+        vmmprintfv_fn("Profile '%s' is invalid - ignoring.\n", ctxVmm->Profile.szFile);
+        goto fail;
+    }
+    if((prf.cbOffsetEPROCESS != sizeof(VMM_WIN_EPROCESS_OFFSET)) || (prf.cbRegistry != sizeof(VMMWIN_REGISTRY_OFFSET))) {
+        vmmprintfv_fn("Profile '%s' offset structure size mismatch - ignoring.\n", ctxVmm->Profile.szFile);
+        goto fail;
+    }
+    if(memcmp(prf.pbPdbGUID, ctxVmm->Profile.pbPdbGUID, 16) || (prf.dwPdbAge != ctxVmm->Profile.dwPdbAge) || (prf.tpMemoryModel != ctxVmm->tpMemoryModel)) {
+        vmmprintfv_fn("Profile '%s' does not match kernel - ignoring.\n", ctxVmm->Profile.szFile);
+        goto fail;
+    }
+    if(prf.OffsetEPROCESS.fValid && !ctxVmm->kernel.OffsetEPROCESS.fValid) {
+        memcpy(&ctxVmm->kernel.OffsetEPROCESS, &prf.OffsetEPROCESS, sizeof(VMM_WIN_EPROCESS_OFFSET));
+        ctxVmm->Profile.fEPROCESS = TRUE;
+    }
+    if(prf.fRegistry) {
+        memcpy(&ctxVmm->Profile.Registry, &prf.Registry, sizeof(VMMWIN_REGISTRY_OFFSET));
+        ctxVmm->Profile.Registry.vaHintCMHIVE = 0;
+        ctxVmm->Profile.fRegistry = TRUE;
+    }
+    ctxVmm->Profile.dwVersionBuild = prf.dwVersionBuild;
+    ctxVmm->Profile.fLoaded = TRUE;
+    fclose(hFile);
+    vmmprintfv_fn("Loaded profile '%s' (build %i).\n", ctxVmm->Profile.szFile, prf.dwVersionBuild);
+    return TRUE;
+fail:
+    fclose(hFile);
+    return FALSE;
+}
+
+BOOL VmmProfile_Initialize(_In_ PVMM_PROCESS pSystemProcess)
+{
+    CHAR szPath[MAX_PATH], szPdbName[MAX_PATH];
+    LPSTR szExt;
+    if(ctxMain->cfg.fDisableProfile) { return FALSE; }
+    if(!PE_GetPdbInfo(pSystemProcess, ctxVmm->kernel.vaBase, NULL, szPdbName, ctxVmm->Profile.pbPdbGUID, &ctxVmm->Profile.dwPdbAge)) {
+        vmmprintfvv_fn("Unable to retrieve kernel pdb info - profile disabled.\n");
+        return FALSE;
+    }
+    if(!szPdbName[0] || strpbrk(szPdbName, "\\/:*?\"<>|")) { return FALSE; }
+    if((szExt = strrchr(szPdbName, '.'))) { *szExt = 0; }
+    Util_GetPathDll(szPath, ctxVmm->hModuleVmm);
+    if(_snprintf_s(ctxVmm->Profile.szFile, MAX_PATH, _TRUNCATE, "%sProfiles\\%s-%016llx%016llx-%i.vmmprofile",
+        szPath,
+        szPdbName,
+        _byteswap_uint64(*(PQWORD)ctxVmm->Profile.pbPdbGUID),
+        _byteswap_uint64(*(PQWORD)(ctxVmm->Profile.pbPdbGUID + 8)),
+        ctxVmm->Profile.dwPdbAge) < 0) {
+        return FALSE;
+    }
+    ctxVmm->Profile.fEnabled = TRUE;
+    return VmmProfile_Load();
+}
+
+VOID VmmProfile_SetRegistry(_In_ PVMMWIN_REGISTRY_OFFSET po)
+{
+    memcpy(&ctxVmm->Profile.Registry, po, sizeof(VMMWIN_REGISTRY_OFFSET));
+    ctxVmm->Profile.Registry.vaHintCMHIVE = 0;
+    ctxVmm->Profile.fRegistry = TRUE;
+    ctxVmm->Profile.fDirty = TRUE;
+}
+
+VOID VmmProfile_Close()
+{
+    FILE *hFile = NULL;
+    BOOL fError;
+    LPSTR szDirEnd;
+    CHAR szFileTmp[MAX_PATH], szDir[MAX_PATH];
+    VMMPROFILE_FILE prf = { 0 };
+    if(!ctxVmm->Profile.fEnabled) { return; }
+    ctxVmm->Profile.fEnabled = FALSE;
+    // only write profile if windows is initialized and offsets were located
+    // (not loaded from profile) or the profile build number is outdated.
+    if((ctxVmm->tpSystem != VMM_SYSTEM_WINDOWS_X64) && (ctxVmm->tpSystem != VMM_SYSTEM_WINDOWS_X86)) { return; }
+    if(!ctxVmm->kernel.OffsetEPROCESS.fValid || !ctxVmm->kernel.dwVersionBuild) { return; }
+    if(ctxVmm->Profile.fEPROCESS && !ctxVmm->Profile.fDirty && (ctxVmm->Profile.dwVersionBuild == ctxVmm->kernel.dwVersionBuild)) { return; }
+    prf.dwMagic = VMMPROFILE_MAGIC;
+    prf.dwVersion = VMMPROFILE_VERSION;
+    memcpy(prf.pbPdbGUID, ctxVmm->Profile.pbPdbGUID, 16);
+    prf.dwPdbAge = ctxVmm->Profile.dwPdbAge;
+    prf.dwVersionBuild = ctxVmm->kernel.dwVersionBuild;
+    prf.tpMemoryModel = ctxVmm->tpMemoryModel;
+    prf.cbOffsetEPROCESS = sizeof(VMM_WIN_EPROCESS_OFFSET);
+    prf.cbRegistry = sizeof(VMMWIN_REGISTRY_OFFSET);
+    memcpy(&prf.OffsetEPROCESS, &ctxVmm->kernel.OffsetEPROCESS, sizeof(VMM_WIN_EPROCESS_OFFSET));
+    if((prf.fRegistry = ctxVmm->Profile.fRegistry)) {
+        memcpy(&prf.Registry, &ctxVmm->Profile.Registry, sizeof(VMMWIN_REGISTRY_OFFSET));
+    }
+    // create the 'Profiles' directory (if required).
+    strcpy_s(szDir, MAX_PATH, ctxVmm->Profile.szFile);
+    if((szDirEnd = strrchr(szDir, '\\'))) {
+        *szDirEnd = 0;
+        if(!CreateDirectoryA(szDir, NULL) && (GetLastError() != ERROR_ALREADY_EXISTS)) {
+            vmmprintf_fn("Unable to create profile directory '%s'.\n", szDir);
+            return;
+        }
+    }
+    // write to temporary file and replace any existing profile on success.
+    if(_snprintf_s(szFileTmp, MAX_PATH, _TRUNCATE, "%s.tmp", ctxVmm->Profile.szFile) < 0) { return; }
+    if(fopen_s(&hFile, szFileTmp, "wb") || !hFile) {
+        vmmprintf_fn("Unable to create profile '%s'.\n", szFileTmp);
+        return;
+    }
+    fError = (1 != fwrite(&prf, sizeof(VMMPROFILE_FILE), 1, hFile));
+    fError = fclose(hFile) || fError;
+    if(fError || !MoveFileExA(szFileTmp, ctxVmm->Profile.szFile, MOVEFILE_REPLACE_EXISTING)) {
+        vmmprintf_fn("Unable to write profile '%s'.\n", ctxVmm->Profile.szFile);
+        DeleteFileA(szFileTmp);
+        return;
+    }
+    vmmprintfv_fn("Wrote profile '%s' (build %i).\n", ctxVmm->Profile.szFile, prf.dwVersionBuild);
+}
@@ -0,0 +1,35 @@
+// vmmprofile.h : declarations of persisted kernel structure offset profiles.
+//
+// (c) Ulf Frisk, 2019
+// Author: Ulf Frisk, pcileech@frizk.net
+//
+
+#ifndef __VMMPROFILE_H__
+#define __VMMPROFILE_H__
+#include "vmm.h"
+
+/*
+* Initialize the offset profile functionality and load the profile matching
+* the ntoskrnl PDB GUID/age (if any) from the profile directory. EPROCESS offsets
+* are applied to ctxVmm->kernel.OffsetEPROCESS unless already valid (i.e. from
+* a cache file), registry offsets are made available in ctxVmm->Profile.
+* This function should be called after the kernel base is located and before
+* the EPROCESS offsets are located.
+* -- pSystemProcess
+* -- return = TRUE if a matching profile was loaded, FALSE otherwise.
+*/
+BOOL VmmProfile_Initialize(_In_ PVMM_PROCESS pSystemProcess);
+
+/*
+* Record newly located registry CMHIVE offsets for the profile.
+* -- po
+*/
+VOID VmmProfile_SetRegistry(_In_ PVMMWIN_REGISTRY_OFFSET po);
+
+/*
+* Write the profile of the current kernel (if enabled and new offsets have been
+* located since load). This function should be called on close.
+*/
+VOID VmmProfile_Close();
+
+#endif /* __VMMPROFILE_H__ */
@@ -0,0 +1,438 @@
+// vmmsearch.c : implementation of the multi-threaded memory search engine.
+//
+// The memory to search (physical memory ranges or the present ranges of the
+// PTE maps of processes) is split into work items of at most 1MB which are
+// searched in parallel on the persistent work pool. Each work item is read in
+// chunks of 16 pages (+ one page of overlap for patterns spanning chunks) over
+// the normal cache-backed read path. Candidate positions are located with the
+// AVX2 two-byte (or one-byte) prefilter - falling back to memchr if AVX2 isn't
+// supported by the CPU - before the full masked pattern is verified.
+//
+// (c) Ulf Frisk, 2019
+// Author: Ulf Frisk, pcileech@frizk.net
+//
+#include "vmmsearch.h"
+#include <intrin.h>
+#include <immintrin.h>
+
+#define VMMSEARCH_ITEM_SIZE         0x00100000
+#define VMMSEARCH_CHUNK_PAGES       0x10
+#define VMMSEARCH_CHUNK_SIZE        (VMMSEARCH_CHUNK_PAGES << 12)
+
+typedef struct tdVMMSEARCH_ITEM {
+    DWORD dwPID;                    // (DWORD)-1 = physical memory
+    DWORD fOverlap;                 // readable memory follows the item (range continues)
+    QWORD qwA;
+    QWORD cb;
+} VMMSEARCH_ITEM, *PVMMSEARCH_ITEM;
+
+typedef struct tdVMMSEARCH_PATTERN {
+    DWORD cb;
+    DWORD cbAlign;                  // 0 = no alignment, otherwise power of two
+    DWORD dwAlignMask32;            // bit mask of aligned positions within 32 bytes
+    DWORD oFilter;                  // offset of prefilter byte(s) in pattern
+    DWORD cFilter;                  // # prefilter bytes (0, 1 or 2)
+    BYTE b0;
+    BYTE b1;
+    BYTE pb[VMMDLL_MEM_SEARCH_MAXLENGTH];
+    BYTE pbMask[VMMDLL_MEM_SEARCH_MAXLENGTH];   // bits set are compared
+} VMMSEARCH_PATTERN, *PVMMSEARCH_PATTERN;
+
+typedef struct tdVMMSEARCH_CONTEXT {
+    PVMMDLL_MEM_SEARCH_CONTEXT pUser;
+    BOOL fAVX2;
+    volatile BOOL fAbort;
+    CRITICAL_SECTION LockResult;
+    DWORD cPattern;
+    VMMSEARCH_PATTERN Pattern[VMMDLL_MEM_SEARCH_MAX];
+    QWORD qwAddrMin;
+    QWORD qwAddrMax;
+    DWORD cItems;
+    DWORD cItemsMax;
+    PVMMSEARCH_ITEM pItems;
+} VMMSEARCH_CONTEXT, *PVMMSEARCH_CONTEXT;
+
+/*
+* Check whether the CPU and the operating system supports AVX2.
+* -- return
+*/
+BOOL VmmSearch_IsAVX2()
+{
+    int rgInfo[4];
+    __cpuid(rgInfo, 0);
+    if(rgInfo[0] < 7) { return FALSE; }
+    __cpuid(rgInfo, 1);
+    if((rgInfo[2] & 0x18000000) != 0x18000000) { return FALSE; }  // OSXSAVE + AVX
+    if((_xgetbv(0) & 0x06) != 0x06) { return FALSE; }             // XMM + YMM state enabled by os
+    __cpuidex(rgInfo, 7, 0);
+    return (rgInfo[1] & 0x20) ? TRUE : FALSE;                     // AVX2
+}
+
+inline BOOL VmmSearch_IsAbort(_In_ PVMMSEARCH_CONTEXT ctx)
+{
+    return ctx->fAbort || ctx->pUser->fAbortRequested || !ctxVmm->ThreadWorkers.fEnabled;
+}
+
+// ----------------------------------------------------------------------------
+// PATTERN MATCHING FUNCTIONALITY BELOW:
+// ----------------------------------------------------------------------------
+
+/*
+* Prepare a search pattern and select its prefilter bytes. Two consecutive
+* fully compared bytes are preferred; bytes other than 0x00 and 0xff are
+* preferred since those are very common in memory.
+* -- pe
+* -- pp
+*/
+VOID VmmSearch_PatternPrepare(_In_ PVMMDLL_MEM_SEARCH_ENTRY pe, _Out_ PVMMSEARCH_PATTERN pp)
+{
+    DWORD i, iScore, iScoreBest = 0;
+    ZeroMemory(pp, sizeof(VMMSEARCH_PATTERN));
+    pp->cb = pe->cb;
+    pp->cbAlign = (pe->cbAlign > 1) ? pe->cbAlign : 0;
+    pp->dwAlignMask32 = 0xffffffff;
+    if(pp->cbAlign && (pp->cbAlign <= 32)) {
+        for(pp->dwAlignMask32 = 0, i = 0; i < 32; i += pp->cbAlign) {
+            pp->dwAlignMask32 |= 1UL << i;
+        }
+    }
+    for(i = 0; i < pe->cb; i++) {
+        pp->pbMask[i] = ~pe->pbSkipMask[i];
+        pp->pb[i] = pe->pb[i] & pp->pbMask[i];
+    }
+    for(i = 0; i < pe->cb; i++) {
+        if(pp->pbMask[i] != 0xff) { continue; }
+        iScore = 1 + (((pp->pb[i] != 0x00) && (pp->pb[i] != 0xff)) ? 2 : 0);
+        if((i + 1 < pe->cb) && (pp->pbMask[i + 1] == 0xff)) {
+            iScore += 4 + (((pp->pb[i + 1] != 0x00) && (pp->pb[i + 1] != 0xff)) ? 1 : 0);
+        }
+        if(iScore > iScoreBest) {
+            iScoreBest = iScore;
+            pp->oFilter = i;
+            pp->cFilter = (iScore >= 4) ? 2 : 1;
+            pp->b0 = pp->pb[i];
+            pp->b1 = (pp->cFilter == 2) ? pp->pb[i + 1] : 0;
+        }
+    }
+}
+
+/*
+* Report a search hit to the caller. Callbacks are serialized.
+*/
+VOID VmmSearch_Result(_In_ PVMMSEARCH_CONTEXT ctx, _In_ DWORD dwPID, _In_ QWORD qwA, _In_ DWORD iSearch)
+{
+    PVMMDLL_MEM_SEARCH_CONTEXT pu = ctx->pUser;
+    EnterCriticalSection(&ctx->LockResult);
+    if(!ctx->fAbort) {
+        pu->cResult++;
+        if(pu->pfnResultCB && !pu->pfnResultCB(pu->ctx, dwPID, qwA, iSearch)) {
+            ctx->fAbort = TRUE;
+        }
+        if(pu->cMaxResult && (pu->cResult >= pu->cMaxResult)) {
+            ctx->fAbort = TRUE;
+        }
+    }
+    LeaveCriticalSection(&ctx->LockResult);
+}
+
+/*
+* Verify a candidate position against the full masked pattern.
+* -- ctx
+* -- iSearch
+* -- dwPID
+* -- qwA = address of chunk buffer start.
+* -- pb = chunk buffer.
+* -- o = offset of candidate in chunk buffer.
+* -- dwValid = bitmap of successfully read pages in the chunk buffer.
+*/
+inline VOID VmmSearch_Verify(_In_ PVMMSEARCH_CONTEXT ctx, _In_ DWORD iSearch, _In_ DWORD dwPID, _In_ QWORD qwA, _In_ PBYTE pb, _In_ DWORD o, _In_ DWORD dwValid)
+{
+    DWORD i, dwPages;
+    PVMMSEARCH_PATTERN pp = ctx->Pattern + iSearch;
+    if(pp->cbAlign && ((qwA + o) & (pp->cbAlign - 1))) { return; }
+    for(i = 0; i < pp->cb; i++) {
+        if((pb[o + i] & pp->pbMask[i]) != pp->pb[i]) { return; }
+    }
+    // all pages covered by the hit must have been read successfully
+    dwPages = ((2UL << ((o + pp->cb - 1) >> 12)) - 1) & ~((1UL << (o >> 12)) - 1);
+    if((dwValid & dwPages) != dwPages) { return; }
+    if((qwA + o < ctx->qwAddrMin) || (qwA + o + pp->cb - 1 > ctx->qwAddrMax)) { return; }
+    VmmSearch_Result(ctx, dwPID, qwA + o, iSearch);
+}
+
+/*
+* Scan for candidates using the AVX2 prefilter.
+* -- cMax = number of candidate positions in chunk buffer.
+*/
+VOID VmmSearch_ScanAVX2(_In_ PVMMSEARCH_CONTEXT ctx, _In_ DWORD iSearch, _In_ DWORD dwPID, _In_ QWORD qwA, _In_ PBYTE pb, _In_ DWORD cMax, _In_ DWORD dwValid)
+{
+    DWORD o = 0, dwMask, iBit;
+    __m256i v0, v1, vEq;
+    PVMMSEARCH_PATTERN pp = ctx->Pattern + iSearch;
+    PBYTE pbF = pb + pp->oFilter;
+    v0 = _mm256_set1_epi8((char)pp->b0);
+    v1 = _mm256_set1_epi8((char)pp->b1);
+    // loads at pbF + o + [0, 32] are within the buffer as long as o + 32 <= cMax
+    // since cMax <= cbBuffer - cb + 1 and oFilter + cFilter <= cb.
+    for(; o + 32 <= cMax; o += 32) {
+        vEq = _mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i*)(pbF + o)), v0);
+        if(pp->cFilter == 2) {
+            vEq = _mm256_and_si256(vEq, _mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i*)(pbF + o + 1)), v1));
+        }
+        dwMask = (DWORD)_mm256_movemask_epi8(vEq) & pp->dwAlignMask32;
+        while(_BitScanForward(&iBit, dwMask)) {
+            dwMask &= dwMask - 1;
+            VmmSearch_Verify(ctx, iSearch, dwPID, qwA, pb, o + iBit, dwValid);
+        }
+    }
+    for(; o < cMax; o++) {
+        if((pbF[o] == pp->b0) && ((pp->cFilter == 1) || (pbF[o + 1] == pp->b1))) {
+            VmmSearch_Verify(ctx, iSearch, dwPID, qwA, pb, o, dwValid);
+        }
+    }
+}
+
+/*
+* Scan for candidates using memchr on the first prefilter byte.
+* -- cMax = number of candidate positions in chunk buffer.
+*/
+VOID VmmSearch_ScanScalar(_In_ PVMMSEARCH_CONTEXT ctx, _In_ DWORD iSearch, _In_ DWORD dwPID, _In_ QWORD qwA, _In_ PBYTE pb, _In_ DWORD cMax, _In_ DWORD dwValid)
+{
+    DWORD o = 0;
+    PBYTE pbHit;
+    PVMMSEARCH_PATTERN pp = ctx->Pattern + iSearch;
+    PBYTE pbF = pb + pp->oFilter;
+    while(o < cMax) {
+        if(!(pbHit = memchr(pbF + o, pp->b0, cMax - o))) { break; }
+        o = (DWORD)(pbHit - pbF);
+        if((pp->cFilter == 1) || (pbF[o + 1] == pp->b1)) {
+            VmmSearch_Verify(ctx, iSearch, dwPID, qwA, pb, o, dwValid);
+        }
+        o++;
+    }
+}
+
+/*
+* Search a chunk buffer for all patterns.
+* -- ctx
+* -- dwPID
+* -- qwA = address of chunk buffer start.
+* -- pb = chunk buffer.
+* -- cbSearch = bytes in which hits may start.
+* -- cbBuffer = bytes in buffer (cbSearch + optional overlap).
+* -- dwValid = bitmap of successfully read pages in the chunk buffer.
+*/
+VOID VmmSearch_Chunk(_In_ PVMMSEARCH_CONTEXT ctx, _In_ DWORD dwPID, _In_ QWORD qwA, _In_ PBYTE pb, _In_ DWORD cbSearch, _In_ DWORD cbBuffer, _In_ DWORD dwValid)
+{
+    DWORD iSearch, o, cMax;
+    PVMMSEARCH_PATTERN pp;
+    for(iSearch = 0; (iSearch < ctx->cPattern) && !ctx->fAbort; iSearch++) {
+        pp = ctx->Pattern + iSearch;
+        if(pp->cb > cbBuffer) { continue; }
+        cMax = min(cbSearch, cbBuffer - pp->cb + 1);
+        if(!pp->cFilter) {
+            // pattern without fully compared bytes - verify every position.
+            for(o = 0; o < cMax; o++) {
+                VmmSearch_Verify(ctx, iSearch, dwPID, qwA, pb, o, dwValid);
+            }
+        } else if(ctx->fAVX2) {
+            VmmSearch_ScanAVX2(ctx, iSearch, dwPID, qwA, pb, cMax, dwValid);
+        } else {
+            VmmSearch_ScanScalar(ctx, iSearch, dwPID, qwA, pb, cMax, dwValid);
+        }
+    }
+}
+
+/*
+* Process a single work item - called in parallel from the work pool.
+* -- ctx
+* -- iItem
+*/
+VOID VmmSearch_ItemProcess(_In_ PVMMSEARCH_CONTEXT ctx, _In_ DWORD iItem)
+{
+    PVMMSEARCH_ITEM pi = ctx->pItems + iItem;
+    PVMM_PROCESS pObProcess = NULL;
+    PBYTE pb = NULL;
+    MEM_IO_SCATTER_HEADER MEMs[VMMSEARCH_CHUNK_PAGES + 1];
+    PMEM_IO_SCATTER_HEADER ppMEMs[VMMSEARCH_CHUNK_PAGES + 1];
+    QWORD qwA, qwEnd, cbChunk, cbRead;
+    DWORD i, cPages, dwValid;
+    if(VmmSearch_IsAbort(ctx)) { return; }
+    if((pi->dwPID != (DWORD)-1) && !(pObProcess = VmmProcessGet(pi->dwPID))) { return; }
+    if(!(pb = LocalAlloc(0, (VMMSEARCH_CHUNK_PAGES + 1) << 12))) { goto fail; }
+    qwEnd = pi->qwA + pi->cb;
+    for(qwA = pi->qwA; (qwA < qwEnd) && !VmmSearch_IsAbort(ctx); qwA += cbChunk) {
+        cbChunk = min(VMMSEARCH_CHUNK_SIZE, qwEnd - qwA);
+        cPages = (DWORD)(cbChunk >> 12);
+        // read one extra page for patterns spanning into the next chunk / item
+        if((qwA + cbChunk < qwEnd) || pi->fOverlap) { cPages++; }
+        ZeroMemory(MEMs, cPages * sizeof(MEM_IO_SCATTER_HEADER));
+        for(i = 0; i < cPages; i++) {
+            ppMEMs[i] = MEMs + i;
+            MEMs[i].magic = MEM_IO_SCATTER_HEADER_MAGIC;
+            MEMs[i].version = MEM_IO_SCATTER_HEADER_VERSION;
+            MEMs[i].qwA = qwA + ((QWORD)i << 12);
+            MEMs[i].cbMax = 0x1000;
+            MEMs[i].pb = pb + ((QWORD)i << 12);
+        }
+        if(pObProcess) {
+            VmmReadScatterVirtual(pObProcess, ppMEMs, cPages, ctx->pUser->flags);
+        } else {
+            VmmReadScatterPhysical(ppMEMs, cPages, ctx->pUser->flags);
+        }
+        for(i = 0, dwValid = 0, cbRead = 0; i < cPages; i++) {
+            if(MEMs[i].cb == 0x1000) {
+                dwValid |= 1UL << i;
+                cbRead += (i < (cbChunk >> 12)) ? 0x1000 : 0;
+            } else {
+                ZeroMemory(MEMs[i].pb, 0x1000);
+            }
+        }
+        InterlockedAdd64((PLONG64)&ctx->pUser->cbReadTotal, cbRead);
+        if(dwValid) {
+            VmmSearch_Chunk(ctx, pi->dwPID, qwA, pb, (DWORD)cbChunk, cPages << 12, dwValid);
+        }
+    }
+fail:
+    Ob_DECREF(pObProcess);
+    LocalFree(pb);
+}
+
+// ----------------------------------------------------------------------------
+// WORK ITEM / RANGE COLLECTION FUNCTIONALITY BELOW:
+// ----------------------------------------------------------------------------
+
+/*
+* Add a page aligned memory range to search - the range is split into work
+* items of at most VMMSEARCH_ITEM_SIZE bytes.
+* -- ctx
+* -- dwPID = (DWORD)-1 for physical memory.
+* -- qwA
+* -- cb
+* -- return
+*/
+_Success_(return)
+BOOL VmmSearch_RangeAdd(_In_ PVMMSEARCH_CONTEXT ctx, _In_ DWORD dwPID, _In_ QWORD qwA, _In_ QWORD cb)
+{
+    DWORD cItemsMaxNew;
+    PVOID pvNew;
+    PVMMSEARCH_ITEM pi;
+    QWORD qwEnd = qwA + cb;
+    while(qwA < qwEnd) {
+        if(ctx->cItems == ctx->cItemsMax) {
+            cItemsMaxNew = ctx->cItemsMax ? (ctx->cItemsMax * 2) : 0x400;
+            pvNew = ctx->pItems ? LocalReAlloc(ctx->pItems, cItemsMaxNew * sizeof(VMMSEARCH_ITEM), LMEM_MOVEABLE) : LocalAlloc(0, cItemsMaxNew * sizeof(VMMSEARCH_ITEM));
+            if(!pvNew) { return FALSE; }
+            ctx->pItems = pvNew;
+            ctx->cItemsMax = cItemsMaxNew;
+        }
+        pi = ctx->pItems + ctx->cItems++;
+        pi->dwPID = dwPID;
+        pi->qwA = qwA;
+        pi->cb = min(VMMSEARCH_ITEM_SIZE, qwEnd - qwA);
+        pi->fOverlap = (qwA + pi->cb < qwEnd);
+        qwA += pi->cb;
+    }
+    return TRUE;
+}
+
+/*
+* Add the present memory ranges of a process (from its PTE map) to search.
+* Adjacent PTE map entries are merged into a single range.
+* -- ctx
+* -- pProcess
+* -- return
+*/
+_Success_(return)
+BOOL VmmSearch_RangeAddProcess(_In_ PVMMSEARCH_CONTEXT ctx, _In_ PVMM_PROCESS pProcess)
+{
+    BOOL fResult = TRUE;
+    DWORD i;
+    QWORD vaStart = 0, vaEnd = 0, va, vaLimit, vaMinAll, vaMaxAll;
+    PVMM_MAP_PTEENTRY pe;
+    PVMMOB_MAP_PTE pObPteMap = NULL;
+    if(!VmmMap_GetPte(pProcess, &pObPteMap, FALSE)) { return TRUE; }    // no map -> nothing to search
+    vaMinAll = ctx->qwAddrMin & ~0xfff;
+    vaMaxAll = ((ctx->qwAddrMax | 0xfff) == (QWORD)-1) ? (QWORD)-1 : ((ctx->qwAddrMax | 0xfff) + 1);
+    for(i = 0; (i < pObPteMap->cMap) && fResult; i++) {
+        pe = pObPteMap->pMap + i;
+        va = max(pe->vaBase, vaMinAll);
+        vaLimit = min(pe->vaBase + (pe->cPages << 12), vaMaxAll);
+        if(va >= vaLimit) { continue; }
+        if(vaEnd && (vaEnd == va)) {
+            vaEnd = vaLimit;
+            continue;
+        }
+        if(vaEnd > vaStart) {
+            fResult = VmmSearch_RangeAdd(ctx, pProcess->dwPID, vaStart, vaEnd - vaStart);
+        }
+        vaStart = va;
+        vaEnd = vaLimit;
+    }
+    if(fResult && (vaEnd > vaStart)) {
+        fResult = VmmSearch_RangeAdd(ctx, pProcess->dwPID, vaStart, vaEnd - vaStart);
+    }
+    Ob_DECREF(pObPteMap);
+    return fResult;
+}
+
+_Success_(return)
+BOOL VmmSearch(_Inout_ PVMMDLL_MEM_SEARCH_CONTEXT ctx)
+{
+    BOOL fResult = FALSE;
+    DWORD i;
+    QWORD paEnd;
+    PVMM_PROCESS pObProcess = NULL;
+    PVMMSEARCH_CONTEXT ctxS = NULL;
+    // 1: verify parameters
+    if((ctx->dwVersion != VMMDLL_MEM_SEARCH_VERSION) || !ctx->cSearch || (ctx->cSearch > VMMDLL_MEM_SEARCH_MAX)) { return FALSE; }
+    for(i = 0; i < ctx->cSearch; i++) {
+        if(!ctx->search[i].cb || (ctx->search[i].cb > VMMDLL_MEM_SEARCH_MAXLENGTH)) { return FALSE; }
+        if(ctx->search[i].cbAlign & (ctx->search[i].cbAlign - 1)) { return FALSE; }
+    }
+    if(ctx->qwAddrMax && (ctx->qwAddrMax < ctx->qwAddrMin)) { return FALSE; }
+    ctx->cbReadTotal = 0;
+    ctx->cResult = 0;
+    // 2: set up context and patterns
+    if(!(ctxS = LocalAlloc(LMEM_ZEROINIT, sizeof(VMMSEARCH_CONTEXT)))) { return FALSE; }
+    InitializeCriticalSection(&ctxS->LockResult);
+    ctxS->pUser = ctx;
+    ctxS->fAVX2 = VmmSearch_IsAVX2();
+    ctxS->qwAddrMin = ctx->qwAddrMin;
+    ctxS->qwAddrMax = ctx->qwAddrMax ? ctx->qwAddrMax : (QWORD)-1;
+    ctxS->cPattern = ctx->cSearch;
+    for(i = 0; i < ctx->cSearch; i++) {
+        VmmSearch_PatternPrepare(&ctx->search[i], &ctxS->Pattern[i]);
+    }
+    // 3: collect ranges / work items
+    switch(ctx->tpScope) {
+        case VMMDLL_MEM_SEARCH_SCOPE_PHYSICAL:
+            paEnd = min(ctxS->qwAddrMax, ctxMain->dev.paMax - 1);
+            if((ctxS->qwAddrMin & ~0xfff) > paEnd) { break; }
+            if(!VmmSearch_RangeAdd(ctxS, (DWORD)-1, ctxS->qwAddrMin & ~0xfff, (paEnd | 0xfff) + 1 - (ctxS->qwAddrMin & ~0xfff))) { goto fail; }
+            break;
+        case VMMDLL_MEM_SEARCH_SCOPE_PROCESS:
+            if(!(pObProcess = VmmProcessGet(ctx->dwPID))) { goto fail; }
+            if(!VmmSearch_RangeAddProcess(ctxS, pObProcess)) { goto fail; }
+            break;
+        case VMMDLL_MEM_SEARCH_SCOPE_ALLPROCESS:
+            while((pObProcess = VmmProcessGetNext(pObProcess, 0))) {
+                if(!VmmSearch_RangeAddProcess(ctxS, pObProcess)) { goto fail; }
+            }
+            break;
+        default:
+            goto fail;
+    }
+    // 4: search in parallel
+    vmmprintfvv_fn("Search: %i pattern(s) in %i work item(s) AVX2: %i\n", ctxS->cPattern, ctxS->cItems, ctxS->fAVX2);
+    if(ctxS->cItems) {
+        VmmWorkParallel(ctxS, ctxS->cItems, (VOID(*)(PVOID, DWORD))VmmSearch_ItemProcess);
+    }
+    fResult = ctxVmm->ThreadWorkers.fEnabled;
+fail:
+    Ob_DECREF(pObProcess);
+    DeleteCriticalSection(&ctxS->LockResult);
+    LocalFree(ctxS->pItems);
+    LocalFree(ctxS);
+    return fResult;
+}
@@ -0,0 +1,26 @@
+// vmmsearch.h : declarations of the multi-threaded memory search engine.
+//
+// (c) Ulf Frisk, 2019
+// Author: Ulf Frisk, pcileech@frizk.net
+//
+#ifndef __VMMSEARCH_H__
+#define __VMMSEARCH_H__
+#include "vmm.h"
+#include "vmmdll.h"
+
+/*
+* Search physical memory, the virtual memory of a single process or the virtual
+* memory of all processes for a set of byte patterns (with optional wildcard
+* masks). The memory to search is split into work items which are processed in
+* parallel on the persistent work pool (VmmWorkParallel). In virtual memory only
+* pages present in the PTE map of the process are searched. Hits are forwarded
+* to the optional result callback - callbacks are serialized but are made in no
+* particular address order.
+* -- ctx = search context - see VMMDLL_MEM_SEARCH_CONTEXT for more information.
+* -- return = TRUE if the search was completed or aborted by the caller, FALSE
+*             on invalid parameters or failure.
+*/
+_Success_(return)
+BOOL VmmSearch(_Inout_ PVMMDLL_MEM_SEARCH_CONTEXT ctx);
+
+#endif /* __VMMSEARCH_H__ */
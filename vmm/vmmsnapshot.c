@@ -0,0 +1,283 @@
+// vmmsnapshot.c : implementation of page-level memory snapshots and diffs.
+//
+// A snapshot records a 64-bit hash per page (8 bytes/page) together with the
+// address ranges the hashes belong to. The ranges are the present entries of
+// the process PTE map or a single physical memory range. Pages are read from
+// the device in batches of 16 pages over the regular scatter read functions -
+// in parallel work items of up to 256 pages on the persistent work pool.
+//
+// (c) Ulf Frisk, 2019
+// Author: Ulf Frisk, pcileech@frizk.net
+//
+#include "vmmsnapshot.h"
+#include "util.h"
+
+#define VMMSNAPSHOT_ITEM_PAGES      0x100
+#define VMMSNAPSHOT_BATCH_PAGES     0x10
+#define VMMSNAPSHOT_MAX_PAGES       0x04000000      // 256GB of memory / 512MB of hashes
+
+typedef struct tdVMMSNAPSHOT_ITEM {
+    QWORD qwA;
+    DWORD cPages;
+    DWORD iHash;
+} VMMSNAPSHOT_ITEM, *PVMMSNAPSHOT_ITEM;
+
+typedef struct tdVMMSNAPSHOT_CONTEXT {
+    PVMM_PROCESS pProcess;              // NULL = physical memory
+    QWORD flags;
+    PVMMDLL_MEM_SNAPSHOT pSnapshot;
+    DWORD cItems;
+    PVMMSNAPSHOT_ITEM pItems;
+} VMMSNAPSHOT_CONTEXT, *PVMMSNAPSHOT_CONTEXT;
+
+typedef struct tdVMMSNAPSHOT_CURSOR {
+    PVMMDLL_MEM_SNAPSHOT p;
+    DWORD iRange;
+    DWORD iPage;
+} VMMSNAPSHOT_CURSOR, *PVMMSNAPSHOT_CURSOR;
+
+// ----------------------------------------------------------------------------
+// SNAPSHOT FUNCTIONALITY BELOW:
+// ----------------------------------------------------------------------------
+
+/*
+* Read and hash the pages of a single work item - called in parallel from the
+* work pool. Unreadable pages are given the hash zero; readable pages are never
+* given the hash zero.
+* -- ctx
+* -- iItem
+*/
+VOID VmmSnapshot_ItemProcess(_In_ PVMMSNAPSHOT_CONTEXT ctx, _In_ DWORD iItem)
+{
+    PVMMSNAPSHOT_ITEM pi = ctx->pItems + iItem;
+    PQWORD pqwHash = ctx->pSnapshot->pqwHash + pi->iHash;
+    MEM_IO_SCATTER_HEADER MEMs[VMMSNAPSHOT_BATCH_PAGES];
+    PMEM_IO_SCATTER_HEADER ppMEMs[VMMSNAPSHOT_BATCH_PAGES];
+    DWORD i, iPage, cPages;
+    QWORD qwHash;
+    PBYTE pb;
+    if(!ctxVmm->ThreadWorkers.fEnabled) { return; }
+    if(!(pb = LocalAlloc(0, VMMSNAPSHOT_BATCH_PAGES << 12))) { return; }
+    for(iPage = 0; iPage < pi->cPages; iPage += cPages) {
+        cPages = min(VMMSNAPSHOT_BATCH_PAGES, pi->cPages - iPage);
+        ZeroMemory(MEMs, cPages * sizeof(MEM_IO_SCATTER_HEADER));
+        for(i = 0; i < cPages; i++) {
+            ppMEMs[i] = MEMs + i;
+            MEMs[i].magic = MEM_IO_SCATTER_HEADER_MAGIC;
+            MEMs[i].version = MEM_IO_SCATTER_HEADER_VERSION;
+            MEMs[i].qwA = pi->qwA + ((QWORD)(iPage + i) << 12);
+            MEMs[i].cbMax = 0x1000;
+            MEMs[i].pb = pb + ((QWORD)i << 12);
+        }
+        if(ctx->pProcess) {
+            VmmReadScatterVirtual(ctx->pProcess, ppMEMs, cPages, ctx->flags);
+        } else {
+            VmmReadScatterPhysical(ppMEMs, cPages, ctx->flags);
+        }
+        for(i = 0; i < cPages; i++) {
+            qwHash = 0;
+            if(MEMs[i].cb == 0x1000) {
+                qwHash = Util_Hash64(MEMs[i].pb, 0x1000);
+                qwHash = qwHash ? qwHash : 1;
+            }
+            pqwHash[iPage + i] = qwHash;
+        }
+    }
+    LocalFree(pb);
+}
+
+/*
+* Append a page aligned range to the growable range array.
+* -- ppRanges
+* -- pcRanges
+* -- pcRangesMax
+* -- pcPages = total page count (updated).
+* -- qwA
+* -- cPages
+* -- return
+*/
+_Success_(return)
+BOOL VmmSnapshot_RangeAdd(_Inout_ PVMMDLL_MEM_SNAPSHOT_RANGE *ppRanges, _Inout_ PDWORD pcRanges, _Inout_ PDWORD pcRangesMax, _Inout_ PQWORD pcPages, _In_ QWORD qwA, _In_ QWORD cPages)
+{
+    PVOID pvNew;
+    DWORD cRangesMaxNew;
+    PVMMDLL_MEM_SNAPSHOT_RANGE pe;
+    if(!cPages) { return TRUE; }
+    if(*pcPages + cPages > VMMSNAPSHOT_MAX_PAGES) { return FALSE; }
+    if(*pcRanges == *pcRangesMax) {
+        cRangesMaxNew = *pcRangesMax ? (*pcRangesMax * 2) : 0x100;
+        pvNew = *ppRanges ? LocalReAlloc(*ppRanges, cRangesMaxNew * sizeof(VMMDLL_MEM_SNAPSHOT_RANGE), LMEM_MOVEABLE) : LocalAlloc(0, cRangesMaxNew * sizeof(VMMDLL_MEM_SNAPSHOT_RANGE));
+        if(!pvNew) { return FALSE; }
+        *ppRanges = pvNew;
+        *pcRangesMax = cRangesMaxNew;
+    }
+    pe = *ppRanges + (*pcRanges)++;
+    pe->qwA = qwA;
+    pe->cPages = (DWORD)cPages;
+    pe->iHash = (DWORD)*pcPages;
+    *pcPages += cPages;
+    return TRUE;
+}
+
+PVMMDLL_MEM_SNAPSHOT VmmSnapshot_Create(_In_ DWORD dwPID, _In_ QWORD qwAddrMin, _In_ QWORD qwAddrMax, _In_ QWORD flags)
+{
+    BOOL fResult = FALSE;
+    DWORD i, iPage, cRanges = 0, cRangesMax = 0;
+    QWORD cPages = 0, qwA, qwLimit, qwMinAll, qwMaxAll;
+    PVMMDLL_MEM_SNAPSHOT_RANGE pRanges = NULL;
+    PVMMDLL_MEM_SNAPSHOT pSnapshot = NULL;
+    PVMMOB_MAP_PTE pObPteMap = NULL;
+    PVMM_MAP_PTEENTRY pePte;
+    PVMMSNAPSHOT_ITEM pi;
+    VMMSNAPSHOT_CONTEXT ctx = { 0 };
+    if(qwAddrMax && (qwAddrMax < qwAddrMin)) { return NULL; }
+    qwMinAll = qwAddrMin & ~0xfff;
+    qwMaxAll = (!qwAddrMax || ((qwAddrMax | 0xfff) == (QWORD)-1)) ? (QWORD)-1 : ((qwAddrMax | 0xfff) + 1);
+    // 1: collect ranges
+    if(dwPID == (DWORD)-1) {
+        qwLimit = min(qwMaxAll, ctxMain->dev.paMax);
+        if(qwMinAll < qwLimit) {
+            if(!VmmSnapshot_RangeAdd(&pRanges, &cRanges, &cRangesMax, &cPages, qwMinAll, (qwLimit - qwMinAll) >> 12)) { goto fail; }
+        }
+    } else {
+        if(!(ctx.pProcess = VmmProcessGet(dwPID))) { goto fail; }
+        if(!VmmMap_GetPte(ctx.pProcess, &pObPteMap, FALSE)) { goto fail; }
+        for(i = 0; i < pObPteMap->cMap; i++) {
+            pePte = pObPteMap->pMap + i;
+            qwA = max(pePte->vaBase, qwMinAll);
+            qwLimit = min(pePte->vaBase + (pePte->cPages << 12), qwMaxAll);
+            if(qwA >= qwLimit) { continue; }
+            if(!VmmSnapshot_RangeAdd(&pRanges, &cRanges, &cRangesMax, &cPages, qwA, (qwLimit - qwA) >> 12)) { goto fail; }
+        }
+    }
+    // 2: allocate snapshot and work items
+    pSnapshot = LocalAlloc(0, sizeof(VMMDLL_MEM_SNAPSHOT) + cRanges * sizeof(VMMDLL_MEM_SNAPSHOT_RANGE) + cPages * sizeof(QWORD));
+    if(!pSnapshot) { goto fail; }
+    pSnapshot->magic = VMMDLL_MEM_SNAPSHOT_MAGIC;
+    pSnapshot->dwVersion = VMMDLL_MEM_SNAPSHOT_VERSION;
+    pSnapshot->dwPID = dwPID;
+    pSnapshot->qwAddrMin = qwAddrMin;
+    pSnapshot->qwAddrMax = qwAddrMax;
+    pSnapshot->flags = flags;
+    pSnapshot->cRange = cRanges;
+    pSnapshot->cPages = (DWORD)cPages;
+    pSnapshot->pRange = (PVMMDLL_MEM_SNAPSHOT_RANGE)(pSnapshot + 1);
+    pSnapshot->pqwHash = (PQWORD)(pSnapshot->pRange + cRanges);
+    if(cRanges) {
+        memcpy(pSnapshot->pRange, pRanges, cRanges * sizeof(VMMDLL_MEM_SNAPSHOT_RANGE));
+    }
+    for(i = 0; i < cRanges; i++) {
+        ctx.cItems += (pRanges[i].cPages + VMMSNAPSHOT_ITEM_PAGES - 1) / VMMSNAPSHOT_ITEM_PAGES;
+    }
+    if(ctx.cItems && !(ctx.pItems = LocalAlloc(0, ctx.cItems * sizeof(VMMSNAPSHOT_ITEM)))) { goto fail; }
+    for(i = 0, pi = ctx.pItems; i < cRanges; i++) {
+        for(iPage = 0; iPage < pRanges[i].cPages; iPage += VMMSNAPSHOT_ITEM_PAGES, pi++) {
+            pi->qwA = pRanges[i].qwA + ((QWORD)iPage << 12);
+            pi->cPages = min(VMMSNAPSHOT_ITEM_PAGES, pRanges[i].cPages - iPage);
+            pi->iHash = pRanges[i].iHash + iPage;
+        }
+    }
+    // 3: read and hash pages in parallel - always bypass the cache
+    ctx.flags = flags | VMM_FLAG_NOCACHE;
+    ctx.pSnapshot = pSnapshot;
+    if(ctx.cItems) {
+        VmmWorkParallel(&ctx, ctx.cItems, (VOID(*)(PVOID, DWORD))VmmSnapshot_ItemProcess);
+    }
+    fResult = ctxVmm->ThreadWorkers.fEnabled;
+fail:
+    Ob_DECREF(pObPteMap);
+    Ob_DECREF(ctx.pProcess);
+    LocalFree(ctx.pItems);
+    LocalFree(pRanges);
+    if(!fResult) {
+        LocalFree(pSnapshot);
+        return NULL;
+    }
+    return pSnapshot;
+}
+
+// ----------------------------------------------------------------------------
+// DIFF FUNCTIONALITY BELOW:
+// ----------------------------------------------------------------------------
+
+inline QWORD VmmSnapshot_CursorAddress(_In_ PVMMSNAPSHOT_CURSOR pc)
+{
+    if(pc->iRange >= pc->p->cRange) { return (QWORD)-1; }
+    return pc->p->pRange[pc->iRange].qwA + ((QWORD)pc->iPage << 12);
+}
+
+inline QWORD VmmSnapshot_CursorHash(_In_ PVMMSNAPSHOT_CURSOR pc)
+{
+    return pc->p->pqwHash[pc->p->pRange[pc->iRange].iHash + pc->iPage];
+}
+
+inline VOID VmmSnapshot_CursorNext(_Inout_ PVMMSNAPSHOT_CURSOR pc)
+{
+    if(++pc->iPage >= pc->p->pRange[pc->iRange].cPages) {
+        pc->iRange++;
+        pc->iPage = 0;
+    }
+}
+
+/*
+* Walk two snapshots in address order and retrieve the differing pages.
+* -- pOld
+* -- pNew
+* -- pDiff = diff to receive counts and entries, or NULL to count only.
+* -- return = number of differing pages.
+*/
+DWORD VmmSnapshot_DiffEntries(_In_ PVMMDLL_MEM_SNAPSHOT pOld, _In_ PVMMDLL_MEM_SNAPSHOT pNew, _Inout_opt_ PVMMDLL_MEM_SNAPSHOT_DIFF pDiff)
+{
+    DWORD c = 0, tp;
+    QWORD qwAO, qwAN, qwA, qwHO, qwHN;
+    VMMSNAPSHOT_CURSOR cO = { 0 }, cN = { 0 };
+    cO.p = pOld;
+    cN.p = pNew;
+    while(TRUE) {
+        qwAO = VmmSnapshot_CursorAddress(&cO);
+        qwAN = VmmSnapshot_CursorAddress(&cN);
+        if((qwAO == (QWORD)-1) && (qwAN == (QWORD)-1)) { break; }
+        qwHO = (qwAO <= qwAN) ? VmmSnapshot_CursorHash(&cO) : 0;
+        qwHN = (qwAN <= qwAO) ? VmmSnapshot_CursorHash(&cN) : 0;
+        qwA = min(qwAO, qwAN);
+        if(qwAO <= qwAN) { VmmSnapshot_CursorNext(&cO); }
+        if(qwAN <= qwA) { VmmSnapshot_CursorNext(&cN); }
+        if(qwHO == qwHN) { continue; }
+        tp = !qwHO ? VMMDLL_MEM_SNAPSHOT_DIFF_ADDED : (!qwHN ? VMMDLL_MEM_SNAPSHOT_DIFF_REMOVED : VMMDLL_MEM_SNAPSHOT_DIFF_CHANGED);
+        if(pDiff) {
+            pDiff->pEntry[c].qwA = qwA;
+            pDiff->pEntry[c].tp = tp;
+            pDiff->pEntry[c]._Reserved = 0;
+            switch(tp) {
+                case VMMDLL_MEM_SNAPSHOT_DIFF_CHANGED: pDiff->cChanged++; break;
+                case VMMDLL_MEM_SNAPSHOT_DIFF_ADDED:   pDiff->cAdded++; break;
+                case VMMDLL_MEM_SNAPSHOT_DIFF_REMOVED: pDiff->cRemoved++; break;
+            }
+        }
+        c++;
+    }
+    return c;
+}
+
+PVMMDLL_MEM_SNAPSHOT_DIFF VmmSnapshot_Diff(_In_ PVMMDLL_MEM_SNAPSHOT pSnapshot, _Out_opt_ PVMMDLL_MEM_SNAPSHOT *ppSnapshotNew)
+{
+    DWORD cEntry;
+    PVMMDLL_MEM_SNAPSHOT pSnapshotNew = NULL;
+    PVMMDLL_MEM_SNAPSHOT_DIFF pDiff = NULL;
+    if(ppSnapshotNew) { *ppSnapshotNew = NULL; }
+    if((pSnapshot->magic != VMMDLL_MEM_SNAPSHOT_MAGIC) || (pSnapshot->dwVersion != VMMDLL_MEM_SNAPSHOT_VERSION)) { return NULL; }
+    if(!(pSnapshotNew = VmmSnapshot_Create(pSnapshot->dwPID, pSnapshot->qwAddrMin, pSnapshot->qwAddrMax, pSnapshot->flags))) { return NULL; }
+    cEntry = VmmSnapshot_DiffEntries(pSnapshot, pSnapshotNew, NULL);
+    if(!(pDiff = LocalAlloc(LMEM_ZEROINIT, sizeof(VMMDLL_MEM_SNAPSHOT_DIFF) + cEntry * sizeof(VMMDLL_MEM_SNAPSHOT_DIFF_ENTRY)))) { goto fail; }
+    pDiff->magic = VMMDLL_MEM_SNAPSHOT_DIFF_MAGIC;
+    pDiff->dwVersion = VMMDLL_MEM_SNAPSHOT_DIFF_VERSION;
+    pDiff->cEntry = cEntry;
+    VmmSnapshot_DiffEntries(pSnapshot, pSnapshotNew, pDiff);
+    if(ppSnapshotNew) {
+        *ppSnapshotNew = pSnapshotNew;
+        pSnapshotNew = NULL;
+    }
+fail:
+    LocalFree(pSnapshotNew);
+    return pDiff;
+}
@@ -0,0 +1,34 @@
+// vmmsnapshot.h : declarations of page-level memory snapshots and diffs.
+//
+// (c) Ulf Frisk, 2019
+// Author: Ulf Frisk, pcileech@frizk.net
+//
+#ifndef __VMMSNAPSHOT_H__
+#define __VMMSNAPSHOT_H__
+#include "vmm.h"
+#include "vmmdll.h"
+
+/*
+* Take a page-level snapshot of the present pages of a process PTE map or of a
+* physical memory range. Pages are read (bypassing the cache) and hashed in
+* parallel on the persistent work pool.
+* CALLER LocalFree: return
+* -- dwPID = PID of process, (DWORD)-1 for physical memory.
+* -- qwAddrMin
+* -- qwAddrMax = max address (0 = no limit).
+* -- flags = VMM_FLAG_*
+* -- return
+*/
+PVMMDLL_MEM_SNAPSHOT VmmSnapshot_Create(_In_ DWORD dwPID, _In_ QWORD qwAddrMin, _In_ QWORD qwAddrMax, _In_ QWORD flags);
+
+/*
+* Take a new snapshot with the same parameters as pSnapshot and return the
+* pages changed, added or removed since pSnapshot was taken.
+* CALLER LocalFree: return, *ppSnapshotNew
+* -- pSnapshot
+* -- ppSnapshotNew = optional ptr to receive the new snapshot.
+* -- return
+*/
+PVMMDLL_MEM_SNAPSHOT_DIFF VmmSnapshot_Diff(_In_ PVMMDLL_MEM_SNAPSHOT pSnapshot, _Out_opt_ PVMMDLL_MEM_SNAPSHOT *ppSnapshotNew);
+
+#endif /* __VMMSNAPSHOT_H__ */
@@ -0,0 +1,195 @@
+// vmmtrace.c : implementation of low-overhead trace events of VMM hot paths.
+//
+// Events are emitted to ETW by a TraceLogging provider when enabled by an
+// ETW session, and/or recorded into an in-memory ring buffer. The ring buffer
+// is written lock-free; an entry may be torn if the buffer wraps around while
+// the entry is being written - this is accepted for the diagnostic use.
+//
+// (c) Ulf Frisk, 2019
+// Author: Ulf Frisk, pcileech@frizk.net
+//
+
+#include "vmmtrace.h"
+#include <TraceLoggingProvider.h>
+
+#define VMMTRACE_RING_ENTRIES       0x4000      // must be power of 2
+#define VMMTRACE_RING_LINELENGTH    92
+
+TRACELOGGING_DEFINE_PROVIDER(
+    g_hVmmTraceProvider,
+    "MemProcFS.Vmm",
+    (0x8f0c51a4, 0x2b7e, 0x4c55, 0x9d, 0x0a, 0x6e, 0x3b, 0x1f, 0x7d, 0x2c, 0x91));
+
+typedef struct tdVMMTRACE_RING_ENTRY {
+    QWORD tm;
+    DWORD tpEvent;
+    DWORD dwPID;
+    DWORD dwTID;
+    DWORD _Filler;
+    QWORD qw1;
+    QWORD qw2;
+    QWORD qwDurationUs;
+} VMMTRACE_RING_ENTRY, *PVMMTRACE_RING_ENTRY;
+
+typedef struct tdVMMTRACE_CONTEXT {
+    BOOL fRegistered;
+    QWORD qwFreq;
+    QWORD tmInitialize;
+    volatile LONG64 iRing;                      // total number of ring buffer entries written
+    PVMMTRACE_RING_ENTRY pRing;
+} VMMTRACE_CONTEXT;
+
+volatile LONG g_VmmTraceEnabled = 0;
+VMMTRACE_CONTEXT g_VmmTrace = { 0 };
+
+LPCSTR VMMTRACE_EVENT_NAMES[] = {
+    "",
+    "RefreshTick",
+    "CacheClear",
+    "CacheReclaim",
+    "MasterLock",
+    "MapBuild",
+    "PdbLoad",
+    "PagedRead",
+    "PagedReadBatch",
+};
+
+/*
+* ETW enable callback - invoked when an ETW session enables or disables the
+* provider.
+*/
+VOID NTAPI VmmTrace_EtwEnableCallback(
+    _In_ LPCGUID SourceId,
+    _In_ ULONG IsEnabled,
+    _In_ UCHAR Level,
+    _In_ ULONGLONG MatchAnyKeyword,
+    _In_ ULONGLONG MatchAllKeyword,
+    _In_opt_ PEVENT_FILTER_DESCRIPTOR FilterData,
+    _Inout_opt_ PVOID CallbackContext)
+{
+    if(IsEnabled) {
+        InterlockedOr(&g_VmmTraceEnabled, VMMTRACE_ENABLED_ETW);
+    } else {
+        InterlockedAnd(&g_VmmTraceEnabled, ~VMMTRACE_ENABLED_ETW);
+    }
+}
+
+VOID VmmTrace_Initialize()
+{
+    if(g_VmmTrace.fRegistered) { return; }
+    QueryPerformanceFrequency((PLARGE_INTEGER)&g_VmmTrace.qwFreq);
+    QueryPerformanceCounter((PLARGE_INTEGER)&g_VmmTrace.tmInitialize);
+    g_VmmTrace.fRegistered = SUCCEEDED(TraceLoggingRegisterEx(g_hVmmTraceProvider, VmmTrace_EtwEnableCallback, NULL));
+}
+
+VOID VmmTrace_Close()
+{
+    InterlockedExchange(&g_VmmTraceEnabled, 0);
+    if(g_VmmTrace.fRegistered) {
+        TraceLoggingUnregister(g_hVmmTraceProvider);
+        g_VmmTrace.fRegistered = FALSE;
+    }
+    LocalFree(g_VmmTrace.pRing);
+    g_VmmTrace.pRing = NULL;
+    g_VmmTrace.iRing = 0;
+}
+
+VOID VmmTrace_RingSetEnabled(_In_ BOOL fEnable)
+{
+    PVMMTRACE_RING_ENTRY pRing;
+    if(!fEnable) {
+        // ring buffer memory is kept until close since concurrent writers may
+        // still be active - it's re-used if the ring buffer is re-enabled.
+        InterlockedAnd(&g_VmmTraceEnabled, ~VMMTRACE_ENABLED_RING);
+        return;
+    }
+    if(!g_VmmTrace.pRing) {
+        if(!(pRing = LocalAlloc(LMEM_ZEROINIT, VMMTRACE_RING_ENTRIES * sizeof(VMMTRACE_RING_ENTRY)))) { return; }
+        if(InterlockedCompareExchangePointer(&g_VmmTrace.pRing, pRing, NULL)) {
+            LocalFree(pRing);
+        }
+    }
+    InterlockedOr(&g_VmmTraceEnabled, VMMTRACE_ENABLED_RING);
+}
+
+BOOL VmmTrace_RingGetEnabled()
+{
+    return (g_VmmTraceEnabled & VMMTRACE_ENABLED_RING) ? TRUE : FALSE;
+}
+
+QWORD VmmTrace_Start()
+{
+    QWORD tm;
+    if(!g_VmmTraceEnabled) { return 0; }
+    QueryPerformanceCounter((PLARGE_INTEGER)&tm);
+    return tm;
+}
+
+#define VMMTRACE_ETW_WRITE(szEventName)                                     \
+    TraceLoggingWrite(g_hVmmTraceProvider, szEventName,                     \
+        TraceLoggingUInt32(dwPID, "PID"),                                   \
+        TraceLoggingHexUInt64(qw1, "Value1"),                               \
+        TraceLoggingHexUInt64(qw2, "Value2"),                               \
+        TraceLoggingUInt64(qwDurationUs, "DurationUs"))
+
+VOID VmmTrace_Event(_In_ DWORD tpEvent, _In_ DWORD dwPID, _In_ QWORD qw1, _In_ QWORD qw2, _In_opt_ QWORD tmStart)
+{
+    QWORD tmNow, qwDurationUs = 0;
+    PVMMTRACE_RING_ENTRY pe;
+    LONG fEnabled = g_VmmTraceEnabled;
+    if(!fEnabled || !tpEvent || (tpEvent > VMMTRACE_EVENT_MAX)) { return; }
+    QueryPerformanceCounter((PLARGE_INTEGER)&tmNow);
+    if(tmStart && (tmNow > tmStart)) {
+        qwDurationUs = ((tmNow - tmStart) * 1000000ULL) / g_VmmTrace.qwFreq;
+    }
+    if(fEnabled & VMMTRACE_ENABLED_ETW) {
+        switch(tpEvent) {
+            case VMMTRACE_EVENT_REFRESH_TICK:       VMMTRACE_ETW_WRITE("RefreshTick"); break;
+            case VMMTRACE_EVENT_CACHE_CLEAR:        VMMTRACE_ETW_WRITE("CacheClear"); break;
+            case VMMTRACE_EVENT_CACHE_RECLAIM:      VMMTRACE_ETW_WRITE("CacheReclaim"); break;
+            case VMMTRACE_EVENT_MASTERLOCK:         VMMTRACE_ETW_WRITE("MasterLock"); break;
+            case VMMTRACE_EVENT_MAP_BUILD:          VMMTRACE_ETW_WRITE("MapBuild"); break;
+            case VMMTRACE_EVENT_PDB_LOAD:           VMMTRACE_ETW_WRITE("PdbLoad"); break;
+            case VMMTRACE_EVENT_PAGED_READ:         VMMTRACE_ETW_WRITE("PagedRead"); break;
+            case VMMTRACE_EVENT_PAGED_READ_BATCH:   VMMTRACE_ETW_WRITE("PagedReadBatch"); break;
+        }
+    }
+    if((fEnabled & VMMTRACE_ENABLED_RING) && g_VmmTrace.pRing) {
+        pe = g_VmmTrace.pRing + ((InterlockedIncrement64(&g_VmmTrace.iRing) - 1) & (VMMTRACE_RING_ENTRIES - 1));
+        pe->tm = tmNow;
+        pe->tpEvent = tpEvent;
+        pe->dwPID = dwPID;
+        pe->dwTID = GetCurrentThreadId();
+        pe->qw1 = qw1;
+        pe->qw2 = qw2;
+        pe->qwDurationUs = qwDurationUs;
+    }
+}
+
+DWORD VmmTrace_RingToString(_Out_writes_opt_(cb) PBYTE pb, _In_ DWORD cb)
+{
+    int o = 0;
+    QWORD i, iStart, iEnd, tmUs;
+    PVMMTRACE_RING_ENTRY pe;
+    iEnd = g_VmmTrace.iRing;
+    iStart = (iEnd > VMMTRACE_RING_ENTRIES) ? (iEnd - VMMTRACE_RING_ENTRIES) : 0;
+    if(!pb) {
+        return g_VmmTrace.pRing ? (DWORD)(iEnd - iStart + 1) * VMMTRACE_RING_LINELENGTH : 0;
+    }
+    if(!g_VmmTrace.pRing || (cb < VMMTRACE_RING_LINELENGTH)) { return 0; }
+    o = snprintf((LPSTR)pb, cb, "%14s %6s %6s %-16s %16s %16s %11s\n", "TIME_US", "TID", "PID", "EVENT", "VALUE1", "VALUE2", "DURATION_US");
+    for(i = iStart; (i < iEnd) && (o > 0) && ((DWORD)o + VMMTRACE_RING_LINELENGTH < cb); i++) {
+        pe = g_VmmTrace.pRing + (i & (VMMTRACE_RING_ENTRIES - 1));
+        tmUs = (pe->tm > g_VmmTrace.tmInitialize) ? (((pe->tm - g_VmmTrace.tmInitialize) * 1000000ULL) / g_VmmTrace.qwFreq) : 0;
+        o += snprintf((LPSTR)pb + o, cb - o, "%14llu %6i %6i %-16.16s %16llx %16llx %11llu\n",
+            tmUs,
+            pe->dwTID,
+            pe->dwPID,
+            VMMTRACE_EVENT_NAMES[min(pe->tpEvent, VMMTRACE_EVENT_MAX)],
+            pe->qw1,
+            pe->qw2,
+            pe->qwDurationUs
+        );
+    }
+    return (o > 0) ? min((DWORD)o, cb) : 0;
+}
@@ -0,0 +1,102 @@
+// vmmtrace.h : declarations of low-overhead trace events of VMM hot paths.
+//
+// Trace events are emitted as ETW TraceLogging events by the provider
+// 'MemProcFS.Vmm' {8f0c51a4-2b7e-4c55-9d0a-6e3b1f7d2c91} whenever an ETW
+// session (i.e. WPR/WPA, xperf, tracelog) has enabled the provider. As an
+// alternative to ETW the events may be recorded into an in-memory ring buffer
+// readable through the .status/trace file. If neither is enabled the cost of
+// a trace point is a single memory read - trace points must be guarded by the
+// inline VMMTRACE_IS_ENABLED() check (or a non-zero start time stamp) so that
+// no function call is made while tracing is disabled.
+//
+// (c) Ulf Frisk, 2019
+// Author: Ulf Frisk, pcileech@frizk.net
+//
+#ifndef __VMMTRACE_H__
+#define __VMMTRACE_H__
+#include "vmm.h"
+
+#define VMMTRACE_EVENT_REFRESH_TICK         0x01    // qw1 = VMMTRACE_REFRESH_* flags
+#define VMMTRACE_EVENT_CACHE_CLEAR          0x02    // qw1 = cache tag
+#define VMMTRACE_EVENT_CACHE_RECLAIM        0x03    // qw1 = cache tag, qw2 = cache region
+#define VMMTRACE_EVENT_MASTERLOCK           0x04    // qw1 = VMMTRACE_MASTERLOCK_* lock holder, duration = process refresh lock hold time
+#define VMMTRACE_EVENT_MAP_BUILD            0x05    // qw1 = VMMTRACE_MAP_* map type, qw2 = success
+#define VMMTRACE_EVENT_PDB_LOAD             0x06    // qw1 = pdb module base, qw2 = success
+#define VMMTRACE_EVENT_PAGED_READ           0x07    // qw1 = va, qw2 = VMMTRACE_PAGED_* resolution
+#define VMMTRACE_EVENT_PAGED_READ_BATCH     0x08    // qw1 = number of pages, qw2 = number of pages read
+#define VMMTRACE_EVENT_MAX                  0x08
+
+#define VMMTRACE_REFRESH_PHYS               0x01
+#define VMMTRACE_REFRESH_TLB                0x02
+#define VMMTRACE_REFRESH_PROC_PARTIAL       0x04
+#define VMMTRACE_REFRESH_PROC_TOTAL         0x08
+#define VMMTRACE_REFRESH_REGISTRY           0x10
+
+#define VMMTRACE_MASTERLOCK_REFRESH_TICK    0x01
+#define VMMTRACE_MASTERLOCK_REFRESH_FORCE   0x02
+
+#define VMMTRACE_MAP_PTE                    0x01
+#define VMMTRACE_MAP_VAD                    0x02
+#define VMMTRACE_MAP_MODULE                 0x03
+#define VMMTRACE_MAP_HEAP                   0x04
+#define VMMTRACE_MAP_THREAD                 0x05
+#define VMMTRACE_MAP_HANDLE                 0x06
+
+#define VMMTRACE_PAGED_FAIL                 0x00    // page could not be resolved
+#define VMMTRACE_PAGED_DATA                 0x01    // page data read (demand zero, page file, compressed)
+#define VMMTRACE_PAGED_PHYS                 0x02    // page resolved to physical address (prototype, transition, vad)
+
+#define VMMTRACE_ENABLED_ETW                0x01
+#define VMMTRACE_ENABLED_RING               0x02
+
+extern volatile LONG g_VmmTraceEnabled;
+
+#define VMMTRACE_IS_ENABLED()               (g_VmmTraceEnabled != 0)
+
+/*
+* Register the ETW trace provider. Should be called once on initialization.
+*/
+VOID VmmTrace_Initialize();
+
+/*
+* Unregister the ETW trace provider and free the ring buffer (if allocated).
+*/
+VOID VmmTrace_Close();
+
+/*
+* Enable or disable recording of trace events into the in-memory ring buffer.
+* -- fEnable
+*/
+VOID VmmTrace_RingSetEnabled(_In_ BOOL fEnable);
+BOOL VmmTrace_RingGetEnabled();
+
+/*
+* Retrieve a start time stamp for an event with duration. Callers should only
+* call this function if VMMTRACE_IS_ENABLED().
+* -- return = start time stamp or zero if tracing is disabled.
+*/
+QWORD VmmTrace_Start();
+
+/*
+* Emit a trace event. If tmStart is non-zero the duration is calculated as
+* the time elapsed since tmStart. If tracing is disabled nothing happens.
+* Callers should only call this function if VMMTRACE_IS_ENABLED() or, for an
+* event with duration, if tmStart is non-zero.
+* -- tpEvent = VMMTRACE_EVENT_*
+* -- dwPID
+* -- qw1 = event specific value.
+* -- qw2 = event specific value.
+* -- tmStart = optional start time stamp retrieved by VmmTrace_Start.
+*/
+VOID VmmTrace_Event(_In_ DWORD tpEvent, _In_ DWORD dwPID, _In_ QWORD qw1, _In_ QWORD qw2, _In_opt_ QWORD tmStart);
+
+/*
+* Render the trace events in the ring buffer - oldest first - as text. All the
+* lines are of equal length.
+* -- pb = buffer to receive text, or NULL to retrieve the required size.
+* -- cb
+* -- return = the number of bytes written / required.
+*/
+DWORD VmmTrace_RingToString(_Out_writes_opt_(cb) PBYTE pb, _In_ DWORD cb);
+
+#endif /* __VMMTRACE_H__ */
@@ -18,6 +18,67 @@ typedef struct tdVMMVFS_PATH {
     LPWSTR wszPath2;
 } VMMVFS_PATH, *PVMMVFS_PATH;
 
+#define VMMVFS_PATH_CACHE_MAX       0x4000
+
+#define VMMVFS_PATH_TP_INVALID      0
+#define VMMVFS_PATH_TP_PROCESS      1       // \pid\.. or \name\..
+#define VMMVFS_PATH_TP_DUMP         2       // \memory.*
+#define VMMVFS_PATH_TP_MODULE       3       // root module
+
+// built-in process directory files
+#define VMMVFS_FILE_NA              0
+#define VMMVFS_FILE_VMEM            1
+#define VMMVFS_FILE_DTB             2
+#define VMMVFS_FILE_DTB_USER        3
+#define VMMVFS_FILE_PID             4
+#define VMMVFS_FILE_PPID            5
+#define VMMVFS_FILE_STATE           6
+#define VMMVFS_FILE_NAME            7
+#define VMMVFS_FILE_NAME_LONG       8
+#define VMMVFS_FILE_WIN_CMDLINE     9
+#define VMMVFS_FILE_WIN_PATH        10
+#define VMMVFS_FILE_WIN_KPATH       11
+#define VMMVFS_FILE_WIN_EPROCESS    12
+#define VMMVFS_FILE_WIN_PEB         13
+#define VMMVFS_FILE_WIN_PEB32       14
+
+static const struct {
+    LPCWSTR wsz;
+    DWORD tp;
+} VMMVFS_FILE_NAMES[] = {
+    { L"vmem", VMMVFS_FILE_VMEM },
+    { L"dtb", VMMVFS_FILE_DTB },
+    { L"dtb-user", VMMVFS_FILE_DTB_USER },
+    { L"pid", VMMVFS_FILE_PID },
+    { L"ppid", VMMVFS_FILE_PPID },
+    { L"state", VMMVFS_FILE_STATE },
+    { L"name", VMMVFS_FILE_NAME },
+    { L"name-long", VMMVFS_FILE_NAME_LONG },
+    { L"win-cmdline", VMMVFS_FILE_WIN_CMDLINE },
+    { L"win-path", VMMVFS_FILE_WIN_PATH },
+    { L"win-kpath", VMMVFS_FILE_WIN_KPATH },
+    { L"win-eprocess", VMMVFS_FILE_WIN_EPROCESS },
+    { L"win-peb", VMMVFS_FILE_WIN_PEB },
+    { L"win-peb32", VMMVFS_FILE_WIN_PEB32 },
+};
+
+/*
+* A resolved vfs path. Paths are resolved once into the path type, the process
+* PID (if any), the built-in process file (if any) and the plugin module handle
+* and plugin sub-path. Resolved paths are cached by path hash so that repeated
+* operations on the same path skip the path parsing and module name lookup.
+*/
+typedef struct tdOB_VMMVFS_PATH {
+    OB ObHdr;
+    DWORD tp;
+    DWORD tpFile;                   // VMMVFS_FILE_* (VMMVFS_PATH_TP_PROCESS only)
+    PVOID hModule;                  // plugin module handle (if any)
+    LPWSTR wszModulePath;           // plugin sub-path (if any)
+    VMMVFS_PATH Path;               // parsed path (VMMVFS_PATH_TP_PROCESS only)
+    WCHAR wszModule[32];
+    WCHAR wszFullPath[MAX_PATH];
+} OB_VMMVFS_PATH, *POB_VMMVFS_PATH;
+
 BOOL VmmVfs_UtilVmmGetPidDirFile(_In_ LPCWSTR wcsFileName, _Out_ PVMMVFS_PATH pPath)
 {
     DWORD i = 0, iPID, iPath1 = 0, iPath2 = 0;
@@ -55,6 +116,58 @@ BOOL VmmVfs_UtilVmmGetPidDirFile(_In_ LPCWSTR wcsFileName, _Out_ PVMMVFS_PATH pP
     return TRUE;
 }
 
+/*
+* Resolve a vfs path - either from the resolved path cache or by parsing it.
+* CALLER DECREF: return
+* -- wcsPath
+* -- return
+*/
+POB_VMMVFS_PATH VmmVfs_PathResolve(_In_ LPCWSTR wcsPath)
+{
+    DWORD i, cch;
+    QWORD qwKey;
+    POB_VMMVFS_PATH pObPath;
+    cch = (DWORD)wcsnlen(wcsPath, MAX_PATH);
+    qwKey = ((QWORD)cch << 32) | Util_HashStringUpperW(wcsPath);
+    // 1: fetch from cache
+    if((cch < MAX_PATH) && (pObPath = ObMap_GetByKey(ctxVmm->pmObVfsPath, qwKey))) {
+        if(!_wcsicmp(pObPath->wszFullPath, wcsPath)) { return pObPath; }
+        Ob_DECREF_NULL(&pObPath);
+    }
+    // 2: resolve path
+    if(!(pObPath = Ob_Alloc(OB_TAG_VMMVFS_PATH, LMEM_ZEROINIT, sizeof(OB_VMMVFS_PATH), NULL, NULL))) { return NULL; }
+    wcsncpy_s(pObPath->wszFullPath, MAX_PATH, wcsPath, _TRUNCATE);
+    if(!_wcsnicmp(wcsPath, L"\\name", 5) || !_wcsnicmp(wcsPath, L"\\pid", 4)) {
+        if(VmmVfs_UtilVmmGetPidDirFile(wcsPath, &pObPath->Path)) {
+            pObPath->tp = VMMVFS_PATH_TP_PROCESS;
+            if(pObPath->Path.wszPath1) {
+                for(i = 0; i < sizeof(VMMVFS_FILE_NAMES) / sizeof(VMMVFS_FILE_NAMES[0]); i++) {
+                    if(!_wcsicmp(pObPath->Path.wszPath1, VMMVFS_FILE_NAMES[i].wsz)) {
+                        pObPath->tpFile = VMMVFS_FILE_NAMES[i].tp;
+                        break;
+                    }
+                }
+                pObPath->hModule = PluginManager_ModuleGet(TRUE, pObPath->Path.wszPath1);
+                pObPath->wszModulePath = pObPath->Path.wszPath2;
+            }
+        }
+    } else if(!_wcsnicmp(wcsPath, L"\\memory.", 8)) {
+        pObPath->tp = VMMVFS_PATH_TP_DUMP;
+    } else if(wcsPath[0]) {
+        pObPath->tp = VMMVFS_PATH_TP_MODULE;
+        pObPath->wszModulePath = Util_PathSplit2_ExWCHAR(pObPath->wszFullPath + 1, pObPath->wszModule, _countof(pObPath->wszModule));
+        pObPath->hModule = PluginManager_ModuleGet(FALSE, pObPath->wszModule);
+    }
+    // 3: store in cache (cache is cleared when full)
+    if(cch < MAX_PATH) {
+        if(ObMap_Size(ctxVmm->pmObVfsPath) >= VMMVFS_PATH_CACHE_MAX) {
+            ObMap_Clear(ctxVmm->pmObVfsPath);
+        }
+        ObMap_Push(ctxVmm->pmObVfsPath, qwKey, pObPath);
+    }
+    return pObPath;
+}
+
 /*
 * Set file timestamp into the ExInfo struct if possible.
 * -- pProcess
@@ -75,173 +188,163 @@ VOID VmmVfs_UtilTimeStampFile(_In_opt_ PVMM_PROCESS pProcess, _Out_ PVMMDLL_VFS_
 // FUNCTIONALITY RELATED TO: READ
 // ----------------------------------------------------------------------------
 
-NTSTATUS VmmVfsReadFileProcess(_In_ PVMM_PROCESS pProcess, _In_ PVMMVFS_PATH pPath, _Out_writes_(cb) PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbRead, _In_ QWORD cbOffset)
+NTSTATUS VmmVfsReadFileProcess(_In_ PVMM_PROCESS pProcess, _In_ POB_VMMVFS_PATH pPath, _Out_writes_(cb) PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbRead, _In_ QWORD cbOffset)
 {
     QWORD cbMemSize;
     DWORD cbBuffer;
     BYTE pbBuffer[0x800];
+    BOOL fWin = (ctxVmm->tpSystem == VMM_SYSTEM_WINDOWS_X64) || (ctxVmm->tpSystem == VMM_SYSTEM_WINDOWS_X86);
+    BOOL f32 = (ctxVmm->tpMemoryModel == VMM_MEMORYMODEL_X86) || (ctxVmm->tpMemoryModel == VMM_MEMORYMODEL_X86PAE);
     ZeroMemory(pbBuffer, 48);
-    // read memory from "vmem" file
-    if(!_wcsicmp(pPath->wszPath1, L"vmem")) {
-        cbMemSize = (ctxVmm->tpMemoryModel == VMM_MEMORYMODEL_X64) ? 1ULL << 48 : 1ULL << 32;
-        return VmmReadAsFile(pProcess, 0, cbMemSize, pb, cb, pcbRead, cbOffset);
-    }
-    // read genereal numeric values from files, pml4, pid, name, virt
-    if(!_wcsicmp(pPath->wszPath1, L"dtb")) {
-        if(ctxVmm->tpMemoryModel == VMM_MEMORYMODEL_X64) {
-            return Util_VfsReadFile_FromQWORD(pProcess->paDTB, pb, cb, pcbRead, cbOffset, FALSE);
-        } else if((ctxVmm->tpMemoryModel == VMM_MEMORYMODEL_X86) || (ctxVmm->tpMemoryModel == VMM_MEMORYMODEL_X86PAE)) {
-            return Util_VfsReadFile_FromDWORD((DWORD)pProcess->paDTB, pb, cb, pcbRead, cbOffset, FALSE);
-        }
-    }
-    if(!_wcsicmp(pPath->wszPath1, L"dtb-user")) {
-        if(ctxVmm->tpMemoryModel == VMM_MEMORYMODEL_X64) {
-            return Util_VfsReadFile_FromQWORD(pProcess->paDTB_UserOpt, pb, cb, pcbRead, cbOffset, FALSE);
-        } else if((ctxVmm->tpMemoryModel == VMM_MEMORYMODEL_X86) || (ctxVmm->tpMemoryModel == VMM_MEMORYMODEL_X86PAE)) {
-            return Util_VfsReadFile_FromDWORD((DWORD)pProcess->paDTB_UserOpt, pb, cb, pcbRead, cbOffset, FALSE);
-        }
-    }
-    if(!_wcsicmp(pPath->wszPath1, L"pid")) {
-        cbBuffer = snprintf(pbBuffer, 32, "%i", pProcess->dwPID);
-        return Util_VfsReadFile_FromPBYTE(pbBuffer, cbBuffer, pb, cb, pcbRead, cbOffset);
-    }
-    if(!_wcsicmp(pPath->wszPath1, L"ppid")) {
-        cbBuffer = snprintf(pbBuffer, 32, "%i", pProcess->dwPPID);
-        return Util_VfsReadFile_FromPBYTE(pbBuffer, cbBuffer, pb, cb, pcbRead, cbOffset);
-    }
-    if(!_wcsicmp(pPath->wszPath1, L"state")) {
-        cbBuffer = snprintf(pbBuffer, 32, "%i", pProcess->dwState);
-        return Util_VfsReadFile_FromPBYTE(pbBuffer, cbBuffer, pb, cb, pcbRead, cbOffset);
-    }
-    if(!_wcsicmp(pPath->wszPath1, L"name")) {
-        cbBuffer = snprintf(pbBuffer, 32, "%s", pProcess->szName);
-        return Util_VfsReadFile_FromPBYTE(pbBuffer, cbBuffer, pb, cb, pcbRead, cbOffset);
-    }
-    // windows specific reads below:
-    if((ctxVmm->tpSystem == VMM_SYSTEM_WINDOWS_X64) || (ctxVmm->tpSystem == VMM_SYSTEM_WINDOWS_X86)) {
-        if(!_wcsicmp(pPath->wszPath1, L"name-long")) {
+    switch(pPath->tpFile) {
+        case VMMVFS_FILE_VMEM:
+            // read memory from "vmem" file
+            cbMemSize = (ctxVmm->tpMemoryModel == VMM_MEMORYMODEL_X64) ? 1ULL << 48 : 1ULL << 32;
+            return VmmReadAsFile(pProcess, 0, cbMemSize, pb, cb, pcbRead, cbOffset);
+        // read genereal numeric values from files, pml4, pid, name, virt
+        case VMMVFS_FILE_DTB:
+            if(ctxVmm->tpMemoryModel == VMM_MEMORYMODEL_X64) {
+                return Util_VfsReadFile_FromQWORD(pProcess->paDTB, pb, cb, pcbRead, cbOffset, FALSE);
+            } else if(f32) {
+                return Util_VfsReadFile_FromDWORD((DWORD)pProcess->paDTB, pb, cb, pcbRead, cbOffset, FALSE);
+            }
+            break;
+        case VMMVFS_FILE_DTB_USER:
+            if(ctxVmm->tpMemoryModel == VMM_MEMORYMODEL_X64) {
+                return Util_VfsReadFile_FromQWORD(pProcess->paDTB_UserOpt, pb, cb, pcbRead, cbOffset, FALSE);
+            } else if(f32) {
+                return Util_VfsReadFile_FromDWORD((DWORD)pProcess->paDTB_UserOpt, pb, cb, pcbRead, cbOffset, FALSE);
+            }
+            break;
+        case VMMVFS_FILE_PID:
+            cbBuffer = snprintf(pbBuffer, 32, "%i", pProcess->dwPID);
+            return Util_VfsReadFile_FromPBYTE(pbBuffer, cbBuffer, pb, cb, pcbRead, cbOffset);
+        case VMMVFS_FILE_PPID:
+            cbBuffer = snprintf(pbBuffer, 32, "%i", pProcess->dwPPID);
+            return Util_VfsReadFile_FromPBYTE(pbBuffer, cbBuffer, pb, cb, pcbRead, cbOffset);
+        case VMMVFS_FILE_STATE:
+            cbBuffer = snprintf(pbBuffer, 32, "%i", pProcess->dwState);
+            return Util_VfsReadFile_FromPBYTE(pbBuffer, cbBuffer, pb, cb, pcbRead, cbOffset);
+        case VMMVFS_FILE_NAME:
+            cbBuffer = snprintf(pbBuffer, 32, "%s", pProcess->szName);
+            return Util_VfsReadFile_FromPBYTE(pbBuffer, cbBuffer, pb, cb, pcbRead, cbOffset);
+        // windows specific reads below:
+        case VMMVFS_FILE_NAME_LONG:
+            if(!fWin) { break; }
             return Util_VfsReadFile_FromPBYTE(pProcess->pObPersistent->szNameLong, pProcess->pObPersistent->cchNameLong, pb, cb, pcbRead, cbOffset);
-        }
-        if(!_wcsicmp(pPath->wszPath1, L"win-cmdline")) {
+        case VMMVFS_FILE_WIN_CMDLINE:
+            if(!fWin) { break; }
             return Util_VfsReadFile_FromPBYTE(pProcess->pObPersistent->UserProcessParams.szCommandLine, pProcess->pObPersistent->UserProcessParams.cchCommandLine, pb, cb, pcbRead, cbOffset);
-        }
-        if(!_wcsicmp(pPath->wszPath1, L"win-path")) {
+        case VMMVFS_FILE_WIN_PATH:
+            if(!fWin) { break; }
             return Util_VfsReadFile_FromPBYTE(pProcess->pObPersistent->szPathKernel, pProcess->pObPersistent->cchPathKernel, pb, cb, pcbRead, cbOffset);
-        }
-    }
-    if(ctxVmm->tpSystem == VMM_SYSTEM_WINDOWS_X64) {
-        if(!_wcsicmp(pPath->wszPath1, L"win-eprocess")) {
-            return Util_VfsReadFile_FromQWORD(pProcess->win.EPROCESS.va, pb, cb, pcbRead, cbOffset, FALSE);
-        }
-        if(!_wcsicmp(pPath->wszPath1, L"win-peb")) {
-            return Util_VfsReadFile_FromQWORD(pProcess->win.vaPEB, pb, cb, pcbRead, cbOffset, FALSE);
-        }
-        if(!_wcsicmp(pPath->wszPath1, L"win-peb32")) {
+        case VMMVFS_FILE_WIN_EPROCESS:
+            if(ctxVmm->tpSystem == VMM_SYSTEM_WINDOWS_X64) {
+                return Util_VfsReadFile_FromQWORD(pProcess->win.EPROCESS.va, pb, cb, pcbRead, cbOffset, FALSE);
+            } else if(ctxVmm->tpSystem == VMM_SYSTEM_WINDOWS_X86) {
+                return Util_VfsReadFile_FromDWORD((DWORD)pProcess->win.EPROCESS.va, pb, cb, pcbRead, cbOffset, FALSE);
+            }
+            break;
+        case VMMVFS_FILE_WIN_PEB:
+            if(ctxVmm->tpSystem == VMM_SYSTEM_WINDOWS_X64) {
+                return Util_VfsReadFile_FromQWORD(pProcess->win.vaPEB, pb, cb, pcbRead, cbOffset, FALSE);
+            } else if(ctxVmm->tpSystem == VMM_SYSTEM_WINDOWS_X86) {
+                return Util_VfsReadFile_FromDWORD((DWORD)pProcess->win.vaPEB, pb, cb, pcbRead, cbOffset, FALSE);
+            }
+            break;
+        case VMMVFS_FILE_WIN_PEB32:
+            if(ctxVmm->tpSystem != VMM_SYSTEM_WINDOWS_X64) { break; }
             return Util_VfsReadFile_FromDWORD(pProcess->win.vaPEB32, pb, cb, pcbRead, cbOffset, FALSE);
-        }
-    }
-    if(ctxVmm->tpSystem == VMM_SYSTEM_WINDOWS_X86) {
-        if(!_wcsicmp(pPath->wszPath1, L"win-eprocess")) {
-            return Util_VfsReadFile_FromDWORD((DWORD)pProcess->win.EPROCESS.va, pb, cb, pcbRead, cbOffset, FALSE);
-        }
-        if(!_wcsicmp(pPath->wszPath1, L"win-peb")) {
-            return Util_VfsReadFile_FromDWORD((DWORD)pProcess->win.vaPEB, pb, cb, pcbRead, cbOffset, FALSE);
-        }
     }
-    // no hit - call down the loadable modules chain for potential hits
-    return PluginManager_Read(pProcess, pPath->wszPath1, pPath->wszPath2, pb, cb, pcbRead, cbOffset);
+    // no hit - call down to the resolved module (if any)
+    return PluginManager_ReadModule(pPath->hModule, pProcess, pPath->wszModulePath, pb, cb, pcbRead, cbOffset);
 }
 
 NTSTATUS VmmVfs_Read(LPCWSTR wcsFileName, _Out_writes_(cb) PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbRead, _In_ QWORD cbOffset)
 {
     NTSTATUS nt = VMM_STATUS_FILE_INVALID;
-    VMMVFS_PATH path;
-    WCHAR wszModule[32];
-    LPWSTR wszModulePath;
+    POB_VMMVFS_PATH pObPath;
     PVMM_PROCESS pObProcess;
-    if(!ctxVmm) { return nt; }
-    // read files in process directories:
-    if(!_wcsnicmp(wcsFileName, L"\\name", 5) || !_wcsnicmp(wcsFileName, L"\\pid", 4)) {
-        if(!VmmVfs_UtilVmmGetPidDirFile(wcsFileName, &path)) { return nt; }
-        pObProcess = VmmProcessGet(path.dwPID);
-        if(!pObProcess) { return VMM_STATUS_FILE_INVALID; }
-        nt = VmmVfsReadFileProcess(pObProcess, &path, pb, cb, pcbRead, cbOffset);
-        Ob_DECREF(pObProcess);
-        return nt;
+    if(!ctxVmm || !(pObPath = VmmVfs_PathResolve(wcsFileName))) { return nt; }
+    switch(pObPath->tp) {
+        case VMMVFS_PATH_TP_PROCESS:
+            // read files in process directories:
+            if(!pObPath->Path.wszPath1 || !(pObProcess = VmmProcessGet(pObPath->Path.dwPID))) { break; }
+            nt = VmmVfsReadFileProcess(pObProcess, pObPath, pb, cb, pcbRead, cbOffset);
+            Ob_DECREF(pObProcess);
+            break;
+        case VMMVFS_PATH_TP_DUMP:
+            // read '\\memory.pmem'/'\\memory.dmp' - physical memory file:
+            nt = MVmmVfsDump_Read(wcsFileName, pb, cb, pcbRead, cbOffset);
+            break;
+        case VMMVFS_PATH_TP_MODULE:
+            // read files in any non-process modules directories
+            nt = PluginManager_ReadModule(pObPath->hModule, NULL, pObPath->wszModulePath, pb, cb, pcbRead, cbOffset);
+            break;
     }
-    // read '\\memory.pmem'/'\\memory.dmp' - physical memory file:
-    if(!_wcsnicmp(wcsFileName, L"\\memory.", 8)) {
-        return MVmmVfsDump_Read(wcsFileName, pb, cb, pcbRead, cbOffset);
-    }
-    // list files in any non-process modules directories
-    wszModulePath = Util_PathSplit2_ExWCHAR((LPWSTR)(wcsFileName + 1), wszModule, _countof(wszModule));
-    return PluginManager_Read(NULL, wszModule, wszModulePath, pb, cb, pcbRead, cbOffset);
+    Ob_DECREF(pObPath);
+    return nt;
 }
 
 // ----------------------------------------------------------------------------
 // FUNCTIONALITY RELATED TO: WRITE
 // ----------------------------------------------------------------------------
 
-NTSTATUS VmmVfsWriteFileProcess(_In_ PVMM_PROCESS pProcess, _In_ PVMMVFS_PATH pPath, _In_ LPVOID pb, _In_ DWORD cb, _Out_ PDWORD pcbWrite, _In_ QWORD cbOffset)
+NTSTATUS VmmVfsWriteFileProcess(_In_ PVMM_PROCESS pProcess, _In_ POB_VMMVFS_PATH pPath, _In_ LPVOID pb, _In_ DWORD cb, _Out_ PDWORD pcbWrite, _In_ QWORD cbOffset)
 {
-    BOOL fFound;
     QWORD cbMemSize;
-    // read only files - report zero bytes written
-    fFound =
-        !_wcsicmp(pPath->wszPath1, L"dtb") ||
-        !_wcsicmp(pPath->wszPath1, L"name") ||
-        !_wcsicmp(pPath->wszPath1, L"pid") ||
-        !_wcsicmp(pPath->wszPath1, L"ppid") ||
-        !_wcsicmp(pPath->wszPath1, L"state");
-    if(fFound) {
-        *pcbWrite = 0;
-        return VMM_STATUS_SUCCESS;
-    }
-    // windows specific writes below:
-    if((ctxVmm->tpSystem == VMM_SYSTEM_WINDOWS_X64) || (ctxVmm->tpSystem == VMM_SYSTEM_WINDOWS_X86)) {
-        fFound =
-            !_wcsicmp(pPath->wszPath1, L"name-long") ||
-            !_wcsicmp(pPath->wszPath1, L"win-cmdline") ||
-            !_wcsicmp(pPath->wszPath1, L"win-eprocess") ||
-            !_wcsicmp(pPath->wszPath1, L"win-kpath") ||
-            !_wcsicmp(pPath->wszPath1, L"win-peb");
-        if(fFound) {
+    BOOL fWin = (ctxVmm->tpSystem == VMM_SYSTEM_WINDOWS_X64) || (ctxVmm->tpSystem == VMM_SYSTEM_WINDOWS_X86);
+    switch(pPath->tpFile) {
+        // read only files - report zero bytes written
+        case VMMVFS_FILE_DTB:
+        case VMMVFS_FILE_NAME:
+        case VMMVFS_FILE_PID:
+        case VMMVFS_FILE_PPID:
+        case VMMVFS_FILE_STATE:
             *pcbWrite = 0;
             return VMM_STATUS_SUCCESS;
-        }
-    }
-    // write memory to "vmem" file
-    if(!_wcsicmp(pPath->wszPath1, L"vmem")) {
-        cbMemSize = (ctxVmm->tpMemoryModel == VMM_MEMORYMODEL_X64) ? 1ULL << 48 : 1ULL << 32;
-        return VmmWriteAsFile(pProcess, 0, cbMemSize, pb, cb, pcbWrite, cbOffset);
+        // windows specific read only files below:
+        case VMMVFS_FILE_NAME_LONG:
+        case VMMVFS_FILE_WIN_CMDLINE:
+        case VMMVFS_FILE_WIN_EPROCESS:
+        case VMMVFS_FILE_WIN_KPATH:
+        case VMMVFS_FILE_WIN_PEB:
+            if(!fWin) { break; }
+            *pcbWrite = 0;
+            return VMM_STATUS_SUCCESS;
+        case VMMVFS_FILE_VMEM:
+            // write memory to "vmem" file
+            cbMemSize = (ctxVmm->tpMemoryModel == VMM_MEMORYMODEL_X64) ? 1ULL << 48 : 1ULL << 32;
+            return VmmWriteAsFile(pProcess, 0, cbMemSize, pb, cb, pcbWrite, cbOffset);
     }
-    // no hit - call down the loadable modules chain for potential hits
-    return PluginManager_Write(pProcess, pPath->wszPath1, pPath->wszPath2, pb, cb, pcbWrite, cbOffset);
+    // no hit - call down to the resolved module (if any)
+    return PluginManager_WriteModule(pPath->hModule, pProcess, pPath->wszModulePath, pb, cb, pcbWrite, cbOffset);
 }
 
 NTSTATUS VmmVfs_Write(_In_ LPCWSTR wcsFileName, _In_reads_(cb) PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbWrite, _In_ QWORD cbOffset)
 {
     NTSTATUS nt = VMM_STATUS_FILE_INVALID;
-    VMMVFS_PATH path;
+    POB_VMMVFS_PATH pObPath;
     PVMM_PROCESS pObProcess;
-    WCHAR wszModule[32];
-    LPWSTR wszModulePath;
-    if(!ctxVmm) { return nt; }
-    // read files in process directories:
-    if(!_wcsnicmp(wcsFileName, L"\\name", 5) || !_wcsnicmp(wcsFileName, L"\\pid", 4)) {
-        if(!VmmVfs_UtilVmmGetPidDirFile(wcsFileName, &path) || !path.wszPath1) { return nt; }
-        pObProcess = VmmProcessGet(path.dwPID);
-        if(!pObProcess) { return VMM_STATUS_FILE_INVALID; }
-        nt = VmmVfsWriteFileProcess(pObProcess, &path, pb, cb, pcbWrite, cbOffset);
-        return nt;
-    }
-    // write '\\memory.pmem'/'\\memory.dmp' - physical memory file:
-    if(!_wcsnicmp(wcsFileName, L"\\memory.", 8)) {
-        return MVmmVfsDump_Write(wcsFileName, pb, cb, pcbWrite, cbOffset);
+    if(!ctxVmm || !(pObPath = VmmVfs_PathResolve(wcsFileName))) { return nt; }
+    switch(pObPath->tp) {
+        case VMMVFS_PATH_TP_PROCESS:
+            // write files in process directories:
+            if(!pObPath->Path.wszPath1 || !(pObProcess = VmmProcessGet(pObPath->Path.dwPID))) { break; }
+            nt = VmmVfsWriteFileProcess(pObProcess, pObPath, pb, cb, pcbWrite, cbOffset);
+            Ob_DECREF(pObProcess);
+            break;
+        case VMMVFS_PATH_TP_DUMP:
+            // write '\\memory.pmem'/'\\memory.dmp' - physical memory file:
+            nt = MVmmVfsDump_Write(wcsFileName, pb, cb, pcbWrite, cbOffset);
+            break;
+        case VMMVFS_PATH_TP_MODULE:
+            // write files in any non-process modules directories
+            nt = PluginManager_WriteModule(pObPath->hModule, NULL, pObPath->wszModulePath, pb, cb, pcbWrite, cbOffset);
+            break;
     }
-    // list files in any non-process modules directories
-    wszModulePath = Util_PathSplit2_ExWCHAR((LPWSTR)(wcsFileName + 1), wszModule, _countof(wszModule));
-    return PluginManager_Write(NULL, wszModule, wszModulePath, pb, cb, pcbWrite, cbOffset);
+    Ob_DECREF(pObPath);
+    return nt;
 }
 
 // ----------------------------------------------------------------------------
@@ -303,12 +406,12 @@ BOOL VmmVfsListFilesProcessRoot(_In_ PVMMVFS_PATH pPath, _Inout_ PHANDLE pFileLi
 }
 
 _Success_(return)
-BOOL VmmVfsListFilesProcess(_In_ PVMM_PROCESS pProcess, _In_ PVMMVFS_PATH pPath, _Inout_ PHANDLE pFileList)
+BOOL VmmVfsListFilesProcess(_In_ PVMM_PROCESS pProcess, _In_ POB_VMMVFS_PATH pObPath, _Inout_ PHANDLE pFileList)
 {
     VMMDLL_VFS_FILELIST_EXINFO ExInfo = { 0 };
     VmmVfs_UtilTimeStampFile(pProcess, &ExInfo);
     // populate process directory - list standard files and subdirectories
-    if(!pPath->wszPath1) {
+    if(!pObPath->Path.wszPath1) {
         VMMDLL_VfsList_AddFileEx(pFileList, "name", NULL, 16, &ExInfo);
         VMMDLL_VfsList_AddFileEx(pFileList, "pid", NULL, 10, &ExInfo);
         VMMDLL_VfsList_AddFileEx(pFileList, "ppid", NULL, 10, &ExInfo);
@@ -327,7 +430,7 @@ BOOL VmmVfsListFilesProcess(_In_ PVMM_PROCESS pProcess, _In_ PVMMVFS_PATH pPath,
         return TRUE;
     }
     // no hit - call down the loadable modules chain for potential hits
-    return PluginManager_List(pProcess, pPath->wszPath1, pPath->wszPath2, pFileList);
+    return PluginManager_ListModule(pObPath->hModule, pProcess, pObPath->wszModulePath, pFileList);
 }
 
 _Success_(return)
@@ -343,28 +446,31 @@ BOOL VmmVfsListFilesRoot(_Inout_ PHANDLE pFileList)
 BOOL VmmVfs_List(_In_ LPCWSTR wcsPath, _Inout_ PHANDLE pFileList)
 {
     BOOL result = FALSE;
-    VMMVFS_PATH path;
+    POB_VMMVFS_PATH pObPath;
     PVMM_PROCESS pObProcess;
-    WCHAR wszModule[32];
-    LPWSTR wszModulePath;
     if(!ctxVmm || !VMMDLL_VfsList_IsHandleValid(pFileList)) { return FALSE; }
     // list files in root directory
     if(!_wcsicmp(wcsPath, L"\\")) {
         return VmmVfsListFilesRoot(pFileList);
     }
-    // list files in name or pid directories:
-    if(!_wcsnicmp(wcsPath, L"\\name", 5) || !_wcsnicmp(wcsPath, L"\\pid", 4)) {
-        if(!VmmVfs_UtilVmmGetPidDirFile(wcsPath, &path)) { return FALSE; }
-        if(path.fRoot) {
-            return VmmVfsListFilesProcessRoot(&path, pFileList);
-        }
-        pObProcess = VmmProcessGet(path.dwPID);
-        if(!pObProcess) { return FALSE; }
-        result = VmmVfsListFilesProcess(pObProcess, &path, pFileList);
-        Ob_DECREF(pObProcess);
-        return result;
+    if(!(pObPath = VmmVfs_PathResolve(wcsPath))) { return FALSE; }
+    switch(pObPath->tp) {
+        case VMMVFS_PATH_TP_PROCESS:
+            // list files in name or pid directories:
+            if(pObPath->Path.fRoot) {
+                result = VmmVfsListFilesProcessRoot(&pObPath->Path, pFileList);
+                break;
+            }
+            if(!(pObProcess = VmmProcessGet(pObPath->Path.dwPID))) { break; }
+            result = VmmVfsListFilesProcess(pObProcess, pObPath, pFileList);
+            Ob_DECREF(pObProcess);
+            break;
+        case VMMVFS_PATH_TP_DUMP:
+        case VMMVFS_PATH_TP_MODULE:
+            // list files in any non-process modules directories
+            result = PluginManager_ListModule(pObPath->hModule, NULL, pObPath->wszModulePath, pFileList);
+            break;
     }
-    // list files in any non-process modules directories
-    wszModulePath = Util_PathSplit2_ExWCHAR((LPWSTR)(wcsPath + 1), wszModule, _countof(wszModule));
-    return PluginManager_List(NULL, wszModule, wszModulePath, pFileList);
+    Ob_DECREF(pObPath);
+    return result;
 }
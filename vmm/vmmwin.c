@@ -35,6 +35,80 @@ PIMAGE_NT_HEADERS VmmWin_GetVerifyHeaderPE(_In_ PVMM_PROCESS pProcess, _In_opt_
     return ntHeader;
 }
 
+// ----------------------------------------------------------------------------
+// WINDOWS SPECIFIC PROCESS RELATED FUNCTIONALITY BELOW:
+//    CROSS-PROCESS MODULE IMAGE CACHE
+// Shared modules such as ntdll.dll and kernel32.dll are mapped by the same
+// physical pages in all processes. Parsed image metadata that only depends on
+// the image itself (section/EAT/IAT counts, raw file size and the export table)
+// is cached globally keyed by the physical address of the module header page,
+// the TimeDateStamp and the SizeOfImage so it's only parsed once.
+// ----------------------------------------------------------------------------
+
+#define VMMWIN_MODULEIMAGE_CACHE_MAX        0x800
+
+typedef struct tdVMMWINOB_MODULE_IMAGE_EAT {
+    OB ObHdr;
+    DWORD cEATs;
+    VMMPROC_WINDOWS_EAT_ENTRY pEATs[];      // vaFunction not used - rebased on copy
+} VMMWINOB_MODULE_IMAGE_EAT, *PVMMWINOB_MODULE_IMAGE_EAT;
+
+typedef struct tdVMMWINOB_MODULE_IMAGE {
+    OB ObHdr;
+    QWORD paHeader;
+    DWORD dwTimeDateStamp;
+    DWORD cbImageSize;
+    volatile BOOL fSizes;                   // size members below are valid
+    DWORD cbFileSizeRaw;
+    DWORD cSections;
+    DWORD cEATs;
+    DWORD cIATs;
+    PVMMWINOB_MODULE_IMAGE_EAT volatile pObEAT;
+} VMMWINOB_MODULE_IMAGE, *PVMMWINOB_MODULE_IMAGE;
+
+VOID VmmWin_ModuleImage_CloseObCallback(_In_ PVOID pOb)
+{
+    Ob_DECREF(((PVMMWINOB_MODULE_IMAGE)pOb)->pObEAT);
+}
+
+/*
+* Retrieve the shared module image cache entry for an already read and verified
+* module header. The entry is created if it does not already exist.
+* CALLER DECREF: return
+* -- pProcess
+* -- vaModuleBase
+* -- ntHeader = verified nt header within the module header page.
+* -- return = the cache entry, or NULL on fail / caching disabled.
+*/
+PVMMWINOB_MODULE_IMAGE VmmWin_ModuleImage_Get(_In_ PVMM_PROCESS pProcess, _In_ QWORD vaModuleBase, _In_ PIMAGE_NT_HEADERS ntHeader)
+{
+    QWORD qwKey, paHeader;
+    DWORD dwTimeDateStamp, cbImageSize;
+    PVMMWINOB_MODULE_IMAGE pObImage;
+    if(!ctxVmm->pmObModuleImage || (ctxVmm->flags & VMM_FLAG_NOCACHE)) { return NULL; }
+    if(!VmmVirt2Phys(pProcess, vaModuleBase, &paHeader)) { return NULL; }
+    paHeader &= ~0xfff;
+    dwTimeDateStamp = ntHeader->FileHeader.TimeDateStamp;       // FileHeader & SizeOfImage offset same in both 32/64-bit
+    cbImageSize = ntHeader->OptionalHeader.SizeOfImage;
+    qwKey = (paHeader >> 12) ^ ((QWORD)dwTimeDateStamp << 32) ^ ((QWORD)cbImageSize << 8);
+    if((pObImage = ObMap_GetByKey(ctxVmm->pmObModuleImage, qwKey))) {
+        if((pObImage->paHeader == paHeader) && (pObImage->dwTimeDateStamp == dwTimeDateStamp) && (pObImage->cbImageSize == cbImageSize)) {
+            return pObImage;
+        }
+        Ob_DECREF_NULL(&pObImage);
+        Ob_DECREF(ObMap_RemoveByKey(ctxVmm->pmObModuleImage, qwKey));
+    }
+    if(!(pObImage = Ob_Alloc(OB_TAG_MOD_IMAGE, LMEM_ZEROINIT, sizeof(VMMWINOB_MODULE_IMAGE), VmmWin_ModuleImage_CloseObCallback, NULL))) { return NULL; }
+    pObImage->paHeader = paHeader;
+    pObImage->dwTimeDateStamp = dwTimeDateStamp;
+    pObImage->cbImageSize = cbImageSize;
+    if(ObMap_Size(ctxVmm->pmObModuleImage) >= VMMWIN_MODULEIMAGE_CACHE_MAX) {
+        ObMap_Clear(ctxVmm->pmObModuleImage);
+    }
+    ObMap_Push(ctxVmm->pmObModuleImage, qwKey, pObImage);      // if concurrent insertion fails - entry is used uncached.
+    return pObImage;
+}
+
 // ----------------------------------------------------------------------------
 // WINDOWS SPECIFIC PROCESS RELATED FUNCTIONALITY BELOW:
 //    IMPORT/EXPORT DIRECTORY PARSING
@@ -141,10 +215,23 @@ BOOL VmmWin_PE_LoadEAT_DisplayBuffer(_In_ PVMM_PROCESS pProcess, _In_ PVMM_MAP_M
     QWORD i, oNameOrdinal, ooName, oName, oFunction, wOrdinalFnIdx;
     DWORD vaFunctionOffset;
     BOOL fHdr32;
+    PVMMWINOB_MODULE_IMAGE pObImage = NULL;
+    PVMMWINOB_MODULE_IMAGE_EAT pObEAT = NULL;
     *pcEATs = 0;
     // load both 32/64 bit ntHeader (only one will be valid)
     if(!(ntHeader64 = VmmWin_GetVerifyHeaderPE(pProcess, pModule->vaBase, pbModuleHeader, &fHdr32))) { goto fail; }
     ntHeader32 = (PIMAGE_NT_HEADERS32)ntHeader64;
+    // use shared module image cache (if already parsed in any process)
+    if((pObImage = VmmWin_ModuleImage_Get(pProcess, pModule->vaBase, (PIMAGE_NT_HEADERS)ntHeader64)) && pObImage->pObEAT) {
+        pObEAT = pObImage->pObEAT;
+        for(i = 0; (i < pObEAT->cEATs) && (i < cEATs); i++) {
+            memcpy(pEATs + i, pObEAT->pEATs + i, sizeof(VMMPROC_WINDOWS_EAT_ENTRY));
+            pEATs[i].vaFunction = pModule->vaBase + pEATs[i].vaFunctionOffset;
+        }
+        *pcEATs = (DWORD)i;
+        Ob_DECREF(pObImage);
+        return TRUE;
+    }
     // Load Export Address Table (EAT)
     oExportDirectory = fHdr32 ?
         ntHeader32->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT].VirtualAddress :
@@ -177,9 +264,21 @@ BOOL VmmWin_PE_LoadEAT_DisplayBuffer(_In_ PVMM_PROCESS pProcess, _In_ PVMM_MAP_M
         strncpy_s(pEATs[i].szFunction, 40, (LPSTR)(pbExportDirectory - oExportDirectory + oName), _TRUNCATE);
     }
     *pcEATs = (DWORD)i;
+    // publish complete result to shared module image cache
+    if(pObImage && (i == pExportDirectory->NumberOfNames)) {
+        if((pObEAT = Ob_Alloc(OB_TAG_MOD_IMAGE_EAT, 0, sizeof(VMMWINOB_MODULE_IMAGE_EAT) + i * sizeof(VMMPROC_WINDOWS_EAT_ENTRY), NULL, NULL))) {
+            pObEAT->cEATs = (DWORD)i;
+            memcpy(pObEAT->pEATs, pEATs, i * sizeof(VMMPROC_WINDOWS_EAT_ENTRY));
+            if(InterlockedCompareExchangePointer(&pObImage->pObEAT, pObEAT, NULL)) {
+                Ob_DECREF(pObEAT);
+            }
+        }
+    }
+    Ob_DECREF(pObImage);
     LocalFree(pbExportDirectory);
     return TRUE;
 fail:
+    Ob_DECREF(pObImage);
     LocalFree(pbExportDirectory);
     return FALSE;
 }
@@ -268,6 +367,8 @@ VOID VmmWin_PE_SetSizeSectionIATEAT_DisplayBuffer(_In_ PVMM_PROCESS pProcess, _I
     BYTE pbModuleHeader[0x1000] = { 0 };
     PIMAGE_NT_HEADERS64 pNtHeaders64;
     BOOL fHdr32;
+    DWORD cbFileSizeRaw, cSections, cEATs, cIATs;
+    PVMMWINOB_MODULE_IMAGE pObImage;
     // check if function is required
     if(pModule->fLoadedEAT && pModule->fLoadedIAT) { return; }
     EnterCriticalSection(&pProcess->LockUpdate);
@@ -281,14 +382,35 @@ VOID VmmWin_PE_SetSizeSectionIATEAT_DisplayBuffer(_In_ PVMM_PROCESS pProcess, _I
         return;
     }
     // calculate display buffer size of: SECTIONS, EAT, IAT, RawFileSize
-    pModule->cbFileSizeRaw = PE_FileRaw_Size(pProcess, pModule->vaBase, pbModuleHeader);
-    pModule->cbDisplayBufferSections = PE_SectionGetNumberOfEx(pProcess, pModule->vaBase, pbModuleHeader) * 70;    // each display buffer human readable line == 70 bytes.
+    // (use the shared module image cache if already parsed in any process)
+    pObImage = VmmWin_ModuleImage_Get(pProcess, pModule->vaBase, (PIMAGE_NT_HEADERS)pNtHeaders64);
+    if(pObImage && pObImage->fSizes) {
+        cbFileSizeRaw = pObImage->cbFileSizeRaw;
+        cSections = pObImage->cSections;
+        cEATs = pObImage->cEATs;
+        cIATs = pObImage->cIATs;
+    } else {
+        cbFileSizeRaw = PE_FileRaw_Size(pProcess, pModule->vaBase, pbModuleHeader);
+        cSections = PE_SectionGetNumberOfEx(pProcess, pModule->vaBase, pbModuleHeader);
+        cEATs = PE_EatGetNumberOfEx(pProcess, pModule->vaBase, pbModuleHeader);
+        cIATs = PE_IatGetNumberOfEx(pProcess, pModule->vaBase, pbModuleHeader);
+        if(pObImage) {
+            pObImage->cbFileSizeRaw = cbFileSizeRaw;
+            pObImage->cSections = cSections;
+            pObImage->cEATs = cEATs;
+            pObImage->cIATs = cIATs;
+            InterlockedExchange((volatile LONG*)&pObImage->fSizes, TRUE);
+        }
+    }
+    Ob_DECREF(pObImage);
+    pModule->cbFileSizeRaw = cbFileSizeRaw;
+    pModule->cbDisplayBufferSections = cSections * 70;              // each display buffer human readable line == 70 bytes.
     if(!pModule->fLoadedEAT) {
-        pModule->cbDisplayBufferEAT = PE_EatGetNumberOfEx(pProcess, pModule->vaBase, pbModuleHeader) * 64;         // each display buffer human readable line == 64 bytes.
+        pModule->cbDisplayBufferEAT = cEATs * 64;                   // each display buffer human readable line == 64 bytes.
         pModule->fLoadedEAT = TRUE;
     }
     if(!pModule->fLoadedIAT) {
-        pModule->cbDisplayBufferIAT = PE_IatGetNumberOfEx(pProcess, pModule->vaBase, pbModuleHeader) * 128;        // each display buffer human readable line == 128 bytes.
+        pModule->cbDisplayBufferIAT = cIATs * 128;                  // each display buffer human readable line == 128 bytes.
         pModule->fLoadedIAT = TRUE;
     }
     LeaveCriticalSection(&pProcess->LockUpdate);
@@ -374,7 +496,6 @@ typedef struct tdVMMWIN_LDRMODULES_CONTEXT {
     DWORD cModules;
     DWORD cModulesMax;
     PVMM_MAP_MODULEENTRY pModules;
-    POB_VSET psVaName;
 } VMMWIN_LDRMODULES_CONTEXT, *PVMMWIN_LDRMODULES_CONTEXT;
 
 VOID VmmWin_InitializeLdrModules_VSetPutVA(_In_ POB_VSET pObVSet_vaAll, _In_ POB_VSET pObVSet_vaTry1, _In_ QWORD va)
@@ -451,7 +572,6 @@ VOID VmmWin_InitializeLdrModules64(_In_ PVMM_PROCESS pProcess, _In_ PVMMWIN_LDRM
         pModule->cwszText = min(MAX_PATH - 1, pLdrModule->BaseDllName.Length);
         ctx->cchNameTotal += max(12, 1 + pModule->cwszText);
         pModule->_Reserved1 = ((QWORD)pLdrModule->BaseDllName.Buffer) + pLdrModule->BaseDllName.Length - pModule->cwszText;
-        ObVSet_Push(ctx->psVaName, pModule->_Reserved1);
         ctx->cModules = ctx->cModules + 1;
         // add FLink/BLink lists
         if(pLdrModule->InLoadOrderModuleList.Flink && !((QWORD)pLdrModule->InLoadOrderModuleList.Flink & 0x7)) {
@@ -558,7 +678,6 @@ VOID VmmWin_InitializeLdrModules32(_In_ PVMM_PROCESS pProcess, _In_ PVMMWIN_LDRM
             pModule->cwszText = min(MAX_PATH - 1, pLdrModule32->BaseDllName.Length);
             ctx->cchNameTotal += max(12, 1 + pModule->cwszText);
             pModule->_Reserved1 = ((QWORD)pLdrModule32->BaseDllName.Buffer) + pLdrModule32->BaseDllName.Length - pModule->cwszText;
-            ObVSet_Push(ctx->psVaName, pModule->_Reserved1);
             ctx->cModules = ctx->cModules + 1;
         }
         // add FLink/BLink lists
@@ -598,15 +717,29 @@ VOID VmmWin_InitializeLdrModules_Name(_In_ PVMM_PROCESS pProcess, _In_ PVMMOB_MA
     QWORD i;
     DWORD cUnknown = 0, oText = 1;
     PVMM_MAP_MODULEENTRY pe;
+    PVMM_READPLAN_ENTRY pPlan = NULL;
+    LPWSTR wszNames = NULL;
     CHAR szBuffer[MAX_PATH] = { 0 };
-    WCHAR wszBuffer[MAX_PATH] = { 0 };
-    for(i = 0; i < pModuleMap->cMap; i++) {
-        pe = pModuleMap->pMap + i;
-        if(VmmRead2(pProcess, pe->_Reserved1, (PBYTE)wszBuffer, pe->cwszText << 1, VMM_FLAG_FORCECACHE_READ)) {
-            pe->wszText = pModuleMap->wszMultiText + oText;
-            pe->cwszText = Util_PathFileNameFixW(pModuleMap->wszMultiText + oText, wszBuffer, pe->cwszText);
-            oText += pe->cwszText + 1;
+    // read all module names in one read plan (one device round trip)
+    if(pModuleMap->cMap && (pPlan = LocalAlloc(LMEM_ZEROINIT, pModuleMap->cMap * (sizeof(VMM_READPLAN_ENTRY) + (MAX_PATH << 1))))) {
+        wszNames = (LPWSTR)(pPlan + pModuleMap->cMap);
+        for(i = 0; i < pModuleMap->cMap; i++) {
+            pe = pModuleMap->pMap + i;
+            pPlan[i].tp = VMM_READPLAN_TP_DATA;
+            pPlan[i].va = pe->_Reserved1;
+            pPlan[i].cb = min(pe->cwszText, MAX_PATH - 1) << 1;
+            pPlan[i].pb = (PBYTE)(wszNames + i * MAX_PATH);
         }
+        VmmReadPlan_Execute(pProcess, FALSE, 0, (DWORD)pModuleMap->cMap, pPlan);
+        for(i = 0; i < pModuleMap->cMap; i++) {
+            pe = pModuleMap->pMap + i;
+            if(pPlan[i].fResult) {
+                pe->wszText = pModuleMap->wszMultiText + oText;
+                pe->cwszText = Util_PathFileNameFixW(pModuleMap->wszMultiText + oText, wszNames + i * MAX_PATH, pe->cwszText);
+                oText += pe->cwszText + 1;
+            }
+        }
+        LocalFree(pPlan);
     }
     for(i = 0; i < pModuleMap->cMap; i++) {
         pe = pModuleMap->pMap + i;
@@ -632,6 +765,20 @@ VOID VmmWin_InitializeLdrModules_Name(_In_ PVMM_PROCESS pProcess, _In_ PVMMOB_MA
     }
 }
 
+/*
+* Mix a value into a running map content hash used to detect whether a rebuilt
+* map differs from its previous build (FNV-1a style over 64-bit values).
+* -- qwHash = previous hash, or VMMWIN_MAPHASH_SEED to start a new hash.
+* -- qw
+* -- return
+*/
+#define VMMWIN_MAPHASH_SEED         0xcbf29ce484222325
+
+inline QWORD VmmWin_MapHash(_In_ QWORD qwHash, _In_ QWORD qw)
+{
+    return (qwHash ^ qw) * 0x00000100000001b3;
+}
+
 int VmmWin_InitializeLdrModules_CmpSort(PDWORD pdw1, PDWORD pdw2)
 {
     return
@@ -639,6 +786,11 @@ int VmmWin_InitializeLdrModules_CmpSort(PDWORD pdw1, PDWORD pdw2)
         (*pdw1 > *pdw2) ? 1 : 0;
 }
 
+VOID VmmWin_InitializeLdrModules_CloseObCallback(_In_ PVOID pOb)
+{
+    Ob_DECREF(((PVMMOB_MAP_MODULE)pOb)->pmObExportIndex);
+}
+
 /*
 * Initialize the module map containing information about loaded modules in the
 * system. This is performed by a PEB/Ldr walk/scan of in-process memory
@@ -649,7 +801,8 @@ int VmmWin_InitializeLdrModules_CmpSort(PDWORD pdw1, PDWORD pdw2)
 _Success_(return)
 BOOL VmmWin_InitializeLdrModules(_In_ PVMM_PROCESS pProcess)
 {
-    DWORD cbObMap;
+    DWORD i, cbObMap;
+    QWORD qwHash;
     PVMMOB_MAP_MODULE pObMap = NULL;
     VMMWIN_LDRMODULES_CONTEXT ctx = { 0 };
     if(pProcess->Map.pObModule) { return TRUE; }
@@ -662,7 +815,6 @@ BOOL VmmWin_InitializeLdrModules(_In_ PVMM_PROCESS pProcess)
     // set up ctx
     ctx.cchNameTotal = 1;
     ctx.cModulesMax = VMMPROCWINDOWS_MAX_MODULES;
-    if(!(ctx.psVaName = ObVSet_New())) { goto fail; }
     if(!(ctx.pModules = (PVMM_MAP_MODULEENTRY)LocalAlloc(LMEM_ZEROINIT, VMMPROCWINDOWS_MAX_MODULES * sizeof(VMM_MAP_MODULEENTRY)))) { goto fail; }
     // fetch modules
     if(ctxVmm->tpSystem == VMM_SYSTEM_WINDOWS_X64) {
@@ -673,28 +825,33 @@ BOOL VmmWin_InitializeLdrModules(_In_ PVMM_PROCESS pProcess)
     }
     // set up module map object
     cbObMap = sizeof(VMMOB_MAP_MODULE) + ctx.cModules * (sizeof(VMM_MAP_MODULEENTRY) + sizeof(QWORD)) + ctx.cchNameTotal * sizeof(WCHAR);
-    if(!(pObMap = Ob_Alloc(OB_TAG_MAP_MODULE, LMEM_ZEROINIT, cbObMap, NULL, NULL))) { goto fail; }
+    if(!(pObMap = Ob_Alloc(OB_TAG_MAP_MODULE, LMEM_ZEROINIT, cbObMap, VmmWin_InitializeLdrModules_CloseObCallback, NULL))) { goto fail; }
     pObMap->pHashTableLookup = (PQWORD)(((PBYTE)pObMap) + sizeof(VMMOB_MAP_MODULE) + ctx.cModules * sizeof(VMM_MAP_MODULEENTRY));
     pObMap->wszMultiText = (LPWSTR)(((PBYTE)pObMap) + sizeof(VMMOB_MAP_MODULE) + ctx.cModules * (sizeof(VMM_MAP_MODULEENTRY) + sizeof(QWORD)));
     pObMap->cbMultiText = ctx.cchNameTotal * sizeof(WCHAR);
     pObMap->cMap = ctx.cModules;
     memcpy(pObMap->pMap, ctx.pModules, ctx.cModules * sizeof(VMM_MAP_MODULEENTRY));
     // fetch module names
-    VmmCachePrefetchPages3(pProcess, ctx.psVaName, MAX_PATH << 1, 0);
     VmmWin_InitializeLdrModules_Name(pProcess, pObMap);
+    // generation: retained if the modules are unchanged since the previous build
+    for(i = 0, qwHash = VMMWIN_MAPHASH_SEED; i < pObMap->cMap; i++) {
+        qwHash = VmmWin_MapHash(qwHash, pObMap->pMap[i].vaBase);
+        qwHash = VmmWin_MapHash(qwHash, ((QWORD)pObMap->pMap[i].cbImageSize << 32) | (DWORD)pObMap->pHashTableLookup[i]);
+    }
+    pObMap->qwGeneration = VmmNotify_MapGeneration(pProcess, VMM_NOTIFY_MAP_MODULE, &pProcess->pObPersistent->MapGeneration.Module, qwHash);
     // finish set-up
     qsort(pObMap->pHashTableLookup, pObMap->cMap, sizeof(QWORD), (int(*)(const void*, const void*))VmmWin_InitializeLdrModules_CmpSort);
     pProcess->Map.pObModule = pObMap;
 fail:
     if(!pProcess->Map.pObModule) {
         // try set up zero-sized module map on fail
-        pObMap = Ob_Alloc(OB_TAG_MAP_MODULE, LMEM_ZEROINIT, sizeof(VMMOB_MAP_MODULE) + 2, NULL, NULL);
+        pObMap = Ob_Alloc(OB_TAG_MAP_MODULE, LMEM_ZEROINIT, sizeof(VMMOB_MAP_MODULE) + 2, VmmWin_InitializeLdrModules_CloseObCallback, NULL);
         pObMap->wszMultiText = (LPWSTR)pObMap->pMap;
         pObMap->pHashTableLookup = (PQWORD)pObMap->pMap;
+        pObMap->qwGeneration = VmmNotify_MapGeneration(pProcess, VMM_NOTIFY_MAP_MODULE, &pProcess->pObPersistent->MapGeneration.Module, VMMWIN_MAPHASH_SEED);
         pProcess->Map.pObModule = pObMap;
     }
     LeaveCriticalSection(&pProcess->LockUpdate);
-    Ob_DECREF(ctx.psVaName);
     LocalFree(ctx.pModules);
     return pProcess->Map.pObModule ? TRUE : FALSE;
 }
@@ -706,7 +863,10 @@ fail:
 PVMMWIN_USER_PROCESS_PARAMETERS VmmWin_UserProcessParameters_Get(_In_ PVMM_PROCESS pProcess)
 {
     BOOL f;
+    LPSTR szDllPath = NULL;
+    DWORD cchDllPath = 0;
     QWORD vaUserProcessParameters = 0;
+    VMM_READPLAN_ENTRY Plan[3];
     PVMMWIN_USER_PROCESS_PARAMETERS pu = &pProcess->pObPersistent->UserProcessParams;
     if(pu->fProcessed || pProcess->dwState) { return pu; }
     EnterCriticalSection(&pProcess->LockUpdate);
@@ -720,10 +880,25 @@ PVMMWIN_USER_PROCESS_PARAMETERS VmmWin_UserProcessParameters_Get(_In_ PVMM_PROCE
             !(vaUserProcessParameters & 0xffff8000'00000007);
     }
     if(f) {
-        if(!VmmRead_U2A_Alloc(pProcess, ctxVmm->f32, 0, vaUserProcessParameters + (ctxVmm->f32 ? 0x038 : 0x060), &pu->szImagePathName, &pu->cchImagePathName, NULL)) { // ImagePathName
-            VmmRead_U2A_Alloc(pProcess, ctxVmm->f32, 0, vaUserProcessParameters + (ctxVmm->f32 ? 0x030 : 0x050), &pu->szImagePathName, &pu->cchImagePathName, NULL);   // DllPath (mutually exclusive with ImagePathName?)
+        // ImagePathName, DllPath (mutually exclusive with ImagePathName?) and CommandLine in one read plan
+        ZeroMemory(Plan, sizeof(Plan));
+        Plan[0].tp = Plan[1].tp = Plan[2].tp = VMM_READPLAN_TP_U2A_ALLOC;
+        Plan[0].va = vaUserProcessParameters + (ctxVmm->f32 ? 0x038 : 0x060);
+        Plan[0].psz = &pu->szImagePathName;
+        Plan[0].pcch = &pu->cchImagePathName;
+        Plan[1].va = vaUserProcessParameters + (ctxVmm->f32 ? 0x030 : 0x050);
+        Plan[1].psz = &szDllPath;
+        Plan[1].pcch = &cchDllPath;
+        Plan[2].va = vaUserProcessParameters + (ctxVmm->f32 ? 0x040 : 0x070);
+        Plan[2].psz = &pu->szCommandLine;
+        Plan[2].pcch = &pu->cchCommandLine;
+        VmmReadPlan_Execute(pProcess, ctxVmm->f32, 0, 3, Plan);
+        if(!Plan[0].fResult) {
+            pu->szImagePathName = szDllPath;
+            pu->cchImagePathName = cchDllPath;
+        } else {
+            LocalFree(szDllPath);
         }
-        VmmRead_U2A_Alloc(pProcess, ctxVmm->f32, 0, vaUserProcessParameters + (ctxVmm->f32 ? 0x040 : 0x070), &pu->szCommandLine, &pu->cchCommandLine, NULL);           // CommandLine
     }
     pu->fProcessed = TRUE;
     LeaveCriticalSection(&pProcess->LockUpdate);
@@ -996,6 +1171,61 @@ VOID VmmWinHeap_Initialize64_Pre(_In_ PVMM_PROCESS pProcess, _In_opt_ POB_MAP ct
     ObMap_Push(ctx, va, (PVOID)e.qwHeapData);
 }
 
+/*
+* Allocate the heap map from the segments found by the heap list traversal
+* and fill in the segment ranges. The segment headers are prefetched in one
+* batch (they are usually already cached by the traversal).
+* -- pProcess
+* -- pmHeap = map of segment address -> heap data.
+* -- f32
+*/
+VOID VmmWinHeap_Initialize_Finish(_In_ PVMM_PROCESS pProcess, _In_ POB_MAP pmHeap, _In_ BOOL f32)
+{
+    DWORD i, cHeaps;
+    POB_VSET pObPrefetch = NULL;
+    PVMMOB_MAP_HEAP pObHeapMap;
+    PVMM_MAP_HEAPENTRY pe;
+    union {
+        VMMWIN_HEAP_SEGMENT32 h32;
+        VMMWIN_HEAP_SEGMENT64 h64;
+    } u;
+    cHeaps = ObMap_Size(pmHeap);
+    if(!(pObHeapMap = Ob_Alloc('HeaM', LMEM_ZEROINIT, sizeof(VMMOB_MAP_HEAP) + cHeaps * sizeof(VMM_MAP_HEAPENTRY), NULL, NULL))) { return; }
+    pObHeapMap->qwGeneration = VmmGenerationNext();
+    pObHeapMap->cMap = cHeaps;
+    while(cHeaps) {
+        cHeaps--;
+        pObHeapMap->pMap[cHeaps].qwHeapData = (QWORD)ObMap_PopWithKey(pmHeap, &pObHeapMap->pMap[cHeaps].vaHeapSegment);
+    }
+    // segment ranges
+    if((pObPrefetch = ObVSet_New())) {
+        for(i = 0; i < pObHeapMap->cMap; i++) {
+            ObVSet_Push_PageAlign(pObPrefetch, pObHeapMap->pMap[i].vaHeapSegment, f32 ? sizeof(VMMWIN_HEAP_SEGMENT32) : sizeof(VMMWIN_HEAP_SEGMENT64));
+        }
+        VmmCachePrefetchPages(pProcess, pObPrefetch, 0);
+    }
+    for(i = 0; i < pObHeapMap->cMap; i++) {
+        pe = pObHeapMap->pMap + i;
+        if(f32) {
+            if(!VmmRead(pProcess, pe->vaHeapSegment, (PBYTE)&u.h32, sizeof(VMMWIN_HEAP_SEGMENT32))) { continue; }
+            pe->vaHeap = u.h32.Heap;
+            pe->vaFirstEntry = u.h32.FirstEntry;
+            pe->vaLastValidEntry = u.h32.LastValidEntry;
+        } else {
+            if(!VmmRead(pProcess, pe->vaHeapSegment, (PBYTE)&u.h64, sizeof(VMMWIN_HEAP_SEGMENT64))) { continue; }
+            pe->vaHeap = u.h64.Heap;
+            pe->vaFirstEntry = u.h64.FirstEntry;
+            pe->vaLastValidEntry = u.h64.LastValidEntry;
+        }
+        if((pe->vaFirstEntry < pe->vaHeapSegment) || (pe->vaLastValidEntry <= pe->vaFirstEntry) || (pe->vaLastValidEntry - pe->vaHeapSegment > ((QWORD)pe->cPages << 12))) {
+            pe->vaFirstEntry = 0;
+            pe->vaLastValidEntry = 0;
+        }
+    }
+    Ob_DECREF(pObPrefetch);
+    pProcess->Map.pObHeap = pObHeapMap;     // pProcess take reference responsibility
+}
+
 /*
 * Identify and scan for 64-bit heaps in a process memory space and commit the
 * result to the pProcess memory map.
@@ -1015,7 +1245,6 @@ VOID VmmWinHeap_Initialize32(_In_ PVMM_PROCESS pProcess, _In_ BOOL fWow64)
     DWORD cHeaps;
     QWORD vaHeapPrimary, vaHeaps[0x80];
     POB_MAP pmObHeap;
-    PVMMOB_MAP_HEAP pObHeapMap;
     // 1: Read PEB
     if(!fWow64 && !pProcess->win.vaPEB) { return; }
     if(fWow64 && !pProcess->win.vaPEB32) { return; }
@@ -1043,15 +1272,7 @@ VOID VmmWinHeap_Initialize32(_In_ PVMM_PROCESS pProcess, _In_ BOOL fWow64)
         NULL
     );
     // 4: allocate and set result
-    cHeaps = ObMap_Size(pmObHeap);
-    if((pObHeapMap = Ob_Alloc('HeaM', 0, sizeof(VMMOB_MAP_HEAP) + cHeaps * sizeof(VMM_MAP_HEAPENTRY), NULL, NULL))) {
-        pObHeapMap->cMap = cHeaps;
-        while(cHeaps) {
-            cHeaps--;
-            pObHeapMap->pMap[cHeaps].qwHeapData = (QWORD)ObMap_PopWithKey(pmObHeap, &pObHeapMap->pMap[cHeaps].vaHeapSegment);
-        }
-        pProcess->Map.pObHeap = pObHeapMap;
-    }
+    VmmWinHeap_Initialize_Finish(pProcess, pmObHeap, TRUE);
     Ob_DECREF(pmObHeap);
 }
 
@@ -1069,7 +1290,6 @@ VOID VmmWinHeap_Initialize64(_In_ PVMM_PROCESS pProcess)
     DWORD cHeaps;
     QWORD vaHeapPrimary, vaHeaps[0x80];
     POB_MAP pmObHeap;
-    PVMMOB_MAP_HEAP pObHeapMap;
     // 1: Read PEB
     f = pProcess->win.vaPEB && VmmRead(pProcess, pProcess->win.vaPEB, pbPEB, sizeof(PEB));
     if(!f) { return; }
@@ -1095,15 +1315,7 @@ VOID VmmWinHeap_Initialize64(_In_ PVMM_PROCESS pProcess)
         NULL
     );
     // 4: allocate and set result
-    cHeaps = ObMap_Size(pmObHeap);
-    if((pObHeapMap = Ob_Alloc('HeaM', 0, sizeof(VMMOB_MAP_HEAP) + cHeaps * sizeof(VMM_MAP_HEAPENTRY), NULL, NULL))) {
-        pObHeapMap->cMap = cHeaps;
-        while(cHeaps) {
-            cHeaps--;
-            pObHeapMap->pMap[cHeaps].qwHeapData = (QWORD)ObMap_PopWithKey(pmObHeap, &pObHeapMap->pMap[cHeaps].vaHeapSegment);
-        }
-        pProcess->Map.pObHeap = pObHeapMap;     // pProcess take reference responsibility
-    }
+    VmmWinHeap_Initialize_Finish(pProcess, pmObHeap, FALSE);
     Ob_DECREF(pmObHeap);
 }
 
@@ -1130,6 +1342,175 @@ BOOL VmmWinHeap_Initialize(_In_ PVMM_PROCESS pProcess)
     return pProcess->Map.pObHeap ? TRUE : FALSE;
 }
 
+/*
+* Cleanup callback for the heap entry iterator object.
+*/
+VOID VmmWinHeap_EntryIterator_CloseObCallback(_In_ PVOID pOb)
+{
+    PVMMOB_WINHEAP_ITERATOR it = (PVMMOB_WINHEAP_ITERATOR)pOb;
+    Ob_DECREF(it->pHeapMap);
+    Ob_DECREF(it->pProcess);
+}
+
+/*
+* Start iterating the entries of heap segment it->iSegment. The heap entry
+* encoding key (if any) and the uncommitted ranges of the segment are read.
+* -- it
+* -- return = FALSE if segment cannot be iterated.
+*/
+_Success_(return)
+BOOL VmmWinHeap_EntryIterator_SegmentBegin(_In_ PVMMOB_WINHEAP_ITERATOR it)
+{
+    DWORD dwEncodeFlagMask, cHop = 0;
+    QWORD vaHead, vaFLink;
+    PVMM_MAP_HEAPENTRY pe = it->pHeapMap->pMap + it->iSegment;
+    BYTE pbHeap[0x90];
+    union {
+        VMMWIN_HEAP_SEGMENT32 h32;
+        VMMWIN_HEAP_SEGMENT64 h64;
+        DWORD pdw[4];
+        QWORD pqw[4];
+    } u;
+    if(!pe->vaFirstEntry || !pe->vaLastValidEntry) { return FALSE; }
+    it->vaNext = pe->vaFirstEntry;
+    it->vaEnd = pe->vaLastValidEntry;
+    it->cUcr = 0;
+    // 1: heap entry encoding key (_HEAP.EncodeFlagMask / _HEAP.Encoding)
+    if(pe->vaHeap != it->vaHeapEncoding) {
+        it->vaHeapEncoding = pe->vaHeap;
+        it->fEncoded = FALSE;
+        if(VmmRead(it->pProcess, pe->vaHeap, pbHeap, sizeof(pbHeap))) {
+            dwEncodeFlagMask = *(PDWORD)(pbHeap + (it->f32 ? 0x4c : 0x7c));
+            it->qwEncoding = *(PQWORD)(pbHeap + (it->f32 ? 0x50 : 0x88));
+            it->fEncoded = dwEncodeFlagMask ? TRUE : FALSE;
+        }
+    }
+    // 2: uncommitted ranges (_HEAP_UCR_DESCRIPTOR linked by SegmentEntry)
+    if(it->f32) {
+        if(!VmmRead(it->pProcess, pe->vaHeapSegment, (PBYTE)&u.h32, sizeof(VMMWIN_HEAP_SEGMENT32))) { return TRUE; }
+        if(!u.h32.NumberOfUnCommittedRanges) { return TRUE; }
+        vaHead = pe->vaHeapSegment + FIELD_OFFSET(VMMWIN_HEAP_SEGMENT32, UCRSegmentList);
+        vaFLink = u.h32.UCRSegmentList.Flink;
+    } else {
+        if(!VmmRead(it->pProcess, pe->vaHeapSegment, (PBYTE)&u.h64, sizeof(VMMWIN_HEAP_SEGMENT64))) { return TRUE; }
+        if(!u.h64.NumberOfUnCommittedRanges) { return TRUE; }
+        vaHead = pe->vaHeapSegment + FIELD_OFFSET(VMMWIN_HEAP_SEGMENT64, UCRSegmentList);
+        vaFLink = u.h64.UCRSegmentList.Flink;
+    }
+    while((vaFLink != vaHead) && (it->cUcr < VMMWINHEAP_ITERATOR_UCR_MAX) && (++cHop < 0x100)) {
+        if(it->f32) {
+            if(!VMM_UADDR32_4(vaFLink) || !VmmRead(it->pProcess, vaFLink, (PBYTE)u.pdw, 4 * sizeof(DWORD))) { break; }
+            it->Ucr[it->cUcr].va = u.pdw[2];
+            it->Ucr[it->cUcr].cb = u.pdw[3];
+            vaFLink = u.pdw[0];
+        } else {
+            if(!VMM_UADDR64_8(vaFLink) || !VmmRead(it->pProcess, vaFLink, (PBYTE)u.pqw, 4 * sizeof(QWORD))) { break; }
+            it->Ucr[it->cUcr].va = u.pqw[2];
+            it->Ucr[it->cUcr].cb = u.pqw[3];
+            vaFLink = u.pqw[0];
+        }
+        it->cUcr++;
+    }
+    return TRUE;
+}
+
+/*
+* Read the next window of the current segment in one batched read and decode
+* all heap entry headers inside the window.
+* -- it
+* -- return = FALSE if the segment is done.
+*/
+_Success_(return)
+BOOL VmmWinHeap_EntryIterator_SegmentFill(_In_ PVMMOB_WINHEAP_ITERATOR it)
+{
+    BOOL fUcr;
+    BYTE b[8];
+    DWORD i, o, cbRead, cbHdr, cbBlock;
+    QWORD vaBase, cb;
+    PVMMWINHEAP_ENTRY pe;
+    it->cEntry = 0;
+    it->iEntry = 0;
+    cbHdr = it->f32 ? 8 : 16;
+    while(it->vaNext + cbHdr <= it->vaEnd) {
+        // skip uncommitted ranges
+        fUcr = FALSE;
+        for(i = 0; i < it->cUcr; i++) {
+            if((it->vaNext >= (it->Ucr[i].va & ~0xfff)) && (it->vaNext < it->Ucr[i].va + it->Ucr[i].cb)) {
+                it->vaNext = it->Ucr[i].va + it->Ucr[i].cb;
+                fUcr = TRUE;
+            }
+        }
+        if(fUcr) { continue; }
+        // read window
+        vaBase = it->vaNext & ~0xfff;
+        cb = min(VMMWINHEAP_ITERATOR_PAGES << 12, ((it->vaEnd + 0xfff) & ~0xfff) - vaBase);
+        VmmReadEx(it->pProcess, vaBase, it->pb, (DWORD)cb, &cbRead, VMM_FLAG_ZEROPAD_ON_FAIL);
+        if(!cbRead) { return FALSE; }
+        // decode entries in window
+        while(it->cEntry < VMMWINHEAP_ITERATOR_ENTRIES) {
+            o = (DWORD)(it->vaNext - vaBase);
+            if((o + cbHdr > cb) || (it->vaNext + cbHdr > it->vaEnd)) { break; }
+            for(i = 0; i < it->cUcr; i++) {
+                if((it->vaNext >= (it->Ucr[i].va & ~0xfff)) && (it->vaNext < it->Ucr[i].va + it->Ucr[i].cb)) { break; }
+            }
+            if(i < it->cUcr) { break; }
+            *(PQWORD)b = *(PQWORD)(it->pb + o + cbHdr - 8);
+            if(it->fEncoded) {
+                *(PQWORD)b ^= it->qwEncoding;
+                if(b[3] != (b[0] ^ b[1] ^ b[2])) { goto segment_end; }
+            }
+            cbBlock = *(PWORD)b * cbHdr;
+            if(!cbBlock || (cbBlock > it->vaEnd - it->vaNext)) { goto segment_end; }
+            pe = it->Entry + it->cEntry++;
+            pe->va = it->vaNext;
+            pe->cb = cbBlock;
+            pe->dwFlags = b[2];
+            pe->HeapId = it->pHeapMap->pMap[it->iSegment].HeapId;
+            pe->iSegment = it->iSegment;
+            pe->fBusy = (b[2] & 1) ? TRUE : FALSE;
+            pe->_Reserved = 0;
+            it->vaNext += cbBlock;
+        }
+        if(it->cEntry) { return TRUE; }
+    }
+    return FALSE;
+segment_end:
+    // invalid entry header - no more entries can be decoded in this segment.
+    it->vaNext = it->vaEnd;
+    return it->cEntry ? TRUE : FALSE;
+}
+
+PVMMOB_WINHEAP_ITERATOR VmmWinHeap_EntryIterator(_In_ PVMM_PROCESS pProcess)
+{
+    PVMMOB_MAP_HEAP pObHeapMap = NULL;
+    PVMMOB_WINHEAP_ITERATOR pObIterator;
+    if(!VmmMap_GetHeap(pProcess, &pObHeapMap)) { return NULL; }
+    if(!(pObIterator = Ob_Alloc('HeaI', LMEM_ZEROINIT, sizeof(VMMOB_WINHEAP_ITERATOR), VmmWinHeap_EntryIterator_CloseObCallback, NULL))) {
+        Ob_DECREF(pObHeapMap);
+        return NULL;
+    }
+    pObIterator->pProcess = Ob_INCREF(pProcess);
+    pObIterator->pHeapMap = pObHeapMap;
+    pObIterator->f32 = (ctxVmm->tpSystem == VMM_SYSTEM_WINDOWS_X86) || pProcess->win.fWow64;
+    pObIterator->vaHeapEncoding = (QWORD)-1;
+    return pObIterator;
+}
+
+_Success_(return)
+BOOL VmmWinHeap_EntryNext(_In_ PVMMOB_WINHEAP_ITERATOR it, _Out_ PVMMWINHEAP_ENTRY pEntry)
+{
+    while(it->iEntry == it->cEntry) {
+        if(it->fSegmentActive && VmmWinHeap_EntryIterator_SegmentFill(it)) { break; }
+        it->fSegmentActive = FALSE;
+        if(!ctxVmm->ThreadWorkers.fEnabled) { return FALSE; }
+        if(it->iSegmentNext >= it->pHeapMap->cMap) { return FALSE; }
+        it->iSegment = it->iSegmentNext++;
+        it->fSegmentActive = VmmWinHeap_EntryIterator_SegmentBegin(it);
+    }
+    memcpy(pEntry, it->Entry + it->iEntry++, sizeof(VMMWINHEAP_ENTRY));
+    return TRUE;
+}
+
 // ----------------------------------------------------------------------------
 // THREADING FUNCTIONALITY BELOW:
 //
@@ -1144,6 +1525,7 @@ typedef struct tdVMMWIN_INITIALIZETHREAD_CONTEXT {
     POB_MAP pmThread;
     POB_VSET psTeb;
     PVMM_PROCESS pProcess;
+    QWORD vaThreadListStart;
 } VMMWIN_INITIALIZETHREAD_CONTEXT, *PVMMWIN_INITIALIZETHREAD_CONTEXT;
 
 int VmmWinThread_Initialize_CmpThreadEntry(PVMM_MAP_THREADENTRY v1, PVMM_MAP_THREADENTRY v2)
@@ -1186,58 +1568,109 @@ VOID VmmWinThread_Initialize_DoWork_Pre(_In_ PVMM_PROCESS pSystemProcess, _In_op
     ObMap_Push(ctx->pmThread, e->dwTID, e);  // map will free allocation when cleared
 }
 
-VOID VmmWinThread_Initialize_DoWork(_In_ PVMM_PROCESS pProcess)
+/*
+* Set up the thread list walk of a single process.
+* -- pSystemProcess
+* -- pProcess
+* -- ctx
+* -- pList = list description for VmmWin_ListTraversePrefetchMulti.
+* -- return
+*/
+_Success_(return)
+BOOL VmmWinThread_Initialize_DoWork_Setup(_In_ PVMM_PROCESS pSystemProcess, _In_ PVMM_PROCESS pProcess, _Out_ PVMMWIN_INITIALIZETHREAD_CONTEXT ctx, _Out_ PVMMWIN_LISTTRAVERSE pList)
 {
     BOOL f32 = ctxVmm->f32;
-    BYTE pbTeb[0x20];
-    DWORD i, cMap;
-    QWORD va, vaThreadListEntry;
-    POB_VSET psObTeb = NULL;
-    POB_MAP pmObThreads = NULL;
-    PVMMOB_MAP_THREAD pObThreadMap = NULL;
-    PVMM_MAP_THREADENTRY pThreadEntry;
-    PVMM_PROCESS pObSystemProcess = NULL;
-    VMMWIN_INITIALIZETHREAD_CONTEXT ctx = { 0 };
-    // 1: set up and perform list traversal call.
+    QWORD vaThreadListEntry;
+    ZeroMemory(ctx, sizeof(VMMWIN_INITIALIZETHREAD_CONTEXT));
+    ZeroMemory(pList, sizeof(VMMWIN_LISTTRAVERSE));
     vaThreadListEntry = VMM_PTR_OFFSET(f32, pProcess->win.EPROCESS.pb, ctxVmm->kernel.ThreadInfo.oThreadListHeadKP);
-    if(f32 ? !VMM_KADDR32_4(vaThreadListEntry) : !VMM_KADDR64_8(vaThreadListEntry)) { goto fail; }
-    if(!(pObSystemProcess = VmmProcessGet(4))) { goto fail; }
-    if(!(psObTeb = ObVSet_New())) { goto fail; }
-    if(!(pmObThreads = ObMap_New(OB_MAP_FLAGS_OBJECT_LOCALFREE))) { goto fail; }
-    ctx.pmThread = pmObThreads;
-    ctx.psTeb = psObTeb;
-    ctx.pProcess = pProcess;
-    va = vaThreadListEntry - ctxVmm->kernel.ThreadInfo.oThreadListEntry;
-    VmmWin_ListTraversePrefetch(
-        pObSystemProcess,
-        f32,
-        &ctx,
-        1,
-        &va,
-        ctxVmm->kernel.ThreadInfo.oThreadListEntry,
-        ctxVmm->kernel.ThreadInfo.oMax,
-        VmmWinThread_Initialize_DoWork_Pre,
-        NULL,
-        pProcess->pObPersistent->pObCMapThreadPrefetch);
-    // 2: transfer result from generic map into PVMMOB_MAP_THREAD
-    if(!(cMap = ObMap_Size(pmObThreads))) { goto fail; }
-    if(!(pObThreadMap = Ob_Alloc(OB_TAG_MAP_THREAD, 0, sizeof(VMMOB_MAP_THREAD) + cMap * sizeof(VMM_MAP_THREADENTRY), NULL, NULL))) { goto fail; }
+    if(f32 ? !VMM_KADDR32_4(vaThreadListEntry) : !VMM_KADDR64_8(vaThreadListEntry)) { return FALSE; }
+    if(!(ctx->psTeb = ObVSet_New()) || !(ctx->pmThread = ObMap_New(OB_MAP_FLAGS_OBJECT_LOCALFREE))) {
+        Ob_DECREF_NULL(&ctx->psTeb);
+        return FALSE;
+    }
+    ctx->pProcess = pProcess;
+    ctx->vaThreadListStart = vaThreadListEntry - ctxVmm->kernel.ThreadInfo.oThreadListEntry;
+    pList->pProcess = pSystemProcess;
+    pList->f32 = f32;
+    pList->ctx = ctx;
+    pList->cvaDataStart = 1;
+    pList->pvaDataStart = &ctx->vaThreadListStart;
+    pList->oListStart = ctxVmm->kernel.ThreadInfo.oThreadListEntry;
+    pList->cbData = ctxVmm->kernel.ThreadInfo.oMax;
+    pList->pfnCallback_Pre = (VMMWIN_LISTTRAVERSE_PRE_CB)VmmWinThread_Initialize_DoWork_Pre;
+    pList->pPrefetchAddressContainer = pProcess->pObPersistent->pObCMapThreadPrefetch;
+    return TRUE;
+}
+
+/*
+* Finish the thread map of a single process once its thread list is walked.
+* User mode stack information is read from the TEBs and generations are set
+* by comparing with the previous thread map of the process; entries with the
+* same TID and ETHREAD address which are otherwise unchanged keep the older
+* generation. The thread map is assigned to pProcess on success.
+* -- ctx
+*/
+VOID VmmWinThread_Initialize_DoWork_Finish(_In_ PVMMWIN_INITIALIZETHREAD_CONTEXT ctx)
+{
+    BOOL f32 = ctxVmm->f32;
+    BYTE pbTeb[0x20];
+    DWORD i, cMap, dwGeneration;
+    PVMM_PROCESS pProcess = ctx->pProcess;
+    PVMMOB_MAP_THREAD pObThreadMap = NULL, pObThreadMapPrev = NULL;
+    PVMM_MAP_THREADENTRY pe, pePrev;
+    // 1: transfer result from generic map into PVMMOB_MAP_THREAD
+    if(!(cMap = ObMap_Size(ctx->pmThread))) { return; }
+    if(!(pObThreadMap = Ob_Alloc(OB_TAG_MAP_THREAD, 0, sizeof(VMMOB_MAP_THREAD) + cMap * sizeof(VMM_MAP_THREADENTRY), NULL, NULL))) { return; }
+    pObThreadMap->qwGeneration = VmmGenerationNext();
     pObThreadMap->cMap = cMap;
-    VmmCachePrefetchPages3(pProcess, psObTeb, 0x20, 0);
+    VmmCachePrefetchPages3(pProcess, ctx->psTeb, 0x20, 0);
     for(i = 0; i < cMap; i++) {
-        pThreadEntry = (PVMM_MAP_THREADENTRY)ObMap_GetByIndex(pmObThreads, i);
-        if(VmmRead2(pProcess, pThreadEntry->vaTeb, pbTeb, 0x20, VMM_FLAG_FORCECACHE_READ)) {
-            pThreadEntry->vaStackBaseUser = f32 ? *(PDWORD)(pbTeb + 4) : *(PQWORD)(pbTeb + 8);
-            pThreadEntry->vaStackLimitUser = f32 ? *(PDWORD)(pbTeb + 8) : *(PQWORD)(pbTeb + 16);
+        pe = (PVMM_MAP_THREADENTRY)ObMap_GetByIndex(ctx->pmThread, i);
+        if(VmmRead2(pProcess, pe->vaTeb, pbTeb, 0x20, VMM_FLAG_FORCECACHE_READ)) {
+            pe->vaStackBaseUser = f32 ? *(PDWORD)(pbTeb + 4) : *(PQWORD)(pbTeb + 8);
+            pe->vaStackLimitUser = f32 ? *(PDWORD)(pbTeb + 8) : *(PQWORD)(pbTeb + 16);
         }
-        memcpy(pObThreadMap->pMap + i, pThreadEntry, sizeof(VMM_MAP_THREADENTRY));
+        memcpy(pObThreadMap->pMap + i, pe, sizeof(VMM_MAP_THREADENTRY));
     }
-    // 3: sort on thread id (TID) and assign result to process object.
+    // 2: sort on thread id (TID).
     qsort(pObThreadMap->pMap, cMap, sizeof(VMM_MAP_THREADENTRY), (int(*)(const void*, const void*))VmmWinThread_Initialize_CmpThreadEntry);
+    // 3: assign generations and remember map for the next generation compare.
+    dwGeneration = InterlockedIncrement(&ctxVmm->dwThreadMapGeneration);
+    pObThreadMap->dwThreadGeneration = dwGeneration;
+    pObThreadMapPrev = (PVMMOB_MAP_THREAD)ObContainer_GetOb(pProcess->pObPersistent->pObCMapThreadPrevious);
+    for(i = 0; i < cMap; i++) {
+        pe = pObThreadMap->pMap + i;
+        pe->dwGeneration = dwGeneration;
+        if(pObThreadMapPrev && (pePrev = VmmMap_GetThreadEntry(pObThreadMapPrev, pe->dwTID)) && (pePrev->vaETHREAD == pe->vaETHREAD)) {
+            pe->dwGeneration = pePrev->dwGeneration;
+            if(memcmp(pe, pePrev, sizeof(VMM_MAP_THREADENTRY))) {
+                pe->dwGeneration = dwGeneration;
+            }
+        }
+    }
+    ObContainer_SetOb(pProcess->pObPersistent->pObCMapThreadPrevious, pObThreadMap);
+    Ob_DECREF(pObThreadMapPrev);
     pProcess->Map.pObThread = pObThreadMap;     // pProcess take reference responsibility
-fail:
-    Ob_DECREF(psObTeb);
-    Ob_DECREF(pmObThreads);
+}
+
+VOID VmmWinThread_Initialize_DoWork_Cleanup(_In_ PVMMWIN_INITIALIZETHREAD_CONTEXT ctx)
+{
+    Ob_DECREF_NULL(&ctx->psTeb);
+    Ob_DECREF_NULL(&ctx->pmThread);
+}
+
+VOID VmmWinThread_Initialize_DoWork(_In_ PVMM_PROCESS pProcess)
+{
+    PVMM_PROCESS pObSystemProcess = NULL;
+    VMMWIN_INITIALIZETHREAD_CONTEXT ctx;
+    VMMWIN_LISTTRAVERSE oList;
+    if(!(pObSystemProcess = VmmProcessGet(4))) { return; }
+    if(VmmWinThread_Initialize_DoWork_Setup(pObSystemProcess, pProcess, &ctx, &oList)) {
+        VmmWin_ListTraversePrefetchMulti(1, &oList);
+        VmmWinThread_Initialize_DoWork_Finish(&ctx);
+        VmmWinThread_Initialize_DoWork_Cleanup(&ctx);
+    }
     Ob_DECREF(pObSystemProcess);
 }
 
@@ -1262,13 +1695,78 @@ BOOL VmmWinThread_Initialize(_In_ PVMM_PROCESS pProcess, _In_ BOOL fNonBlocking)
     if(!pProcess->Map.pObThread) {
         VmmWinThread_Initialize_DoWork(pProcess);
         if(!pProcess->Map.pObThread) {
-            pProcess->Map.pObThread = Ob_Alloc(OB_TAG_MAP_THREAD, LMEM_ZEROINIT, sizeof(VMMOB_MAP_THREAD), NULL, NULL);
+            if((pProcess->Map.pObThread = Ob_Alloc(OB_TAG_MAP_THREAD, LMEM_ZEROINIT, sizeof(VMMOB_MAP_THREAD), NULL, NULL))) {
+                pProcess->Map.pObThread->qwGeneration = VmmGenerationNext();
+            }
         }
     }
     LeaveCriticalSection(&pProcess->Map.LockUpdateThreadMap);
     return pProcess->Map.pObThread ? TRUE : FALSE;
 }
 
+/*
+* VmmWorkParallel callback for VmmWinThread_InitializeAll.
+*/
+VOID VmmWinThread_InitializeAll_FinishCB(_In_ PVMMWIN_INITIALIZETHREAD_CONTEXT pCtxs, _In_ DWORD iItem)
+{
+    VmmTlbSpider(pCtxs[iItem].pProcess);
+    VmmWinThread_Initialize_DoWork_Finish(pCtxs + iItem);
+}
+
+/*
+* Initialize the thread maps of all processes which don't already have one in
+* a single batched pass. The thread lists of all processes are walked at the
+* same time - one prefetch per list step for all processes - after which the
+* per-process TEB reads are performed in parallel. Processes which currently
+* are being initialized by another thread are skipped.
+*/
+VOID VmmWinThread_InitializeAll()
+{
+    DWORD i, cCtx = 0, cProcess;
+    PBYTE pbBuffer = NULL;
+    PVMM_PROCESS pObSystemProcess = NULL, pObProcess = NULL;
+    PVMMOB_PROCESS_TABLE ptObCurrent = NULL;
+    PVMMWIN_INITIALIZETHREAD_CONTEXT pCtxs;
+    PVMMWIN_LISTTRAVERSE pLists;
+    PVMM_PROCESS *ppProcesses;
+    if(!ctxVmm->fThreadMapEnabled) { return; }
+    if(!(ptObCurrent = (PVMMOB_PROCESS_TABLE)ObContainer_GetOb(ctxVmm->pObCPROC))) { goto fail; }
+    if(!(cProcess = (DWORD)ptObCurrent->c)) { goto fail; }
+    if(!(pObSystemProcess = VmmProcessGet(4))) { goto fail; }
+    if(!(pbBuffer = LocalAlloc(0, cProcess * (sizeof(VMMWIN_INITIALIZETHREAD_CONTEXT) + sizeof(VMMWIN_LISTTRAVERSE) + sizeof(PVMM_PROCESS))))) { goto fail; }
+    pCtxs = (PVMMWIN_INITIALIZETHREAD_CONTEXT)pbBuffer;
+    pLists = (PVMMWIN_LISTTRAVERSE)(pbBuffer + cProcess * sizeof(VMMWIN_INITIALIZETHREAD_CONTEXT));
+    ppProcesses = (PVMM_PROCESS*)(pbBuffer + cProcess * (sizeof(VMMWIN_INITIALIZETHREAD_CONTEXT) + sizeof(VMMWIN_LISTTRAVERSE)));
+    // 1: lock and set up processes without thread map
+    while((cCtx < cProcess) && (pObProcess = VmmProcessGetNextEx(ptObCurrent, pObProcess, 0))) {
+        if(pObProcess->Map.pObThread || !TryEnterCriticalSection(&pObProcess->Map.LockUpdateThreadMap)) { continue; }
+        if(!pObProcess->Map.pObThread && VmmWinThread_Initialize_DoWork_Setup(pObSystemProcess, pObProcess, pCtxs + cCtx, pLists + cCtx)) {
+            ppProcesses[cCtx++] = Ob_INCREF(pObProcess);
+        } else {
+            LeaveCriticalSection(&pObProcess->Map.LockUpdateThreadMap);
+        }
+    }
+    Ob_DECREF_NULL(&pObProcess);
+    // 2: walk all thread lists at the same time and finish maps in parallel
+    VmmWin_ListTraversePrefetchMulti(cCtx, pLists);
+    VmmWorkParallel(pCtxs, cCtx, (VOID(*)(PVOID, DWORD))VmmWinThread_InitializeAll_FinishCB);
+    // 3: clean up and unlock
+    for(i = 0; i < cCtx; i++) {
+        if(!ppProcesses[i]->Map.pObThread) {
+            if((ppProcesses[i]->Map.pObThread = Ob_Alloc(OB_TAG_MAP_THREAD, LMEM_ZEROINIT, sizeof(VMMOB_MAP_THREAD), NULL, NULL))) {
+                ppProcesses[i]->Map.pObThread->qwGeneration = VmmGenerationNext();
+            }
+        }
+        VmmWinThread_Initialize_DoWork_Cleanup(pCtxs + i);
+        LeaveCriticalSection(&ppProcesses[i]->Map.LockUpdateThreadMap);
+        Ob_DECREF(ppProcesses[i]);
+    }
+fail:
+    LocalFree(pbBuffer);
+    Ob_DECREF(pObSystemProcess);
+    Ob_DECREF(ptObCurrent);
+}
+
 // ----------------------------------------------------------------------------
 // HANDLE FUNCTIONALITY BELOW:
 //
@@ -1302,9 +1800,9 @@ PVMMWIN_OBJECT_TYPE VmmWin_ObjectTypeGet(_In_ BYTE iObjectType)
     if(ctxVmm->ObjectTypeTable.fInitialized) {
         return ctxVmm->ObjectTypeTable.h[iObjectType].wsz ? &ctxVmm->ObjectTypeTable.h[iObjectType] : NULL;
     }
-    EnterCriticalSection(&ctxVmm->MasterLock);
+    EnterCriticalSection(&ctxVmm->ObjectTypeTable.LockUpdate);
     if(ctxVmm->ObjectTypeTable.fInitialized) {
-        LeaveCriticalSection(&ctxVmm->MasterLock);
+        LeaveCriticalSection(&ctxVmm->ObjectTypeTable.LockUpdate);
         return ctxVmm->ObjectTypeTable.h[iObjectType].wsz ? &ctxVmm->ObjectTypeTable.h[iObjectType] : NULL;
     }
     if(!(pObSystemProcess = VmmProcessGet(4))) { goto fail; }
@@ -1375,7 +1873,7 @@ PVMMWIN_OBJECT_TYPE VmmWin_ObjectTypeGet(_In_ BYTE iObjectType)
 fail:
     ctxVmm->ObjectTypeTable.fInitialized = TRUE;
     if(!fResult) { ctxVmm->ObjectTypeTable.fInitializedFailed = TRUE; }
-    LeaveCriticalSection(&ctxVmm->MasterLock);
+    LeaveCriticalSection(&ctxVmm->ObjectTypeTable.LockUpdate);
     Ob_DECREF(pObSystemProcess);
     LocalFree(wszMultiText);
     return ctxVmm->ObjectTypeTable.h[iObjectType].wsz ? &ctxVmm->ObjectTypeTable.h[iObjectType] : NULL;
@@ -1396,14 +1894,25 @@ BYTE VmmWin_ObjectTypeGetIndexFromEncoded(_In_ QWORD vaObjectHeader, _In_ BYTE i
     return iTypeIndexTableEncoded ^ (BYTE)(vaObjectHeader >> 8) ^ ctxVmm->ObjectTypeTable.bObjectHeaderCookie;
 }
 
+#define VMMWIN_HANDLE_WORK_CHUNK            0x100
+#define VMMWIN_HANDLETEXT_CACHE_MAX         0x00080000
+
+typedef struct tdVMMWINOB_HANDLE_TEXT {
+    OB ObHdr;
+    QWORD vaString;
+    DWORD cbString;
+    DWORD dwPoolTag;
+    WCHAR wsz[];
+} VMMWINOB_HANDLE_TEXT, *PVMMWINOB_HANDLE_TEXT;
+
 typedef struct tdVMMWIN_INITIALIZE_HANDLE_CONTEXT {
     PVMM_PROCESS pSystemProcess;
     PVMM_PROCESS pProcess;
     DWORD cTables;
     DWORD cTablesMax;
     PQWORD pvaTables;
+    PDWORD piMapTable;              // [cTables + 1] per table start index into pHandleMap
     PVMMOB_MAP_HANDLE pHandleMap;
-    DWORD iMap;
 } VMMWIN_INITIALIZE_HANDLE_CONTEXT, *PVMMWIN_INITIALIZE_HANDLE_CONTEXT;
 
 /*
@@ -1461,88 +1970,71 @@ VOID VmmWinHandle_InitializeCore_SpiderTables(_In_ PVMMWIN_INITIALIZE_HANDLE_CON
 }
 
 /*
-* Count the number of valid handles.
-* -- ctx
-* -- return = the number of valid handles.
+* Decode a handle table entry into the object address (object body).
+* -- pbEntry = handle table entry (8 bytes on 32-bit, 16 bytes on 64-bit).
+* -- return = object address or 0 if not a valid handle entry.
 */
-DWORD VmmWinHandle_InitializeCore_CountHandles(_In_ PVMMWIN_INITIALIZE_HANDLE_CONTEXT ctx)
+QWORD VmmWinHandle_InitializeCore_DecodeEntry(_In_ PBYTE pbEntry)
 {
     QWORD va;
-    DWORD iTable, i, cHandles = 0;
-    union {
-        BYTE pb[0x1000];
-        DWORD pdw[0x400];
-        QWORD pqw[0x200];
-    } u;
-    VmmCachePrefetchPages4(ctx->pSystemProcess, ctx->cTables, ctx->pvaTables, 0x1000, 0);
-    for(iTable = 0; iTable < ctx->cTables; iTable++) {
-        if(!VmmRead(ctx->pSystemProcess, ctx->pvaTables[iTable], u.pb, 0x1000)) { continue; }
-        if(ctxVmm->f32) {
-            for(i = 1; i < 512; i++) {
-                if(!VMM_KADDR32(u.pdw[i << 1])) { continue; }
-                cHandles++;
-            }
-        } else {
-            for(i = 1; i < 256; i++) {
-                va = u.pqw[i << 1];
-                if(ctxVmm->kernel.dwVersionBuild >= 9200) {     // Win8 or later
-                    va = 0xffff0000'00000000 | (va >> 16);
-                }
-                if(!VMM_KADDR64(va)) { continue; }
-                cHandles++;
-            }
+    if(ctxVmm->f32) {
+        va = *(PDWORD)pbEntry & ~3;
+        return VMM_KADDR32(va) ? ((va & ~7) + 0x18ULL) : 0;
+    }
+    va = *(PQWORD)pbEntry;
+    if(ctxVmm->kernel.dwVersionBuild >= 9600) {         // Win8.1 or later
+        va = 0xffff0000'00000000 | (va >> 16);
+    } else if(ctxVmm->kernel.dwVersionBuild >= 9200) {  // Win8 or later
+        va = 0xfffff800'00000000 | (va >> 19);
+    }
+    return VMM_KADDR64(va) ? ((va & ~7) + 0x30) : 0;
+}
+
+/*
+* Count the number of valid handles in a single handle table. Called in
+* parallel by VmmWorkParallel - the count is stored in ctx->piMapTable.
+* -- ctx
+* -- iTable
+*/
+VOID VmmWinHandle_InitializeCore_CountHandlesCB(_In_ PVMMWIN_INITIALIZE_HANDLE_CONTEXT ctx, _In_ DWORD iTable)
+{
+    DWORD i, cHandles = 0, cbEntry = ctxVmm->f32 ? 8 : 16;
+    BYTE pb[0x1000];
+    if(!VmmRead(ctx->pSystemProcess, ctx->pvaTables[iTable], pb, 0x1000)) { return; }
+    for(i = 1; i < 0x1000 / cbEntry; i++) {
+        if(VmmWinHandle_InitializeCore_DecodeEntry(pb + i * cbEntry)) {
+            cHandles++;
         }
     }
-    return cHandles;
+    ctx->piMapTable[iTable] = cHandles;
 }
 
 /*
-* Read the handle tables and populate only basic information into the HandleMap
+* Read a handle table and populate only basic information into the HandleMap
 * i.e. data that don't require reading of the actual objects pointed to.
+* Entries are written into the map range reserved for the table by the count
+* pass. Called in parallel by VmmWorkParallel.
 * -- ctx
-* -- vaHandleTable
-* -- dwBaseHandleId
+* -- iTable
 */
-VOID VmmWinHandle_InitializeCore_ReadHandleTable(_In_ PVMMWIN_INITIALIZE_HANDLE_CONTEXT ctx, _In_ QWORD vaHandleTable, _In_ DWORD dwBaseHandleId)
+VOID VmmWinHandle_InitializeCore_ReadHandleTableCB(_In_ PVMMWIN_INITIALIZE_HANDLE_CONTEXT ctx, _In_ DWORD iTable)
 {
-    DWORD i;
     QWORD va;
+    DWORD i, iMap, iMapMax, dwBaseHandleId, cbEntry = ctxVmm->f32 ? 8 : 16;
     PVMM_MAP_HANDLEENTRY pe;
-    union {
-        BYTE pb[0x1000];
-        DWORD pdw[0x400];
-        QWORD pqw[0x200];
-    } u;
-    if(!VmmRead(ctx->pSystemProcess, vaHandleTable, u.pb, 0x1000)) { return; }
-    if(ctxVmm->f32) {
-        for(i = 1; i < 512; i++) {
-            va = u.pdw[i << 1] & ~3;
-            if(!VMM_KADDR32(va)) { continue; }
-            pe = ctx->pHandleMap->pMap + ctx->iMap;
-            pe->vaObject = (va & ~7) + 0x18ULL;
-            pe->dwGrantedAccess = u.pdw[(i << 1) + 1] & 0x00ffffff;
-            pe->dwHandle = dwBaseHandleId + (i << 2);
-            pe->dwPID = ctx->pProcess->dwPID;
-            ctx->iMap++;
-            if(ctx->iMap == ctx->pHandleMap->cMap) { break; }
-        }
-    } else {
-        for(i = 1; i < 256; i++) {
-            va = u.pqw[i << 1];
-            if(ctxVmm->kernel.dwVersionBuild >= 9600) {         // Win8.1 or later
-                va = 0xffff0000'00000000 | (va >> 16);
-            } else if(ctxVmm->kernel.dwVersionBuild >= 9200) {  // Win8 or later
-                va = 0xfffff800'00000000 | (va >> 19);
-            }
-            if(!VMM_KADDR64(va)) { continue; }
-            pe = ctx->pHandleMap->pMap + ctx->iMap;
-            pe->vaObject = (va & ~7) + 0x30;
-            pe->dwGrantedAccess = (DWORD)u.pqw[(i << 1) + 1] & 0x00ffffff;
-            pe->dwHandle = dwBaseHandleId + (i << 2);
-            pe->dwPID = ctx->pProcess->dwPID;
-            ctx->iMap++;
-            if(ctx->iMap == ctx->pHandleMap->cMap) { break; }
-        }
+    BYTE pb[0x1000];
+    iMap = ctx->piMapTable[iTable];
+    iMapMax = ctx->piMapTable[iTable + 1];
+    if((iMap == iMapMax) || !VmmRead(ctx->pSystemProcess, ctx->pvaTables[iTable], pb, 0x1000)) { return; }
+    dwBaseHandleId = iTable * (ctxVmm->f32 ? 2048 : 1024);
+    for(i = 1; (i < 0x1000 / cbEntry) && (iMap < iMapMax); i++) {
+        if(!(va = VmmWinHandle_InitializeCore_DecodeEntry(pb + i * cbEntry))) { continue; }
+        pe = ctx->pHandleMap->pMap + iMap;
+        pe->vaObject = va;
+        pe->dwGrantedAccess = *(PDWORD)(pb + i * cbEntry + (cbEntry >> 1)) & 0x00ffffff;
+        pe->dwHandle = dwBaseHandleId + (i << 2);
+        pe->dwPID = ctx->pProcess->dwPID;
+        iMap++;
     }
 }
 
@@ -1613,16 +2105,73 @@ DWORD VmmWinHandle_InitializeText_GetPoolHeader64(_In_reads_(0x60) PBYTE pb, _Ou
     return 0;
 }
 
-VOID VmmWinHandle_InitializeText_DoWork(_In_ PVMM_PROCESS pSystemProcess, _In_ PVMMOB_MAP_HANDLE pHandleMap)
-{
-    BOOL f, fThreadingEnabled;
-    PBYTE pbMultiText = NULL;
-    DWORD i, cbRead, oPoolHdr, cbObjectRead, cbMultiText = 4, ocbMultiText = 2;
+typedef struct tdVMMWIN_INITIALIZE_HANDLETEXT_CONTEXT {
+    PVMM_PROCESS pSystemProcess;
+    PVMMOB_MAP_HANDLE pHandleMap;
     POB_VSET psObPrefetch;
+    BOOL fThreadingEnabled;
+    DWORD cbObjectRead;
+    PDWORD poMultiText;             // [pHandleMap->cMap] text offsets into pbMultiText
+    PBYTE pbMultiText;
+} VMMWIN_INITIALIZE_HANDLETEXT_CONTEXT, *PVMMWIN_INITIALIZE_HANDLETEXT_CONTEXT;
+
+/*
+* Retrieve a cached object name for a handle entry from the global handle text
+* cache. The cached name is only returned if the name buffer address, length
+* and pool tag are unchanged since the name was cached.
+* CALLER DECREF: return
+* -- pe
+* -- return
+*/
+PVMMWINOB_HANDLE_TEXT VmmWinHandle_TextCache_Get(_In_ PVMM_MAP_HANDLEENTRY pe)
+{
+    PVMMWINOB_HANDLE_TEXT pObText;
+    if(ctxVmm->flags & VMM_FLAG_NOCACHE) { return NULL; }
+    if((pObText = ObMap_GetByKey(ctxVmm->pmObHandleText, pe->vaObject))) {
+        if((pObText->vaString == pe->_Reserved2) && (pObText->cbString == pe->_Reserved1) && (pObText->dwPoolTag == pe->dwPoolTag)) {
+            return pObText;
+        }
+        Ob_DECREF(pObText);
+    }
+    return NULL;
+}
+
+/*
+* Insert a successfully read object name into the global handle text cache.
+* -- pe
+* -- pbText
+*/
+VOID VmmWinHandle_TextCache_Put(_In_ PVMM_MAP_HANDLEENTRY pe, _In_ PBYTE pbText)
+{
+    PVMMWINOB_HANDLE_TEXT pObText;
+    if(!ctxVmm->pmObHandleText || (ctxVmm->flags & VMM_FLAG_NOCACHE)) { return; }
+    if(!(pObText = Ob_Alloc(OB_TAG_HANDLE_TEXT, 0, sizeof(VMMWINOB_HANDLE_TEXT) + pe->_Reserved1, NULL, NULL))) { return; }
+    pObText->vaString = pe->_Reserved2;
+    pObText->cbString = pe->_Reserved1;
+    pObText->dwPoolTag = pe->dwPoolTag;
+    memcpy(pObText->wsz, pbText, pe->_Reserved1);
+    if(ObMap_Size(ctxVmm->pmObHandleText) >= VMMWIN_HANDLETEXT_CACHE_MAX) {
+        ObMap_Clear(ctxVmm->pmObHandleText);
+    }
+    Ob_DECREF(ObMap_RemoveByKey(ctxVmm->pmObHandleText, pe->vaObject));
+    ObMap_Push(ctxVmm->pmObHandleText, pe->vaObject, pObText);
+    Ob_DECREF(pObText);
+}
+
+/*
+* Read and interpret the object header, pool tag and object name location of
+* a chunk of handles. Called in parallel by VmmWorkParallel.
+* -- ctx
+* -- iChunk
+*/
+VOID VmmWinHandle_InitializeText_ObjectCB(_In_ PVMMWIN_INITIALIZE_HANDLETEXT_CONTEXT ctx, _In_ DWORD iChunk)
+{
+    BOOL f;
+    DWORD i, iMax, cbRead, oPoolHdr;
     PUNICODE_STRING32 pus32;
     PUNICODE_STRING64 pus64;
     PVMM_MAP_HANDLEENTRY pe;
-    PVMM_PROCESS pObProcessHnd;
+    PVMMWINOB_HANDLE_TEXT pObText;
     union {
         BYTE pb[0x1000];
         struct {
@@ -1640,21 +2189,12 @@ VOID VmmWinHandle_InitializeText_DoWork(_In_ PVMM_PROCESS pSystemProcess, _In_ P
             BYTE pb[];
         } O64;
     } u;
-    fThreadingEnabled = (ctxVmm->kernel.ThreadInfo.oCid > 0);
-    cbObjectRead = max(ctxVmm->kernel.OffsetEPROCESS.PID + 0x08, ctxVmm->kernel.ThreadInfo.oCid + 0x20);
-    cbObjectRead = 0x90 + max(0x70, cbObjectRead);
-    // 1: cache prefetch object data
-    if(!(psObPrefetch = ObVSet_New())) { goto fail; }
-    for(i = 0; i < pHandleMap->cMap; i++) {
-        ObVSet_Push(psObPrefetch, pHandleMap->pMap[i].vaObject - 0x90);
-    }
-    VmmCachePrefetchPages3(pSystemProcess, psObPrefetch, cbObjectRead, 0);
-    ObVSet_Clear(psObPrefetch);
-    // 2: read and interpret object data
-    if(ctxVmm->f32) {
-        for(i = 0; i < pHandleMap->cMap; i++) {
-            pe = pHandleMap->pMap + i;
-            VmmReadEx(pSystemProcess, pe->vaObject - 0x60, u.pb, cbObjectRead, &cbRead, VMM_FLAG_ZEROPAD_ON_FAIL | VMM_FLAG_FORCECACHE_READ);
+    i = iChunk * VMMWIN_HANDLE_WORK_CHUNK;
+    iMax = min(i + VMMWIN_HANDLE_WORK_CHUNK, ctx->pHandleMap->cMap);
+    for(; i < iMax; i++) {
+        pe = ctx->pHandleMap->pMap + i;
+        if(ctxVmm->f32) {
+            VmmReadEx(ctx->pSystemProcess, pe->vaObject - 0x60, u.pb, ctx->cbObjectRead, &cbRead, VMM_FLAG_ZEROPAD_ON_FAIL | VMM_FLAG_FORCECACHE_READ);
             if(cbRead < 0x60) { continue; }
             // fetch and validate type index
             pe->iType = VmmWin_ObjectTypeGetIndexFromEncoded(pe->vaObject - 0x18, u.O32.Header.TypeIndex);
@@ -1673,11 +2213,9 @@ VOID VmmWinHandle_InitializeText_DoWork(_In_ PVMM_PROCESS pSystemProcess, _In_ P
                 pus32 = NULL;
                 if((pe->dwPoolTag & 0x00ffffff) == 'orP') {
                     pe->_Reserved1 = *(PDWORD)(u.O32.pb + ctxVmm->kernel.OffsetEPROCESS.PID);
-                    cbMultiText += 31 * sizeof(WCHAR) + 2;
-                } else if(((pe->dwPoolTag & 0x00ffffff) == 'rhT') && fThreadingEnabled) {
+                } else if(((pe->dwPoolTag & 0x00ffffff) == 'rhT') && ctx->fThreadingEnabled) {
                     if(ctxVmm->kernel.ThreadInfo.oCid && *(PDWORD)(u.O32.pb + ctxVmm->kernel.ThreadInfo.oCid + 4)) {
                         pe->_Reserved1 = *(PDWORD)(u.O32.pb + ctxVmm->kernel.ThreadInfo.oCid + 4);
-                        cbMultiText += 11 * sizeof(WCHAR) + 2;
                     }
                 } else if((pe->dwPoolTag & 0x00ffffff) == 'liF') {
                     pus32 = (PUNICODE_STRING32)(u.O32.pb + 0x030);
@@ -1688,18 +2226,12 @@ VOID VmmWinHandle_InitializeText_DoWork(_In_ PVMM_PROCESS pSystemProcess, _In_ P
                     !(pus32->Length & 1) && (pus32->Length < (2 * MAX_PATH)) && (pus32->Length <= pus32->MaximumLength) &&
                     VMM_KADDR32(pus32->Buffer);
                 if(f) {
-                    cbMultiText += pus32->Length + 2;
                     pe->_Reserved1 = pus32->Length;
                     pe->_Reserved2 = pus32->Buffer;
-                    ObVSet_Push(psObPrefetch, pus32->Buffer);
                 }
             }
-        }
-    } else {
-        for(i = 0; i < pHandleMap->cMap; i++) {
-            pe = pHandleMap->pMap + i;
-            max(0x70, ctxVmm->kernel.ThreadInfo.oCid + 0x10);
-            VmmReadEx(pSystemProcess, pe->vaObject - 0x90, u.pb, cbObjectRead, &cbRead, VMM_FLAG_ZEROPAD_ON_FAIL | VMM_FLAG_FORCECACHE_READ);
+        } else {
+            VmmReadEx(ctx->pSystemProcess, pe->vaObject - 0x90, u.pb, ctx->cbObjectRead, &cbRead, VMM_FLAG_ZEROPAD_ON_FAIL | VMM_FLAG_FORCECACHE_READ);
             if(cbRead < 0x90) { continue; }
             // fetch and validate type index
             pe->iType = VmmWin_ObjectTypeGetIndexFromEncoded(pe->vaObject - 0x30, u.O64.Header.TypeIndex);
@@ -1718,11 +2250,9 @@ VOID VmmWinHandle_InitializeText_DoWork(_In_ PVMM_PROCESS pSystemProcess, _In_ P
                 pus64 = NULL;
                 if((pe->dwPoolTag & 0x00ffffff) == 'orP') {
                     pe->_Reserved1 = *(PDWORD)(u.O64.pb + ctxVmm->kernel.OffsetEPROCESS.PID);
-                    cbMultiText += 31 * sizeof(WCHAR) + 2;
-                } else if(((pe->dwPoolTag & 0x00ffffff) == 'rhT') && fThreadingEnabled) {
+                } else if(((pe->dwPoolTag & 0x00ffffff) == 'rhT') && ctx->fThreadingEnabled) {
                     if(ctxVmm->kernel.ThreadInfo.oCid && *(PDWORD)(u.O64.pb + ctxVmm->kernel.ThreadInfo.oCid + 8)) {
                         pe->_Reserved1 = *(PDWORD)(u.O64.pb + ctxVmm->kernel.ThreadInfo.oCid + 8);
-                        cbMultiText += 11 * sizeof(WCHAR) + 2;
                     }
                 } else if((pe->dwPoolTag & 0x00ffffff) == 'liF') {
                     pus64 = (PUNICODE_STRING64)(u.O64.pb + 0x058);
@@ -1733,51 +2263,115 @@ VOID VmmWinHandle_InitializeText_DoWork(_In_ PVMM_PROCESS pSystemProcess, _In_ P
                     !(pus64->Length & 1) && (pus64->Length < (2 * MAX_PATH)) && (pus64->Length <= pus64->MaximumLength) &&
                     VMM_KADDR64(pus64->Buffer);
                 if(f) {
-                    cbMultiText += pus64->Length + 2;
                     pe->_Reserved1 = pus64->Length;
                     pe->_Reserved2 = pus64->Buffer;
-                    ObVSet_Push(psObPrefetch, pus64->Buffer);
                 }
             }
         }
+        // prefetch object name unless already cached
+        if(pe->_Reserved2 && ((pe->dwPoolTag & 0x00ffffff) != 'rhT')) {
+            if((pObText = VmmWinHandle_TextCache_Get(pe))) {
+                Ob_DECREF(pObText);
+            } else {
+                ObVSet_Push(ctx->psObPrefetch, pe->_Reserved2);
+            }
+        }
     }
-    // create and fill text descriptions
-    pHandleMap->wszMultiText = (LPWSTR)pbMultiText = LocalAlloc(LMEM_ZEROINIT, cbMultiText);
-    if(!pHandleMap->wszMultiText) { goto fail; }
-    pHandleMap->cbMultiText = cbMultiText;
-    VmmCachePrefetchPages3(pSystemProcess, psObPrefetch, MAX_PATH * 2, 0);
-    for(i = 0; i < pHandleMap->cMap; i++) {
-        pe = pHandleMap->pMap + i;
+}
+
+/*
+* Fill the text descriptions of a chunk of handles into the already allocated
+* and laid out multi-text buffer. Called in parallel by VmmWorkParallel.
+* -- ctx
+* -- iChunk
+*/
+VOID VmmWinHandle_InitializeText_TextCB(_In_ PVMMWIN_INITIALIZE_HANDLETEXT_CONTEXT ctx, _In_ DWORD iChunk)
+{
+    DWORD i, iMax;
+    PBYTE pbText;
+    PVMM_MAP_HANDLEENTRY pe;
+    PVMM_PROCESS pObProcessHnd;
+    PVMMWINOB_HANDLE_TEXT pObText;
+    i = iChunk * VMMWIN_HANDLE_WORK_CHUNK;
+    iMax = min(i + VMMWIN_HANDLE_WORK_CHUNK, ctx->pHandleMap->cMap);
+    for(; i < iMax; i++) {
+        pe = ctx->pHandleMap->pMap + i;
+        pe->wszText = (LPWSTR)ctx->pbMultiText;
+        if(!ctx->poMultiText[i]) { continue; }
+        pbText = ctx->pbMultiText + ctx->poMultiText[i];
         if((pe->dwPoolTag & 0x00ffffff) == 'orP') {         // PROCESS
-            if((pe->_Reserved1 < 99999) && (pObProcessHnd = VmmProcessGet(pe->_Reserved1))) {
-                pe->cwszText = swprintf_s((LPWSTR)(pbMultiText + ocbMultiText), 32, L"PID %i - %S", pObProcessHnd->dwPID, pObProcessHnd->szName);
-                pe->wszText = (LPWSTR)(pbMultiText + ocbMultiText);
-                ocbMultiText += 31 * sizeof(WCHAR) + 2;
+            if((pObProcessHnd = VmmProcessGet(pe->_Reserved1))) {
+                pe->cwszText = swprintf_s((LPWSTR)pbText, 32, L"PID %i - %S", pObProcessHnd->dwPID, pObProcessHnd->szName);
+                pe->wszText = (LPWSTR)pbText;
                 Ob_DECREF_NULL(&pObProcessHnd);
-            } else {
-                pe->wszText = (LPWSTR)pbMultiText;
             }
         } else if((pe->dwPoolTag & 0x00ffffff) == 'rhT') {   // THREAD
+            pe->cwszText = swprintf_s((LPWSTR)pbText, 12, L"TID %i", pe->_Reserved1);
+            pe->wszText = (LPWSTR)pbText;
+        } else if((pObText = VmmWinHandle_TextCache_Get(pe))) {
+            memcpy(pbText, pObText->wsz, pe->_Reserved1);
+            pe->cwszText = pe->_Reserved1 >> 1;
+            pe->wszText = (LPWSTR)pbText;
+            Ob_DECREF(pObText);
+        } else if(VmmRead2(ctx->pSystemProcess, pe->_Reserved2, pbText, pe->_Reserved1, VMM_FLAG_FORCECACHE_READ)) {
+            pe->cwszText = pe->_Reserved1 >> 1;
+            pe->wszText = (LPWSTR)pbText;
+            VmmWinHandle_TextCache_Put(pe, pbText);
+        }
+    }
+}
+
+VOID VmmWinHandle_InitializeText_DoWork(_In_ PVMM_PROCESS pSystemProcess, _In_ PVMMOB_MAP_HANDLE pHandleMap)
+{
+    DWORD i, cChunks, cbMultiText = 4, ocbMultiText = 2;
+    PVMM_MAP_HANDLEENTRY pe;
+    VMMWIN_INITIALIZE_HANDLETEXT_CONTEXT ctx = { 0 };
+    ctx.pSystemProcess = pSystemProcess;
+    ctx.pHandleMap = pHandleMap;
+    ctx.fThreadingEnabled = (ctxVmm->kernel.ThreadInfo.oCid > 0);
+    ctx.cbObjectRead = max(ctxVmm->kernel.OffsetEPROCESS.PID + 0x08, ctxVmm->kernel.ThreadInfo.oCid + 0x20);
+    ctx.cbObjectRead = 0x90 + max(0x70, ctx.cbObjectRead);
+    cChunks = (pHandleMap->cMap + VMMWIN_HANDLE_WORK_CHUNK - 1) / VMMWIN_HANDLE_WORK_CHUNK;
+    if(!(ctx.poMultiText = LocalAlloc(LMEM_ZEROINIT, (pHandleMap->cMap + 1ULL) * sizeof(DWORD)))) { goto fail; }
+    // 1: cache prefetch object data
+    if(!(ctx.psObPrefetch = ObVSet_New())) { goto fail; }
+    for(i = 0; i < pHandleMap->cMap; i++) {
+        ObVSet_Push(ctx.psObPrefetch, pHandleMap->pMap[i].vaObject - 0x90);
+    }
+    VmmCachePrefetchPages3(pSystemProcess, ctx.psObPrefetch, ctx.cbObjectRead, 0);
+    ObVSet_Clear(ctx.psObPrefetch);
+    // 2: read and interpret object data in parallel
+    VmmWorkParallel(&ctx, cChunks, (VOID(*)(PVOID, DWORD))VmmWinHandle_InitializeText_ObjectCB);
+    // 3: lay out text descriptions - sizes must match what is written by the
+    //    text callback; 0 offset means no text (empty string).
+    for(i = 0; i < pHandleMap->cMap; i++) {
+        pe = pHandleMap->pMap + i;
+        if((pe->dwPoolTag & 0x00ffffff) == 'orP') {
+            if(pe->_Reserved1 < 99999) {
+                ctx.poMultiText[i] = ocbMultiText;
+                ocbMultiText += 31 * sizeof(WCHAR) + 2;
+            }
+        } else if((pe->dwPoolTag & 0x00ffffff) == 'rhT') {
             if(pe->_Reserved1 && (pe->_Reserved1 < 99999)) {
-                pe->cwszText = swprintf_s((LPWSTR)(pbMultiText + ocbMultiText), 12, L"TID %i", pe->_Reserved1);
-                pe->wszText = (LPWSTR)(pbMultiText + ocbMultiText);
+                ctx.poMultiText[i] = ocbMultiText;
                 ocbMultiText += 11 * sizeof(WCHAR) + 2;
-            } else {
-                pe->wszText = (LPWSTR)pbMultiText;
             }
         } else if(pe->_Reserved2) {
-            if(VmmRead2(pSystemProcess, pe->_Reserved2, pbMultiText + ocbMultiText, pe->_Reserved1, VMM_FLAG_FORCECACHE_READ)) {
-                pe->cwszText = pe->_Reserved1 >> 1;
-                pe->wszText = (LPWSTR)(pbMultiText + ocbMultiText);
-                ocbMultiText += pe->_Reserved1 + 2;
-            }
-        } else {
-            pe->wszText = (LPWSTR)pbMultiText;
+            ctx.poMultiText[i] = ocbMultiText;
+            ocbMultiText += pe->_Reserved1 + 2;
         }
     }
+    cbMultiText = ocbMultiText + 2;
+    // 4: create and fill text descriptions in parallel
+    if(!(ctx.pbMultiText = LocalAlloc(LMEM_ZEROINIT, cbMultiText))) { goto fail; }
+    VmmCachePrefetchPages3(pSystemProcess, ctx.psObPrefetch, MAX_PATH * 2, 0);
+    VmmWorkParallel(&ctx, cChunks, (VOID(*)(PVOID, DWORD))VmmWinHandle_InitializeText_TextCB);
+    pHandleMap->cbMultiText = cbMultiText;
+    pHandleMap->wszMultiText = (LPWSTR)ctx.pbMultiText;
     // fall-through
 fail:
-    Ob_DECREF(psObPrefetch);
+    LocalFree(ctx.poMultiText);
+    Ob_DECREF(ctx.psObPrefetch);
 }
 
 VOID VmmWinHandle_InitializeCore_DoWork(_In_ PVMM_PROCESS pSystemProcess, _In_ PVMM_PROCESS pProcess)
@@ -1786,8 +2380,9 @@ VOID VmmWinHandle_InitializeCore_DoWork(_In_ PVMM_PROCESS pSystemProcess, _In_ P
     BOOL f32 = ctxVmm->f32;
     BYTE pb[0x20], iLevel;
     WORD oTableCode;
-    DWORD i, cHandles, iHandleMap = 0;
-    QWORD vaHandleTable = 0, vaTableCode = 0;
+    DWORD i, cHandles, cTableHandles;
+    QWORD vaHandleTable = 0, vaTableCode = 0, qwHash = VMMWIN_MAPHASH_SEED;
+    PVMM_MAP_HANDLEENTRY pe;
     VMMWIN_INITIALIZE_HANDLE_CONTEXT ctx = { 0 };
     PVMMOB_MAP_HANDLE pObHandleMap = NULL;
     ctx.pSystemProcess = pSystemProcess;
@@ -1808,18 +2403,31 @@ VOID VmmWinHandle_InitializeCore_DoWork(_In_ PVMM_PROCESS pSystemProcess, _In_ P
         ctx.cTables = 1;
         ctx.pvaTables[0] = vaTableCode;
     }
-    // count handles and allocate map
-    if(!(cHandles = VmmWinHandle_InitializeCore_CountHandles(&ctx))) { goto fail; }
-    cHandles = min(cHandles, 256 * 1024);
+    // count handles (per table) and allocate map
+    if(!(ctx.piMapTable = LocalAlloc(LMEM_ZEROINIT, (ctx.cTables + 1ULL) * sizeof(DWORD)))) { goto fail; }
+    VmmCachePrefetchPages4(pSystemProcess, ctx.cTables, ctx.pvaTables, 0x1000, 0);
+    VmmWorkParallel(&ctx, ctx.cTables, (VOID(*)(PVOID, DWORD))VmmWinHandle_InitializeCore_CountHandlesCB);
+    for(i = 0, cHandles = 0; i <= ctx.cTables; i++) {
+        cTableHandles = ctx.piMapTable[i];
+        ctx.piMapTable[i] = cHandles;
+        cHandles = min(cHandles + cTableHandles, 256 * 1024);
+    }
+    if(!cHandles) { goto fail; }
     ctx.pHandleMap = pObHandleMap = Ob_Alloc(OB_TAG_MAP_HANDLE, LMEM_ZEROINIT, sizeof(VMMOB_MAP_HANDLE) + cHandles * sizeof(VMM_MAP_HANDLEENTRY), VmmWinHandle_CloseObCallback, NULL);
     if(!pObHandleMap) { goto fail; }
     pObHandleMap->cMap = cHandles;
-    // walk handle tables to fill map with core handle information
-    for(i = 0; i < ctx.cTables; i++) {
-        VmmWinHandle_InitializeCore_ReadHandleTable(&ctx, ctx.pvaTables[i], i * (f32 ? 2048 : 1024));
-    }
+    // walk handle tables in parallel to fill map with core handle information
+    VmmWorkParallel(&ctx, ctx.cTables, (VOID(*)(PVOID, DWORD))VmmWinHandle_InitializeCore_ReadHandleTableCB);
+    // generation: retained if the handles are unchanged since the previous build
+    for(i = 0; i < pObHandleMap->cMap; i++) {
+        pe = pObHandleMap->pMap + i;
+        qwHash = VmmWin_MapHash(qwHash, pe->vaObject);
+        qwHash = VmmWin_MapHash(qwHash, ((QWORD)pe->dwGrantedAccess << 32) | pe->dwHandle);
+    }
+    pObHandleMap->qwGeneration = VmmNotify_MapGeneration(pProcess, VMM_NOTIFY_MAP_HANDLE, &pProcess->pObPersistent->MapGeneration.Handle, qwHash);
     pProcess->Map.pObHandle = Ob_INCREF(pObHandleMap);
 fail:
+    LocalFree(ctx.piMapTable);
     LocalFree(ctx.pvaTables);
     Ob_DECREF(pObHandleMap);
 }
@@ -1833,7 +2441,9 @@ BOOL VmmWinHandle_InitializeCore(_In_ PVMM_PROCESS pProcess)
     if(!pProcess->Map.pObHandle && (pObSystemProcess = VmmProcessGet(4))) {
         VmmWinHandle_InitializeCore_DoWork(pObSystemProcess, pProcess);
         if(!pProcess->Map.pObHandle) {
-            pProcess->Map.pObHandle = Ob_Alloc(OB_TAG_MAP_HANDLE, LMEM_ZEROINIT, sizeof(VMMOB_MAP_HANDLE), VmmWinHandle_CloseObCallback, NULL);
+            if((pProcess->Map.pObHandle = Ob_Alloc(OB_TAG_MAP_HANDLE, LMEM_ZEROINIT, sizeof(VMMOB_MAP_HANDLE), VmmWinHandle_CloseObCallback, NULL))) {
+                pProcess->Map.pObHandle->qwGeneration = VmmNotify_MapGeneration(pProcess, VMM_NOTIFY_MAP_HANDLE, &pProcess->pObPersistent->MapGeneration.Handle, VMMWIN_MAPHASH_SEED);
+            }
         }
         Ob_DECREF(pObSystemProcess);
     }
@@ -2620,14 +3230,192 @@ BOOL VmmWin_EnumerateEPROCESS(_In_ PVMM_PROCESS pSystemProcess, _In_ BOOL fRefre
 
 #define VMMWIN_LISTTRAVERSEPREFETCH_LOOPPROTECT_MAX         0x1000
 
+typedef struct tdVMMWIN_LISTTRAVERSE_STATE {
+    PVMMWIN_LISTTRAVERSE pl;
+    PBYTE pbData;
+    POB_VSET psAll;             // all addresses (incl. additional from pfnCallback_Pre)
+    POB_VSET psFrontier;        // entries to visit in the current step
+    POB_VSET psNext;            // entries to visit in the next step
+    POB_VSET psValid;           // valid entries
+} VMMWIN_LISTTRAVERSE_STATE, *PVMMWIN_LISTTRAVERSE_STATE;
+
+/*
+* Prefetch the addresses in ppsAddress (one optional address set per list)
+* with one scatter read per process - lists in the same process are merged.
+* -- cLists
+* -- pStates
+* -- ppsAddress
+*/
+VOID VmmWin_ListTraverse_Prefetch(_In_ DWORD cLists, _In_reads_(cLists) PVMMWIN_LISTTRAVERSE_STATE pStates, _In_reads_(cLists) POB_VSET *ppsAddress)
+{
+    PQWORD pva;
+    DWORD i, j, iva, cva;
+    POB_VSET psObPages;
+    for(i = 0; i < cLists; i++) {
+        if(!ObVSet_Size(ppsAddress[i])) { continue; }
+        for(j = 0; j < i; j++) {
+            if(ObVSet_Size(ppsAddress[j]) && (pStates[j].pl->pProcess == pStates[i].pl->pProcess)) { break; }
+        }
+        if(j < i) { continue; }     // already prefetched together with list j
+        if(!(psObPages = ObVSet_New())) { return; }
+        ObVSet_BuilderMode(psObPages, TRUE);
+        for(j = i; j < cLists; j++) {
+            if(pStates[j].pl->pProcess != pStates[i].pl->pProcess) { continue; }
+            if(!(pva = ObVSet_GetSorted(ppsAddress[j], &cva))) { continue; }
+            for(iva = 0; iva < cva; iva++) {
+                ObVSet_Push_PageAlign(psObPages, pva[iva], pStates[j].pl->cbData);
+            }
+            LocalFree(pva);
+        }
+        VmmCachePrefetchPages(pStates[i].pl->pProcess, psObPages, 0);
+        Ob_DECREF(psObPages);
+    }
+}
+
+/*
+* Analyze a single list entry already read into ps->pbData and queue its not
+* yet seen FLink/BLink neighbours for the next step.
+* -- ps
+* -- vaData
+*/
+VOID VmmWin_ListTraverse_Entry(_In_ PVMMWIN_LISTTRAVERSE_STATE ps, _In_ QWORD vaData)
+{
+    PVMMWIN_LISTTRAVERSE pl = ps->pl;
+    QWORD vaFLink, vaBLink;
+    BOOL fValidEntry, fValidFLink, fValidBLink;
+    vaFLink = pl->f32 ? *(PDWORD)(ps->pbData + pl->oListStart + 0) : *(PQWORD)(ps->pbData + pl->oListStart + 0);
+    vaBLink = pl->f32 ? *(PDWORD)(ps->pbData + pl->oListStart + 4) : *(PQWORD)(ps->pbData + pl->oListStart + 8);
+    if(pl->pfnCallback_Pre) {
+        fValidEntry = FALSE; fValidFLink = FALSE; fValidBLink = FALSE;
+        pl->pfnCallback_Pre(pl->pProcess, pl->ctx, vaData, ps->pbData, pl->cbData, vaFLink, vaBLink, ps->psAll, &fValidEntry, &fValidFLink, &fValidBLink);
+    } else {
+        if(pl->f32) {
+            fValidFLink = !(vaFLink & 0x03);
+            fValidBLink = !(vaBLink & 0x03);
+        } else {
+            fValidFLink = VMM_KADDR64_8(vaFLink) || VMM_UADDR64_8(vaFLink);
+            fValidBLink = VMM_KADDR64_8(vaBLink) || VMM_UADDR64_8(vaBLink);
+        }
+        fValidEntry = fValidFLink || fValidBLink;
+    }
+    if(fValidEntry) {
+        ObVSet_Push(ps->psValid, vaData);
+    }
+    vaFLink -= pl->oListStart;
+    vaBLink -= pl->oListStart;
+    if(fValidFLink && !ObVSet_Exists(ps->psAll, vaFLink)) {
+        ObVSet_Push(ps->psAll, vaFLink);
+        ObVSet_Push(ps->psNext, vaFLink);
+    }
+    if(fValidBLink && !ObVSet_Exists(ps->psAll, vaBLink)) {
+        ObVSet_Push(ps->psAll, vaBLink);
+        ObVSet_Push(ps->psNext, vaBLink);
+    }
+}
+
+VOID VmmWin_ListTraversePrefetchMulti(_In_ DWORD cLists, _In_reads_(cLists) PVMMWIN_LISTTRAVERSE pLists)
+{
+    QWORD vaData;
+    DWORD i, j, cbReadData;
+    BOOL fFrontier;
+    POB_VSET psSwap, *pps = NULL;
+    PVMMWIN_LISTTRAVERSE pl;
+    PVMMWIN_LISTTRAVERSE_STATE ps, pStates = NULL;
+    if(!cLists) { return; }
+    if(!(pStates = LocalAlloc(LMEM_ZEROINIT, cLists * (sizeof(VMMWIN_LISTTRAVERSE_STATE) + sizeof(POB_VSET))))) { return; }
+    pps = (POB_VSET*)(pStates + cLists);
+    for(i = 0; i < cLists; i++) {
+        pStates[i].pl = pLists + i;
+    }
+    // 1: Prefetch any addresses stored in optional address containers
+    for(i = 0; i < cLists; i++) {
+        pps[i] = ObContainer_GetOb(pLists[i].pPrefetchAddressContainer);
+    }
+    VmmWin_ListTraverse_Prefetch(cLists, pStates, pps);
+    for(i = 0; i < cLists; i++) {
+        Ob_DECREF_NULL(&pps[i]);
+    }
+    // 2: Prepare/Allocate and set up initial entries
+    for(i = 0; i < cLists; i++) {
+        ps = pStates + i;
+        pl = ps->pl;
+        if(!(ps->psAll = ObVSet_New())) { goto fail; }
+        if(!(ps->psFrontier = ObVSet_New())) { goto fail; }
+        if(!(ps->psNext = ObVSet_New())) { goto fail; }
+        if(!(ps->psValid = ObVSet_New())) { goto fail; }
+        if(!(ps->pbData = LocalAlloc(0, pl->cbData))) { goto fail; }
+        // sets are only accessed by this thread until psAll is published in
+        // the optional prefetch address container - no locking is required.
+        ObVSet_BuilderMode(ps->psAll, TRUE);
+        ObVSet_BuilderMode(ps->psFrontier, TRUE);
+        ObVSet_BuilderMode(ps->psNext, TRUE);
+        ObVSet_BuilderMode(ps->psValid, TRUE);
+        ObVSet_PushBatch(ps->psAll, pl->cvaDataStart, pl->pvaDataStart);
+        ObVSet_PushBatch(ps->psFrontier, pl->cvaDataStart, pl->pvaDataStart);
+    }
+    // 3: Step-wise list walk. The frontier of all lists is prefetched in one
+    //    go. Entries still not in the cache (e.g. paged) are read one by one.
+    while(TRUE) {
+        fFrontier = FALSE;
+        for(i = 0; i < cLists; i++) {
+            pps[i] = pStates[i].psFrontier;
+            fFrontier = fFrontier || ObVSet_Size(pps[i]);
+        }
+        if(!fFrontier) { break; }
+        VmmWin_ListTraverse_Prefetch(cLists, pStates, pps);
+        for(i = 0; i < cLists; i++) {
+            ps = pStates + i;
+            pl = ps->pl;
+            while((vaData = ObVSet_Pop(ps->psFrontier))) {
+                VmmReadEx(pl->pProcess, vaData, ps->pbData, pl->cbData, &cbReadData, VMM_FLAG_FORCECACHE_READ);
+                if((cbReadData != pl->cbData) && !VmmRead(pl->pProcess, vaData, ps->pbData, pl->cbData)) { continue; }
+                VmmWin_ListTraverse_Entry(ps, vaData);
+            }
+            psSwap = ps->psFrontier;
+            ps->psFrontier = ps->psNext;
+            ps->psNext = psSwap;
+        }
+    }
+    // 4: Prefetch additional gathered addresses into cache.
+    for(i = 0; i < cLists; i++) {
+        pps[i] = pStates[i].psAll;
+    }
+    VmmWin_ListTraverse_Prefetch(cLists, pStates, pps);
+    // 5: 2nd main list walk. Call into optional pfnCallback_Post to do the main
+    //    processing of the list items.
+    for(i = 0; i < cLists; i++) {
+        ps = pStates + i;
+        pl = ps->pl;
+        if(pl->pfnCallback_Post) {
+            while((vaData = ObVSet_Pop(ps->psValid))) {
+                if(VmmRead(pl->pProcess, vaData, ps->pbData, pl->cbData)) {
+                    pl->pfnCallback_Post(pl->pProcess, pl->ctx, vaData, ps->pbData, pl->cbData);
+                }
+            }
+        }
+        // 6: Store/Update the optional container with the newly prefetch addresses (if possible and desirable).
+        if(pl->pPrefetchAddressContainer && ctxMain->dev.fVolatile && ctxVmm->ThreadProcCache.fEnabled) {
+            ObVSet_BuilderMode(ps->psAll, FALSE);
+            ObContainer_SetOb(pl->pPrefetchAddressContainer, ps->psAll);
+        }
+    }
+fail:
+    // 7: Cleanup
+    for(i = 0; i < cLists; i++) {
+        ps = pStates + i;
+        Ob_DECREF(ps->psAll);
+        Ob_DECREF(ps->psFrontier);
+        Ob_DECREF(ps->psNext);
+        Ob_DECREF(ps->psValid);
+        LocalFree(ps->pbData);
+    }
+    LocalFree(pStates);
+}
+
 /*
 * Walk a windows linked list in an efficient way that minimize IO requests to
-* the the device. This is advantageous for latency reasons. The function return
-* a set of the addresses used - this may be used to prefetch pages in advance
-* if the list should be walked again at a later time.
-* The callback function must only return FALSE on severe errors when the list
-* should no longer be continued to be walked in the direction.
-* CALLER_DECREF: return
+* the the device. This is advantageous for latency reasons. The list is walked
+* as a single list by VmmWin_ListTraversePrefetchMulti.
 * -- pProcess
 * -- f32
 * -- ctx = ctx to pass along to callback function (if any)
@@ -2651,98 +3439,16 @@ VOID VmmWin_ListTraversePrefetch(
     _In_opt_ VOID(*pfnCallback_Post)(_In_ PVMM_PROCESS pProcess, _In_opt_ PVOID ctx, _In_ QWORD va, _In_ PBYTE pb, _In_ DWORD cb),
     _In_opt_ POB_CONTAINER pPrefetchAddressContainer)
 {
-    QWORD vaData;
-    DWORD cbReadData;
-    PBYTE pbData = NULL;
-    QWORD vaFLink, vaBLink;
-    POB_VSET pObVSet_vaAll = NULL, pObVSet_vaTry1 = NULL, pObVSet_vaTry2 = NULL, pObVSet_vaValid = NULL;
-    BOOL fValidEntry, fValidFLink, fValidBLink, fTry1;
-    // 1: Prefetch any addresses stored in optional address container
-    pObVSet_vaAll = ObContainer_GetOb(pPrefetchAddressContainer);
-    VmmCachePrefetchPages3(pProcess, pObVSet_vaAll, cbData, 0);
-    Ob_DECREF_NULL(&pObVSet_vaAll);
-    // 2: Prepare/Allocate and set up initial entry
-    if(!(pObVSet_vaAll = ObVSet_New())) { goto fail; }
-    if(!(pObVSet_vaTry1 = ObVSet_New())) { goto fail; }
-    if(!(pObVSet_vaTry2 = ObVSet_New())) { goto fail; }
-    if(!(pObVSet_vaValid = ObVSet_New())) { goto fail; }
-    if(!(pbData = LocalAlloc(0, cbData))) { goto fail; }
-    while(cvaDataStart) {
-        cvaDataStart--;
-        ObVSet_Push(pObVSet_vaAll, pvaDataStart[cvaDataStart]);
-        ObVSet_Push(pObVSet_vaTry1, pvaDataStart[cvaDataStart]);
-    }
-    // 3: Initial list walk
-    fTry1 = TRUE;
-    while(TRUE) {
-        if(fTry1) {
-            vaData = ObVSet_Pop(pObVSet_vaTry1);
-            if(!vaData && (0 == ObVSet_Size(pObVSet_vaTry2))) { break; }
-            if(!vaData) {
-                VmmCachePrefetchPages3(pProcess, pObVSet_vaAll, cbData, 0);
-                fTry1 = FALSE;
-                continue;
-            }
-            VmmReadEx(pProcess, vaData, pbData, cbData, &cbReadData, VMM_FLAG_FORCECACHE_READ);
-            if(cbReadData != cbData) {
-                ObVSet_Push(pObVSet_vaTry2, vaData);
-                continue;
-            }
-        } else {
-            vaData = ObVSet_Pop(pObVSet_vaTry2);
-            if(!vaData && (0 == ObVSet_Size(pObVSet_vaTry1))) { break; }
-            if(!vaData) { fTry1 = TRUE; continue; }
-            if(!VmmRead(pProcess, vaData, pbData, cbData)) { continue; }
-        }
-        vaFLink = f32 ? *(PDWORD)(pbData + oListStart + 0) : *(PQWORD)(pbData + oListStart + 0);
-        vaBLink = f32 ? *(PDWORD)(pbData + oListStart + 4) : *(PQWORD)(pbData + oListStart + 8);
-        if(pfnCallback_Pre) {
-            fValidEntry = FALSE; fValidFLink = FALSE; fValidBLink = FALSE;
-            pfnCallback_Pre(pProcess, ctx, vaData, pbData, cbData, vaFLink, vaBLink, pObVSet_vaAll, &fValidEntry, &fValidFLink, &fValidBLink);
-        } else {
-            if(f32) {
-                fValidFLink = !(vaFLink & 0x03);
-                fValidBLink = !(vaBLink & 0x03);
-            } else {
-                fValidFLink = VMM_KADDR64_8(vaFLink) || VMM_UADDR64_8(vaFLink);
-                fValidBLink = VMM_KADDR64_8(vaBLink) || VMM_UADDR64_8(vaBLink);
-            }
-            fValidEntry = fValidFLink || fValidBLink;
-        }
-        if(fValidEntry) {
-            ObVSet_Push(pObVSet_vaValid, vaData);
-        }
-        vaFLink -= oListStart;
-        vaBLink -= oListStart;
-        if(fValidFLink && !ObVSet_Exists(pObVSet_vaAll, vaFLink)) {
-            ObVSet_Push(pObVSet_vaAll, vaFLink);
-            ObVSet_Push(pObVSet_vaTry1, vaFLink);
-        }
-        if(fValidBLink && !ObVSet_Exists(pObVSet_vaAll, vaBLink)) {
-            ObVSet_Push(pObVSet_vaAll, vaBLink);
-            ObVSet_Push(pObVSet_vaTry1, vaBLink);
-        }
-    }
-    // 4: Prefetch additional gathered addresses into cache.
-    VmmCachePrefetchPages3(pProcess, pObVSet_vaAll, cbData, 0);
-    // 5: 2nd main list walk. Call into optional pfnCallback_Post to do the main
-    //    processing of the list items.
-    if(pfnCallback_Post) {
-        while((vaData = ObVSet_Pop(pObVSet_vaValid))) {
-            if(VmmRead(pProcess, vaData, pbData, cbData)) {
-                pfnCallback_Post(pProcess, ctx, vaData, pbData, cbData);
-            }
-        }
-    }
-    // 6: Store/Update the optional container with the newly prefetch addresses (if possible and desirable).
-    if(pPrefetchAddressContainer && ctxMain->dev.fVolatile && ctxVmm->ThreadProcCache.fEnabled) {
-        ObContainer_SetOb(pPrefetchAddressContainer, pObVSet_vaAll);
-    }
-fail:
-    // 7: Cleanup
-    Ob_DECREF_NULL(&pObVSet_vaAll);
-    Ob_DECREF_NULL(&pObVSet_vaTry1);
-    Ob_DECREF_NULL(&pObVSet_vaTry2);
-    Ob_DECREF_NULL(&pObVSet_vaValid);
-    LocalFree(pbData);
+    VMMWIN_LISTTRAVERSE l = { 0 };
+    l.pProcess = pProcess;
+    l.f32 = f32;
+    l.ctx = ctx;
+    l.cvaDataStart = cvaDataStart;
+    l.pvaDataStart = pvaDataStart;
+    l.oListStart = oListStart;
+    l.cbData = cbData;
+    l.pfnCallback_Pre = pfnCallback_Pre;
+    l.pfnCallback_Post = pfnCallback_Post;
+    l.pPrefetchAddressContainer = pPrefetchAddressContainer;
+    VmmWin_ListTraversePrefetchMulti(1, &l);
 }
@@ -120,6 +120,66 @@ BOOL VmmWin_InitializeLdrModules(_In_ PVMM_PROCESS pProcess);
 */
 BOOL VmmWinHeap_Initialize(_In_ PVMM_PROCESS pProcess);
 
+#define VMMWINHEAP_ITERATOR_PAGES       0x20    // pages read per batched window
+#define VMMWINHEAP_ITERATOR_ENTRIES     0x400   // max decoded entries per window
+#define VMMWINHEAP_ITERATOR_UCR_MAX     0x40    // max uncommitted ranges per segment
+
+// NB! layout must be identical to VMMDLL_HEAP_ENTRY.
+typedef struct tdVMMWINHEAP_ENTRY {
+    QWORD va;                       // heap entry (header) address
+    DWORD cb;                       // block size including header
+    DWORD dwFlags;                  // decoded heap entry flags
+    DWORD HeapId;
+    DWORD iSegment;                 // index of segment in the heap map
+    BOOL fBusy;                     // allocated block
+    DWORD _Reserved;
+} VMMWINHEAP_ENTRY, *PVMMWINHEAP_ENTRY;
+
+typedef struct tdVMMOB_WINHEAP_ITERATOR {
+    OB ObHdr;
+    PVMM_PROCESS pProcess;
+    PVMMOB_MAP_HEAP pHeapMap;
+    BOOL f32;
+    BOOL fSegmentActive;
+    DWORD iSegment;
+    DWORD iSegmentNext;
+    QWORD vaNext;                   // next entry in current segment
+    QWORD vaEnd;                    // end of current segment
+    QWORD vaHeapEncoding;           // heap of the encoding key below
+    BOOL fEncoded;
+    QWORD qwEncoding;
+    DWORD cUcr;
+    struct {
+        QWORD va;
+        QWORD cb;
+    } Ucr[VMMWINHEAP_ITERATOR_UCR_MAX];
+    DWORD cEntry;
+    DWORD iEntry;
+    VMMWINHEAP_ENTRY Entry[VMMWINHEAP_ITERATOR_ENTRIES];
+    BYTE pb[VMMWINHEAP_ITERATOR_PAGES << 12];
+} VMMOB_WINHEAP_ITERATOR, *PVMMOB_WINHEAP_ITERATOR;
+
+/*
+* Create a lazy iterator over the heap entries of all heap segments in the
+* heap map of a process. Segments are walked on demand - each segment is read
+* in batched windows of VMMWINHEAP_ITERATOR_PAGES pages and all entry headers
+* (encoded headers included) in a window are decoded in bulk. Pages containing
+* only the body of a large block are never read. Back-end (NT) heap only.
+* CALLER DECREF: return
+* -- pProcess
+* -- return
+*/
+PVMMOB_WINHEAP_ITERATOR VmmWinHeap_EntryIterator(_In_ PVMM_PROCESS pProcess);
+
+/*
+* Retrieve the next heap entry from a heap entry iterator.
+* -- it
+* -- pEntry
+* -- return = FALSE when no more entries exist.
+*/
+_Success_(return)
+BOOL VmmWinHeap_EntryNext(_In_ PVMMOB_WINHEAP_ITERATOR it, _Out_ PVMMWINHEAP_ENTRY pEntry);
+
 /*
 * Initialize the thread map for a specific process.
 * NB! The threading sub-system is dependent on pdb symbols and may take a small
@@ -130,6 +190,14 @@ BOOL VmmWinHeap_Initialize(_In_ PVMM_PROCESS pProcess);
 */
 BOOL VmmWinThread_Initialize(_In_ PVMM_PROCESS pProcess, _In_ BOOL fNonBlocking);
 
+/*
+* Initialize the thread maps of all processes which don't already have one in
+* a single batched pass. The thread lists of all processes are walked at the
+* same time after which the per-process TEB reads are performed in parallel.
+* Processes which currently are being initialized by another thread are skipped.
+*/
+VOID VmmWinThread_InitializeAll();
+
 /*
 * Initialize Handles for a specific process. Extended information text may take
 * extra time to initialize.
@@ -160,6 +228,36 @@ PVMMWIN_OBJECT_TYPE VmmWin_ObjectTypeGet(_In_ BYTE iObjectType);
 */
 BOOL VmmWin_EnumerateEPROCESS(_In_ PVMM_PROCESS pSystemProcess, _In_ BOOL fRefreshTotal);
 
+typedef VOID(*VMMWIN_LISTTRAVERSE_PRE_CB)(_In_ PVMM_PROCESS pProcess, _In_opt_ PVOID ctx, _In_ QWORD va, _In_ PBYTE pb, _In_ DWORD cb, _In_ QWORD vaFLink, _In_ QWORD vaBLink, _In_ POB_VSET pVSetAddress, _Inout_ PBOOL pfValidEntry, _Inout_ PBOOL pfValidFLink, _Inout_ PBOOL pfValidBLink);
+typedef VOID(*VMMWIN_LISTTRAVERSE_POST_CB)(_In_ PVMM_PROCESS pProcess, _In_opt_ PVOID ctx, _In_ QWORD va, _In_ PBYTE pb, _In_ DWORD cb);
+
+// Description of one linked list to walk with VmmWin_ListTraversePrefetchMulti.
+// The members correspond to the arguments of VmmWin_ListTraversePrefetch.
+typedef struct tdVMMWIN_LISTTRAVERSE {
+    PVMM_PROCESS pProcess;
+    BOOL f32;
+    PVOID ctx;
+    DWORD cvaDataStart;
+    PQWORD pvaDataStart;
+    DWORD oListStart;
+    DWORD cbData;
+    VMMWIN_LISTTRAVERSE_PRE_CB pfnCallback_Pre;
+    VMMWIN_LISTTRAVERSE_POST_CB pfnCallback_Post;
+    POB_CONTAINER pPrefetchAddressContainer;
+} VMMWIN_LISTTRAVERSE, *PVMMWIN_LISTTRAVERSE;
+
+/*
+* Walk multiple independent windows linked lists at the same time. All lists
+* are walked in both directions (FLink and BLink) one step at a time; in each
+* step the frontier of all lists is fetched with one scatter read per process
+* before the entries are analyzed. This keeps the number of dependent device
+* round trips down to the length of the longest list half instead of the sum
+* of the lists. Callbacks are called as described in VmmWin_ListTraversePrefetch.
+* -- cLists
+* -- pLists
+*/
+VOID VmmWin_ListTraversePrefetchMulti(_In_ DWORD cLists, _In_reads_(cLists) PVMMWIN_LISTTRAVERSE pLists);
+
 /*
 * Walk a windows linked list in an efficient way that minimize IO requests to
 * the the device. This is advantageous for latency reasons. The function return
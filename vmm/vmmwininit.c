@@ -11,8 +11,12 @@
 #include "pe.h"
 #include "pdb.h"
 #include "util.h"
+#include "vmmprofile.h"
 #include "vmmwin.h"
 #include "vmmwinreg.h"
+#include <emmintrin.h>
+
+#define VMMWININIT_SCAN_THREADS_MAX         8
 
 /*
 * Try initialize threading - this is dependent on available PDB symbols.
@@ -108,6 +112,166 @@ VOID VmmWinInit_TryInitializeKernelOptionalValues()
     ctxVmm->kernel.opt.fInitialized = TRUE;
 }
 
+// ----------------------------------------------------------------------------
+// PARALLEL CHUNKED SCAN FUNCTIONALITY:
+// The initialization scans for the DTB and the ntoskrnl.exe base are split
+// into large contiguous chunks which are read and scanned in parallel. The
+// result of the lowest chunk with a candidate is kept - the same result as a
+// sequential scan would yield. Chunks above an already found candidate are
+// abandoned as soon as possible. The work pool may not be used at this stage
+// of the initialization (ThreadWorkers.fEnabled is not yet set) - dedicated
+// short-lived scan threads are used instead.
+// ----------------------------------------------------------------------------
+
+typedef struct tdVMMWININIT_SCAN_CONTEXT {
+    PBYTE pb;                       // buffer of cChunks * cbChunk bytes.
+    DWORD cbChunk;
+    DWORD cChunks;
+    volatile LONG iChunkNext;
+    volatile LONG iChunkFound;      // lowest chunk with a candidate (cChunks if none).
+    BOOL fRead;                     // read chunk (except chunk #0) before scan.
+    BOOL fNtHeaderReq;              // ntos scan: require valid NT header.
+    BOOL fTry;                      // ntos scan: accept MZ + POOLCODE try candidates.
+    DWORD cbPoolCodeScan;           // ntos scan: bytes of each page to scan for POOLCODE.
+    QWORD va;                       // base address of chunk #0.
+    PVMM_PROCESS pProcess;
+    BOOL(*pfnValidate)(_In_ QWORD pa, _In_reads_(0x1000) PBYTE pbPage);
+    BOOL(*pfnChunk)(_In_ struct tdVMMWININIT_SCAN_CONTEXT *ctx, _In_ DWORD iChunk, _Out_ PQWORD pqwResult);
+    PQWORD pqwResult;               // per-chunk results [cChunks].
+    PQWORD pqwTry;                  // per-chunk try candidates [cChunks].
+} VMMWININIT_SCAN_CONTEXT, *PVMMWININIT_SCAN_CONTEXT;
+
+/*
+* Scan thread: claim chunks in ascending order until all chunks are claimed or
+* a candidate has been found in a lower chunk.
+* -- ctx
+* -- return
+*/
+DWORD VmmWinInit_ScanParallel_ThreadProc(_In_ PVMMWININIT_SCAN_CONTEXT ctx)
+{
+    LONG i, iFound;
+    QWORD qwResult;
+    while(((i = InterlockedIncrement(&ctx->iChunkNext) - 1) < (LONG)ctx->cChunks) && (i < ctx->iChunkFound)) {
+        if(ctx->pfnChunk(ctx, i, &qwResult)) {
+            ctx->pqwResult[i] = qwResult;
+            while(((iFound = ctx->iChunkFound) > i) && (iFound != InterlockedCompareExchange(&ctx->iChunkFound, i, iFound)));
+        }
+    }
+    return 1;
+}
+
+/*
+* Execute a chunked scan in parallel on the calling thread and a number of
+* short-lived scan threads.
+* -- ctx
+* -- pqwResult = result of the lowest chunk with a candidate.
+* -- return
+*/
+_Success_(return)
+BOOL VmmWinInit_ScanParallel(_In_ PVMMWININIT_SCAN_CONTEXT ctx, _Out_ PQWORD pqwResult)
+{
+    DWORD i, cThreads = 0;
+    HANDLE hThreads[VMMWININIT_SCAN_THREADS_MAX - 1];
+    SYSTEM_INFO SystemInfo = { 0 };
+    *pqwResult = 0;
+    if(!ctx->cChunks || !(ctx->pqwResult = LocalAlloc(LMEM_ZEROINIT, 2ULL * ctx->cChunks * sizeof(QWORD)))) { return FALSE; }
+    ctx->pqwTry = ctx->pqwResult + ctx->cChunks;
+    ctx->iChunkNext = 0;
+    ctx->iChunkFound = ctx->cChunks;
+    GetSystemInfo(&SystemInfo);
+    while((cThreads + 1 < min(ctx->cChunks, min(VMMWININIT_SCAN_THREADS_MAX, SystemInfo.dwNumberOfProcessors))) &&
+        (hThreads[cThreads] = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)VmmWinInit_ScanParallel_ThreadProc, ctx, 0, NULL))) {
+        cThreads++;
+    }
+    VmmWinInit_ScanParallel_ThreadProc(ctx);
+    if(cThreads) {
+        WaitForMultipleObjects(cThreads, hThreads, TRUE, INFINITE);
+        for(i = 0; i < cThreads; i++) {
+            CloseHandle(hThreads[i]);
+        }
+    }
+    if(ctx->iChunkFound < (LONG)ctx->cChunks) {
+        *pqwResult = ctx->pqwResult[ctx->iChunkFound];
+    } else if(ctx->fTry) {
+        for(i = 0; i < ctx->cChunks; i++) {
+            if(ctx->pqwTry[i]) { *pqwResult = ctx->pqwTry[i]; }
+        }
+    }
+    LocalFree(ctx->pqwResult);
+    ctx->pqwResult = NULL;
+    ctx->pqwTry = NULL;
+    return *pqwResult ? TRUE : FALSE;
+}
+
+/*
+* Chunk callback: read a chunk of kernel virtual memory and scan it for the
+* ntoskrnl.exe base, i.e. (1) MZ header (+ optional NT header), (2) POOLCODE
+* section name and (3) ntoskrnl.exe module name (if possible to read).
+* -- ctx
+* -- iChunk
+* -- pqwResult
+* -- return
+*/
+_Success_(return)
+BOOL VmmWinInit_FindNtosScan_ChunkCB(_In_ PVMMWININIT_SCAN_CONTEXT ctx, _In_ DWORD iChunk, _Out_ PQWORD pqwResult)
+{
+    QWORD o, p, oChunk = (QWORD)iChunk * ctx->cbChunk;
+    PBYTE pb = ctx->pb + oChunk;
+    CHAR szModuleName[MAX_PATH] = { 0 };
+    PIMAGE_DOS_HEADER pDosHeader;
+    PIMAGE_NT_HEADERS pNtHeader;
+    VmmReadEx(ctx->pProcess, ctx->va + oChunk, pb, ctx->cbChunk, NULL, 0);
+    for(p = 0; p < ctx->cbChunk; p += 0x1000) {
+        if(ctx->iChunkFound < (LONG)iChunk) { break; }                  // lower chunk already found
+        pDosHeader = (PIMAGE_DOS_HEADER)(pb + p);                       // DOS header
+        if(pDosHeader->e_magic != IMAGE_DOS_SIGNATURE) { continue; }    // DOS header signature (MZ)
+        if(ctx->fNtHeaderReq) {
+            if(pDosHeader->e_lfanew > 0x800) { continue; }
+            pNtHeader = (PIMAGE_NT_HEADERS)(pb + p + pDosHeader->e_lfanew); // NT header
+            if(pNtHeader->Signature != IMAGE_NT_SIGNATURE) { continue; }    // NT header signature
+        }
+        for(o = 0; o < ctx->cbPoolCodeScan; o += 8) {
+            if(*(PQWORD)(pb + p + o) == 0x45444F434C4F4F50) {           // POOLCODE
+                if(!PE_GetModuleNameEx(ctx->pProcess, ctx->va + oChunk + p, FALSE, pb + p, szModuleName, _countof(szModuleName), NULL)) {
+                    ctx->pqwTry[iChunk] = ctx->va + oChunk + p;
+                    break;
+                }
+                if(_stricmp(szModuleName, "ntoskrnl.exe")) {            // not ntoskrnl.exe
+                    break;
+                }
+                *pqwResult = ctx->va + oChunk + p;
+                return TRUE;
+            }
+        }
+    }
+    return FALSE;
+}
+
+/*
+* Chunk callback: (optionally) read a chunk of physical memory and validate
+* each page in it as a possible DTB by calling ctx->pfnValidate.
+* -- ctx
+* -- iChunk
+* -- pqwResult
+* -- return
+*/
+_Success_(return)
+BOOL VmmWinInit_DTB_FindValidate_ChunkCB(_In_ PVMMWININIT_SCAN_CONTEXT ctx, _In_ DWORD iChunk, _Out_ PQWORD pqwResult)
+{
+    QWORD pa, paChunk = (QWORD)iChunk * ctx->cbChunk;
+    if(ctx->fRead && iChunk) {
+        LeechCore_Read(paChunk, ctx->pb + paChunk, ctx->cbChunk);
+    }
+    for(pa = paChunk; pa < paChunk + ctx->cbChunk; pa += 0x1000) {
+        if(ctx->iChunkFound < (LONG)iChunk) { break; }                  // lower chunk already found
+        if(ctx->pfnValidate(pa, ctx->pb + pa)) {
+            *pqwResult = pa;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
 /*
 * Scan a page table hierarchy between virtual addresses between vaMin and vaMax
 * for the first occurence of large 2MB pages. This is usually 'ntoskrnl.exe' if
@@ -168,9 +332,12 @@ finish:
 */
 QWORD VmmWinInit_FindNtosScan64(PVMM_PROCESS pSystemProcess)
 {
-    PBYTE pb;
-    QWORD p, o, vaCurrentMin, vaBase, cbSize;
-    CHAR szModuleName[MAX_PATH] = { 0 };
+    QWORD vaCurrentMin, vaBase, cbSize, vaNtos = 0;
+    VMMWININIT_SCAN_CONTEXT ctx = { 0 };
+    ctx.cbChunk = 0x00200000;
+    ctx.cbPoolCodeScan = 0x1000;
+    ctx.pProcess = pSystemProcess;
+    ctx.pfnChunk = VmmWinInit_FindNtosScan_ChunkCB;
     vaCurrentMin = 0xFFFFF80000000000;
     while(TRUE) {
         vaBase = 0;
@@ -180,23 +347,13 @@ QWORD VmmWinInit_FindNtosScan64(PVMM_PROCESS pSystemProcess)
         vaCurrentMin = vaBase + cbSize;
         if(cbSize >= 0x01000000) { continue; }  // too big
         if(cbSize <= 0x00400000) { continue; }  // too small
-        // try locate ntoskrnl.exe base inside suggested area
-        if(!(pb = (PBYTE)LocalAlloc(0, cbSize))) { return 0; }
-        VmmReadEx(pSystemProcess, vaBase, pb, (DWORD)cbSize, NULL, 0);
-        for(p = 0; p < cbSize; p += 0x1000) {
-            // check for (1) MZ header, (2) POOLCODE section, (3) ntoskrnl.exe module name
-            if(*(PWORD)(pb + p) != 0x5a4d) { continue; } // MZ header
-            for(o = 0; o < 0x1000; o += 8) {
-                if(*(PQWORD)(pb + p + o) == 0x45444F434C4F4F50) { // POOLCODE
-                    PE_GetModuleNameEx(pSystemProcess, vaBase + p, FALSE, pb + p, szModuleName, _countof(szModuleName), NULL);
-                    if(!_stricmp(szModuleName, "ntoskrnl.exe")) {
-                        LocalFree(pb);
-                        return vaBase + p;
-                    }
-                }
-            }
-        }
-        LocalFree(pb);
+        // try locate ntoskrnl.exe base inside suggested area (scan 2MB pages in parallel)
+        if(!(ctx.pb = (PBYTE)LocalAlloc(0, cbSize))) { return 0; }
+        ctx.va = vaBase;
+        ctx.cChunks = (DWORD)(cbSize / ctx.cbChunk);
+        VmmWinInit_ScanParallel(&ctx, &vaNtos);
+        LocalFree(ctx.pb);
+        if(vaNtos) { return vaNtos; }
     }
     return 0;
 }
@@ -255,47 +412,27 @@ cleanup:
 
 /*
 * scans the relatively limited memory space 0x80000000-0x83ffffff for the base
-* of 'ntoskrnl.exe'. NB! this is a very non-optimized way of doing things and
-* should be improved upon to increase startup performance - but 64MB is not a
-* huge amount of memory and it's only scanned at startup ...
+* of 'ntoskrnl.exe'. The 64MB are read and scanned in 8MB chunks in parallel.
 * -- pSystemProcess
 * -- return = virtual address of ntoskrnl.exe base if successful, otherwise 0.
 */
 DWORD VmmWinInit_FindNtosScan32(_In_ PVMM_PROCESS pSystemProcess)
 {
-    DWORD o, p, vaNtosTry = 0;
-    PBYTE pb;
-    CHAR szModuleName[MAX_PATH] = { 0 };
-    PIMAGE_DOS_HEADER pDosHeader;
-    PIMAGE_NT_HEADERS pNtHeader;
-    if(!(pb = LocalAlloc(LMEM_ZEROINIT, 0x04000000))) { return 0; }
-    for(p = 0; p < 0x04000000; p += 0x1000) {
-        // read 8MB chunks when required.
-        if(0 == p % 0x00800000) {
-            VmmReadEx(pSystemProcess, 0x80000000ULL + p, pb + p, 0x00800000, NULL, 0);
-        }
-        // check for (1) MZ+NT header, (2) POOLCODE section, (3) ntoskrnl.exe module name (if possible to read)
-        pDosHeader = (PIMAGE_DOS_HEADER)(pb + p);                       // DOS header
-        if(pDosHeader->e_magic != IMAGE_DOS_SIGNATURE) { continue; }    // DOS header signature (MZ)
-        if(pDosHeader->e_lfanew > 0x800) { continue; }
-        pNtHeader = (PIMAGE_NT_HEADERS)(pb + p + pDosHeader->e_lfanew); // NT header
-        if(pNtHeader->Signature != IMAGE_NT_SIGNATURE) { continue; }    // NT header signature
-        for(o = 0; o < 0x800; o += 8) {
-            if(*(PQWORD)(pb + p + o) == 0x45444F434C4F4F50) {           // POOLCODE
-                if(!PE_GetModuleNameEx(pSystemProcess, 0x80000000ULL + p, FALSE, pb + p, szModuleName, _countof(szModuleName), NULL)) {
-                    vaNtosTry = 0x80000000 + p;
-                    continue;
-                }
-                if(_stricmp(szModuleName, "ntoskrnl.exe")) {            // not ntoskrnl.exe
-                    continue;
-                }
-                LocalFree(pb);
-                return 0x80000000 + p;
-            }
-        }
-    }
-    LocalFree(pb);
-    return vaNtosTry;      // on fail try return NtosTry derived from MZ + POOLCODE only.
+    QWORD vaNtos = 0;
+    VMMWININIT_SCAN_CONTEXT ctx = { 0 };
+    if(!(ctx.pb = LocalAlloc(LMEM_ZEROINIT, 0x04000000))) { return 0; }
+    // scan 8MB chunks in parallel; on fail NtosTry derived from MZ + POOLCODE only.
+    ctx.cbChunk = 0x00800000;
+    ctx.cChunks = 0x04000000 / 0x00800000;
+    ctx.fNtHeaderReq = TRUE;
+    ctx.fTry = TRUE;
+    ctx.cbPoolCodeScan = 0x800;
+    ctx.va = 0x80000000;
+    ctx.pProcess = pSystemProcess;
+    ctx.pfnChunk = VmmWinInit_FindNtosScan_ChunkCB;
+    VmmWinInit_ScanParallel(&ctx, &vaNtos);
+    LocalFree(ctx.pb);
+    return (DWORD)vaNtos;
 }
 
 /*
@@ -314,8 +451,10 @@ PVMM_PROCESS VmmWinInit_FindNtosScan()
     VmmProcessCreateFinish();
     // 2: Spider DTB to speed things up.
     VmmTlbSpider(pObSystemProcess);
-    // 3: Find the base of 'ntoskrnl.exe'
-    if(VMM_MEMORYMODEL_X64 == ctxVmm->tpMemoryModel) {
+    // 3: Find the base of 'ntoskrnl.exe' (use cache file value if valid)
+    if(ctxVmm->CacheFile.vaKernelBase && PE_GetSize(pObSystemProcess, ctxVmm->CacheFile.vaKernelBase)) {
+        vaKernelBase = ctxVmm->CacheFile.vaKernelBase;
+    } else if(VMM_MEMORYMODEL_X64 == ctxVmm->tpMemoryModel) {
         LeechCore_GetOption(LEECHCORE_OPT_MEMORYINFO_OS_KERNELBASE, &vaKernelBase);
         if(!vaKernelBase) {
             vaKernelHint = ctxVmm->kernel.vaEntry;
@@ -374,34 +513,55 @@ BOOL VmmWinInit_DTB_FindValidate_X86(_In_ QWORD pa, _In_reads_(0x1000) PBYTE pbP
 _Success_(return)
 BOOL VmmWinInit_DTB_FindValidate_X86PAE(_In_ QWORD pa, _In_reads_(0x1000) PBYTE pbPage)
 {
-    for(QWORD i = 0; i < 0x1000; i += 8) {
-        if((i < 0x20) && ((*(PQWORD)(pbPage + i) != pa + (i << 9) + 0x1001))) {
-            return FALSE;
-        } else if((i >= 0x20) && *(PQWORD)(pbPage + i)) {
-            return FALSE;
-        }
+    QWORD i;
+    __m128i vOr = _mm_setzero_si128();
+    for(i = 0; i < 0x20; i += 8) {
+        if(*(PQWORD)(pbPage + i) != pa + (i << 9) + 0x1001) { return FALSE; }
     }
-    return TRUE;
+    for(i = 0x20; i < 0x1000; i += 0x10) {
+        vOr = _mm_or_si128(vOr, _mm_loadu_si128((__m128i*)(pbPage + i)));
+    }
+    return 0xffff == _mm_movemask_epi8(_mm_cmpeq_epi8(vOr, _mm_setzero_si128()));
 }
 
+/*
+* Compare two 64-bit lanes for equality with SSE2 (which lacks a 64-bit compare)
+* by combining the 32-bit compare of the low/high dwords.
+*/
+#define VMMWININIT_MM_CMPEQ_EPI64(v, c) _mm_and_si128(_mm_cmpeq_epi32(v, c), _mm_shuffle_epi32(_mm_cmpeq_epi32(v, c), _MM_SHUFFLE(2, 3, 0, 1)))
+
+/*
+* Check if a page looks like the Windows Kernel x64 Directory Table Base (DTB)
+* - i.e. the PML4 of the System process.
+* 1: PML4E[0] is a user-mode entry pointing to a PDPT below max address.
+* 2: self-referential entry exists above 0x800.
+* 3: a minimum number of supervisor-mode entries above 0x800 exists.
+* The upper half of the page is checked with SSE2 two entries at a time; only
+* entries matching the supervisor flags have their address checked.
+*/
 _Success_(return)
 BOOL VmmWinInit_DTB_FindValidate_X64(_In_ QWORD pa, _In_reads_(0x1000) PBYTE pbPage)
 {
-    DWORD c, i;
-    BOOL fSelfRef = FALSE;
+    DWORD c = 0, i, dwMask;
     QWORD pte, paMax;
+    __m128i v, vSelfRef = _mm_setzero_si128();
+    const __m128i vAndSelfRef = _mm_set1_epi64x(0x0000fffffffff083), vCmpSelfRef = _mm_set1_epi64x(pa + 0x03);
+    const __m128i vAndSuper = _mm_set1_epi64x(0x8000ff0000000087), vCmpSuper = _mm_set1_epi64x(0x03);
     paMax = ctxMain->dev.paMax;
     // check for user-mode page table with PDPT below max physical address and not NX.
     pte = *(PQWORD)pbPage;
     if(((pte & 0x0000000000000087) != 0x07) || ((pte & 0x0000fffffffff000) > paMax)) { return FALSE; }
-    for(c = 0, i = 0x800; i < 0x1000; i += 8) { // minimum number of supervisor entries above 0x800
-        pte = *(PQWORD)(pbPage + i);
-        // check for user-mode page table with PDPT below max physical address and not NX.
-        if(((pte & 0x8000ff0000000087) == 0x03) && ((pte & 0x0000fffffffff000) < paMax)) { c++; }
+    for(i = 0x800; i < 0x1000; i += 0x10) {
+        v = _mm_loadu_si128((__m128i*)(pbPage + i));
         // check for self-referential entry
-        if((*(PQWORD)(pbPage + i) & 0x0000fffffffff083) == pa + 0x03) { fSelfRef = TRUE; }
+        vSelfRef = _mm_or_si128(vSelfRef, VMMWININIT_MM_CMPEQ_EPI64(_mm_and_si128(v, vAndSelfRef), vCmpSelfRef));
+        // check for supervisor-mode page table with PDPT below max physical address and not NX.
+        if((dwMask = _mm_movemask_pd(_mm_castsi128_pd(VMMWININIT_MM_CMPEQ_EPI64(_mm_and_si128(v, vAndSuper), vCmpSuper))))) {
+            if((dwMask & 1) && ((*(PQWORD)(pbPage + i) & 0x0000fffffffff000) < paMax)) { c++; }
+            if((dwMask & 2) && ((*(PQWORD)(pbPage + i + 8) & 0x0000fffffffff000) < paMax)) { c++; }
+        }
     }
-    return fSelfRef && (c >= 6);
+    return _mm_movemask_epi8(vSelfRef) && (c >= 6);
 }
 
 /*
@@ -435,51 +595,45 @@ BOOL VmmWinInit_DTB_FindValidate_X64_LowStub(_In_ PBYTE pbLowStub1M)
 _Success_(return)
 BOOL VmmWinInit_DTB_FindValidate()
 {
-    DWORD pa;
     QWORD paDTB = 0;
-    PBYTE pb16M;
-    if(!(pb16M = LocalAlloc(LMEM_ZEROINIT, 0x01000000))) { return FALSE; }
+    VMMWININIT_SCAN_CONTEXT ctx = { 0 };
+    if(!(ctx.pb = LocalAlloc(LMEM_ZEROINIT, 0x01000000))) { return FALSE; }
     // 1: try locate DTB via X64 low stub in lower 1MB
-    LeechCore_Read(0, pb16M, 0x00100000);
-    if(VmmWinInit_DTB_FindValidate_X64_LowStub(pb16M)) {
+    LeechCore_Read(0, ctx.pb, 0x00100000);
+    if(VmmWinInit_DTB_FindValidate_X64_LowStub(ctx.pb)) {
         VmmInitializeMemoryModel(VMM_MEMORYMODEL_X64);
         paDTB = ctxVmm->kernel.paDTB;
     }
-    // 2: try locate DTB by scanning in lower 16MB
+    // 2: try locate DTB by scanning in lower 16MB (1MB chunks in parallel).
+    //    the remaining 15MB are read in parallel by the X64 scan. The X64
+    //    scan only stops early on success - no further reads are required.
+    ctx.cbChunk = 0x00100000;
+    ctx.cChunks = 0x01000000 / 0x00100000;
+    ctx.pfnChunk = VmmWinInit_DTB_FindValidate_ChunkCB;
     // X64
     if(!paDTB) {
-        for(pa = 0; pa < 0x01000000; pa += 0x1000) {
-            if(pa == 0x00100000) {
-                LeechCore_Read(0x00100000, pb16M + 0x00100000, 0x00f00000);
-            }
-            if(VmmWinInit_DTB_FindValidate_X64(pa, pb16M + pa)) {
-                VmmInitializeMemoryModel(VMM_MEMORYMODEL_X64);
-                paDTB = pa;
-                break;
-            }
+        ctx.fRead = TRUE;
+        ctx.pfnValidate = VmmWinInit_DTB_FindValidate_X64;
+        if(VmmWinInit_ScanParallel(&ctx, &paDTB)) {
+            VmmInitializeMemoryModel(VMM_MEMORYMODEL_X64);
         }
+        ctx.fRead = FALSE;
     }
     // X86-PAE
     if(!paDTB) {
-        for(pa = 0; pa < 0x01000000; pa += 0x1000) {
-            if(VmmWinInit_DTB_FindValidate_X86PAE(pa, pb16M + pa)) {
-                VmmInitializeMemoryModel(VMM_MEMORYMODEL_X86PAE);
-                paDTB = pa;
-                break;
-            }
+        ctx.pfnValidate = VmmWinInit_DTB_FindValidate_X86PAE;
+        if(VmmWinInit_ScanParallel(&ctx, &paDTB)) {
+            VmmInitializeMemoryModel(VMM_MEMORYMODEL_X86PAE);
         }
     }
     // X86
     if(!paDTB) {
-        for(pa = 0; pa < 0x01000000; pa += 0x1000) {
-            if(VmmWinInit_DTB_FindValidate_X86(pa, pb16M + pa)) {
-                VmmInitializeMemoryModel(VMM_MEMORYMODEL_X86);
-                paDTB = pa;
-                break;
-            }
+        ctx.pfnValidate = VmmWinInit_DTB_FindValidate_X86;
+        if(VmmWinInit_ScanParallel(&ctx, &paDTB)) {
+            VmmInitializeMemoryModel(VMM_MEMORYMODEL_X86);
         }
     }
-    LocalFree(pb16M);
+    LocalFree(ctx.pb);
     if(!paDTB) { return FALSE; }
     ctxVmm->kernel.paDTB = paDTB;
     return TRUE;
@@ -631,6 +785,8 @@ QWORD VmmWinInit_FindSystemEPROCESS(_In_ PVMM_PROCESS pSystemProcess)
     IMAGE_SECTION_HEADER SectionHeader;
     BYTE pbALMOSTRO[0x80], pbSYSTEM[0x300];
     QWORD i, vaPsInitialSystemProcess, vaSystemEPROCESS;
+    // 0: use value from cache file (if existing)
+    if((vaSystemEPROCESS = ctxVmm->CacheFile.vaSystemEPROCESS)) { goto success; }
     // 1: try locate System EPROCESS by PsInitialSystemProcess exported symbol (works on all win versions)
     vaPsInitialSystemProcess = PE_GetProcAddress(pSystemProcess, ctxVmm->kernel.vaBase, "PsInitialSystemProcess");
     if(VmmRead(pSystemProcess, vaPsInitialSystemProcess, (PBYTE)& vaSystemEPROCESS, 8)) {
@@ -665,20 +821,137 @@ success:
     return vaSystemEPROCESS;
 }
 
+/*
+* Mark the start of an initialization stage.
+* -- iStage = VMM_INIT_STAGE_*
+*/
+VOID VmmWinInit_StageStart(_In_ DWORD iStage)
+{
+    QueryPerformanceCounter((PLARGE_INTEGER)&ctxVmm->Init.Stage[iStage].tmStart);
+}
+
+/*
+* Mark an initialization stage as completed and publish its readiness flag.
+* -- iStage = VMM_INIT_STAGE_*
+*/
+VOID VmmWinInit_StageReady(_In_ DWORD iStage)
+{
+    QueryPerformanceCounter((PLARGE_INTEGER)&ctxVmm->Init.Stage[iStage].tmEnd);
+    ctxVmm->Init.Stage[iStage].fReady = TRUE;
+}
+
+BOOL VmmWinInit_StageGet(_In_ DWORD iStage, _Out_opt_ PQWORD pqwStartMs, _Out_opt_ PQWORD pqwDurationMs)
+{
+    DWORD i;
+    BOOL fReady = TRUE;
+    QWORD qwFreq, tmStart, tmEnd = 0;
+    if(pqwStartMs) { *pqwStartMs = 0; }
+    if(pqwDurationMs) { *pqwDurationMs = 0; }
+    if(iStage > VMM_INIT_STAGE_MAX) { return FALSE; }
+    if(!QueryPerformanceFrequency((PLARGE_INTEGER)&qwFreq) || !qwFreq) { qwFreq = 1; }
+    if(iStage == VMM_INIT_STAGE_MAX) {
+        for(i = 0; i < VMM_INIT_STAGE_MAX; i++) {
+            fReady = fReady && ctxVmm->Init.Stage[i].fReady;
+            tmEnd = max(tmEnd, ctxVmm->Init.Stage[i].tmEnd);
+        }
+        tmStart = ctxVmm->Init.tmStart;
+    } else {
+        fReady = ctxVmm->Init.Stage[iStage].fReady;
+        tmStart = ctxVmm->Init.Stage[iStage].tmStart;
+        tmEnd = ctxVmm->Init.Stage[iStage].tmEnd;
+        if(pqwStartMs && tmStart) { *pqwStartMs = (tmStart - ctxVmm->Init.tmStart) * 1000 / qwFreq; }
+    }
+    if(pqwDurationMs && fReady) { *pqwDurationMs = (tmEnd - tmStart) * 1000 / qwFreq; }
+    return fReady;
+}
+
 /*
 * Async initialization of remaining actions in VmmWinInit_TryInitialize.
+* In staged init mode the registry hive map is built in parallel by the
+* VmmWinInit_TryInitialize_AsyncRegistry thread. In non-staged init mode the
+* hive map is built on first use as before - the registry stage is only marked
+* as ready so that the overall init stage is reported. The optional kernel
+* values depend on (and may update) the KDBG located by the KERNELINFO stage,
+* which runs in parallel in staged init mode - wait for it to complete first.
 * -- lpParameter
 * -- return
 */
 DWORD VmmWinInit_TryInitialize_Async(LPVOID lpParameter)
 {
+    VmmWinInit_StageStart(VMM_INIT_STAGE_PDB);
     PDB_Initialize_WaitComplete();
+    VmmWinInit_StageReady(VMM_INIT_STAGE_PDB);
+    VmmWinInit_StageStart(VMM_INIT_STAGE_PAGING);
     MmWin_PagingInitialize(TRUE);   // initialize full paging (memcompression)
+    VmmWinInit_StageReady(VMM_INIT_STAGE_PAGING);
+    VmmWinInit_StageStart(VMM_INIT_STAGE_THREADING);
     VmmWinInit_TryInitializeThreading();
+    VmmWinInit_StageReady(VMM_INIT_STAGE_THREADING);
+    if(!ctxVmm->Init.fStaged) {
+        VmmWinInit_StageStart(VMM_INIT_STAGE_REGISTRY);     // hive map built on first use
+        VmmWinInit_StageReady(VMM_INIT_STAGE_REGISTRY);
+    }
+    if(ctxVmm->Init.hEventKernelInfo) {
+        WaitForSingleObject(ctxVmm->Init.hEventKernelInfo, INFINITE);
+        CloseHandle(ctxVmm->Init.hEventKernelInfo);
+        ctxVmm->Init.hEventKernelInfo = NULL;
+    }
+    VmmWinInit_StageStart(VMM_INIT_STAGE_KERNELOPT);
     VmmWinInit_TryInitializeKernelOptionalValues();
+    VmmWinInit_StageReady(VMM_INIT_STAGE_KERNELOPT);
+    InterlockedDecrement(&ctxVmm->ThreadWorkers.c);
+    return 1;
+}
+
+/*
+* Async (staged init mode) build of the registry hive map.
+* -- lpParameter
+* -- return
+*/
+DWORD VmmWinInit_TryInitialize_AsyncRegistry(LPVOID lpParameter)
+{
+    VmmWinInit_StageStart(VMM_INIT_STAGE_REGISTRY);
+    Ob_DECREF(VmmWinReg_HiveGetNext(NULL));         // build hive map
+    VmmWinInit_StageReady(VMM_INIT_STAGE_REGISTRY);
+    InterlockedDecrement(&ctxVmm->ThreadWorkers.c);
     return 1;
 }
 
+/*
+* Async (staged init mode) location of PsLoadedModuleList and KDBG.
+* FUNCTION DECREF: pObSystemProcess
+* -- pObSystemProcess
+* -- return
+*/
+DWORD VmmWinInit_TryInitialize_AsyncKernelInfo(_In_ PVMM_PROCESS pObSystemProcess)
+{
+    VmmWinInit_StageStart(VMM_INIT_STAGE_KERNELINFO);
+    VmmWinInit_FindPsLoadedModuleListKDBG(pObSystemProcess);
+    VmmWinInit_StageReady(VMM_INIT_STAGE_KERNELINFO);
+    SetEvent(ctxVmm->Init.hEventKernelInfo);
+    Ob_DECREF(pObSystemProcess);
+    InterlockedDecrement(&ctxVmm->ThreadWorkers.c);
+    return 1;
+}
+
+/*
+* Start an async initialization thread. The thread is accounted for in the
+* ThreadWorkers count so that VmmClose() waits for it to complete. If thread
+* creation fails the function is executed synchronously on the caller thread.
+* -- pfn
+* -- lpParameter
+* -- return = thread handle (to be closed by caller), or NULL.
+*/
+HANDLE VmmWinInit_TryInitialize_StartThread(_In_ LPTHREAD_START_ROUTINE pfn, _In_opt_ LPVOID lpParameter)
+{
+    HANDLE hThread;
+    InterlockedIncrement(&ctxVmm->ThreadWorkers.c);
+    if(!(hThread = CreateThread(NULL, 0, pfn, lpParameter, 0, NULL))) {
+        pfn(lpParameter);
+    }
+    return hThread;
+}
+
 /*
 * Try initialize the VMM from scratch with new WINDOWS support.
 * -- paDTBOpt
@@ -686,14 +959,21 @@ DWORD VmmWinInit_TryInitialize_Async(LPVOID lpParameter)
 */
 BOOL VmmWinInit_TryInitialize(_In_opt_ QWORD paDTBOpt)
 {
-    HANDLE hThreadInitializeAsync;
+    BOOL fResult;
+    DWORD i, cThreads = 0;
+    HANDLE hThreads[3];
     PVMM_PROCESS pObSystemProcess = NULL, pObProcess = NULL;
+    ctxVmm->Init.fStaged = ctxMain->cfg.fStagedInit;
+    QueryPerformanceCounter((PLARGE_INTEGER)&ctxVmm->Init.tmStart);
+    VmmWinInit_StageStart(VMM_INIT_STAGE_KERNEL);
     // Fetch Directory Base (DTB (PML4)) and initialize Memory Model.
     if(paDTBOpt) {
         if(!VmmWinInit_DTB_Validate(paDTBOpt)) {
             vmmprintfv("VmmWinInit_TryInitialize: Initialization Failed. Unable to verify user-supplied (0x%016llx) DTB. #1\n", paDTBOpt);
             goto fail;
         }
+    } else if(ctxVmm->CacheFile.paDTB && VmmWinInit_DTB_Validate(ctxVmm->CacheFile.paDTB)) {
+        vmmprintfvv_fn("INFO: DTB retrieved from cache file.\n");
     } else if(LeechCore_GetOption(LEECHCORE_OPT_MEMORYINFO_OS_DTB, &paDTBOpt)) {
         if(!VmmWinInit_DTB_Validate(paDTBOpt)) {
             vmmprintfv("VmmWinInit_TryInitialize: Warning: Unable to verify crash-dump supplied DTB. (0x%016llx) #1\n", paDTBOpt);
@@ -712,6 +992,10 @@ BOOL VmmWinInit_TryInitialize(_In_opt_ QWORD paDTBOpt)
         goto fail;
     }
     vmmprintfvv_fn("INFO: NTOS located at: %016llx.\n", ctxVmm->kernel.vaBase);
+    // Load kernel offset profile (if any) - skips heuristic offset location
+    VmmProfile_Initialize(pObSystemProcess);
+    VmmWinInit_StageReady(VMM_INIT_STAGE_KERNEL);
+    VmmWinInit_StageStart(VMM_INIT_STAGE_PROCESS);
     // Initialize Paging (Limited Mode)
     MmWin_PagingInitialize(FALSE);
     // Locate System EPROCESS
@@ -720,8 +1004,14 @@ BOOL VmmWinInit_TryInitialize(_In_opt_ QWORD paDTBOpt)
         vmmprintfv_fn("Initialization Failed. Unable to locate EPROCESS. #4\n");
         goto fail;
     }
-    // Enumerate processes
-    if(!VmmWin_EnumerateEPROCESS(pObSystemProcess, TRUE)) {
+    // Enumerate processes (re-locate EPROCESS offsets if cache file or profile values fail)
+    fResult = VmmWin_EnumerateEPROCESS(pObSystemProcess, TRUE);
+    if(!fResult && ctxVmm->kernel.OffsetEPROCESS.fValid && (ctxVmm->CacheFile.fLoaded || ctxVmm->Profile.fEPROCESS)) {
+        ZeroMemory(&ctxVmm->kernel.OffsetEPROCESS, sizeof(VMM_WIN_EPROCESS_OFFSET));
+        ctxVmm->Profile.fEPROCESS = FALSE;
+        fResult = VmmWin_EnumerateEPROCESS(pObSystemProcess, TRUE);
+    }
+    if(!fResult) {
         vmmprintfv("VmmWinInit: Initialization Failed. Unable to walk EPROCESS. #5\n");
         goto fail;
     }
@@ -738,17 +1028,33 @@ BOOL VmmWinInit_TryInitialize(_In_opt_ QWORD paDTBOpt)
             }
         }
     }
+    VmmWinInit_StageReady(VMM_INIT_STAGE_PROCESS);
     // Initialization functionality:
+    //   staged mode: return as soon as the process list is ready and bring up
+    //   PsLoadedModuleList/KDBG, registry, pdb, paging and threading in parallel
+    //   background threads. Readiness is published in ctxVmm->Init.Stage[].
     PDB_Initialize(NULL, TRUE);                                 // Async init of PDB subsystem.
-    VmmWinInit_FindPsLoadedModuleListKDBG(pObSystemProcess);    // Find PsLoadedModuleList and possibly KDBG.
-    VmmWinReg_Initialize();                                     // Registry.
+    VmmWinReg_Initialize();                                     // Registry (hive map is built on demand).
+    if(ctxVmm->Init.fStaged && (ctxVmm->Init.hEventKernelInfo = CreateEvent(NULL, TRUE, FALSE, NULL))) {
+        hThreads[cThreads] = VmmWinInit_TryInitialize_StartThread((LPTHREAD_START_ROUTINE)VmmWinInit_TryInitialize_AsyncKernelInfo, Ob_INCREF(pObSystemProcess));
+        if(hThreads[cThreads]) { cThreads++; }
+        hThreads[cThreads] = VmmWinInit_TryInitialize_StartThread((LPTHREAD_START_ROUTINE)VmmWinInit_TryInitialize_AsyncRegistry, NULL);
+        if(hThreads[cThreads]) { cThreads++; }
+    } else {
+        VmmWinInit_StageStart(VMM_INIT_STAGE_KERNELINFO);
+        VmmWinInit_FindPsLoadedModuleListKDBG(pObSystemProcess);    // Find PsLoadedModuleList and possibly KDBG.
+        VmmWinInit_StageReady(VMM_INIT_STAGE_KERNELINFO);
+    }
     // Async Initialization functionality:
-    hThreadInitializeAsync = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)VmmWinInit_TryInitialize_Async, (LPVOID)NULL, 0, NULL);
-    if(hThreadInitializeAsync) {
+    hThreads[cThreads] = VmmWinInit_TryInitialize_StartThread((LPTHREAD_START_ROUTINE)VmmWinInit_TryInitialize_Async, NULL);
+    if(hThreads[cThreads]) { cThreads++; }
+    if(cThreads) {
         if(ctxMain->cfg.fWaitInitialize) {
-            WaitForSingleObject(hThreadInitializeAsync, INFINITE);
+            WaitForMultipleObjects(cThreads, hThreads, TRUE, INFINITE);
+        }
+        for(i = 0; i < cThreads; i++) {
+            CloseHandle(hThreads[i]);
         }
-        CloseHandle(hThreadInitializeAsync);
     }
     // return
     Ob_DECREF(pObSystemProcess);
@@ -26,4 +26,14 @@ VOID VmmWinInit_TryInitializeKernelOptionalValues();
 _Success_(return)
 BOOL VmmWinInit_TryInitialize(_In_opt_ QWORD paDTB);
 
+/*
+* Retrieve the readiness and timings of an initialization stage. Timings are
+* in milliseconds relative to the start of the initialization.
+* -- iStage = VMM_INIT_STAGE_* or VMM_INIT_STAGE_MAX for all stages combined.
+* -- pqwStartMs = stage start (all stages: 0).
+* -- pqwDurationMs = stage duration (all stages: until the last stage is ready).
+* -- return = TRUE if the stage (or all stages) is ready.
+*/
+BOOL VmmWinInit_StageGet(_In_ DWORD iStage, _Out_opt_ PQWORD pqwStartMs, _Out_opt_ PQWORD pqwDurationMs);
+
 #endif /* __VMMWININIT_H__ */
@@ -11,42 +11,25 @@
 #include "leechcore.h"
 #include "pe.h"
 #include "util.h"
+#include "vmmprofile.h"
 #include "vmmwin.h"
 
 #define REG_SIGNATURE_HBIN      0x6e696268
 
-typedef struct tdVMMWIN_REGISTRY_OFFSET {
-    QWORD vaHintCMHIVE;
-    struct {
-        WORD Signature;
-        WORD FLink;
-        WORD Length;
-        WORD StorageMap;
-        WORD StorageSmallDir;
-        WORD BaseBlock;
-        WORD FileFullPathOpt;
-        WORD FileUserNameOpt;
-        WORD HiveRootPathOpt;
-        WORD _Size;
-    } CM;
-    struct {
-        WORD Signature;
-        WORD Length;
-        WORD Major;
-        WORD Minor;
-        WORD FileName;
-    } BB;
-    struct {
-        WORD _Size;
-    } HE;
-} VMMWIN_REGISTRY_OFFSET, *PVMMWIN_REGISTRY_OFFSET;
-
 typedef struct tdVMMWIN_REGISTRY_CONTEXT {
     POB_CONTAINER pObCHiveMap;
+    POB_MAP pmObPathHash;           // bounded cache: path string -> key path hash
+    POB_CONTAINER pObCHivePrevious; // map of previous snapshotted hives (by vaCMHIVE) - used by incremental snapshots
     CRITICAL_SECTION LockUpdate;
     VMMWIN_REGISTRY_OFFSET Offset;
 } VMMWIN_REGISTRY_CONTEXT, *PVMMWIN_REGISTRY_CONTEXT;
 
+#define VMMWINREG_PATHHASH_CACHE_MAX        0x1000
+#define VMMWINREG_SNAPSHOT_VERIFY_INTERVAL  4       // full hive re-read every N:th snapshot
+
+// hive owning the (possibly shared) snapshot buffer and key tree of a hive.
+#define VMMWINREG_HIVE_TREE(pHive)          ((pHive)->Snapshot.pObHiveTree ? (pHive)->Snapshot.pObHiveTree : (pHive))
+
 //-----------------------------------------------------------------------------
 // READ & WRITE TO REGISTRY "MEMORY SPACE" BELOW:
 // Each individual registry hive may be addressed with an addressing scheme
@@ -160,7 +143,9 @@ BOOL VmmWinReg_Reg2Virt32(_In_ PVMM_PROCESS pProcessRegistry, _In_ POB_REGISTRY_
 }
 
 /*
-* Translate a registry address 'ra' into a virtual address 'va'
+* Translate a registry address 'ra' into a virtual address 'va'. Successful
+* translations are cached per 4K block in the hive object. The cache is valid
+* for the lifetime of the hive object (i.e. until the next registry refresh).
 * -- pProcessRegistry = the registry process
 * -- pRegistryHive = the registry hive
 * -- ra = the registry address to translate
@@ -170,10 +155,74 @@ BOOL VmmWinReg_Reg2Virt32(_In_ PVMM_PROCESS pProcessRegistry, _In_ POB_REGISTRY_
 _Success_(return)
 BOOL VmmWinReg_Reg2Virt(_In_ PVMM_PROCESS pProcessRegistry, _In_ POB_REGISTRY_HIVE pRegistryHive, _In_ DWORD ra, _Out_ PQWORD pva)
 {
-    if(!pProcessRegistry || !pRegistryHive) { return FALSE; }
-    return ctxVmm->f32 ?
-        VmmWinReg_Reg2Virt32(pProcessRegistry, pRegistryHive, ra, pva) :
-        VmmWinReg_Reg2Virt64(pProcessRegistry, pRegistryHive, ra, pva);
+    QWORD qwCache;
+    PQWORD pqwCache;
+    if(!pProcessRegistry || !pRegistryHive || (ra >= pRegistryHive->cbLength)) { return FALSE; }
+    if(!(pqwCache = pRegistryHive->pqwReg2VirtCache)) {
+        if((pqwCache = LocalAlloc(LMEM_ZEROINIT, ((pRegistryHive->cbLength + 0xfffULL) >> 12) * sizeof(QWORD)))) {
+            if(InterlockedCompareExchangePointer(&pRegistryHive->pqwReg2VirtCache, pqwCache, NULL)) {
+                LocalFree(pqwCache);
+                pqwCache = pRegistryHive->pqwReg2VirtCache;
+            }
+        }
+    }
+    if(pqwCache && (qwCache = pqwCache[ra >> 12])) {
+        *pva = (qwCache & ~0xfff) | (ra & 0xfff);
+        return TRUE;
+    }
+    if(!(ctxVmm->f32 ? VmmWinReg_Reg2Virt32(pProcessRegistry, pRegistryHive, ra, pva) : VmmWinReg_Reg2Virt64(pProcessRegistry, pRegistryHive, ra, pva))) {
+        return FALSE;
+    }
+    if(pqwCache) {
+        pqwCache[ra >> 12] = (*pva & ~0xfff) | 1;
+    }
+    return TRUE;
+}
+
+/*
+* Prefetch the hive storage map directory and table entries required to
+* translate the registry address range into the cache. This is done in two
+* batched reads so that subsequent VmmWinReg_Reg2Virt calls on the range will
+* not have to read the directory and table entries one by one.
+* -- pProcessRegistry
+* -- pRegistryHive
+* -- ra
+* -- cb
+*/
+VOID VmmWinReg_Reg2VirtPrefetch(_In_ PVMM_PROCESS pProcessRegistry, _In_ POB_REGISTRY_HIVE pRegistryHive, _In_ DWORD ra, _In_ DWORD cb)
+{
+    PVMMWIN_REGISTRY_OFFSET po = &ctxVmm->pRegistry->Offset;
+    DWORD iDirectory, iDirectoryFirst, iDirectoryLast, iTableFirst, iTableLast, cbPtr = ctxVmm->f32 ? 4 : 8;
+    QWORD va, vaTable;
+    POB_VSET pObVSet = NULL;
+    if(!cb || (ra >= pRegistryHive->cbLength) || !(pObVSet = ObVSet_New())) { return; }
+    cb = min(cb, pRegistryHive->cbLength - ra);
+    iDirectoryFirst = (ra >> (12 + 9)) & 0x3ff;
+    iDirectoryLast = ((ra + cb - 1) >> (12 + 9)) & 0x3ff;
+    // 1: prefetch directory entries
+    if(iDirectoryLast || !pRegistryHive->vaHMAP_TABLE_SmallDir) {
+        for(va = (pRegistryHive->vaHMAP_DIRECTORY + iDirectoryFirst * cbPtr) & ~0xfff; va <= pRegistryHive->vaHMAP_DIRECTORY + iDirectoryLast * cbPtr; va += 0x1000) {
+            ObVSet_Push(pObVSet, va);
+        }
+        VmmCachePrefetchPages(pProcessRegistry, pObVSet, 0);
+        ObVSet_Clear(pObVSet);
+    }
+    // 2: prefetch table entries
+    for(iDirectory = iDirectoryFirst; iDirectory <= iDirectoryLast; iDirectory++) {
+        vaTable = 0;
+        if(iDirectory || !pRegistryHive->vaHMAP_TABLE_SmallDir) {
+            if(!VmmRead(pProcessRegistry, pRegistryHive->vaHMAP_DIRECTORY + iDirectory * cbPtr, (PBYTE)&vaTable, cbPtr) || !vaTable) { continue; }
+        } else {
+            vaTable = pRegistryHive->vaHMAP_TABLE_SmallDir;
+        }
+        iTableFirst = (iDirectory == iDirectoryFirst) ? ((ra >> 12) & 0x1ff) : 0;
+        iTableLast = (iDirectory == iDirectoryLast) ? (((ra + cb - 1) >> 12) & 0x1ff) : 0x1ff;
+        for(va = (vaTable + iTableFirst * po->HE._Size) & ~0xfff; va < vaTable + (iTableLast + 1ULL) * po->HE._Size; va += 0x1000) {
+            ObVSet_Push(pObVSet, va);
+        }
+    }
+    VmmCachePrefetchPages(pProcessRegistry, pObVSet, 0);
+    Ob_DECREF(pObVSet);
 }
 
 /*
@@ -190,7 +239,7 @@ BOOL VmmWinReg_Reg2Virt(_In_ PVMM_PROCESS pProcessRegistry, _In_ POB_REGISTRY_HI
 VOID VmmWinReg_ReadScatter(_In_ PVMM_PROCESS pProcessRegistry, _In_ POB_REGISTRY_HIVE pRegistryHive, _Inout_ PPMEM_IO_SCATTER_HEADER ppMEMsReg, _In_ DWORD cpMEMsReg, _In_ QWORD flags)
 {
     QWORD va;
-    DWORD i = 0, iRA, iVA;
+    DWORD i = 0, iRA, iVA, ra, raMin, raMax;
     BYTE pbBufferSmall[0x20 * (sizeof(MEM_IO_SCATTER_HEADER) + sizeof(PMEM_IO_SCATTER_HEADER))];
     PBYTE pbBufferMEMs, pbBufferLarge = NULL;
     PMEM_IO_SCATTER_HEADER pIoVA, pIoRA;
@@ -204,7 +253,17 @@ VOID VmmWinReg_ReadScatter(_In_ PVMM_PROCESS pProcessRegistry, _In_ POB_REGISTRY
         ppMEMsVirt = (PPMEM_IO_SCATTER_HEADER)pbBufferLarge;
         pbBufferMEMs = pbBufferLarge + cpMEMsReg * sizeof(PMEM_IO_SCATTER_HEADER);
     }
-    // 2: translate reg2virt
+    // 2: prefetch storage map entries of non-cached blocks and translate reg2virt
+    for(iRA = 0, raMin = (DWORD)-1, raMax = 0; iRA < cpMEMsReg; iRA++) {
+        ra = (DWORD)ppMEMsReg[iRA]->qwA;
+        if((ra < pRegistryHive->cbLength) && !(pRegistryHive->pqwReg2VirtCache && pRegistryHive->pqwReg2VirtCache[ra >> 12])) {
+            raMin = min(raMin, ra);
+            raMax = max(raMax, ra);
+        }
+    }
+    if((cpMEMsReg > 1) && (raMin < raMax)) {
+        VmmWinReg_Reg2VirtPrefetch(pProcessRegistry, pRegistryHive, raMin & ~0xfff, (raMax & ~0xfff) - (raMin & ~0xfff) + 0x1000);
+    }
     for(iRA = 0, iVA = 0; iRA < cpMEMsReg; iRA++) {
         pIoRA = ppMEMsReg[iRA];
         if(VmmWinReg_Reg2Virt(pProcessRegistry, pRegistryHive, (DWORD)pIoRA->qwA, &va)) {
@@ -587,12 +646,72 @@ BOOL VmmWinReg_FuzzHiveOffsets32(_In_ PVMM_PROCESS pProcessSystem, _In_ QWORD va
     return TRUE;
 }
 
+/*
+* Apply the registry offsets of a loaded kernel offset profile to a potential
+* CMHIVE page. Only the signature and the hive list linkage are verified, which
+* is much cheaper than fuzzing the offsets. Upon success the offsets are stored
+* in ctxVmm->pRegistry->Offset.
+* -- pProcessSystem
+* -- vaCMHIVE = virtual address of the page (if known), otherwise zero.
+* -- pbCMHIVE
+* -- return
+*/
+BOOL VmmWinReg_ProfileHiveOffsets(_In_ PVMM_PROCESS pProcessSystem, _In_ QWORD vaCMHIVE, _In_reads_(0x1000) PBYTE pbCMHIVE)
+{
+    BOOL f32 = ctxVmm->f32;
+    DWORD o, dwSignature = 0;
+    QWORD vaFLink, vaBLink = 0;
+    PVMMWIN_REGISTRY_OFFSET pp = &ctxVmm->Profile.Registry;
+    if(!ctxVmm->Profile.fRegistry || !pp->CM.FLink) { return FALSE; }
+    // _CMHIVE BASE (may be preceded by a pool header)
+    for(o = 0; o <= 0x40; o += 4) {
+        if(*(PDWORD)(pbCMHIVE + o) == 0xBEE0BEE0) { break; }
+    }
+    if((o > 0x40) || (o + pp->CM.FLink + 8 > 0x1000)) { return FALSE; }
+    pbCMHIVE += o;
+    if(vaCMHIVE) { vaCMHIVE += o; }
+    // _CMHIVE _LIST_ENTRY - FLink->BLink must point back to this hive and FLink to another hive
+    vaFLink = f32 ? *(PDWORD)(pbCMHIVE + pp->CM.FLink) : *(PQWORD)(pbCMHIVE + pp->CM.FLink);
+    if(!vaFLink || (vaFLink & (f32 ? 3 : 7))) { return FALSE; }
+    if(!VmmRead(pProcessSystem, vaFLink + (f32 ? 4 : 8), (PBYTE)&vaBLink, f32 ? sizeof(DWORD) : sizeof(QWORD))) { return FALSE; }
+    if(vaCMHIVE && (vaBLink != vaCMHIVE + pp->CM.FLink)) { return FALSE; }
+    if(!VmmRead(pProcessSystem, vaFLink - pp->CM.FLink, (PBYTE)&dwSignature, sizeof(DWORD)) || (dwSignature != 0xBEE0BEE0)) { return FALSE; }
+    memcpy(&ctxVmm->pRegistry->Offset, pp, sizeof(VMMWIN_REGISTRY_OFFSET));
+    ctxVmm->pRegistry->Offset.vaHintCMHIVE = vaCMHIVE ? vaCMHIVE : (vaFLink - pp->CM.FLink);
+    vmmprintfvv_fn("Registry offsets retrieved from profile.\n");
+    return TRUE;
+}
+
+/*
+* Check a potential CMHIVE page against the profile offsets (iPass == 0) or
+* fuzz the offsets (iPass == 1). Fuzzed offsets are stored in the profile.
+* -- pProcessSystem
+* -- iPass
+* -- vaCMHIVE = virtual address of the page (if known), otherwise zero.
+* -- pbCMHIVE
+* -- return
+*/
+BOOL VmmWinReg_LocateRegistryHive_Check(_In_ PVMM_PROCESS pProcessSystem, _In_ DWORD iPass, _In_ QWORD vaCMHIVE, _In_reads_(0x1000) PBYTE pbCMHIVE)
+{
+    if(iPass == 0) {
+        return VmmWinReg_ProfileHiveOffsets(pProcessSystem, vaCMHIVE, pbCMHIVE);
+    }
+    if(ctxVmm->f32 ? VmmWinReg_FuzzHiveOffsets32(pProcessSystem, vaCMHIVE, pbCMHIVE) : VmmWinReg_FuzzHiveOffsets64(pProcessSystem, vaCMHIVE, pbCMHIVE)) {
+        VmmProfile_SetRegistry(&ctxVmm->pRegistry->Offset);
+        return TRUE;
+    }
+    return FALSE;
+}
+
 /*
 * Locate a registry hive. Once a single registry hive is located the linked
 * list may be traversed to enumerate the remaining registry hives.
 * The search algorithm looks for promising addresses in ntoskrnl.exe .data
 * section and checks if any of these addresses are part of a CMHIVE. If the
 * above technique fail then the lower memory is scanned (also fail sometimes).
+* If a kernel offset profile is loaded all candidates are first checked
+* against the profile offsets; the offset fuzzer is only run if no candidate
+* matches the profile.
 * -- return
 */
 #define MAX_NUM_POTENTIAL_HIVE_HINT        0x20
@@ -602,51 +721,55 @@ BOOL VmmWinReg_LocateRegistryHive()
     BOOL f32 = ctxVmm->f32;
     PVMM_PROCESS pObProcessSystem = VmmProcessGet(4);
     IMAGE_SECTION_HEADER SectionHeader;
-    DWORD iSection, cbSectionSize, cbPoolHdr, cbPoolHdrMax, cPotentialHive, o, p, i;
+    DWORD iPass, iSection, cbSectionSize, cbPoolHdr, cbPoolHdrMax, cPotentialHive, o, p, i;
     QWORD vaPotentialHive[MAX_NUM_POTENTIAL_HIVE_HINT];
     PBYTE pb = NULL;
     PPMEM_IO_SCATTER_HEADER ppMEMs = NULL;
-    if(!VmmProcessGet(4) || !(pb = LocalAlloc(0, 0x01000000))) { goto cleanup; }
-    // 1: Try locate registry by scanning ntoskrnl.exe .data section.
-    for(iSection = 0; iSection < 2; iSection++) {    // 1st check '.data' section, then PAGEDATA' for pointers.
-        if(!PE_SectionGetFromName(pObProcessSystem, ctxVmm->kernel.vaBase, iSection ? "PAGEDATA" : ".data", &SectionHeader)) { goto cleanup; }
-        cbSectionSize = min(0x01000000, SectionHeader.Misc.VirtualSize);
-        VmmReadEx(pObProcessSystem, ctxVmm->kernel.vaBase + SectionHeader.VirtualAddress, pb, min(0x01000000, SectionHeader.Misc.VirtualSize), NULL, VMM_FLAG_ZEROPAD_ON_FAIL);
-        cbPoolHdrMax = f32 ? 0x08 : 0x10;
-        for(cbPoolHdr = 0; cbPoolHdr <= cbPoolHdrMax; cbPoolHdr += cbPoolHdrMax) {
-            for(cPotentialHive = 0, o = 0; o < cbSectionSize && cPotentialHive < MAX_NUM_POTENTIAL_HIVE_HINT; o += (f32 ? 4 : 8)) {
-                if(f32) {
-                    if((*(PDWORD)(pb + o) & 0x80000fff) == 0x80000000 + cbPoolHdr) {
-                        vaPotentialHive[cPotentialHive++] = *(PDWORD)(pb + o);
-                    }
-                } else {
-                    if((*(PQWORD)(pb + o) & 0xffff8000'00000fff) == (0xffff8000'00000000 + cbPoolHdr)) {
-                        vaPotentialHive[cPotentialHive++] = *(PQWORD)(pb + o);
+    if(!pObProcessSystem || !(pb = LocalAlloc(0, 0x01000000))) { goto cleanup; }
+    for(iPass = (ctxVmm->Profile.fRegistry ? 0 : 1); iPass < 2; iPass++) {
+        // 1: Try locate registry by scanning ntoskrnl.exe .data section.
+        for(iSection = 0; iSection < 2; iSection++) {    // 1st check '.data' section, then PAGEDATA' for pointers.
+            if(!PE_SectionGetFromName(pObProcessSystem, ctxVmm->kernel.vaBase, iSection ? "PAGEDATA" : ".data", &SectionHeader)) { goto cleanup; }
+            cbSectionSize = min(0x01000000, SectionHeader.Misc.VirtualSize);
+            VmmReadEx(pObProcessSystem, ctxVmm->kernel.vaBase + SectionHeader.VirtualAddress, pb, min(0x01000000, SectionHeader.Misc.VirtualSize), NULL, VMM_FLAG_ZEROPAD_ON_FAIL);
+            cbPoolHdrMax = f32 ? 0x08 : 0x10;
+            for(cbPoolHdr = 0; cbPoolHdr <= cbPoolHdrMax; cbPoolHdr += cbPoolHdrMax) {
+                for(cPotentialHive = 0, o = 0; o < cbSectionSize && cPotentialHive < MAX_NUM_POTENTIAL_HIVE_HINT; o += (f32 ? 4 : 8)) {
+                    if(f32) {
+                        if((*(PDWORD)(pb + o) & 0x80000fff) == 0x80000000 + cbPoolHdr) {
+                            vaPotentialHive[cPotentialHive++] = *(PDWORD)(pb + o);
+                        }
+                    } else {
+                        if((*(PQWORD)(pb + o) & 0xffff8000'00000fff) == (0xffff8000'00000000 + cbPoolHdr)) {
+                            vaPotentialHive[cPotentialHive++] = *(PQWORD)(pb + o);
+                        }
                     }
                 }
-            }
-            if(!cPotentialHive) { continue; }
-            if(!LeechCore_AllocScatterEmpty(cPotentialHive, &ppMEMs)) { continue; }
-            for(i = 0; i < cPotentialHive; i++) {
-                ppMEMs[i]->qwA = vaPotentialHive[i] & ~0xfff;
-            }
-            VmmReadScatterVirtual(pObProcessSystem, ppMEMs, cPotentialHive, 0);
-            for(i = 0; i < cPotentialHive; i++) {
-                if(ppMEMs[i]->cb == 0x1000) {
-                    if((result = f32 ? VmmWinReg_FuzzHiveOffsets32(pObProcessSystem, ppMEMs[i]->qwA, ppMEMs[i]->pb) : VmmWinReg_FuzzHiveOffsets64(pObProcessSystem, ppMEMs[i]->qwA, ppMEMs[i]->pb))) {
+                if(!cPotentialHive) { continue; }
+                LocalFree(ppMEMs);
+                ppMEMs = NULL;
+                if(!LeechCore_AllocScatterEmpty(cPotentialHive, &ppMEMs)) { continue; }
+                for(i = 0; i < cPotentialHive; i++) {
+                    ppMEMs[i]->qwA = vaPotentialHive[i] & ~0xfff;
+                }
+                VmmReadScatterVirtual(pObProcessSystem, ppMEMs, cPotentialHive, 0);
+                for(i = 0; i < cPotentialHive; i++) {
+                    if((ppMEMs[i]->cb == 0x1000) && VmmWinReg_LocateRegistryHive_Check(pObProcessSystem, iPass, ppMEMs[i]->qwA, ppMEMs[i]->pb)) {
+                        result = TRUE;
                         goto cleanup;
                     }
                 }
             }
         }
-    }
-    // 2: As a fallback - try locate registry by scanning lower physical memory.
-    //    This is much slower, but will work sometimes when the above method fail.
-    for(o = 0x00000000; o < 0x08000000; o += 0x01000000) {
-        VmmReadEx(NULL, o, pb, 0x01000000, NULL, 0);
-        for(p = 0; p < 0x01000000; p += 0x1000) {
-            if((result = f32 ? VmmWinReg_FuzzHiveOffsets32(pObProcessSystem, 0, pb + p) : VmmWinReg_FuzzHiveOffsets64(pObProcessSystem, 0, pb + p))) {
-                goto cleanup;
+        // 2: As a fallback - try locate registry by scanning lower physical memory.
+        //    This is much slower, but will work sometimes when the above method fail.
+        for(o = 0x00000000; o < 0x08000000; o += 0x01000000) {
+            VmmReadEx(NULL, o, pb, 0x01000000, NULL, 0);
+            for(p = 0; p < 0x01000000; p += 0x1000) {
+                if(VmmWinReg_LocateRegistryHive_Check(pObProcessSystem, iPass, 0, pb + p)) {
+                    result = TRUE;
+                    goto cleanup;
+                }
             }
         }
     }
@@ -671,9 +794,15 @@ cleanup:
 VOID VmmWinReg_CallbackCleanup_ObRegistryHive(POB_REGISTRY_HIVE pOb)
 {
     DeleteCriticalSection(&pOb->LockUpdate);
+    LocalFree(pOb->pqwReg2VirtCache);
     Ob_DECREF(pOb->Snapshot.pmKeyHash);
     Ob_DECREF(pOb->Snapshot.pmKeyOffset);
-    LocalFree(pOb->Snapshot.pb);
+    if(pOb->Snapshot.pObHiveTree) {
+        Ob_DECREF(pOb->Snapshot.pObHiveTree);
+    } else {
+        LocalFree(pOb->Snapshot.pb);
+    }
+    LocalFree(pOb->Snapshot.pqwBlockPA);
 }
 
 /*
@@ -889,19 +1018,121 @@ POB_MAP VmmWinReg_HiveMap()
 _Success_(return)
 BOOL VmmWinReg_KeyInitialize(_In_ POB_REGISTRY_HIVE pHive);
 
+/*
+* Hash the contents of a 4K hive snapshot block.
+* -- pb
+* -- return
+*/
+QWORD VmmWinReg_HiveSnapshotHashBlock(_In_reads_(0x1000) PBYTE pb)
+{
+    DWORD i;
+    QWORD qwHash = 0xcbf29ce484222325;
+    for(i = 0; i < 0x1000; i += 8) {
+        qwHash = (qwHash ^ *(PQWORD)(pb + i)) * 0x100000001b3;
+    }
+    return qwHash;
+}
+
+/*
+* Read the hive into the snapshot buffer 4K block by 4K block. Blocks whose
+* backing physical page is unchanged since the previous snapshot of the hive
+* are copied from it rather than re-read from memory - but only if memory is
+* static or the previous snapshot was read in the current PHYS cache generation
+* (a re-read would be served the same data from the cache), otherwise in-place
+* modifications of the blocks would be missed. The backing physical address
+* and the content hash of each block are recorded for the next time.
+* -- pHive
+* -- pHivePrev = previous snapshot of the same hive (if any).
+* -- fVerify = re-read all blocks regardless of their backing page.
+* -- pcChanged = number of blocks with changed contents vs. the previous snapshot.
+* -- return
+*/
+_Success_(return)
+BOOL VmmWinReg_HiveSnapshotRead(_In_ POB_REGISTRY_HIVE pHive, _In_opt_ POB_REGISTRY_HIVE pHivePrev, _In_ BOOL fVerify, _Out_ PDWORD pcChanged)
+{
+    BOOL fReuse;
+    QWORD va, pa;
+    DWORD i, iMEM, cMEMs = 0, cBlock, cChanged = 0;
+    PBYTE pbBuffer = NULL;
+    PMEM_IO_SCATTER_HEADER pMEMs, *ppMEMs;
+    PVMM_PROCESS pObProcessRegistry = NULL;
+    cBlock = (pHive->Snapshot.cb + 0xfff) >> 12;
+    if(pHivePrev && ((pHivePrev->Snapshot.cBlock != cBlock) || !pHivePrev->Snapshot.pqwBlockPA)) { pHivePrev = NULL; }
+    pHive->Snapshot.dwPhysGeneration = ctxVmm->Cache.PHYS.dwGeneration;
+    fReuse = !fVerify && pHivePrev && (!ctxMain->dev.fVolatile || (pHivePrev->Snapshot.dwPhysGeneration == pHive->Snapshot.dwPhysGeneration));
+    if(!(pObProcessRegistry = VmmWinReg_GetRegistryProcess())) { goto fail; }
+    if(!(pHive->Snapshot.pqwBlockPA = LocalAlloc(LMEM_ZEROINIT, cBlock * 2ULL * sizeof(QWORD)))) { goto fail; }
+    pHive->Snapshot.pqwBlockHash = pHive->Snapshot.pqwBlockPA + cBlock;
+    pHive->Snapshot.cBlock = cBlock;
+    if(!(pbBuffer = LocalAlloc(LMEM_ZEROINIT, cBlock * (sizeof(MEM_IO_SCATTER_HEADER) + sizeof(PMEM_IO_SCATTER_HEADER))))) { goto fail; }
+    pMEMs = (PMEM_IO_SCATTER_HEADER)pbBuffer;
+    ppMEMs = (PPMEM_IO_SCATTER_HEADER)(pbBuffer + cBlock * sizeof(MEM_IO_SCATTER_HEADER));
+    // 1: translate blocks - copy blocks with unchanged backing page from the
+    //    previous snapshot and schedule the remaining blocks for reading.
+    VmmWinReg_Reg2VirtPrefetch(pObProcessRegistry, pHive, 0, pHive->Snapshot.cb);
+    for(i = 0; i < cBlock; i++) {
+        if(!VmmWinReg_Reg2Virt(pObProcessRegistry, pHive, i << 12, &va)) {
+            ZeroMemory(pHive->Snapshot.pb + ((QWORD)i << 12), 0x1000);
+            continue;
+        }
+        if(!VmmVirt2Phys(pObProcessRegistry, va, &pa)) { pa = 0; }
+        pHive->Snapshot.pqwBlockPA[i] = pa;
+        if(fReuse && pa && (pa == pHivePrev->Snapshot.pqwBlockPA[i])) {
+            memcpy(pHive->Snapshot.pb + ((QWORD)i << 12), pHivePrev->Snapshot.pb + ((QWORD)i << 12), 0x1000);
+            pHive->Snapshot.pqwBlockHash[i] = pHivePrev->Snapshot.pqwBlockHash[i];
+            continue;
+        }
+        ppMEMs[cMEMs] = &pMEMs[cMEMs];
+        pMEMs[cMEMs].magic = MEM_IO_SCATTER_HEADER_MAGIC;
+        pMEMs[cMEMs].version = MEM_IO_SCATTER_HEADER_VERSION;
+        pMEMs[cMEMs].qwA = va & ~0xfff;
+        pMEMs[cMEMs].cbMax = 0x1000;
+        pMEMs[cMEMs].pb = pHive->Snapshot.pb + ((QWORD)i << 12);
+        cMEMs++;
+    }
+    // 2: read remaining blocks and compare with the previous snapshot
+    VmmReadScatterVirtual(pObProcessRegistry, ppMEMs, cMEMs, 0);
+    for(iMEM = 0; iMEM < cMEMs; iMEM++) {
+        if(pMEMs[iMEM].cb != 0x1000) {
+            ZeroMemory(pMEMs[iMEM].pb, 0x1000);
+        }
+        i = (DWORD)((pMEMs[iMEM].pb - pHive->Snapshot.pb) >> 12);
+        pHive->Snapshot.pqwBlockHash[i] = VmmWinReg_HiveSnapshotHashBlock(pMEMs[iMEM].pb);
+    }
+    for(i = 0; i < cBlock; i++) {
+        if(!pHivePrev || (pHive->Snapshot.pqwBlockHash[i] != pHivePrev->Snapshot.pqwBlockHash[i])) {
+            cChanged++;
+        }
+    }
+    *pcChanged = cChanged;
+    LocalFree(pbBuffer);
+    Ob_DECREF(pObProcessRegistry);
+    return TRUE;
+fail:
+    LocalFree(pbBuffer);
+    Ob_DECREF(pObProcessRegistry);
+    return FALSE;
+}
+
 /*
 * Ensure a registry hive snapshot is taken of the hive and stored within the
 * hive object. A snapshot is created by copying the whole registry hive into
-* memory and performing analysis on it to generate a key tree for convenient
-* parsing of the keys. Any keys derived from the hive must never be used after
-* Ob_DECREF has been called on the hive.
+* memory. Only the root keys are created up front - other keys are created on
+* demand when their parent key is visited. If a snapshot of the same hive was
+* taken before the last registry refresh the snapshot is taken incrementally -
+* only blocks with changed backing pages are re-read and if no block contents
+* changed the previous snapshot buffer and key tree is shared. Any keys derived
+* from the hive must never be used after Ob_DECREF has been called on the hive.
 * -- pHive
 * -- return
 */
 _Success_(return)
 BOOL VmmWinReg_HiveSnapshotEnsure(_In_ POB_REGISTRY_HIVE pHive)
 {
-    DWORD cbRead;
+    BOOL fVerify;
+    DWORD cChanged = 0;
+    POB_MAP pmObHivePrev = NULL;
+    POB_REGISTRY_HIVE pObHivePrev = NULL, pHiveTree;
     // 1: check already cached
     if(!pHive) { return FALSE; }
     if(pHive->Snapshot.fInitialized) { return TRUE; }
@@ -912,22 +1143,54 @@ BOOL VmmWinReg_HiveSnapshotEnsure(_In_ POB_REGISTRY_HIVE pHive)
         LeaveCriticalSection(&pHive->LockUpdate);
         return TRUE;
     }
-    // 3: allocate new
-    pHive->Snapshot.pmKeyHash = ObMap_New(OB_MAP_FLAGS_OBJECT_OB);
-    pHive->Snapshot.pmKeyOffset = ObMap_New(OB_MAP_FLAGS_OBJECT_OB);
+    // 3: retrieve previous snapshot of hive (if any)
+    if((pmObHivePrev = ObContainer_GetOb(ctxVmm->pRegistry->pObCHivePrevious))) {
+        pObHivePrev = ObMap_GetByKey(pmObHivePrev, pHive->vaCMHIVE);
+        if(pObHivePrev && (!pObHivePrev->Snapshot.fInitialized || (pObHivePrev->Snapshot.cb != pHive->cbLength))) {
+            Ob_DECREF_NULL(&pObHivePrev);
+        }
+    }
+    fVerify = !pObHivePrev || (pObHivePrev->Snapshot.cIncremental + 1 >= VMMWINREG_SNAPSHOT_VERIFY_INTERVAL);
+    // 4: read hive into new snapshot buffer
     pHive->Snapshot.cb = pHive->cbLength;
-    pHive->Snapshot.pb = LocalAlloc(0, pHive->Snapshot.cb);
-    if(!pHive->Snapshot.pmKeyHash || !pHive->Snapshot.pmKeyOffset || !pHive->Snapshot.pb) { goto fail; }
-    VmmWinReg_HiveReadEx(pHive, 0, pHive->Snapshot.pb, pHive->Snapshot.cb, &cbRead, VMM_FLAG_ZEROPAD_ON_FAIL);
-    if(!VmmWinReg_KeyInitialize(pHive)) { goto fail; }
+    pHive->Snapshot.pb = LocalAlloc(0, (pHive->Snapshot.cb + 0xfffULL) & ~0xfff);
+    if(!pHive->Snapshot.pb || !VmmWinReg_HiveSnapshotRead(pHive, pObHivePrev, fVerify, &cChanged)) { goto fail; }
+    pHive->Snapshot.cIncremental = fVerify ? 0 : pObHivePrev->Snapshot.cIncremental + 1;
+    if(pObHivePrev && !cChanged) {
+        // 5: unchanged since previous snapshot - share buffer and key tree
+        pHiveTree = VMMWINREG_HIVE_TREE(pObHivePrev);
+        LocalFree(pHive->Snapshot.pb);
+        pHive->Snapshot.pb = pHiveTree->Snapshot.pb;
+        pHive->Snapshot.pmKeyHash = Ob_INCREF(pHiveTree->Snapshot.pmKeyHash);
+        pHive->Snapshot.pmKeyOffset = Ob_INCREF(pHiveTree->Snapshot.pmKeyOffset);
+        pHive->Snapshot.pObHiveTree = Ob_INCREF(pHiveTree);
+    } else {
+        // 5: new or changed hive - create new key tree
+        pHive->Snapshot.pmKeyHash = ObMap_New(OB_MAP_FLAGS_OBJECT_OB);
+        pHive->Snapshot.pmKeyOffset = ObMap_New(OB_MAP_FLAGS_OBJECT_OB);
+        if(!pHive->Snapshot.pmKeyHash || !pHive->Snapshot.pmKeyOffset) { goto fail; }
+        if(!VmmWinReg_KeyInitialize(pHive)) { goto fail; }
+    }
+    vmmprintfvv_fn("Hive=%016llx Blocks=%i Changed=%i Shared=%i \n", pHive->vaCMHIVE, pHive->Snapshot.cBlock, cChanged, (pHive->Snapshot.pObHiveTree ? 1 : 0));
     pHive->Snapshot.fInitialized = TRUE;
+    Ob_DECREF(pObHivePrev);
+    Ob_DECREF(pmObHivePrev);
     LeaveCriticalSection(&pHive->LockUpdate);
     return TRUE;
 fail:
     Ob_DECREF_NULL(&pHive->Snapshot.pmKeyHash);
     Ob_DECREF_NULL(&pHive->Snapshot.pmKeyOffset);
-    LocalFree(pHive->Snapshot.pb);
+    if(pHive->Snapshot.pObHiveTree) {
+        Ob_DECREF_NULL(&pHive->Snapshot.pObHiveTree);
+    } else {
+        LocalFree(pHive->Snapshot.pb);
+    }
     pHive->Snapshot.pb = NULL;
+    LocalFree(pHive->Snapshot.pqwBlockPA);
+    pHive->Snapshot.pqwBlockPA = NULL;
+    pHive->Snapshot.pqwBlockHash = NULL;
+    Ob_DECREF(pObHivePrev);
+    Ob_DECREF(pmObHivePrev);
     LeaveCriticalSection(&pHive->LockUpdate);
     return FALSE;
 }
@@ -943,12 +1206,16 @@ VOID VmmWinReg_Initialize()
     PVMMWIN_REGISTRY_CONTEXT ctx;
     if(!(ctx = LocalAlloc(LMEM_ZEROINIT, sizeof(VMMWIN_REGISTRY_CONTEXT)))) { goto fail; }
     if(!(ctx->pObCHiveMap = ObContainer_New(NULL))) { goto fail; }
+    if(!(ctx->pmObPathHash = ObMap_New(OB_MAP_FLAGS_OBJECT_OB))) { goto fail; }
+    if(!(ctx->pObCHivePrevious = ObContainer_New(NULL))) { goto fail; }
     InitializeCriticalSection(&ctx->LockUpdate);
     ctxVmm->pRegistry = ctx;
     return;
 fail:
     if(ctx) {
         Ob_DECREF(ctx->pObCHiveMap);
+        Ob_DECREF(ctx->pmObPathHash);
+        Ob_DECREF(ctx->pObCHivePrevious);
         LocalFree(ctx);
     }
 }
@@ -957,6 +1224,8 @@ VOID VmmWinReg_Close()
 {
     if(ctxVmm->pRegistry) {
         Ob_DECREF(ctxVmm->pRegistry->pObCHiveMap);
+        Ob_DECREF(ctxVmm->pRegistry->pmObPathHash);
+        Ob_DECREF(ctxVmm->pRegistry->pObCHivePrevious);
         DeleteCriticalSection(&ctxVmm->pRegistry->LockUpdate);
         LocalFree(ctxVmm->pRegistry);
         ctxVmm->pRegistry = NULL;
@@ -965,9 +1234,29 @@ VOID VmmWinReg_Close()
 
 VOID VmmWinReg_Refresh()
 {
-    if(ctxVmm->pRegistry) {
-        ObContainer_SetOb(ctxVmm->pRegistry->pObCHiveMap, NULL);
+    POB_MAP pmObHiveMap = NULL, pmObPrevOld = NULL, pmObPrevNew = NULL;
+    POB_REGISTRY_HIVE pObHive = NULL, pObHivePrev;
+    if(!ctxVmm->pRegistry) { return; }
+    EnterCriticalSection(&ctxVmm->pRegistry->LockUpdate);
+    // retain snapshotted hives (or their previous snapshots) for incremental
+    // snapshots of the same hives after the refresh.
+    if((pmObHiveMap = ObContainer_GetOb(ctxVmm->pRegistry->pObCHiveMap)) && (pmObPrevNew = ObMap_New(OB_MAP_FLAGS_OBJECT_OB))) {
+        pmObPrevOld = ObContainer_GetOb(ctxVmm->pRegistry->pObCHivePrevious);
+        while((pObHive = ObMap_GetNext(pmObHiveMap, pObHive))) {
+            if(pObHive->Snapshot.fInitialized) {
+                ObMap_Push(pmObPrevNew, pObHive->vaCMHIVE, pObHive);
+            } else if((pObHivePrev = ObMap_GetByKey(pmObPrevOld, pObHive->vaCMHIVE))) {
+                ObMap_Push(pmObPrevNew, pObHive->vaCMHIVE, pObHivePrev);
+                Ob_DECREF(pObHivePrev);
+            }
+        }
+        ObContainer_SetOb(ctxVmm->pRegistry->pObCHivePrevious, pmObPrevNew);
     }
+    ObContainer_SetOb(ctxVmm->pRegistry->pObCHiveMap, NULL);
+    LeaveCriticalSection(&ctxVmm->pRegistry->LockUpdate);
+    Ob_DECREF(pmObPrevNew);
+    Ob_DECREF(pmObPrevOld);
+    Ob_DECREF(pmObHiveMap);
 }
 
 
@@ -1031,7 +1320,11 @@ POB_REGISTRY_HIVE VmmWinReg_HiveGetByName(_In_ LPSTR szName)
 #define REG_CM_KEY_SIGNATURE_KEYNODE        0x6B6E  // 'nk'-key
 #define REG_CM_KEY_SIGNATURE_KEYVALUE       0x6B76  // 'vk'-key
 #define REG_CM_HASH_LEAF_SIGNATURE          0x686C  // 'hl'-key
+#define REG_CM_FAST_LEAF_SIGNATURE          0x666C  // 'lf'-key
+#define REG_CM_INDEX_LEAF_SIGNATURE         0x696C  // 'li'-key
+#define REG_CM_INDEX_ROOT_SIGNATURE         0x6972  // 'ri'-key
 #define REG_CM_KEY_SIGNATURE_BIGDATA        0x6264  // 'db'-key
+#define REG_CM_BIG_DATA_SEGMENT_SIZE        0x3fd8  // max data size of a single big data segment cell
 
 #define REG_CM_KEY_VALUE_FLAGS_COMP_NAME    0x01
 #define REG_CM_KEY_NODE_FLAGS_COMP_NAME     0x20
@@ -1112,10 +1405,12 @@ typedef struct tdOB_REGISTRY_KEY {
     DWORD dwCellHead;
     DWORD oCell;
     WORD cbCell;
-    WORD iSuffix;                   // suffix (0-9) (order/count) for keys with identical name/parent
+    WORD iSuffix;                   // suffix (0-9) (parent subkey list order) for keys with identical name/parent
     QWORD qwHashKeyParent;          // parent key hash (calculated on file system compatible hash)
     QWORD qwHashKeyThis;            // this key hash (calculated on file system compatible hash)
     PREG_CM_KEY_NODE pKey;          // points into pHive->Snapshot.pb (must not be free'd)
+    BOOL fChildResolved;            // subkey lists resolved into child keys (protected by pHive->LockUpdate)
+    BOOL fChildResolving;           // subkey lists currently being resolved (protected by pHive->LockUpdate)
     struct {
         WORD c;
         WORD cMax;
@@ -1198,6 +1493,73 @@ QWORD VmmWinReg_KeyHashPathW(_In_ LPWSTR wszPath)
     return qwHashTotal;
 }
 
+typedef struct tdOB_REGISTRY_PATHHASH {
+    OB ObHdr;
+    QWORD qwHashParent;
+    QWORD qwHash;
+    WCHAR wszName[];
+} OB_REGISTRY_PATHHASH, *POB_REGISTRY_PATHHASH;
+
+/*
+* Calculate the key hash of a child key name given the parent key hash. The
+* result is retrieved from the bounded path hash cache (keyed by the parent key
+* hash and the raw name) if possible. The cache is cleared once it is full.
+* -- qwHashParent
+* -- wszName
+* -- return
+*/
+QWORD VmmWinReg_KeyHashChildW_Cached(_In_ QWORD qwHashParent, _In_ LPWSTR wszName)
+{
+    QWORD qwHash, qwKey = qwHashParent ^ 0xcbf29ce484222325;
+    DWORD cch;
+    POB_MAP pmPathHash = ctxVmm->pRegistry ? ctxVmm->pRegistry->pmObPathHash : NULL;
+    POB_REGISTRY_PATHHASH pObPathHash;
+    if(!pmPathHash) {
+        return VmmWinReg_KeyHashNameW(wszName) + ((qwHashParent >> 13) | (qwHashParent << 51));
+    }
+    for(cch = 0; wszName[cch]; cch++) {
+        qwKey = (qwKey ^ wszName[cch]) * 0x100000001b3;
+    }
+    if((pObPathHash = ObMap_GetByKey(pmPathHash, qwKey))) {
+        if((pObPathHash->qwHashParent == qwHashParent) && !wcscmp(pObPathHash->wszName, wszName)) {
+            qwHash = pObPathHash->qwHash;
+            Ob_DECREF(pObPathHash);
+            return qwHash;
+        }
+        Ob_DECREF(pObPathHash);
+        return VmmWinReg_KeyHashNameW(wszName) + ((qwHashParent >> 13) | (qwHashParent << 51));
+    }
+    qwHash = VmmWinReg_KeyHashNameW(wszName) + ((qwHashParent >> 13) | (qwHashParent << 51));
+    if(ObMap_Size(pmPathHash) >= VMMWINREG_PATHHASH_CACHE_MAX) {
+        ObMap_Clear(pmPathHash);
+    }
+    if((pObPathHash = Ob_Alloc(OB_TAG_REG_PATHHASH, 0, sizeof(OB_REGISTRY_PATHHASH) + (cch + 1ULL) * sizeof(WCHAR), NULL, NULL))) {
+        pObPathHash->qwHashParent = qwHashParent;
+        pObPathHash->qwHash = qwHash;
+        memcpy(pObPathHash->wszName, wszName, (cch + 1ULL) * sizeof(WCHAR));
+        ObMap_Push(pmPathHash, qwKey, pObPathHash);
+        Ob_DECREF(pObPathHash);
+    }
+    return qwHash;
+}
+
+/*
+* Hash a path - as VmmWinReg_KeyHashPathW - but retrieve the per path component
+* hashes from the bounded path hash cache if possible.
+* -- wszPath
+* -- return
+*/
+QWORD VmmWinReg_KeyHashPathW_Cached(_In_ LPWSTR wszPath)
+{
+    QWORD qwHash = 0;
+    WCHAR wsz1[MAX_PATH];
+    while(wszPath && wszPath[0]) {
+        wszPath = Util_PathSplit2_ExWCHAR(wszPath, wsz1, _countof(wsz1));
+        qwHash = VmmWinReg_KeyHashChildW_Cached(qwHash, wsz1);
+    }
+    return qwHash;
+}
+
 /*
 * Helper function to validate the sanity of a Cell Size.
 * -- pHive
@@ -1239,8 +1601,12 @@ VOID VmmWinReg_KeyInitializeCreateKey_AddChild(_In_opt_ POB_REGISTRY_KEY pObKeyP
     pObKeyParent->Child.po[pObKeyParent->Child.c++] = oCellChild;
 }
 
+VOID VmmWinReg_KeyResolveChildren(_In_ POB_REGISTRY_HIVE pHive, _In_ POB_REGISTRY_KEY pKey);
+
 /*
-* Try to create a new key from a given hbin offset.
+* Try to create a new key from a given hbin offset. The subkey lists of the
+* parent key are resolved first so that suffixes of keys with duplicate names
+* are assigned in subkey list order - independent of the key access order.
 * CALLER DECREF: return
 * -- pHive
 * -- oCell
@@ -1281,9 +1647,15 @@ POB_REGISTRY_KEY VmmWinReg_KeyInitializeCreateKey(_In_ POB_REGISTRY_HIVE pHive,
 			pObKeyParent = ObMap_GetByIndex(pHive->Snapshot.pmKeyOffset, 1);		// e[0] = ROOT, e[1] = orphan root
 		}
 	}
-    // 4: check for and adjust for duplicate key names at different offsets
-    if(ObMap_ExistsKey(pHive->Snapshot.pmKeyOffset, oCell)) {
-        goto fail;
+    // 4: resolve the parent subkey lists (may create this key) and check for
+    //    and adjust for duplicate key names at different offsets
+    if(pObKeyParent && (pObKeyParent->oCell == pnk->Parent)) {
+        VmmWinReg_KeyResolveChildren(pHive, pObKeyParent);
+    }
+    if((pObKey = ObMap_GetByKey(pHive->Snapshot.pmKeyOffset, oCell))) {
+        if(!Ob_VALID_TAG(pObKey, OB_TAG_REG_KEY)) { goto fail; }
+        Ob_DECREF(pObKeyParent);
+        return pObKey;
     }
     while(TRUE) {
         qwKeyHash = dwNameHash = VmmWinReg_KeyHashName(pnk, iSuffix);
@@ -1390,18 +1762,35 @@ BOOL VmmWinReg_KeyInitializeRootKey(_In_ POB_REGISTRY_HIVE pHive)
 }
 
 /*
-* Initialize the registry key functionality by first "snapshotting" the hive
-* contents into memory then walking the complete hive to try to find and index
-* relations beteen parent-child registry keys - which are then stored into
-* hash maps for faster lookups.
+* Initialize the registry key functionality of a freshly "snapshotted" hive.
+* Only the 'ROOT' and 'ORPHAN' root keys are created - any other keys are
+* created on demand by VmmWinReg_KeyResolveChildren/VmmWinReg_KeyScanAll.
 * -- pHive
 * -- return
 */
 _Success_(return)
 BOOL VmmWinReg_KeyInitialize(_In_ POB_REGISTRY_HIVE pHive)
+{
+    return VmmWinReg_KeyInitializeRootKey(pHive);
+}
+
+/*
+* Walk the complete hive to try to find and index relations between all
+* parent-child registry keys - including deleted and orphaned keys - which are
+* then stored into hash maps for faster lookups. Keys already created on demand
+* are kept as-is. The scan is only performed once per hive snapshot.
+* -- pHive
+*/
+VOID VmmWinReg_KeyScanAll(_In_ POB_REGISTRY_HIVE pHive)
 {
 	DWORD oCell, dwSignature, cbCell, cbHbin, iHbin = 0;
-    if(!VmmWinReg_KeyInitializeRootKey(pHive)) { return FALSE; }
+    pHive = VMMWINREG_HIVE_TREE(pHive);
+    if(pHive->Snapshot.fScanComplete) { return; }
+    EnterCriticalSection(&pHive->LockUpdate);
+    if(pHive->Snapshot.fScanComplete) {
+        LeaveCriticalSection(&pHive->LockUpdate);
+        return;
+    }
     while(iHbin < (pHive->Snapshot.cb & ~0xfff)) {
         dwSignature = *(PDWORD)(pHive->Snapshot.pb + iHbin);
         if(!dwSignature) {  // zero-padded hbin
@@ -1434,7 +1823,85 @@ BOOL VmmWinReg_KeyInitialize(_In_ POB_REGISTRY_HIVE pHive)
 
         iHbin += cbHbin;
     }
-    return TRUE;
+    pHive->Snapshot.fScanComplete = TRUE;
+    LeaveCriticalSection(&pHive->LockUpdate);
+}
+
+/*
+* Create the keys referenced by a subkey list cell (lf/lh/li) - or recursively
+* by the sub-lists of an index root cell (ri).
+* (Helper function to VmmWinReg_KeyResolveChildren)
+* -- pHive
+* -- oList
+* -- iLevel
+*/
+VOID VmmWinReg_KeyResolveChildrenList(_In_ POB_REGISTRY_HIVE pHive, _In_ DWORD oList, _In_ DWORD iLevel)
+{
+    PBYTE pbList;
+    WORD wSignature;
+    DWORD i, c, cbCell, cbEntry, oEntry;
+    if(!VmmWinReg_KeyValidateCellSize(pHive, oList, 8, 0x00100000)) { return; }
+    cbCell = REG_CELL_SIZE_EX(pHive->Snapshot.pb, oList);
+    pbList = pHive->Snapshot.pb + oList + 4;
+    wSignature = *(PWORD)pbList;
+    switch(wSignature) {
+        case REG_CM_FAST_LEAF_SIGNATURE:
+        case REG_CM_HASH_LEAF_SIGNATURE:
+            cbEntry = 8;        // cell offset + name hint/hash
+            break;
+        case REG_CM_INDEX_LEAF_SIGNATURE:
+        case REG_CM_INDEX_ROOT_SIGNATURE:
+            cbEntry = 4;        // cell offset
+            break;
+        default:
+            return;
+    }
+    c = min(*(PWORD)(pbList + 2), (cbCell - 8) / cbEntry);
+    for(i = 0; i < c; i++) {
+        oEntry = *(PDWORD)(pbList + 4 + i * cbEntry);
+        if(wSignature == REG_CM_INDEX_ROOT_SIGNATURE) {
+            if(iLevel < 2) {
+                VmmWinReg_KeyResolveChildrenList(pHive, oEntry, iLevel + 1);
+            }
+        } else {
+            Ob_DECREF(VmmWinReg_KeyInitializeCreateKey(pHive, oEntry, 0));
+        }
+    }
+}
+
+/*
+* Ensure the direct child keys of a key are created by resolving its persistent
+* and volatile subkey lists. This is only done once per key and is not needed
+* if the complete hive has already been scanned.
+* -- pHive
+* -- pKey
+*/
+VOID VmmWinReg_KeyResolveChildren(_In_ POB_REGISTRY_HIVE pHive, _In_ POB_REGISTRY_KEY pKey)
+{
+    DWORD i;
+    PREG_CM_KEY_NODE pnk;
+    pHive = VMMWINREG_HIVE_TREE(pHive);
+    if(pKey->fChildResolved || pHive->Snapshot.fScanComplete) { return; }
+    EnterCriticalSection(&pHive->LockUpdate);
+    if(!pKey->fChildResolved && !pKey->fChildResolving && !pHive->Snapshot.fScanComplete) {
+        pKey->fChildResolving = TRUE;
+        pnk = pKey->pKey;
+        if(((PBYTE)pnk < pHive->Snapshot.pb) || ((PBYTE)pnk >= pHive->Snapshot.pb + pHive->Snapshot.cb)) {
+            // dummy root key - use the real root key node (if any) in the hive.
+            pnk = NULL;
+            if(VmmWinReg_KeyValidateCellSize(pHive, pKey->oCell, REG_CM_KEY_NODE_SIZEOF + 4, 0x1000) && (REG_CM_KEY_SIGNATURE_KEYNODE == *(PWORD)(pHive->Snapshot.pb + pKey->oCell + 4))) {
+                pnk = (PREG_CM_KEY_NODE)(pHive->Snapshot.pb + pKey->oCell + 4);
+            }
+        }
+        for(i = 0; pnk && (i < 2); i++) {
+            if(pnk->SubKeyCounts[i]) {
+                VmmWinReg_KeyResolveChildrenList(pHive, pnk->SubKeyLists[i], 0);
+            }
+        }
+        pKey->fChildResolved = TRUE;
+        pKey->fChildResolving = FALSE;
+    }
+    LeaveCriticalSection(&pHive->LockUpdate);
 }
 
 /*
@@ -1494,6 +1961,41 @@ POB_REGISTRY_VALUE VmmWinReg_ValueByKeyAndName(_In_ POB_REGISTRY_HIVE pHive, _In
     return NULL;
 }
 
+/*
+* Copy data from a "big data" (db) value - i.e. a value with data larger than
+* a single cell split into segment cells of REG_CM_BIG_DATA_SEGMENT_SIZE. The
+* data is copied from the hive snapshot up to the first invalid segment.
+* (Helper function to VmmWinReg_ValueQueryInternal)
+* -- pHive
+* -- pBigData
+* -- cbDataLength
+* -- pbData
+* -- cbData
+* -- cbDataOffset
+* -- return = number of bytes copied.
+*/
+DWORD VmmWinReg_ValueQueryBigData(_In_ POB_REGISTRY_HIVE pHive, _In_ PREG_CM_BIG_DATA pBigData, _In_ DWORD cbDataLength, _Out_writes_(cbData) PBYTE pbData, _In_ DWORD cbData, _In_ DWORD cbDataOffset)
+{
+    PDWORD praSegments;
+    DWORD iSegment, cSegments, cbListCell, oSegment, cbSegment, oCopy, cbCopy, cbRead = 0;
+    if(!VmmWinReg_KeyValidateCellSize(pHive, pBigData->List, 8, 0x1000)) { return 0; }
+    cbListCell = REG_CELL_SIZE_EX(pHive->Snapshot.pb, pBigData->List);
+    cSegments = min(pBigData->Count, (cbListCell - 4) >> 2);
+    praSegments = (PDWORD)(pHive->Snapshot.pb + pBigData->List + 4);
+    iSegment = cbDataOffset / REG_CM_BIG_DATA_SEGMENT_SIZE;
+    while((cbRead < cbData) && (iSegment < cSegments)) {
+        oSegment = iSegment * REG_CM_BIG_DATA_SEGMENT_SIZE;
+        cbSegment = min(REG_CM_BIG_DATA_SEGMENT_SIZE, cbDataLength - oSegment);
+        if(!VmmWinReg_KeyValidateCellSize(pHive, praSegments[iSegment], 4 + cbSegment, 0x4000)) { break; }
+        oCopy = cbDataOffset + cbRead - oSegment;
+        cbCopy = min(cbData - cbRead, cbSegment - oCopy);
+        memcpy(pbData + cbRead, pHive->Snapshot.pb + praSegments[iSegment] + 4 + oCopy, cbCopy);
+        cbRead += cbCopy;
+        iSegment++;
+    }
+    return cbRead;
+}
+
 /*
 * Helper function (core functionality) for the VmmWinReg_ValueQuery1 function.
 */
@@ -1523,8 +2025,11 @@ BOOL VmmWinReg_ValueQueryInternal(_In_ POB_REGISTRY_HIVE pHive, _In_ POB_REGISTR
     if(cbCellData < 8) { return FALSE; }
     // "big data" table
     if(*(PWORD)(pHive->Snapshot.pb + oCellData + 4) == REG_CM_KEY_SIGNATURE_BIGDATA) {
-        vmmprintfvv_fn("BIG DATA TABLE NOT YET SUPPORTED. Hive=%016llx Cell=%08x \n", pHive->vaCMHIVE, pObKeyValue->oCell);
-        return FALSE;
+        if(!(cbDataRead = VmmWinReg_ValueQueryBigData(pHive, (PREG_CM_BIG_DATA)(pHive->Snapshot.pb + oCellData + 4), cbDataLength, pbData, cbDataRead, cbDataOffset))) {
+            vmmprintfvv_fn("BAD BIG DATA TABLE. Hive=%016llx Cell=%08x \n", pHive->vaCMHIVE, pObKeyValue->oCell);
+            return FALSE;
+        }
+        goto success;
     }
     // "ordinary" data
     if(cbDataOffset > cbCellData - 4) { return FALSE; }
@@ -1622,9 +2127,37 @@ BOOL VmmWinReg_KeyHiveGetByFullPath(_In_ LPWSTR wszPathFull, _Out_ POB_REGISTRY_
     return FALSE;
 }
 
+/*
+* Walk a path component by component from its root key, resolving the child
+* keys of each visited key on demand. Cost is proportional to the path depth.
+* CALLER DECREF: return
+* -- pHive
+* -- wszPath
+* -- return
+*/
+POB_REGISTRY_KEY VmmWinReg_KeyGetByPathW_Walk(_In_ POB_REGISTRY_HIVE pHive, _In_ LPWSTR wszPath)
+{
+    QWORD qwHash = 0;
+    WCHAR wsz1[MAX_PATH];
+    POB_REGISTRY_KEY pObKey = NULL, pObKeyNext;
+    while(wszPath && wszPath[0]) {
+        wszPath = Util_PathSplit2_ExWCHAR(wszPath, wsz1, _countof(wsz1));
+        qwHash = VmmWinReg_KeyHashChildW_Cached(qwHash, wsz1);
+        if(pObKey) {
+            VmmWinReg_KeyResolveChildren(pHive, pObKey);
+        }
+        pObKeyNext = ObMap_GetByKey(pHive->Snapshot.pmKeyHash, qwHash);
+        Ob_DECREF(pObKey);
+        if(!(pObKey = pObKeyNext)) { return NULL; }
+    }
+    return pObKey;
+}
+
 /*
 * Retrieve a registry key by its path. If no registry key is found then NULL
-* will be returned.
+* will be returned. Keys are resolved on demand by walking the path. If the key
+* is not found in the active key tree the complete hive is scanned for deleted
+* and orphaned keys - unless lazy registry mode is enabled.
 * CALLER DECREF: return
 * -- pHive
 * -- wszPath
@@ -1632,14 +2165,25 @@ BOOL VmmWinReg_KeyHiveGetByFullPath(_In_ LPWSTR wszPathFull, _Out_ POB_REGISTRY_
 */
 POB_REGISTRY_KEY VmmWinReg_KeyGetByPathW(_In_ POB_REGISTRY_HIVE pHive, _In_ LPWSTR wszPath)
 {
+    QWORD qwHash;
+    POB_REGISTRY_KEY pObKey;
     if(!VmmWinReg_HiveSnapshotEnsure(pHive)) { return NULL; }
-    return (POB_REGISTRY_KEY)ObMap_GetByKey(pHive->Snapshot.pmKeyHash, VmmWinReg_KeyHashPathW(wszPath));
+    // 1: key already exists
+    qwHash = VmmWinReg_KeyHashPathW_Cached(wszPath);
+    if((pObKey = ObMap_GetByKey(pHive->Snapshot.pmKeyHash, qwHash)) || VMMWINREG_HIVE_TREE(pHive)->Snapshot.fScanComplete) { return pObKey; }
+    // 2: walk the path from the root key and resolve child keys on the way
+    if((pObKey = VmmWinReg_KeyGetByPathW_Walk(pHive, wszPath)) || ctxVmm->fRegistryLazy) { return pObKey; }
+    // 3: not found in active key tree - deleted/orphan key? (full scan)
+    VmmWinReg_KeyScanAll(pHive);
+    return ObMap_GetByKey(pHive->Snapshot.pmKeyHash, qwHash);
 }
 
 /*
 * Retrive registry sub-keys from the level directly below the given parent key.
 * The resulting keys are returned in a no-key map (set). If no parent key is
-* given the root keys are returned.
+* given the root keys are returned. In lazy registry mode only the subkey lists
+* of the parent key are resolved, otherwise the complete hive is scanned once
+* to also include deleted and orphaned keys.
 * CALLER DECREF: return
 * -- pHive
 * -- pKeyParent
@@ -1653,11 +2197,18 @@ POB_MAP VmmWinReg_KeyList(_In_ POB_REGISTRY_HIVE pHive, _In_opt_ POB_REGISTRY_KE
     if(!VmmWinReg_HiveSnapshotEnsure(pHive)) { return NULL; }
     if(!(pmObSubkeys = ObMap_New(OB_MAP_FLAGS_OBJECT_OB | OB_MAP_FLAGS_NOKEY))) { return NULL; }
     if(pKeyParent) {
+        if(ctxVmm->fRegistryLazy) {
+            VmmWinReg_KeyResolveChildren(pHive, pKeyParent);
+        } else {
+            VmmWinReg_KeyScanAll(pHive);
+        }
+        EnterCriticalSection(&VMMWINREG_HIVE_TREE(pHive)->LockUpdate);
         for(i = 0; i < pKeyParent->Child.c; i++) {
             pKeyChild = ObMap_GetByKey(pHive->Snapshot.pmKeyOffset, pKeyParent->Child.po[i]);
             ObMap_Push(pmObSubkeys, 0, pKeyChild);
             Ob_DECREF(pKeyChild);
         }
+        LeaveCriticalSection(&VMMWINREG_HIVE_TREE(pHive)->LockUpdate);
     } else {
         for(i = 0; i < 2; i++) {
             pKeyChild = ObMap_GetByIndex(pHive->Snapshot.pmKeyOffset, i);
@@ -1819,3 +2370,305 @@ BOOL VmmWinReg_ValueQuery4(_In_ POB_REGISTRY_HIVE pHive, _In_ POB_REGISTRY_VALUE
     if(pcbData) { *pcbData = 0; }
     return FALSE;
 }
+
+
+
+//-----------------------------------------------------------------------------
+// REGISTRY SEARCH FUNCTIONALITY BELOW:
+// Search all hives in parallel (one work item per hive) by walking the active
+// key tree directly over the hive snapshot buffers - without creating any key
+// or value objects.
+//-----------------------------------------------------------------------------
+
+#define VMMWINREG_SEARCH_PATH_MAX           0x1000
+#define VMMWINREG_SEARCH_NAME_MAX           0x4000
+#define VMMWINREG_SEARCH_DATA_MAX           0x01000000
+
+typedef struct tdVMMWINREG_SEARCH_CONTEXT {
+    LPWSTR wszKeyPathGlob;
+    LPWSTR wszValueNameGlob;
+    PBYTE pbDataPattern;
+    DWORD cbDataPattern;
+    PVOID ctxCallback;
+    BOOL(*pfnCallback)(_In_opt_ PVOID ctx, _In_ PVMM_REGISTRY_SEARCH_MATCH pMatch);
+    volatile BOOL fAbort;
+    CRITICAL_SECTION LockCallback;
+    DWORD cHives;
+    POB_REGISTRY_HIVE *ppHives;
+} VMMWINREG_SEARCH_CONTEXT, *PVMMWINREG_SEARCH_CONTEXT;
+
+typedef struct tdVMMWINREG_SEARCH_STACK_ENTRY {
+    DWORD oCell;
+    DWORD cchPathParent;
+} VMMWINREG_SEARCH_STACK_ENTRY, *PVMMWINREG_SEARCH_STACK_ENTRY;
+
+typedef struct tdVMMWINREG_SEARCH_HIVE_CONTEXT {
+    PVMMWINREG_SEARCH_CONTEXT ctx;
+    POB_REGISTRY_HIVE pHive;
+    POB_VSET pvsVisited;
+    DWORD cStack;
+    DWORD cStackMax;
+    PVMMWINREG_SEARCH_STACK_ENTRY pStack;
+    DWORD cbData;
+    PBYTE pbData;
+    WCHAR wszPath[VMMWINREG_SEARCH_PATH_MAX];
+    WCHAR wszName[VMMWINREG_SEARCH_NAME_MAX];
+} VMMWINREG_SEARCH_HIVE_CONTEXT, *PVMMWINREG_SEARCH_HIVE_CONTEXT;
+
+/*
+* Convert a raw (compressed ascii or utf-16) key or value name to a string.
+* -- pbName
+* -- cbName = name length in bytes.
+* -- fCompressed
+* -- wszOut
+* -- cchOut
+* -- return = number of characters excl. terminating null.
+*/
+DWORD VmmWinReg_SearchName(_In_reads_(cbName) PBYTE pbName, _In_ DWORD cbName, _In_ BOOL fCompressed, _Out_writes_(cchOut) LPWSTR wszOut, _In_ DWORD cchOut)
+{
+    DWORD i, cch;
+    cch = min(cchOut - 1, fCompressed ? cbName : cbName >> 1);
+    for(i = 0; i < cch; i++) {
+        wszOut[i] = fCompressed ? pbName[i] : ((PWCHAR)pbName)[i];
+    }
+    wszOut[cch] = 0;
+    return cch;
+}
+
+/*
+* Report a match to the caller. Callbacks are serialized.
+* -- ctx
+* -- pMatch
+*/
+VOID VmmWinReg_SearchReport(_In_ PVMMWINREG_SEARCH_CONTEXT ctx, _In_ PVMM_REGISTRY_SEARCH_MATCH pMatch)
+{
+    EnterCriticalSection(&ctx->LockCallback);
+    if(!ctx->fAbort && !ctx->pfnCallback(ctx->ctxCallback, pMatch)) {
+        ctx->fAbort = TRUE;
+    }
+    LeaveCriticalSection(&ctx->LockCallback);
+}
+
+/*
+* Push the keys referenced by a subkey list cell (lf/lh/li/ri) onto the stack.
+* -- ctxH
+* -- oList
+* -- cchPathParent
+* -- iLevel
+*/
+VOID VmmWinReg_SearchPushList(_In_ PVMMWINREG_SEARCH_HIVE_CONTEXT ctxH, _In_ DWORD oList, _In_ DWORD cchPathParent, _In_ DWORD iLevel)
+{
+    PBYTE pbList;
+    WORD wSignature;
+    DWORD i, c, cbCell, cbEntry, oEntry, cStackMax;
+    PVMMWINREG_SEARCH_STACK_ENTRY pStackNew;
+    POB_REGISTRY_HIVE pHive = ctxH->pHive;
+    if(!VmmWinReg_KeyValidateCellSize(pHive, oList, 8, 0x00100000)) { return; }
+    cbCell = REG_CELL_SIZE_EX(pHive->Snapshot.pb, oList);
+    pbList = pHive->Snapshot.pb + oList + 4;
+    wSignature = *(PWORD)pbList;
+    switch(wSignature) {
+        case REG_CM_FAST_LEAF_SIGNATURE:
+        case REG_CM_HASH_LEAF_SIGNATURE:
+            cbEntry = 8;
+            break;
+        case REG_CM_INDEX_LEAF_SIGNATURE:
+        case REG_CM_INDEX_ROOT_SIGNATURE:
+            cbEntry = 4;
+            break;
+        default:
+            return;
+    }
+    c = min(*(PWORD)(pbList + 2), (cbCell - 8) / cbEntry);
+    for(i = 0; i < c; i++) {
+        oEntry = *(PDWORD)(pbList + 4 + i * cbEntry);
+        if(wSignature == REG_CM_INDEX_ROOT_SIGNATURE) {
+            if(iLevel < 2) {
+                VmmWinReg_SearchPushList(ctxH, oEntry, cchPathParent, iLevel + 1);
+            }
+            continue;
+        }
+        if(!ObVSet_Push(ctxH->pvsVisited, 0x100000000 | oEntry)) { continue; }
+        if(ctxH->cStack == ctxH->cStackMax) {
+            cStackMax = ctxH->cStackMax ? ctxH->cStackMax * 2 : 0x100;
+            if(!(pStackNew = LocalAlloc(0, cStackMax * sizeof(VMMWINREG_SEARCH_STACK_ENTRY)))) { return; }
+            if(ctxH->pStack) {
+                memcpy(pStackNew, ctxH->pStack, ctxH->cStack * sizeof(VMMWINREG_SEARCH_STACK_ENTRY));
+            }
+            LocalFree(ctxH->pStack);
+            ctxH->pStack = pStackNew;
+            ctxH->cStackMax = cStackMax;
+        }
+        ctxH->pStack[ctxH->cStack].oCell = oEntry;
+        ctxH->pStack[ctxH->cStack].cchPathParent = cchPathParent;
+        ctxH->cStack++;
+    }
+}
+
+/*
+* Match the values of a key against the search criteria.
+* -- ctxH
+* -- pnk
+*/
+VOID VmmWinReg_SearchValues(_In_ PVMMWINREG_SEARCH_HIVE_CONTEXT ctxH, _In_ PREG_CM_KEY_NODE pnk)
+{
+    PVMMWINREG_SEARCH_CONTEXT ctx = ctxH->ctx;
+    POB_REGISTRY_HIVE pHive = ctxH->pHive;
+    DWORD i, o, cValues, cbListCell, cbCell, cbData, cbDataRead, *praValues;
+    OB_REGISTRY_VALUE Value = { 0 };
+    VMM_REGISTRY_SEARCH_MATCH Match = { 0 };
+    PREG_CM_KEY_VALUE pvk;
+    PBYTE pbDataNew;
+    if(!pnk->ValueList.Count || !VmmWinReg_KeyValidateCellSize(pHive, pnk->ValueList.List, 8, 0x00100000)) { return; }
+    cbListCell = REG_CELL_SIZE_EX(pHive->Snapshot.pb, pnk->ValueList.List);
+    cValues = min(pnk->ValueList.Count, (cbListCell - 4) >> 2);
+    praValues = (PDWORD)(pHive->Snapshot.pb + pnk->ValueList.List + 4);
+    for(i = 0; (i < cValues) && !ctx->fAbort; i++) {
+        // 1: validate value and match name
+        if(!VmmWinReg_KeyValidateCellSize(pHive, praValues[i], REG_CM_KEY_VALUE_SIZEOF + 4, 0x4000)) { continue; }
+        cbCell = REG_CELL_SIZE_EX(pHive->Snapshot.pb, praValues[i]);
+        pvk = (PREG_CM_KEY_VALUE)(pHive->Snapshot.pb + praValues[i] + 4);
+        if((pvk->Signature != REG_CM_KEY_SIGNATURE_KEYVALUE) || (pvk->NameLength > cbCell - 4 - REG_CM_KEY_VALUE_SIZEOF)) { continue; }
+        VmmWinReg_SearchName((PBYTE)pvk->szName, pvk->NameLength, pvk->Flags & REG_CM_KEY_VALUE_FLAGS_COMP_NAME, ctxH->wszName, VMMWINREG_SEARCH_NAME_MAX);
+        if(ctx->wszValueNameGlob && !Util_WildcardMatchW(ctx->wszValueNameGlob, ctxH->wszName)) { continue; }
+        // 2: retrieve data and match data pattern
+        Value.dwCellHead = *(PDWORD)(pHive->Snapshot.pb + praValues[i]);
+        Value.oCell = praValues[i];
+        Value.cbCell = cbCell;
+        Value.pValue = pvk;
+        cbData = min(VMMWINREG_SEARCH_DATA_MAX, pvk->DataLength & 0x7fffffff);
+        if(cbData > ctxH->cbData) {
+            if(!(pbDataNew = LocalAlloc(0, cbData))) { continue; }
+            LocalFree(ctxH->pbData);
+            ctxH->pbData = pbDataNew;
+            ctxH->cbData = cbData;
+        }
+        cbDataRead = 0;
+        if(cbData && !VmmWinReg_ValueQueryInternal(pHive, &Value, NULL, NULL, ctxH->pbData, cbData, &cbDataRead, 0)) {
+            cbDataRead = 0;
+        }
+        if(ctx->cbDataPattern) {
+            if(cbDataRead < ctx->cbDataPattern) { continue; }
+            for(o = 0; o <= cbDataRead - ctx->cbDataPattern; o++) {
+                if((ctxH->pbData[o] == ctx->pbDataPattern[0]) && !memcmp(ctxH->pbData + o, ctx->pbDataPattern, ctx->cbDataPattern)) { break; }
+            }
+            if(o > cbDataRead - ctx->cbDataPattern) { continue; }
+        }
+        // 3: report match
+        Match.vaCMHIVE = pHive->vaCMHIVE;
+        Match.ftLastWrite = pnk->LastWriteTime;
+        Match.wszKeyPath = ctxH->wszPath;
+        Match.wszValueName = ctxH->wszName;
+        Match.dwType = pvk->Type;
+        Match.cbData = cbDataRead;
+        Match.pbData = ctxH->pbData;
+        VmmWinReg_SearchReport(ctx, &Match);
+    }
+}
+
+/*
+* Search a single hive - work item function for VmmWorkParallel.
+* -- ctx
+* -- iHive
+*/
+VOID VmmWinReg_SearchHive(_In_opt_ PVMMWINREG_SEARCH_CONTEXT ctx, _In_ DWORD iHive)
+{
+    DWORD cbCell, cchPath, cchName;
+    PREG_CM_KEY_NODE pnk;
+    VMMWINREG_SEARCH_STACK_ENTRY e;
+    VMM_REGISTRY_SEARCH_MATCH Match = { 0 };
+    POB_REGISTRY_KEY pObKeyRoot = NULL;
+    PVMMWINREG_SEARCH_HIVE_CONTEXT ctxH = NULL;
+    BOOL fValues = ctx->wszValueNameGlob || ctx->cbDataPattern;
+    if(ctx->fAbort || !VmmWinReg_HiveSnapshotEnsure(ctx->ppHives[iHive])) { return; }
+    if(!(ctxH = LocalAlloc(LMEM_ZEROINIT, sizeof(VMMWINREG_SEARCH_HIVE_CONTEXT)))) { return; }
+    ctxH->ctx = ctx;
+    ctxH->pHive = ctx->ppHives[iHive];
+    if(!(ctxH->pvsVisited = ObVSet_New())) { goto fail; }
+    if(!(pObKeyRoot = ObMap_GetByIndex(ctxH->pHive->Snapshot.pmKeyOffset, 0))) { goto fail; }    // e[0] = ROOT
+    // 1: push root key and walk the active key tree depth first
+    e.oCell = pObKeyRoot->oCell;
+    e.cchPathParent = 0;
+    ObVSet_Push(ctxH->pvsVisited, 0x100000000 | e.oCell);
+    while(!ctx->fAbort) {
+        if(e.oCell == (DWORD)-1) {
+            if(!ctxH->cStack) { break; }
+            e = ctxH->pStack[--ctxH->cStack];
+        }
+        if(!VmmWinReg_KeyValidateCellSize(ctxH->pHive, e.oCell, REG_CM_KEY_NODE_SIZEOF + 4, 0x1000)) { e.oCell = (DWORD)-1; continue; }
+        cbCell = REG_CELL_SIZE_EX(ctxH->pHive->Snapshot.pb, e.oCell);
+        pnk = (PREG_CM_KEY_NODE)(ctxH->pHive->Snapshot.pb + e.oCell + 4);
+        if((pnk->Signature != REG_CM_KEY_SIGNATURE_KEYNODE) || (pnk->NameLength > cbCell - 4 - REG_CM_KEY_NODE_SIZEOF)) { e.oCell = (DWORD)-1; continue; }
+        // 2: build key path
+        if(!e.cchPathParent) {
+            wcscpy_s(ctxH->wszPath, VMMWINREG_SEARCH_PATH_MAX, L"ROOT");
+            cchPath = 4;
+        } else {
+            if(e.cchPathParent + 2 >= VMMWINREG_SEARCH_PATH_MAX) { e.oCell = (DWORD)-1; continue; }
+            ctxH->wszPath[e.cchPathParent] = '\\';
+            cchName = VmmWinReg_SearchName((PBYTE)pnk->szName, pnk->NameLength, pnk->Flags & REG_CM_KEY_NODE_FLAGS_COMP_NAME, ctxH->wszPath + e.cchPathParent + 1, VMMWINREG_SEARCH_PATH_MAX - e.cchPathParent - 1);
+            cchPath = e.cchPathParent + 1 + cchName;
+        }
+        // 3: match key and values
+        if(!ctx->wszKeyPathGlob || Util_WildcardMatchW(ctx->wszKeyPathGlob, ctxH->wszPath)) {
+            if(fValues) {
+                VmmWinReg_SearchValues(ctxH, pnk);
+            } else {
+                Match.vaCMHIVE = ctxH->pHive->vaCMHIVE;
+                Match.ftLastWrite = pnk->LastWriteTime;
+                Match.wszKeyPath = ctxH->wszPath;
+                VmmWinReg_SearchReport(ctx, &Match);
+            }
+        }
+        // 4: push sub-keys (persistent and volatile)
+        if(pnk->SubKeyCounts[0]) {
+            VmmWinReg_SearchPushList(ctxH, pnk->SubKeyLists[0], cchPath, 0);
+        }
+        if(pnk->SubKeyCounts[1]) {
+            VmmWinReg_SearchPushList(ctxH, pnk->SubKeyLists[1], cchPath, 0);
+        }
+        e.oCell = (DWORD)-1;
+    }
+fail:
+    Ob_DECREF(pObKeyRoot);
+    Ob_DECREF(ctxH->pvsVisited);
+    LocalFree(ctxH->pStack);
+    LocalFree(ctxH->pbData);
+    LocalFree(ctxH);
+}
+
+_Success_(return)
+BOOL VmmWinReg_Search(
+    _In_opt_ LPWSTR wszKeyPathGlob,
+    _In_opt_ LPWSTR wszValueNameGlob,
+    _In_reads_opt_(cbDataPattern) PBYTE pbDataPattern,
+    _In_ DWORD cbDataPattern,
+    _In_opt_ PVOID ctx,
+    _In_ BOOL(*pfnCallback)(_In_opt_ PVOID ctx, _In_ PVMM_REGISTRY_SEARCH_MATCH pMatch)
+) {
+    DWORD i;
+    POB_REGISTRY_HIVE pObHive = NULL;
+    VMMWINREG_SEARCH_CONTEXT ctxSearch = { 0 };
+    if(!pfnCallback || (cbDataPattern && !pbDataPattern)) { return FALSE; }
+    ctxSearch.wszKeyPathGlob = (wszKeyPathGlob && wszKeyPathGlob[0]) ? wszKeyPathGlob : NULL;
+    ctxSearch.wszValueNameGlob = wszValueNameGlob;
+    ctxSearch.pbDataPattern = pbDataPattern;
+    ctxSearch.cbDataPattern = pbDataPattern ? cbDataPattern : 0;
+    ctxSearch.ctxCallback = ctx;
+    ctxSearch.pfnCallback = pfnCallback;
+    if(!(ctxSearch.cHives = VmmWinReg_HiveCount())) { return FALSE; }
+    if(!(ctxSearch.ppHives = LocalAlloc(LMEM_ZEROINIT, ctxSearch.cHives * sizeof(POB_REGISTRY_HIVE)))) { return FALSE; }
+    for(i = 0; (i < ctxSearch.cHives) && (pObHive = VmmWinReg_HiveGetNext(pObHive)); i++) {
+        ctxSearch.ppHives[i] = Ob_INCREF(pObHive);
+    }
+    Ob_DECREF_NULL(&pObHive);
+    ctxSearch.cHives = i;
+    InitializeCriticalSection(&ctxSearch.LockCallback);
+    VmmWorkParallel(&ctxSearch, ctxSearch.cHives, (VOID(*)(PVOID, DWORD))VmmWinReg_SearchHive);
+    DeleteCriticalSection(&ctxSearch.LockCallback);
+    for(i = 0; i < ctxSearch.cHives; i++) {
+        Ob_DECREF(ctxSearch.ppHives[i]);
+    }
+    LocalFree(ctxSearch.ppHives);
+    return TRUE;
+}
@@ -19,14 +19,22 @@ typedef struct tdOB_REGISTRY_HIVE {
     QWORD _FutureReserved[0x10];
     QWORD vaHMAP_DIRECTORY;
     QWORD vaHMAP_TABLE_SmallDir;
+    PQWORD volatile pqwReg2VirtCache;   // per 4K block: cached reg2virt translation (va | 1) - lazily allocated
     CRITICAL_SECTION LockUpdate;
     // snapshot functionality below - VmmWinReg_EnsureSnapshot() must be called before access!
     struct {
         BOOL fInitialized;
+        BOOL fScanComplete;     // all hbin cells scanned for keys (incl. deleted/orphan keys)
         POB_MAP pmKeyHash;      // object map for POB_REG_KEY keyed by hash
         POB_MAP pmKeyOffset;    // object map for POB_REG_KEY& keyed by offset
         DWORD cb;
         PBYTE pb;
+        DWORD cBlock;           // number of 4K blocks in snapshot
+        DWORD cIncremental;     // incremental snapshots since last full re-read
+        DWORD dwPhysGeneration; // PHYS cache generation at the time the snapshot was read
+        PQWORD pqwBlockPA;      // per 4K block: backing physical address (0 = unknown)
+        PQWORD pqwBlockHash;    // per 4K block: content hash (allocated together with pqwBlockPA)
+        struct tdOB_REGISTRY_HIVE *pObHiveTree; // hive owning shared pb/key tree (unchanged since previous snapshot) or NULL
     } Snapshot;
 } OB_REGISTRY_HIVE, *POB_REGISTRY_HIVE;
 
@@ -44,6 +52,16 @@ typedef struct tdVMM_REGISTRY_VALUE_INFO {
     WCHAR wszName[MAX_PATH];
 } VMM_REGISTRY_VALUE_INFO, *PVMM_REGISTRY_VALUE_INFO;
 
+typedef struct tdVMM_REGISTRY_SEARCH_MATCH {
+    QWORD vaCMHIVE;
+    QWORD ftLastWrite;          // last write time of key
+    LPWSTR wszKeyPath;          // key path relative to hive, i.e. 'ROOT\Key\SubKey'
+    LPWSTR wszValueName;        // value name, or NULL on key match
+    DWORD dwType;
+    DWORD cbData;
+    PBYTE pbData;
+} VMM_REGISTRY_SEARCH_MATCH, *PVMM_REGISTRY_SEARCH_MATCH;
+
 typedef struct tdOB_REGISTRY_KEY                *POB_REGISTRY_KEY;
 typedef struct tdOB_REGISTRY_VALUE              *POB_REGISTRY_VALUE;
 
@@ -235,4 +253,29 @@ BOOL VmmWinReg_ValueQuery3(_In_ POB_REGISTRY_HIVE pHive, _In_ LPWSTR wszPathKeyV
 _Success_(return)
 BOOL VmmWinReg_ValueQuery4(_In_ POB_REGISTRY_HIVE pHive, _In_ POB_REGISTRY_VALUE pObKeyValue, _Out_opt_ PDWORD pdwType, _Out_writes_opt_(cbData) PBYTE pbData, _In_ DWORD cbData, _Out_opt_ PDWORD pcbData);
 
+/*
+* Search all registry hives for keys and values matching the given criteria.
+* Hives are searched in parallel (one work item per hive) directly over their
+* snapshot buffers without creating key/value objects. If no value name glob
+* and no data pattern is given matching keys are reported, otherwise matching
+* values are reported. Callbacks are serialized (but may be made from several
+* threads) and all pointers in the match are only valid during the callback.
+* -- wszKeyPathGlob = optional glob matched against 'ROOT\Key\SubKey'.
+* -- wszValueNameGlob = optional glob matched against value names.
+* -- pbDataPattern = optional byte pattern to find within value data.
+* -- cbDataPattern
+* -- ctx = optional context to pass to the callback function.
+* -- pfnCallback = callback function, return FALSE to stop the search.
+* -- return
+*/
+_Success_(return)
+BOOL VmmWinReg_Search(
+    _In_opt_ LPWSTR wszKeyPathGlob,
+    _In_opt_ LPWSTR wszValueNameGlob,
+    _In_reads_opt_(cbDataPattern) PBYTE pbDataPattern,
+    _In_ DWORD cbDataPattern,
+    _In_opt_ PVOID ctx,
+    _In_ BOOL(*pfnCallback)(_In_opt_ PVOID ctx, _In_ PVMM_REGISTRY_SEARCH_MATCH pMatch)
+);
+
 #endif /* __VMMWINREG_H__ */
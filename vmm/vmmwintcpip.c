@@ -22,6 +22,15 @@ typedef struct _RTL_DYNAMIC_HASH_TABLE {
     QWORD Directory;            // +020
 } RTL_DYNAMIC_HASH_TABLE, *PRTL_DYNAMIC_HASH_TABLE;
 
+#define VMMWINTCPIP_TCPE_CACHE_MAX      0x4000
+
+typedef struct tdVMMWINTCPIP_TCPE_CACHE_ENTRY {
+    QWORD vaINET_AF;
+    QWORD vaINET_Addr;
+    BOOL fCached;
+    VMMWIN_TCPIP_ENTRY e;
+} VMMWINTCPIP_TCPE_CACHE_ENTRY, *PVMMWINTCPIP_TCPE_CACHE_ENTRY;
+
 // ----------------------------------------------------------------------------
 // PARTITION TABLE LOCALIZATION FUNCTIONALITY BELOW:
 // Locate the tcpip.sys!PartitionTable which contains references to hash maps
@@ -236,37 +245,25 @@ fail:
 }
 
 /*
-* Retrieve the virtual addresses of the TCP ENDPOINT structs in memory (TcpE).
-* The virtual addresses will be put into the pObSet_TcpEndpoints set upon success.
+* Walk the tcpip.sys!PartitionTable and retrieve the addresses of the TCP hash
+* tables (TcHT) referenced by it. The partition table is allocated once at
+* boot so the result is cached in ctxVmm->TcpIp and only derived once.
+* NB! must be called with ctxVmm->TcpIp.LockUpdate held.
 * -- pSystemProcess
-* -- pObSet_TcpEndpoints
-* -- return
+* -- return = cached set of TcHT addresses, NULL on fail. NB! no INCREF.
 */
-_Success_(return)
-BOOL VmmWinTcpIp_TcpE_GetAddressEPs(_In_ PVMM_PROCESS pSystemProcess, _Inout_ POB_VSET pObSet_TcpEndpoints)
+POB_VSET VmmWinTcpIp_TcpE_GetTcHT(_In_ PVMM_PROCESS pSystemProcess)
 {
-    BOOL f, fResult = FALSE;
-    QWORD va, va2, va3;
-    DWORD i, o, oStartHT, oListPT = 0, cbRead, cbTcpHT;
-    BYTE pb[0x810] = { 0 }, pbTcHT[0x400];
-    PBYTE pbPartitionTable;
-    POB_VSET pObTcHT = NULL, pObHTab = NULL, pObTcpE = NULL;
-    PRTL_DYNAMIC_HASH_TABLE pTcpHT;
+    BOOL f;
+    DWORD o, oStartHT, oListPT = 0;
+    PBYTE pbPartitionTable = NULL;
+    POB_VSET pObTcHT = NULL;
+    if(ctxVmm->TcpIp.pObTcHT) { return ctxVmm->TcpIp.pObTcHT; }
     if(!(pbPartitionTable = LocalAlloc(LMEM_ZEROINIT, 0x4000))) { goto fail; }
     if(!(pObTcHT = ObVSet_New())) { goto fail; }
-    if(!(pObHTab = ObVSet_New())) { goto fail; }
-    if(!(pObTcpE = ObVSet_New())) { goto fail; }
-    // 1: load partition table
-    if(!ctxVmm->TcpIp.fInitialized) {
-        VmmWinTcpIp_GetPartitionTable64(pSystemProcess);
-    }
-    if(!ctxVmm->TcpIp.vaPartitionTable) { goto fail; }
-    vmmprintfvv_fn("tcpip!PartitionTable located at: 0x%016llx\n", ctxVmm->TcpIp.vaPartitionTable)
     VmmReadEx(pSystemProcess, ctxVmm->TcpIp.vaPartitionTable, pbPartitionTable, 0x4000, NULL, 0);
-    // 2: enumerate possible TcHT by walking tcpip.sys!PartitionTable
     oStartHT = (DWORD)(*(PQWORD)(pbPartitionTable + 0x10) - *(PQWORD)(pbPartitionTable + 0x00));
-    cbTcpHT = 0x10 + oStartHT + 4 * sizeof(RTL_DYNAMIC_HASH_TABLE);
-    if(cbTcpHT > sizeof(pbTcHT)) { goto fail; }
+    if(0x10 + oStartHT + 4 * sizeof(RTL_DYNAMIC_HASH_TABLE) > 0x400) { goto fail; }
     oListPT = VMMWINTCPIP_PARTITIONTABLE_OFFSET20(pbPartitionTable, ctxVmm->TcpIp.vaPartitionTable) ? 0x20 : oListPT;
     oListPT = VMMWINTCPIP_PARTITIONTABLE_OFFSET18(pbPartitionTable, ctxVmm->TcpIp.vaPartitionTable) ? 0x18 : oListPT;
     if(oListPT) {
@@ -286,14 +283,54 @@ BOOL VmmWinTcpIp_TcpE_GetAddressEPs(_In_ PVMM_PROCESS pSystemProcess, _Inout_ PO
         }
     }
     if(0 == ObVSet_Size(pObTcHT)) { goto fail; }
+    ctxVmm->TcpIp.oStartHT = oStartHT;
+    ctxVmm->TcpIp.pObTcHT = pObTcHT;
+    LocalFree(pbPartitionTable);
+    return pObTcHT;
+fail:
+    Ob_DECREF(pObTcHT);
+    LocalFree(pbPartitionTable);
+    return NULL;
+}
+
+/*
+* Retrieve the virtual addresses of the TCP ENDPOINT structs in memory (TcpE).
+* The virtual addresses will be put into the pObSet_TcpEndpoints set upon success.
+* All TcHT and all hash table directories (HTab) are each read in one scatter.
+* NB! must be called with ctxVmm->TcpIp.LockUpdate held.
+* -- pSystemProcess
+* -- pObSet_TcpEndpoints
+* -- return
+*/
+_Success_(return)
+BOOL VmmWinTcpIp_TcpE_GetAddressEPs(_In_ PVMM_PROCESS pSystemProcess, _Inout_ POB_VSET pObSet_TcpEndpoints)
+{
+    BOOL fResult = FALSE;
+    QWORD va, va2, va3;
+    DWORD i, o, cbRead, cbTcpHT, iTcHT;
+    BYTE pb[0x810] = { 0 }, pbTcHT[0x400];
+    POB_VSET pObTcHT, pObHTab = NULL, pObTcpE = NULL;
+    PRTL_DYNAMIC_HASH_TABLE pTcpHT;
+    if(!(pObHTab = ObVSet_New())) { goto fail; }
+    if(!(pObTcpE = ObVSet_New())) { goto fail; }
+    // 1: load partition table
+    if(!ctxVmm->TcpIp.fInitialized) {
+        VmmWinTcpIp_GetPartitionTable64(pSystemProcess);
+    }
+    if(!ctxVmm->TcpIp.vaPartitionTable) { goto fail; }
+    vmmprintfvv_fn("tcpip!PartitionTable located at: 0x%016llx\n", ctxVmm->TcpIp.vaPartitionTable)
+    // 2: enumerate possible TcHT by walking tcpip.sys!PartitionTable (cached)
+    if(!(pObTcHT = VmmWinTcpIp_TcpE_GetTcHT(pSystemProcess))) { goto fail; }
+    cbTcpHT = 0x10 + ctxVmm->TcpIp.oStartHT + 4 * sizeof(RTL_DYNAMIC_HASH_TABLE);
     VmmCachePrefetchPages3(pSystemProcess, pObTcHT, cbTcpHT, 0);
     // 3: enumerate possible/interesting TCP hash tables - TcHT.
-    while((va = ObVSet_Pop(pObTcHT))) {
+    for(iTcHT = 0; iTcHT < ObVSet_Size(pObTcHT); iTcHT++) {
+        va = ObVSet_Get(pObTcHT, iTcHT);
         ZeroMemory(pbTcHT, cbTcpHT);
         VmmReadEx(pSystemProcess, va, pbTcHT, cbTcpHT, &cbRead, VMM_FLAG_FORCECACHE_READ);
         if((cbTcpHT != cbRead) || (*(PDWORD)(pbTcHT + 0x04) !=  'THcT')) { continue; }
         for(i = 0; i < 4; i++) {
-            pTcpHT = (PRTL_DYNAMIC_HASH_TABLE)(pbTcHT + 0x10 + oStartHT) + i;
+            pTcpHT = (PRTL_DYNAMIC_HASH_TABLE)(pbTcHT + 0x10 + ctxVmm->TcpIp.oStartHT) + i;
             if(!VMM_KADDR64_16(pTcpHT->Directory) || (pTcpHT->TableSize != 0x80) || (pTcpHT->DivisorMask != 0x7f)) { break; }
             if(!pTcpHT->NonEmptyBuckets) { continue; }
             ObVSet_Push(pObHTab, pTcpHT->Directory - 0x10);  // store address in set & account for prepended pool header
@@ -333,16 +370,18 @@ BOOL VmmWinTcpIp_TcpE_GetAddressEPs(_In_ PVMM_PROCESS pSystemProcess, _Inout_ PO
     if(0 == ObVSet_Size(pObSet_TcpEndpoints)) { goto fail; }
     fResult = TRUE;
 fail:
-    Ob_DECREF(pObTcHT);
     Ob_DECREF(pObHTab);
     Ob_DECREF(pObTcpE);
-    LocalFree(pbPartitionTable);
     return fResult;
 }
 
 /*
 * Read the TCP ENDPOINTS in the set pSet_TcpE and fill the data into the sorted
-* result array pTcpEs.
+* result array pTcpEs. The main TcpE struct is always read. Address family, src
+* and dst addresses and the process id are taken from the endpoint cache if the
+* endpoint is unchanged since the last enumeration - only new (or re-used)
+* endpoints are resolved. The endpoint cache is replaced upon success.
+* NB! must be called with ctxVmm->TcpIp.LockUpdate held.
 * -- pSystemProcess,
 * -- pSet_TcpE = set of TcpE VAs to parse
 * -- pTcpEs = buffer to receive result of sorted entries
@@ -358,6 +397,8 @@ BOOL VmmWinTcpIp_TcpE_Enumerate(_In_ PVMM_PROCESS pSystemProcess, _In_ POB_VSET
     DWORD cbRead, c = 0, i, j;
     BYTE pb[0x400] = { 0 };
     PVMMWIN_TCPIP_ENTRY pE;
+    PVMMWINTCPIP_TCPE_CACHE_ENTRY pCE, pCEs = NULL;
+    POB_MAP pmTcpE = NULL;
     POB_VSET pObPrefetch = NULL;
     PVMM_PROCESS pObProcess = NULL;
     PVMMWIN_TCPIP_OFFSET_TcpE po = &ctxVmm->TcpIp.OTcpE;
@@ -376,6 +417,7 @@ BOOL VmmWinTcpIp_TcpE_Enumerate(_In_ PVMM_PROCESS pSystemProcess, _In_ POB_VSET
     };
     if(cTcpEs < ObVSet_Size(pSet_TcpE)) { goto fail; }
     if(!(pObPrefetch = ObVSet_New())) { goto fail; }
+    if(!(pCEs = LocalAlloc(LMEM_ZEROINIT, cTcpEs * sizeof(VMMWINTCPIP_TCPE_CACHE_ENTRY)))) { goto fail; }
     VmmCachePrefetchPages3(pSystemProcess, pSet_TcpE, po->_Size, 0);
     // 1: retrieve general info from main struct (TcpE)
     while((va = ObVSet_Pop(pSet_TcpE))) {
@@ -394,6 +436,28 @@ BOOL VmmWinTcpIp_TcpE_Enumerate(_In_ PVMM_PROCESS pSystemProcess, _In_ POB_VSET
         pE->_Reserved_vaINET_AF = *(PQWORD)(pb + po->INET_AF);
         pE->_Reserved_vaINET_Addr = *(PQWORD)(pb + po->INET_Addr);
         if(!VMM_KADDR64_8(pE->vaEPROCESS) || !VMM_KADDR64_8(pE->_Reserved_vaINET_AF) || !VMM_KADDR64_8(pE->_Reserved_vaINET_Addr)) { continue; }
+        pCEs[c].vaINET_AF = pE->_Reserved_vaINET_AF;
+        pCEs[c].vaINET_Addr = pE->_Reserved_vaINET_Addr;
+        // 1.1 unchanged endpoint already resolved in the last enumeration?
+        pCE = ObMap_GetByKey(ctxVmm->TcpIp.pmTcpE, va);
+        f = pCE &&
+            (pCE->vaINET_AF == pCEs[c].vaINET_AF) &&
+            (pCE->vaINET_Addr == pCEs[c].vaINET_Addr) &&
+            (pCE->e.vaEPROCESS == pE->vaEPROCESS) &&
+            (pCE->e.qwTime == pE->qwTime) &&
+            (pCE->e.Src.wPort == pE->Src.wPort) &&
+            (pCE->e.Dst.wPort == pE->Dst.wPort);
+        if(f) {
+            pE->dwPID = pCE->e.dwPID;
+            memcpy(&pE->AF, &pCE->e.AF, sizeof(pE->AF));
+            memcpy(pE->Src.pbA, pCE->e.Src.pbA, sizeof(pE->Src.pbA));
+            memcpy(pE->Dst.pbA, pCE->e.Dst.pbA, sizeof(pE->Dst.pbA));
+            pE->Src.fValid = pCE->e.Src.fValid;
+            pE->Dst.fValid = pCE->e.Dst.fValid;
+            pCEs[c].fCached = TRUE;
+            c++;
+            continue;
+        }
         ObVSet_Push(pObPrefetch, pE->_Reserved_vaINET_AF - 0x10);
         ObVSet_Push(pObPrefetch, pE->_Reserved_vaINET_Addr);
         c++;
@@ -404,6 +468,7 @@ BOOL VmmWinTcpIp_TcpE_Enumerate(_In_ PVMM_PROCESS pSystemProcess, _In_ POB_VSET
     if(!(pObPrefetch = ObVSet_New())) { goto fail; }
     for(i = 0; i < c; i++) {
         pE = pTcpEs + i;
+        if(pCEs[i].fCached) { continue; }
         // 2.1 fetch INET_AF
         VmmReadEx(pSystemProcess, pE->_Reserved_vaINET_AF - 0x10, pb, 0x30, &cbRead, VMM_FLAG_FORCECACHE_READ);
         if(0x30 != cbRead) { continue; }
@@ -429,6 +494,10 @@ BOOL VmmWinTcpIp_TcpE_Enumerate(_In_ PVMM_PROCESS pSystemProcess, _In_ POB_VSET
     VmmCachePrefetchPages3(pSystemProcess, pObPrefetch, 0x18, 0);
     for(i = 0; i < c; i++) {
         pE = pTcpEs + i;
+        if(pCEs[i].fCached) {
+            pE->_Reserved_fPidSearch = TRUE;
+            continue;
+        }
         if(pE->AF.fValid) {
             if((pE->AF.wAF == AF_INET) || (pE->AF.wAF == AF_INET6)) {
                 // 3.1 src address
@@ -470,11 +539,28 @@ BOOL VmmWinTcpIp_TcpE_Enumerate(_In_ PVMM_PROCESS pSystemProcess, _In_ POB_VSET
         }
         Ob_DECREF_NULL(&pObProcess);
     }
+    // 5: replace endpoint cache with fully resolved endpoints
+    if((pmTcpE = ObMap_New(OB_MAP_FLAGS_OBJECT_LOCALFREE))) {
+        for(i = 0; (i < c) && (i < VMMWINTCPIP_TCPE_CACHE_MAX); i++) {
+            pE = pTcpEs + i;
+            if(!pE->AF.fValid || !pE->Src.fValid || !pE->Dst.fValid) { continue; }
+            if(!(pCE = LocalAlloc(0, sizeof(VMMWINTCPIP_TCPE_CACHE_ENTRY)))) { break; }
+            pCE->vaINET_AF = pCEs[i].vaINET_AF;
+            pCE->vaINET_Addr = pCEs[i].vaINET_Addr;
+            memcpy(&pCE->e, pE, sizeof(VMMWIN_TCPIP_ENTRY));
+            if(!ObMap_Push(pmTcpE, pE->vaTcpE, pCE)) { LocalFree(pCE); }
+        }
+        Ob_DECREF(ctxVmm->TcpIp.pmTcpE);
+        ctxVmm->TcpIp.pmTcpE = pmTcpE;
+    }
     qsort(pTcpEs, c, sizeof(VMMWIN_TCPIP_ENTRY), (int(*)(const void*, const void*))VmmWinTcpIp_TcpE_CmpSort);
     *pcTcpEs = c;
+    Ob_DECREF(pObPrefetch);
+    LocalFree(pCEs);
     return TRUE;
 fail:
     Ob_DECREF(pObPrefetch);
+    LocalFree(pCEs);
     return FALSE;
 }
 
@@ -495,17 +581,21 @@ BOOL VmmWinTcpIp_TcpE_Get(_Out_ PPVMMWIN_TCPIP_ENTRY ppTcpE, _Out_ PDWORD pcTcpE
     if(ctxVmm->f32) { goto fail; }
     if(!(pObTcpE = ObVSet_New())) { goto fail; }
     if(!(pObSystemProcess = VmmProcessGet(4))) { goto fail; }
-    if(!VmmWinTcpIp_TcpE_GetAddressEPs(pObSystemProcess, pObTcpE)) { goto fail; }
+    EnterCriticalSection(&ctxVmm->TcpIp.LockUpdate);
+    if(!VmmWinTcpIp_TcpE_GetAddressEPs(pObSystemProcess, pObTcpE)) { goto fail_unlock; }
     VmmWinTcpIp_TcpE_Fuzz(pObSystemProcess, ObVSet_Get(pObTcpE, 0));
-    if(!ctxVmm->TcpIp.OTcpE._fValid) { goto fail; }
+    if(!ctxVmm->TcpIp.OTcpE._fValid) { goto fail_unlock; }
     cTcpEs = ObVSet_Size(pObTcpE);
-    if(!(pTcpEs = LocalAlloc(LMEM_ZEROINIT, cTcpEs * sizeof(VMMWIN_TCPIP_ENTRY)))) { goto fail; }
-    if(!VmmWinTcpIp_TcpE_Enumerate(pObSystemProcess, pObTcpE, pTcpEs, cTcpEs, &cTcpEs)) { goto fail; }
+    if(!(pTcpEs = LocalAlloc(LMEM_ZEROINIT, cTcpEs * sizeof(VMMWIN_TCPIP_ENTRY)))) { goto fail_unlock; }
+    if(!VmmWinTcpIp_TcpE_Enumerate(pObSystemProcess, pObTcpE, pTcpEs, cTcpEs, &cTcpEs)) { goto fail_unlock; }
+    LeaveCriticalSection(&ctxVmm->TcpIp.LockUpdate);
     *ppTcpE = pTcpEs;
     *pcTcpE = cTcpEs;
     Ob_DECREF(pObTcpE);
     Ob_DECREF(pObSystemProcess);
     return TRUE;
+fail_unlock:
+    LeaveCriticalSection(&ctxVmm->TcpIp.LockUpdate);
 fail:
     LocalFree(pTcpEs);
     Ob_DECREF(pObTcpE);
@@ -0,0 +1,109 @@
+// xpress.c : implementation of decompression of the Xpress (plain LZ77) format.
+//
+// (c) Ulf Frisk, 2018-2019
+// Author: Ulf Frisk, pcileech@frizk.net
+//
+#include "xpress.h"
+#include <intrin.h>
+#include <emmintrin.h>
+
+/*
+* Copy an LZ77 match inside the output buffer. Non-overlapping matches (offset
+* >= 16) are copied 16 bytes at a time using SSE2 as long as there is slack in
+* the output buffer for the last (partial) store. Overlapping matches, and any
+* match near the end of the output buffer, are copied byte by byte to preserve
+* the LZ77 repeat semantics.
+*/
+inline VOID Xpress_CopyMatch(_Inout_ PBYTE pbOut, _In_ DWORD oOut, _In_ DWORD cbOut, _In_ DWORD dwOffset, _In_ DWORD cbMatch)
+{
+    PBYTE pbDst = pbOut + oOut, pbSrc = pbDst - dwOffset;
+    DWORD i;
+    if(dwOffset == 1) {
+        memset(pbDst, pbSrc[0], cbMatch);
+        return;
+    }
+    if((dwOffset >= 16) && (oOut + cbMatch + 16 <= cbOut)) {
+        for(i = 0; i < cbMatch; i += 16) {
+            _mm_storeu_si128((__m128i*)(pbDst + i), _mm_loadu_si128((__m128i*)(pbSrc + i)));
+        }
+        return;
+    }
+    for(i = 0; i < cbMatch; i++) {
+        pbDst[i] = pbSrc[i];
+    }
+}
+
+_Success_(return)
+BOOL Xpress_Decompress(_In_reads_(cbIn) PBYTE pbIn, _In_ DWORD cbIn, _Out_writes_(cbOut) PBYTE pbOut, _In_ DWORD cbOut, _Out_ PDWORD pcbOut)
+{
+    DWORD dwFlags = 0, cFlags = 0, cLiteral, iBit;
+    DWORD oIn = 0, oOut = 0, oHalfByte = 0;
+    DWORD dwMatch, dwOffset, cbMatch;
+    *pcbOut = 0;
+    while(oOut < cbOut) {
+        if(!cFlags) {
+            if(oIn + 4 > cbIn) { break; }
+            dwFlags = *(PDWORD)(pbIn + oIn);
+            oIn += 4;
+            cFlags = 32;
+        }
+        // literal run: count consecutive zero flag bits from the top.
+        if(!(dwFlags & (1UL << (cFlags - 1)))) {
+            cLiteral = cFlags;
+            if(_BitScanReverse(&iBit, dwFlags & (0xffffffff >> (32 - cFlags)))) {
+                cLiteral = cFlags - 1 - iBit;
+            }
+            cLiteral = min(cLiteral, min(cbIn - oIn, cbOut - oOut));
+            if(!cLiteral) { break; }
+            memcpy(pbOut + oOut, pbIn + oIn, cLiteral);
+            oIn += cLiteral;
+            oOut += cLiteral;
+            cFlags -= cLiteral;
+            continue;
+        }
+        // match
+        cFlags--;
+        if(oIn == cbIn) { break; }
+        if(oIn + 2 > cbIn) { return FALSE; }
+        dwMatch = *(PWORD)(pbIn + oIn);
+        oIn += 2;
+        cbMatch = dwMatch & 7;
+        dwOffset = (dwMatch >> 3) + 1;
+        if(cbMatch == 7) {
+            if(!oHalfByte) {
+                if(oIn >= cbIn) { return FALSE; }
+                cbMatch = pbIn[oIn] & 0x0f;
+                oHalfByte = oIn;
+                oIn++;
+            } else {
+                cbMatch = pbIn[oHalfByte] >> 4;
+                oHalfByte = 0;
+            }
+            if(cbMatch == 15) {
+                if(oIn >= cbIn) { return FALSE; }
+                cbMatch = pbIn[oIn];
+                oIn++;
+                if(cbMatch == 255) {
+                    if(oIn + 2 > cbIn) { return FALSE; }
+                    cbMatch = *(PWORD)(pbIn + oIn);
+                    oIn += 2;
+                    if(!cbMatch) {
+                        if(oIn + 4 > cbIn) { return FALSE; }
+                        cbMatch = *(PDWORD)(pbIn + oIn);
+                        oIn += 4;
+                    }
+                    if(cbMatch < 15 + 7) { return FALSE; }
+                    cbMatch -= 15 + 7;
+                }
+                cbMatch += 15;
+            }
+            cbMatch += 7;
+        }
+        cbMatch += 3;
+        if((dwOffset > oOut) || (cbMatch > cbOut - oOut)) { return FALSE; }
+        Xpress_CopyMatch(pbOut, oOut, cbOut, dwOffset, cbMatch);
+        oOut += cbMatch;
+    }
+    *pcbOut = oOut;
+    return TRUE;
+}
@@ -0,0 +1,26 @@
+// xpress.h : definitions related to decompression of the Xpress (plain LZ77)
+//             format. The decoder does not depend on the vmm context and may
+//             be used stand-alone (vmm_bench).
+//
+// (c) Ulf Frisk, 2018-2019
+// Author: Ulf Frisk, pcileech@frizk.net
+//
+#ifndef __XPRESS_H__
+#define __XPRESS_H__
+#include <windows.h>
+
+/*
+* Decompress a buffer compressed with the Xpress (plain LZ77) algorithm - i.e.
+* COMPRESS_ALGORITHM_XPRESS as used by the windows memory compression store.
+* Decompression stops when the input is exhausted or the output is full.
+* -- pbIn
+* -- cbIn
+* -- pbOut
+* -- cbOut
+* -- pcbOut = number of decompressed bytes written to pbOut.
+* -- return = TRUE on success, FALSE on malformed input.
+*/
+_Success_(return)
+BOOL Xpress_Decompress(_In_reads_(cbIn) PBYTE pbIn, _In_ DWORD cbIn, _Out_writes_(cbOut) PBYTE pbOut, _In_ DWORD cbOut, _Out_ PDWORD pcbOut);
+
+#endif /* __XPRESS_H__ */
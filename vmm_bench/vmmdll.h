@@ -0,0 +1,1717 @@
+// vmmdll.h : header file to include in projects that use vmm.dll either as
+// stand anlone projects or as native plugins to vmm.dll.
+//
+// (c) Ulf Frisk, 2018-2019
+// Author: Ulf Frisk, pcileech@frizk.net
+//
+// Header Version: 3.0
+//
+
+#include <windows.h>
+#include "leechcore.h"
+
+#ifndef __VMMDLL_H__
+#define __VMMDLL_H__
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+//-----------------------------------------------------------------------------
+// INITIALIZATION FUNCTIONALITY BELOW:
+// Choose one way of initialzing the VMM / Memory Process File System.
+//-----------------------------------------------------------------------------
+
+/*
+* Initialize VMM.DLL with command line parameters. For a more detailed info
+* about the parameters please see github wiki for MemProcFS and LeechCore.
+* NB! LeechCore initialization parameters are _also_ valid to this function.
+* Important parameters are:
+*    -printf = show printf style outputs.
+*    -v -vv -vvv = extra verbosity levels.
+*    -device = device as on format for LeechCore - please see leechcore.h or
+*              Github documentation for additional information. Some values
+*              are: <file>, fpga, usb3380, hvsavedstate, totalmeltdown, pmem
+*    -remote = remote LeechCore instance - please see leechcore.h or Github
+*              documentation for additional information.
+*    -norefresh = disable background refreshes (even if backing memory is
+*              volatile memory).
+*    -symbolserverdisable = disable symbol server until user change.
+*              This parameter will take precedence over registry settings.
+*    -pagefile[0-9] = page file(s) to use in addition to physical memory.
+*              Normally pagefile.sys have index 0 and swapfile.sys index 1.
+*              Page files are in constant flux - do not use if time diff
+*              between memory dump and page files are more than few minutes.
+*              Example: 'pagefile0 swapfile.sys'
+*    -waitinitialize = Wait for initialization to complete before returning.
+*              Normal use is that some initialization is done asynchronously
+*              and may not be completed when initialization call is completed.
+*              This includes virtual memory compression, registry and more.
+*              Example: '-waitinitialize'
+*    -cachesize = total memory budget in MB of the physical memory, page table
+*              and paged memory caches. Lower the budget when analyzing many
+*              targets in parallel (one process per target).
+*              Example: '-cachesize 64'
+*
+* Only one instance of VMM.DLL may be initialized per process since all state
+* and the LeechCore memory acquisition device are process-wide. There is no
+* handle based API; multiple targets can't be analyzed concurrently in one
+* process and cache budgets / worker threads can't be shared between targets.
+* To analyze another target call VMMDLL_Close before initializing again -
+* initializing an already initialized VMM.DLL fails. To analyze targets in
+* parallel use one process per target with a lowered -cachesize.
+* -- argc
+* -- argv
+* -- return = success/fail
+*/
+_Success_(return)
+BOOL VMMDLL_Initialize(_In_ DWORD argc, _In_ LPSTR argv[]);
+
+/*
+* Close an initialized instance of VMM.DLL and clean up all allocated resources
+* including plugins, linked PCILeech.DLL and other memory resources.
+* -- return = success/fail.
+*/
+_Success_(return)
+BOOL VMMDLL_Close();
+
+/*
+* Perform a refresh of all internal caches including:
+* - process listings
+* - memory cache
+* - page table cache
+* If dwMaxAgeMs is non-zero only the caches/listings last refreshed more than
+* dwMaxAgeMs milliseconds ago are refreshed ("refresh if older than").
+* WARNING: function may take some time to execute!
+* -- dwMaxAgeMs = max age in ms, 0 = force refresh of everything.
+* -- return = sucess/fail
+*/
+_Success_(return)
+BOOL VMMDLL_Refresh(_In_ DWORD dwMaxAgeMs);
+
+/*
+* Free memory allocated by the VMMDLL.
+* -- pvMem
+*/
+VOID VMMDLL_MemFree(_Frees_ptr_opt_ PVOID pvMem);
+
+
+//-----------------------------------------------------------------------------
+// CONFIGURATION SETTINGS BELOW:
+// Configure the memory process file system or the underlying memory
+// acquisition devices.
+//-----------------------------------------------------------------------------
+
+/*
+* Options used together with the functions: VMMDLL_ConfigGet & VMMDLL_ConfigSet
+* Options are defined with either: VMMDLL_OPT_* in this header file or as
+* LEECHCORE_OPT_* in leechcore.h
+* For more detailed information check the sources for individual device types.
+*/
+#define VMMDLL_OPT_CORE_PRINTF_ENABLE                   0x80000001  // RW
+#define VMMDLL_OPT_CORE_VERBOSE                         0x80000002  // RW
+#define VMMDLL_OPT_CORE_VERBOSE_EXTRA                   0x80000003  // RW
+#define VMMDLL_OPT_CORE_VERBOSE_EXTRA_TLP               0x80000004  // RW
+#define VMMDLL_OPT_CORE_MAX_NATIVE_ADDRESS              0x80000005  // R
+#define VMMDLL_OPT_CORE_SYSTEM                          0x80000007  // R
+#define VMMDLL_OPT_CORE_MEMORYMODEL                     0x80000008  // R
+
+#define VMMDLL_OPT_CONFIG_IS_REFRESH_ENABLED            0x40000001  // R - 1/0
+#define VMMDLL_OPT_CONFIG_TICK_PERIOD                   0x40000002  // RW - base tick period in ms
+#define VMMDLL_OPT_CONFIG_READCACHE_TICKS               0x40000003  // RW - memory cache validity period (in ticks)
+#define VMMDLL_OPT_CONFIG_TLBCACHE_TICKS                0x40000004  // RW - page table (tlb) cache validity period (in ticks)
+#define VMMDLL_OPT_CONFIG_PROCCACHE_TICKS_PARTIAL       0x40000005  // RW - process refresh (partial) period (in ticks)
+#define VMMDLL_OPT_CONFIG_PROCCACHE_TICKS_TOTAL         0x40000006  // RW - process refresh (full) period (in ticks)
+#define VMMDLL_OPT_CONFIG_VMM_VERSION_MAJOR             0x40000007  // R
+#define VMMDLL_OPT_CONFIG_VMM_VERSION_MINOR             0x40000008  // R
+#define VMMDLL_OPT_CONFIG_VMM_VERSION_REVISION          0x40000009  // R
+#define VMMDLL_OPT_CONFIG_STATISTICS_FUNCTIONCALL       0x4000000A  // RW - enable function call statistics (.status/statistics_fncall file)
+#define VMMDLL_OPT_CONFIG_IS_PAGING_ENABLED             0x4000000B  // RW - 1/0
+#define VMMDLL_OPT_CONFIG_CACHE_BUDGET_MB               0x4000000C  // RW - total memory budget (in MB) of the PHYS/TLB/PAGING caches
+#define VMMDLL_OPT_CONFIG_CACHE_POLICY                  0x4000000D  // RW - cache eviction policy: 0 = age (default), 1 = 2Q (scan resistant)
+#define VMMDLL_OPT_CONFIG_READSCATTER_ASYNC_INFLIGHT    0x4000000E  // RW - max number of VMMDLL_MemReadScatterAsync batches in flight (1-64)
+#define VMMDLL_OPT_CONFIG_REGISTRY_LAZY                 0x4000000F  // RW - 1 = registry key listings only resolve the listed key's subkey lists (no deleted/orphan keys), 0 = full hive scan on first listing (default)
+#define VMMDLL_OPT_CONFIG_INIT_STAGED                   0x40000010  // R - 1 = staged initialization (-stagedinit): subsystems are initialized in the background
+#define VMMDLL_OPT_CONFIG_TRACE_RING                    0x40000011  // RW - 1 = record trace events into the in-memory ring buffer (.status/trace file)
+#define VMMDLL_OPT_CONFIG_REFRESH_ADAPTIVE              0x40000012  // RW - 1 = adapt refresh periods to measured change rates (default), 0 = fixed refresh periods
+#define VMMDLL_OPT_CONFIG_REFRESH_IDLE_MS               0x40000013  // RW - suspend refreshes after ms without api activity, 0 = never suspend
+#define VMMDLL_OPT_CONFIG_REMOTE_PIPELINE_DEPTH         0x40000014  // RW - max outstanding requests per scatter read towards remote devices (1-16, 1 = no pipelining)
+#define VMMDLL_OPT_CONFIG_CACHE_DEDUP                   0x40000015  // RW - PHYS cache content deduplication: 0 = off, 1 = zero pages (default), 2 = zero + duplicate pages
+#define VMMDLL_OPT_CONFIG_PROTOTYPEPTE_CACHE_MB         0x40000016  // RW - memory budget of the prototype pte array cache in MB (1-4096)
+#define VMMDLL_OPT_CONFIG_PAGING_FAILED_TTL_MS          0x40000017  // RW - ms a failed paged memory read is remembered before being retried
+#define VMMDLL_OPT_CONFIG_REMOTE_COMPRESS               0x40000018  // R - 1 = remote device page payloads are compressed (default, -remotenocompress to disable)
+#define VMMDLL_OPT_CONFIG_REMOTE_PREFETCH_ASYNC         0x40000019  // RW - 1 = VMMDLL_MemPrefetchPages towards remote devices returns immediately and prefetches in the background (default)
+// options below take a sub-option in bits 0-11 (and for some in bits 32-63).
+// each option occupies its own 0x1000 range separate from plain options 0x40000xxx.
+#define VMMDLL_OPT_CONFIG_CACHESTAT_PHYS                0x40001000  // R - PHYS cache statistics counter: OR with VMMDLL_OPT_CACHESTAT_*
+#define VMMDLL_OPT_CONFIG_CACHESTAT_TLB                 0x40002000  // R - TLB cache statistics counter: OR with VMMDLL_OPT_CACHESTAT_*
+#define VMMDLL_OPT_CONFIG_CACHESTAT_PAGING              0x40003000  // R - PAGING cache statistics counter: OR with VMMDLL_OPT_CACHESTAT_*
+#define VMMDLL_OPT_CONFIG_INIT_READY                    0x40004000  // R - 1 = initialization stage ready: OR with VMMDLL_OPT_INIT_STAGE_*
+#define VMMDLL_OPT_CONFIG_INIT_TIME_MS                  0x40005000  // R - initialization stage duration in ms (0 if not ready): OR with VMMDLL_OPT_INIT_STAGE_*
+#define VMMDLL_OPT_CONFIG_OBJECTS                       0x40006000  // R - object manager counter: OR with VMMDLL_OPT_OBJECTS_* and optionally ((ULONG64)tag << 32) for a single object tag (default: all tags)
+#define VMMDLL_OPT_CONFIG_STATISTICS_CALL               0x40007000  // R - function call statistics (requires VMMDLL_OPT_CONFIG_STATISTICS_FUNCTIONCALL): OR with VMMDLL_OPT_STATISTICS_CALL_* and ((ULONG64)id << 32), id = row index in .status/statistics_fncall
+
+#define VMMDLL_OPT_CACHESTAT_HIT                        0x01        // cache lookup hits
+#define VMMDLL_OPT_CACHESTAT_MISS                       0x02        // cache lookup misses
+#define VMMDLL_OPT_CACHESTAT_INSERT                     0x03        // entries inserted
+#define VMMDLL_OPT_CACHESTAT_EVICT                      0x04        // entries evicted to make room for new entries
+#define VMMDLL_OPT_CACHESTAT_EVICT_STALE                0x05        // stale entries (from previous refresh) reclaimed
+#define VMMDLL_OPT_CACHESTAT_ENTRIES                    0x06        // current number of entries in the cache
+#define VMMDLL_OPT_CACHESTAT_ENTRIES_MAX                0x07        // max number of entries in the cache
+#define VMMDLL_OPT_CACHESTAT_LOCK_CONTENDED             0x08        // number of contended region lock acquisitions
+#define VMMDLL_OPT_CACHESTAT_LOCK_WAIT_US               0x09        // total time waited for region locks (microseconds)
+
+#define VMMDLL_OPT_OBJECTS_ALIVE                        0x01        // currently alive objects
+#define VMMDLL_OPT_OBJECTS_ALLOC_TOTAL                  0x02        // total number of allocated objects
+#define VMMDLL_OPT_OBJECTS_BYTES                        0x03        // bytes held by currently alive objects
+#define VMMDLL_OPT_OBJECTS_PEAK                         0x04        // peak number of alive objects (sampled)
+#define VMMDLL_OPT_OBJECTS_TAGS                         0x05        // number of accounted object tags
+
+#define VMMDLL_OPT_STATISTICS_CALL_COUNT                0x01        // number of calls
+#define VMMDLL_OPT_STATISTICS_CALL_TIME_TOTAL_US        0x02        // total time spent in calls (microseconds)
+#define VMMDLL_OPT_STATISTICS_CALL_TIME_P50_US          0x03        // approximate median call latency (microseconds)
+#define VMMDLL_OPT_STATISTICS_CALL_TIME_P99_US          0x04        // approximate 99th percentile call latency (microseconds)
+#define VMMDLL_OPT_STATISTICS_CALL_TIME_P999_US         0x05        // approximate 99.9th percentile call latency (microseconds)
+#define VMMDLL_OPT_STATISTICS_CALL_TIME_MAX_US          0x06        // max call latency (microseconds)
+#define VMMDLL_OPT_STATISTICS_CALL_IDS                  0x07        // number of function call ids (id is ignored)
+
+#define VMMDLL_OPT_INIT_STAGE_ALL                       0x00        // all stages (ready: all stages ready, time: ms from start until last stage ready)
+#define VMMDLL_OPT_INIT_STAGE_KERNEL                    0x01        // DTB, memory model and ntoskrnl.exe
+#define VMMDLL_OPT_INIT_STAGE_PROCESS                   0x02        // process list
+#define VMMDLL_OPT_INIT_STAGE_KERNELINFO                0x03        // PsLoadedModuleList and KDBG
+#define VMMDLL_OPT_INIT_STAGE_REGISTRY                  0x04        // registry hive map
+#define VMMDLL_OPT_INIT_STAGE_PDB                       0x05        // debug symbol subsystem
+#define VMMDLL_OPT_INIT_STAGE_PAGING                    0x06        // full paging - page files and memory compression
+#define VMMDLL_OPT_INIT_STAGE_THREADING                 0x07        // thread map
+#define VMMDLL_OPT_INIT_STAGE_KERNELOPT                 0x08        // optional kernel values
+
+#define VMMDLL_OPT_WIN_VERSION_MAJOR                    0x40000101  // R
+#define VMMDLL_OPT_WIN_VERSION_MINOR                    0x40000102  // R
+#define VMMDLL_OPT_WIN_VERSION_BUILD                    0x40000103  // R
+
+static const LPSTR VMMDLL_MEMORYMODEL_TOSTRING[4] = { "N/A", "X86", "X86PAE", "X64" };
+
+typedef enum tdVMMDLL_MEMORYMODEL_TP {
+    VMMDLL_MEMORYMODEL_NA       = 0,
+    VMMDLL_MEMORYMODEL_X86      = 1,
+    VMMDLL_MEMORYMODEL_X86PAE   = 2,
+    VMMDLL_MEMORYMODEL_X64      = 3
+} VMMDLL_MEMORYMODEL_TP;
+
+typedef enum tdVMMDLL_SYSTEM_TP {
+    VMMDLL_SYSTEM_UNKNOWN_X64   = 1,
+    VMMDLL_SYSTEM_WINDOWS_X64   = 2,
+    VMMDLL_SYSTEM_UNKNOWN_X86   = 3,
+    VMMDLL_SYSTEM_WINDOWS_X86   = 4
+} VMMDLL_SYSTEM_TP;
+
+/*
+* Set a device specific option value. Please see defines VMMDLL_OPT_* for infor-
+* mation about valid option values. Please note that option values may overlap
+* between different device types with different meanings.
+* -- fOption
+* -- pqwValue = pointer to ULONG64 to receive option value.
+* -- return = success/fail.
+*/
+_Success_(return)
+BOOL VMMDLL_ConfigGet(_In_ ULONG64 fOption, _Out_ PULONG64 pqwValue);
+
+/*
+* Set a device specific option value. Please see defines VMMDLL_OPT_* for infor-
+* mation about valid option values. Please note that option values may overlap
+* between different device types with different meanings.
+* -- fOption
+* -- qwValue
+* -- return = success/fail.
+*/
+_Success_(return)
+BOOL VMMDLL_ConfigSet(_In_ ULONG64 fOption, _In_ ULONG64 qwValue);
+
+
+
+//-----------------------------------------------------------------------------
+// VFS - VIRTUAL FILE SYSTEM FUNCTIONALITY BELOW:
+// This is the core of the memory process file system. All implementation and
+// analysis towards the file system is possible by using functionality below. 
+//-----------------------------------------------------------------------------
+
+#define VMMDLL_STATUS_SUCCESS                       ((NTSTATUS)0x00000000L)
+#define VMMDLL_STATUS_UNSUCCESSFUL                  ((NTSTATUS)0xC0000001L)
+#define VMMDLL_STATUS_END_OF_FILE                   ((NTSTATUS)0xC0000011L)
+#define VMMDLL_STATUS_FILE_INVALID                  ((NTSTATUS)0xC0000098L)
+#define VMMDLL_STATUS_FILE_SYSTEM_LIMITATION        ((NTSTATUS)0xC0000427L)
+
+#define VMMDLL_VFS_FILELIST_EXINFO_VERSION          1
+#define VMMDLL_VFS_FILELIST_VERSION                 1
+
+typedef struct tdVMMDLL_VFS_FILELIST_EXINFO {
+    DWORD dwVersion;
+    BOOL fCompressed;                   // set flag FILE_ATTRIBUTE_COMPRESSED - (no meaning but shows gui artifact in explorer.exe)
+    union {
+        FILETIME ftCreationTime;        // 0 = default time
+        QWORD qwCreationTime;
+    };
+    union {
+        FILETIME ftLastAccessTime;      // 0 = default time
+        QWORD qwLastAccessTime;
+    };
+    union {
+        FILETIME ftLastWriteTime;       // 0 = default time
+        QWORD qwLastWriteTime;
+    };
+} VMMDLL_VFS_FILELIST_EXINFO, *PVMMDLL_VFS_FILELIST_EXINFO;
+
+typedef struct tdVMMDLL_VFS_FILELIST {
+    DWORD dwVersion;
+    VOID(*pfnAddFile)     (_Inout_ HANDLE h, _In_opt_ LPSTR szName, _In_opt_ LPWSTR wszName, _In_ ULONG64 cb, _In_opt_ PVMMDLL_VFS_FILELIST_EXINFO pExInfo);
+    VOID(*pfnAddDirectory)(_Inout_ HANDLE h, _In_opt_ LPSTR szName, _In_opt_ LPWSTR wszName, _In_opt_ PVMMDLL_VFS_FILELIST_EXINFO pExInfo);
+    HANDLE h;
+} VMMDLL_VFS_FILELIST, *PVMMDLL_VFS_FILELIST;
+
+/*
+* Helper inline functions for callbacks into the VMM_VFS_FILELIST structure.
+*/
+inline VOID VMMDLL_VfsList_AddFile(_In_ HANDLE pFileList, _In_opt_ LPSTR szName, _In_ ULONG64 cb)
+{
+    ((PVMMDLL_VFS_FILELIST)pFileList)->pfnAddFile(((PVMMDLL_VFS_FILELIST)pFileList)->h, szName, NULL, cb, NULL);
+}
+
+inline VOID VMMDLL_VfsList_AddFileEx(_In_ HANDLE pFileList, _In_opt_ LPSTR szName, _In_opt_ LPWSTR wszName, _In_ ULONG64 cb, _In_opt_ PVMMDLL_VFS_FILELIST_EXINFO pExInfo)
+{
+    ((PVMMDLL_VFS_FILELIST)pFileList)->pfnAddFile(((PVMMDLL_VFS_FILELIST)pFileList)->h, szName, wszName, cb, pExInfo);
+}
+
+inline VOID VMMDLL_VfsList_AddDirectory(_In_ HANDLE pFileList, _In_opt_ LPSTR szName)
+{
+    ((PVMMDLL_VFS_FILELIST)pFileList)->pfnAddDirectory(((PVMMDLL_VFS_FILELIST)pFileList)->h, szName, NULL, NULL);
+}
+
+inline VOID VMMDLL_VfsList_AddDirectoryEx(_In_ HANDLE pFileList, _In_opt_ LPSTR szName, _In_opt_ LPWSTR wszName, _In_opt_ PVMMDLL_VFS_FILELIST_EXINFO pExInfo)
+{
+    ((PVMMDLL_VFS_FILELIST)pFileList)->pfnAddDirectory(((PVMMDLL_VFS_FILELIST)pFileList)->h, szName, wszName, pExInfo);
+}
+
+inline BOOL VMMDLL_VfsList_IsHandleValid(_In_ HANDLE pFileList)
+{
+    return ((PVMMDLL_VFS_FILELIST)pFileList)->dwVersion == VMMDLL_VFS_FILELIST_VERSION;
+}
+
+/*
+* List a directory of files in the memory process file system. Directories and
+* files will be listed by callbacks into functions supplied in the pFileList
+* parameter. If information of an individual file is needed it's neccessary
+* to list all files in its directory.
+* -- wcsPath
+* -- pFileList
+* -- return
+*/
+_Success_(return)
+BOOL VMMDLL_VfsList(_In_ LPCWSTR wcsPath, _Inout_ PVMMDLL_VFS_FILELIST pFileList);
+
+/*
+* Read select parts of a file in the memory process file system.
+* -- wcsFileName
+* -- pb
+* -- cb
+* -- pcbRead
+* -- cbOffset
+* -- return
+*
+*/
+NTSTATUS VMMDLL_VfsRead(_In_ LPCWSTR wcsFileName, _Out_ LPVOID pb, _In_ DWORD cb, _Out_ PDWORD pcbRead, _In_ ULONG64 cbOffset);
+
+/*
+* Write select parts to a file in the memory process file system.
+* -- wcsFileName
+* -- pb
+* -- cb
+* -- pcbWrite
+* -- cbOffset
+* -- return
+*/
+NTSTATUS VMMDLL_VfsWrite(_In_ LPCWSTR wcsFileName, _In_ LPVOID pb, _In_ DWORD cb, _Out_ PDWORD pcbWrite, _In_ ULONG64 cbOffset);
+
+#define VMMDLL_DUMP_FLAG_CRASHDUMP              0x0001  // write memory.dmp crash dump format (default: memory.pmem raw format)
+
+/*
+* Write a full physical memory dump to a file. This is equivalent of copying
+* the file memory.pmem (or memory.dmp) in the memory process file system root
+* but considerably faster; memory is read in large chunks in parallel across
+* threads bypassing the internal cache and holes in the physical memory map
+* are skipped. Progress and throughput is printed (if printf is enabled).
+* -- szFileName = the file to write (existing files are overwritten).
+* -- flags = optional flags as given by VMMDLL_DUMP_FLAG_*
+* -- return = success/fail.
+*/
+_Success_(return)
+BOOL VMMDLL_DumpToFile(_In_ LPSTR szFileName, _In_ DWORD flags);
+
+/*
+* Utility functions for memory process file system read/write towards different
+* underlying data representations.
+*/
+NTSTATUS VMMDLL_UtilVfsReadFile_FromPBYTE(_In_ PBYTE pbFile, _In_ ULONG64 cbFile, _Out_ PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbRead, _In_ ULONG64 cbOffset);
+NTSTATUS VMMDLL_UtilVfsReadFile_FromQWORD(_In_ ULONG64 qwValue, _Out_ PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbRead, _In_ ULONG64 cbOffset, _In_ BOOL fPrefix);
+NTSTATUS VMMDLL_UtilVfsReadFile_FromDWORD(_In_ DWORD dwValue, _Out_ PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbRead, _In_ ULONG64 cbOffset, _In_ BOOL fPrefix);
+NTSTATUS VMMDLL_UtilVfsReadFile_FromBOOL(_In_ BOOL fValue, _Out_ PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbRead, _In_ ULONG64 cbOffset);
+NTSTATUS VMMDLL_UtilVfsWriteFile_BOOL(_Inout_ PBOOL pfTarget, _In_ PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbWrite, _In_ ULONG64 cbOffset);
+NTSTATUS VMMDLL_UtilVfsWriteFile_DWORD(_Inout_ PDWORD pdwTarget, _In_ PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbWrite, _In_ ULONG64 cbOffset, _In_ DWORD dwMinAllow);
+
+
+//-----------------------------------------------------------------------------
+// PLUGIN MANAGER FUNCTIONALITY BELOW:
+// Function and structures to initialize and use the memory process file system
+// plugin functionality. The plugin manager is started by a call to function:
+// VMM_VfsInitializePlugins. Each built-in plugin and external plugin of which
+// the DLL name matches m_*.dll will receive a call to its InitializeVmmPlugin
+// function. The plugin/module may decide to call pfnPluginManager_Register to
+// register plugins in the form of different names one or more times.
+// Example of registration function in a plugin DLL below: 
+// 'VOID InitializeVmmPlugin(_In_ PVMM_PLUGIN_REGINFO pRegInfo)'
+//-----------------------------------------------------------------------------
+
+/*
+* Initialize all potential plugins, both built-in and external, that maps into
+* the memory process file system. Please note that plugins are not loaded by
+* default - they have to be explicitly loaded by calling this function. They
+* will be unloaded on a general close of the vmm dll.
+* -- return
+*/
+_Success_(return)
+BOOL VMMDLL_VfsInitializePlugins();
+
+typedef VOID(*VMMDLL_NOTIFY_CALLBACK)(_In_opt_ PVOID ctx, _In_ DWORD fEvent, _In_opt_ PVOID pvEvent, _In_opt_ DWORD cbEvent);
+
+/*
+* Subscribe to change notifications without being a plugin. The callback is
+* called on the refresh thread with the same events and event data as sent to
+* plugin pfnNotify. The callback must return quickly and must not call the
+* VMMDLL_NotifySubscribe/VMMDLL_NotifyUnsubscribe functions.
+* -- fEventMask = mask of VMMDLL_PLUGIN_EVENT_PROCESS_* / VMMDLL_PLUGIN_EVENT_MAP_*
+* -- pfnCallback
+* -- ctx = optional context passed to pfnCallback.
+* -- return = success/fail (max 16 concurrent subscriptions).
+*/
+_Success_(return)
+BOOL VMMDLL_NotifySubscribe(_In_ DWORD fEventMask, _In_ VMMDLL_NOTIFY_CALLBACK pfnCallback, _In_opt_ PVOID ctx);
+
+/*
+* Remove a subscription previously added by VMMDLL_NotifySubscribe. The
+* function waits for an ongoing callback to return; once it has returned the
+* callback will not be called again and ctx may be freed.
+* -- pfnCallback
+* -- ctx
+* -- return = success/fail.
+*/
+_Success_(return)
+BOOL VMMDLL_NotifyUnsubscribe(_In_ VMMDLL_NOTIFY_CALLBACK pfnCallback, _In_opt_ PVOID ctx);
+
+#define VMMDLL_PLUGIN_CONTEXT_MAGIC             0xc0ffee663df9301c
+#define VMMDLL_PLUGIN_CONTEXT_VERSION           3
+#define VMMDLL_PLUGIN_REGINFO_MAGIC             0xc0ffee663df9301d
+#define VMMDLL_PLUGIN_REGINFO_VERSION           4
+
+#define VMMDLL_PLUGIN_EVENT_VERBOSITYCHANGE     0x01
+#define VMMDLL_PLUGIN_EVENT_TOTALREFRESH        0x02
+#define VMMDLL_PLUGIN_EVENT_PROCESS_TERMINATE   0x04    // pvEvent = PVMMDLL_PLUGIN_NOTIFY_PROCESS
+#define VMMDLL_PLUGIN_EVENT_PROCESS_CREATE      0x08    // pvEvent = PVMMDLL_PLUGIN_NOTIFY_PROCESS
+#define VMMDLL_PLUGIN_EVENT_MAP_MODULE          0x10    // pvEvent = PVMMDLL_PLUGIN_NOTIFY_PROCESS
+#define VMMDLL_PLUGIN_EVENT_MAP_HANDLE          0x20    // pvEvent = PVMMDLL_PLUGIN_NOTIFY_PROCESS
+
+// event data for process create/terminate and module/handle map changed events.
+// qwGeneration is the process table generation for process events and the map
+// generation (as returned by VMMDLL_ProcessGetGeneration) for map events.
+typedef struct tdVMMDLL_PLUGIN_NOTIFY_PROCESS {
+    DWORD dwPID;
+    DWORD _Reserved;
+    ULONG64 qwGeneration;
+} VMMDLL_PLUGIN_NOTIFY_PROCESS, *PVMMDLL_PLUGIN_NOTIFY_PROCESS;
+
+typedef struct tdVMMDLL_PLUGIN_CONTEXT {
+    ULONG64 magic;
+    WORD wVersion;
+    WORD wSize;
+    DWORD dwPID;
+    PVOID pProcess;
+    LPWSTR wszModule;
+    LPWSTR wszPath;
+    PVOID pvReserved1;
+    PVOID pvReserved2;
+} VMMDLL_PLUGIN_CONTEXT, *PVMMDLL_PLUGIN_CONTEXT;
+
+typedef struct tdVMMDLL_PLUGIN_REGINFO {
+    ULONG64 magic;
+    WORD wVersion;
+    WORD wSize;
+    VMMDLL_MEMORYMODEL_TP tpMemoryModel;
+    VMMDLL_SYSTEM_TP tpSystem;
+    HMODULE hDLL;
+    HMODULE hReservedDllPython3X;   // not for general use (only used for python).
+    BOOL(*pfnPluginManager_Register)(struct tdVMMDLL_PLUGIN_REGINFO *pPluginRegInfo);
+    HMODULE hReservedDllPython3;   // not for general use (only used for python).
+    PVOID pvReserved2;
+    // general plugin registration info to be filled out by the plugin below:
+    struct {
+        WCHAR wszModuleName[32];
+        BOOL fRootModule;
+        BOOL fProcessModule;
+        PVOID pvReserved1;
+        PVOID pvReserved2;
+    } reg_info;
+    // function plugin registration info to be filled out by the plugin below:
+    struct {
+        BOOL(*pfnList)(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _Inout_ PHANDLE pFileList);
+        NTSTATUS(*pfnRead)(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _Out_ PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbRead,  _In_ ULONG64 cbOffset);
+        NTSTATUS(*pfnWrite)(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _In_ PBYTE pb, _In_ DWORD cb, _Out_ PDWORD pcbWrite, _In_ ULONG64 cbOffset);
+        VOID(*pfnNotify)(_In_ DWORD fEvent, _In_opt_ PVOID pvEvent, _In_opt_ DWORD cbEvent);
+        VOID(*pfnClose)();
+        PVOID pvReserved1;
+        PVOID pvReserved2;
+    } reg_fn;
+} VMMDLL_PLUGIN_REGINFO, *PVMMDLL_PLUGIN_REGINFO;
+
+//-----------------------------------------------------------------------------
+// VMM CORE FUNCTIONALITY BELOW:
+// Vmm core functaionlity such as read (and write) to both virtual and physical
+// memory. NB! writing will only work if the target is supported - i.e. not a
+// memory dump file...
+// To read physical memory specify dwPID as (DWORD)-1
+//-----------------------------------------------------------------------------
+
+// FLAG used to supress the default read cache in calls to VMM_MemReadEx()
+// which will lead to the read being fetched from the target system always.
+// Cached page tables (used for translating virtual2physical) are still used.
+#define VMMDLL_FLAG_NOCACHE                        0x0001  // do not use the data cache (force reading from memory acquisition device)
+#define VMMDLL_FLAG_ZEROPAD_ON_FAIL                0x0002  // zero pad failed physical memory reads and report success if read within range of physical memory.
+#define VMMDLL_FLAG_FORCECACHE_READ                0x0008  // force use of cache - fail non-cached pages - only valid for reads, invalid with VMM_FLAG_NOCACHE/VMM_FLAG_ZEROPAD_ON_FAIL.
+#define VMMDLL_FLAG_NOPAGING                       0x0010  // do not try to retrieve memory from paged out memory from pagefile/compressed (even if possible)
+#define VMMDLL_FLAG_NOPAGING_IO                    0x0020  // do not try to retrieve memory from paged out memory if read would incur additional I/O (even if possible).
+
+/*
+* Read memory in various non-contigious locations specified by the pointers to
+* the items in the ppMEMs array. Result for each unit of work will be given
+* individually. No upper limit of number of items to read, but no performance
+* boost will be given if above hardware limit. Max size of each unit of work is
+* one 4k page (4096 bytes).
+* -- dwPID - PID of target process, (DWORD)-1 to read physical memory.
+* -- ppMEMs = array of scatter read headers.
+* -- cpMEMs = count of ppMEMs.
+* -- flags = optional flags as given by VMMDLL_FLAG_*
+* -- return = the number of successfully read items.
+*/
+DWORD VMMDLL_MemReadScatter(_In_ DWORD dwPID, _Inout_ PPMEM_IO_SCATTER_HEADER ppMEMs, _In_ DWORD cpMEMs, _In_ DWORD flags);
+
+/*
+* Callback function for VMMDLL_MemReadScatterAsync. The callback is called on
+* a worker thread once the batch has been read.
+* -- ctx = the caller supplied context.
+* -- ppMEMs = the array of scatter read headers of the completed batch.
+* -- cpMEMs = count of ppMEMs.
+* -- cMEMsRead = the number of successfully read items.
+*/
+typedef VOID(*VMMDLL_MEM_SCATTER_ASYNC_CALLBACK)(_In_opt_ PVOID ctx, _In_ PPMEM_IO_SCATTER_HEADER ppMEMs, _In_ DWORD cpMEMs, _In_ DWORD cMEMsRead);
+
+/*
+* Submit an asynchronous scatter read of a batch of memory - see the function
+* VMMDLL_MemReadScatter for more information about the read. The function
+* returns immediately unless the max number of batches are already in flight,
+* in which case it waits for a batch to complete. The max number of batches is
+* set by the option VMMDLL_OPT_CONFIG_READSCATTER_ASYNC_INFLIGHT.
+* The ppMEMs array, its headers and buffers must remain valid until the batch
+* has completed. Completion is signalled by the optional callback function as
+* well as by the returned waitable handle.
+* CALLER CloseHandle: return
+* -- dwPID - PID of target process, (DWORD)-1 to read physical memory.
+* -- ppMEMs = array of scatter read headers.
+* -- cpMEMs = count of ppMEMs.
+* -- flags = optional flags as given by VMMDLL_FLAG_*
+* -- pfnCallback = optional callback function to call on batch completion.
+* -- ctx = optional context to pass along to the callback function.
+* -- return = waitable handle signalled after completion (and after callback),
+*             or NULL on fail. The handle must be closed with CloseHandle.
+*/
+_Success_(return != NULL)
+HANDLE VMMDLL_MemReadScatterAsync(_In_ DWORD dwPID, _Inout_ PPMEM_IO_SCATTER_HEADER ppMEMs, _In_ DWORD cpMEMs, _In_ DWORD flags, _In_opt_ VMMDLL_MEM_SCATTER_ASYNC_CALLBACK pfnCallback, _In_opt_ PVOID ctx);
+
+/*
+* Read a single 4096-byte page of memory.
+* -- dwPID - PID of target process, (DWORD)-1 to read physical memory.
+* -- qwA
+* -- pbPage
+* -- return = success/fail (depending if all requested bytes are read or not).
+*/
+_Success_(return)
+BOOL VMMDLL_MemReadPage(_In_ DWORD dwPID, _In_ ULONG64 qwA, _Inout_bytecount_(4096) PBYTE pbPage);
+
+/*
+* Retrieve a read-only pointer to a single 4096-byte page of memory without any
+* copying. The page is taken directly from the internal memory cache whenever
+* possible. The page is reference counted and pinned in memory until released
+* by the caller with VMMDLL_MemPageRelease. Pages should be released promptly
+* since pinned pages may not be used for caching.
+* -- dwPID - PID of target process, (DWORD)-1 to read physical memory.
+* -- qwA = address of page (will be page aligned).
+* -- ppbPage = ptr to receive read-only page pointer.
+* -- flags = optional flags as given by VMMDLL_FLAG_*
+* -- return = success/fail.
+*/
+_Success_(return)
+BOOL VMMDLL_MemReadPageRef(_In_ DWORD dwPID, _In_ ULONG64 qwA, _Out_ PBYTE *ppbPage, _In_ DWORD flags);
+
+/*
+* Retrieve read-only pointers to multiple 4096-byte pages of memory without any
+* copying. Pages not in the internal cache are read in one scatter read before
+* references are taken. Pages successfully read must be released by the caller
+* with VMMDLL_MemPageRelease. Failed pages are set to NULL.
+* -- dwPID - PID of target process, (DWORD)-1 to read physical memory.
+* -- pqwA = array of page addresses.
+* -- cPages
+* -- ppbPages = array to receive read-only page pointers (or NULL on fail).
+* -- flags = optional flags as given by VMMDLL_FLAG_*
+* -- return = the number of successfully retrieved pages.
+*/
+DWORD VMMDLL_MemReadScatterPageRef(_In_ DWORD dwPID, _In_reads_(cPages) PULONG64 pqwA, _In_ DWORD cPages, _Out_writes_(cPages) PBYTE *ppbPages, _In_ DWORD flags);
+
+/*
+* Release a page retrieved by VMMDLL_MemReadPageRef/VMMDLL_MemReadScatterPageRef.
+* -- pbPage
+*/
+VOID VMMDLL_MemPageRelease(_In_opt_ PBYTE pbPage);
+
+/*
+* Read a contigious arbitrary amount of memory.
+* -- dwPID - PID of target process, (DWORD)-1 to read physical memory.
+* -- qwA
+* -- pb
+* -- cb
+* -- return = success/fail (depending if all requested bytes are read or not).
+*/
+_Success_(return)
+BOOL VMMDLL_MemRead(_In_ DWORD dwPID, _In_ ULONG64 qwA, _Out_writes_(cb) PBYTE pb, _In_ DWORD cb);
+
+/*
+* Read a contigious amount of memory and report the number of bytes read in pcbRead.
+* -- dwPID - PID of target process, (DWORD)-1 to read physical memory.
+* -- qwA
+* -- pb
+* -- cb
+* -- pcbRead
+* -- flags = flags as in VMMDLL_FLAG_*
+* -- return = success/fail. NB! reads may report as success even if 0 bytes are
+*        read - it's recommended to verify pcbReadOpt parameter.
+*/
+_Success_(return)
+BOOL VMMDLL_MemReadEx(_In_ DWORD dwPID, _In_ ULONG64 qwA, _Out_writes_(cb) PBYTE pb, _In_ DWORD cb, _Out_opt_ PDWORD pcbReadOpt, _In_ ULONG64 flags);
+
+/*
+* Prefetch a number of addresses (specified in the pA array) into the memory
+* cache. This function is to be used to batch larger known reads into local
+* cache before making multiple smaller reads - which will then happen from
+* the cache. Function exists for performance reasons.
+* Towards remote devices the prefetch is a hint: the function returns at once
+* and the pages are read in the background. Subsequent reads wait for hinted
+* pages to arrive (VMMDLL_OPT_CONFIG_REMOTE_PREFETCH_ASYNC).
+* -- dwPID = PID of target process, (DWORD)-1 for physical memory.
+* -- pPrefetchAddresses = array of addresses to read into cache.
+* -- cPrefetchAddresses
+*/
+_Success_(return)
+BOOL VMMDLL_MemPrefetchPages(_In_ DWORD dwPID, _In_reads_(cPrefetchAddresses) PULONG64 pPrefetchAddresses, _In_ DWORD cPrefetchAddresses);
+
+/*
+* Write a contigious arbitrary amount of memory. Please note some virtual memory
+* such as pages of executables (such as DLLs) may be shared between different
+* virtual memory over different processes. As an example a write to kernel32.dll
+* in one process is likely to affect kernel32 in the whole system - in all
+* processes. Heaps and Stacks and other memory are usually safe to write to.
+* Please take care when writing to memory!
+* -- dwPID = PID of target process, (DWORD)-1 to read physical memory.
+* -- qwA
+* -- pb
+* -- cb
+* -- return = TRUE on success, FALSE on partial or zero write.
+*/
+_Success_(return)
+BOOL VMMDLL_MemWrite(_In_ DWORD dwPID, _In_ ULONG64 qwA, _In_reads_(cb) PBYTE pb, _In_ DWORD cb);
+
+#define VMMDLL_MEM_WRITE_FLAG_VERIFY        0x01    // verify by batched read-back (bypassing cache)
+
+typedef struct tdVMMDLL_MEM_WRITE_ENTRY {
+    DWORD dwPID;                    // [in] PID of target process, (DWORD)-1 for physical memory
+    DWORD cb;                       // [in] number of bytes to write
+    ULONG64 qwA;                    // [in] address to write
+    PBYTE pb;                       // [in] data to write
+    DWORD cbWrite;                  // [out] number of bytes written
+    BOOL fVerified;                 // [out] fully written and verified (VMMDLL_MEM_WRITE_FLAG_VERIFY only)
+} VMMDLL_MEM_WRITE_ENTRY, *PVMMDLL_MEM_WRITE_ENTRY;
+
+/*
+* Write a batch of memory writes, possibly spanning multiple processes and/or
+* physical memory, in one call. All addresses are translated up front and
+* physically adjacent writes are merged into single device writes. Only the
+* cached pages actually written are invalidated. Optionally the written data
+* may be verified by a single batched read-back of the affected pages.
+* The same precautions as for VMMDLL_MemWrite applies!
+* NB! the order of overlapping writes within the same batch is undefined.
+* -- cEntries
+* -- pEntries
+* -- flags = 0 or VMMDLL_MEM_WRITE_FLAG_VERIFY.
+* -- return = the number of entries fully written (and verified if requested).
+*/
+DWORD VMMDLL_MemWriteBatch(_In_ DWORD cEntries, _Inout_updates_(cEntries) PVMMDLL_MEM_WRITE_ENTRY pEntries, _In_ DWORD flags);
+
+/*
+* Translate a virtual address to a physical address by walking the page tables
+* of the specified process.
+* -- dwPID
+* -- qwVA
+* -- pqwPA
+* -- return = success/fail.
+*/
+_Success_(return)
+BOOL VMMDLL_MemVirt2Phys(_In_ DWORD dwPID, _In_ ULONG64 qwVA, _Out_ PULONG64 pqwPA);
+
+#define VMMDLL_MEM_SEARCH_VERSION           0xfe3e0001
+#define VMMDLL_MEM_SEARCH_MAXLENGTH         32
+#define VMMDLL_MEM_SEARCH_MAX               16
+
+#define VMMDLL_MEM_SEARCH_SCOPE_PHYSICAL    1
+#define VMMDLL_MEM_SEARCH_SCOPE_PROCESS     2
+#define VMMDLL_MEM_SEARCH_SCOPE_ALLPROCESS  3
+
+typedef struct tdVMMDLL_MEM_SEARCH_ENTRY {
+    DWORD cb;                                       // length of search pattern (1-32 bytes)
+    DWORD cbAlign;                                  // byte alignment of hits (0/1 = none, otherwise power of two)
+    BYTE pb[VMMDLL_MEM_SEARCH_MAXLENGTH];           // search pattern
+    BYTE pbSkipMask[VMMDLL_MEM_SEARCH_MAXLENGTH];   // wildcard mask - bits set are ignored in comparison
+} VMMDLL_MEM_SEARCH_ENTRY, *PVMMDLL_MEM_SEARCH_ENTRY;
+
+/*
+* Callback function invoked for each search hit. Callbacks are serialized but
+* are not made in any particular address order.
+* -- ctx = user supplied context.
+* -- dwPID = PID of hit, (DWORD)-1 for physical memory.
+* -- qwA = address of hit.
+* -- iSearch = index into search[] of the pattern that was found.
+* -- return = TRUE to continue the search, FALSE to abort.
+*/
+typedef BOOL(*VMMDLL_MEM_SEARCH_RESULT_CALLBACK)(_In_opt_ PVOID ctx, _In_ DWORD dwPID, _In_ ULONG64 qwA, _In_ DWORD iSearch);
+
+typedef struct tdVMMDLL_MEM_SEARCH_CONTEXT {
+    DWORD dwVersion;                                // VMMDLL_MEM_SEARCH_VERSION
+    DWORD tpScope;                                  // VMMDLL_MEM_SEARCH_SCOPE_*
+    DWORD dwPID;                                    // PID if scope is VMMDLL_MEM_SEARCH_SCOPE_PROCESS
+    DWORD cSearch;                                  // number of valid entries in search[]
+    ULONG64 qwAddrMin;                              // min address to search
+    ULONG64 qwAddrMax;                              // max address to search (0 = no limit)
+    ULONG64 flags;                                  // VMMDLL_FLAG_* read flags
+    DWORD cMaxResult;                               // max # of hits before search is aborted (0 = no limit)
+    DWORD _Reserved;
+    PVOID ctx;                                      // user context forwarded to pfnResultCB
+    VMMDLL_MEM_SEARCH_RESULT_CALLBACK pfnResultCB;  // optional result callback
+    VMMDLL_MEM_SEARCH_ENTRY search[VMMDLL_MEM_SEARCH_MAX];
+    // fields below may be accessed by the caller (from another thread) during an ongoing search.
+    volatile BOOL fAbortRequested;                  // set by caller to abort search
+    volatile ULONG64 cbReadTotal;                   // progress: bytes read so far
+    volatile DWORD cResult;                         // number of hits so far
+} VMMDLL_MEM_SEARCH_CONTEXT, *PVMMDLL_MEM_SEARCH_CONTEXT;
+
+/*
+* Search memory for up to 16 byte patterns (of up to 32 bytes each) with
+* optional wildcard masks and alignment. Physical memory, the virtual memory of
+* a single process or the virtual memory of all processes may be searched. The
+* search is performed in parallel on multiple threads and uses SIMD (AVX2)
+* instructions if supported by the CPU. This function is blocking until the
+* search is completed or aborted - progress may be monitored and the search may
+* be aborted from another thread by the fields at the end of the context.
+* -- ctx
+* -- return = TRUE on completed (or aborted) search, FALSE on fail.
+*/
+_Success_(return)
+BOOL VMMDLL_MemSearch(_Inout_ PVMMDLL_MEM_SEARCH_CONTEXT ctx);
+
+#define VMMDLL_MEM_SNAPSHOT_MAGIC           0xc0ffee663df9301d
+#define VMMDLL_MEM_SNAPSHOT_VERSION         1
+#define VMMDLL_MEM_SNAPSHOT_DIFF_MAGIC      0xc0ffee663df9301e
+#define VMMDLL_MEM_SNAPSHOT_DIFF_VERSION    1
+
+#define VMMDLL_MEM_SNAPSHOT_DIFF_CHANGED    1
+#define VMMDLL_MEM_SNAPSHOT_DIFF_ADDED      2
+#define VMMDLL_MEM_SNAPSHOT_DIFF_REMOVED    3
+
+typedef struct tdVMMDLL_MEM_SNAPSHOT_RANGE {
+    ULONG64 qwA;                    // page aligned start address of range
+    DWORD cPages;
+    DWORD iHash;                    // index of first page hash in pqwHash
+} VMMDLL_MEM_SNAPSHOT_RANGE, *PVMMDLL_MEM_SNAPSHOT_RANGE;
+
+typedef struct tdVMMDLL_MEM_SNAPSHOT {
+    ULONG64 magic;                  // VMMDLL_MEM_SNAPSHOT_MAGIC
+    DWORD dwVersion;                // VMMDLL_MEM_SNAPSHOT_VERSION
+    DWORD dwPID;                    // PID, (DWORD)-1 for physical memory
+    ULONG64 qwAddrMin;
+    ULONG64 qwAddrMax;
+    ULONG64 flags;
+    DWORD cRange;
+    DWORD cPages;
+    PVMMDLL_MEM_SNAPSHOT_RANGE pRange;  // ranges sorted by address
+    PULONG64 pqwHash;               // page hashes - 0 = page not readable
+} VMMDLL_MEM_SNAPSHOT, *PVMMDLL_MEM_SNAPSHOT;
+
+typedef struct tdVMMDLL_MEM_SNAPSHOT_DIFF_ENTRY {
+    ULONG64 qwA;                    // page address
+    DWORD tp;                       // VMMDLL_MEM_SNAPSHOT_DIFF_*
+    DWORD _Reserved;
+} VMMDLL_MEM_SNAPSHOT_DIFF_ENTRY, *PVMMDLL_MEM_SNAPSHOT_DIFF_ENTRY;
+
+typedef struct tdVMMDLL_MEM_SNAPSHOT_DIFF {
+    ULONG64 magic;                  // VMMDLL_MEM_SNAPSHOT_DIFF_MAGIC
+    DWORD dwVersion;                // VMMDLL_MEM_SNAPSHOT_DIFF_VERSION
+    DWORD cChanged;
+    DWORD cAdded;
+    DWORD cRemoved;
+    DWORD cEntry;
+    DWORD _Reserved;
+    VMMDLL_MEM_SNAPSHOT_DIFF_ENTRY pEntry[];    // entries sorted by address
+} VMMDLL_MEM_SNAPSHOT_DIFF, *PVMMDLL_MEM_SNAPSHOT_DIFF;
+
+/*
+* Take a page-level snapshot of memory - a 64-bit hash is recorded for each
+* readable page. For processes the present pages of the PTE map within the
+* address range are recorded, for physical memory all pages within the range.
+* Pages are read in parallel from the memory acquisition device (bypassing the
+* cache) and hashed - page contents are not stored.
+* NB! CALLER IS RESPONSIBLE FOR VMMDLL_MemFree return value!
+* CALLER FREE: VMMDLL_MemFree(return)
+* -- dwPID = PID of target process, (DWORD)-1 for physical memory.
+* -- qwAddrMin
+* -- qwAddrMax = max address (0 = no limit).
+* -- flags = VMMDLL_FLAG_*
+* -- return - fail: NULL, success: the snapshot - NB! Caller responsible for VMMDLL_MemFree!
+*/
+PVMMDLL_MEM_SNAPSHOT VMMDLL_MemSnapshot(_In_ DWORD dwPID, _In_ ULONG64 qwAddrMin, _In_ ULONG64 qwAddrMax, _In_ ULONG64 flags);
+
+/*
+* Take a new snapshot with the same parameters as an existing snapshot and
+* return the changed, added and removed pages between them. The new snapshot
+* is optionally returned so that it may be used as the base for the next diff.
+* NB! CALLER IS RESPONSIBLE FOR VMMDLL_MemFree return value and *ppSnapshotNew!
+* CALLER FREE: VMMDLL_MemFree(return)
+* CALLER FREE: VMMDLL_MemFree(*ppSnapshotNew)
+* -- pSnapshot = snapshot previously retrieved by VMMDLL_MemSnapshot / VMMDLL_MemSnapshotDiff.
+* -- ppSnapshotNew = optional ptr to receive the new snapshot.
+* -- return - fail: NULL, success: the diff - NB! Caller responsible for VMMDLL_MemFree!
+*/
+PVMMDLL_MEM_SNAPSHOT_DIFF VMMDLL_MemSnapshotDiff(_In_ PVMMDLL_MEM_SNAPSHOT pSnapshot, _Out_opt_ PVMMDLL_MEM_SNAPSHOT *ppSnapshotNew);
+
+typedef struct tdVMMDLL_PHYS2VIRT_ENTRY {
+    ULONG64 pa;
+    ULONG64 va;
+    DWORD dwPID;
+    DWORD _Reserved;
+} VMMDLL_PHYS2VIRT_ENTRY, *PVMMDLL_PHYS2VIRT_ENTRY;
+
+/*
+* Translate physical addresses to all virtual addresses (in all processes)
+* which map them. A global reverse index is built in one page table walk of
+* all active processes on first use and kept until the next total refresh -
+* subsequent lookups are fast. If pEntries is set to NULL the number of
+* entries required will be returned in parameter pcEntries.
+* Entries are returned in order of pPAs and by PID and virtual address.
+* -- cPAs = number of physical addresses in pPAs.
+* -- pPAs = physical addresses to look up.
+* -- pEntries = buffer of minimum length *pcEntries or NULL.
+* -- pcEntries = pointer to number of entries in pEntries.
+* -- return = success/fail.
+*/
+_Success_(return)
+BOOL VMMDLL_MemPhys2VirtIndex(_In_ DWORD cPAs, _In_reads_(cPAs) PULONG64 pPAs, _Out_writes_opt_(*pcEntries) PVMMDLL_PHYS2VIRT_ENTRY pEntries, _Inout_ PDWORD pcEntries);
+
+
+
+//-----------------------------------------------------------------------------
+// VMM PROCESS MAP FUNCTIONALITY BELOW:
+// Functionality for retrieving process related collections of items such as
+// page table map (PTE), virtual address descriptor map (VAD), loaded modules,
+// heaps and threads.
+//-----------------------------------------------------------------------------
+
+#define VMMDLL_MAP_PTE_VERSION              1
+#define VMMDLL_MAP_VAD_VERSION              1
+#define VMMDLL_MAP_MODULE_VERSION           1
+#define VMMDLL_MAP_HEAP_VERSION             2
+#define VMMDLL_MAP_THREAD_VERSION           1
+#define VMMDLL_MAP_HANDLE_VERSION           1
+
+// flags to check for existence in the fPage field of VMMDLL_MAP_PTEENTRY
+#define VMMDLL_MEMMAP_FLAG_PAGE_W          0x0000000000000002
+#define VMMDLL_MEMMAP_FLAG_PAGE_NS         0x0000000000000004
+#define VMMDLL_MEMMAP_FLAG_PAGE_NX         0x8000000000000000
+#define VMMDLL_MEMMAP_FLAG_PAGE_MASK       0x8000000000000006
+
+typedef struct tdVMMDLL_MAP_PTEENTRY {
+    QWORD vaBase;
+    QWORD cPages;
+    QWORD fPage;
+    BOOL  fWoW64;
+    DWORD cwszText;
+    LPWSTR wszText;
+    DWORD _Reserved1[2];
+} VMMDLL_MAP_PTEENTRY, *PVMMDLL_MAP_PTEENTRY;
+
+typedef struct tdVMMDLL_MAP_VADENTRY {
+    QWORD vaStart;
+    QWORD vaEnd;
+    QWORD vaVad;
+    // DWORD 0
+    DWORD VadType           : 3;   // Pos 0
+    DWORD Protection        : 5;   // Pos 3
+    DWORD fImage            : 1;   // Pos 8
+    DWORD fFile             : 1;   // Pos 9
+    DWORD fPageFile         : 1;   // Pos 10
+    DWORD fPrivateMemory    : 1;   // Pos 11
+    DWORD fTeb              : 1;   // Pos 12
+    DWORD fStack            : 1;   // Pos 13
+    DWORD fSpare            : 2;   // Pos 14
+    DWORD HeapNum           : 7;   // Pos 16
+    DWORD fHeap             : 1;   // Pos 23
+    DWORD cwszDescription   : 8;   // Pos 24
+    // DWORD 1
+    DWORD CommitCharge      : 31;   // Pos 0
+    DWORD MemCommit         : 1;    // Pos 31
+    DWORD u2;
+    DWORD cbPrototypePte;
+    QWORD vaPrototypePte;
+    QWORD vaSubsection;
+    LPWSTR wszText;                 // optional LPWSTR pointed into VMMDLL_MAP_VAD.wszMultiText
+    DWORD cwszText;                 // WCHAR count not including terminating null
+    DWORD _Reserved1;
+} VMMDLL_MAP_VADENTRY, *PVMMDLL_MAP_VADENTRY;
+
+typedef struct tdVMMDLL_MAP_MODULEENTRY {
+    QWORD vaBase;
+    QWORD vaEntry;
+    DWORD cbImageSize;
+    BOOL  fWoW64;
+    LPWSTR wszText;
+    DWORD cwszText;                 // wchar count not including terminating null
+    DWORD _Reserved1[7];
+} VMMDLL_MAP_MODULEENTRY, *PVMMDLL_MAP_MODULEENTRY;
+
+typedef struct tdVMMDLL_MAP_HEAPENTRY {
+    QWORD vaHeapSegment;
+    DWORD cPages;
+    DWORD cPagesUnCommitted : 24;
+    DWORD HeapId : 7;
+    DWORD fPrimary : 1;
+    QWORD vaHeap;                   // heap (_HEAP) the segment belongs to
+    QWORD vaFirstEntry;             // segment range: first heap entry
+    QWORD vaLastValidEntry;         // segment range: end of last valid entry
+} VMMDLL_MAP_HEAPENTRY, *PVMMDLL_MAP_HEAPENTRY;
+
+typedef struct tdVMMDLL_MAP_THREADENTRY {
+    DWORD dwTID;
+    DWORD dwPID;
+    DWORD dwExitStatus;
+    UCHAR bState;
+    UCHAR bRunning;
+    UCHAR bPriority;
+    UCHAR bBasePriority;
+    QWORD vaETHREAD;
+    QWORD vaTeb;
+    QWORD ftCreateTime;
+    QWORD ftExitTime;
+    QWORD vaStartAddress;
+    QWORD vaStackBaseUser;
+    QWORD vaStackLimitUser;
+    QWORD vaStackBaseKernel;
+    QWORD vaStackLimitKernel;
+    DWORD dwGeneration;             // thread map generation in which entry was added or last changed
+    DWORD _FutureUse[9];
+} VMMDLL_MAP_THREADENTRY, *PVMMDLL_MAP_THREADENTRY;
+
+typedef struct tdVMMDLL_MAP_HANDLEENTRY {
+    QWORD vaObject;
+    DWORD dwHandle;
+    DWORD dwGrantedAccess : 24;
+    DWORD iType : 8;
+    QWORD qwHandleCount;
+    QWORD qwPointerCount;
+    QWORD vaObjectCreateInfo;
+    QWORD vaSecurityDescriptor;
+    LPWSTR wszText;
+    DWORD cwszText;
+    DWORD dwPID;
+    DWORD dwPoolTag;
+    DWORD _FutureUse[4];
+    DWORD cwszType;
+    LPWSTR wszType;
+} VMMDLL_MAP_HANDLEENTRY, *PVMMDLL_MAP_HANDLEENTRY;
+
+typedef struct tdVMMDLL_MAP_PTE {
+    DWORD dwVersion;
+    DWORD _Reserved1[5];
+    LPWSTR wszMultiText;            // NULL or multi-wstr pointed into by VMMDLL_MAP_VADENTRY.wszText
+    DWORD cbMultiText;
+    DWORD cMap;                     // # map entries.
+    VMMDLL_MAP_PTEENTRY pMap[];     // map entries.
+} VMMDLL_MAP_PTE, *PVMMDLL_MAP_PTE;
+
+typedef struct tdVMMDLL_MAP_VAD {
+    DWORD dwVersion;
+    DWORD _Reserved1[5];
+    LPWSTR wszMultiText;            // NULL or multi-wstr pointed into by VMMDLL_MAP_VADENTRY.wszText
+    DWORD cbMultiText;
+    DWORD cMap;                     // # map entries.
+    VMMDLL_MAP_VADENTRY pMap[];     // map entries.
+} VMMDLL_MAP_VAD, *PVMMDLL_MAP_VAD;
+
+typedef struct tdVMMDLL_MAP_MODULE {
+    DWORD dwVersion;
+    DWORD _Reserved1[5];
+    LPWSTR wszMultiText;            // multi-wstr pointed into by VMMDLL_MAP_MODULEENTRY.wszText
+    DWORD cbMultiText;
+    DWORD cMap;                     // # map entries.
+    VMMDLL_MAP_MODULEENTRY pMap[];  // map entries.
+} VMMDLL_MAP_MODULE, *PVMMDLL_MAP_MODULE; 
+
+typedef struct tdVMMDLL_MAP_HEAP {
+    DWORD dwVersion;
+    DWORD _Reserved1[8];
+    DWORD cMap;                     // # map entries.
+    VMMDLL_MAP_HEAPENTRY pMap[];    // map entries.
+} VMMDLL_MAP_HEAP, *PVMMDLL_MAP_HEAP;
+
+typedef struct tdVMMDLL_MAP_THREAD {
+    DWORD dwVersion;
+    DWORD _Reserved[8];
+    DWORD cMap;                     // # map entries.
+    VMMDLL_MAP_THREADENTRY pMap[];  // map entries.
+} VMMDLL_MAP_THREAD, *PVMMDLL_MAP_THREAD;
+
+typedef struct tdVMMDLL_MAP_HANDLE {
+    DWORD dwVersion;
+    DWORD _Reserved1[5];
+    LPWSTR wszMultiText;            // multi-wstr pointed into by VMMDLL_MAP_HANDLEENTRY.wszText
+    DWORD cbMultiText;
+    DWORD cMap;                     // # map entries.
+    VMMDLL_MAP_HANDLEENTRY pMap[];  // map entries.
+} VMMDLL_MAP_HANDLE, *PVMMDLL_MAP_HANDLE;
+
+/*
+* Retrieve the memory map entries based on hardware page tables (PTE) for the
+* process. If pPteMap is set to NULL the number of bytes required will be
+* returned in parameter pcbPteMap.
+* Entries returned are sorted on VMMDLL_MAP_PTEENTRY.vaBase
+* -- dwPID
+* -- pPteMap = buffer of minimum byte length *pcbPteMap or NULL.
+* -- pcbPteMap = pointer to byte count of pPteMap buffer.
+* -- fIdentifyModules = try identify modules as well (= slower)
+* -- return = success/fail.
+*/
+_Success_(return)
+BOOL VMMDLL_ProcessMap_GetPte(_In_ DWORD dwPID, _Out_writes_bytes_opt_(*pcbPteMap) PVMMDLL_MAP_PTE pPteMap, _Inout_ PDWORD pcbPteMap, _In_ BOOL fIdentifyModules);
+
+/*
+* Retrieve memory map entries based on virtual address descriptor (VAD) for
+* the process. If pVadMap is set to NULL the number of bytes required
+* will be returned in parameter pcbVadMap.
+* Entries returned are sorted on VMMDLL_MAP_VADENTRY.vaStart
+* -- dwPID
+* -- pVadMap = buffer of minimum byte length *pcbVadMap or NULL.
+* -- pcbVadMap = pointer to byte count of pVadMap buffer.
+* -- fIdentifyModules = try identify modules as well (= slower)
+* -- return = success/fail.
+*/
+_Success_(return)
+BOOL VMMDLL_ProcessMap_GetVad(_In_ DWORD dwPID, _Out_writes_bytes_opt_(*pcbVadMap) PVMMDLL_MAP_VAD pVadMap, _Inout_ PDWORD pcbVadMap, _In_ BOOL fIdentifyModules);
+
+/*
+* Retrieve the single memory map entry based on hardware page tables (PTE)
+* which contains the virtual address va. The entry is looked up in the cached
+* map without copying the full map. No text is returned - wszText is NULL.
+* -- dwPID
+* -- va = virtual address inside the entry to retrieve.
+* -- pPteEntry = buffer to receive the entry.
+* -- return = success/fail.
+*/
+_Success_(return)
+BOOL VMMDLL_ProcessMap_GetPteEntry(_In_ DWORD dwPID, _In_ ULONG64 va, _Out_ PVMMDLL_MAP_PTEENTRY pPteEntry);
+
+/*
+* Retrieve the single memory map entry based on virtual address descriptors
+* (VAD) which contains the virtual address va. The entry is looked up in the
+* cached map without copying the full map. No text is returned - wszText is
+* NULL.
+* -- dwPID
+* -- va = virtual address inside the entry to retrieve.
+* -- pVadEntry = buffer to receive the entry.
+* -- return = success/fail.
+*/
+_Success_(return)
+BOOL VMMDLL_ProcessMap_GetVadEntry(_In_ DWORD dwPID, _In_ ULONG64 va, _Out_ PVMMDLL_MAP_VADENTRY pVadEntry);
+
+/*
+* Retrieve the modules (.dlls) for the specified process. If pModuleMap is set
+* to NULL the number of bytes required will be returned in parameter pcbModuleMap.
+* -- dwPID
+* -- pModuleMap = buffer of minimum byte length *pcbModuleMap or NULL.
+* -- pcbModuleMap = pointer to byte count of pModuleMap buffer.
+* -- return = success/fail.
+*/
+_Success_(return)
+BOOL VMMDLL_ProcessMap_GetModule(_In_ DWORD dwPID, _Out_writes_bytes_opt_(*pcbModuleMap) PVMMDLL_MAP_MODULE pModuleMap, _Inout_ PDWORD pcbModuleMap);
+
+/*
+* Retrieve a module map entry (.exe / .dll) given a process and module name.
+* NB! PVMMDLL_MAP_MODULEENTRY->wszText will not be set by this function.
+* If module name is required use VMMDLL_ProcessMap_GetModule().
+* -- dwPID
+* -- szModuleName
+* -- pModuleMapEntry
+* -- return = success/fail.
+*/
+_Success_(return)
+BOOL VMMDLL_ProcessMap_GetModuleFromName(_In_ DWORD dwPID, _In_ LPWSTR wszModuleName, _Out_ PVMMDLL_MAP_MODULEENTRY pModuleMapEntry);
+
+/*
+* Retrieve the heaps for the specified process. If pHeapMap is set to NULL
+* the number of bytes required will be returned in parameter pcbHeapMap.
+* -- dwPID
+* -- pHeapMap = buffer of minimum byte length *pcbHeapMap or NULL.
+* -- pcbHeapMap = pointer to byte count of pHeapMap buffer.
+* -- return = success/fail.
+*/
+_Success_(return)
+BOOL VMMDLL_ProcessMap_GetHeap(_In_ DWORD dwPID, _Out_writes_bytes_opt_(*pcbHeapMap) PVMMDLL_MAP_HEAP pHeapMap, _Inout_ PDWORD pcbHeapMap);
+
+typedef struct tdVMMDLL_HEAP_ENTRY {
+    ULONG64 va;                     // heap entry (header) address
+    DWORD cb;                       // block size including header
+    DWORD dwFlags;                  // decoded heap entry flags
+    DWORD HeapId;
+    DWORD iSegment;                 // index of segment in the heap map
+    BOOL fBusy;                     // allocated block
+    DWORD _Reserved;
+} VMMDLL_HEAP_ENTRY, *PVMMDLL_HEAP_ENTRY;
+
+/*
+* Callback function for VMMDLL_ProcessMap_EnumHeapEntries.
+* -- ctx = optional context as given to VMMDLL_ProcessMap_EnumHeapEntries.
+* -- pEntry
+* -- return = TRUE to continue enumeration, FALSE to stop.
+*/
+typedef BOOL(*VMMDLL_HEAP_ENTRY_CALLBACK)(_In_opt_ PVOID ctx, _In_ PVMMDLL_HEAP_ENTRY pEntry);
+
+/*
+* Enumerate the heap entries of all segments in the heap map of the specified
+* process. Segments are walked lazily in batched page windows and encoded heap
+* entry headers are decoded. Only NT (back-end) heap entries are enumerated;
+* low fragmentation heap sub-segments show up as single busy entries.
+* -- dwPID
+* -- pfnCallback
+* -- ctx = optional context forwarded to pfnCallback.
+* -- return = success/fail.
+*/
+_Success_(return)
+BOOL VMMDLL_ProcessMap_EnumHeapEntries(_In_ DWORD dwPID, _In_ VMMDLL_HEAP_ENTRY_CALLBACK pfnCallback, _In_opt_ PVOID ctx);
+
+/*
+* Retrieve the threads for the specified process. If pThreadMap is set to NULL
+* the number of bytes required will be returned in parameter pcbThreadMap.
+* Entries returned are sorted on VMMDLL_MAP_THREADENTRY.dwTID
+* -- dwPID
+* -- pThreadMap = buffer of minimum byte length *pcbThreadMap or NULL.
+* -- pcbThreadMap = pointer to byte count of pThreadMap buffer.
+* -- return = success/fail.
+*/
+_Success_(return)
+BOOL VMMDLL_ProcessMap_GetThread(_In_ DWORD dwPID, _Out_writes_bytes_opt_(*pcbThreadMap) PVMMDLL_MAP_THREAD pThreadMap, _Inout_ PDWORD pcbThreadMap);
+
+/*
+* Retrieve the threads of all processes which have been added or changed since
+* the thread map generation dwGeneration. Thread maps of processes which don't
+* have a thread map yet are built in one batched pass. Thread maps are rebuilt
+* on total refresh; threads unchanged since the previous build keep their older
+* generation (VMMDLL_MAP_THREADENTRY.dwGeneration). Removed threads are not
+* reported. Use 0 as dwGeneration to retrieve all threads. If pThreadMap is
+* set to NULL the number of bytes required will be returned in pcbThreadMap.
+* -- dwGeneration = generation returned by a previous call in pdwGeneration or 0.
+* -- pThreadMap = buffer of minimum byte length *pcbThreadMap or NULL.
+* -- pcbThreadMap = pointer to byte count of pThreadMap buffer.
+* -- pdwGeneration = optional current generation to use in the next call.
+* -- return = success/fail.
+*/
+_Success_(return)
+BOOL VMMDLL_ProcessMap_GetThreadChanged(_In_ DWORD dwGeneration, _Out_writes_bytes_opt_(*pcbThreadMap) PVMMDLL_MAP_THREAD pThreadMap, _Inout_ PDWORD pcbThreadMap, _Out_opt_ PDWORD pdwGeneration);
+
+/*
+* Retrieve the handles for the specified process. If pHandleMap is set to NULL
+* the number of bytes required will be returned in parameter pcbHandleMap.
+* Entries returned are sorted on VMMDLL_MAP_HANDLEENTRY.dwHandle
+* -- dwPID
+* -- pHandleMap = buffer of minimum byte length *pcbHandleMap or NULL.
+* -- pcbHandleMap = pointer to byte count of pHandleMap buffer.
+* -- return = success/fail.
+*/
+_Success_(return)
+BOOL VMMDLL_ProcessMap_GetHandle(_In_ DWORD dwPID, _Out_writes_bytes_opt_(*pcbHandleMap) PVMMDLL_MAP_HANDLE pHandleMap, _Inout_ PDWORD pcbHandleMap);
+
+#define VMMDLL_GENERATION_TP_PROCESSTABLE       0
+#define VMMDLL_GENERATION_TP_PTE                1
+#define VMMDLL_GENERATION_TP_VAD                2
+#define VMMDLL_GENERATION_TP_MODULE             3
+#define VMMDLL_GENERATION_TP_HEAP               4
+#define VMMDLL_GENERATION_TP_THREAD             5
+#define VMMDLL_GENERATION_TP_HANDLE             6
+
+/*
+* Retrieve the generation of the process table or of a map of the specified
+* process. Generations are unique and increase monotonically - a changed
+* generation means the object has been rebuilt since last retrieved. Module
+* and handle maps retain their generation if rebuilt with unchanged contents.
+* Retrieving the generation of a map will build the map if not already built.
+* -- dwPID = process (ignored for VMMDLL_GENERATION_TP_PROCESSTABLE).
+* -- tp = VMMDLL_GENERATION_TP_*
+* -- pqwGeneration
+* -- return = success/fail.
+*/
+_Success_(return)
+BOOL VMMDLL_ProcessGetGeneration(_In_ DWORD dwPID, _In_ DWORD tp, _Out_ PULONG64 pqwGeneration);
+
+
+
+//-----------------------------------------------------------------------------
+// VMM PROCESS FUNCTIONALITY BELOW:
+// Functionality below is mostly relating to Windows processes.
+//-----------------------------------------------------------------------------
+
+/*
+* Retrieve an active process given it's name. Please note that if multiple
+* processes with the same name exists only one will be returned. If required to
+* parse all processes with the same name please iterate over the PID list by
+* calling VMMDLL_PidList together with VMMDLL_ProcessGetInformation.
+* -- szProcName = process name case insensitive.
+* -- pdwPID = pointer that will receive PID on success.
+* -- return
+*/
+_Success_(return)
+BOOL VMMDLL_PidGetFromName(_In_ LPSTR szProcName, _Out_ PDWORD pdwPID);
+
+/*
+* List the PIDs in the system.
+* -- pPIDs = DWORD array of at least number of PIDs in system, or NULL.
+* -- pcPIDs = size of (in number of DWORDs) pPIDs array on entry, number of PIDs in system on exit.
+* -- return = success/fail.
+*/
+_Success_(return)
+BOOL VMMDLL_PidList(_Out_writes_opt_(*pcPIDs) PDWORD pPIDs, _Inout_ PULONG64 pcPIDs); 
+
+#define VMMDLL_PROCESS_INFORMATION_MAGIC        0xc0ffee663df9301e
+#define VMMDLL_PROCESS_INFORMATION_VERSION      5
+
+typedef struct tdVMMDLL_PROCESS_INFORMATION {
+    ULONG64 magic;
+    WORD wVersion;
+    WORD wSize;
+    VMMDLL_MEMORYMODEL_TP tpMemoryModel;    // as given by VMMDLL_MEMORYMODEL_* enum
+    VMMDLL_SYSTEM_TP tpSystem;              // as given by VMMDLL_SYSTEM_* enum
+    BOOL fUserOnly;                         // only user mode pages listed
+    DWORD dwPID;
+    DWORD dwPPID;
+    DWORD dwState;
+    CHAR szName[16];
+    CHAR szNameLong[64];
+    ULONG64 paDTB;
+    ULONG64 paDTB_UserOpt;                  // may not exist
+    union {
+        struct {
+            ULONG64 vaEPROCESS;
+            ULONG64 vaPEB;
+            ULONG64 _Reserved1;
+            BOOL fWow64;
+            DWORD vaPEB32;                  // WoW64 only
+        } win;
+    } os;
+} VMMDLL_PROCESS_INFORMATION, *PVMMDLL_PROCESS_INFORMATION;
+
+/*
+* Retrieve various process information from a PID. Process information such as
+* name, page directory bases and the process state may be retrieved.
+* -- dwPID
+* -- pProcessInformation = if null, size is given in *pcbProcessInfo
+* -- pcbProcessInformation = size of pProcessInfo (in bytes) on entry and exit
+* -- return = success/fail.
+*/
+_Success_(return)
+BOOL VMMDLL_ProcessGetInformation(_In_ DWORD dwPID, _Inout_opt_ PVMMDLL_PROCESS_INFORMATION pProcessInformation, _In_ PSIZE_T pcbProcessInformation);
+
+#define VMMDLL_PROCESS_INFORMATION_OPT_STRING_PATH_KERNEL           1
+#define VMMDLL_PROCESS_INFORMATION_OPT_STRING_PATH_USER_IMAGE       2
+#define VMMDLL_PROCESS_INFORMATION_OPT_STRING_CMDLINE               3
+
+/*
+* Retrieve a string value belonging to a process. The function allocates a new
+* string buffer and returns the requested string in it. The string is always
+* NULL terminated. On failure NULL is returned.
+* NB! CALLER IS RESPONSIBLE FOR VMMDLL_MemFree return value!
+* CALLER FREE: VMMDLL_MemFree(return)
+* -- dwPID
+* -- fOptionString = string value to retrieve as given by VMMDLL_PROCESS_INFORMATION_OPT_STRING_*
+* -- return - fail: NULL, success: the string - NB! must be VMMDLL_MemFree'd by caller!
+*/
+LPSTR VMMDLL_ProcessGetInformationString(_In_ DWORD dwPID, _In_ DWORD fOptionString);
+
+#define VMMDLL_PROCESS_INFORMATION_ALL_VERSION  1
+
+typedef struct tdVMMDLL_PROCESS_INFORMATION_ALL_ENTRY {
+    VMMDLL_PROCESS_INFORMATION info;
+    ULONG64 ftCreateTime;                   // FILETIME, 0 if not available
+    ULONG64 ftExitTime;                     // FILETIME, 0 if not available
+    LPSTR szPathKernel;                     // ptr into szMultiText, never NULL
+    LPSTR szPathUserImage;                  // ptr into szMultiText, never NULL
+    LPSTR szCommandLine;                    // ptr into szMultiText, never NULL
+} VMMDLL_PROCESS_INFORMATION_ALL_ENTRY, *PVMMDLL_PROCESS_INFORMATION_ALL_ENTRY;
+
+typedef struct tdVMMDLL_PROCESS_INFORMATION_ALL {
+    DWORD dwVersion;                        // VMMDLL_PROCESS_INFORMATION_ALL_VERSION
+    DWORD cbMultiText;
+    LPSTR szMultiText;                      // NULL-terminated strings shared by all entries
+    DWORD _Reserved;
+    DWORD cProcess;
+    VMMDLL_PROCESS_INFORMATION_ALL_ENTRY pProcess[];
+} VMMDLL_PROCESS_INFORMATION_ALL, *PVMMDLL_PROCESS_INFORMATION_ALL;
+
+/*
+* Retrieve process information, including creation/exit times, kernel path,
+* user mode image path and command line, for all processes in one call. The
+* user mode process parameters of all processes are read in a single parallel
+* pass before the result is packed into one allocation. All strings are stored
+* in a shared string blob and are always NULL terminated (possibly empty).
+* NB! CALLER IS RESPONSIBLE FOR VMMDLL_MemFree return value!
+* CALLER FREE: VMMDLL_MemFree(return)
+* -- return - fail: NULL, success: the process information - NB! must be VMMDLL_MemFree'd by caller!
+*/
+PVMMDLL_PROCESS_INFORMATION_ALL VMMDLL_ProcessGetInformationAll();
+
+typedef struct tdVMMDLL_EAT_ENTRY {
+    ULONG64 vaFunction;
+    DWORD vaFunctionOffset;
+    CHAR szFunction[40];
+} VMMDLL_EAT_ENTRY, *PVMMDLL_EAT_ENTRY;
+
+typedef struct tdVMMDLL_IAT_ENTRY {
+    ULONG64 vaFunction;
+    CHAR szFunction[40];
+    CHAR szModule[64];
+} VMMDLL_IAT_ENTRY, *PVMMDLL_IAT_ENTRY;
+
+/*
+* Retrieve information about: Data Directories, Sections, Export Address Table
+* and Import Address Table (IAT).
+* If the pData == NULL upon entry the number of entries of the pData array must
+* have in order to be able to hold the data is returned.
+* -- dwPID
+* -- wszModule
+* -- pData
+* -- cData
+* -- pcData
+* -- return = success/fail.
+*/
+_Success_(return) 
+BOOL VMMDLL_ProcessGetDirectories(_In_ DWORD dwPID, _In_ LPWSTR wszModule, _Out_writes_(16) PIMAGE_DATA_DIRECTORY pData, _In_ DWORD cData, _Out_ PDWORD pcData);
+_Success_(return)
+BOOL VMMDLL_ProcessGetSections(_In_ DWORD dwPID, _In_ LPWSTR wszModule, _Out_opt_ PIMAGE_SECTION_HEADER pData, _In_ DWORD cData, _Out_ PDWORD pcData);
+_Success_(return)
+BOOL VMMDLL_ProcessGetEAT(_In_ DWORD dwPID, _In_ LPWSTR wszModule, _Out_opt_ PVMMDLL_EAT_ENTRY pData, _In_ DWORD cData, _Out_ PDWORD pcData);
+_Success_(return)
+BOOL VMMDLL_ProcessGetIAT(_In_ DWORD dwPID, _In_ LPWSTR wszModule, _Out_opt_ PVMMDLL_IAT_ENTRY pData, _In_ DWORD cData, _Out_ PDWORD pcData);
+
+/*
+* Callback function for VMMDLL_ProcessDumpModules. The callback may be called
+* in parallel from multiple threads (for different modules). The chunks of a
+* single module are delivered in file offset order.
+* -- ctx = optional context as given to VMMDLL_ProcessDumpModules.
+* -- vaModuleBase
+* -- wszModuleName
+* -- cbFile = total size of the re-constructed module file.
+* -- cbOffset = file offset of the chunk.
+* -- pb
+* -- cb
+* -- return = TRUE to continue, FALSE to stop the dump.
+*/
+typedef BOOL(*VMMDLL_PE_DUMP_CALLBACK)(_In_opt_ PVOID ctx, _In_ ULONG64 vaModuleBase, _In_ LPWSTR wszModuleName, _In_ DWORD cbFile, _In_ DWORD cbOffset, _In_reads_(cb) PBYTE pb, _In_ DWORD cb);
+
+/*
+* Dump all modules of a process as best-effort re-constructed PE files (same
+* as the files in the 'pedump' directory). Modules are re-constructed in
+* parallel and streamed in chunks of up to 1MB to the callback function.
+* -- dwPID
+* -- pfnCallback
+* -- ctx = optional context forwarded to pfnCallback.
+* -- return = TRUE on completion, FALSE on fail or if stopped by the callback.
+*/
+_Success_(return)
+BOOL VMMDLL_ProcessDumpModules(_In_ DWORD dwPID, _In_ VMMDLL_PE_DUMP_CALLBACK pfnCallback, _In_opt_ PVOID ctx);
+
+/*
+* Retrieve the virtual address of a given function inside a process/module.
+* -- dwPID
+* -- wszModuleName
+* -- szFunctionName
+* -- return = virtual address of function, zero on fail.
+*/
+ULONG64 VMMDLL_ProcessGetProcAddress(_In_ DWORD dwPID, _In_ LPWSTR wszModuleName, _In_ LPSTR szFunctionName);
+
+/*
+* Retrieve the base address of a given module.
+* -- dwPID
+* -- wszModuleName
+* -- return = virtual address of module base, zero on fail.
+*/
+ULONG64 VMMDLL_ProcessGetModuleBase(_In_ DWORD dwPID, _In_ LPWSTR wszModuleName);
+
+
+
+//-----------------------------------------------------------------------------
+// WINDOWS SPECIFIC DEBUGGING / SYMBOL FUNCTIONALITY BELOW:
+//-----------------------------------------------------------------------------
+
+/*
+* Retrieve a symbol virtual address given a module name and a symbol name.
+* NB! not all modules may exist - initially only module "nt" is available.
+* NB! if multiple modules have the same name the 1st to be added will be used.
+* NB! the call waits for the PDB of the module to be loaded if required - this
+*     may take some time if the PDB has to be downloaded from the symbol server.
+* -- szModule
+* -- szSymbolName
+* -- pvaSymbolAddress
+* -- return
+*/
+_Success_(return)
+BOOL VMMDLL_PdbSymbolAddress(_In_ LPSTR szModule, _In_ LPSTR szSymbolName, _Out_ PULONG64 pvaSymbolAddress);
+
+/*
+* Retrieve a type size given a module name and a type name.
+* NB! not all modules may exist - initially only module "nt" is available.
+* NB! if multiple modules have the same name the 1st to be added will be used.
+* NB! the call waits for the PDB of the module to be loaded if required - this
+*     may take some time if the PDB has to be downloaded from the symbol server.
+* -- szModule
+* -- szTypeName
+* -- pcbTypeSize
+* -- return
+*/
+_Success_(return)
+BOOL VMMDLL_PdbTypeSize(_In_ LPSTR szModule, _In_ LPSTR szTypeName, _Out_ PDWORD pcbTypeSize);
+
+/*
+* Locate the offset of a type child - typically a sub-item inside a struct.
+* NB! not all modules may exist - initially only module "nt" is available.
+* NB! if multiple modules have the same name the 1st to be added will be used.
+* NB! the call waits for the PDB of the module to be loaded if required - this
+*     may take some time if the PDB has to be downloaded from the symbol server.
+* -- szModule
+* -- szTypeName
+* -- wszTypeChildName
+* -- pcbTypeChildOffset
+* -- return
+*/
+_Success_(return)
+BOOL VMMDLL_PdbTypeChildOffset(_In_ LPSTR szModule, _In_ LPSTR szTypeName, _In_ LPWSTR wszTypeChildName, _Out_ PDWORD pcbTypeChildOffset);
+
+
+
+//-----------------------------------------------------------------------------
+// WINDOWS SPECIFIC REGISTRY FUNCTIONALITY BELOW:
+//-----------------------------------------------------------------------------
+
+#define VMMDLL_REGISTRY_HIVE_INFORMATION_MAGIC      0xc0ffee653df8d01e
+#define VMMDLL_REGISTRY_HIVE_INFORMATION_VERSION    1
+
+typedef struct td_VMMDLL_REGISTRY_HIVE_INFORMATION {
+    ULONG64 magic;
+    WORD wVersion;
+    WORD wSize;
+    BYTE _FutureReserved1[0x14];
+    ULONG64 vaCMHIVE;
+    ULONG64 vaHBASE_BLOCK;
+    DWORD cbLength;
+    CHAR szName[136 + 1];
+    WCHAR wszNameShort[32 + 1];
+    WCHAR wszHiveRootPath[MAX_PATH];
+    ULONG64 _FutureReserved2[0x10];
+} VMMDLL_REGISTRY_HIVE_INFORMATION, *PVMMDLL_REGISTRY_HIVE_INFORMATION;
+
+/*
+* Retrieve information about the registry hives in the target system.
+* -- pHives = buffer of cHives * sizeof(VMMDLL_REGISTRY_HIVE_INFORMATION) to receive information about all hives. NULL to receive # hives in pcHives.
+* -- cHives
+* -- pcHives = if pHives == NULL: # total hives. if pHives: # read hives.
+* -- return
+*/
+_Success_(return)
+BOOL VMMDLL_WinReg_HiveList(_Out_writes_(cHives) PVMMDLL_REGISTRY_HIVE_INFORMATION pHives, _In_ DWORD cHives, _Out_ PDWORD pcHives);
+
+/*
+* Read a contigious arbitrary amount of registry hive memory and report the
+* number of bytes read in pcbRead.
+* NB! Address space does not include regf registry hive file header!
+* -- vaCMHive
+* -- ra
+* -- pb
+* -- cb
+* -- pcbReadOpt
+* -- flags = flags as in VMMDLL_FLAG_*
+* -- return = success/fail. NB! reads may report as success even if 0 bytes are
+*        read - it's recommended to verify pcbReadOpt parameter.
+*/
+_Success_(return)
+BOOL VMMDLL_WinReg_HiveReadEx(_In_ ULONG64 vaCMHive, _In_ DWORD ra, _Out_ PBYTE pb, _In_ DWORD cb, _Out_opt_ PDWORD pcbReadOpt, _In_ ULONG64 flags);
+
+/*
+* Write a virtually contigious arbitrary amount of memory to a registry hive.
+* NB! Address space does not include regf registry hive file header!
+* -- vaCMHive
+* -- ra
+* -- pb
+* -- cb
+* -- return = TRUE on success, FALSE on partial or zero write.
+*/
+_Success_(return)
+BOOL VMMDLL_WinReg_HiveWrite(_In_ ULONG64 vaCMHive, _In_ DWORD ra, _In_ PBYTE pb, _In_ DWORD cb);
+
+/*
+* Enumerate registry sub keys - similar to WINAPI function 'RegEnumKeyExW.'
+* Please consult WINAPI function documentation for information.
+* May be called with HKLM base or virtual address of CMHIVE base examples:
+*   1) 'HKLM\SOFTWARE\Key\SubKey'
+*   2) 'HKLM\ORPHAN\SAM\Key\SubKey'              (orphan key)
+*   3) '0x<vaCMHIVE>\ROOT\Key\SubKey'
+*   4) '0x<vaCMHIVE>\ORPHAN\Key\SubKey'          (orphan key)
+* -- wszFullPathKey
+* -- dwIndex
+* -- lpName
+* -- lpcchName
+* -- lpftLastWriteTime
+* -- return
+*/
+_Success_(return)
+BOOL VMMDLL_WinReg_EnumKeyExW(
+    _In_ LPWSTR wszFullPathKey,
+    _In_ DWORD dwIndex,
+    _Out_writes_opt_(*lpcchName) LPWSTR lpName,
+    _Inout_ LPDWORD lpcchName,
+    _Out_opt_ PFILETIME lpftLastWriteTime
+);
+
+/*
+* Enumerate registry values given a registry key - similar to WINAPI function
+* 'EnumValueW'. Please consult WINAPI function documentation for information.
+* May be called in two ways:
+* May be called with HKLM base or virtual address of CMHIVE base examples:
+*   1) 'HKLM\SOFTWARE\Key\SubKey'
+*   2) 'HKLM\ORPHAN\SAM\Key\SubKey'              (orphan key)
+*   3) '0x<vaCMHIVE>\ROOT\Key\SubKey'
+*   4) '0x<vaCMHIVE>\ORPHAN\Key\SubKey'          (orphan key)
+* -- wszFullPathKey
+* -- dwIndex
+* -- lpValueName
+* -- lpcchValueName
+* -- lpType
+* -- lpData
+* -- lpcbData
+* -- return
+*/
+_Success_(return)
+BOOL VMMDLL_WinReg_EnumValueW(
+    _In_ LPWSTR wszFullPathKey,
+    _In_ DWORD dwIndex,
+    _Out_writes_opt_(*lpcchValueName) LPWSTR lpValueName,
+    _Inout_ LPDWORD lpcchValueName,
+    _Out_opt_ LPDWORD lpType,
+    _Out_writes_opt_(*lpcbData) LPBYTE lpData,
+    _Inout_opt_ LPDWORD lpcbData
+);
+
+/*
+* Query a registry value given a registry key/value path - similar to WINAPI
+* function 'RegQueryValueEx'.
+* Please consult WINAPI function documentation for information.
+* May be called with HKLM base or virtual address of CMHIVE base examples:
+*   1) 'HKLM\SOFTWARE\Key\SubKey\Value'
+*   2) 'HKLM\ORPHAN\SAM\Key\SubKey\'             (orphan key and default value)
+*   3) '0x<vaCMHIVE>\ROOT\Key\SubKey\Value'
+*   4) '0x<vaCMHIVE>\ORPHAN\Key\SubKey\Value'    (orphan key value)
+* -- wszFullPathKeyValue
+* -- lpType
+* -- lpData
+* -- lpcbData
+* -- return
+*/
+_Success_(return)
+BOOL VMMDLL_WinReg_QueryValueExW(
+    _In_ LPWSTR wszFullPathKeyValue,
+    _Out_opt_ LPDWORD lpType,
+    _Out_writes_opt_(*lpcbData) LPBYTE lpData,
+    _When_(lpData == NULL, _Out_opt_) _When_(lpData != NULL, _Inout_opt_) LPDWORD lpcbData
+);
+
+typedef struct tdVMMDLL_REGISTRY_SEARCH_MATCH {
+    ULONG64 vaCMHIVE;
+    ULONG64 ftLastWrite;        // last write time of key
+    LPWSTR wszKeyPath;          // key path relative to hive, i.e. 'ROOT\Key\SubKey'
+    LPWSTR wszValueName;        // value name, or NULL on key match
+    DWORD dwType;
+    DWORD cbData;               // value data length in pbData (max 16MB)
+    PBYTE pbData;
+} VMMDLL_REGISTRY_SEARCH_MATCH, *PVMMDLL_REGISTRY_SEARCH_MATCH;
+
+typedef BOOL(*VMMDLL_WINREG_SEARCH_CALLBACK)(_In_opt_ PVOID ctx, _In_ PVMMDLL_REGISTRY_SEARCH_MATCH pMatch);
+
+/*
+* Search all registry hives for keys and values matching the given criteria -
+* i.e. for persistence hunting without a large number of enumeration calls.
+* Hives are searched in parallel directly over their in-memory snapshots. The
+* active key tree is searched - deleted and orphaned keys are not searched.
+* If neither wszValueNameGlob nor pbDataPattern is given matching keys will be
+* reported, otherwise matching values will be reported.
+* Globs are case insensitive and may contain '*' and '?'.
+* Callbacks are never made concurrently but may be made from different threads.
+* Pointers in the match struct are only valid during the callback.
+* -- wszKeyPathGlob = optional key path glob, i.e. 'ROOT\*\CurrentVersion\Run*'.
+* -- wszValueNameGlob = optional value name glob.
+* -- pbDataPattern = optional byte pattern to search for within value data.
+* -- cbDataPattern
+* -- pfnCallback = callback function called on each match. Return FALSE to stop the search.
+* -- ctx = optional context to pass along to the callback function.
+* -- return
+*/
+_Success_(return)
+BOOL VMMDLL_WinReg_Search(
+    _In_opt_ LPWSTR wszKeyPathGlob,
+    _In_opt_ LPWSTR wszValueNameGlob,
+    _In_reads_opt_(cbDataPattern) PBYTE pbDataPattern,
+    _In_ DWORD cbDataPattern,
+    _In_ VMMDLL_WINREG_SEARCH_CALLBACK pfnCallback,
+    _In_opt_ PVOID ctx
+);
+
+
+
+//-----------------------------------------------------------------------------
+// WINDOWS SPECIFIC NETWORKING FUNCTIONALITY BELOW:
+//-----------------------------------------------------------------------------
+
+#define VMMDLL_WIN_TCPIP_MAGIC        0xc0ffee663df93685
+#define VMMDLL_WIN_TCPIP_VERSION      1
+
+typedef struct tdVMMDLL_WIN_TCPIP_ENTRY {   // SHARED WITH VMMWINTCPIP
+    DWORD dwPID;
+    DWORD dwState;
+    CHAR szState[12];
+    struct {    // address family (IPv4/IPv6)
+        BOOL fValid;
+        WORD wAF;
+    } AF;
+    struct {
+        BOOL fValid;
+        WORD wPort;
+        BYTE pbA[16];   // ipv4 = 1st 4 bytes, ipv6 = all bytes
+    } Src;
+    struct {
+        BOOL fValid;
+        WORD wPort;
+        BYTE pbA[16];   // ipv4 = 1st 4 bytes, ipv6 = all bytes
+    } Dst;
+    QWORD vaTcpE;
+    QWORD qwTime;
+    QWORD vaEPROCESS;
+    QWORD _Reserved[2];
+} VMMDLL_WIN_TCPIP_ENTRY, *PVMMDLL_WIN_TCPIP_ENTRY;
+
+typedef struct tdVMMDLL_WIN_TCPIP {
+    QWORD magic;
+    DWORD dwVersion;
+    DWORD cTcpE;
+    VMMDLL_WIN_TCPIP_ENTRY pTcpE[];
+} VMMDLL_WIN_TCPIP, *PVMMDLL_WIN_TCPIP;
+
+/*
+* Retrieve networking information about network connections related to Windows TCP/IP stack.
+* NB! CALLER IS RESPONSIBLE FOR VMMDLL_MemFree return value!
+* CALLER FREE: VMMDLL_MemFree(return)
+* -- return - fail: NULL, success: a PVMMDLL_WIN_TCPIP struct scontaining the result - NB! Caller responsible for VMMDLL_MemFree!
+*/
+PVMMDLL_WIN_TCPIP VMMDLL_WinNet_Get();
+
+
+
+//-----------------------------------------------------------------------------
+// WINDOWS SPECIFIC UTILITY FUNCTIONS BELOW:
+//-----------------------------------------------------------------------------
+
+typedef struct tdVMMDLL_WIN_THUNKINFO_IAT {
+    BOOL fValid;
+    BOOL f32;               // if TRUE fn is a 32-bit/4-byte entry, otherwise 64-bit/8-byte entry.
+    ULONG64 vaThunk;        // address of import address table 'thunk'.
+    ULONG64 vaFunction;     // value if import address table 'thunk' == address of imported function.
+    ULONG64 vaNameModule;   // address of name string for imported module.
+    ULONG64 vaNameFunction; // address of name string for imported function.
+} VMMDLL_WIN_THUNKINFO_IAT, *PVMMDLL_WIN_THUNKINFO_IAT;
+
+typedef struct tdVMMDLL_WIN_THUNKINFO_EAT {
+    BOOL fValid;
+    DWORD valueThunk;       // value of export address table 'thunk'.
+    ULONG64 vaThunk;        // address of import address table 'thunk'.
+    ULONG64 vaNameFunction; // address of name string for exported function.
+    ULONG64 vaFunction;     // address of exported function (module base + value parameter).
+} VMMDLL_WIN_THUNKINFO_EAT, *PVMMDLL_WIN_THUNKINFO_EAT;
+
+/*
+* Retrieve information about the import address table IAT thunk for an imported
+* function. This includes the virtual address of the IAT thunk which is useful
+* for hooking.
+* -- dwPID
+* -- wszModuleName
+* -- szImportModuleName
+* -- szImportFunctionName
+* -- pThunkIAT
+* -- return
+*/
+_Success_(return)
+BOOL VMMDLL_WinGetThunkInfoIAT(_In_ DWORD dwPID, _In_ LPWSTR wszModuleName, _In_ LPSTR szImportModuleName, _In_ LPSTR szImportFunctionName, _Out_ PVMMDLL_WIN_THUNKINFO_IAT pThunkInfoIAT);
+
+/*
+* Retrieve information about the export address table EAT thunk for an exported
+* function. This includes the virtual address of the EAT thunk which is useful
+* for hooking.
+* -- dwPID
+* -- wszModuleName
+* -- pThunkEAT
+* -- return
+*/
+_Success_(return)
+BOOL VMMDLL_WinGetThunkInfoEAT(_In_ DWORD dwPID, _In_ LPWSTR wszModuleName, _In_ LPSTR szExportFunctionName, _Out_ PVMMDLL_WIN_THUNKINFO_EAT pThunkInfoEAT);
+
+
+
+//-----------------------------------------------------------------------------
+// VMM UTIL FUNCTIONALITY BELOW:
+//-----------------------------------------------------------------------------
+
+/*
+* Fill a human readable hex ascii memory dump into the caller supplied sz buffer.
+* -- pb
+* -- cb
+* -- cbInitialOffset = offset, must be max 0x1000 and multiple of 0x10.
+* -- sz = buffer to fill, NULL to retrieve buffer size in pcsz parameter.
+* -- pcsz = IF sz==NULL :: size of buffer (including space for terminating NULL) on exit
+*           IF sz!=NULL :: size of buffer on entry, size of characters (excluding terminating NULL) on exit.
+*/
+_Success_(return)
+BOOL VMMDLL_UtilFillHexAscii(_In_ PBYTE pb, _In_ DWORD cb, _In_ DWORD cbInitialOffset, _Out_opt_ LPSTR sz, _Inout_ PDWORD pcsz);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* __VMMDLL_H__ */
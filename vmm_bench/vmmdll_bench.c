@@ -0,0 +1,813 @@
+// vmmdll_bench.c - MemProcFS C/C++ VMM API benchmark suite
+//
+// Runs a fixed set of micro and macro benchmarks against a memory dump file
+// and prints the results as JSON lines (one JSON object per benchmark) on
+// stdout to allow results to be compared across builds/commits.
+//
+// Syntax: vmm_bench.exe <dumpfile> [-warmup <n>] [-rep <n>] [-threads <n>] [-pid <pid>] [-numa]
+//
+// Each benchmark is run <warmup> times untimed and <rep> times timed. The
+// reported times are min/median/max of the timed runs (in microseconds) and
+// the rate is the number of units per second of the median run.
+//
+// (c) Ulf Frisk, 2019
+// Author: Ulf Frisk, pcileech@frizk.net
+//
+
+#include <Windows.h>
+#include <stdio.h>
+#include "leechcore.h"
+#include "vmmdll.h"
+#include "../vmm/mm_ptescan.h"
+#include "../vmm/xpress.h"
+#include "../vmm/pidhash.h"
+#include "../vmm/ob.h"
+#include "../MemProcFS/vfs_readahead.h"
+
+#pragma comment(lib, "leechcore")
+#pragma comment(lib, "vmm")
+
+#define BENCH_REP_MAX                   64
+#define BENCH_SCATTER_PAGES             0x1000
+#define BENCH_VIRT2PHYS_MAX             0x10000
+#define BENCH_SMALLREAD_COUNT           0x40000
+#define BENCH_REGISTRY_DEPTH_MAX        3
+#define BENCH_VFS_READ_CHUNK            0x00100000
+#define BENCH_VFS_READ_TOTAL            0x04000000
+#define BENCH_VFS_READAHEAD_CHUNK       0x00010000  // typical explorer/copy read size
+#define BENCH_HEXASCII_SIZE             0x00100000
+#define BENCH_PTESCAN_TABLES            0x400
+#define BENCH_PTESCAN_LOOPS             0x10
+#define BENCH_XPRESS_PAGES              0x400
+#define BENCH_PIDHASH_LOOKUPS           0x00100000
+#define BENCH_OB_ALLOCS                 0x00100000
+#define BENCH_OB_LIVE                   0x4000
+#define BENCH_OB_TAG_HEAP               'BnHp'      // not pooled by ob_core
+
+typedef LONG(WINAPI *PFN_RtlGetCompressionWorkSpaceSize)(USHORT CompressionFormatAndEngine, PULONG CompressBufferWorkSpaceSize, PULONG CompressFragmentWorkSpaceSize);
+typedef LONG(WINAPI *PFN_RtlCompressBuffer)(USHORT CompressionFormatAndEngine, PUCHAR UncompressedBuffer, ULONG UncompressedBufferSize, PUCHAR CompressedBuffer, ULONG CompressedBufferSize, ULONG UncompressedChunkSize, PULONG FinalCompressedSize, PVOID WorkSpace);
+typedef LONG(WINAPI *PFN_RtlDecompressBuffer)(USHORT CompressionFormat, PUCHAR UncompressedBuffer, ULONG UncompressedBufferSize, PUCHAR CompressedBuffer, ULONG CompressedBufferSize, PULONG FinalUncompressedSize);
+
+typedef struct tdBENCH_CONTEXT {
+    DWORD cWarmup;
+    DWORD cRep;
+    DWORD cThreadMax;
+    DWORD dwPID;
+    BOOL fNUMA;
+    QWORD paMax;
+    QWORD qwFreq;
+    DWORD cPIDs;
+    PDWORD pPIDs;
+    DWORD cVAs;
+    PQWORD pVAs;
+    PPMEM_IO_SCATTER_HEADER ppMEMs;
+    PBYTE pbVfs;
+    PVFS_READAHEAD pVfsReadAhead;
+    DWORD cszHexAscii;
+    LPSTR szHexAscii;
+    DWORD cPageTables;
+    PQWORD pqwPageTables;             // [BENCH_PTESCAN_TABLES * 512]
+    DWORD cXpress;
+    PBYTE pbXpress;                   // [BENCH_XPRESS_PAGES * 0x1000] compressed pages
+    PDWORD pcbXpress;                 // [BENCH_XPRESS_PAGES] compressed sizes
+    PFN_RtlDecompressBuffer pfnRtlDecompressBuffer;
+    PIDHASH PidHash;
+    PBYTE pbPidHash;
+    volatile LONG iNextPID;           // parallel benchmark state
+} BENCH_CONTEXT, *PBENCH_CONTEXT;
+
+BENCH_CONTEXT g_ctx = { 0 };
+
+// ----------------------------------------------------------------------------
+// Benchmark runner below:
+// ----------------------------------------------------------------------------
+
+typedef struct tdBENCH_DEFINITION {
+    LPSTR szName;
+    LPSTR szUnit;
+    VOID(*pfnSetup)(_In_ QWORD qwParam);                // optional untimed setup before each run
+    QWORD(*pfnRun)(_In_ QWORD qwParam);                 // timed run - return number of units processed
+} BENCH_DEFINITION, *PBENCH_DEFINITION;
+
+int Bench_CmpSort(_In_ const QWORD *p1, _In_ const QWORD *p2)
+{
+    return (*p1 < *p2) ? -1 : ((*p1 > *p2) ? 1 : 0);
+}
+
+QWORD Bench_TimeUs(_In_ QWORD tmStart, _In_ QWORD tmEnd)
+{
+    return ((tmEnd - tmStart) * 1000000ULL) / g_ctx.qwFreq;
+}
+
+/*
+* Run a benchmark with warm-up and repetitions and print the result as a JSON
+* line on stdout.
+* -- pDef
+* -- qwParam = benchmark specific parameter (i.e. thread count).
+*/
+VOID Bench_Run(_In_ PBENCH_DEFINITION pDef, _In_ QWORD qwParam)
+{
+    DWORD i;
+    QWORD tmStart, tmEnd, cUnits = 0, qwMedianUs;
+    QWORD pqwTimeUs[BENCH_REP_MAX], pcUnits[BENCH_REP_MAX];
+    for(i = 0; i < g_ctx.cWarmup; i++) {
+        if(pDef->pfnSetup) { pDef->pfnSetup(qwParam); }
+        pDef->pfnRun(qwParam);
+    }
+    for(i = 0; i < g_ctx.cRep; i++) {
+        if(pDef->pfnSetup) { pDef->pfnSetup(qwParam); }
+        QueryPerformanceCounter((PLARGE_INTEGER)&tmStart);
+        pcUnits[i] = pDef->pfnRun(qwParam);
+        QueryPerformanceCounter((PLARGE_INTEGER)&tmEnd);
+        pqwTimeUs[i] = Bench_TimeUs(tmStart, tmEnd);
+        cUnits = max(cUnits, pcUnits[i]);
+    }
+    qsort(pqwTimeUs, g_ctx.cRep, sizeof(QWORD), (int(*)(const void*, const void*))Bench_CmpSort);
+    qwMedianUs = pqwTimeUs[g_ctx.cRep / 2];
+    printf(
+        "{\"name\":\"%s\",\"param\":%llu,\"warmup\":%u,\"rep\":%u,\"unit\":\"%s\",\"units\":%llu,\"time_us_min\":%llu,\"time_us_median\":%llu,\"time_us_max\":%llu,\"rate_per_s\":%llu}\n",
+        pDef->szName, qwParam, g_ctx.cWarmup, g_ctx.cRep, pDef->szUnit, cUnits,
+        pqwTimeUs[0], qwMedianUs, pqwTimeUs[g_ctx.cRep - 1],
+        qwMedianUs ? (QWORD)((double)cUnits * 1000000.0 / (double)qwMedianUs) : 0);
+    fflush(stdout);
+}
+
+// ----------------------------------------------------------------------------
+// Benchmarks below:
+// ----------------------------------------------------------------------------
+
+VOID Bench_Setup_Refresh(_In_ QWORD qwParam)
+{
+    VMMDLL_Refresh(0);
+}
+
+/*
+* Physical scatter read of BENCH_SCATTER_PAGES pages spread evenly over the
+* physical address space. qwParam = VMMDLL_FLAG_* (NOCACHE for cold reads).
+*/
+QWORD Bench_ScatterRead(_In_ QWORD qwParam)
+{
+    DWORD i;
+    QWORD paStride = max(0x1000, (g_ctx.paMax / BENCH_SCATTER_PAGES) & ~0xfff);
+    for(i = 0; i < BENCH_SCATTER_PAGES; i++) {
+        g_ctx.ppMEMs[i]->qwA = (i * paStride) % g_ctx.paMax;
+        g_ctx.ppMEMs[i]->cb = 0;
+    }
+    return 0x1000ULL * VMMDLL_MemReadScatter((DWORD)-1, g_ctx.ppMEMs, BENCH_SCATTER_PAGES, (DWORD)qwParam);
+}
+
+QWORD Bench_Virt2Phys(_In_ QWORD qwParam)
+{
+    DWORD i;
+    QWORD pa, c = 0;
+    for(i = 0; i < g_ctx.cVAs; i++) {
+        if(VMMDLL_MemVirt2Phys(g_ctx.dwPID, g_ctx.pVAs[i], &pa)) { c++; }
+    }
+    return c;
+}
+
+/*
+* Many small virtual memory reads (qwParam = read size in bytes) - as made by
+* struct/pointer reads - spread over the pages of the target process. The
+* offsets within the pages vary so that some reads straddle page boundaries.
+*/
+QWORD Bench_SmallRead(_In_ QWORD qwParam)
+{
+    DWORD i, cbRead;
+    QWORD c = 0;
+    BYTE pb[0x40];
+    for(i = 0; i < BENCH_SMALLREAD_COUNT; i++) {
+        if(VMMDLL_MemReadEx(g_ctx.dwPID, g_ctx.pVAs[i % g_ctx.cVAs] + ((i * 0x1f8ULL) & 0xfff), pb, (DWORD)qwParam, &cbRead, 0) && (cbRead == qwParam)) {
+            c++;
+        }
+    }
+    return c;
+}
+
+/*
+* Build a process map for all processes: qwParam = 0:PTE, 1:VAD, 2:MODULE, 3:HANDLE.
+* Only the size query is made - which builds the map - to avoid measuring the
+* copy into the caller supplied buffer.
+*/
+QWORD Bench_Map_Single(_In_ QWORD qwParam, _In_ DWORD dwPID)
+{
+    DWORD cb = 0;
+    switch(qwParam) {
+        case 0: return VMMDLL_ProcessMap_GetPte(dwPID, NULL, &cb, TRUE);
+        case 1: return VMMDLL_ProcessMap_GetVad(dwPID, NULL, &cb, TRUE);
+        case 2: return VMMDLL_ProcessMap_GetModule(dwPID, NULL, &cb);
+        case 3: return VMMDLL_ProcessMap_GetHandle(dwPID, NULL, &cb);
+    }
+    return 0;
+}
+
+QWORD Bench_Map(_In_ QWORD qwParam)
+{
+    DWORD i;
+    QWORD c = 0;
+    for(i = 0; i < g_ctx.cPIDs; i++) {
+        c += Bench_Map_Single(qwParam, g_ctx.pPIDs[i]);
+    }
+    return c;
+}
+
+QWORD Bench_Registry_EnumKey(_In_ LPWSTR wszPath, _In_ DWORD cDepth)
+{
+    DWORD i, cch;
+    QWORD c = 0;
+    WCHAR wszName[MAX_PATH];
+    WCHAR wszSubPath[2 * MAX_PATH];
+    for(i = 0; ; i++) {
+        cch = MAX_PATH;
+        if(!VMMDLL_WinReg_EnumKeyExW(wszPath, i, wszName, &cch, NULL)) { break; }
+        c++;
+        if((cDepth < BENCH_REGISTRY_DEPTH_MAX) && (_snwprintf_s(wszSubPath, _countof(wszSubPath), _TRUNCATE, L"%s\\%s", wszPath, wszName) > 0)) {
+            c += Bench_Registry_EnumKey(wszSubPath, cDepth + 1);
+        }
+    }
+    return c;
+}
+
+QWORD Bench_Registry(_In_ QWORD qwParam)
+{
+    return Bench_Registry_EnumKey(L"HKLM\\SYSTEM", 0);
+}
+
+/*
+* Per-process action scaling: qwParam client threads concurrently retrieve
+* process information and the PTE map of all processes.
+*/
+DWORD WINAPI Bench_Parallel_ThreadProc(_In_ LPVOID lpParameter)
+{
+    LONG i;
+    SIZE_T cbInfo;
+    VMMDLL_PROCESS_INFORMATION Info;
+    PQWORD pc = (PQWORD)lpParameter;
+    while((i = InterlockedIncrement(&g_ctx.iNextPID) - 1) < (LONG)g_ctx.cPIDs) {
+        ZeroMemory(&Info, sizeof(VMMDLL_PROCESS_INFORMATION));
+        Info.magic = VMMDLL_PROCESS_INFORMATION_MAGIC;
+        Info.wVersion = VMMDLL_PROCESS_INFORMATION_VERSION;
+        cbInfo = sizeof(VMMDLL_PROCESS_INFORMATION);
+        if(VMMDLL_ProcessGetInformation(g_ctx.pPIDs[i], &Info, &cbInfo) && Bench_Map_Single(0, g_ctx.pPIDs[i])) {
+            (*pc)++;
+        }
+    }
+    return 0;
+}
+
+QWORD Bench_Parallel(_In_ QWORD qwParam)
+{
+    DWORD i, cThreads = (DWORD)qwParam;
+    QWORD c = 0, pc[MAXIMUM_WAIT_OBJECTS] = { 0 };
+    HANDLE phThreads[MAXIMUM_WAIT_OBJECTS] = { 0 };
+    g_ctx.iNextPID = 0;
+    for(i = 0; i < cThreads; i++) {
+        phThreads[i] = CreateThread(NULL, 0, Bench_Parallel_ThreadProc, pc + i, 0, NULL);
+    }
+    for(i = 0; i < cThreads; i++) {
+        if(phThreads[i]) {
+            WaitForSingleObject(phThreads[i], INFINITE);
+            CloseHandle(phThreads[i]);
+        }
+        c += pc[i];
+    }
+    return c;
+}
+
+/*
+* Sequential VFS read of the physical memory file in 1MB chunks.
+* qwParam = 0:cold (refresh before run), 1:warm.
+*/
+QWORD Bench_VfsRead(_In_ QWORD qwParam)
+{
+    NTSTATUS nt;
+    DWORD cbRead;
+    QWORD o, c = 0, cbTotal = min(BENCH_VFS_READ_TOTAL, g_ctx.paMax);
+    for(o = 0; o < cbTotal; o += BENCH_VFS_READ_CHUNK) {
+        nt = VMMDLL_VfsRead(L"\\memory.pmem", g_ctx.pbVfs, BENCH_VFS_READ_CHUNK, &cbRead, o);
+        if(nt != VMMDLL_STATUS_SUCCESS) { break; }
+        c += cbRead;
+    }
+    return c;
+}
+
+/*
+* Create a fresh read-ahead context (if qwParam != 0) on a refreshed vmm.
+*/
+VOID Bench_Setup_VfsReadAhead(_In_ QWORD qwParam)
+{
+    VMMDLL_Refresh(0);
+    VfsReadAhead_Free(g_ctx.pVfsReadAhead);
+    g_ctx.pVfsReadAhead = qwParam ? VfsReadAhead_New(VMMDLL_VfsRead, L"\\memory.pmem", g_ctx.paMax, INFINITE) : NULL;
+}
+
+/*
+* Sequential VFS read of the physical memory file in 64kB chunks - the access
+* pattern served by the MemProcFS read-ahead.
+* qwParam = 0:direct, 1:read-ahead, 2:read-ahead invalidated after each read
+* (worst case; as if each read was interleaved with a write).
+*/
+QWORD Bench_VfsReadAhead(_In_ QWORD qwParam)
+{
+    NTSTATUS nt;
+    DWORD cbRead;
+    QWORD o, c = 0, cbTotal = min(BENCH_VFS_READ_TOTAL, g_ctx.paMax);
+    if(qwParam && !g_ctx.pVfsReadAhead) { return 0; }
+    for(o = 0; o < cbTotal; o += BENCH_VFS_READAHEAD_CHUNK) {
+        if(qwParam) {
+            nt = VfsReadAhead_Read(g_ctx.pVfsReadAhead, g_ctx.pbVfs, BENCH_VFS_READAHEAD_CHUNK, &cbRead, o);
+            if(qwParam == 2) { VfsReadAhead_Invalidate(); }
+        } else {
+            nt = VMMDLL_VfsRead(L"\\memory.pmem", g_ctx.pbVfs, BENCH_VFS_READAHEAD_CHUNK, &cbRead, o);
+        }
+        if(nt != VMMDLL_STATUS_SUCCESS) { break; }
+        c += cbRead;
+    }
+    return c;
+}
+
+/*
+* Hexdump rendering throughput of the last read 1MB VFS chunk.
+*/
+QWORD Bench_FillHexAscii(_In_ QWORD qwParam)
+{
+    DWORD csz = g_ctx.cszHexAscii;
+    if(!VMMDLL_UtilFillHexAscii(g_ctx.pbVfs, BENCH_HEXASCII_SIZE, 0, g_ctx.szHexAscii, &csz)) { return 0; }
+    return BENCH_HEXASCII_SIZE;
+}
+
+/*
+* Scan page tables read from the target process for valid non-large entries -
+* the scan made by the x64 tlb spider and pte map walkers for each table - and
+* visit each matching entry. qwParam = 0:scalar per-entry branch, 1:SSE2, 2:AVX2.
+*/
+QWORD Bench_PteScan(_In_ QWORD qwParam)
+{
+    DWORD i, iLoop, iPte;
+    QWORD c = 0, qwBitmap[8], iBit;
+    PQWORD PTEs;
+    g_fMmX64PteScanAVX2 = (qwParam == 2);
+    for(iLoop = 0; iLoop < BENCH_PTESCAN_LOOPS; iLoop++) {
+        for(i = 0; i < g_ctx.cPageTables; i++) {
+            PTEs = g_ctx.pqwPageTables + i * 512ULL;
+            if(qwParam == 0) {
+                for(iPte = 0; iPte < 512; iPte++) {
+                    if((PTEs[iPte] & 0x81) == 0x01) {
+                        c += iPte;
+                    }
+                }
+            } else {
+                ZeroMemory(qwBitmap, sizeof(qwBitmap));
+                MmX64_PteScan(PTEs, 0x81, 0x01, qwBitmap);
+                while(MmX64_PteScanNext(qwBitmap, &iBit)) {
+                    c += iBit;
+                }
+            }
+        }
+    }
+    return c ? BENCH_PTESCAN_LOOPS * (QWORD)g_ctx.cPageTables : 0;
+}
+
+/*
+* Decompress the Xpress compressed pages - as done for each page read from the
+* windows memory compression store. qwParam = 0:Xpress_Decompress (built-in),
+* 1:ntdll!RtlDecompressBuffer.
+*/
+QWORD Bench_Xpress(_In_ QWORD qwParam)
+{
+    DWORD i, cb;
+    QWORD c = 0;
+    BYTE pbPage[0x1000];
+    for(i = 0; i < g_ctx.cXpress; i++) {
+        if(qwParam == 0) {
+            if(Xpress_Decompress(g_ctx.pbXpress + i * 0x1000ULL, g_ctx.pcbXpress[i], pbPage, 0x1000, &cb) && (cb == 0x1000)) { c++; }
+        } else {
+            if(!g_ctx.pfnRtlDecompressBuffer(COMPRESSION_FORMAT_XPRESS, pbPage, 0x1000, g_ctx.pbXpress + i * 0x1000ULL, g_ctx.pcbXpress[i], &cb) && (cb == 0x1000)) { c++; }
+        }
+    }
+    return c;
+}
+
+/*
+* Build a synthetic PID hash index of qwParam processes - sized as the process
+* table sizes it - with PIDs being scattered multiples of four as on windows.
+*/
+VOID Bench_Setup_PidHash(_In_ QWORD qwParam)
+{
+    DWORD i, cMax = 0x100;
+    while(cMax < qwParam + (qwParam >> 2)) {
+        cMax <<= 1;
+    }
+    if(g_ctx.pbPidHash && (g_ctx.PidHash.c == qwParam)) { return; }
+    LocalFree(g_ctx.pbPidHash);
+    if(!(g_ctx.pbPidHash = LocalAlloc(LMEM_ZEROINIT, PidHash_Size(cMax)))) {
+        ZeroMemory(&g_ctx.PidHash, sizeof(PIDHASH));
+        return;
+    }
+    PidHash_Initialize(&g_ctx.PidHash, cMax, g_ctx.pbPidHash);
+    for(i = 0; i < qwParam; i++) {
+        PidHash_Insert(&g_ctx.PidHash, 4 * (5 * i + (i & 3) + 1));
+    }
+}
+
+/*
+* Look up PIDs in the synthetic PID hash index. Every other lookup is a hit on
+* an existing PID and every other a miss (PIDs not a multiple of four).
+* qwParam = number of processes in the index.
+*/
+QWORD Bench_PidHash(_In_ QWORD qwParam)
+{
+    DWORD i, c = 0;
+    if(!g_ctx.PidHash.c) { return 0; }
+    for(i = 0; i < BENCH_PIDHASH_LOOKUPS; i++) {
+        if(i & 1) {
+            c += (PidHash_Find(&g_ctx.PidHash, g_ctx.PidHash.pdwKey[(i * 0x9E3779B1) % g_ctx.PidHash.c] + 2) == PIDHASH_INDEX_NONE) ? 1 : 0;
+        } else {
+            c += (PidHash_Find(&g_ctx.PidHash, g_ctx.PidHash.pdwKey[(i * 0x9E3779B1) % g_ctx.PidHash.c]) != PIDHASH_INDEX_NONE) ? 1 : 0;
+        }
+    }
+    return c;
+}
+
+/*
+* Retrieve the object size of allocation i of the object manager benchmarks.
+* Sizes are spread over the pooled size classes.
+*/
+DWORD Bench_ObSize(_In_ QWORD i)
+{
+    return (DWORD)(sizeof(OB) + (((i * 0x9E3779B1) >> 8) % 0x1f00));
+}
+
+/*
+* Allocate and free short-lived objects - as done for the core object manager
+* collections - one at a time. qwParam = 0:pooled core tag, 1:heap tag.
+*/
+QWORD Bench_ObAlloc(_In_ QWORD qwParam)
+{
+    DWORD i, c = 0;
+    PVOID pOb;
+    DWORD tag = qwParam ? BENCH_OB_TAG_HEAP : OB_TAG_CORE_DATA;
+    for(i = 0; i < BENCH_OB_ALLOCS; i++) {
+        if((pOb = Ob_Alloc(tag, 0, Bench_ObSize(i), NULL, NULL))) {
+            Ob_DECREF(pOb);
+            c++;
+        }
+    }
+    return c;
+}
+
+/*
+* Sum the committed and the allocated (busy) bytes of the process heap - which
+* backs LocalAlloc and therefore the object manager.
+*/
+VOID Bench_HeapUsage(_Out_ PQWORD pcbCommitted, _Out_ PQWORD pcbBusy)
+{
+    PROCESS_HEAP_ENTRY e = { 0 };
+    HANDLE hHeap = GetProcessHeap();
+    *pcbCommitted = 0;
+    *pcbBusy = 0;
+    HeapLock(hHeap);
+    while(HeapWalk(hHeap, &e)) {
+        if(e.wFlags & PROCESS_HEAP_REGION) {
+            *pcbCommitted += e.Region.dwCommittedSize;
+        } else if(e.wFlags & PROCESS_HEAP_ENTRY_BUSY) {
+            *pcbBusy += e.cbData;
+        }
+    }
+    HeapUnlock(hHeap);
+}
+
+/*
+* Churn a window of BENCH_OB_LIVE live objects of random sizes by replacing a
+* random object per allocation. If fHeapUsage the process heap growth during
+* the churn - compared to the live object bytes - is printed as a JSON line
+* on stdout as a measure of fragmentation.
+* -- qwParam = 0:pooled core tag, 1:heap tag.
+* -- fHeapUsage
+* -- return = number of objects allocated.
+*/
+QWORD Bench_ObChurnEx(_In_ QWORD qwParam, _In_ BOOL fHeapUsage)
+{
+    DWORD i, iLive;
+    QWORD c = 0, cbLive = 0, cbCommitted0 = 0, cbBusy0 = 0, cbCommitted1, cbBusy1;
+    PVOID *ppOb;
+    DWORD tag = qwParam ? BENCH_OB_TAG_HEAP : OB_TAG_CORE_DATA;
+    if(!(ppOb = LocalAlloc(LMEM_ZEROINIT, BENCH_OB_LIVE * sizeof(PVOID)))) { return 0; }
+    if(fHeapUsage) { Bench_HeapUsage(&cbCommitted0, &cbBusy0); }
+    for(i = 0; i < BENCH_OB_ALLOCS; i++) {
+        iLive = (DWORD)((i * 0x9E3779B1ULL) >> 7) % BENCH_OB_LIVE;
+        Ob_DECREF(ppOb[iLive]);
+        if((ppOb[iLive] = Ob_Alloc(tag, 0, Bench_ObSize(i), NULL, NULL))) { c++; }
+    }
+    if(fHeapUsage) {
+        for(i = 0; i < BENCH_OB_LIVE; i++) {
+            if(ppOb[i]) { cbLive += sizeof(OB) + ((POB)ppOb[i])->cbData; }
+        }
+        Bench_HeapUsage(&cbCommitted1, &cbBusy1);
+        printf(
+            "{\"name\":\"ob_churn_fragmentation\",\"param\":%llu,\"live_bytes\":%llu,\"heap_committed_delta\":%lli,\"heap_busy_delta\":%lli}\n",
+            qwParam, cbLive, (LONG64)(cbCommitted1 - cbCommitted0), (LONG64)(cbBusy1 - cbBusy0));
+        fflush(stdout);
+    }
+    for(i = 0; i < BENCH_OB_LIVE; i++) {
+        Ob_DECREF(ppOb[i]);
+    }
+    LocalFree(ppOb);
+    return c;
+}
+
+QWORD Bench_ObChurn(_In_ QWORD qwParam)
+{
+    return Bench_ObChurnEx(qwParam, FALSE);
+}
+
+// ----------------------------------------------------------------------------
+// Initialization and main below:
+// ----------------------------------------------------------------------------
+
+/*
+* Select the benchmark target process (if not given) as the process with the
+* largest PTE map and collect the page addresses used by the virt2phys bench.
+*/
+BOOL Bench_InitializeTarget()
+{
+    DWORD i, j, cb, cbMax = 0;
+    QWORD va;
+    PVMMDLL_MAP_PTE pPteMap = NULL;
+    ULONG64 cPIDs = 0;
+    if(!VMMDLL_PidList(NULL, &cPIDs) || !cPIDs) { return FALSE; }
+    if(!(g_ctx.pPIDs = LocalAlloc(LMEM_ZEROINIT, cPIDs * sizeof(DWORD)))) { return FALSE; }
+    if(!VMMDLL_PidList(g_ctx.pPIDs, &cPIDs)) { return FALSE; }
+    g_ctx.cPIDs = (DWORD)cPIDs;
+    if(!g_ctx.dwPID) {
+        for(i = 0; i < g_ctx.cPIDs; i++) {
+            cb = 0;
+            if(VMMDLL_ProcessMap_GetPte(g_ctx.pPIDs[i], NULL, &cb, FALSE) && (cb > cbMax)) {
+                cbMax = cb;
+                g_ctx.dwPID = g_ctx.pPIDs[i];
+            }
+        }
+    }
+    cb = 0;
+    if(!VMMDLL_ProcessMap_GetPte(g_ctx.dwPID, NULL, &cb, FALSE)) { return FALSE; }
+    if(!(pPteMap = LocalAlloc(0, cb))) { return FALSE; }
+    if(!(g_ctx.pVAs = LocalAlloc(0, BENCH_VIRT2PHYS_MAX * sizeof(QWORD)))) { goto fail; }
+    if(!VMMDLL_ProcessMap_GetPte(g_ctx.dwPID, pPteMap, &cb, FALSE)) { goto fail; }
+    for(i = 0; (i < pPteMap->cMap) && (g_ctx.cVAs < BENCH_VIRT2PHYS_MAX); i++) {
+        for(j = 0, va = pPteMap->pMap[i].vaBase; (j < pPteMap->pMap[i].cPages) && (g_ctx.cVAs < BENCH_VIRT2PHYS_MAX); j++, va += 0x1000) {
+            g_ctx.pVAs[g_ctx.cVAs++] = va;
+        }
+    }
+    LocalFree(pPteMap);
+    return g_ctx.cVAs > 0;
+fail:
+    LocalFree(pPteMap);
+    return FALSE;
+}
+
+/*
+* Read up to BENCH_PTESCAN_TABLES page tables of the target process by a breath
+* first walk from its DTB (x64 only) for use by the pte scan benchmark.
+*/
+BOOL Bench_InitializePageTables()
+{
+    DWORD i, iTable;
+    QWORD pte, pa;
+    SIZE_T cbInfo = sizeof(VMMDLL_PROCESS_INFORMATION);
+    VMMDLL_PROCESS_INFORMATION Info = { 0 };
+    Info.magic = VMMDLL_PROCESS_INFORMATION_MAGIC;
+    Info.wVersion = VMMDLL_PROCESS_INFORMATION_VERSION;
+    if(!VMMDLL_ProcessGetInformation(g_ctx.dwPID, &Info, &cbInfo) || (Info.tpMemoryModel != VMMDLL_MEMORYMODEL_X64)) { return FALSE; }
+    if(!(g_ctx.pqwPageTables = LocalAlloc(0, BENCH_PTESCAN_TABLES * 0x1000ULL))) { return FALSE; }
+    if(!VMMDLL_MemRead((DWORD)-1, Info.paDTB & ~0xfff, (PBYTE)g_ctx.pqwPageTables, 0x1000)) { return FALSE; }
+    g_ctx.cPageTables = 1;
+    for(iTable = 0; (iTable < g_ctx.cPageTables) && (g_ctx.cPageTables < BENCH_PTESCAN_TABLES); iTable++) {
+        for(i = 0; (i < 512) && (g_ctx.cPageTables < BENCH_PTESCAN_TABLES); i++) {
+            pte = g_ctx.pqwPageTables[iTable * 512ULL + i];
+            pa = pte & 0x0000fffffffff000;
+            if(((pte & 0x81) != 0x01) || (pa >= g_ctx.paMax)) { continue; }
+            if(VMMDLL_MemRead((DWORD)-1, pa, (PBYTE)(g_ctx.pqwPageTables + g_ctx.cPageTables * 512ULL), 0x1000)) {
+                g_ctx.cPageTables++;
+            }
+        }
+    }
+    return TRUE;
+}
+
+/*
+* Compress up to BENCH_XPRESS_PAGES physical pages spread evenly over physical
+* memory with ntdll!RtlCompressBuffer (Xpress) for use by the decompression
+* benchmark. Pages that do not compress are skipped. The built-in decoder is
+* verified to decompress each page identically to the original.
+*/
+BOOL Bench_InitializeXpress()
+{
+    DWORD i, cbCompressed, cbVerify, cbWorkspace, cbFragment;
+    QWORD paStride = max(0x1000, (g_ctx.paMax / BENCH_XPRESS_PAGES) & ~0xfff);
+    BYTE pbPage[0x1000], pbVerify[0x1000];
+    PBYTE pbWorkspace = NULL;
+    HMODULE hNtDll;
+    PFN_RtlGetCompressionWorkSpaceSize pfnRtlGetCompressionWorkSpaceSize;
+    PFN_RtlCompressBuffer pfnRtlCompressBuffer;
+    if(!(hNtDll = GetModuleHandleA("ntdll.dll"))) { return FALSE; }
+    pfnRtlGetCompressionWorkSpaceSize = (PFN_RtlGetCompressionWorkSpaceSize)GetProcAddress(hNtDll, "RtlGetCompressionWorkSpaceSize");
+    pfnRtlCompressBuffer = (PFN_RtlCompressBuffer)GetProcAddress(hNtDll, "RtlCompressBuffer");
+    g_ctx.pfnRtlDecompressBuffer = (PFN_RtlDecompressBuffer)GetProcAddress(hNtDll, "RtlDecompressBuffer");
+    if(!pfnRtlGetCompressionWorkSpaceSize || !pfnRtlCompressBuffer || !g_ctx.pfnRtlDecompressBuffer) { return FALSE; }
+    if(pfnRtlGetCompressionWorkSpaceSize(COMPRESSION_FORMAT_XPRESS, &cbWorkspace, &cbFragment)) { return FALSE; }
+    if(!(pbWorkspace = LocalAlloc(0, cbWorkspace))) { return FALSE; }
+    g_ctx.pbXpress = LocalAlloc(0, BENCH_XPRESS_PAGES * 0x1000ULL);
+    g_ctx.pcbXpress = LocalAlloc(0, BENCH_XPRESS_PAGES * sizeof(DWORD));
+    if(!g_ctx.pbXpress || !g_ctx.pcbXpress) { goto fail; }
+    for(i = 0; i < BENCH_XPRESS_PAGES; i++) {
+        if(!VMMDLL_MemRead((DWORD)-1, (i * paStride) % g_ctx.paMax, pbPage, 0x1000)) { continue; }
+        if(pfnRtlCompressBuffer(COMPRESSION_FORMAT_XPRESS, pbPage, 0x1000, g_ctx.pbXpress + g_ctx.cXpress * 0x1000ULL, 0x1000, 0x1000, &cbCompressed, pbWorkspace)) { continue; }
+        if(!Xpress_Decompress(g_ctx.pbXpress + g_ctx.cXpress * 0x1000ULL, cbCompressed, pbVerify, 0x1000, &cbVerify) || (cbVerify != 0x1000) || memcmp(pbPage, pbVerify, 0x1000)) {
+            fprintf(stderr, "FAIL: xpress decompression mismatch at pa %016llx\n", (i * paStride) % g_ctx.paMax);
+            goto fail;
+        }
+        g_ctx.pcbXpress[g_ctx.cXpress++] = cbCompressed;
+    }
+    LocalFree(pbWorkspace);
+    return g_ctx.cXpress ? TRUE : FALSE;
+fail:
+    LocalFree(pbWorkspace);
+    g_ctx.cXpress = 0;
+    return FALSE;
+}
+
+VOID Bench_ShowUsage()
+{
+    fprintf(stderr,
+        "MemProcFS VMM API benchmark suite. Output is printed as JSON lines.    \n" \
+        "Syntax: vmm_bench.exe <dumpfile> [options]                            \n" \
+        "  -warmup <n>  : untimed warm-up runs per benchmark (default: 1).     \n" \
+        "  -rep <n>     : timed repetitions per benchmark (default: 5, max: 64).\n" \
+        "  -threads <n> : max number of threads in scaling benchmark (default: \n" \
+        "                 number of logical processors, max: 64).              \n" \
+        "  -pid <pid>   : target process (default: process with most PTEs).    \n" \
+        "  -numa        : initialize the VMM in numa mode (multi-socket hosts).\n");
+}
+
+int main(_In_ int argc, _In_ char* argv[])
+{
+    int i;
+    QWORD qwThreads, qwProcesses;
+    SYSTEM_INFO SystemInfo;
+    BENCH_DEFINITION Def;
+    BENCH_DEFINITION DefMap[] = {
+        { "map_pte",    "maps", Bench_Setup_Refresh, Bench_Map },
+        { "map_vad",    "maps", Bench_Setup_Refresh, Bench_Map },
+        { "map_module", "maps", Bench_Setup_Refresh, Bench_Map },
+        { "map_handle", "maps", Bench_Setup_Refresh, Bench_Map },
+    };
+    if(argc < 2) {
+        Bench_ShowUsage();
+        return 1;
+    }
+    GetSystemInfo(&SystemInfo);
+    g_ctx.cWarmup = 1;
+    g_ctx.cRep = 5;
+    g_ctx.cThreadMax = SystemInfo.dwNumberOfProcessors;
+    for(i = 2; i < argc; i += 2) {
+        if(!_stricmp(argv[i], "-numa")) {
+            g_ctx.fNUMA = TRUE;
+            i--;
+        } else if(i + 1 >= argc) {
+            Bench_ShowUsage();
+            return 1;
+        } else if(!_stricmp(argv[i], "-warmup")) {
+            g_ctx.cWarmup = strtoul(argv[i + 1], NULL, 0);
+        } else if(!_stricmp(argv[i], "-rep")) {
+            g_ctx.cRep = strtoul(argv[i + 1], NULL, 0);
+        } else if(!_stricmp(argv[i], "-threads")) {
+            g_ctx.cThreadMax = strtoul(argv[i + 1], NULL, 0);
+        } else if(!_stricmp(argv[i], "-pid")) {
+            g_ctx.dwPID = strtoul(argv[i + 1], NULL, 0);
+        } else {
+            Bench_ShowUsage();
+            return 1;
+        }
+    }
+    g_ctx.cRep = max(1, min(BENCH_REP_MAX, g_ctx.cRep));
+    g_ctx.cThreadMax = max(1, min(MAXIMUM_WAIT_OBJECTS, g_ctx.cThreadMax));
+    QueryPerformanceFrequency((PLARGE_INTEGER)&g_ctx.qwFreq);
+    // initialize
+    if(!VMMDLL_Initialize(g_ctx.fNUMA ? 5 : 4, (LPSTR[]) { "", "-device", argv[1], "-waitinitialize", "-numa" })) {
+        fprintf(stderr, "FAIL: VMMDLL_Initialize: '%s'\n", argv[1]);
+        return 1;
+    }
+    if(!VMMDLL_ConfigGet(VMMDLL_OPT_CORE_MAX_NATIVE_ADDRESS, &g_ctx.paMax) || !g_ctx.paMax) {
+        fprintf(stderr, "FAIL: VMMDLL_ConfigGet: max native address\n");
+        goto fail;
+    }
+    if(!Bench_InitializeTarget()) {
+        fprintf(stderr, "FAIL: unable to initialize target process\n");
+        goto fail;
+    }
+    if(!LeechCore_AllocScatterEmpty(BENCH_SCATTER_PAGES, &g_ctx.ppMEMs) || !(g_ctx.pbVfs = LocalAlloc(0, BENCH_VFS_READ_CHUNK))) {
+        fprintf(stderr, "FAIL: out of memory\n");
+        goto fail;
+    }
+    // scatter read
+    Def = (BENCH_DEFINITION){ "scatter_read_cold", "bytes", NULL, Bench_ScatterRead };
+    Bench_Run(&Def, VMMDLL_FLAG_NOCACHE);
+    Def = (BENCH_DEFINITION){ "scatter_read_warm", "bytes", NULL, Bench_ScatterRead };
+    Bench_Run(&Def, 0);
+    // pte scan - scalar vs vectorized (x64 targets only)
+    if(Bench_InitializePageTables()) {
+        Def = (BENCH_DEFINITION){ "pte_scan_scalar", "tables", NULL, Bench_PteScan };
+        Bench_Run(&Def, 0);
+        Def = (BENCH_DEFINITION){ "pte_scan_sse2", "tables", NULL, Bench_PteScan };
+        Bench_Run(&Def, 1);
+        if(MmX64_PteScanIsAVX2()) {
+            Def = (BENCH_DEFINITION){ "pte_scan_avx2", "tables", NULL, Bench_PteScan };
+            Bench_Run(&Def, 2);
+        }
+    }
+    // xpress decompression - built-in vs ntdll
+    if(Bench_InitializeXpress()) {
+        Def = (BENCH_DEFINITION){ "xpress_native", "pages", NULL, Bench_Xpress };
+        Bench_Run(&Def, 0);
+        Def = (BENCH_DEFINITION){ "xpress_rtl", "pages", NULL, Bench_Xpress };
+        Bench_Run(&Def, 1);
+    }
+    // pid hash lookup scaling at 100..100K processes
+    Def = (BENCH_DEFINITION){ "pid_hash_lookup", "lookups", Bench_Setup_PidHash, Bench_PidHash };
+    for(qwProcesses = 100; qwProcesses <= 100000; qwProcesses *= 10) {
+        Bench_Run(&Def, qwProcesses);
+    }
+    // object manager allocation throughput and heap fragmentation - pooled vs heap
+    Def = (BENCH_DEFINITION){ "ob_alloc_pooled", "objects", NULL, Bench_ObAlloc };
+    Bench_Run(&Def, 0);
+    Def = (BENCH_DEFINITION){ "ob_alloc_heap", "objects", NULL, Bench_ObAlloc };
+    Bench_Run(&Def, 1);
+    Def = (BENCH_DEFINITION){ "ob_churn_pooled", "objects", NULL, Bench_ObChurn };
+    Bench_Run(&Def, 0);
+    Bench_ObChurnEx(0, TRUE);
+    Def = (BENCH_DEFINITION){ "ob_churn_heap", "objects", NULL, Bench_ObChurn };
+    Bench_Run(&Def, 1);
+    Bench_ObChurnEx(1, TRUE);
+    // virtual to physical translation
+    Def = (BENCH_DEFINITION){ "virt2phys", "translations", NULL, Bench_Virt2Phys };
+    Bench_Run(&Def, g_ctx.dwPID);
+    // small reads (warm - after warm-up run)
+    Def = (BENCH_DEFINITION){ "small_read_8", "reads", NULL, Bench_SmallRead };
+    Bench_Run(&Def, 8);
+    Def = (BENCH_DEFINITION){ "small_read_64", "reads", NULL, Bench_SmallRead };
+    Bench_Run(&Def, 64);
+    // map build times (cold - after refresh)
+    for(i = 0; i < _countof(DefMap); i++) {
+        Bench_Run(&DefMap[i], i);
+    }
+    // registry enumeration
+    Def = (BENCH_DEFINITION){ "registry_enum", "keys", NULL, Bench_Registry };
+    Bench_Run(&Def, BENCH_REGISTRY_DEPTH_MAX);
+    // per-process action scaling at 1..N threads
+    Def = (BENCH_DEFINITION){ "process_parallel", "processes", Bench_Setup_Refresh, Bench_Parallel };
+    for(qwThreads = 1; qwThreads <= g_ctx.cThreadMax; qwThreads = (qwThreads < g_ctx.cThreadMax) ? min(qwThreads << 1, g_ctx.cThreadMax) : (qwThreads + 1)) {
+        Bench_Run(&Def, qwThreads);
+    }
+    // vfs read throughput
+    Def = (BENCH_DEFINITION){ "vfs_read_cold", "bytes", Bench_Setup_Refresh, Bench_VfsRead };
+    Bench_Run(&Def, 0);
+    Def = (BENCH_DEFINITION){ "vfs_read_warm", "bytes", NULL, Bench_VfsRead };
+    Bench_Run(&Def, 1);
+    // vfs sequential small read throughput - direct vs read-ahead (cold)
+    Def = (BENCH_DEFINITION){ "vfs_readahead_off", "bytes", Bench_Setup_VfsReadAhead, Bench_VfsReadAhead };
+    Bench_Run(&Def, 0);
+    Def = (BENCH_DEFINITION){ "vfs_readahead_on", "bytes", Bench_Setup_VfsReadAhead, Bench_VfsReadAhead };
+    Bench_Run(&Def, 1);
+    Def = (BENCH_DEFINITION){ "vfs_readahead_invalidated", "bytes", Bench_Setup_VfsReadAhead, Bench_VfsReadAhead };
+    Bench_Run(&Def, 2);
+    // hexdump rendering throughput
+    if(VMMDLL_UtilFillHexAscii(g_ctx.pbVfs, BENCH_HEXASCII_SIZE, 0, NULL, &g_ctx.cszHexAscii) && (g_ctx.szHexAscii = LocalAlloc(0, g_ctx.cszHexAscii))) {
+        Def = (BENCH_DEFINITION){ "fill_hex_ascii", "bytes", NULL, Bench_FillHexAscii };
+        Bench_Run(&Def, 0);
+    }
+    VfsReadAhead_Free(g_ctx.pVfsReadAhead);
+    LocalFree(g_ctx.pbPidHash);
+    LocalFree(g_ctx.pcbXpress);
+    LocalFree(g_ctx.pbXpress);
+    LocalFree(g_ctx.pqwPageTables);
+    LocalFree(g_ctx.szHexAscii);
+    LocalFree(g_ctx.pbVfs);
+    LeechCore_MemFree(g_ctx.ppMEMs);
+    LocalFree(g_ctx.pVAs);
+    LocalFree(g_ctx.pPIDs);
+    VMMDLL_Close();
+    return 0;
+fail:
+    VfsReadAhead_Free(g_ctx.pVfsReadAhead);
+    LocalFree(g_ctx.pbPidHash);
+    LocalFree(g_ctx.pcbXpress);
+    LocalFree(g_ctx.pbXpress);
+    LocalFree(g_ctx.pqwPageTables);
+    LocalFree(g_ctx.szHexAscii);
+    LocalFree(g_ctx.pbVfs);
+    LeechCore_MemFree(g_ctx.ppMEMs);
+    LocalFree(g_ctx.pVAs);
+    LocalFree(g_ctx.pPIDs);
+    VMMDLL_Close();
+    return 1;
+}
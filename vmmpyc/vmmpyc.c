@@ -94,7 +94,9 @@ VMMPYC_Initialize(PyObject *self, PyObject *args)
 
     }
     Py_DECREF(pyList);
+    Py_BEGIN_ALLOW_THREADS;
     result = VMMDLL_Initialize(cDstArgs, pszDstArgs);
+    Py_END_ALLOW_THREADS;
     for(i = 0; i < cDstArgs; i++) {
         Py_XDECREF(pyBytesDstArgs[i]);
     }
@@ -168,105 +170,226 @@ VMMPYC_ConfigSet(PyObject *self, PyObject *args)
 // VMMPYC C-PYTHON FUNCTIONS BELOW:
 //-----------------------------------------------------------------------------
 
-// (DWORD, [STR], (DWORD)) -> [{...}]
-static PyObject*
-VMMPYC_MemReadScatter(PyObject *self, PyObject *args)
+/*
+* Read a list of 4kB page sized and aligned addresses into one contiguous
+* destination buffer - page i is read into pbData + i * 0x1000. The GIL is
+* released around the read. Pages that failed to read are zero-filled and
+* have their bit in the optional validity bitmap cleared.
+* NB! the python interpreter lock is required on entry and exit.
+* -- szFn = function name for error messages.
+* -- dwPID
+* -- pyListSrc = list of addresses (borrowed reference).
+* -- flags
+* -- pbData = destination buffer of (number of addresses * 0x1000) bytes.
+* -- pbBitmap = optional bitmap of ((number of addresses + 7) / 8) bytes.
+* -- pcbRead = optional ptr to receive the number of bytes successfully read.
+* -- return = TRUE on success, FALSE with a python exception set on failure.
+*/
+_Success_(return)
+BOOL VMMPYC_MemReadScatter_Contiguous(_In_ LPSTR szFn, _In_ DWORD dwPID, _In_ PyObject *pyListSrc, _In_ DWORD flags, _Out_ PBYTE pbData, _Out_opt_ PBYTE pbBitmap, _Out_opt_ PQWORD pcbRead)
 {
-    PyObject *pyListSrc, *pyListItemSrc, *pyListDst, *pyDict;
+    PyObject *pyListItemSrc;
     BOOL result;
-    DWORD dwPID, cMEMs, flags = 0;
-    ULONG64 i, qwA;
+    DWORD i, cMEMs;
+    QWORD qwA, cbRead = 0;
+    PBYTE pb;
     PMEM_IO_SCATTER_HEADER pMEM, pMEMs;
     PPMEM_IO_SCATTER_HEADER ppMEMs;
-    PBYTE pb, pbDataBuffer;
-    if(!PyArg_ParseTuple(args, "kO!|k", &dwPID, &PyList_Type, &pyListSrc, &flags)) { return NULL; } // borrowed reference
     cMEMs = (DWORD)PyList_Size(pyListSrc);
-    if(cMEMs == 0) { 
-        Py_DECREF(pyListSrc);
-        return PyList_New(0);
-    }
-    // allocate & initialize buffer+basic
-    pb = LocalAlloc(0, cMEMs * (sizeof(PMEM_IO_SCATTER_HEADER) + sizeof(MEM_IO_SCATTER_HEADER) + 0x1000));
-    if(!pb) {
-        Py_DECREF(pyListSrc);
-        return PyErr_NoMemory();
+    if(pbBitmap) { ZeroMemory(pbBitmap, (cMEMs + 7) / 8); }
+    if(pcbRead) { *pcbRead = 0; }
+    if(cMEMs == 0) { return TRUE; }
+    // allocate & initialize scatter headers - data is read directly into pbData
+    if(!(pb = LocalAlloc(LMEM_ZEROINIT, cMEMs * (sizeof(PMEM_IO_SCATTER_HEADER) + sizeof(MEM_IO_SCATTER_HEADER))))) {
+        PyErr_NoMemory();
+        return FALSE;
     }
     ppMEMs = (PPMEM_IO_SCATTER_HEADER)pb;
     pMEMs = (PMEM_IO_SCATTER_HEADER)(pb + cMEMs * sizeof(PMEM_IO_SCATTER_HEADER));
-    pbDataBuffer = pb + cMEMs * (sizeof(PMEM_IO_SCATTER_HEADER) + sizeof(MEM_IO_SCATTER_HEADER));
-    ZeroMemory(pb, pbDataBuffer - pb);
-    // iterate over # entries and build scatter data structure
     for(i = 0; i < cMEMs; i++) {
         pMEM = pMEMs + i;
         pyListItemSrc = PyList_GetItem(pyListSrc, i); // borrowed reference
         if(!pyListItemSrc || !PyLong_Check(pyListItemSrc)) {
-            Py_DECREF(pyListSrc);
             LocalFree(pb);
-            return PyErr_Format(PyExc_RuntimeError, "VMMPYC_MemReadScatter: Argument list contains non numeric item.");
+            PyErr_Format(PyExc_RuntimeError, "%s: Argument list contains non numeric item.", szFn);
+            return FALSE;
         }
         qwA = PyLong_AsUnsignedLongLong(pyListItemSrc);
         if(qwA == (ULONG64)-1) {
-            Py_DECREF(pyListSrc);
             LocalFree(pb);
-            return PyErr_Format(PyExc_RuntimeError, "VMMPYC_MemReadScatter: Argument list contains out-of-range numeric item.");
+            PyErr_Format(PyExc_RuntimeError, "%s: Argument list contains out-of-range numeric item.", szFn);
+            return FALSE;
         }
         pMEM->cbMax = 0x1000;
-        pMEM->pb = pbDataBuffer + (i << 12);
+        pMEM->pb = pbData + ((QWORD)i << 12);
         pMEM->qwA = qwA;
         ppMEMs[i] = pMEM;
     }
-    Py_DECREF(pyListSrc);
     // call c-dll for vmm
     Py_BEGIN_ALLOW_THREADS;
     result = VMMDLL_MemReadScatter(dwPID, ppMEMs, cMEMs, flags);
+    if(result) {
+        for(i = 0; i < cMEMs; i++) {
+            pMEM = pMEMs + i;
+            if(pMEM->cb == 0x1000) {
+                if(pbBitmap) { pbBitmap[i >> 3] |= 1 << (i & 7); }
+                cbRead += 0x1000;
+            } else {
+                ZeroMemory(pMEM->pb, 0x1000);
+            }
+        }
+    }
     Py_END_ALLOW_THREADS;
     if(!result) {
         LocalFree(pb);
-        return PyErr_Format(PyExc_RuntimeError, "VMMPYC_MemReadScatter: Failed.");
+        PyErr_Format(PyExc_RuntimeError, "%s: Failed.", szFn);
+        return FALSE;
+    }
+    if(pcbRead) { *pcbRead = cbRead; }
+    LocalFree(pb);
+    return TRUE;
+}
+
+// (DWORD, [ULONG64], (DWORD)) -> [{...}]
+static PyObject*
+VMMPYC_MemReadScatter(PyObject *self, PyObject *args)
+{
+    PyObject *pyListSrc, *pyListDst, *pyDict, *pyBitmap;
+    DWORD dwPID, cMEMs, flags = 0;
+    ULONG64 i, qwA;
+    PBYTE pbData, pbBitmap;
+    if(!PyArg_ParseTuple(args, "kO!|k", &dwPID, &PyList_Type, &pyListSrc, &flags)) { return NULL; } // borrowed reference
+    cMEMs = (DWORD)PyList_Size(pyListSrc);
+    if(cMEMs == 0) {
+        return PyList_New(0);
+    }
+    if(!(pbData = LocalAlloc(0, (SIZE_T)cMEMs << 12))) { return PyErr_NoMemory(); }
+    if(!(pyBitmap = PyBytes_FromStringAndSize(NULL, (cMEMs + 7) / 8))) {
+        LocalFree(pbData);
+        return NULL;
+    }
+    pbBitmap = (PBYTE)PyBytes_AsString(pyBitmap);
+    if(!VMMPYC_MemReadScatter_Contiguous("VMMPYC_MemReadScatter", dwPID, pyListSrc, flags, pbData, pbBitmap, NULL)) {
+        Py_DECREF(pyBitmap);
+        LocalFree(pbData);
+        return NULL;
     }
     if(!(pyListDst = PyList_New(0))) {
-        LocalFree(pb);
+        Py_DECREF(pyBitmap);
+        LocalFree(pbData);
         return PyErr_NoMemory();
     }
     for(i = 0; i < cMEMs; i++) {
-        pMEM = pMEMs + i;
+        qwA = PyLong_AsUnsignedLongLong(PyList_GetItem(pyListSrc, i));
         if((pyDict = PyDict_New())) {
-            PyDict_SetItemString_DECREF(pyDict, "addr", PyLong_FromUnsignedLongLong(pMEM->qwA));
-            PyDict_SetItemString_DECREF(pyDict, ((dwPID == -1) ? "pa" : "va"), PyLong_FromUnsignedLongLong(pMEM->qwA));
-            PyDict_SetItemString_DECREF(pyDict, "data", PyBytes_FromStringAndSize(pMEM->pb, 0x1000));
-            PyDict_SetItemString_DECREF(pyDict, "size", PyLong_FromUnsignedLong(pMEM->cb));
+            PyDict_SetItemString_DECREF(pyDict, "addr", PyLong_FromUnsignedLongLong(qwA));
+            PyDict_SetItemString_DECREF(pyDict, ((dwPID == -1) ? "pa" : "va"), PyLong_FromUnsignedLongLong(qwA));
+            PyDict_SetItemString_DECREF(pyDict, "data", PyBytes_FromStringAndSize(pbData + (i << 12), 0x1000));
+            PyDict_SetItemString_DECREF(pyDict, "size", PyLong_FromUnsignedLong(((pbBitmap[i >> 3] >> (i & 7)) & 1) ? 0x1000 : 0));
             PyList_Append_DECREF(pyListDst, pyDict);
         }
     }
-    LocalFree(pb);
+    Py_DECREF(pyBitmap);
+    LocalFree(pbData);
     return pyListDst;
 }
 
+// (DWORD, [ULONG64], (DWORD)) -> (PBYTE, PBYTE)
+static PyObject*
+VMMPYC_MemReadScatterContiguous(PyObject *self, PyObject *args)
+{
+    PyObject *pyListSrc, *pyData, *pyBitmap, *pyResult;
+    DWORD dwPID, cMEMs, flags = 0;
+    if(!PyArg_ParseTuple(args, "kO!|k", &dwPID, &PyList_Type, &pyListSrc, &flags)) { return NULL; } // borrowed reference
+    cMEMs = (DWORD)PyList_Size(pyListSrc);
+    if(cMEMs > 0x00010000) { return PyErr_Format(PyExc_RuntimeError, "VMMPYC_MemReadScatterContiguous: Read larger than maximum supported (0x10000) pages requested."); }
+    // result objects are not yet shared - safe to read into without the GIL.
+    if(!(pyData = PyBytes_FromStringAndSize(NULL, (Py_ssize_t)cMEMs << 12))) { return NULL; }
+    if(!(pyBitmap = PyBytes_FromStringAndSize(NULL, (cMEMs + 7) / 8))) {
+        Py_DECREF(pyData);
+        return NULL;
+    }
+    if(!VMMPYC_MemReadScatter_Contiguous("VMMPYC_MemReadScatterContiguous", dwPID, pyListSrc, flags, (PBYTE)PyBytes_AsString(pyData), (PBYTE)PyBytes_AsString(pyBitmap), NULL)) {
+        Py_DECREF(pyData);
+        Py_DECREF(pyBitmap);
+        return NULL;
+    }
+    pyResult = PyTuple_Pack(2, pyData, pyBitmap);
+    Py_DECREF(pyData);
+    Py_DECREF(pyBitmap);
+    return pyResult;
+}
+
+// (DWORD, [ULONG64], BYTEARRAY, (DWORD)) -> PBYTE
+static PyObject*
+VMMPYC_MemReadScatterInto(PyObject *self, PyObject *args)
+{
+    PyObject *pyListSrc, *pyByteArray, *pyBitmap;
+    DWORD dwPID, cMEMs, flags = 0;
+    if(!PyArg_ParseTuple(args, "kO!O!|k", &dwPID, &PyList_Type, &pyListSrc, &PyByteArray_Type, &pyByteArray, &flags)) { return NULL; } // borrowed reference
+    cMEMs = (DWORD)PyList_Size(pyListSrc);
+    if(cMEMs > 0x00010000) { return PyErr_Format(PyExc_RuntimeError, "VMMPYC_MemReadScatterInto: Read larger than maximum supported (0x10000) pages requested."); }
+    if((QWORD)PyByteArray_Size(pyByteArray) < ((QWORD)cMEMs << 12)) {
+        return PyErr_Format(PyExc_RuntimeError, "VMMPYC_MemReadScatterInto: Destination buffer too small.");
+    }
+    if(!(pyBitmap = PyBytes_FromStringAndSize(NULL, (cMEMs + 7) / 8))) { return NULL; }
+    if(!VMMPYC_MemReadScatter_Contiguous("VMMPYC_MemReadScatterInto", dwPID, pyListSrc, flags, (PBYTE)PyByteArray_AsString(pyByteArray), (PBYTE)PyBytes_AsString(pyBitmap), NULL)) {
+        Py_DECREF(pyBitmap);
+        return NULL;
+    }
+    return pyBitmap;
+}
+
 // (DWORD, ULONG64, DWORD, (ULONG64)) -> PBYTE
 static PyObject*
 VMMPYC_MemRead(PyObject *self, PyObject *args)
 {
-    PyObject *pyBytes;
+    PyObject *pyBytes, *pyBytesShort;
     BOOL result;
     DWORD dwPID, cb, cbRead = 0;
     ULONG64 qwA, flags = 0;
     PBYTE pb;
     if(!PyArg_ParseTuple(args, "kKk|K", &dwPID, &qwA, &cb, &flags)) { return NULL; }
     if(cb > 0x01000000) { return PyErr_Format(PyExc_RuntimeError, "VMMPYC_MemRead: Read larger than maximum supported (0x01000000) bytes requested."); }
-    pb = LocalAlloc(0, cb);
-    if(!pb) { return PyErr_NoMemory(); }
+    // read directly into the (not yet shared) result bytes object.
+    if(!(pyBytes = PyBytes_FromStringAndSize(NULL, cb))) { return NULL; }
+    pb = (PBYTE)PyBytes_AsString(pyBytes);
     Py_BEGIN_ALLOW_THREADS;
     result = VMMDLL_MemReadEx(dwPID, qwA, pb, cb, &cbRead, flags);
     Py_END_ALLOW_THREADS;
-    if(!result) { 
-        LocalFree(pb);
+    if(!result) {
+        Py_DECREF(pyBytes);
         return PyErr_Format(PyExc_RuntimeError, "VMMPYC_MemRead: Failed.");
     }
-    pyBytes = PyBytes_FromStringAndSize(pb, cbRead);
-    LocalFree(pb);
+    if(cbRead < cb) {
+        pyBytesShort = PyBytes_FromStringAndSize(pb, cbRead);
+        Py_DECREF(pyBytes);
+        return pyBytesShort;
+    }
     return pyBytes;
 }
 
+// (DWORD, ULONG64, BYTEARRAY, (ULONG64)) -> DWORD
+static PyObject*
+VMMPYC_MemReadInto(PyObject *self, PyObject *args)
+{
+    PyObject *pyByteArray;
+    BOOL result;
+    DWORD dwPID, cb, cbRead = 0;
+    ULONG64 qwA, flags = 0;
+    PBYTE pb;
+    if(!PyArg_ParseTuple(args, "kKO!|K", &dwPID, &qwA, &PyByteArray_Type, &pyByteArray, &flags)) { return NULL; } // borrowed reference
+    if(PyByteArray_Size(pyByteArray) > 0x01000000) { return PyErr_Format(PyExc_RuntimeError, "VMMPYC_MemReadInto: Read larger than maximum supported (0x01000000) bytes requested."); }
+    cb = (DWORD)PyByteArray_Size(pyByteArray);
+    if(cb == 0) { return PyLong_FromUnsignedLong(0); }
+    pb = (PBYTE)PyByteArray_AsString(pyByteArray);
+    Py_BEGIN_ALLOW_THREADS;
+    result = VMMDLL_MemReadEx(dwPID, qwA, pb, cb, &cbRead, flags);
+    Py_END_ALLOW_THREADS;
+    if(!result) { return PyErr_Format(PyExc_RuntimeError, "VMMPYC_MemReadInto: Failed."); }
+    return PyLong_FromUnsignedLong(cbRead);
+}
+
 // (DWORD, ULONG64, PBYTE) -> None
 static PyObject*
 VMMPYC_MemWrite(PyObject *self, PyObject *args)
@@ -1473,6 +1596,386 @@ VMMPYC_VfsList(PyObject *self, PyObject *args)
     return pyDict;
 }
 
+
+
+//-----------------------------------------------------------------------------
+// VMMPYC C-PYTHON PACKED (COLUMNAR) MAP FUNCTIONS BELOW:
+// Maps are returned as a dict with one packed 'entries' bytes object of
+// 'count' fixed size entries and one 'strings' bytes object. Strings are
+// null-terminated UTF-16LE and are referenced from the entries by a byte
+// offset and a length in characters (not including the terminating null).
+// The entry layouts below are mirrored as NumPy dtypes in vmmpy.py - any
+// change must be made in both places.
+//-----------------------------------------------------------------------------
+
+#pragma pack(push, 1)
+typedef struct tdVMMPYC_PACKED_PTEENTRY {
+    QWORD va;
+    QWORD cPages;
+    QWORD fPage;
+    DWORD fWoW64;
+    DWORD oTag;
+    DWORD cchTag;
+    DWORD _Reserved;
+} VMMPYC_PACKED_PTEENTRY, *PVMMPYC_PACKED_PTEENTRY;
+
+typedef struct tdVMMPYC_PACKED_VADENTRY {
+    QWORD vaStart;
+    QWORD vaEnd;
+    QWORD vaVad;
+    QWORD vaSubsection;
+    QWORD vaPrototypePte;
+    DWORD cbPrototypePte;
+    DWORD CommitCharge;
+    BYTE VadType;
+    BYTE Protection;
+    BYTE fImage;
+    BYTE fFile;
+    BYTE fPageFile;
+    BYTE fPrivateMemory;
+    BYTE fTeb;
+    BYTE fStack;
+    BYTE fHeap;
+    BYTE HeapNum;
+    BYTE MemCommit;
+    BYTE _Reserved1;
+    DWORD oTag;
+    DWORD cchTag;
+    DWORD _Reserved2;
+} VMMPYC_PACKED_VADENTRY, *PVMMPYC_PACKED_VADENTRY;
+
+typedef struct tdVMMPYC_PACKED_THREADENTRY {
+    DWORD dwTID;
+    DWORD dwPID;
+    DWORD dwExitStatus;
+    BYTE bState;
+    BYTE bRunning;
+    BYTE bPriority;
+    BYTE bBasePriority;
+    QWORD vaETHREAD;
+    QWORD vaTeb;
+    QWORD vaStartAddress;
+    QWORD vaStackBaseUser;
+    QWORD vaStackLimitUser;
+    QWORD vaStackBaseKernel;
+    QWORD vaStackLimitKernel;
+    QWORD ftCreateTime;
+    QWORD ftExitTime;
+} VMMPYC_PACKED_THREADENTRY, *PVMMPYC_PACKED_THREADENTRY;
+
+typedef struct tdVMMPYC_PACKED_HANDLEENTRY {
+    QWORD vaObject;
+    QWORD qwHandleCount;
+    QWORD qwPointerCount;
+    QWORD vaObjectCreateInfo;
+    QWORD vaSecurityDescriptor;
+    DWORD dwHandle;
+    DWORD dwGrantedAccess;
+    DWORD iType;
+    DWORD dwPID;
+    DWORD dwPoolTag;
+    DWORD oTag;
+    DWORD cchTag;
+    DWORD oType;
+    DWORD cchType;
+    DWORD _Reserved;
+} VMMPYC_PACKED_HANDLEENTRY, *PVMMPYC_PACKED_HANDLEENTRY;
+#pragma pack(pop)
+
+/*
+* Allocate the result bytes objects for a packed map. The objects are not yet
+* shared and are filled in place by the caller.
+* -- cMap
+* -- cbEntry
+* -- cbStrings
+* -- ppyEntries
+* -- ppyStrings
+* -- return
+*/
+_Success_(return)
+BOOL VMMPYC_Packed_Alloc(_In_ DWORD cMap, _In_ DWORD cbEntry, _In_ QWORD cbStrings, _Out_ PyObject **ppyEntries, _Out_ PyObject **ppyStrings)
+{
+    *ppyStrings = NULL;
+    if(cbStrings > 0x7fffffff) {
+        PyErr_NoMemory();
+        return FALSE;
+    }
+    if(!(*ppyEntries = PyBytes_FromStringAndSize(NULL, (Py_ssize_t)cMap * cbEntry))) { return FALSE; }
+    if(!(*ppyStrings = PyBytes_FromStringAndSize(NULL, (Py_ssize_t)max(2, cbStrings)))) {
+        Py_DECREF(*ppyEntries);
+        *ppyEntries = NULL;
+        return FALSE;
+    }
+    ZeroMemory(PyBytes_AsString(*ppyEntries), (SIZE_T)cMap * cbEntry);
+    ZeroMemory(PyBytes_AsString(*ppyStrings), 2);       // offset 0 = empty string
+    return TRUE;
+}
+
+/*
+* Append a string to the packed string blob.
+* -- wsz = string to append (or NULL).
+* -- cwsz = wchar count not including terminating null.
+* -- pbStrings = string blob.
+* -- pcbStrings = current blob byte length - updated on append.
+* -- poString = ptr to receive the byte offset of the string.
+* -- pcchString = ptr to receive the wchar count of the string.
+*/
+VOID VMMPYC_Packed_AppendString(_In_opt_ LPWSTR wsz, _In_ DWORD cwsz, _Inout_ PBYTE pbStrings, _Inout_ PDWORD pcbStrings, _Out_ PDWORD poString, _Out_ PDWORD pcchString)
+{
+    if(!wsz || !cwsz) {
+        *poString = 0;
+        *pcchString = 0;
+        return;
+    }
+    *poString = *pcbStrings;
+    *pcchString = cwsz;
+    memcpy(pbStrings + *pcbStrings, wsz, cwsz * sizeof(WCHAR));
+    *(PWCHAR)(pbStrings + *pcbStrings + cwsz * sizeof(WCHAR)) = 0;
+    *pcbStrings += (cwsz + 1) * sizeof(WCHAR);
+}
+
+/*
+* Build the packed map result dict. Steals the references to the bytes objects.
+* The strings bytes object is truncated (copied) only if not fully used.
+* -- pyEntries
+* -- pyStrings
+* -- cMap
+* -- cbEntry
+* -- cbStrings = used byte length of the strings bytes object.
+* -- return
+*/
+PyObject* VMMPYC_Packed_Result(_In_ PyObject *pyEntries, _In_ PyObject *pyStrings, _In_ DWORD cMap, _In_ DWORD cbEntry, _In_ DWORD cbStrings)
+{
+    PyObject *pyDict, *pyStringsShort;
+    if((DWORD)PyBytes_Size(pyStrings) != cbStrings) {
+        pyStringsShort = PyBytes_FromStringAndSize(PyBytes_AsString(pyStrings), cbStrings);
+        Py_DECREF(pyStrings);
+        if(!(pyStrings = pyStringsShort)) {
+            Py_DECREF(pyEntries);
+            return NULL;
+        }
+    }
+    if(!(pyDict = PyDict_New())) {
+        Py_DECREF(pyEntries);
+        Py_DECREF(pyStrings);
+        return PyErr_NoMemory();
+    }
+    PyDict_SetItemString_DECREF(pyDict, "count", PyLong_FromUnsignedLong(cMap));
+    PyDict_SetItemString_DECREF(pyDict, "entry-size", PyLong_FromUnsignedLong(cbEntry));
+    PyDict_SetItemString_DECREF(pyDict, "entries", pyEntries);
+    PyDict_SetItemString_DECREF(pyDict, "strings", pyStrings);
+    return pyDict;
+}
+
+// (DWORD, (BOOL)) -> {...}
+static PyObject*
+VMMPYC_ProcessGetPteMapPacked(PyObject *self, PyObject *args)
+{
+    PyObject *pyEntries, *pyStrings;
+    BOOL result, fIdentifyModules = FALSE;
+    DWORD dwPID, i, cbStrings = 2;
+    DWORD cbPteMap = 0;
+    QWORD cbStringsMax = 2;
+    PVMMDLL_MAP_PTEENTRY pe;
+    PVMMDLL_MAP_PTE pPteMap = NULL;
+    PVMMPYC_PACKED_PTEENTRY pp;
+    PBYTE pbStrings;
+    if(!PyArg_ParseTuple(args, "k|p", &dwPID, &fIdentifyModules)) { return NULL; }
+    Py_BEGIN_ALLOW_THREADS;
+    result =
+        VMMDLL_ProcessMap_GetPte(dwPID, NULL, &cbPteMap, fIdentifyModules) &&
+        cbPteMap &&
+        (pPteMap = LocalAlloc(0, cbPteMap)) &&
+        VMMDLL_ProcessMap_GetPte(dwPID, pPteMap, &cbPteMap, fIdentifyModules);
+    Py_END_ALLOW_THREADS;
+    if(!result) {
+        LocalFree(pPteMap);
+        return PyErr_Format(PyExc_RuntimeError, "VMMPYC_ProcessGetPteMapPacked: Failed.");
+    }
+    for(i = 0; i < pPteMap->cMap; i++) {
+        cbStringsMax += (pPteMap->pMap[i].cwszText + 1ULL) * sizeof(WCHAR);
+    }
+    if(!VMMPYC_Packed_Alloc(pPteMap->cMap, sizeof(VMMPYC_PACKED_PTEENTRY), cbStringsMax, &pyEntries, &pyStrings)) {
+        LocalFree(pPteMap);
+        return NULL;
+    }
+    pp = (PVMMPYC_PACKED_PTEENTRY)PyBytes_AsString(pyEntries);
+    pbStrings = (PBYTE)PyBytes_AsString(pyStrings);
+    for(i = 0; i < pPteMap->cMap; i++, pp++) {
+        pe = pPteMap->pMap + i;
+        pp->va = pe->vaBase;
+        pp->cPages = pe->cPages;
+        pp->fPage = pe->fPage;
+        pp->fWoW64 = pe->fWoW64 ? 1 : 0;
+        VMMPYC_Packed_AppendString(pe->wszText, pe->cwszText, pbStrings, &cbStrings, &pp->oTag, &pp->cchTag);
+    }
+    LocalFree(pPteMap);
+    return VMMPYC_Packed_Result(pyEntries, pyStrings, i, sizeof(VMMPYC_PACKED_PTEENTRY), cbStrings);
+}
+
+// (DWORD, (BOOL)) -> {...}
+static PyObject*
+VMMPYC_ProcessGetVadMapPacked(PyObject *self, PyObject *args)
+{
+    PyObject *pyEntries, *pyStrings;
+    BOOL result, fIdentifyModules = FALSE;
+    DWORD dwPID, i, cbStrings = 2;
+    DWORD cbVadMap = 0;
+    QWORD cbStringsMax = 2;
+    PVMMDLL_MAP_VADENTRY pe;
+    PVMMDLL_MAP_VAD pVadMap = NULL;
+    PVMMPYC_PACKED_VADENTRY pp;
+    PBYTE pbStrings;
+    if(!PyArg_ParseTuple(args, "k|p", &dwPID, &fIdentifyModules)) { return NULL; }
+    Py_BEGIN_ALLOW_THREADS;
+    result =
+        VMMDLL_ProcessMap_GetVad(dwPID, NULL, &cbVadMap, fIdentifyModules) &&
+        cbVadMap &&
+        (pVadMap = LocalAlloc(0, cbVadMap)) &&
+        VMMDLL_ProcessMap_GetVad(dwPID, pVadMap, &cbVadMap, fIdentifyModules);
+    Py_END_ALLOW_THREADS;
+    if(!result) {
+        LocalFree(pVadMap);
+        return PyErr_Format(PyExc_RuntimeError, "VMMPYC_ProcessGetVadMapPacked: Failed.");
+    }
+    for(i = 0; i < pVadMap->cMap; i++) {
+        cbStringsMax += (pVadMap->pMap[i].cwszText + 1ULL) * sizeof(WCHAR);
+    }
+    if(!VMMPYC_Packed_Alloc(pVadMap->cMap, sizeof(VMMPYC_PACKED_VADENTRY), cbStringsMax, &pyEntries, &pyStrings)) {
+        LocalFree(pVadMap);
+        return NULL;
+    }
+    pp = (PVMMPYC_PACKED_VADENTRY)PyBytes_AsString(pyEntries);
+    pbStrings = (PBYTE)PyBytes_AsString(pyStrings);
+    for(i = 0; i < pVadMap->cMap; i++, pp++) {
+        pe = pVadMap->pMap + i;
+        pp->vaStart = pe->vaStart;
+        pp->vaEnd = pe->vaEnd;
+        pp->vaVad = pe->vaVad;
+        pp->vaSubsection = pe->vaSubsection;
+        pp->vaPrototypePte = pe->vaPrototypePte;
+        pp->cbPrototypePte = pe->cbPrototypePte;
+        pp->CommitCharge = pe->CommitCharge;
+        pp->VadType = (BYTE)pe->VadType;
+        pp->Protection = (BYTE)pe->Protection;
+        pp->fImage = (BYTE)pe->fImage;
+        pp->fFile = (BYTE)pe->fFile;
+        pp->fPageFile = (BYTE)pe->fPageFile;
+        pp->fPrivateMemory = (BYTE)pe->fPrivateMemory;
+        pp->fTeb = (BYTE)pe->fTeb;
+        pp->fStack = (BYTE)pe->fStack;
+        pp->fHeap = (BYTE)pe->fHeap;
+        pp->HeapNum = (BYTE)pe->HeapNum;
+        pp->MemCommit = (BYTE)pe->MemCommit;
+        VMMPYC_Packed_AppendString(pe->wszText, pe->cwszText, pbStrings, &cbStrings, &pp->oTag, &pp->cchTag);
+    }
+    LocalFree(pVadMap);
+    return VMMPYC_Packed_Result(pyEntries, pyStrings, i, sizeof(VMMPYC_PACKED_VADENTRY), cbStrings);
+}
+
+// (DWORD) -> {...}
+static PyObject*
+VMMPYC_ProcessGetThreadMapPacked(PyObject *self, PyObject *args)
+{
+    PyObject *pyEntries, *pyStrings;
+    BOOL result;
+    DWORD dwPID, i;
+    DWORD cbThreadMap = 0;
+    PVMMDLL_MAP_THREADENTRY pe;
+    PVMMDLL_MAP_THREAD pThreadMap = NULL;
+    PVMMPYC_PACKED_THREADENTRY pp;
+    if(!PyArg_ParseTuple(args, "k", &dwPID)) { return NULL; }
+    Py_BEGIN_ALLOW_THREADS;
+    result =
+        VMMDLL_ProcessMap_GetThread(dwPID, NULL, &cbThreadMap) &&
+        cbThreadMap &&
+        (pThreadMap = LocalAlloc(0, cbThreadMap)) &&
+        VMMDLL_ProcessMap_GetThread(dwPID, pThreadMap, &cbThreadMap);
+    Py_END_ALLOW_THREADS;
+    if(!result) {
+        LocalFree(pThreadMap);
+        return PyErr_Format(PyExc_RuntimeError, "VMMPYC_ProcessGetThreadMapPacked: Failed.");
+    }
+    if(!VMMPYC_Packed_Alloc(pThreadMap->cMap, sizeof(VMMPYC_PACKED_THREADENTRY), 2, &pyEntries, &pyStrings)) {
+        LocalFree(pThreadMap);
+        return NULL;
+    }
+    pp = (PVMMPYC_PACKED_THREADENTRY)PyBytes_AsString(pyEntries);
+    for(i = 0; i < pThreadMap->cMap; i++, pp++) {
+        pe = pThreadMap->pMap + i;
+        pp->dwTID = pe->dwTID;
+        pp->dwPID = pe->dwPID;
+        pp->dwExitStatus = pe->dwExitStatus;
+        pp->bState = pe->bState;
+        pp->bRunning = pe->bRunning;
+        pp->bPriority = pe->bPriority;
+        pp->bBasePriority = pe->bBasePriority;
+        pp->vaETHREAD = pe->vaETHREAD;
+        pp->vaTeb = pe->vaTeb;
+        pp->vaStartAddress = pe->vaStartAddress;
+        pp->vaStackBaseUser = pe->vaStackBaseUser;
+        pp->vaStackLimitUser = pe->vaStackLimitUser;
+        pp->vaStackBaseKernel = pe->vaStackBaseKernel;
+        pp->vaStackLimitKernel = pe->vaStackLimitKernel;
+        pp->ftCreateTime = pe->ftCreateTime;
+        pp->ftExitTime = pe->ftExitTime;
+    }
+    LocalFree(pThreadMap);
+    return VMMPYC_Packed_Result(pyEntries, pyStrings, i, sizeof(VMMPYC_PACKED_THREADENTRY), 2);
+}
+
+// (DWORD) -> {...}
+static PyObject*
+VMMPYC_ProcessGetHandleMapPacked(PyObject *self, PyObject *args)
+{
+    PyObject *pyEntries, *pyStrings;
+    BOOL result;
+    DWORD dwPID, i, cbStrings = 2, cbHandleMap = 0;
+    QWORD cbStringsMax = 2;
+    PVMMDLL_MAP_HANDLE pHandleMap = NULL;
+    PVMMDLL_MAP_HANDLEENTRY pe;
+    PVMMPYC_PACKED_HANDLEENTRY pp;
+    PBYTE pbStrings;
+    if(!PyArg_ParseTuple(args, "k", &dwPID)) { return NULL; }
+    Py_BEGIN_ALLOW_THREADS;
+    result =
+        VMMDLL_ProcessMap_GetHandle(dwPID, NULL, &cbHandleMap) &&
+        cbHandleMap &&
+        (pHandleMap = LocalAlloc(0, cbHandleMap)) &&
+        VMMDLL_ProcessMap_GetHandle(dwPID, pHandleMap, &cbHandleMap);
+    Py_END_ALLOW_THREADS;
+    if(!result) {
+        LocalFree(pHandleMap);
+        return PyErr_Format(PyExc_RuntimeError, "VMMPYC_ProcessGetHandleMapPacked: Failed.");
+    }
+    for(i = 0; i < pHandleMap->cMap; i++) {
+        cbStringsMax += (pHandleMap->pMap[i].cwszText + 1ULL + pHandleMap->pMap[i].cwszType + 1ULL) * sizeof(WCHAR);
+    }
+    if(!VMMPYC_Packed_Alloc(pHandleMap->cMap, sizeof(VMMPYC_PACKED_HANDLEENTRY), cbStringsMax, &pyEntries, &pyStrings)) {
+        LocalFree(pHandleMap);
+        return NULL;
+    }
+    pp = (PVMMPYC_PACKED_HANDLEENTRY)PyBytes_AsString(pyEntries);
+    pbStrings = (PBYTE)PyBytes_AsString(pyStrings);
+    for(i = 0; i < pHandleMap->cMap; i++, pp++) {
+        pe = pHandleMap->pMap + i;
+        pp->vaObject = pe->vaObject;
+        pp->qwHandleCount = pe->qwHandleCount;
+        pp->qwPointerCount = pe->qwPointerCount;
+        pp->vaObjectCreateInfo = pe->vaObjectCreateInfo;
+        pp->vaSecurityDescriptor = pe->vaSecurityDescriptor;
+        pp->dwHandle = pe->dwHandle;
+        pp->dwGrantedAccess = pe->dwGrantedAccess;
+        pp->iType = pe->iType;
+        pp->dwPID = pe->dwPID;
+        pp->dwPoolTag = pe->dwPoolTag;
+        VMMPYC_Packed_AppendString(pe->wszText, pe->cwszText, pbStrings, &cbStrings, &pp->oTag, &pp->cchTag);
+        VMMPYC_Packed_AppendString(pe->wszType, pe->cwszType, pbStrings, &cbStrings, &pp->oType, &pp->cchType);
+    }
+    LocalFree(pHandleMap);
+    return VMMPYC_Packed_Result(pyEntries, pyStrings, i, sizeof(VMMPYC_PACKED_HANDLEENTRY), cbStrings);
+}
+
 //-----------------------------------------------------------------------------
 // PY2C common functionality below:
 //-----------------------------------------------------------------------------
@@ -1484,7 +1987,10 @@ static PyMethodDef VMMPYC_EmbMethods[] = {
     {"VMMPYC_ConfigGet", VMMPYC_ConfigGet, METH_VARARGS, "Get a device specific option value."},
     {"VMMPYC_ConfigSet", VMMPYC_ConfigSet, METH_VARARGS, "Set a device specific option value."},
     {"VMMPYC_MemReadScatter", VMMPYC_MemReadScatter, METH_VARARGS, "Read multiple 4kB page sized and aligned chunks of memory given as an address list."},
+    {"VMMPYC_MemReadScatterContiguous", VMMPYC_MemReadScatterContiguous, METH_VARARGS, "Read multiple 4kB page sized and aligned chunks of memory into one contiguous buffer with a validity bitmap."},
+    {"VMMPYC_MemReadScatterInto", VMMPYC_MemReadScatterInto, METH_VARARGS, "Read multiple 4kB page sized and aligned chunks of memory into a caller supplied bytearray."},
     {"VMMPYC_MemRead", VMMPYC_MemRead, METH_VARARGS, "Read memory."},
+    {"VMMPYC_MemReadInto", VMMPYC_MemReadInto, METH_VARARGS, "Read memory into a caller supplied bytearray."},
     {"VMMPYC_MemWrite", VMMPYC_MemWrite, METH_VARARGS, "Write memory."},
     {"VMMPYC_MemVirt2Phys", VMMPYC_MemVirt2Phys, METH_VARARGS, "Translate a virtual address into a physical address."},
     {"VMMPYC_PidGetFromName", VMMPYC_PidGetFromName, METH_VARARGS, "Locate a process by name and return the PID."},
@@ -1496,6 +2002,10 @@ static PyMethodDef VMMPYC_EmbMethods[] = {
     {"VMMPYC_ProcessGetHeapMap", VMMPYC_ProcessGetHeapMap, METH_VARARGS, "Retrieve the heap map for a given process."},
     {"VMMPYC_ProcessGetThreadMap", VMMPYC_ProcessGetThreadMap, METH_VARARGS, "Retrieve the thread map for a given process."},
     {"VMMPYC_ProcessGetHandleMap", VMMPYC_ProcessGetHandleMap, METH_VARARGS, "Retrieve the handle map for a given process."},
+    {"VMMPYC_ProcessGetPteMapPacked", VMMPYC_ProcessGetPteMapPacked, METH_VARARGS, "Retrieve the PTE memory map for a given process as a packed buffer."},
+    {"VMMPYC_ProcessGetVadMapPacked", VMMPYC_ProcessGetVadMapPacked, METH_VARARGS, "Retrieve the VAD memory map for a given process as a packed buffer."},
+    {"VMMPYC_ProcessGetThreadMapPacked", VMMPYC_ProcessGetThreadMapPacked, METH_VARARGS, "Retrieve the thread map for a given process as a packed buffer."},
+    {"VMMPYC_ProcessGetHandleMapPacked", VMMPYC_ProcessGetHandleMapPacked, METH_VARARGS, "Retrieve the handle map for a given process as a packed buffer."},
     {"VMMPYC_ProcessGetInformation", VMMPYC_ProcessGetInformation, METH_VARARGS, "Retrieve process information for a specific process."},
     {"VMMPYC_ProcessGetDirectories", VMMPYC_ProcessGetDirectories, METH_VARARGS, "Retrieve the data directories for a specific process and module."},
     {"VMMPYC_ProcessGetSections", VMMPYC_ProcessGetSections, METH_VARARGS, "Retrieve the sections for a specific process and module."},
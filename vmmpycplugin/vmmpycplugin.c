@@ -22,6 +22,44 @@
 // PY2C PYTHON CALLBACK FUNCTIONALITY BELOW:
 //-----------------------------------------------------------------------------
 
+#define PY2C_STAT_MAX               0x40
+#define PY2C_STAT_HEAVY_US          50000       // avg latency (us) above which a plugin is serialized.
+#define PY2C_STAT_FILENAME          "plugin-latency.txt"
+#define PY2C_STAT_FILENAMEW         L"plugin-latency.txt"
+#define PY2C_STAT_LINELENGTH        98
+#define PY2C_STAT_OP_LIST           0
+#define PY2C_STAT_OP_READ           1
+#define PY2C_STAT_OP_WRITE          2
+
+typedef struct tdPY2C_STAT_OP {
+    volatile LONG64 c;
+    volatile LONG64 tmTotal;
+    volatile LONG64 tmMax;
+} PY2C_STAT_OP, *PPY2C_STAT_OP;
+
+/*
+* Per python plugin latency statistics. A python plugin is identified by the
+* top-level directory below the 'py' directory. Plugins with an average call
+* latency above PY2C_STAT_HEAVY_US are serialized on LockSerialize before the
+* GIL is acquired so that threads waiting on a heavy plugin wait natively and
+* don't compete with other plugins for the GIL. Only the outermost callback on
+* a thread is serialized - a plugin may re-enter MemProcFS (and other python
+* plugins) through vmmpyc while it holds LockSerialize.
+*/
+typedef struct tdPY2C_STAT {
+    WCHAR wszName[32];
+    SRWLOCK LockSerialize;
+    volatile LONG64 tmAvg;                      // moving average latency (qpc ticks).
+    PY2C_STAT_OP Op[3];
+} PY2C_STAT, *PPY2C_STAT;
+
+typedef struct tdPY2C_STAT_CALL {
+    PPY2C_STAT pStat;
+    DWORD iOp;
+    BOOL fSerialized;
+    LARGE_INTEGER tmStart;
+} PY2C_STAT_CALL, *PPY2C_STAT_CALL;
+
 typedef struct tdPY2C_CONTEXT {
 	BOOL fPrintf;
 	BOOL fVerbose;
@@ -33,10 +71,19 @@ typedef struct tdPY2C_CONTEXT {
     PyObject *fnWrite;
 	PyObject *fnNotify;
     PyObject *fnClose;
+    struct {
+        SRWLOCK LockSRW;
+        QWORD qwFrequency;
+        DWORD c;
+        PY2C_STAT Plugin[PY2C_STAT_MAX];
+    } Stat;
 } PY2C_CONTEXT, *PPY2C_CONTEXT;
 
 PPY2C_CONTEXT ctxPY2C = NULL;
 
+// # of python plugin callbacks currently active on the calling thread.
+__declspec(thread) DWORD g_dwPY2C_StatCallDepth = 0;
+
 static PyObject*
 PY2C_CallbackRegister(PyObject *self, PyObject *args)
 {
@@ -68,6 +115,156 @@ BOOL PY2C_Util_TranslatePathDelimiterW(_Out_writes_(MAX_PATH) LPWSTR dst, LPWSTR
     return FALSE;
 }
 
+/*
+* Retrieve the statistics entry for the plugin the path belongs to. The entry
+* is created if it does not already exist.
+* -- wszPath = plugin path with '/' delimiter.
+* -- return = the statistics entry or NULL if the statistics table is full.
+*/
+PPY2C_STAT PY2C_Stat_Get(_In_ LPWSTR wszPath)
+{
+    DWORD i;
+    WCHAR wszName[32];
+    PPY2C_STAT pStat = NULL;
+    for(i = 0; (i < 31) && wszPath[i] && (wszPath[i] != '/'); i++) {
+        wszName[i] = wszPath[i];
+    }
+    wszName[i] = 0;
+    AcquireSRWLockShared(&ctxPY2C->Stat.LockSRW);
+    for(i = 0; i < ctxPY2C->Stat.c; i++) {
+        if(!_wcsicmp(ctxPY2C->Stat.Plugin[i].wszName, wszName)) {
+            pStat = ctxPY2C->Stat.Plugin + i;
+            break;
+        }
+    }
+    ReleaseSRWLockShared(&ctxPY2C->Stat.LockSRW);
+    if(pStat) { return pStat; }
+    AcquireSRWLockExclusive(&ctxPY2C->Stat.LockSRW);
+    for(i = 0; i < ctxPY2C->Stat.c; i++) {
+        if(!_wcsicmp(ctxPY2C->Stat.Plugin[i].wszName, wszName)) {
+            pStat = ctxPY2C->Stat.Plugin + i;
+            break;
+        }
+    }
+    if(!pStat && (ctxPY2C->Stat.c < PY2C_STAT_MAX)) {
+        pStat = ctxPY2C->Stat.Plugin + ctxPY2C->Stat.c;
+        wcscpy_s(pStat->wszName, _countof(pStat->wszName), wszName);
+        ctxPY2C->Stat.c++;
+    }
+    ReleaseSRWLockExclusive(&ctxPY2C->Stat.LockSRW);
+    return pStat;
+}
+
+/*
+* Start timing a python plugin callback. Heavy plugins are serialized here
+* unless the callback is nested inside another python plugin callback on the
+* same thread; waiting there could deadlock on a lock held further up the
+* stack - NB! must be called before the GIL is acquired.
+* -- pc
+* -- iOp = PY2C_STAT_OP_*
+* -- wszPath = plugin path with '/' delimiter.
+*/
+VOID PY2C_Stat_CallBegin(_Out_ PPY2C_STAT_CALL pc, _In_ DWORD iOp, _In_ LPWSTR wszPath)
+{
+    pc->iOp = iOp;
+    pc->fSerialized = FALSE;
+    if((pc->pStat = PY2C_Stat_Get(wszPath)) && !g_dwPY2C_StatCallDepth) {
+        if(pc->pStat->tmAvg > (LONG64)(ctxPY2C->Stat.qwFrequency * PY2C_STAT_HEAVY_US / 1000000)) {
+            AcquireSRWLockExclusive(&pc->pStat->LockSerialize);
+            pc->fSerialized = TRUE;
+        }
+    }
+    g_dwPY2C_StatCallDepth++;
+    QueryPerformanceCounter(&pc->tmStart);
+}
+
+/*
+* Finish timing a python plugin callback - must be called after the GIL has
+* been released.
+* -- pc
+*/
+VOID PY2C_Stat_CallEnd(_In_ PPY2C_STAT_CALL pc)
+{
+    LARGE_INTEGER tmEnd;
+    LONG64 tm, tmMax, tmAvg;
+    PPY2C_STAT_OP pOp;
+    g_dwPY2C_StatCallDepth--;
+    if(!pc->pStat) { return; }
+    QueryPerformanceCounter(&tmEnd);
+    tm = tmEnd.QuadPart - pc->tmStart.QuadPart;
+    if(pc->fSerialized) {
+        ReleaseSRWLockExclusive(&pc->pStat->LockSerialize);
+    }
+    pOp = pc->pStat->Op + pc->iOp;
+    InterlockedIncrement64(&pOp->c);
+    InterlockedAdd64(&pOp->tmTotal, tm);
+    while((tmMax = pOp->tmMax) < tm) {
+        if(tmMax == InterlockedCompareExchange64(&pOp->tmMax, tm, tmMax)) { break; }
+    }
+    tmAvg = pc->pStat->tmAvg;
+    InterlockedExchange64(&pc->pStat->tmAvg, tmAvg + (tm - tmAvg) / 8);
+}
+
+/*
+* Render the plugin latency statistics file.
+* -- pb = buffer to receive the file, or NULL to retrieve the size only.
+* -- cb
+* -- return = the file size.
+*/
+DWORD PY2C_Stat_Render(_Out_writes_opt_(cb) PBYTE pb, _In_ DWORD cb)
+{
+    int r;
+    DWORD i, j, o = 0, cStat;
+    QWORD qwAvgUs[3], qwFrequency = max(1, ctxPY2C->Stat.qwFrequency);
+    PPY2C_STAT pStat;
+    cStat = ctxPY2C->Stat.c;
+    if(!pb) { return (cStat + 1) * PY2C_STAT_LINELENGTH; }
+    for(i = 0; (i <= cStat) && (o + PY2C_STAT_LINELENGTH <= cb); i++) {
+        if(i == 0) {
+            r = _snprintf_s((LPSTR)pb + o, cb - o, _TRUNCATE, "%-24s %9s %9s %9s %9s %9s %9s %10s %c\n",
+                "Plugin", "List", "List(us)", "Read", "Read(us)", "Write", "Write(us)", "Max(us)", 'S');
+            if(r < 0) { break; }
+            o += r;
+            continue;
+        }
+        pStat = ctxPY2C->Stat.Plugin + i - 1;
+        for(j = 0; j < 3; j++) {
+            qwAvgUs[j] = pStat->Op[j].c ? (pStat->Op[j].tmTotal * 1000000 / qwFrequency / pStat->Op[j].c) : 0;
+        }
+        r = _snprintf_s((LPSTR)pb + o, cb - o, _TRUNCATE, "%-24.24S %9lli %9lli %9lli %9lli %9lli %9lli %10lli %c\n",
+            pStat->wszName[0] ? pStat->wszName : L"-",
+            pStat->Op[PY2C_STAT_OP_LIST].c, qwAvgUs[PY2C_STAT_OP_LIST],
+            pStat->Op[PY2C_STAT_OP_READ].c, qwAvgUs[PY2C_STAT_OP_READ],
+            pStat->Op[PY2C_STAT_OP_WRITE].c, qwAvgUs[PY2C_STAT_OP_WRITE],
+            max(max(pStat->Op[0].tmMax, pStat->Op[1].tmMax), pStat->Op[2].tmMax) * 1000000 / qwFrequency,
+            (pStat->tmAvg > (LONG64)(qwFrequency * PY2C_STAT_HEAVY_US / 1000000)) ? 'S' : '-');
+        if(r < 0) { break; }
+        o += r;
+    }
+    return o;
+}
+
+/*
+* Read the plugin latency statistics file - no GIL is required.
+*/
+NTSTATUS PY2C_Stat_Read(_Out_ LPVOID pb, _In_ DWORD cb, _Out_ PDWORD pcbRead, _In_ ULONG64 cbOffset)
+{
+    DWORD cbFile;
+    PBYTE pbFile;
+    *pcbRead = 0;
+    cbFile = PY2C_Stat_Render(NULL, 0) + PY2C_STAT_LINELENGTH;
+    if(!(pbFile = LocalAlloc(0, cbFile))) { return VMMDLL_STATUS_FILE_INVALID; }
+    cbFile = PY2C_Stat_Render(pbFile, cbFile);
+    if(cbOffset >= cbFile) {
+        LocalFree(pbFile);
+        return VMMDLL_STATUS_END_OF_FILE;
+    }
+    *pcbRead = (DWORD)min(cb, cbFile - cbOffset);
+    memcpy(pb, pbFile + cbOffset, *pcbRead);
+    LocalFree(pbFile);
+    return VMMDLL_STATUS_SUCCESS;
+}
+
 BOOL PY2C_Callback_List(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _Inout_ PHANDLE pFileList)
 {
     BOOL result = FALSE;
@@ -77,8 +274,13 @@ BOOL PY2C_Callback_List(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _Inout_ PHANDLE pFileLi
     PyGILState_STATE gstate;
     SIZE_T i, cList;
     WCHAR wszPathBuffer[MAX_PATH];
+    PY2C_STAT_CALL StatCall;
     if(!ctxPY2C->fInitialized) { return FALSE; }
     if(!PY2C_Util_TranslatePathDelimiterW(wszPathBuffer, ctx->wszPath)) { return FALSE; }
+    if((ctx->dwPID == -1) && !wszPathBuffer[0]) {
+        VMMDLL_VfsList_AddFile(pFileList, PY2C_STAT_FILENAME, PY2C_Stat_Render(NULL, 0));
+    }
+    PY2C_Stat_CallBegin(&StatCall, PY2C_STAT_OP_LIST, wszPathBuffer);
     gstate = PyGILState_Ensure();
     if(!(pyPath = PyUnicode_FromWideChar(wszPathBuffer, -1))) { goto fail; }
     pyPid = (ctx->dwPID == -1) ? NULL : PyLong_FromUnsignedLong(ctx->dwPID);
@@ -113,6 +315,7 @@ fail:
     Py_XDECREF(pyList);
     Py_XDECREF(pyPath);
     PyGILState_Release(gstate);
+    PY2C_Stat_CallEnd(&StatCall);
     return result;
 }
 
@@ -122,8 +325,13 @@ NTSTATUS PY2C_Callback_Read(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _Out_ LPVOID pb, _I
     PyObject *args = NULL, *pyBytes = NULL, *pyPid = NULL, *pyPath = NULL;
     PyGILState_STATE gstate;
     WCHAR wszPathBuffer[MAX_PATH];
+    PY2C_STAT_CALL StatCall;
     if(!ctxPY2C->fInitialized) { return FALSE; }
     if(!PY2C_Util_TranslatePathDelimiterW(wszPathBuffer, ctx->wszPath)) { return FALSE; }
+    if((ctx->dwPID == -1) && !_wcsicmp(wszPathBuffer, PY2C_STAT_FILENAMEW)) {
+        return PY2C_Stat_Read(pb, cb, pcbRead, cbOffset);
+    }
+    PY2C_Stat_CallBegin(&StatCall, PY2C_STAT_OP_READ, wszPathBuffer);
     gstate = PyGILState_Ensure();
     if(!(pyPath = PyUnicode_FromWideChar(wszPathBuffer, -1))) { goto fail; }
     pyPid = (ctx->dwPID == -1) ? NULL : PyLong_FromUnsignedLong(ctx->dwPID);
@@ -147,6 +355,7 @@ fail:
     Py_XDECREF(pyBytes);
     Py_XDECREF(pyPath);
     PyGILState_Release(gstate);
+    PY2C_Stat_CallEnd(&StatCall);
     return nt;
 }
 
@@ -156,9 +365,11 @@ NTSTATUS PY2C_Callback_Write(_In_ PVMMDLL_PLUGIN_CONTEXT ctx, _In_ LPVOID pb, _I
     PyObject *args = NULL, *pyLong = NULL, *pyPid = NULL, *pyPath = NULL;
     PyGILState_STATE gstate;
     WCHAR wszPathBuffer[MAX_PATH];
+    PY2C_STAT_CALL StatCall;
     *pcbWrite = 0;
     if(!ctxPY2C->fInitialized) { return VMMDLL_STATUS_FILE_INVALID; }
     if(!PY2C_Util_TranslatePathDelimiterW(wszPathBuffer, ctx->wszPath)) { return VMMDLL_STATUS_FILE_INVALID; }
+    PY2C_Stat_CallBegin(&StatCall, PY2C_STAT_OP_WRITE, wszPathBuffer);
     gstate = PyGILState_Ensure();
     if(!(pyPath = PyUnicode_FromWideChar(wszPathBuffer, -1))) { goto fail; }
     pyPid = (ctx->dwPID == -1) ? NULL : PyLong_FromUnsignedLong(ctx->dwPID);
@@ -180,6 +391,7 @@ fail:
     Py_XDECREF(pyLong);
     Py_XDECREF(pyPath);
     PyGILState_Release(gstate);
+    PY2C_Stat_CallEnd(&StatCall);
     return nt;
 }
 
@@ -292,6 +504,7 @@ BOOL VmmPyPlugin_PythonInitialize(_In_ HMODULE hDllPython)
         return FALSE;
     }
 	VmmPyPlugin_UpdateVerbosity();
+    QueryPerformanceFrequency((PLARGE_INTEGER)&ctxPY2C->Stat.qwFrequency);
     // 2: Construct Python Path
     Util_GetPathDll(wszPathBaseExe, NULL);
     Util_GetPathDll(wszPathBasePython, hDllPython);